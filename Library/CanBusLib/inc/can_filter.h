@@ -0,0 +1,101 @@
+/**************************************************************************//**
+ * @file     can_filter.h
+ * @version  V1.00
+ * @brief    CAN acceptance filter planner header file
+ *
+ * @note
+ *           The planner turns wanted identifier ranges and masks into the fewest identifier and mask pairs
+ *           that fit in the free message objects, and tells how many unwanted identifiers they let through.
+ *           It has no chip dependency, so it runs at start-up or on a PC. A filter has the meaning of the
+ *           message object registers: a 1 bit of u32Mask is compared, a 0 bit is accepted as either value.
+ *           Up to CAN_FILTER_EXACT_BLOCKS blocks are grouped by an exhaustive search. Larger sets are joined
+ *           greedily, which can let more unwanted identifiers through than the best plan.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __CAN_FILTER_H__
+#define __CAN_FILTER_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @addtogroup Library Library
+  @{
+*/
+
+/** @addtogroup CAN_BUS_Library CAN Bus Library
+  @{
+*/
+
+/** @addtogroup CAN_FILTER_EXPORTED_CONSTANTS CAN Filter Exported Constants
+  @{
+*/
+
+#define CAN_FILTER_STD_ID       0           /*!< 11-bit identifier. Same as CAN_STD_ID */
+#define CAN_FILTER_EXT_ID       1           /*!< 29-bit identifier. Same as CAN_EXT_ID */
+
+#define CAN_FILTER_MAX_BLOCKS   128         /*!< Wanted identifier blocks of a plan */
+#define CAN_FILTER_EXACT_BLOCKS 10          /*!< Most blocks for which CanFilter_Plan() finds the best plan */
+
+#define CAN_FILTER_OK           ( 0L)
+#define CAN_FILTER_ERR_PARAM    (-1L)       /*!< Invalid identifier, range or filter number */
+#define CAN_FILTER_ERR_FULL     (-2L)       /*!< More than CAN_FILTER_MAX_BLOCKS blocks */
+
+/*@}*/ /* end of group CAN_FILTER_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup CAN_FILTER_EXPORTED_STRUCTS CAN Filter Exported Structs
+  @{
+*/
+
+typedef struct
+{
+    uint32_t u32IdType;                     /*!< CAN_FILTER_STD_ID or CAN_FILTER_EXT_ID */
+    uint32_t u32Id;                         /*!< Only the bits of u32Mask can be 1 */
+    uint32_t u32Mask;
+    uint32_t u32Wanted;                     /*!< Wanted identifiers it accepts */
+} CAN_FILTER_T;
+
+typedef struct
+{
+    uint32_t u32WantNum;                    /*!< Private */
+    CAN_FILTER_T asWant[CAN_FILTER_MAX_BLOCKS];     /*!< Private. Wanted identifiers as disjoint blocks */
+    uint32_t u32FilterNum;
+    CAN_FILTER_T asFilter[CAN_FILTER_MAX_BLOCKS];   /*!< Result of CanFilter_Plan() */
+    uint32_t u32WantedIds;                  /*!< Wanted identifiers */
+    uint32_t u32AcceptedIds;                /*!< Identifiers accepted by the filters. The difference is let through
+                                                 for nothing. */
+} CAN_FILTER_PLAN_T;
+
+/*@}*/ /* end of group CAN_FILTER_EXPORTED_STRUCTS */
+
+
+/** @addtogroup CAN_FILTER_EXPORTED_FUNCTIONS CAN Filter Exported Functions
+  @{
+*/
+
+void CanFilter_Init(CAN_FILTER_PLAN_T *psPlan);
+int32_t CanFilter_AddRange(CAN_FILTER_PLAN_T *psPlan, uint32_t u32IdType, uint32_t u32First, uint32_t u32Last);
+int32_t CanFilter_AddMask(CAN_FILTER_PLAN_T *psPlan, uint32_t u32IdType, uint32_t u32Id, uint32_t u32Mask);
+int32_t CanFilter_Plan(CAN_FILTER_PLAN_T *psPlan, uint32_t u32MaxFilters);
+int32_t CanFilter_Match(CAN_FILTER_PLAN_T *psPlan, uint32_t u32IdType, uint32_t u32Id);
+uint32_t CanFilter_FalseAcceptPpm(CAN_FILTER_PLAN_T *psPlan);
+
+/*@}*/ /* end of group CAN_FILTER_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group CAN_BUS_Library */
+
+/*@}*/ /* end of group Library */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CAN_FILTER_H__ */
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
@@ -0,0 +1,114 @@
+/**************************************************************************//**
+ * @file     can_stats.h
+ * @version  V1.00
+ * @brief    CAN bus statistics header file
+ *
+ * @note
+ *           Bus load, error frames and per identifier counters of a CAN node. Frames with known contents count
+ *           with their exact length including stuff bits. Frames which the node only counted, like those dropped
+ *           by its filters, count with the average length. Times are ticks of any free running counter.
+ *           The functions have no chip dependency and aren't reentrant.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __CAN_STATS_H__
+#define __CAN_STATS_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @addtogroup Library Library
+  @{
+*/
+
+/** @addtogroup CAN_BUS_Library CAN Bus Library
+  @{
+*/
+
+/** @addtogroup CAN_STATS_EXPORTED_CONSTANTS CAN Statistics Exported Constants
+  @{
+*/
+
+#define CAN_STATS_STD_ID        0           /*!< 11-bit identifier. Same as CAN_STD_ID */
+#define CAN_STATS_EXT_ID        1           /*!< 29-bit identifier. Same as CAN_EXT_ID */
+
+#define CAN_STATS_ERR_BITS      20          /*!< Bus time of an error frame: error flags, delimiter and intermission */
+#define CAN_STATS_FREE          0xFFFFFFFFUL    /*!< u32Id of an unused identifier entry */
+
+/*@}*/ /* end of group CAN_STATS_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup CAN_STATS_EXPORTED_STRUCTS CAN Statistics Exported Structs
+  @{
+*/
+
+typedef struct
+{
+    uint32_t u32IdType;
+    uint32_t u32Id;                         /*!< CAN_STATS_FREE if the entry is unused */
+    uint32_t u32RxCnt;
+    uint32_t u32RxLast;                     /*!< Private. Tick of the last frame */
+    uint32_t u32RxGapMax;                   /*!< Longest ticks between two received frames */
+    uint32_t u32TxCnt;
+    uint32_t u32LatMin;                     /*!< Ticks from the transmit queue to the end of the frame */
+    uint32_t u32LatMax;
+    uint64_t u64LatSum;
+} CAN_STATS_ID_T;
+
+typedef struct
+{
+    uint32_t u32BitRate;
+    uint32_t u32TickHz;
+    uint32_t u32WinTicks;                   /*!< Measurement window */
+    uint32_t u32WinStart;                   /*!< Private */
+    uint32_t u32WinBits;                    /*!< Private. Bits of the frames with known contents */
+    uint32_t u32WinKnown;                   /*!< Private. Frames with known contents */
+    uint32_t u32WinFrames;                  /*!< Private. All frames */
+    uint32_t u32WinErr;                     /*!< Private */
+    uint32_t u32LastFrames;                 /*!< Private. Counter values of the last CanStats_Bus() */
+    uint32_t u32LastErr;                    /*!< Private */
+    uint32_t u32Load;                       /*!< Bus load of the last window in 0.1 % */
+    uint32_t u32ErrRate;                    /*!< Error frames per second in the last window */
+    uint32_t u32Frames;                     /*!< All frames */
+    uint32_t u32ErrFrames;                  /*!< All error frames */
+    CAN_STATS_ID_T *psId;                   /*!< Hash table of identifiers */
+    uint32_t u32IdSize;                     /*!< Power of 2 */
+    uint32_t u32IdNum;
+    uint32_t u32IdDrop;                     /*!< Frames of identifiers which found no free entry */
+} CAN_STATS_T;
+
+/*@}*/ /* end of group CAN_STATS_EXPORTED_STRUCTS */
+
+
+/** @addtogroup CAN_STATS_EXPORTED_FUNCTIONS CAN Statistics Exported Functions
+  @{
+*/
+
+void CanStats_Init(CAN_STATS_T *psStats, uint32_t u32BitRate, uint32_t u32TickHz, uint32_t u32WinTicks,
+                   CAN_STATS_ID_T *psId, uint32_t u32IdSize, uint32_t u32Now);
+uint32_t CanStats_FrameBits(uint32_t u32IdType, uint32_t u32Id, uint32_t u32Remote, uint32_t u32DLC,
+                            const uint8_t *pu8Data);
+void CanStats_Rx(CAN_STATS_T *psStats, uint32_t u32IdType, uint32_t u32Id, uint32_t u32Remote, uint32_t u32DLC,
+                 const uint8_t *pu8Data, uint32_t u32Now);
+void CanStats_Tx(CAN_STATS_T *psStats, uint32_t u32IdType, uint32_t u32Id, uint32_t u32Queued, uint32_t u32Done);
+int32_t CanStats_Bus(CAN_STATS_T *psStats, uint32_t u32BusFrames, uint32_t u32ErrFrames, uint32_t u32Now);
+CAN_STATS_ID_T *CanStats_Find(CAN_STATS_T *psStats, uint32_t u32IdType, uint32_t u32Id);
+
+/*@}*/ /* end of group CAN_STATS_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group CAN_BUS_Library */
+
+/*@}*/ /* end of group Library */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CAN_STATS_H__ */
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
@@ -0,0 +1,501 @@
+/**************************************************************************//**
+ * @file     can_filter.c
+ * @version  V1.00
+ * @brief    CAN acceptance filter planner source file
+ *
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include "can_filter.h"
+
+/** @addtogroup Library Library
+  @{
+*/
+
+/** @addtogroup CAN_BUS_Library CAN Bus Library
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+/* A filter is a block of identifiers: the bits of u32Mask are fixed to those of u32Id, the other bits are free. */
+#define CAN_FILTER_WIDTH(u32IdType)     (((u32IdType) == CAN_FILTER_EXT_ID) ? 29 : 11)
+#define CAN_FILTER_FULL(u32IdType)      (((u32IdType) == CAN_FILTER_EXT_ID) ? 0x1FFFFFFFUL : 0x7FFUL)
+
+/* State of the exhaustive search of CanFilter_Plan() */
+typedef struct
+{
+    CAN_FILTER_T asBlock[CAN_FILTER_EXACT_BLOCKS];  /* Blocks after the joins which add no identifier */
+    uint32_t u32BlockNum;
+    uint32_t u32MaxFilters;
+    CAN_FILTER_T asGroup[CAN_FILTER_EXACT_BLOCKS];  /* Join of each group of blocks so far */
+    CAN_FILTER_T asBest[CAN_FILTER_EXACT_BLOCKS];
+    uint32_t u32BestNum;                            /* 0 until a plan better than the greedy one is found */
+    uint32_t u32BestIds;                            /* Accepted identifiers of the best plan */
+} CAN_FILTER_SEARCH_T;
+
+static uint32_t CanFilter_Ones(uint32_t u32Val)
+{
+    uint32_t u32Cnt;
+
+    for(u32Cnt = 0; u32Val; u32Val &= u32Val - 1)
+        u32Cnt++;
+
+    return u32Cnt;
+}
+
+/* Identifiers of a block */
+static uint32_t CanFilter_Size(const CAN_FILTER_T *psBlock)
+{
+    return 1UL << (CAN_FILTER_WIDTH(psBlock->u32IdType) - CanFilter_Ones(psBlock->u32Mask));
+}
+
+/* Whether two blocks have an identifier in common */
+static int32_t CanFilter_Meet(const CAN_FILTER_T *psA, const CAN_FILTER_T *psB)
+{
+    return (psA->u32IdType == psB->u32IdType) && (((psA->u32Id ^ psB->u32Id) & psA->u32Mask & psB->u32Mask) == 0);
+}
+
+/* Whether block A holds all identifiers of block B */
+static int32_t CanFilter_Covers(const CAN_FILTER_T *psA, const CAN_FILTER_T *psB)
+{
+    return CanFilter_Meet(psA, psB) && ((psA->u32Mask & ~psB->u32Mask) == 0);
+}
+
+/* Smallest block which holds blocks A and B */
+static void CanFilter_Join(const CAN_FILTER_T *psA, const CAN_FILTER_T *psB, CAN_FILTER_T *psJoin)
+{
+    psJoin->u32IdType = psA->u32IdType;
+    psJoin->u32Mask = psA->u32Mask & psB->u32Mask & ~(psA->u32Id ^ psB->u32Id);
+    psJoin->u32Id = psA->u32Id & psJoin->u32Mask;
+    psJoin->u32Wanted = 0;
+}
+
+/* Wanted identifiers in a block. The wanted blocks are disjoint, so their parts just add up. */
+static uint32_t CanFilter_CountWanted(const CAN_FILTER_PLAN_T *psPlan, const CAN_FILTER_T *psBlock)
+{
+    uint32_t i, u32Cnt = 0;
+
+    for(i = 0; i < psPlan->u32WantNum; i++)
+    {
+        if(CanFilter_Meet(&psPlan->asWant[i], psBlock))
+            u32Cnt += 1UL << (CAN_FILTER_WIDTH(psBlock->u32IdType) -
+                              CanFilter_Ones(psPlan->asWant[i].u32Mask | psBlock->u32Mask));
+    }
+
+    return u32Cnt;
+}
+
+/* Add the part of sPiece outside the wanted blocks u32From to u32Num - 1. Each block that meets it cuts it
+   by one free bit at a time: the half outside the block goes on to the next blocks, the other half is
+   narrowed until it lies inside the block. */
+static int32_t CanFilter_AddPiece(CAN_FILTER_PLAN_T *psPlan, CAN_FILTER_T sPiece, uint32_t u32From, uint32_t u32Num)
+{
+    CAN_FILTER_T *psWant;
+    CAN_FILTER_T sPart;
+    uint32_t u32Bits, u32Bit;
+
+    for(; u32From < u32Num; u32From++)
+    {
+        psWant = &psPlan->asWant[u32From];
+
+        if(!CanFilter_Meet(psWant, &sPiece))
+            continue;
+
+        u32Bits = psWant->u32Mask & ~sPiece.u32Mask;
+
+        while(u32Bits)
+        {
+            u32Bit = u32Bits & (~u32Bits + 1);
+            u32Bits &= ~u32Bit;
+
+            sPart = sPiece;
+            sPart.u32Mask |= u32Bit;
+            sPart.u32Id |= ~psWant->u32Id & u32Bit;
+
+            if(CanFilter_AddPiece(psPlan, sPart, u32From + 1, u32Num) < 0)
+                return CAN_FILTER_ERR_FULL;
+
+            sPiece.u32Mask |= u32Bit;
+            sPiece.u32Id |= psWant->u32Id & u32Bit;
+        }
+
+        return CAN_FILTER_OK;
+    }
+
+    if(psPlan->u32WantNum >= CAN_FILTER_MAX_BLOCKS)
+        return CAN_FILTER_ERR_FULL;
+
+    sPiece.u32Wanted = CanFilter_Size(&sPiece);
+    psPlan->asWant[psPlan->u32WantNum++] = sPiece;
+
+    return CAN_FILTER_OK;
+}
+
+/* Identifiers of sPiece which none of the u32Num filters accepts. It splits sPiece like CanFilter_AddPiece(). */
+static uint32_t CanFilter_NewIds(const CAN_FILTER_T *psFilter, uint32_t u32Num, CAN_FILTER_T sPiece)
+{
+    CAN_FILTER_T sPart;
+    uint32_t i, u32Bits, u32Bit, u32Cnt = 0;
+
+    for(i = 0; i < u32Num; i++)
+    {
+        if(!CanFilter_Meet(&psFilter[i], &sPiece))
+            continue;
+
+        u32Bits = psFilter[i].u32Mask & ~sPiece.u32Mask;
+
+        while(u32Bits)
+        {
+            u32Bit = u32Bits & (~u32Bits + 1);
+            u32Bits &= ~u32Bit;
+
+            sPart = sPiece;
+            sPart.u32Mask |= u32Bit;
+            sPart.u32Id |= ~psFilter[i].u32Id & u32Bit;
+            u32Cnt += CanFilter_NewIds(&psFilter[i + 1], u32Num - i - 1, sPart);
+
+            sPiece.u32Mask |= u32Bit;
+            sPiece.u32Id |= psFilter[i].u32Id & u32Bit;
+        }
+
+        return u32Cnt;
+    }
+
+    return CanFilter_Size(&sPiece);
+}
+
+/* Identifiers which any of the u32Num filters accepts */
+static uint32_t CanFilter_Accepted(const CAN_FILTER_T *psFilter, uint32_t u32Num)
+{
+    uint32_t i, u32Cnt = 0;
+
+    for(i = 0; i < u32Num; i++)
+        u32Cnt += CanFilter_NewIds(psFilter, i, psFilter[i]);
+
+    return u32Cnt;
+}
+
+/* Put the blocks from u32Block on in each group of the same type or in a new group, and keep the grouping which
+   accepts the fewest identifiers. A join only grows as blocks are added, so a partial grouping which already
+   accepts as many identifiers as the best one is dropped. New groups are opened in order, so each grouping is
+   visited once. */
+static void CanFilter_Search(CAN_FILTER_SEARCH_T *psSearch, uint32_t u32Block, uint32_t u32Groups)
+{
+    const CAN_FILTER_T *psBlock = &psSearch->asBlock[u32Block];
+    CAN_FILTER_T sSave;
+    uint32_t u32Ids, i;
+
+    u32Ids = CanFilter_Accepted(psSearch->asGroup, u32Groups);
+
+    if(u32Ids >= psSearch->u32BestIds)
+        return;
+
+    if(u32Block == psSearch->u32BlockNum)
+    {
+        for(i = 0; i < u32Groups; i++)
+            psSearch->asBest[i] = psSearch->asGroup[i];
+
+        psSearch->u32BestNum = u32Groups;
+        psSearch->u32BestIds = u32Ids;
+        return;
+    }
+
+    for(i = 0; i < u32Groups; i++)
+    {
+        if(psSearch->asGroup[i].u32IdType != psBlock->u32IdType)
+            continue;
+
+        sSave = psSearch->asGroup[i];
+        CanFilter_Join(&sSave, psBlock, &psSearch->asGroup[i]);
+        CanFilter_Search(psSearch, u32Block + 1, u32Groups);
+        psSearch->asGroup[i] = sSave;
+    }
+
+    if(u32Groups < psSearch->u32MaxFilters)
+    {
+        psSearch->asGroup[u32Groups] = *psBlock;
+        CanFilter_Search(psSearch, u32Block + 1, u32Groups + 1);
+    }
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+/**
+  * @brief      Start a plan
+  * @param[in]  psPlan      Plan. It is about 4 KB, so it is better static than on the stack.
+  * @return     None
+  */
+void CanFilter_Init(CAN_FILTER_PLAN_T *psPlan)
+{
+    psPlan->u32WantNum = 0;
+    psPlan->u32FilterNum = 0;
+    psPlan->u32WantedIds = 0;
+    psPlan->u32AcceptedIds = 0;
+}
+
+/**
+  * @brief      Add wanted identifiers of a mask
+  * @param[in]  psPlan      Plan.
+  * @param[in]  u32IdType   CAN_FILTER_STD_ID or CAN_FILTER_EXT_ID.
+  * @param[in]  u32Id       Identifier.
+  * @param[in]  u32Mask     Compared bits of u32Id. Identifiers which only differ in the other bits are wanted too.
+  * @return     CAN_FILTER_OK, CAN_FILTER_ERR_PARAM or CAN_FILTER_ERR_FULL.
+  * @details    Identifiers which were added before are skipped, so the wanted set is kept as disjoint blocks.
+  */
+int32_t CanFilter_AddMask(CAN_FILTER_PLAN_T *psPlan, uint32_t u32IdType, uint32_t u32Id, uint32_t u32Mask)
+{
+    CAN_FILTER_T sBlock;
+
+    if((u32IdType > CAN_FILTER_EXT_ID) || (u32Id > CAN_FILTER_FULL(u32IdType)))
+        return CAN_FILTER_ERR_PARAM;
+
+    sBlock.u32IdType = u32IdType;
+    sBlock.u32Mask = u32Mask & CAN_FILTER_FULL(u32IdType);
+    sBlock.u32Id = u32Id & sBlock.u32Mask;
+    sBlock.u32Wanted = 0;
+
+    return CanFilter_AddPiece(psPlan, sBlock, 0, psPlan->u32WantNum);
+}
+
+/**
+  * @brief      Add a range of wanted identifiers
+  * @param[in]  psPlan      Plan.
+  * @param[in]  u32IdType   CAN_FILTER_STD_ID or CAN_FILTER_EXT_ID.
+  * @param[in]  u32First    First identifier.
+  * @param[in]  u32Last     Last identifier.
+  * @return     CAN_FILTER_OK, CAN_FILTER_ERR_PARAM or CAN_FILTER_ERR_FULL.
+  * @details    The range is split into the largest aligned blocks, at most 2 for each identifier bit.
+  */
+int32_t CanFilter_AddRange(CAN_FILTER_PLAN_T *psPlan, uint32_t u32IdType, uint32_t u32First, uint32_t u32Last)
+{
+    uint32_t u32Full, u32Size;
+    int32_t i32Ret;
+
+    if(u32IdType > CAN_FILTER_EXT_ID)
+        return CAN_FILTER_ERR_PARAM;
+
+    u32Full = CAN_FILTER_FULL(u32IdType);
+
+    if((u32First > u32Last) || (u32Last > u32Full))
+        return CAN_FILTER_ERR_PARAM;
+
+    while(1)
+    {
+        /* Largest block which starts at u32First and ends by u32Last */
+        for(u32Size = 1; u32Size <= u32Full; u32Size <<= 1)
+        {
+            if((u32First & ((u32Size << 1) - 1)) || ((u32Size << 1) - 1 > u32Last - u32First))
+                break;
+        }
+
+        if((i32Ret = CanFilter_AddMask(psPlan, u32IdType, u32First, u32Full & ~(u32Size - 1))) < 0)
+            return i32Ret;
+
+        if(u32Last - u32First == u32Size - 1)
+            return CAN_FILTER_OK;
+
+        u32First += u32Size;
+    }
+}
+
+/**
+  * @brief      Plan the filters
+  * @param[in]  psPlan          Plan with the wanted identifiers.
+  * @param[in]  u32MaxFilters   Message objects for the filters.
+  * @return     Number of filters in psPlan->asFilter, or CAN_FILTER_ERR_PARAM if u32MaxFilters is 0 or less than
+  *             the identifier types which are wanted.
+  * @details    Blocks which differ in one compared bit are joined first, which adds no identifier. While there
+  *             are more filters than u32MaxFilters, the two filters whose join adds the fewest unwanted identifiers
+  *             are joined. Filters inside the joined one are dropped. This greedy plan isn't always the best one.
+  *             If at most CAN_FILTER_EXACT_BLOCKS blocks are left after the first joins, every grouping of the
+  *             blocks into u32MaxFilters filters is searched, bounded by the greedy plan, and the grouping which
+  *             accepts the fewest identifiers is taken. Then u32WantedIds and u32AcceptedIds are counted.
+  *             The greedy time grows with the cube of the wanted blocks, so it is meant for start-up.
+  */
+int32_t CanFilter_Plan(CAN_FILTER_PLAN_T *psPlan, uint32_t u32MaxFilters)
+{
+    CAN_FILTER_T *psFilter = psPlan->asFilter;
+    CAN_FILTER_T sJoin, sBest;
+    CAN_FILTER_SEARCH_T sSearch;
+    uint32_t i, j, k, n, u32Diff, u32Joined, u32Cost, u32Freed, u32Covered;
+    uint32_t u32BestCost = 0, u32BestCovered = 0, u32BestI = 0, u32Found;
+
+    if(u32MaxFilters == 0)
+        return CAN_FILTER_ERR_PARAM;
+
+    n = psPlan->u32WantNum;
+
+    for(i = 0; i < n; i++)
+        psFilter[i] = psPlan->asWant[i];
+
+    /* Exact joins */
+    do
+    {
+        u32Joined = 0;
+
+        for(i = 0; i < n; i++)
+        {
+            for(j = i + 1; j < n;)
+            {
+                u32Diff = psFilter[i].u32Id ^ psFilter[j].u32Id;
+
+                if((psFilter[i].u32IdType == psFilter[j].u32IdType) && (psFilter[i].u32Mask == psFilter[j].u32Mask) &&
+                        u32Diff && ((u32Diff & (u32Diff - 1)) == 0))
+                {
+                    psFilter[i].u32Mask &= ~u32Diff;
+                    psFilter[i].u32Id &= psFilter[i].u32Mask;
+                    psFilter[i].u32Wanted += psFilter[j].u32Wanted;
+                    psFilter[j] = psFilter[--n];
+                    u32Joined = 1;
+                }
+                else
+                {
+                    j++;
+                }
+            }
+        }
+    }
+    while(u32Joined);
+
+    sSearch.u32BlockNum = 0;
+
+    if((n > u32MaxFilters) && (n <= CAN_FILTER_EXACT_BLOCKS))
+    {
+        for(i = 0; i < n; i++)
+            sSearch.asBlock[i] = psFilter[i];
+
+        sSearch.u32BlockNum = n;
+        sSearch.u32MaxFilters = u32MaxFilters;
+    }
+
+    /* Joins which let unwanted identifiers through */
+    while(n > u32MaxFilters)
+    {
+        u32Found = 0;
+
+        for(i = 0; i < n; i++)
+        {
+            for(j = i + 1; j < n; j++)
+            {
+                if(psFilter[i].u32IdType != psFilter[j].u32IdType)
+                    continue;
+
+                CanFilter_Join(&psFilter[i], &psFilter[j], &sJoin);
+                sJoin.u32Wanted = CanFilter_CountWanted(psPlan, &sJoin);
+
+                /* Unwanted identifiers of the join minus those of the filters it replaces */
+                u32Freed = 0;
+                u32Covered = 0;
+
+                for(k = 0; k < n; k++)
+                {
+                    if(CanFilter_Covers(&sJoin, &psFilter[k]))
+                    {
+                        u32Freed += CanFilter_Size(&psFilter[k]) - psFilter[k].u32Wanted;
+                        u32Covered++;
+                    }
+                }
+
+                u32Cost = CanFilter_Size(&sJoin) - sJoin.u32Wanted;
+                u32Cost = (u32Cost > u32Freed) ? u32Cost - u32Freed : 0;
+
+                if(!u32Found || (u32Cost < u32BestCost) || ((u32Cost == u32BestCost) && (u32Covered > u32BestCovered)))
+                {
+                    u32Found = 1;
+                    u32BestCost = u32Cost;
+                    u32BestCovered = u32Covered;
+                    u32BestI = i;
+                    sBest = sJoin;
+                }
+            }
+        }
+
+        if(!u32Found)
+            return CAN_FILTER_ERR_PARAM;
+
+        psFilter[u32BestI] = sBest;
+
+        for(k = n; k-- > 0;)
+        {
+            if((k != u32BestI) && CanFilter_Covers(&sBest, &psFilter[k]))
+            {
+                psFilter[k] = psFilter[--n];
+
+                if(u32BestI == n)
+                    u32BestI = k;
+            }
+        }
+    }
+
+    /* Best grouping of few blocks */
+    if(sSearch.u32BlockNum)
+    {
+        sSearch.u32BestNum = 0;
+        sSearch.u32BestIds = CanFilter_Accepted(psFilter, n);
+        CanFilter_Search(&sSearch, 0, 0);
+
+        if(sSearch.u32BestNum)
+        {
+            for(i = 0; i < sSearch.u32BestNum; i++)
+            {
+                psFilter[i] = sSearch.asBest[i];
+                psFilter[i].u32Wanted = CanFilter_CountWanted(psPlan, &psFilter[i]);
+            }
+
+            n = sSearch.u32BestNum;
+        }
+    }
+
+    psPlan->u32FilterNum = n;
+    psPlan->u32WantedIds = 0;
+
+    for(i = 0; i < psPlan->u32WantNum; i++)
+        psPlan->u32WantedIds += psPlan->asWant[i].u32Wanted;
+
+    psPlan->u32AcceptedIds = CanFilter_Accepted(psFilter, n);
+
+    return (int32_t)n;
+}
+
+/**
+  * @brief      Check an identifier against the planned filters
+  * @param[in]  psPlan      Plan.
+  * @param[in]  u32IdType   CAN_FILTER_STD_ID or CAN_FILTER_EXT_ID.
+  * @param[in]  u32Id       Identifier.
+  * @return     1 if a filter accepts it, else 0.
+  * @details    Weighting the identifiers of a bus by their frame rates gives the real false accept rate.
+  */
+int32_t CanFilter_Match(CAN_FILTER_PLAN_T *psPlan, uint32_t u32IdType, uint32_t u32Id)
+{
+    uint32_t i;
+
+    for(i = 0; i < psPlan->u32FilterNum; i++)
+    {
+        if((psPlan->asFilter[i].u32IdType == u32IdType) &&
+                (((u32Id ^ psPlan->asFilter[i].u32Id) & psPlan->asFilter[i].u32Mask) == 0))
+            return 1;
+    }
+
+    return 0;
+}
+
+/**
+  * @brief      False accept rate of the planned filters
+  * @param[in]  psPlan      Plan.
+  * @return     Unwanted share of the accepted frames in ppm, if all identifiers are sent equally often.
+  */
+uint32_t CanFilter_FalseAcceptPpm(CAN_FILTER_PLAN_T *psPlan)
+{
+    if(psPlan->u32AcceptedIds == 0)
+        return 0;
+
+    return (uint32_t)((uint64_t)(psPlan->u32AcceptedIds - psPlan->u32WantedIds) * 1000000 / psPlan->u32AcceptedIds);
+}
+
+/*@}*/ /* end of group CAN_BUS_Library */
+
+/*@}*/ /* end of group Library */
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
@@ -0,0 +1,339 @@
+/**************************************************************************//**
+ * @file     can_stats.c
+ * @version  V1.00
+ * @brief    CAN bus statistics source file
+ *
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stddef.h>
+#include "can_stats.h"
+
+/** @addtogroup Library Library
+  @{
+*/
+
+/** @addtogroup CAN_BUS_Library CAN Bus Library
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#define CAN_STATS_DEF_BITS  119     /* Standard data frame of 8 bytes with average stuffing, until a length is known */
+#define CAN_STATS_TAIL_BITS 13      /* CRC delimiter, ACK slot and delimiter, end of frame and intermission */
+
+/* Bit stream from the start of frame to the end of the CRC, where stuff bits are inserted */
+typedef struct
+{
+    uint32_t u32Crc;
+    uint32_t u32Last;
+    uint32_t u32Run;
+    uint32_t u32Bits;
+} CAN_STATS_STREAM_T;
+
+/* Send the u32Num lower bits of u32Val, MSB first. u32Crc is 1 if they are covered by the CRC. */
+static void CanStats_Put(CAN_STATS_STREAM_T *psStream, uint32_t u32Val, uint32_t u32Num, uint32_t u32Crc)
+{
+    uint32_t u32Bit, u32Feedback;
+
+    while(u32Num--)
+    {
+        u32Bit = (u32Val >> u32Num) & 1;
+
+        if(u32Crc)
+        {
+            /* CRC-15, x^15 + x^14 + x^10 + x^8 + x^7 + x^4 + x^3 + 1 */
+            u32Feedback = u32Bit ^ (psStream->u32Crc >> 14);
+            psStream->u32Crc = (psStream->u32Crc << 1) & 0x7FFF;
+
+            if(u32Feedback)
+                psStream->u32Crc ^= 0x4599;
+        }
+
+        psStream->u32Bits++;
+
+        if(u32Bit == psStream->u32Last)
+        {
+            /* A stuff bit of the other level follows 5 equal bits and starts the next run */
+            if(++psStream->u32Run == 5)
+            {
+                psStream->u32Bits++;
+                psStream->u32Last = !u32Bit;
+                psStream->u32Run = 1;
+            }
+        }
+        else
+        {
+            psStream->u32Last = u32Bit;
+            psStream->u32Run = 1;
+        }
+    }
+}
+
+/* Entry of an identifier. A free entry is taken for a new one, NULL if there is none. */
+static CAN_STATS_ID_T *CanStats_Entry(CAN_STATS_T *psStats, uint32_t u32IdType, uint32_t u32Id, uint32_t u32Add)
+{
+    CAN_STATS_ID_T *psEntry;
+    uint32_t u32Idx, i;
+
+    if(psStats->u32IdSize == 0)
+        return NULL;
+
+    u32Idx = ((u32Id ^ (u32IdType << 29)) * 0x9E3779B1UL) >> 16;
+
+    for(i = 0; i < psStats->u32IdSize; i++, u32Idx++)
+    {
+        psEntry = &psStats->psId[u32Idx & (psStats->u32IdSize - 1)];
+
+        if((psEntry->u32Id == u32Id) && (psEntry->u32IdType == u32IdType))
+            return psEntry;
+
+        if(psEntry->u32Id == CAN_STATS_FREE)
+        {
+            if(!u32Add)
+                return NULL;
+
+            psEntry->u32IdType = u32IdType;
+            psEntry->u32Id = u32Id;
+            psStats->u32IdNum++;
+            return psEntry;
+        }
+    }
+
+    return NULL;
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+/**
+  * @brief      Start the statistics
+  * @param[in]  psStats     Statistics.
+  * @param[in]  u32BitRate  Bus bit rate.
+  * @param[in]  u32TickHz   Frequency of the ticks.
+  * @param[in]  u32WinTicks Ticks of a bus load window.
+  * @param[in]  psId        Identifier entries. It can be NULL if u32IdSize is 0.
+  * @param[in]  u32IdSize   Entries of psId, a power of 2. Keep it about twice the identifiers seen.
+  * @param[in]  u32Now      Current tick.
+  * @return     None
+  */
+void CanStats_Init(CAN_STATS_T *psStats, uint32_t u32BitRate, uint32_t u32TickHz, uint32_t u32WinTicks,
+                   CAN_STATS_ID_T *psId, uint32_t u32IdSize, uint32_t u32Now)
+{
+    uint32_t i;
+
+    psStats->u32BitRate = u32BitRate;
+    psStats->u32TickHz = u32TickHz;
+    psStats->u32WinTicks = u32WinTicks;
+    psStats->u32WinStart = u32Now;
+    psStats->u32WinBits = 0;
+    psStats->u32WinKnown = 0;
+    psStats->u32WinFrames = 0;
+    psStats->u32WinErr = 0;
+    psStats->u32LastFrames = 0;
+    psStats->u32LastErr = 0;
+    psStats->u32Load = 0;
+    psStats->u32ErrRate = 0;
+    psStats->u32Frames = 0;
+    psStats->u32ErrFrames = 0;
+    psStats->psId = psId;
+    psStats->u32IdSize = u32IdSize;
+    psStats->u32IdNum = 0;
+    psStats->u32IdDrop = 0;
+
+    for(i = 0; i < u32IdSize; i++)
+    {
+        psId[i].u32IdType = 0;
+        psId[i].u32Id = CAN_STATS_FREE;
+        psId[i].u32RxCnt = 0;
+        psId[i].u32RxLast = 0;
+        psId[i].u32RxGapMax = 0;
+        psId[i].u32TxCnt = 0;
+        psId[i].u32LatMin = 0;
+        psId[i].u32LatMax = 0;
+        psId[i].u64LatSum = 0;
+    }
+}
+
+/**
+  * @brief      Bus time of a frame
+  * @param[in]  u32IdType   CAN_STATS_STD_ID or CAN_STATS_EXT_ID.
+  * @param[in]  u32Id       Identifier.
+  * @param[in]  u32Remote   1 for a remote frame.
+  * @param[in]  u32DLC      Data length code. A data frame has 8 bytes if it is over 8.
+  * @param[in]  pu8Data     Data bytes. It isn't used for a remote frame.
+  * @return     Bits from the start of frame to the end of the intermission, stuff bits included.
+  */
+uint32_t CanStats_FrameBits(uint32_t u32IdType, uint32_t u32Id, uint32_t u32Remote, uint32_t u32DLC,
+                            const uint8_t *pu8Data)
+{
+    CAN_STATS_STREAM_T sStream;
+    uint32_t i;
+
+    sStream.u32Crc = 0;
+    sStream.u32Last = 2;
+    sStream.u32Run = 0;
+    sStream.u32Bits = 0;
+
+    u32Remote = u32Remote ? 1 : 0;
+    u32DLC &= 0xF;
+
+    /* Start of frame */
+    CanStats_Put(&sStream, 0, 1, 1);
+
+    if(u32IdType == CAN_STATS_EXT_ID)
+    {
+        /* Base identifier, SRR, IDE, identifier extension, RTR, r1 and r0 */
+        CanStats_Put(&sStream, u32Id >> 18, 11, 1);
+        CanStats_Put(&sStream, 3, 2, 1);
+        CanStats_Put(&sStream, u32Id & 0x3FFFF, 18, 1);
+        CanStats_Put(&sStream, u32Remote << 2, 3, 1);
+    }
+    else
+    {
+        /* Identifier, RTR, IDE and r0 */
+        CanStats_Put(&sStream, u32Id, 11, 1);
+        CanStats_Put(&sStream, u32Remote << 2, 3, 1);
+    }
+
+    CanStats_Put(&sStream, u32DLC, 4, 1);
+
+    if(!u32Remote)
+    {
+        for(i = 0; i < ((u32DLC > 8) ? 8 : u32DLC); i++)
+            CanStats_Put(&sStream, pu8Data[i], 8, 1);
+    }
+
+    CanStats_Put(&sStream, sStream.u32Crc, 15, 0);
+
+    return sStream.u32Bits + CAN_STATS_TAIL_BITS;
+}
+
+/**
+  * @brief      Count a received frame
+  * @param[in]  psStats     Statistics.
+  * @param[in]  u32IdType   CAN_STATS_STD_ID or CAN_STATS_EXT_ID.
+  * @param[in]  u32Id       Identifier.
+  * @param[in]  u32Remote   1 for a remote frame.
+  * @param[in]  u32DLC      Data length code.
+  * @param[in]  pu8Data     Data bytes.
+  * @param[in]  u32Now      Tick of the reception.
+  * @return     None
+  * @details    The frame also counts in the bus frames given to CanStats_Bus(). Here its length becomes known.
+  */
+void CanStats_Rx(CAN_STATS_T *psStats, uint32_t u32IdType, uint32_t u32Id, uint32_t u32Remote, uint32_t u32DLC,
+                 const uint8_t *pu8Data, uint32_t u32Now)
+{
+    CAN_STATS_ID_T *psEntry;
+
+    psStats->u32WinBits += CanStats_FrameBits(u32IdType, u32Id, u32Remote, u32DLC, pu8Data);
+    psStats->u32WinKnown++;
+
+    if((psEntry = CanStats_Entry(psStats, u32IdType, u32Id, 1)) == NULL)
+    {
+        psStats->u32IdDrop++;
+        return;
+    }
+
+    if(psEntry->u32RxCnt && (u32Now - psEntry->u32RxLast > psEntry->u32RxGapMax))
+        psEntry->u32RxGapMax = u32Now - psEntry->u32RxLast;
+
+    psEntry->u32RxLast = u32Now;
+    psEntry->u32RxCnt++;
+}
+
+/**
+  * @brief      Count a sent frame
+  * @param[in]  psStats     Statistics.
+  * @param[in]  u32IdType   CAN_STATS_STD_ID or CAN_STATS_EXT_ID.
+  * @param[in]  u32Id       Identifier.
+  * @param[in]  u32Queued   Tick when the frame was queued.
+  * @param[in]  u32Done     Tick when its transmission ended.
+  * @return     None
+  * @details    Only the latency is counted. The frame counts in the bus load through CanStats_Bus().
+  */
+void CanStats_Tx(CAN_STATS_T *psStats, uint32_t u32IdType, uint32_t u32Id, uint32_t u32Queued, uint32_t u32Done)
+{
+    CAN_STATS_ID_T *psEntry;
+    uint32_t u32Lat = u32Done - u32Queued;
+
+    if((psEntry = CanStats_Entry(psStats, u32IdType, u32Id, 1)) == NULL)
+    {
+        psStats->u32IdDrop++;
+        return;
+    }
+
+    if((psEntry->u32TxCnt == 0) || (u32Lat < psEntry->u32LatMin))
+        psEntry->u32LatMin = u32Lat;
+
+    if(u32Lat > psEntry->u32LatMax)
+        psEntry->u32LatMax = u32Lat;
+
+    psEntry->u64LatSum += u32Lat;
+    psEntry->u32TxCnt++;
+}
+
+/**
+  * @brief      Count the bus frames and errors, and end the window when it is over
+  * @param[in]  psStats         Statistics.
+  * @param[in]  u32BusFrames    Running count of all frames on the bus, like CAN_QUEUE_T.u32BusFrames.
+  * @param[in]  u32ErrFrames    Running count of error frames, like CAN_QUEUE_T.u32ErrFrames.
+  * @param[in]  u32Now          Current tick.
+  * @return     1 if u32Load and u32ErrRate are new, else 0.
+  * @details    Call it often, at least once per window. Frames which were counted but not received,
+  *             like the frames of the node itself or those dropped by its filters, count with the average length
+  *             of the received frames of the window. An error counts with CAN_STATS_ERR_BITS and half a frame.
+  */
+int32_t CanStats_Bus(CAN_STATS_T *psStats, uint32_t u32BusFrames, uint32_t u32ErrFrames, uint32_t u32Now)
+{
+    uint32_t u32Ticks, u32Avg;
+    uint64_t u64Bits;
+
+    psStats->u32WinFrames += u32BusFrames - psStats->u32LastFrames;
+    psStats->u32Frames += u32BusFrames - psStats->u32LastFrames;
+    psStats->u32WinErr += u32ErrFrames - psStats->u32LastErr;
+    psStats->u32ErrFrames += u32ErrFrames - psStats->u32LastErr;
+    psStats->u32LastFrames = u32BusFrames;
+    psStats->u32LastErr = u32ErrFrames;
+
+    u32Ticks = u32Now - psStats->u32WinStart;
+
+    if((u32Ticks < psStats->u32WinTicks) || (u32Ticks == 0))
+        return 0;
+
+    u32Avg = psStats->u32WinKnown ? psStats->u32WinBits / psStats->u32WinKnown : CAN_STATS_DEF_BITS;
+    /* An error breaks off a frame, on average in its middle */
+    u64Bits = (uint64_t)psStats->u32WinBits + (uint64_t)psStats->u32WinErr * (CAN_STATS_ERR_BITS + u32Avg / 2);
+
+    if(psStats->u32WinFrames > psStats->u32WinKnown)
+        u64Bits += (uint64_t)(psStats->u32WinFrames - psStats->u32WinKnown) * u32Avg;
+
+    psStats->u32Load = (uint32_t)(u64Bits * psStats->u32TickHz / u32Ticks * 1000 / psStats->u32BitRate);
+    psStats->u32ErrRate = (uint32_t)((uint64_t)psStats->u32WinErr * psStats->u32TickHz / u32Ticks);
+
+    psStats->u32WinStart = u32Now;
+    psStats->u32WinBits = 0;
+    psStats->u32WinKnown = 0;
+    psStats->u32WinFrames = 0;
+    psStats->u32WinErr = 0;
+
+    return 1;
+}
+
+/**
+  * @brief      Find the counters of an identifier
+  * @param[in]  psStats     Statistics.
+  * @param[in]  u32IdType   CAN_STATS_STD_ID or CAN_STATS_EXT_ID.
+  * @param[in]  u32Id       Identifier.
+  * @return     The counters, or NULL if no frame of it was counted.
+  */
+CAN_STATS_ID_T *CanStats_Find(CAN_STATS_T *psStats, uint32_t u32IdType, uint32_t u32Id)
+{
+    return CanStats_Entry(psStats, u32IdType, u32Id, 0);
+}
+
+/*@}*/ /* end of group CAN_BUS_Library */
+
+/*@}*/ /* end of group Library */
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
@@ -17219,6 +17219,7 @@ typedef struct
 #include "usbd.h"
 #include "fmc.h"
 #include "uart.h"
+#include "dlog.h"
 #include "pwm.h"
 #include "pdma.h"
 #include "tk.h"
@@ -0,0 +1,95 @@
+/**************************************************************************//**
+ * @file     i2c_eeprom.h
+ * @version  V1.00
+ * @brief    I2C EEPROM library header file
+ *
+ * @note
+ *           The library runs on the I2C message queue of i2c.h. It fits the 24Cxx family: 1 address byte up to
+ *           2 KB, 2 address bytes above, and the high address bits in the slave address.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __I2C_EEPROM_H__
+#define __I2C_EEPROM_H__
+
+#include "M451Series.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @addtogroup Library Library
+  @{
+*/
+
+/** @addtogroup I2C_EEPROM_Library I2C EEPROM Library
+  @{
+*/
+
+/** @addtogroup I2C_EEPROM_EXPORTED_CONSTANTS I2C EEPROM Exported Constants
+  @{
+*/
+
+#define I2C_EEPROM_MAX_PAGE         256     /*!< Largest page size */
+#define I2C_EEPROM_MAX_POLLS        2000    /*!< ACK polls of one write cycle before time-out */
+
+/* Return values */
+#define I2C_EEPROM_OK               0
+#define I2C_EEPROM_ERR_PARAM        -1      /*!< Address or length is out of the device */
+#define I2C_EEPROM_ERR_DEVICE       -2      /*!< The device doesn't answer, or the bus failed */
+#define I2C_EEPROM_ERR_TIMEOUT      -3      /*!< The write cycle didn't end in I2C_EEPROM_MAX_POLLS polls */
+
+/*@}*/ /* end of group I2C_EEPROM_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup I2C_EEPROM_EXPORTED_STRUCTS I2C EEPROM Exported Structs
+  @{
+*/
+
+/**
+  * @details  An EEPROM device. The counters show how a write went and can be cleared by the caller.
+  */
+typedef struct
+{
+    I2C_QUEUE_T *psQueue;
+    uint8_t u8Addr;                 /*!< 7-bit slave address with the block bits 0 */
+    uint8_t u8AddrLen;              /*!< Memory address bytes, 1 or 2 */
+    uint8_t u8Busy;                 /*!< Private. A write cycle may be running */
+    uint32_t u32Size;               /*!< Bytes */
+    uint32_t u32PageSize;           /*!< Bytes, a power of 2 */
+    uint32_t u32PageCnt;            /*!< Pages written */
+    uint32_t u32SkipCnt;            /*!< Pages skipped because they didn't change */
+    uint32_t u32PollCnt;            /*!< ACK polls which the device didn't acknowledge */
+    uint8_t au8Addr[2];             /*!< Private */
+    uint8_t au8Page[2 + I2C_EEPROM_MAX_PAGE];   /*!< Private. Address and data of a page write */
+    I2C_QMSG_T asMsg[2];            /*!< Private */
+    I2C_QXFER_T sXfer;              /*!< Private */
+} I2C_EEPROM_T;
+
+/*@}*/ /* end of group I2C_EEPROM_EXPORTED_STRUCTS */
+
+
+/** @addtogroup I2C_EEPROM_EXPORTED_FUNCTIONS I2C EEPROM Exported Functions
+  @{
+*/
+
+int32_t I2cEeprom_Open(I2C_EEPROM_T *psDev, I2C_QUEUE_T *psQueue, uint8_t u8Addr, uint32_t u32Size, uint32_t u32PageSize);
+int32_t I2cEeprom_WaitReady(I2C_EEPROM_T *psDev);
+int32_t I2cEeprom_Read(I2C_EEPROM_T *psDev, uint32_t u32Addr, uint8_t *pu8Buf, uint32_t u32Len);
+int32_t I2cEeprom_Write(I2C_EEPROM_T *psDev, uint32_t u32Addr, const uint8_t *pu8Data, uint32_t u32Len);
+
+/*@}*/ /* end of group I2C_EEPROM_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group I2C_EEPROM_Library */
+
+/*@}*/ /* end of group Library */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__I2C_EEPROM_H__
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
@@ -0,0 +1,248 @@
+/**************************************************************************//**
+ * @file     i2c_eeprom.c
+ * @version  V1.00
+ * @brief    I2C EEPROM library source file
+ *
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <string.h>
+#include "i2c_eeprom.h"
+
+/** @addtogroup Library Library
+  @{
+*/
+
+/** @addtogroup I2C_EEPROM_Library I2C EEPROM Library
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+/* Longest sequential read of one transaction */
+#define I2C_EEPROM_READ_CHUNK   0x8000
+
+/* Slave address of a memory address. The bits above the address bytes select a block. */
+static uint8_t I2cEeprom_Slave(I2C_EEPROM_T *psDev, uint32_t u32Addr)
+{
+    return (uint8_t)(psDev->u8Addr | ((u32Addr >> (psDev->u8AddrLen * 8)) & 0x7));
+}
+
+/* Run the messages of psDev->asMsg as one transaction */
+static int32_t I2cEeprom_Transfer(I2C_EEPROM_T *psDev, uint32_t u32MsgNum)
+{
+    psDev->sXfer.psMsg = psDev->asMsg;
+    psDev->sXfer.u32MsgNum = u32MsgNum;
+    psDev->sXfer.pfnDone = NULL;
+
+    return I2C_QueueTransfer(psDev->psQueue, &psDev->sXfer);
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup I2C_EEPROM_EXPORTED_FUNCTIONS I2C EEPROM Exported Functions
+  @{
+*/
+
+/**
+  * @brief      Open an EEPROM
+  * @param[out] psDev       Device state in SRAM.
+  * @param[in]  psQueue     Queue of the I2C port opened by I2C_QueueOpen().
+  * @param[in]  u8Addr      7-bit slave address, like 0x50.
+  * @param[in]  u32Size     Bytes of the device.
+  * @param[in]  u32PageSize Bytes of a write page, a power of 2 up to I2C_EEPROM_MAX_PAGE.
+  * @retval     I2C_EEPROM_OK           The device answers.
+  * @retval     I2C_EEPROM_ERR_PARAM    The size or the page size is invalid.
+  * @retval     I2C_EEPROM_ERR_TIMEOUT  No device answers.
+  * @details    Devices up to 2 KB take 1 address byte. A write cycle left by an earlier reset is waited for.
+  */
+int32_t I2cEeprom_Open(I2C_EEPROM_T *psDev, I2C_QUEUE_T *psQueue, uint8_t u8Addr, uint32_t u32Size, uint32_t u32PageSize)
+{
+    if((u32PageSize == 0) || (u32PageSize > I2C_EEPROM_MAX_PAGE) || (u32PageSize & (u32PageSize - 1)) ||
+            (u32Size < u32PageSize) || (u32Size > 0x80000))
+        return I2C_EEPROM_ERR_PARAM;
+
+    psDev->psQueue = psQueue;
+    psDev->u8Addr = u8Addr;
+    psDev->u8AddrLen = (u32Size <= 2048) ? 1 : 2;
+    psDev->u32Size = u32Size;
+    psDev->u32PageSize = u32PageSize;
+    psDev->u32PageCnt = 0;
+    psDev->u32SkipCnt = 0;
+    psDev->u32PollCnt = 0;
+    psDev->u8Busy = 1;
+
+    return I2cEeprom_WaitReady(psDev);
+}
+
+/**
+  * @brief      Wait for the write cycle of the last page
+  * @param[in]  psDev       Device.
+  * @retval     I2C_EEPROM_OK           The device is ready.
+  * @retval     I2C_EEPROM_ERR_DEVICE   The bus failed.
+  * @retval     I2C_EEPROM_ERR_TIMEOUT  The device didn't answer in I2C_EEPROM_MAX_POLLS polls.
+  * @details    The device doesn't acknowledge its address during a write cycle, so its address alone is sent
+  *             until it does. The next access starts as soon as the cycle ends instead of after the worst case
+  *             write time. Reads and writes call it first.
+  */
+int32_t I2cEeprom_WaitReady(I2C_EEPROM_T *psDev)
+{
+    int32_t i32Status;
+    uint32_t i;
+
+    if(!psDev->u8Busy)
+        return I2C_EEPROM_OK;
+
+    psDev->asMsg[0].u8Addr = psDev->u8Addr;
+    psDev->asMsg[0].u8Flags = I2C_QMSG_WR;
+    psDev->asMsg[0].u16Len = 0;
+    psDev->asMsg[0].pu8Buf = NULL;
+
+    for(i = 0; i < I2C_EEPROM_MAX_POLLS; i++)
+    {
+        i32Status = I2cEeprom_Transfer(psDev, 1);
+
+        if(i32Status == I2C_QXFER_DONE)
+        {
+            psDev->u8Busy = 0;
+            return I2C_EEPROM_OK;
+        }
+
+        if(i32Status != I2C_QXFER_NACK)
+            return I2C_EEPROM_ERR_DEVICE;
+
+        psDev->u32PollCnt++;
+    }
+
+    return I2C_EEPROM_ERR_TIMEOUT;
+}
+
+/**
+  * @brief      Read from an EEPROM
+  * @param[in]  psDev       Device.
+  * @param[in]  u32Addr     Memory address.
+  * @param[out] pu8Buf      Buffer of the data.
+  * @param[in]  u32Len      Bytes.
+  * @return     I2C_EEPROM_OK or I2C_EEPROM_ERR_XXX.
+  * @details    One sequential read gets up to 32 KB of a block, so the address is sent once per block instead
+  *             of once per byte.
+  */
+int32_t I2cEeprom_Read(I2C_EEPROM_T *psDev, uint32_t u32Addr, uint8_t *pu8Buf, uint32_t u32Len)
+{
+    uint32_t u32Block = 1UL << (psDev->u8AddrLen * 8), u32Chunk;
+    int32_t i32Ret;
+
+    if((u32Addr > psDev->u32Size) || (u32Len > psDev->u32Size - u32Addr))
+        return I2C_EEPROM_ERR_PARAM;
+
+    i32Ret = I2cEeprom_WaitReady(psDev);
+
+    if(i32Ret < 0)
+        return i32Ret;
+
+    while(u32Len)
+    {
+        u32Chunk = u32Block - (u32Addr & (u32Block - 1));
+
+        if(u32Chunk > I2C_EEPROM_READ_CHUNK)
+            u32Chunk = I2C_EEPROM_READ_CHUNK;
+
+        if(u32Chunk > u32Len)
+            u32Chunk = u32Len;
+
+        /* Address write, repeated START and read */
+        psDev->au8Addr[0] = (uint8_t)(u32Addr >> 8);
+        psDev->au8Addr[1] = (uint8_t)u32Addr;
+        psDev->asMsg[0].u8Addr = I2cEeprom_Slave(psDev, u32Addr);
+        psDev->asMsg[0].u8Flags = I2C_QMSG_WR;
+        psDev->asMsg[0].u16Len = psDev->u8AddrLen;
+        psDev->asMsg[0].pu8Buf = &psDev->au8Addr[2 - psDev->u8AddrLen];
+        psDev->asMsg[1].u8Addr = psDev->asMsg[0].u8Addr;
+        psDev->asMsg[1].u8Flags = I2C_QMSG_RD;
+        psDev->asMsg[1].u16Len = (uint16_t)u32Chunk;
+        psDev->asMsg[1].pu8Buf = pu8Buf;
+
+        if(I2cEeprom_Transfer(psDev, 2) != I2C_QXFER_DONE)
+            return I2C_EEPROM_ERR_DEVICE;
+
+        u32Addr += u32Chunk;
+        pu8Buf += u32Chunk;
+        u32Len -= u32Chunk;
+    }
+
+    return I2C_EEPROM_OK;
+}
+
+/**
+  * @brief      Write to an EEPROM
+  * @param[in]  psDev       Device.
+  * @param[in]  u32Addr     Memory address. It needn't be aligned.
+  * @param[in]  pu8Data     Data.
+  * @param[in]  u32Len      Bytes.
+  * @return     I2C_EEPROM_OK or I2C_EEPROM_ERR_XXX.
+  * @details    The data are split at the page boundaries. Each page is read first and written only if it
+  *             changes, which saves its write cycle and its wear. The write cycle of the last page isn't waited
+  *             for here, so the caller can go on until the next access.
+  */
+int32_t I2cEeprom_Write(I2C_EEPROM_T *psDev, uint32_t u32Addr, const uint8_t *pu8Data, uint32_t u32Len)
+{
+    uint8_t *pu8Page = &psDev->au8Page[2];
+    uint32_t u32Chunk;
+    int32_t i32Ret;
+
+    if((u32Addr > psDev->u32Size) || (u32Len > psDev->u32Size - u32Addr))
+        return I2C_EEPROM_ERR_PARAM;
+
+    while(u32Len)
+    {
+        u32Chunk = psDev->u32PageSize - (u32Addr & (psDev->u32PageSize - 1));
+
+        if(u32Chunk > u32Len)
+            u32Chunk = u32Len;
+
+        /* The read waits for the write cycle of the previous page */
+        i32Ret = I2cEeprom_Read(psDev, u32Addr, pu8Page, u32Chunk);
+
+        if(i32Ret < 0)
+            return i32Ret;
+
+        if(memcmp(pu8Page, pu8Data, u32Chunk) == 0)
+        {
+            psDev->u32SkipCnt++;
+        }
+        else
+        {
+            /* Address bytes and data in one message */
+            psDev->au8Page[0] = (uint8_t)(u32Addr >> 8);
+            psDev->au8Page[1] = (uint8_t)u32Addr;
+            memcpy(pu8Page, pu8Data, u32Chunk);
+
+            psDev->asMsg[0].u8Addr = I2cEeprom_Slave(psDev, u32Addr);
+            psDev->asMsg[0].u8Flags = I2C_QMSG_WR;
+            psDev->asMsg[0].u16Len = (uint16_t)(psDev->u8AddrLen + u32Chunk);
+            psDev->asMsg[0].pu8Buf = &psDev->au8Page[2 - psDev->u8AddrLen];
+
+            if(I2cEeprom_Transfer(psDev, 1) != I2C_QXFER_DONE)
+                return I2C_EEPROM_ERR_DEVICE;
+
+            psDev->u8Busy = 1;
+            psDev->u32PageCnt++;
+        }
+
+        u32Addr += u32Chunk;
+        pu8Data += u32Chunk;
+        u32Len -= u32Chunk;
+    }
+
+    return I2C_EEPROM_OK;
+}
+
+/*@}*/ /* end of group I2C_EEPROM_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group I2C_EEPROM_Library */
+
+/*@}*/ /* end of group Library */
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
@@ -0,0 +1,346 @@
+/**************************************************************************//**
+ * @file     isp_lib.h
+ * @version  V1.00
+ * @brief    M451 series ISP protocol engine and flash back end header file
+ *
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __ISP_LIB_H__
+#define __ISP_LIB_H__
+
+#include "M451Series.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @addtogroup Library Library
+  @{
+*/
+
+/** @addtogroup ISP_Library ISP Library
+  @{
+*/
+
+/** @addtogroup ISP_EXPORTED_CONSTANTS ISP Exported Constants
+  @{
+*/
+
+#define ISP_FW_VERSION          0x35    /*!< Firmware version reported by CMD_GET_FWVER */
+
+#define ISP_LEGACY_PKT_SIZE     64      /*!< Packet size before CMD_NEGOTIATE. Also the response size */
+#define ISP_MAX_PKT_SIZE        512     /*!< Maximum packet size which CMD_NEGOTIATE can select */
+#define ISP_PKT_BUF_NUM         4       /*!< Receive packet buffers of a transport. Must be power of 2 */
+#ifndef ISP_CRC_PDMA_CH
+#define ISP_CRC_PDMA_CH         9       /*!< PDMA channel of the packet CRC, reserved by ISP_Open(). Not for transports */
+#endif
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Optional commands. The LZ and delta updates are off by default, so every loader fits the 4 KB LDROM.  */
+/*  A loader turns one on by defining it to 1 in its project (Keil: Options for Target -> C/C++ -> Define) */
+/*  and the IROM1 size of 0x1000 in its target makes armlink report an overflow. A command that is turned  */
+/*  off fails like a broken stream, so the host falls back to CMD_UPDATE_APROM. An option that is turned   */
+/*  off is never granted by CMD_NEGOTIATE, so the host keeps the 16-bit byte sum.                          */
+/*---------------------------------------------------------------------------------------------------------*/
+#ifndef ISP_USE_LZ
+#define ISP_USE_LZ              0       /*!< CMD_UPDATE_APROM_LZ */
+#endif
+#ifndef ISP_USE_DELTA
+#define ISP_USE_DELTA           0       /*!< CMD_UPDATE_APROM_DELTA */
+#endif
+#ifndef ISP_USE_CRC32
+#define ISP_USE_CRC32           1       /*!< ISP_OPT_CRC32 and its cycle report. CMD_GET_CRC32 stays */
+#endif
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  ISP commands                                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+#define CMD_UPDATE_APROM        0x000000A0
+#define CMD_UPDATE_CONFIG       0x000000A1
+#define CMD_READ_CONFIG         0x000000A2
+#define CMD_ERASE_ALL           0x000000A3
+#define CMD_SYNC_PACKNO         0x000000A4
+#define CMD_GET_FWVER           0x000000A6
+#define CMD_RUN_APROM           0x000000AB
+#define CMD_RUN_LDROM           0x000000AC
+#define CMD_RESET               0x000000AD
+#define CMD_CONNECT             0x000000AE
+#define CMD_GET_DEVICEID        0x000000B1
+#define CMD_UPDATE_DATAFLASH    0x000000C3
+#define CMD_NEGOTIATE           0x000000D0
+#define CMD_UPDATE_APROM_LZ     0x000000D1
+#define CMD_UPDATE_APROM_DELTA  0x000000D2
+#define CMD_GET_CRC32           0x000000D3
+#define CMD_RESEND_PACKET       0x000000FF
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  CMD_NEGOTIATE                                                                                          */
+/*    Request  : [cmd][packno][packet size][window][options]                                               */
+/*    Response : [checksum][packno][accepted packet size][accepted window][accepted options]               */
+/*  After the response, the host sends packets of the accepted size and may keep up to "window" packets    */
+/*  in flight. Responses stay ISP_LEGACY_PKT_SIZE bytes and come back in packet order. The host must wait  */
+/*  for all responses before CMD_RESEND_PACKET. CMD_CONNECT of ISP_LEGACY_PKT_SIZE bytes returns to the    */
+/*  legacy 64-byte stop-and-wait protocol, so old host tools keep working.                                 */
+/*  Firmware before version 0x34 answers CMD_NEGOTIATE with CONFIG0 and CONFIG1, so a host must fall       */
+/*  back to legacy mode if the accepted packet size isn't between 64 and the requested size.               */
+/*  Firmware before version 0x35 doesn't return options. The host must check the version before it asks    */
+/*  for an option.                                                                                         */
+/*---------------------------------------------------------------------------------------------------------*/
+#define ISP_OPT_CRC32           0x00000001UL    /*!< Packet check is CRC-32 instead of the 16-bit byte sum */
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  ISP_OPT_CRC32                                                                                          */
+/*  The first word of every response is the CRC-32 of the whole received packet in place of the 16-bit     */
+/*  byte sum, starting with the response of CMD_NEGOTIATE. The CRC is IEEE 802.3 like                      */
+/*  CMD_UPDATE_APROM_DELTA and is computed by the CRC controller fed by PDMA. Like the byte sum, it covers */
+/*  the data read back after programming. Two more words report the cost of the packet in CPU cycles:      */
+/*    Response[56] : cycles to compute the packet CRC                                                      */
+/*    Response[60] : cycles of ISP_ParseCmd() for the packet, programming included                         */
+/*  The cycles are 0 if the core has no cycle counter. CMD_CONNECT returns to the byte sum.                */
+/*---------------------------------------------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  CMD_GET_CRC32                                                                                          */
+/*    Request  : [cmd][packno][start address][size]                                                        */
+/*    Response : [checksum][packno][CRC-32 or 0xFFFFFFFF on error]                                         */
+/*  Reads back an updated image for the final check. The range must be word aligned and inside APROM or    */
+/*  Data Flash. The CRC is the same as the image CRC of CMD_UPDATE_APROM_DELTA.                            */
+/*---------------------------------------------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  CMD_UPDATE_APROM_LZ                                                                                    */
+/*    First packet : [cmd][packno][0][image size][compressed stream]                                       */
+/*    Next packets : [0][packno][compressed stream]                                                        */
+/*    Response     : [checksum][packno][decoded bytes or 0xFFFFFFFF on error][byte sum of programmed data] */
+/*  The stream is an LZ4 block of the APROM image, created by SampleCode/ISP/LinuxTool/isp_lzpack. The     */
+/*  response checksum covers the received packet, and the host compares the byte sum of the last response  */
+/*  with its image. CMD_RESEND_PACKET fails the update, so the host restarts it.                           */
+/*---------------------------------------------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  CMD_UPDATE_APROM_DELTA                                                                                 */
+/*    First packet : [cmd][packno][base size][base CRC][image size][image CRC][delta records]              */
+/*    Next packets : [0][packno][delta records]                                                            */
+/*    Response     : [checksum][packno][built bytes or 0xFFFFFFFF on error][byte sum of programmed data]   */
+/*  The records are created by SampleCode/ISP/LinuxTool/isp_mkdelta. CRC-32 is IEEE 802.3 over the image   */
+/*  padded with 0xFF to word boundary. Nothing is programmed unless the base CRC matches APROM, and the    */
+/*  last response reports an error if the image CRC doesn't match after programming. On a base mismatch    */
+/*  the first response returns the CRC of APROM in place of the byte sum. CMD_RESEND_PACKET fails the      */
+/*  update like CMD_UPDATE_APROM_LZ. Only the loaders on ISP_ParseCmd() have the command, and only when    */
+/*  ISP_USE_DELTA is 1. ISP_CAN and ISP_DFU have their own protocols and no delta update.                  */
+/*---------------------------------------------------------------------------------------------------------*/
+
+/* ISP_DELTA_T record types */
+#define ISP_DELTA_SAME          0       /*!< Keep base image bytes */
+#define ISP_DELTA_COPY          1       /*!< Copy base image bytes from another address */
+#define ISP_DELTA_DATA          2       /*!< New bytes */
+
+/* ISP_DELTA_T decoder states */
+#define ISP_DELTA_STATE_TYPE    0
+#define ISP_DELTA_STATE_LEN     1
+#define ISP_DELTA_STATE_SRC     2
+#define ISP_DELTA_STATE_COPY    3
+#define ISP_DELTA_STATE_DATA    4
+#define ISP_DELTA_STATE_DONE    5
+#define ISP_DELTA_STATE_ERROR   6
+
+/* ISP_LZ_T decoder states */
+#define ISP_LZ_STATE_TOKEN      0
+#define ISP_LZ_STATE_LITLEN     1
+#define ISP_LZ_STATE_LITERAL    2
+#define ISP_LZ_STATE_OFFSET0    3
+#define ISP_LZ_STATE_OFFSET1    4
+#define ISP_LZ_STATE_MATLEN     5
+#define ISP_LZ_STATE_DONE       6
+#define ISP_LZ_STATE_ERROR      7
+
+#define V6M_AIRCR_VECTKEY_DATA  0x05FA0000UL
+#define V6M_AIRCR_SYSRESETREQ   0x00000004UL
+
+/*@}*/ /* end of group ISP_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup ISP_EXPORTED_STRUCTS ISP Exported Structs
+  @{
+*/
+
+/**
+  * @details  Packet transport of the ISP engine. A packet returned by pfnRecv() is parsed in place, so
+  *           the transport must not touch it until pfnRelease() is called. pfnSend() is NULL if the host
+  *           fetches the response from g_au32IspResponse by itself (I2C and SPI slave).
+  *           pfnSetPktSize() is NULL if the transport only supports ISP_LEGACY_PKT_SIZE packets.
+  */
+typedef struct
+{
+    uint8_t *(*pfnRecv)(uint32_t *pu32Len);             /*!< Return next received packet and its size. NULL if none */
+    void (*pfnRelease)(void);                           /*!< Packet returned by pfnRecv() is parsed */
+    void (*pfnSend)(uint8_t *pu8Buf, uint32_t u32Len);  /*!< Send response of the parsed packet */
+    void (*pfnSetPktSize)(uint32_t u32PktSize);         /*!< Receive packets of new size from now on */
+    uint32_t u32MaxPktSize;                             /*!< Maximum packet size, ISP_LEGACY_PKT_SIZE ~ ISP_MAX_PKT_SIZE */
+    uint32_t u32MaxWindow;                              /*!< Maximum packets in flight, 1 ~ ISP_PKT_BUF_NUM */
+} ISP_TRANSPORT_T;
+
+/**
+  * @details  Receive packet buffers shared by a transport interrupt handler and the ISP engine.
+  *           The handler fills ISP_PktRxBuf() and commits it by ISP_PktRxDone(). When all buffers
+  *           wait for the engine, received data goes to a spare buffer and the packet is dropped.
+  */
+typedef struct
+{
+    uint32_t au32Buf[ISP_PKT_BUF_NUM + 1][ISP_MAX_PKT_SIZE / 4];
+    uint32_t au32Len[ISP_PKT_BUF_NUM];
+    volatile uint32_t u32Head;      /*!< Count of packets received */
+    volatile uint32_t u32Tail;      /*!< Count of packets released */
+} ISP_PKT_QUEUE_T;
+
+/**
+  * @details  Decoder state of a compressed image. See ISP_LzDecode().
+  */
+typedef struct
+{
+    uint32_t u32State;      /*!< ISP_LZ_STATE_XXX */
+    uint32_t u32Token;      /*!< Token of current sequence */
+    uint32_t u32Len;        /*!< Literal or match length left */
+    uint32_t u32Offset;     /*!< Match offset */
+    uint32_t u32Addr;       /*!< Flash address of the page buffer */
+    uint32_t u32Pos;        /*!< Decoded bytes in the page buffer */
+    uint32_t u32Done;       /*!< Decoded bytes */
+    uint32_t u32Remain;     /*!< Bytes left to decode */
+    uint32_t u32Sum;        /*!< Byte sum of programmed data read back */
+    uint32_t *pu32Page;     /*!< Page buffer */
+} ISP_LZ_T;
+
+/**
+  * @details  Decoder state of a delta image. See ISP_DeltaDecode().
+  */
+typedef struct
+{
+    uint32_t u32State;      /*!< ISP_DELTA_STATE_XXX */
+    uint32_t u32Type;       /*!< Type of current record */
+    uint32_t u32Len;        /*!< Bytes left of current record */
+    uint32_t u32Src;        /*!< Base image address to copy from */
+    uint32_t u32Shift;      /*!< Bit position of next byte of a record field */
+    uint32_t u32Base;       /*!< Flash address of the image */
+    uint32_t u32Crc;        /*!< CRC-32 of the new image */
+    uint32_t u32CacheAddr;  /*!< Address of last flash word read */
+    uint32_t u32CacheData;  /*!< Last flash word read */
+    ISP_LZ_T sOut;          /*!< Page buffer state. Only the output fields are used. */
+} ISP_DELTA_T;
+
+/*@}*/ /* end of group ISP_EXPORTED_STRUCTS */
+
+
+/** @addtogroup ISP_EXPORTED_FUNCTIONS ISP Exported Functions
+  @{
+*/
+
+extern uint32_t g_au32IspResponse[ISP_LEGACY_PKT_SIZE / 4];
+extern uint32_t g_u32IspApromSize, g_u32IspDataFlashAddr, g_u32IspDataFlashSize;
+
+/**
+  * @brief      Get the buffer to receive next packet
+  * @param[in]  psQ     Packet queue of the transport
+  * @return     Buffer of ISP_MAX_PKT_SIZE bytes. The same buffer is returned until ISP_PktRxDone().
+  */
+__STATIC_INLINE uint8_t *ISP_PktRxBuf(ISP_PKT_QUEUE_T *psQ)
+{
+    if((psQ->u32Head - psQ->u32Tail) >= ISP_PKT_BUF_NUM)
+        return (uint8_t *)psQ->au32Buf[ISP_PKT_BUF_NUM];
+
+    return (uint8_t *)psQ->au32Buf[psQ->u32Head & (ISP_PKT_BUF_NUM - 1)];
+}
+
+/**
+  * @brief      Commit the buffer of ISP_PktRxBuf() as a received packet
+  * @param[in]  psQ     Packet queue of the transport
+  * @param[in]  u32Len  Packet size
+  * @return     None
+  */
+__STATIC_INLINE void ISP_PktRxDone(ISP_PKT_QUEUE_T *psQ, uint32_t u32Len)
+{
+    if((psQ->u32Head - psQ->u32Tail) < ISP_PKT_BUF_NUM)
+    {
+        psQ->au32Len[psQ->u32Head & (ISP_PKT_BUF_NUM - 1)] = u32Len;
+        psQ->u32Head++;
+    }
+}
+
+/**
+  * @brief      Check if all packet buffers wait for the ISP engine
+  * @param[in]  psQ     Packet queue of the transport
+  * @retval     0   A buffer is free
+  * @retval     1   Next packet would be dropped
+  */
+__STATIC_INLINE uint32_t ISP_PktIsFull(ISP_PKT_QUEUE_T *psQ)
+{
+    return ((psQ->u32Head - psQ->u32Tail) >= ISP_PKT_BUF_NUM);
+}
+
+/**
+  * @brief      Get the oldest received packet
+  * @param[in]  psQ     Packet queue of the transport
+  * @param[out] pu32Len Packet size
+  * @return     Packet buffer. NULL if no packet is received.
+  */
+__STATIC_INLINE uint8_t *ISP_PktGet(ISP_PKT_QUEUE_T *psQ, uint32_t *pu32Len)
+{
+    if(psQ->u32Head == psQ->u32Tail)
+        return NULL;
+
+    *pu32Len = psQ->au32Len[psQ->u32Tail & (ISP_PKT_BUF_NUM - 1)];
+    return (uint8_t *)psQ->au32Buf[psQ->u32Tail & (ISP_PKT_BUF_NUM - 1)];
+}
+
+/**
+  * @brief      Give the packet of ISP_PktGet() back to the transport
+  * @param[in]  psQ     Packet queue of the transport
+  * @return     None
+  */
+__STATIC_INLINE void ISP_PktFree(ISP_PKT_QUEUE_T *psQ)
+{
+    if(psQ->u32Head != psQ->u32Tail)
+        psQ->u32Tail++;
+}
+
+/* ISP protocol engine (isp_core.c) */
+int32_t ISP_Open(const ISP_TRANSPORT_T *psTransport);
+uint32_t ISP_Poll(void);
+void ISP_ParseCmd(uint8_t *pu8Buf, uint32_t u32Len);
+
+/* Flash back end (isp_flash.c) */
+int32_t ISP_FlashOpen(void);
+int32_t ISP_FlashRead(uint32_t u32Start, uint32_t u32End, uint32_t *pu32Data);
+int32_t ISP_FlashErase(uint32_t u32Start, uint32_t u32Size);
+int32_t ISP_FlashUpdate(uint32_t u32Start, uint32_t u32End, uint32_t *pu32Data, uint32_t *pu32PageBuf);
+int32_t ISP_FlashAppend(uint32_t u32Addr, uint8_t *pu8Data, uint32_t u32Len, uint32_t u32Last, uint32_t *pu32PageBuf);
+void ISP_FlashEraseUsed(uint32_t u32Start, uint32_t u32End);
+void ISP_UpdateConfig(uint32_t *pu32Data, uint32_t *pu32Res);
+uint32_t ISP_FlashCrc32(uint32_t u32Start, uint32_t u32End);
+uint32_t ISP_GetApromSize(void);
+void ISP_GetDataFlashInfo(uint32_t *pu32Addr, uint32_t *pu32Size);
+
+/* Compressed image decoder (isp_lz.c) */
+void ISP_LzOpen(ISP_LZ_T *psLz, uint32_t u32Addr, uint32_t u32Len, uint32_t *pu32Page);
+int32_t ISP_LzDecode(ISP_LZ_T *psLz, uint8_t *pu8Src, uint32_t u32Len);
+int32_t ISP_LzPut(ISP_LZ_T *psLz, uint8_t u8Data);
+
+/* Delta image decoder (isp_delta.c) */
+void ISP_DeltaOpen(ISP_DELTA_T *psDelta, uint32_t u32Addr, uint32_t u32Len, uint32_t u32Crc, uint32_t *pu32Page);
+int32_t ISP_DeltaDecode(ISP_DELTA_T *psDelta, uint8_t *pu8Src, uint32_t u32Len);
+
+/*@}*/ /* end of group ISP_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group ISP_Library */
+
+/*@}*/ /* end of group Library */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __ISP_LIB_H__ */
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
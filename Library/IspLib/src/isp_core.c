@@ -0,0 +1,504 @@
+/**************************************************************************//**
+ * @file     isp_core.c
+ * @version  V1.00
+ * @brief    M451 series ISP protocol engine source file
+ *
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "isp_lib.h"
+
+/** @addtogroup Library Library
+  @{
+*/
+
+/** @addtogroup ISP_Library ISP Library
+  @{
+*/
+
+uint32_t g_au32IspResponse[ISP_LEGACY_PKT_SIZE / 4];   /*!< Response of the last parsed packet */
+
+static const ISP_TRANSPORT_T *s_psTransport;
+static uint32_t s_u32Connected;
+static uint32_t s_u32PktSize;       /* Packet size of the transport */
+static uint32_t s_u32NewPktSize;    /* Packet size selected by the last CMD_NEGOTIATE or CMD_CONNECT */
+static uint32_t s_au32PageBuf[FMC_FLASH_PAGE_SIZE / 4];    /* Keeps the head of a page while it is erased */
+static uint32_t s_u32UpdateApromCmd;
+#if ISP_USE_LZ
+static ISP_LZ_T s_sLz;              /* Decoder of CMD_UPDATE_APROM_LZ. Decodes into s_au32PageBuf. */
+#endif
+#if ISP_USE_DELTA
+static ISP_DELTA_T s_sDelta;        /* Decoder of CMD_UPDATE_APROM_DELTA. Builds pages in s_au32PageBuf. */
+#endif
+static uint32_t s_u32Options;       /* ISP_OPT_xxx accepted by the last CMD_NEGOTIATE */
+#if ISP_USE_CRC32
+static uint32_t s_u32CrcChReserved; /* ISP_CRC_PDMA_CH is reserved. ISP_OPT_CRC32 is granted only then. */
+
+/* Weak reference like spi.c, so the loaders don't link pdma.c. Nothing else can reserve channels there. */
+__WEAK int32_t PDMA_ReserveChannels(uint32_t u32Mask);
+#endif
+
+/** @addtogroup ISP_EXPORTED_FUNCTIONS ISP Exported Functions
+  @{
+*/
+
+static uint16_t ISP_Checksum(uint8_t *pu8Buf, uint32_t u32Len)
+{
+    uint32_t i;
+    uint16_t u16Sum;
+
+    for(u16Sum = 0, i = 0; i < u32Len; i++)
+        u16Sum += pu8Buf[i];
+
+    return u16Sum;
+}
+
+#if ISP_USE_CRC32
+/* CRC-32 of a packet. PDMA writes the words to the CRC controller while the CPU waits. */
+static uint32_t ISP_PktCrc32(uint8_t *pu8Buf, uint32_t u32Len)
+{
+    volatile uint32_t *pu32ReqSel = &PDMA->REQSEL0_3 + (ISP_CRC_PDMA_CH / 4);
+    uint32_t u32Words = u32Len / 4, u32Pos = (ISP_CRC_PDMA_CH % 4) * 8;
+
+    CLK->AHBCLK |= (CLK_AHBCLK_CRCCKEN_Msk | CLK_AHBCLK_PDMACKEN_Msk);
+    CRC->SEED = 0xFFFFFFFF;
+    CRC->CTL = CRC_32 | CRC_WDATA_RVS | CRC_CHECKSUM_RVS | CRC_CHECKSUM_COM | CRC_CPU_WDATA_32 | CRC_CTL_CRCEN_Msk;
+    CRC->CTL |= CRC_CTL_CRCRST_Msk;
+
+    if(u32Words)
+    {
+        *pu32ReqSel = (*pu32ReqSel & ~(0x1FUL << u32Pos)) | (PDMA_MEM << u32Pos);
+        PDMA->DSCT[ISP_CRC_PDMA_CH].SA = (uint32_t)pu8Buf;
+        PDMA->DSCT[ISP_CRC_PDMA_CH].DA = (uint32_t)&CRC->DAT;
+        PDMA->DSCT[ISP_CRC_PDMA_CH].CTL = ((u32Words - 1) << PDMA_DSCT_CTL_TXCNT_Pos) | PDMA_WIDTH_32 |
+                                          PDMA_SAR_INC | PDMA_DAR_FIX | PDMA_REQ_BURST | PDMA_BURST_128 |
+                                          PDMA_DSCT_CTL_TBINTDIS_Msk | PDMA_OP_BASIC;
+        PDMA->TDSTS = (1 << ISP_CRC_PDMA_CH);
+        PDMA->CHCTL |= (1 << ISP_CRC_PDMA_CH);
+        PDMA->SWREQ = (1 << ISP_CRC_PDMA_CH);
+
+        while((PDMA->TDSTS & (1 << ISP_CRC_PDMA_CH)) == 0);
+
+        PDMA->TDSTS = (1 << ISP_CRC_PDMA_CH);
+    }
+
+    /* Bytes after the last word. Packets of the ISP protocol are word aligned. */
+    if(u32Len % 4)
+    {
+        CRC->CTL &= ~CRC_CTL_DATLEN_Msk;
+
+        for(u32Words *= 4; u32Words < u32Len; u32Words++)
+            CRC->DAT = pu8Buf[u32Words];
+    }
+
+    return CRC->CHECKSUM;
+}
+#endif
+
+/**
+  * @brief      Open ISP engine on a packet transport
+  * @param[in]  psTransport     Packet transport. The transport interface must be initialized.
+  * @retval     0   Success
+  * @retval     -1  APROM size is unknown
+  * @details    Register write-protection must be disabled before calling this function. ISP_CRC_PDMA_CH is
+  *             reserved with PDMA_ReserveChannels() when pdma.c is linked. If another driver holds it,
+  *             CMD_NEGOTIATE doesn't grant ISP_OPT_CRC32 and the host keeps the byte sum.
+  */
+int32_t ISP_Open(const ISP_TRANSPORT_T *psTransport)
+{
+    s_psTransport = psTransport;
+    s_u32Connected = 0;
+    s_u32PktSize = ISP_LEGACY_PKT_SIZE;
+    s_u32NewPktSize = ISP_LEGACY_PKT_SIZE;
+    s_u32UpdateApromCmd = 0;
+    s_u32Options = 0;
+
+#if ISP_USE_CRC32
+    if(!s_u32CrcChReserved)
+        s_u32CrcChReserved = (!PDMA_ReserveChannels || (PDMA_ReserveChannels(1 << ISP_CRC_PDMA_CH) == 0));
+#endif
+
+    return ISP_FlashOpen();
+}
+
+/**
+  * @brief      Parse a received packet and send the response
+  * @param      None
+  * @return     Command of the parsed packet. 0 if no packet is parsed.
+  * @details    Packets before CMD_CONNECT are dropped without response, so noise on the interface can't
+  *             start a command. The transport keeps receiving into its other packet buffers while the
+  *             packet is programmed, so the host may stream a window of packets after CMD_NEGOTIATE.
+  */
+uint32_t ISP_Poll(void)
+{
+    uint8_t *pu8Pkt;
+    uint32_t u32Cmd, u32Len;
+
+    pu8Pkt = s_psTransport->pfnRecv(&u32Len);
+
+    if(pu8Pkt == NULL)
+        return 0;
+
+    u32Cmd = inpw(pu8Pkt);
+
+    if((u32Cmd == CMD_CONNECT) || s_u32Connected)
+    {
+        s_u32Connected = 1;
+        ISP_ParseCmd(pu8Pkt, u32Len);
+
+        if(s_psTransport->pfnSend)
+            s_psTransport->pfnSend((uint8_t *)g_au32IspResponse, ISP_LEGACY_PKT_SIZE);
+
+        /* Switch packet size after the response is out in the old format */
+        if((s_u32NewPktSize != s_u32PktSize) && s_psTransport->pfnSetPktSize)
+        {
+            s_u32PktSize = s_u32NewPktSize;
+            s_psTransport->pfnSetPktSize(s_u32PktSize);
+        }
+    }
+    else
+    {
+        u32Cmd = 0;
+    }
+
+    s_psTransport->pfnRelease();
+
+    return u32Cmd;
+}
+
+/**
+  * @brief      Parse an ISP command packet
+  * @param[in]  pu8Buf  Packet. It is parsed in place. Its data is cleared if its page fails to program.
+  * @param[in]  u32Len  Packet size
+  * @return     None
+  * @details    The response is built in g_au32IspResponse.
+  */
+void ISP_ParseCmd(uint8_t *pu8Buf, uint32_t u32Len)
+{
+    static uint32_t u32StartAddr, u32TotalLen, u32LastDataLen, u32PackNo = 1, u32Cmd, u32PageFail;
+    uint8_t *pu8Response, *pu8Src;
+    uint32_t u32LCmd, u32SrcLen, u32Reg, u32Config0, u32Security;
+#if ISP_USE_CRC32
+    uint32_t u32Cycles = DWT->CYCCNT;
+#endif
+
+    pu8Response = (uint8_t *)g_au32IspResponse;
+    pu8Src = pu8Buf;
+    u32SrcLen = u32Len;
+    u32LCmd = inpw(pu8Src);
+    outpw(pu8Response + 4, 0);
+    pu8Src += 8;
+    u32SrcLen -= 8;
+    ISP_FlashRead(FMC_CONFIG0_ADDR, FMC_CONFIG0_ADDR + 8, (uint32_t *)(pu8Response + 8)); /* Read config */
+    u32Config0 = *(uint32_t *)(pu8Response + 8);
+    u32Security = u32Config0 & 0x2;
+
+    if(u32LCmd == CMD_SYNC_PACKNO)
+        u32PackNo = inpw(pu8Src);
+
+    if((u32LCmd) && (u32LCmd != CMD_RESEND_PACKET))
+        u32Cmd = u32LCmd;
+
+    if(u32LCmd == CMD_GET_FWVER)
+    {
+        pu8Response[8] = ISP_FW_VERSION;
+    }
+    else if(u32LCmd == CMD_GET_DEVICEID)
+    {
+        outpw(pu8Response + 8, SYS->PDID);
+        goto out;
+    }
+    else if(u32LCmd == CMD_RUN_APROM || u32LCmd == CMD_RUN_LDROM || u32LCmd == CMD_RESET)
+    {
+        outpw(&SYS->RSTSTS, 3); /* Clear bit */
+
+        /* Set BS */
+        if(u32LCmd == CMD_RUN_APROM)
+        {
+            u32Reg = (FMC->ISPCTL & 0xFFFFFFFC);
+        }
+        else if(u32LCmd == CMD_RUN_LDROM)
+        {
+            u32Reg = (FMC->ISPCTL & 0xFFFFFFFC);
+            u32Reg |= 0x00000002;
+        }
+        else
+        {
+            u32Reg = (FMC->ISPCTL & 0xFFFFFFFE); /* ISP disable */
+        }
+
+        FMC->ISPCTL = u32Reg;
+        SCB->AIRCR = (V6M_AIRCR_VECTKEY_DATA | V6M_AIRCR_SYSRESETREQ);
+
+        /* Trap the CPU */
+        while(1);
+    }
+    else if(u32LCmd == CMD_CONNECT)
+    {
+        u32PackNo = 1;
+        s_u32NewPktSize = ISP_LEGACY_PKT_SIZE;
+        s_u32Options = 0;
+        goto out;
+    }
+    else if(u32LCmd == CMD_NEGOTIATE)
+    {
+        uint32_t u32Size = ISP_LEGACY_PKT_SIZE, u32Window = 1, u32Options = 0;
+
+        /* Stay in legacy mode when ISP_ParseCmd() is used without ISP_Poll() */
+        if(s_psTransport && s_psTransport->pfnSetPktSize)
+        {
+            u32Size = inpw(pu8Src) & ~7UL;  /* Keep payload word aligned after the 8 or 16 bytes header */
+            u32Window = inpw(pu8Src + 4);
+
+            if(u32Size > s_psTransport->u32MaxPktSize)
+                u32Size = s_psTransport->u32MaxPktSize;
+
+            if(u32Size < ISP_LEGACY_PKT_SIZE)
+                u32Size = ISP_LEGACY_PKT_SIZE;
+
+            if(u32Window > s_psTransport->u32MaxWindow)
+                u32Window = s_psTransport->u32MaxWindow;
+
+            if(u32Window == 0)
+                u32Window = 1;
+
+#if ISP_USE_CRC32
+            if(s_u32CrcChReserved)
+                u32Options = inpw(pu8Src + 8) & ISP_OPT_CRC32;
+#endif
+        }
+
+#if ISP_USE_CRC32
+        if(u32Options & ISP_OPT_CRC32)
+        {
+            /* Cycle counter for the cost report */
+            CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+            DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+        }
+#endif
+
+        s_u32NewPktSize = u32Size;
+        s_u32Options = u32Options;
+        outpw(pu8Response + 8, u32Size);
+        outpw(pu8Response + 12, u32Window);
+        outpw(pu8Response + 16, u32Options);
+        goto out;
+    }
+    else if(u32LCmd == CMD_GET_CRC32)
+    {
+        u32Reg = inpw(pu8Src);              /* Start address */
+        u32SrcLen = inpw(pu8Src + 4);       /* Size */
+
+        /* A CRC of one word gives the word away. Same lock rule as CMD_UPDATE_CONFIG. */
+        if(((u32Security == 0) && (!s_u32UpdateApromCmd)) || ((u32Reg | u32SrcLen) & 3) ||
+                (u32Reg > g_u32IspApromSize) || (u32SrcLen > g_u32IspApromSize - u32Reg))
+            outpw(pu8Response + 8, 0xFFFFFFFF);
+        else
+            outpw(pu8Response + 8, ISP_FlashCrc32(u32Reg, u32Reg + u32SrcLen));
+
+        goto out;
+    }
+    else if((u32LCmd == CMD_UPDATE_APROM) || (u32LCmd == CMD_ERASE_ALL))
+    {
+        if(u32LCmd == CMD_ERASE_ALL)
+        {
+            ISP_FlashErase(FMC_APROM_BASE, g_u32IspDataFlashAddr); /* Erase APROM */
+            ISP_FlashErase(g_u32IspDataFlashAddr, g_u32IspDataFlashSize);
+            *(uint32_t *)(pu8Response + 8) = u32Config0 | 0x02;
+            ISP_UpdateConfig((uint32_t *)(pu8Response + 8), NULL);
+        }
+
+        s_u32UpdateApromCmd = TRUE;
+    }
+
+    if(u32LCmd == CMD_UPDATE_APROM_LZ)
+    {
+#if ISP_USE_LZ
+        u32TotalLen = inpw(pu8Src + 4);
+        pu8Src += 8;
+        u32SrcLen -= 8;
+
+        if(u32TotalLen > g_u32IspDataFlashAddr)
+            u32TotalLen = g_u32IspDataFlashAddr;
+
+        ISP_FlashEraseUsed(FMC_APROM_BASE + u32TotalLen, g_u32IspDataFlashAddr);
+        ISP_LzOpen(&s_sLz, FMC_APROM_BASE, u32TotalLen, s_au32PageBuf);
+        s_u32UpdateApromCmd = TRUE;
+#else
+        u32Cmd = 0;
+        outpw(pu8Response + 8, 0xFFFFFFFF);
+        goto out;
+#endif
+    }
+    else if(u32LCmd == CMD_UPDATE_APROM_DELTA)
+    {
+#if ISP_USE_DELTA
+        u32TotalLen = inpw(pu8Src + 8);
+        u32Reg = inpw(pu8Src);   /* Base size */
+        s_sDelta.u32State = ISP_DELTA_STATE_ERROR;
+
+        if((u32Reg > g_u32IspDataFlashAddr) || (u32TotalLen > g_u32IspDataFlashAddr))
+        {
+            outpw(pu8Response + 8, 0xFFFFFFFF);
+            goto out;
+        }
+
+        /* Don't touch flash unless APROM holds the base image of the delta */
+        u32Reg = ISP_FlashCrc32(FMC_APROM_BASE, FMC_APROM_BASE + u32Reg);
+
+        if(u32Reg != inpw(pu8Src + 4))
+        {
+            outpw(pu8Response + 8, 0xFFFFFFFF);
+            outpw(pu8Response + 12, u32Reg);
+            goto out;
+        }
+
+        ISP_DeltaOpen(&s_sDelta, FMC_APROM_BASE, u32TotalLen, inpw(pu8Src + 12), s_au32PageBuf);
+        pu8Src += 16;
+        u32SrcLen -= 16;
+        s_u32UpdateApromCmd = TRUE;
+#else
+        u32Cmd = 0;
+        outpw(pu8Response + 8, 0xFFFFFFFF);
+        goto out;
+#endif
+    }
+    else if((u32LCmd == CMD_UPDATE_APROM) || (u32LCmd == CMD_UPDATE_DATAFLASH))
+    {
+        if(u32LCmd == CMD_UPDATE_DATAFLASH)
+        {
+            u32StartAddr = g_u32IspDataFlashAddr;
+
+            if(g_u32IspDataFlashSize == 0)
+                goto out;
+        }
+        else
+        {
+            u32StartAddr = 0;
+        }
+
+        u32TotalLen = inpw(pu8Src + 4);
+        pu8Src += 8;
+        u32SrcLen -= 8;
+        u32PageFail = 0;
+
+        /* Pages are erased only when they change. Clear the old content after the new image. */
+        if(u32LCmd == CMD_UPDATE_DATAFLASH)
+            ISP_FlashEraseUsed(u32StartAddr + u32TotalLen, g_u32IspDataFlashAddr + g_u32IspDataFlashSize);
+        else
+            ISP_FlashEraseUsed(u32StartAddr + u32TotalLen, g_u32IspDataFlashAddr);
+    }
+    else if(u32LCmd == CMD_UPDATE_CONFIG)
+    {
+        if((u32Security == 0) && (!s_u32UpdateApromCmd))  /* Security lock */
+            goto out;
+
+        ISP_UpdateConfig((uint32_t *)(pu8Src), (uint32_t *)(pu8Response + 8));
+        ISP_GetDataFlashInfo(&g_u32IspDataFlashAddr, &g_u32IspDataFlashSize);
+        goto out;
+    }
+    else if(u32LCmd == CMD_RESEND_PACKET)   /* For APROM and Data Flash only */
+    {
+        uint32_t u32PageAddr;
+
+        /* The decoder can't go back. Fail the update and let the host restart it. */
+#if ISP_USE_LZ
+        if(u32Cmd == CMD_UPDATE_APROM_LZ)
+        {
+            s_sLz.u32State = ISP_LZ_STATE_ERROR;
+            goto out;
+        }
+#endif
+
+#if ISP_USE_DELTA
+        if(u32Cmd == CMD_UPDATE_APROM_DELTA)
+        {
+            s_sDelta.u32State = ISP_DELTA_STATE_ERROR;
+            goto out;
+        }
+#endif
+
+        u32PageAddr = u32StartAddr & ~(FMC_FLASH_PAGE_SIZE - 1);
+        u32StartAddr -= u32LastDataLen;
+        u32TotalLen += u32LastDataLen;
+        u32LastDataLen = 0;
+
+        /* The page buffer moved on to the next page. Take the head of the packet's page back from flash.
+           A page which failed to program is still in the buffer. */
+        if((u32PageAddr != (u32StartAddr & ~(FMC_FLASH_PAGE_SIZE - 1))) && !u32PageFail)
+            ISP_FlashRead(u32StartAddr & ~(FMC_FLASH_PAGE_SIZE - 1), u32StartAddr, s_au32PageBuf);
+
+        u32PageFail = 0;
+        goto out;
+    }
+
+    if((u32Cmd == CMD_UPDATE_APROM) || (u32Cmd == CMD_UPDATE_DATAFLASH))
+    {
+        if(u32TotalLen < u32SrcLen)
+            u32SrcLen = u32TotalLen;    /* Prevent last packet from over writing */
+
+        u32TotalLen -= u32SrcLen;
+
+        /* A page is programmed and verified when it is complete. If it fails, the packet is cleared so
+           the checksum fails and the host sends it again. */
+        u32PageFail = (ISP_FlashAppend(u32StartAddr, pu8Src, u32SrcLen, (u32TotalLen == 0), s_au32PageBuf) < 0);
+
+        if(u32PageFail)
+            memset(pu8Src, 0, u32SrcLen);
+
+        u32StartAddr += u32SrcLen;
+        u32LastDataLen = u32SrcLen;
+    }
+#if ISP_USE_LZ
+    else if(u32Cmd == CMD_UPDATE_APROM_LZ)
+    {
+        if(ISP_LzDecode(&s_sLz, pu8Src, u32SrcLen) < 0)
+            outpw(pu8Response + 8, 0xFFFFFFFF);
+        else
+            outpw(pu8Response + 8, s_sLz.u32Done);
+
+        outpw(pu8Response + 12, s_sLz.u32Sum);
+    }
+#endif
+#if ISP_USE_DELTA
+    else if(u32Cmd == CMD_UPDATE_APROM_DELTA)
+    {
+        if(ISP_DeltaDecode(&s_sDelta, pu8Src, u32SrcLen) < 0)
+            outpw(pu8Response + 8, 0xFFFFFFFF);
+        else
+            outpw(pu8Response + 8, s_sDelta.sOut.u32Done);
+
+        outpw(pu8Response + 12, s_sDelta.sOut.u32Sum);
+    }
+#endif
+
+out:
+#if ISP_USE_CRC32
+    if(s_u32Options & ISP_OPT_CRC32)
+    {
+        u32Reg = DWT->CYCCNT;
+        outpw(pu8Response, ISP_PktCrc32(pu8Buf, u32Len));
+        outpw(pu8Response + 56, DWT->CYCCNT - u32Reg);
+        outpw(pu8Response + 60, DWT->CYCCNT - u32Cycles);
+    }
+    else
+#endif
+    {
+        outpw(pu8Response, ISP_Checksum(pu8Buf, u32Len));
+    }
+
+    ++u32PackNo;
+    outpw(pu8Response + 4, u32PackNo);
+    u32PackNo++;
+}
+
+/*@}*/ /* end of group ISP_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group ISP_Library */
+
+/*@}*/ /* end of group Library */
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
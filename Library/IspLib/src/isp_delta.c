@@ -0,0 +1,190 @@
+/**************************************************************************//**
+ * @file     isp_delta.c
+ * @version  V1.00
+ * @brief    M451 series ISP delta image decoder source file
+ *
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include "isp_lib.h"
+
+/** @addtogroup Library Library
+  @{
+*/
+
+/** @addtogroup ISP_Library ISP Library
+  @{
+*/
+
+/** @addtogroup ISP_EXPORTED_FUNCTIONS ISP Exported Functions
+  @{
+*/
+
+/* Copy the record from the base image. The base image is still in flash at the source address. */
+static int32_t ISP_DeltaCopy(ISP_DELTA_T *psDelta)
+{
+    uint32_t u32Addr;
+
+    for(; psDelta->u32Len; psDelta->u32Len--, psDelta->u32Src++)
+    {
+        u32Addr = psDelta->u32Src & ~3UL;
+
+        if(u32Addr != psDelta->u32CacheAddr)
+        {
+            if(ISP_FlashRead(u32Addr, u32Addr + 4, &psDelta->u32CacheData) < 0)
+                return -1;
+
+            psDelta->u32CacheAddr = u32Addr;
+        }
+
+        if(ISP_LzPut(&psDelta->sOut, (uint8_t)(psDelta->u32CacheData >> ((psDelta->u32Src & 3) * 8))) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+/**
+  * @brief      Start applying a delta image
+  * @param[out] psDelta     Decoder state
+  * @param[in]  u32Addr     Page aligned flash address of the image
+  * @param[in]  u32Len      Size of the new image in bytes
+  * @param[in]  u32Crc      CRC-32 of the new image padded with 0xFF to word boundary
+  * @param[in]  pu32Page    Buffer of FMC_FLASH_PAGE_SIZE bytes. Each page is built here and then programmed.
+  * @return     None
+  */
+void ISP_DeltaOpen(ISP_DELTA_T *psDelta, uint32_t u32Addr, uint32_t u32Len, uint32_t u32Crc, uint32_t *pu32Page)
+{
+    ISP_LzOpen(&psDelta->sOut, u32Addr, u32Len, pu32Page);
+    psDelta->u32State = (u32Len) ? ISP_DELTA_STATE_TYPE : ISP_DELTA_STATE_DONE;
+    psDelta->u32Base = u32Addr;
+    psDelta->u32Crc = u32Crc;
+    psDelta->u32CacheAddr = 0xFFFFFFFF;
+}
+
+/**
+  * @brief      Apply a part of the delta stream and program the built pages
+  * @param[in]  psDelta     Decoder state
+  * @param[in]  pu8Src      Delta records
+  * @param[in]  u32Len      Size of delta records. The stream may be split at any byte.
+  * @retval     0   Success. Data after the end of the stream is ignored.
+  * @retval     -1  The stream is corrupted, programming failed or CRC-32 of the new image doesn't match.
+  *                 Decoding stays failed.
+  * @details    Each record is [type][32-bit length] followed by a 32-bit source address for ISP_DELTA_COPY or
+  *             the data for ISP_DELTA_DATA. ISP_DELTA_SAME keeps the bytes of the base image. Pages are built in
+  *             order and programmed only if they change, so a record may only copy from pages which are not
+  *             built yet or which don't change. The delta generator takes care of it.
+  */
+int32_t ISP_DeltaDecode(ISP_DELTA_T *psDelta, uint8_t *pu8Src, uint32_t u32Len)
+{
+    ISP_LZ_T *psOut = &psDelta->sOut;
+
+    while(u32Len || (psDelta->u32State == ISP_DELTA_STATE_COPY))
+    {
+        switch(psDelta->u32State)
+        {
+            case ISP_DELTA_STATE_TYPE:
+                psDelta->u32Type = *pu8Src++;
+                u32Len--;
+
+                if(psDelta->u32Type > ISP_DELTA_DATA)
+                    goto error;
+
+                psDelta->u32Len = 0;
+                psDelta->u32Shift = 0;
+                psDelta->u32State = ISP_DELTA_STATE_LEN;
+                break;
+
+            case ISP_DELTA_STATE_LEN:
+                psDelta->u32Len |= (uint32_t)(*pu8Src++) << psDelta->u32Shift;
+                u32Len--;
+                psDelta->u32Shift += 8;
+
+                if(psDelta->u32Shift < 32)
+                    break;
+
+                if((psDelta->u32Len == 0) || (psDelta->u32Len > psOut->u32Remain))
+                    goto error;
+
+                psDelta->u32Src = 0;
+                psDelta->u32Shift = 0;
+
+                if(psDelta->u32Type == ISP_DELTA_SAME)
+                {
+                    psDelta->u32Src = psOut->u32Addr + psOut->u32Pos;
+                    psDelta->u32State = ISP_DELTA_STATE_COPY;
+                }
+                else if(psDelta->u32Type == ISP_DELTA_COPY)
+                {
+                    psDelta->u32State = ISP_DELTA_STATE_SRC;
+                }
+                else
+                {
+                    psDelta->u32State = ISP_DELTA_STATE_DATA;
+                }
+
+                break;
+
+            case ISP_DELTA_STATE_SRC:
+                psDelta->u32Src |= (uint32_t)(*pu8Src++) << psDelta->u32Shift;
+                u32Len--;
+                psDelta->u32Shift += 8;
+
+                if(psDelta->u32Shift == 32)
+                    psDelta->u32State = ISP_DELTA_STATE_COPY;
+
+                break;
+
+            case ISP_DELTA_STATE_COPY:
+                if(ISP_DeltaCopy(psDelta) < 0)
+                    goto error;
+
+                goto next;
+
+            case ISP_DELTA_STATE_DATA:
+                if(ISP_LzPut(psOut, *pu8Src++) < 0)
+                    goto error;
+
+                u32Len--;
+
+                if(--psDelta->u32Len)
+                    break;
+
+next:
+                if(psOut->u32Remain)
+                {
+                    psDelta->u32State = ISP_DELTA_STATE_TYPE;
+                    break;
+                }
+
+                /* All pages are programmed. Verify the new image. */
+                if(ISP_FlashCrc32(psDelta->u32Base, psDelta->u32Base + psOut->u32Done) != psDelta->u32Crc)
+                    goto error;
+
+                psDelta->u32State = ISP_DELTA_STATE_DONE;
+                return 0;
+
+            case ISP_DELTA_STATE_DONE:
+                return 0;
+
+            default:
+                return -1;
+        }
+    }
+
+    return 0;
+
+error:
+    psDelta->u32State = ISP_DELTA_STATE_ERROR;
+    return -1;
+}
+
+/*@}*/ /* end of group ISP_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group ISP_Library */
+
+/*@}*/ /* end of group Library */
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
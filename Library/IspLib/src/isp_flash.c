@@ -0,0 +1,341 @@
+/**************************************************************************//**
+ * @file     isp_flash.c
+ * @version  V1.00
+ * @brief    M451 series ISP flash back end source file
+ *
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "isp_lib.h"
+
+/** @addtogroup Library Library
+  @{
+*/
+
+/** @addtogroup ISP_Library ISP Library
+  @{
+*/
+
+uint32_t g_u32IspApromSize;         /*!< APROM size */
+uint32_t g_u32IspDataFlashAddr;     /*!< Data Flash base address */
+uint32_t g_u32IspDataFlashSize;     /*!< Data Flash size */
+
+/** @addtogroup ISP_EXPORTED_FUNCTIONS ISP Exported Functions
+  @{
+*/
+
+static int32_t ISP_FlashProc(uint32_t u32Cmd, uint32_t u32Start, uint32_t u32End, uint32_t *pu32Data)
+{
+    uint32_t u32Addr, u32Reg, u32TimeOutCnt;
+
+    for(u32Addr = u32Start; u32Addr < u32End; pu32Data++)
+    {
+        FMC->ISPCMD = u32Cmd;
+        FMC->ISPADDR = u32Addr;
+
+        if(u32Cmd == FMC_ISPCMD_PROGRAM)
+            FMC->ISPDAT = *pu32Data;
+
+        FMC->ISPTRG = 0x1;
+        __ISB();
+
+        /* Wait for ISP command done. */
+        u32TimeOutCnt = (u32Cmd == FMC_ISPCMD_PAGE_ERASE) ? FMC_TIMEOUT_ERASE : FMC_TIMEOUT_WRITE;
+        while(FMC->ISPTRG & 0x1)
+        {
+            if(--u32TimeOutCnt == 0)
+                return -1;
+        }
+
+        u32Reg = FMC->ISPCTL;
+
+        if(u32Reg & FMC_ISPCTL_ISPFF_Msk)
+        {
+            FMC->ISPCTL = u32Reg;
+            return -1;
+        }
+
+        if(u32Cmd == FMC_ISPCMD_READ)
+            *pu32Data = FMC->ISPDAT;
+
+        if(u32Cmd == FMC_ISPCMD_PAGE_ERASE)
+            u32Addr += FMC_FLASH_PAGE_SIZE;
+        else
+            u32Addr += 4;
+    }
+
+    return 0;
+}
+
+/**
+  * @brief      Enable ISP function and get APROM and Data Flash information
+  * @param      None
+  * @retval     0   Success
+  * @retval     -1  APROM size is unknown
+  * @details    Register write-protection must be disabled before calling this function.
+  */
+int32_t ISP_FlashOpen(void)
+{
+    CLK->AHBCLK |= CLK_AHBCLK_ISPCKEN_Msk;
+    FMC->ISPCTL |= (FMC_ISPCTL_ISPEN_Msk | FMC_ISPCTL_APUEN_Msk);
+
+    g_u32IspApromSize = ISP_GetApromSize();
+
+    if(g_u32IspApromSize == 0)
+        return -1;
+
+    ISP_GetDataFlashInfo(&g_u32IspDataFlashAddr, &g_u32IspDataFlashSize);
+    return 0;
+}
+
+/**
+  * @brief      Read flash words by ISP read command
+  * @param[in]  u32Start    Start address
+  * @param[in]  u32End      End address (exclusive)
+  * @param[out] pu32Data    Data buffer
+  * @retval     0   Success
+  * @retval     -1  Read failed. The address is out of range.
+  */
+int32_t ISP_FlashRead(uint32_t u32Start, uint32_t u32End, uint32_t *pu32Data)
+{
+    return ISP_FlashProc(FMC_ISPCMD_READ, u32Start, u32End, pu32Data);
+}
+
+/**
+  * @brief      Erase flash pages
+  * @param[in]  u32Start    Page aligned start address
+  * @param[in]  u32Size     Size in bytes
+  * @retval     0   Success
+  * @retval     -1  Erase failed
+  */
+int32_t ISP_FlashErase(uint32_t u32Start, uint32_t u32Size)
+{
+    return ISP_FlashProc(FMC_ISPCMD_PAGE_ERASE, u32Start, u32Start + u32Size, NULL);
+}
+
+/**
+  * @brief      Program data only where flash content differs
+  * @param[in]  u32Start    Start address
+  * @param[in]  u32End      End address (exclusive)
+  * @param[in]  pu32Data    New data
+  * @param[in]  pu32PageBuf Buffer of FMC_FLASH_PAGE_SIZE bytes to build each page in. pu32Data may point to it
+  *                         when the data starts on a page boundary.
+  * @retval     1   Flash is changed
+  * @retval     0   Flash already holds the data
+  * @details    Each page is completed with its current content and passed to FMC_UpdatePage(), which
+  *             erases it only if a changed word is not blank.
+  */
+int32_t ISP_FlashUpdate(uint32_t u32Start, uint32_t u32End, uint32_t *pu32Data, uint32_t *pu32PageBuf)
+{
+    uint32_t u32Page, u32PageEnd, u32Len;
+    int32_t i32Ret = 0;
+
+    while(u32Start < u32End)
+    {
+        u32Page = u32Start & ~(FMC_FLASH_PAGE_SIZE - 1);
+        u32PageEnd = u32Page + FMC_FLASH_PAGE_SIZE;
+
+        if(u32PageEnd > u32End)
+            u32PageEnd = u32End;
+
+        u32Len = u32PageEnd - u32Start;
+
+        /* Keep the flash content around the new data */
+        ISP_FlashRead(u32Page, u32Start, pu32PageBuf);
+        if(&pu32PageBuf[(u32Start - u32Page) / 4] != pu32Data)
+            memcpy(&pu32PageBuf[(u32Start - u32Page) / 4], pu32Data, u32Len);
+        ISP_FlashRead(u32PageEnd, u32Page + FMC_FLASH_PAGE_SIZE, &pu32PageBuf[(u32PageEnd - u32Page) / 4]);
+
+        if(FMC_UpdatePage(u32Page, pu32PageBuf) != 1)
+            i32Ret = 1;
+
+        pu32Data += u32Len / 4;
+        u32Start = u32PageEnd;
+    }
+
+    return i32Ret;
+}
+
+/**
+  * @brief      Collect sequential data into the page buffer and update each page once
+  * @param[in]  u32Addr     Flash address of the data. It follows the data of the last call.
+  * @param[in]  pu8Data     New data
+  * @param[in]  u32Len      Byte count
+  * @param[in]  u32Last     1 if it is the end of the image. The last page is padded with 0xFF and updated.
+  * @param[in]  pu32PageBuf Buffer of FMC_FLASH_PAGE_SIZE bytes. It holds the data of the page before u32Addr.
+  * @retval     0   Success
+  * @retval     -1  A page failed. The buffer still holds the whole page, so the data can be sent again.
+  * @details    A page is passed to FMC_UpdatePage() only when it is complete, so it is erased at most once
+  *             however small the packets are.
+  */
+int32_t ISP_FlashAppend(uint32_t u32Addr, uint8_t *pu8Data, uint32_t u32Len, uint32_t u32Last, uint32_t *pu32PageBuf)
+{
+    uint8_t *pu8Page = (uint8_t *)pu32PageBuf;
+    uint32_t u32Pos, u32Copy;
+
+    while(u32Len > 0)
+    {
+        u32Pos = u32Addr & (FMC_FLASH_PAGE_SIZE - 1);
+        u32Copy = FMC_FLASH_PAGE_SIZE - u32Pos;
+
+        if(u32Copy > u32Len)
+            u32Copy = u32Len;
+
+        memcpy(&pu8Page[u32Pos], pu8Data, u32Copy);
+        u32Addr += u32Copy;
+        pu8Data += u32Copy;
+        u32Len -= u32Copy;
+
+        if(((u32Addr & (FMC_FLASH_PAGE_SIZE - 1)) == 0) &&
+                (FMC_UpdatePage(u32Addr - FMC_FLASH_PAGE_SIZE, pu32PageBuf) < 0))
+            return -1;
+    }
+
+    u32Pos = u32Addr & (FMC_FLASH_PAGE_SIZE - 1);
+
+    if(u32Last && u32Pos)
+    {
+        /* Clear the old content after the new image like ISP_FlashEraseUsed() */
+        memset(&pu8Page[u32Pos], 0xFF, FMC_FLASH_PAGE_SIZE - u32Pos);
+
+        if(FMC_UpdatePage(u32Addr - u32Pos, pu32PageBuf) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+/**
+  * @brief      Erase the pages which are not blank
+  * @param[in]  u32Start    Start address. Rounded up to page boundary.
+  * @param[in]  u32End      End address (exclusive)
+  * @return     None
+  */
+void ISP_FlashEraseUsed(uint32_t u32Start, uint32_t u32End)
+{
+    uint32_t u32Addr, u32Data;
+
+    u32Start = (u32Start + FMC_FLASH_PAGE_SIZE - 1) & ~(FMC_FLASH_PAGE_SIZE - 1);
+
+    for(; u32Start < u32End; u32Start += FMC_FLASH_PAGE_SIZE)
+    {
+        for(u32Addr = u32Start; u32Addr < u32Start + FMC_FLASH_PAGE_SIZE; u32Addr += 4)
+        {
+            ISP_FlashRead(u32Addr, u32Addr + 4, &u32Data);
+
+            if(u32Data != 0xFFFFFFFF)
+            {
+                ISP_FlashErase(u32Start, FMC_FLASH_PAGE_SIZE);
+                break;
+            }
+        }
+    }
+}
+
+/**
+  * @brief      Calculate CRC-32 of flash by CRC controller
+  * @param[in]  u32Start    Start address
+  * @param[in]  u32End      End address (exclusive). Rounded up to word boundary.
+  * @return     CRC-32 (IEEE 802.3, same as zlib crc32()) of the flash bytes
+  */
+uint32_t ISP_FlashCrc32(uint32_t u32Start, uint32_t u32End)
+{
+    uint32_t u32Data, i;
+
+    CLK->AHBCLK |= CLK_AHBCLK_CRCCKEN_Msk;
+    CRC->SEED = 0xFFFFFFFF;
+    CRC->CTL = CRC_32 | CRC_WDATA_RVS | CRC_CHECKSUM_RVS | CRC_CHECKSUM_COM | CRC_CPU_WDATA_8 | CRC_CTL_CRCEN_Msk;
+    CRC->CTL |= CRC_CTL_CRCRST_Msk;
+
+    for(; u32Start < u32End; u32Start += 4)
+    {
+        ISP_FlashRead(u32Start, u32Start + 4, &u32Data);
+
+        /* Byte writes keep the byte order of flash */
+        for(i = 0; i < 4; i++, u32Data >>= 8)
+            CRC->DAT = u32Data & 0xFF;
+    }
+
+    return CRC->CHECKSUM;
+}
+
+/**
+  * @brief      Write CONFIG0 and CONFIG1
+  * @param[in]  pu32Data    New CONFIG0 and CONFIG1
+  * @param[out] pu32Res     CONFIG0 and CONFIG1 read back. NULL if not required.
+  * @return     None
+  */
+void ISP_UpdateConfig(uint32_t *pu32Data, uint32_t *pu32Res)
+{
+    /* For M451 series, CONIFG2 must be 0xFFFFFF5A (Don't modify this value. It should be 0xFFFFFF5A after reset.) */
+    FMC_ENABLE_CFG_UPDATE();
+    ISP_FlashProc(FMC_ISPCMD_PAGE_ERASE, FMC_CONFIG0_ADDR, FMC_CONFIG0_ADDR + 8, NULL);
+    ISP_FlashProc(FMC_ISPCMD_PROGRAM, FMC_CONFIG0_ADDR, FMC_CONFIG0_ADDR + 8, pu32Data);
+
+    if(pu32Res)
+        ISP_FlashProc(FMC_ISPCMD_READ, FMC_CONFIG0_ADDR, FMC_CONFIG0_ADDR + 8, pu32Res);
+
+    FMC_DISABLE_CFG_UPDATE();
+}
+
+/**
+  * @brief      Get APROM size
+  * @param      None
+  * @return     APROM size. 0 if it is unknown.
+  * @details    Supports 40K/72K/128K/256K bytes APROM.
+  */
+uint32_t ISP_GetApromSize(void)
+{
+    const uint32_t au32Size[4] = {40 * 1024, 72 * 1024, 128 * 1024, 256 * 1024};
+    uint32_t i, u32Data;
+
+    for(i = 0; i < 4; i++)
+    {
+        if(ISP_FlashRead(au32Size[i], au32Size[i] + 4, &u32Data) < 0)
+            return au32Size[i];
+    }
+
+    return 0;
+}
+
+/**
+  * @brief      Get Data Flash base address and size
+  * @param[out] pu32Addr    Data Flash base address. It is the end of APROM if Data Flash is disabled.
+  * @param[out] pu32Size    Data Flash size
+  * @return     None
+  * @details    g_u32IspApromSize must be set before calling this function.
+  */
+void ISP_GetDataFlashInfo(uint32_t *pu32Addr, uint32_t *pu32Size)
+{
+    uint32_t u32Data;
+
+    ISP_FlashRead(FMC_CONFIG0_ADDR, FMC_CONFIG0_ADDR + 4, &u32Data);
+
+    if((u32Data & 0x01) == 0)   /* DFEN enable */
+    {
+        ISP_FlashRead(FMC_CONFIG1_ADDR, FMC_CONFIG1_ADDR + 4, &u32Data);
+
+        /* Avoid CONFIG1 value from error */
+        if((u32Data > g_u32IspApromSize) || (u32Data & (FMC_FLASH_PAGE_SIZE - 1)))
+            u32Data = g_u32IspApromSize;
+
+        *pu32Addr = u32Data;
+        *pu32Size = g_u32IspApromSize - u32Data;
+    }
+    else
+    {
+        *pu32Addr = g_u32IspApromSize;
+        *pu32Size = 0;
+    }
+}
+
+/*@}*/ /* end of group ISP_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group ISP_Library */
+
+/*@}*/ /* end of group Library */
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
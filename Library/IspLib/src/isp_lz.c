@@ -0,0 +1,225 @@
+/**************************************************************************//**
+ * @file     isp_lz.c
+ * @version  V1.00
+ * @brief    M451 series ISP compressed image decoder source file
+ *
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include "isp_lib.h"
+
+/** @addtogroup Library Library
+  @{
+*/
+
+/** @addtogroup ISP_Library ISP Library
+  @{
+*/
+
+/** @addtogroup ISP_EXPORTED_FUNCTIONS ISP Exported Functions
+  @{
+*/
+
+/* Program the decoded page and add the read back data to the checksum */
+static int32_t ISP_LzFlush(ISP_LZ_T *psLz)
+{
+    uint8_t *pu8Page = (uint8_t *)psLz->pu32Page;
+    uint32_t i, u32End;
+
+    /* Pad the last word of the image */
+    for(u32End = psLz->u32Pos; u32End & 3; u32End++)
+        pu8Page[u32End] = 0xFF;
+
+    /* The page starts on a page boundary, so the page buffer needn't keep any data before it */
+    ISP_FlashUpdate(psLz->u32Addr, psLz->u32Addr + u32End, psLz->pu32Page, psLz->pu32Page);
+
+    if(ISP_FlashRead(psLz->u32Addr, psLz->u32Addr + u32End, psLz->pu32Page) < 0)
+        return -1;
+
+    for(i = 0; i < psLz->u32Pos; i++)
+        psLz->u32Sum += pu8Page[i];
+
+    psLz->u32Addr += FMC_FLASH_PAGE_SIZE;
+    psLz->u32Pos = 0;
+    return 0;
+}
+
+/**
+  * @brief      Put a decoded byte to the page buffer
+  * @param[in]  psLz        Decoder state
+  * @param[in]  u8Data      Decoded byte
+  * @retval     0   Success
+  * @retval     -1  The image is complete or the page can't be programmed
+  * @details    The page is programmed when it is full or the image is complete. Other decoders which write
+  *             a page aligned image use this function too.
+  */
+int32_t ISP_LzPut(ISP_LZ_T *psLz, uint8_t u8Data)
+{
+    if(psLz->u32Remain == 0)
+        return -1;
+
+    ((uint8_t *)psLz->pu32Page)[psLz->u32Pos++] = u8Data;
+    psLz->u32Done++;
+    psLz->u32Remain--;
+
+    if((psLz->u32Pos == FMC_FLASH_PAGE_SIZE) || (psLz->u32Remain == 0))
+        return ISP_LzFlush(psLz);
+
+    return 0;
+}
+
+/* Copy a match. Data of the previous pages is read back from flash. */
+static int32_t ISP_LzCopy(ISP_LZ_T *psLz)
+{
+    uint32_t u32Addr, u32Data;
+    uint8_t u8Data;
+
+    if((psLz->u32Offset == 0) || (psLz->u32Offset > psLz->u32Done) || (psLz->u32Len > psLz->u32Remain))
+        return -1;
+
+    while(psLz->u32Len--)
+    {
+        if(psLz->u32Offset <= psLz->u32Pos)
+        {
+            u8Data = ((uint8_t *)psLz->pu32Page)[psLz->u32Pos - psLz->u32Offset];
+        }
+        else
+        {
+            u32Addr = psLz->u32Addr + psLz->u32Pos - psLz->u32Offset;
+            ISP_FlashRead(u32Addr & ~3UL, (u32Addr & ~3UL) + 4, &u32Data);
+            u8Data = (uint8_t)(u32Data >> ((u32Addr & 3) * 8));
+        }
+
+        if(ISP_LzPut(psLz, u8Data) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+/**
+  * @brief      Start decoding a compressed image
+  * @param[out] psLz        Decoder state
+  * @param[in]  u32Addr     Page aligned flash address of the image
+  * @param[in]  u32Len      Size of the decoded image in bytes
+  * @param[in]  pu32Page    Buffer of FMC_FLASH_PAGE_SIZE bytes. Each page is decoded here and then programmed.
+  * @return     None
+  */
+void ISP_LzOpen(ISP_LZ_T *psLz, uint32_t u32Addr, uint32_t u32Len, uint32_t *pu32Page)
+{
+    psLz->u32State = (u32Len) ? ISP_LZ_STATE_TOKEN : ISP_LZ_STATE_DONE;
+    psLz->u32Addr = u32Addr;
+    psLz->u32Pos = 0;
+    psLz->u32Done = 0;
+    psLz->u32Remain = u32Len;
+    psLz->u32Sum = 0;
+    psLz->pu32Page = pu32Page;
+}
+
+/**
+  * @brief      Decode a part of the compressed stream and program the decoded pages
+  * @param[in]  psLz        Decoder state
+  * @param[in]  pu8Src      Compressed data
+  * @param[in]  u32Len      Size of compressed data. The stream may be split at any byte.
+  * @retval     0   Success. Data after the end of the stream is ignored.
+  * @retval     -1  The stream is corrupted or the flash can't be read. Decoding stays failed.
+  * @details    The stream is an LZ4 block (token, literals, 16-bit offset, match length) which decodes to the
+  *             size given to ISP_LzOpen(). A match may refer to any decoded byte up to 64 KB back, so the
+  *             decoder needs no history buffer in SRAM.
+  */
+int32_t ISP_LzDecode(ISP_LZ_T *psLz, uint8_t *pu8Src, uint32_t u32Len)
+{
+    uint32_t u32Data;
+
+    while(u32Len--)
+    {
+        u32Data = *pu8Src++;
+
+        switch(psLz->u32State)
+        {
+            case ISP_LZ_STATE_TOKEN:
+                psLz->u32Token = u32Data;
+                psLz->u32Len = u32Data >> 4;
+
+                if(psLz->u32Len == 15)
+                    psLz->u32State = ISP_LZ_STATE_LITLEN;
+                else if(psLz->u32Len)
+                    psLz->u32State = ISP_LZ_STATE_LITERAL;
+                else
+                    psLz->u32State = ISP_LZ_STATE_OFFSET0;
+
+                break;
+
+            case ISP_LZ_STATE_LITLEN:
+                psLz->u32Len += u32Data;
+
+                if(u32Data != 255)
+                    psLz->u32State = ISP_LZ_STATE_LITERAL;
+
+                break;
+
+            case ISP_LZ_STATE_LITERAL:
+                if(ISP_LzPut(psLz, (uint8_t)u32Data) < 0)
+                    goto error;
+
+                if(--psLz->u32Len == 0)
+                    psLz->u32State = (psLz->u32Remain) ? ISP_LZ_STATE_OFFSET0 : ISP_LZ_STATE_DONE;
+
+                break;
+
+            case ISP_LZ_STATE_OFFSET0:
+                psLz->u32Offset = u32Data;
+                psLz->u32State = ISP_LZ_STATE_OFFSET1;
+                break;
+
+            case ISP_LZ_STATE_OFFSET1:
+                psLz->u32Offset |= u32Data << 8;
+                psLz->u32Len = psLz->u32Token & 0xF;
+
+                if(psLz->u32Len == 15)
+                {
+                    psLz->u32State = ISP_LZ_STATE_MATLEN;
+                    break;
+                }
+
+                goto copy;
+
+            case ISP_LZ_STATE_MATLEN:
+                psLz->u32Len += u32Data;
+
+                if(u32Data == 255)
+                    break;
+
+copy:
+                psLz->u32Len += 4;  /* Minimum match */
+
+                if(ISP_LzCopy(psLz) < 0)
+                    goto error;
+
+                psLz->u32State = (psLz->u32Remain) ? ISP_LZ_STATE_TOKEN : ISP_LZ_STATE_DONE;
+                break;
+
+            case ISP_LZ_STATE_DONE:
+                return 0;
+
+            default:
+                return -1;
+        }
+    }
+
+    return 0;
+
+error:
+    psLz->u32State = ISP_LZ_STATE_ERROR;
+    return -1;
+}
+
+/*@}*/ /* end of group ISP_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group ISP_Library */
+
+/*@}*/ /* end of group Library */
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
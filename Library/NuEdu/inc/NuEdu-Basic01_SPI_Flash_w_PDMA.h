@@ -11,4 +11,9 @@ extern unsigned int SpiFlash_w_PDMA_ReadStatusReg2(void);
 extern void SpiFlash_w_PDMA_WaitReady(void);
 extern void SpiFlash_w_PDMA_PageProgram(unsigned int u32SrcAddr, unsigned int StartAddress);
 extern void SpiFlash_w_PDMA_ReadData(unsigned int u32DestAddr, unsigned int StartAddress);
+extern unsigned int SpiFlash_w_PDMA_Init(unsigned int u32BusClock);
+extern void SpiFlash_w_PDMA_Write(unsigned int u32SrcAddr, unsigned int StartAddress, unsigned int u32Length);
+extern void SpiFlash_w_PDMA_WriteStream(unsigned int u32SrcAddr, unsigned int StartAddress, unsigned int u32Length,
+                                        void (*pfnFill)(unsigned char *pu8Buf, unsigned int u32Length));
+extern void SpiFlash_w_PDMA_Read(unsigned int u32DestAddr, unsigned int StartAddress, unsigned int u32Length);
 #endif
@@ -9,6 +9,17 @@
 #define TEST_LENGTH                 256
 #define SPI_CLR_TXFIFO_MASK 9
 #define SPI_CLR_RXFIFO_MASK 8
+#define SPI_FLASH_PAGE_SIZE         256
+#define SPI_PDMA_MAX_COUNT          16384   /* TXCNT of a PDMA channel is 14 bits */
+
+// PDMA control word of a transfer: 8-bit single requests without table interrupt.
+// The channels are opened once by SpiFlash_w_PDMA_Init(), so each transfer only writes the memory address and this word.
+#define SPI_PDMA_CTL(u32Count, u32Inc)  (PDMA_OP_BASIC | PDMA_REQ_SINGLE | PDMA_WIDTH_8 | PDMA_DSCT_CTL_TBINTDIS_Msk | \
+                                         (u32Inc) | (((u32Count) - 1) << PDMA_DSCT_CTL_TXCNT_Pos))
+
+static unsigned char s_u8PdmaReady = 0;
+static unsigned char s_u8DummyTx = 0xFF;
+static unsigned char s_au8PageStage[SPI_FLASH_PAGE_SIZE];
 
 void Init_PDMA_CH1_for_SPI2_TX(uint32_t u32SrcAddr)
 {
@@ -220,151 +231,208 @@ void SpiFlash_w_PDMA_WaitReady(void)
 }
 
 // **************************************
-void SpiFlash_w_PDMA_PageProgram(unsigned int u32SrcAddr, unsigned int StartAddress)
+// Open the PDMA channels once. The request sources and the SPI side addresses stay set, so the transfers
+// after it only load the memory address and the count. The channels are reserved with PDMA_ReserveChannels(),
+// so PDMA_AllocChannel() and other drivers can't take them. Return 0 if another driver holds them.
+unsigned int SpiFlash_w_PDMA_Init(unsigned int u32BusClock)
 {
-    unsigned int au32SourceData;
-    unsigned int u32RegValue, u32Abort;
+    unsigned int u32Clock;
 
-    // /CS: active
-    SPI_SET_SS_LOW(SPI2);
-    // configure transaction length as 8 bits
+    if(!s_u8PdmaReady && (PDMA_ReserveChannels((1 << SPI_TX_DMA_CH) | (1 << SPI_RX_DMA_CH)) != 0))
+        return 0;
+
+    // set the bus clock for bulk transfers and 8-bit transactions
+    if(u32BusClock)
+        u32Clock = SPI_SetBusClock(SPI2, u32BusClock);
+    else
+        u32Clock = SPI_GetBusClock(SPI2);
     SPI_SET_DATA_WIDTH(SPI2, 8);
-    // send Command: 0x06, Write enable
-    au32SourceData = 0x06;
-    SPI_WRITE_TX(SPI2, au32SourceData);
+
+    PDMA_Open((1 << SPI_TX_DMA_CH) | (1 << SPI_RX_DMA_CH));
+    PDMA_SetTransferMode(SPI_TX_DMA_CH, PDMA_SPI2_TX, FALSE, 0);
+    PDMA_SetTransferMode(SPI_RX_DMA_CH, PDMA_SPI2_RX, FALSE, 0);
+    PDMA_SET_DST_ADDR(SPI_TX_DMA_CH, (uint32_t)&SPI2->TX);
+    PDMA_SET_SRC_ADDR(SPI_RX_DMA_CH, (uint32_t)&SPI2->RX);
+    s_u8PdmaReady = 1;
+
+    return u32Clock;
+}
+
+// **************************************
+// Wait until the PDMA channels of u32Mask are done, then until SPI2 is idle.
+// Return 0 if a channel was aborted.
+static unsigned int SpiFlash_w_PDMA_WaitDone(unsigned int u32Mask)
+{
+    unsigned int u32Done = 0, u32Abort;
+
+    while(u32Done != u32Mask)
+    {
+        // check the DMA transfer abort flag
+        u32Abort = PDMA_GET_ABORT_STS() & u32Mask;
+        if(u32Abort)
+        {
+            PDMA_CLR_ABORT_FLAG(u32Abort);
+            break;
+        }
+
+        // check the DMA transfer done flags
+        u32Done |= PDMA_GET_TD_STS() & u32Mask;
+    }
+
+    PDMA_CLR_TD_FLAG(u32Done);
+    SPI_DISABLE_TX_RX_PDMA(SPI2);
+
     // wait
     while(SPI_IS_BUSY(SPI2));
 
-    // /CS: de-active
-    SPI_SET_SS_HIGH(SPI2);
+    return (u32Done == u32Mask);
+}
+
+// **************************************
+// Send Command: 0x06, Write enable, then a command with a 24-bit address. /CS stays active.
+static void SpiFlash_w_PDMA_SendCmdAddr(unsigned int u32Cmd, unsigned int StartAddress, unsigned int u32WriteEnable)
+{
+    if(u32WriteEnable)
+    {
+        // /CS: active
+        SPI_SET_SS_LOW(SPI2);
+        // configure transaction length as 8 bits
+        SPI_SET_DATA_WIDTH(SPI2, 8);
+        SPI_WRITE_TX(SPI2, 0x06);
+        // wait
+        while(SPI_IS_BUSY(SPI2));
+        // /CS: de-active
+        SPI_SET_SS_HIGH(SPI2);
+    }
 
     // /CS: active
     SPI_SET_SS_LOW(SPI2);
-    // send Command: 0x02, Page program
-    au32SourceData = 0x02;
-    SPI_WRITE_TX(SPI2, au32SourceData);
-    // wait
-    while(SPI_IS_BUSY(SPI2));
-
-    // configure transaction length as 24 bits
-    SPI_SET_DATA_WIDTH(SPI2, 24);
-    // send 24-bit start address
-    au32SourceData = StartAddress;
-    SPI_WRITE_TX(SPI2, au32SourceData);
+    // configure transaction length as 32 bits: command and 24-bit address
+    SPI_SET_DATA_WIDTH(SPI2, 32);
+    SPI_WRITE_TX(SPI2, (u32Cmd << 24) | (StartAddress & 0xFFFFFF));
     // wait
     while(SPI_IS_BUSY(SPI2));
 
-    // configure transaction length as 8 bits
+    // configure transaction length as 8 bits for the data phase
     SPI_SET_DATA_WIDTH(SPI2, 8);
+}
+
+// **************************************
+// Program one page or a part of a page. The flash programs it after /CS goes high, so this returns
+// while the flash is still busy.
+static void SpiFlash_w_PDMA_ProgramPage(unsigned int u32SrcAddr, unsigned int StartAddress, unsigned int u32Length)
+{
+    if(!s_u8PdmaReady && !SpiFlash_w_PDMA_Init(0))
+        return;
+
+    // send Command: 0x02, Page program
+    SpiFlash_w_PDMA_SendCmdAddr(0x02, StartAddress, 1);
     SPI_ClearTxFIFO(SPI2);
 
-    // enable SPI PDMA
-    /* Initial PDMA Channel */
-    Init_PDMA_CH1_for_SPI2_TX((uint32_t)u32SrcAddr);
+    // re-arm the TX channel
+    PDMA_SET_SRC_ADDR(SPI_TX_DMA_CH, u32SrcAddr);
+    PDMA->DSCT[SPI_TX_DMA_CH].CTL = SPI_PDMA_CTL(u32Length, PDMA_SAR_INC | PDMA_DAR_FIX);
     SPI_TRIGGER_TX_PDMA(SPI2);
 
-    while(1)
-    {
-        /* Get interrupt status */
-        u32RegValue = PDMA_GET_INT_STATUS();
-        /* Check the DMA transfer done interrupt flag */
-        if(u32RegValue & PDMA_INTSTS_TDIF_Msk)
-        {
-            /* Check the PDMA transfer done interrupt flags */
-            if((PDMA_GET_TD_STS() & (1 << SPI_TX_DMA_CH)) == (1 << SPI_TX_DMA_CH))
-            {
-                /* Clear the DMA transfer done flags */
-                PDMA_CLR_TD_FLAG(1 << SPI_TX_DMA_CH);
-                /* Disable SPI PDMA TX function */
-                SPI_DISABLE_TX_PDMA(SPI2);
-                break;
-            }
-
-            /* Check the DMA transfer abort interrupt flag */
-            if(u32RegValue & PDMA_INTSTS_ABTIF_Msk)
-            {
-                /* Get the target abort flag */
-                u32Abort = PDMA_GET_ABORT_STS();
-                /* Clear the target abort flag */
-                PDMA_CLR_ABORT_FLAG(u32Abort);
-                break;
-            }
-        }
-    }
-
-    // wait
-    while(SPI_IS_BUSY(SPI2));
+    SpiFlash_w_PDMA_WaitDone(1 << SPI_TX_DMA_CH);
 
     // /CS: de-active
     SPI_SET_SS_HIGH(SPI2);
-
 }
 
+// **************************************
+void SpiFlash_w_PDMA_PageProgram(unsigned int u32SrcAddr, unsigned int StartAddress)
+{
+    SpiFlash_w_PDMA_ProgramPage(u32SrcAddr, StartAddress, SPI_FLASH_PAGE_SIZE);
+}
 
 // **************************************
-void SpiFlash_w_PDMA_ReadData(unsigned int u32DestAddr, unsigned int StartAddress)
+// Program u32Length bytes from any flash address. The data are split at the page boundaries.
+// If pfnFill is not NULL, it produces the data page by page into a staging buffer, and u32SrcAddr is unused.
+// The next page is staged while the flash programs the current one, so its time is hidden behind the
+// program time. It returns after the last page is programmed.
+void SpiFlash_w_PDMA_WriteStream(unsigned int u32SrcAddr, unsigned int StartAddress, unsigned int u32Length,
+                                 void (*pfnFill)(unsigned char *pu8Buf, unsigned int u32Length))
 {
-    unsigned int au32SourceData;
-    unsigned int u32RegValue, u32Abort;
+    unsigned int u32Chunk, u32Next;
 
-    // /CS: active
-    SPI_SET_SS_LOW(SPI2);
-    // configure transaction length as 8 bits
-    SPI_SET_DATA_WIDTH(SPI2, 8);
-    // send Command: 0x03, Read data
-    au32SourceData = 0x03;
-    SPI_WRITE_TX(SPI2, au32SourceData);
-    // wait
-    while(SPI_IS_BUSY(SPI2));
+    // the first page ends at the page boundary
+    u32Chunk = SPI_FLASH_PAGE_SIZE - (StartAddress % SPI_FLASH_PAGE_SIZE);
+    if(u32Chunk > u32Length)
+        u32Chunk = u32Length;
 
-    // configure transaction length as 24 bits
-    SPI_SET_DATA_WIDTH(SPI2, 24);
-    // send 24-bit start address
-    au32SourceData = StartAddress;
-    SPI_WRITE_TX(SPI2, au32SourceData);
-    // wait
-    while(SPI_IS_BUSY(SPI2));
+    if(pfnFill && u32Chunk)
+        pfnFill(s_au8PageStage, u32Chunk);
 
-    // configure transaction length as 8 bits
-    SPI_SET_DATA_WIDTH(SPI2, 8);
-    SPI_ClearRxFIFO(SPI2);
+    while(u32Length)
+    {
+        // the previous page must be done
+        SpiFlash_w_PDMA_WaitReady();
 
-    // enable SPI PDMA
-    Init_PDMA_CH2_for_SPI2_RX((uint32_t)u32DestAddr);
-    SPI_TRIGGER_RX_PDMA(SPI2);
+        SpiFlash_w_PDMA_ProgramPage(pfnFill ? (uint32_t)s_au8PageStage : u32SrcAddr, StartAddress, u32Chunk);
 
-    while(1)
-    {
-        /* Get interrupt status */
-        u32RegValue = PDMA_GET_INT_STATUS();
-        /* Check the DMA transfer done interrupt flag */
-        if(u32RegValue & PDMA_INTSTS_TDIF_Msk)
-        {
-            /* Check the PDMA transfer done interrupt flags */
-            if((PDMA_GET_TD_STS() & (1 << SPI_RX_DMA_CH)) == (1 << SPI_RX_DMA_CH))
-            {
-                /* Clear the DMA transfer done flags */
-                PDMA_CLR_TD_FLAG(1 << SPI_RX_DMA_CH);
-                /* Disable SPI PDMA RX function */
-                SPI_DISABLE_RX_PDMA(SPI2);
-                break;
-            }
-
-            /* Check the DMA transfer abort interrupt flag */
-            if(u32RegValue & PDMA_INTSTS_ABTIF_Msk)
-            {
-                /* Get the target abort flag */
-                u32Abort = PDMA_GET_ABORT_STS();
-                /* Clear the target abort flag */
-                PDMA_CLR_ABORT_FLAG(u32Abort);
-                break;
-            }
-        }
+        StartAddress += u32Chunk;
+        u32SrcAddr += u32Chunk;
+        u32Length -= u32Chunk;
+        u32Next = (u32Length > SPI_FLASH_PAGE_SIZE) ? SPI_FLASH_PAGE_SIZE : u32Length;
+
+        // the flash has latched the page, so the staging buffer can be refilled while it programs
+        if(pfnFill && u32Next)
+            pfnFill(s_au8PageStage, u32Next);
+
+        u32Chunk = u32Next;
     }
 
+    SpiFlash_w_PDMA_WaitReady();
+}
+
+// **************************************
+void SpiFlash_w_PDMA_Write(unsigned int u32SrcAddr, unsigned int StartAddress, unsigned int u32Length)
+{
+    SpiFlash_w_PDMA_WriteStream(u32SrcAddr, StartAddress, u32Length, NULL);
+}
+
+// **************************************
+// Read u32Length bytes with Command: 0x0B, Fast read. One command is sent, then the data are received in PDMA
+// transfers of up to 16 KB back to back, so the bus runs near its clock rate at any length.
+void SpiFlash_w_PDMA_Read(unsigned int u32DestAddr, unsigned int StartAddress, unsigned int u32Length)
+{
+    unsigned int u32Chunk;
+
+    if(!s_u8PdmaReady && !SpiFlash_w_PDMA_Init(0))
+        return;
+
+    // send Command: 0x0B, Fast read, and one dummy byte
+    SpiFlash_w_PDMA_SendCmdAddr(0x0B, StartAddress, 0);
+    SPI_WRITE_TX(SPI2, 0xFF);
     // wait
     while(SPI_IS_BUSY(SPI2));
 
+    while(u32Length)
+    {
+        u32Chunk = (u32Length > SPI_PDMA_MAX_COUNT) ? SPI_PDMA_MAX_COUNT : u32Length;
+        SPI_ClearRxFIFO(SPI2);
+
+        // re-arm the RX channel and a TX channel which clocks out dummy bytes
+        PDMA_SET_DST_ADDR(SPI_RX_DMA_CH, u32DestAddr);
+        PDMA->DSCT[SPI_RX_DMA_CH].CTL = SPI_PDMA_CTL(u32Chunk, PDMA_SAR_FIX | PDMA_DAR_INC);
+        PDMA_SET_SRC_ADDR(SPI_TX_DMA_CH, (uint32_t)&s_u8DummyTx);
+        PDMA->DSCT[SPI_TX_DMA_CH].CTL = SPI_PDMA_CTL(u32Chunk, PDMA_SAR_FIX | PDMA_DAR_FIX);
+        SPI_TRIGGER_TX_RX_PDMA(SPI2);
+
+        if(!SpiFlash_w_PDMA_WaitDone((1 << SPI_TX_DMA_CH) | (1 << SPI_RX_DMA_CH)))
+            break;
+
+        u32DestAddr += u32Chunk;
+        u32Length -= u32Chunk;
+    }
+
     // /CS: de-active
     SPI_SET_SS_HIGH(SPI2);
 }
+
+// **************************************
+void SpiFlash_w_PDMA_ReadData(unsigned int u32DestAddr, unsigned int StartAddress)
+{
+    SpiFlash_w_PDMA_Read(u32DestAddr, StartAddress, SPI_FLASH_PAGE_SIZE);
+}
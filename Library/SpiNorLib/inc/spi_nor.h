@@ -0,0 +1,194 @@
+/**************************************************************************//**
+ * @file     spi_nor.h
+ * @version  V1.00
+ * @brief    SPI NOR flash library header file
+ *
+ * @note
+ *           The library only talks to the flash through SPI_NOR_T.pfnExec(), so it has no chip dependency and
+ *           builds on a PC against a simulated flash. spi_nor_port.h binds it to the SPI transaction queue.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __SPI_NOR_H__
+#define __SPI_NOR_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @addtogroup Library Library
+  @{
+*/
+
+/** @addtogroup SPI_NOR_Library SPI NOR Library
+  @{
+*/
+
+/** @addtogroup SPI_NOR_EXPORTED_CONSTANTS SPI NOR Exported Constants
+  @{
+*/
+
+/* Bus width of an operation. The command is always on one line, the address and the dummy bytes are on
+   SPI_NOR_ADDR_LINES() lines and the data is on SPI_NOR_DATA_LINES() lines. */
+#define SPI_NOR_BUS_1_1_1       0x11    /*!< Single SPI */
+#define SPI_NOR_BUS_1_1_2       0x12    /*!< Dual output */
+#define SPI_NOR_BUS_1_2_2       0x22    /*!< Dual I/O */
+#define SPI_NOR_BUS_1_1_4       0x14    /*!< Quad output */
+#define SPI_NOR_BUS_1_4_4       0x44    /*!< Quad I/O */
+#define SPI_NOR_ADDR_LINES(bus) (((bus) >> 4) & 0xF)
+#define SPI_NOR_DATA_LINES(bus) ((bus) & 0xF)
+
+/* Bus widths which the port supports besides single SPI. See SpiNor_Open(). */
+#define SPI_NOR_CAP_DUAL        0x01
+#define SPI_NOR_CAP_QUAD        0x02
+
+#define SPI_NOR_MAX_DUMMY       8       /*!< Maximum mode and dummy bytes of a read */
+#define SPI_NOR_MAX_ERASE_TYPES 4       /*!< Erase types in the SFDP basic table */
+
+/* SPI_NOR_T.u32State */
+#define SPI_NOR_STATE_IDLE      0       /*!< No program or erase is running */
+#define SPI_NOR_STATE_PROGRAM   1       /*!< SpiNor_WriteStart() is running */
+#define SPI_NOR_STATE_ERASE     2       /*!< SpiNor_EraseStart() is running */
+
+/* Return values */
+#define SPI_NOR_OK              0
+#define SPI_NOR_ERR_PARAM       -1      /*!< Address, length or alignment is invalid */
+#define SPI_NOR_ERR_BUSY        -2      /*!< A program or erase is still running */
+#define SPI_NOR_ERR_DEVICE      -3      /*!< No flash answered, or the port failed */
+
+/* Commands */
+#define SPI_NOR_CMD_WRSR        0x01
+#define SPI_NOR_CMD_PP          0x02
+#define SPI_NOR_CMD_READ        0x03
+#define SPI_NOR_CMD_RDSR        0x05
+#define SPI_NOR_CMD_WREN        0x06
+#define SPI_NOR_CMD_FAST_READ   0x0B
+#define SPI_NOR_CMD_SE_4K       0x20
+#define SPI_NOR_CMD_WRSR2       0x31
+#define SPI_NOR_CMD_RDSR2       0x35
+#define SPI_NOR_CMD_WRSR2_3E    0x3E
+#define SPI_NOR_CMD_RDSR2_3F    0x3F
+#define SPI_NOR_CMD_RDSFDP      0x5A
+#define SPI_NOR_CMD_RESUME      0x7A
+#define SPI_NOR_CMD_SUSPEND     0x75
+#define SPI_NOR_CMD_RDID        0x9F
+#define SPI_NOR_CMD_EN4B        0xB7
+#define SPI_NOR_CMD_BE_64K      0xD8
+
+#define SPI_NOR_SR_WIP          0x01    /*!< Write in progress bit of the status register */
+
+/*@}*/ /* end of group SPI_NOR_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup SPI_NOR_EXPORTED_STRUCTS SPI NOR Exported Structs
+  @{
+*/
+
+/**
+  * @details  One flash operation with one chip select assertion. The mode and dummy bytes follow the address
+  *           on the address lines with the value 0xFF, which never enters a continuous read mode.
+  *           Only one of pu8Tx and pu8Rx is used.
+  */
+typedef struct
+{
+    uint8_t u8Cmd;
+    uint8_t u8Bus;                  /*!< SPI_NOR_BUS_1_1_1, ... */
+    uint8_t u8AddrLen;              /*!< 0, 3 or 4 bytes */
+    uint8_t u8Dummy;                /*!< Mode and dummy bytes, 0 ~ SPI_NOR_MAX_DUMMY */
+    uint32_t u32Addr;
+    const uint8_t *pu8Tx;           /*!< Data to send, or NULL */
+    uint8_t *pu8Rx;                 /*!< Buffer of received data, or NULL */
+    uint32_t u32Len;                /*!< Data bytes. Can be 0 */
+} SPI_NOR_OP_T;
+
+/**
+  * @details  An erase type of the flash
+  */
+typedef struct
+{
+    uint32_t u32Size;               /*!< Bytes, a power of 2 */
+    uint32_t u32TimeMs;             /*!< Typical erase time */
+    uint8_t u8Cmd;
+    uint8_t u8Use;                  /*!< Private. Erase of this size is faster than erases of the smaller sizes */
+} SPI_NOR_ERASE_TYPE_T;
+
+/**
+  * @details  One step of an erase plan. See SpiNor_PlanErase().
+  */
+typedef struct
+{
+    uint32_t u32Addr;
+    uint32_t u32Size;
+    uint8_t u8Cmd;
+} SPI_NOR_ERASE_STEP_T;
+
+/**
+  * @details  A flash device. The port fills pfnExec, pfnYield, pvPort and u32MaxLen before SpiNor_Open(),
+  *           which fills the rest from the SFDP tables.
+  */
+typedef struct SPI_NOR
+{
+    /* Port */
+    int32_t (*pfnExec)(void *pvPort, const SPI_NOR_OP_T *psOp, uint32_t u32Num);   /*!< Run operations back to back. 0 on success */
+    void (*pfnYield)(struct SPI_NOR *psNor);    /*!< Called while the flash is busy. Can be NULL */
+    void *pvPort;
+    uint32_t u32MaxLen;             /*!< Maximum data bytes of one operation. 0 if there is no limit */
+
+    /* Device */
+    uint32_t u32JedecId;
+    uint32_t u32Size;               /*!< Bytes */
+    uint32_t u32PageSize;           /*!< Program page bytes */
+    uint8_t u8AddrLen;              /*!< 3 or 4 */
+    uint8_t u8ReadCmd;
+    uint8_t u8ReadBus;              /*!< SPI_NOR_BUS_XXX of u8ReadCmd */
+    uint8_t u8ReadDummy;            /*!< Mode and dummy bytes of u8ReadCmd */
+    uint8_t u8QeMethod;             /*!< Quad enable requirement of SFDP */
+    uint8_t u8SuspendCmd;           /*!< 0 if program and erase suspend aren't supported */
+    uint8_t u8ResumeCmd;
+    uint8_t u8Sfdp;                 /*!< 1 if the parameters come from SFDP */
+    uint32_t u32EraseNum;
+    SPI_NOR_ERASE_TYPE_T asErase[SPI_NOR_MAX_ERASE_TYPES];  /*!< In ascending size */
+
+    /* Background program or erase */
+    uint32_t u32State;              /*!< SPI_NOR_STATE_XXX */
+    uint32_t u32Addr;               /*!< Next page or block */
+    uint32_t u32End;
+    const uint8_t *pu8Src;          /*!< Data of the next page */
+    uint32_t u32SuspendCnt;         /*!< Reads which suspended a program or erase */
+} SPI_NOR_T;
+
+/*@}*/ /* end of group SPI_NOR_EXPORTED_STRUCTS */
+
+
+/** @addtogroup SPI_NOR_EXPORTED_FUNCTIONS SPI NOR Exported Functions
+  @{
+*/
+
+int32_t SpiNor_Open(SPI_NOR_T *psNor, uint32_t u32Caps);
+int32_t SpiNor_Read(SPI_NOR_T *psNor, uint32_t u32Addr, uint8_t *pu8Buf, uint32_t u32Len);
+int32_t SpiNor_WriteStart(SPI_NOR_T *psNor, uint32_t u32Addr, const uint8_t *pu8Data, uint32_t u32Len);
+int32_t SpiNor_Write(SPI_NOR_T *psNor, uint32_t u32Addr, const uint8_t *pu8Data, uint32_t u32Len);
+int32_t SpiNor_EraseStart(SPI_NOR_T *psNor, uint32_t u32Addr, uint32_t u32Len);
+int32_t SpiNor_Erase(SPI_NOR_T *psNor, uint32_t u32Addr, uint32_t u32Len);
+int32_t SpiNor_PlanErase(SPI_NOR_T *psNor, uint32_t u32Addr, uint32_t u32Len, SPI_NOR_ERASE_STEP_T *psStep,
+                         uint32_t u32MaxSteps, uint32_t *pu32TimeMs);
+int32_t SpiNor_Poll(SPI_NOR_T *psNor);
+int32_t SpiNor_Sync(SPI_NOR_T *psNor);
+
+/*@}*/ /* end of group SPI_NOR_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group SPI_NOR_Library */
+
+/*@}*/ /* end of group Library */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__SPI_NOR_H__
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
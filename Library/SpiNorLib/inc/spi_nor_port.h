@@ -0,0 +1,79 @@
+/**************************************************************************//**
+ * @file     spi_nor_port.h
+ * @version  V1.00
+ * @brief    SPI NOR flash library port of the M451 SPI transaction queue header file
+ *
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __SPI_NOR_PORT_H__
+#define __SPI_NOR_PORT_H__
+
+#include "M451Series.h"
+#include "spi_nor.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @addtogroup Library Library
+  @{
+*/
+
+/** @addtogroup SPI_NOR_Library SPI NOR Library
+  @{
+*/
+
+/** @addtogroup SPI_NOR_EXPORTED_CONSTANTS SPI NOR Exported Constants
+  @{
+*/
+
+#define SPI_NOR_PORT_MAX_OPS    2       /*!< Operations of one pfnExec() call */
+#define SPI_NOR_PORT_DATA_SEGS  4       /*!< Data segments of one operation, each up to SPI_QSEG_MAX_LEN bytes */
+
+/*@}*/ /* end of group SPI_NOR_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup SPI_NOR_EXPORTED_STRUCTS SPI NOR Exported Structs
+  @{
+*/
+
+/**
+  * @details  Port state. Each operation is one transaction of the queue. The command, address and dummy bytes
+  *           are one segment in single SPI, and the data follows in chained segments, so a read of 64 KB runs
+  *           without CPU. The state must be in SRAM.
+  */
+typedef struct
+{
+    SPI_QUEUE_T *psQueue;
+    SPI_QDEV_T sDev;
+    SPI_QXFER_T asXfer[SPI_NOR_PORT_MAX_OPS];
+    SPI_QSEG_T asSeg[SPI_NOR_PORT_MAX_OPS][2 + SPI_NOR_PORT_DATA_SEGS];
+    uint8_t au8Hdr[SPI_NOR_PORT_MAX_OPS][1 + 4 + SPI_NOR_MAX_DUMMY];
+} SPI_NOR_PORT_T;
+
+/*@}*/ /* end of group SPI_NOR_EXPORTED_STRUCTS */
+
+
+/** @addtogroup SPI_NOR_EXPORTED_FUNCTIONS SPI NOR Exported Functions
+  @{
+*/
+
+uint32_t SpiNor_PortInit(SPI_NOR_T *psNor, SPI_NOR_PORT_T *psPort, SPI_QUEUE_T *psQueue, uint32_t u32BusClock,
+                         volatile uint32_t *pu32CsPin);
+
+/*@}*/ /* end of group SPI_NOR_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group SPI_NOR_Library */
+
+/*@}*/ /* end of group Library */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__SPI_NOR_PORT_H__
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
@@ -0,0 +1,848 @@
+/**************************************************************************//**
+ * @file     spi_nor.c
+ * @version  V1.00
+ * @brief    SPI NOR flash library source file
+ *
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <string.h>
+#include "spi_nor.h"
+
+/** @addtogroup Library Library
+  @{
+*/
+
+/** @addtogroup SPI_NOR_Library SPI NOR Library
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#define SFDP_SIGNATURE      0x50444653UL    /* "SFDP" */
+#define SFDP_BFPT_DWORDS    16              /* DWORDs of the JESD216B basic flash parameter table which are used */
+
+/* Fast reads of the SFDP basic table. The parameters are 16-bit halves of a DWORD: bits 4:0 are dummy clocks,
+   bits 7:5 are mode clocks and bits 15:8 are the command. */
+static const struct
+{
+    uint8_t u8Bus;
+    uint8_t u8Cap;          /* SPI_NOR_CAP_XXX which the port needs */
+    uint8_t u8SupportBit;   /* Bit of DWORD 1 */
+    uint8_t u8Dword;        /* DWORD of the parameters, 0-based */
+    uint8_t u8Shift;        /* 0 or 16 */
+} s_asReadModes[] =
+{
+    /* Fastest first */
+    {SPI_NOR_BUS_1_4_4, SPI_NOR_CAP_QUAD, 21, 2, 0},
+    {SPI_NOR_BUS_1_1_4, SPI_NOR_CAP_QUAD, 22, 2, 16},
+    {SPI_NOR_BUS_1_2_2, SPI_NOR_CAP_DUAL, 20, 3, 16},
+    {SPI_NOR_BUS_1_1_2, SPI_NOR_CAP_DUAL, 16, 3, 0},
+};
+
+/* Winbond W25Q read parameters, used when the flash has no SFDP table. They match the SFDP format. */
+static const uint32_t s_au32W25qRead[2] = {0x6B08EB44UL, 0xBB803B08UL};
+
+static const uint16_t s_au16EraseUnitMs[4] = {1, 16, 128, 1000};
+
+/* Typical erase times of the slowest common parts (W25Q..BV, MX25L..E, GD25Q), used when SFDP has no DWORD 10.
+   A plan from them may be longer than the real erase, but not shorter. */
+static const struct
+{
+    uint32_t u32Size;
+    uint16_t u16TimeMs;
+} s_asEraseTimes[] =
+{
+    {0x1000, 60},
+    {0x8000, 400},
+    {0x10000, 700},
+};
+
+/* Erase suspend and resume of flashes whose SFDP table has no DWORD 13. Macronix isn't listed: MX25L..E parts
+   can't suspend and share their JEDEC IDs with the newer parts, which report suspend in SFDP. */
+static const struct
+{
+    uint16_t u16Id;         /* Manufacturer and memory type, bits 23:8 of the JEDEC ID */
+    uint8_t u8SuspendCmd;
+    uint8_t u8ResumeCmd;
+} s_asSuspendCmds[] =
+{
+    {0xEF40, SPI_NOR_CMD_SUSPEND, SPI_NOR_CMD_RESUME},     /* Winbond W25Q..BV/FV/JV-IQ */
+    {0xEF70, SPI_NOR_CMD_SUSPEND, SPI_NOR_CMD_RESUME},     /* Winbond W25Q..JV-IM */
+};
+
+static int32_t SpiNor_Exec(SPI_NOR_T *psNor, SPI_NOR_OP_T *psOp, uint32_t u32Num)
+{
+    return (psNor->pfnExec(psNor->pvPort, psOp, u32Num) == 0) ? SPI_NOR_OK : SPI_NOR_ERR_DEVICE;
+}
+
+/* Initialize a single SPI operation */
+static void SpiNor_InitOp(SPI_NOR_OP_T *psOp, uint8_t u8Cmd, const uint8_t *pu8Tx, uint8_t *pu8Rx, uint32_t u32Len)
+{
+    memset(psOp, 0, sizeof(SPI_NOR_OP_T));
+    psOp->u8Cmd = u8Cmd;
+    psOp->u8Bus = SPI_NOR_BUS_1_1_1;
+    psOp->pu8Tx = pu8Tx;
+    psOp->pu8Rx = pu8Rx;
+    psOp->u32Len = u32Len;
+}
+
+/* Single SPI command without address */
+static int32_t SpiNor_Cmd(SPI_NOR_T *psNor, uint8_t u8Cmd, const uint8_t *pu8Tx, uint8_t *pu8Rx, uint32_t u32Len)
+{
+    SPI_NOR_OP_T sOp;
+
+    SpiNor_InitOp(&sOp, u8Cmd, pu8Tx, pu8Rx, u32Len);
+
+    return SpiNor_Exec(psNor, &sOp, 1);
+}
+
+/* Write enable and a command in one port call, so nothing waits between them */
+static int32_t SpiNor_ExecWrite(SPI_NOR_T *psNor, SPI_NOR_OP_T *psOp)
+{
+    SPI_NOR_OP_T asOp[2];
+
+    SpiNor_InitOp(&asOp[0], SPI_NOR_CMD_WREN, NULL, NULL, 0);
+    asOp[1] = *psOp;
+
+    return SpiNor_Exec(psNor, asOp, 2);
+}
+
+static int32_t SpiNor_WaitReady(SPI_NOR_T *psNor)
+{
+    uint8_t u8Sr;
+
+    while(1)
+    {
+        if(SpiNor_Cmd(psNor, SPI_NOR_CMD_RDSR, NULL, &u8Sr, 1) < 0)
+            return SPI_NOR_ERR_DEVICE;
+
+        if(!(u8Sr & SPI_NOR_SR_WIP))
+            return SPI_NOR_OK;
+
+        if(psNor->pfnYield)
+            psNor->pfnYield(psNor);
+    }
+}
+
+static int32_t SpiNor_ReadSfdp(SPI_NOR_T *psNor, uint32_t u32Addr, uint8_t *pu8Buf, uint32_t u32Len)
+{
+    SPI_NOR_OP_T sOp;
+
+    SpiNor_InitOp(&sOp, SPI_NOR_CMD_RDSFDP, NULL, pu8Buf, u32Len);
+    sOp.u8AddrLen = 3;
+    sOp.u8Dummy = 1;
+    sOp.u32Addr = u32Addr;
+
+    return SpiNor_Exec(psNor, &sOp, 1);
+}
+
+/* Read the basic flash parameter table. Returns its DWORDs, or 0 if the flash has no SFDP table. */
+static uint32_t SpiNor_ReadBfpt(SPI_NOR_T *psNor, uint32_t *pu32Dw)
+{
+    uint8_t au8Buf[SFDP_BFPT_DWORDS * 4];
+    uint32_t u32Num, i;
+
+    /* The first parameter header always points to the basic table */
+    if(SpiNor_ReadSfdp(psNor, 0, au8Buf, 16) < 0)
+        return 0;
+
+    if((au8Buf[0] | (au8Buf[1] << 8) | (au8Buf[2] << 16) | ((uint32_t)au8Buf[3] << 24)) != SFDP_SIGNATURE)
+        return 0;
+
+    if((au8Buf[8] != 0x00) || (au8Buf[15] != 0xFF) || (au8Buf[11] < 9))
+        return 0;
+
+    u32Num = (au8Buf[11] < SFDP_BFPT_DWORDS) ? au8Buf[11] : SFDP_BFPT_DWORDS;
+
+    if(SpiNor_ReadSfdp(psNor, au8Buf[12] | (au8Buf[13] << 8) | (au8Buf[14] << 16), au8Buf, u32Num * 4) < 0)
+        return 0;
+
+    for(i = 0; i < u32Num; i++)
+        pu32Dw[i] = au8Buf[i * 4] | (au8Buf[i * 4 + 1] << 8) | (au8Buf[i * 4 + 2] << 16) | ((uint32_t)au8Buf[i * 4 + 3] << 24);
+
+    return u32Num;
+}
+
+/* Set the quad enable bit of the status registers by the SFDP quad enable requirement */
+static int32_t SpiNor_EnableQuad(SPI_NOR_T *psNor)
+{
+    SPI_NOR_OP_T sOp;
+    uint8_t au8Sr[2], u8RdCmd, u8Bit;
+
+    switch(psNor->u8QeMethod)
+    {
+        case 0:     /* No QE bit */
+            return SPI_NOR_OK;
+
+        case 1:     /* Bit 1 of SR2, which can't be read. Written with SR1. */
+            if(SpiNor_Cmd(psNor, SPI_NOR_CMD_RDSR, NULL, &au8Sr[0], 1) < 0)
+                return SPI_NOR_ERR_DEVICE;
+
+            au8Sr[1] = 0x02;
+            SpiNor_InitOp(&sOp, SPI_NOR_CMD_WRSR, au8Sr, NULL, 2);
+            u8RdCmd = 0;
+            u8Bit = 0;
+            break;
+
+        case 2:     /* Bit 6 of SR1 */
+            if(SpiNor_Cmd(psNor, SPI_NOR_CMD_RDSR, NULL, &au8Sr[0], 1) < 0)
+                return SPI_NOR_ERR_DEVICE;
+
+            if(au8Sr[0] & 0x40)
+                return SPI_NOR_OK;
+
+            au8Sr[0] |= 0x40;
+            SpiNor_InitOp(&sOp, SPI_NOR_CMD_WRSR, au8Sr, NULL, 1);
+            u8RdCmd = SPI_NOR_CMD_RDSR;
+            u8Bit = 0x40;
+            break;
+
+        case 3:     /* Bit 7 of SR2, read by 0x3F and written by 0x3E */
+            if(SpiNor_Cmd(psNor, SPI_NOR_CMD_RDSR2_3F, NULL, &au8Sr[0], 1) < 0)
+                return SPI_NOR_ERR_DEVICE;
+
+            if(au8Sr[0] & 0x80)
+                return SPI_NOR_OK;
+
+            au8Sr[0] |= 0x80;
+            SpiNor_InitOp(&sOp, SPI_NOR_CMD_WRSR2_3E, au8Sr, NULL, 1);
+            u8RdCmd = SPI_NOR_CMD_RDSR2_3F;
+            u8Bit = 0x80;
+            break;
+
+        case 4:     /* Bit 1 of SR2, read by 0x35 and written with SR1 */
+        case 5:
+            if((SpiNor_Cmd(psNor, SPI_NOR_CMD_RDSR, NULL, &au8Sr[0], 1) < 0) ||
+                    (SpiNor_Cmd(psNor, SPI_NOR_CMD_RDSR2, NULL, &au8Sr[1], 1) < 0))
+                return SPI_NOR_ERR_DEVICE;
+
+            if(au8Sr[1] & 0x02)
+                return SPI_NOR_OK;
+
+            au8Sr[1] |= 0x02;
+            SpiNor_InitOp(&sOp, SPI_NOR_CMD_WRSR, au8Sr, NULL, 2);
+            u8RdCmd = SPI_NOR_CMD_RDSR2;
+            u8Bit = 0x02;
+            break;
+
+        case 6:     /* Bit 1 of SR2, read by 0x35 and written by 0x31 */
+            if(SpiNor_Cmd(psNor, SPI_NOR_CMD_RDSR2, NULL, &au8Sr[1], 1) < 0)
+                return SPI_NOR_ERR_DEVICE;
+
+            if(au8Sr[1] & 0x02)
+                return SPI_NOR_OK;
+
+            au8Sr[1] |= 0x02;
+            SpiNor_InitOp(&sOp, SPI_NOR_CMD_WRSR2, &au8Sr[1], NULL, 1);
+            u8RdCmd = SPI_NOR_CMD_RDSR2;
+            u8Bit = 0x02;
+            break;
+
+        default:    /* Unknown, so quad modes aren't used */
+            return SPI_NOR_ERR_DEVICE;
+    }
+
+    if((SpiNor_ExecWrite(psNor, &sOp) < 0) || (SpiNor_WaitReady(psNor) < 0))
+        return SPI_NOR_ERR_DEVICE;
+
+    /* Read back. A write protected status register keeps the old value. */
+    if(u8RdCmd)
+    {
+        if(SpiNor_Cmd(psNor, u8RdCmd, NULL, &au8Sr[0], 1) < 0)
+            return SPI_NOR_ERR_DEVICE;
+
+        if(!(au8Sr[0] & u8Bit))
+            return SPI_NOR_ERR_DEVICE;
+    }
+
+    return SPI_NOR_OK;
+}
+
+/* Pick the fastest read which the flash and the port support. Dummy clocks must fill whole bytes. */
+static void SpiNor_SelectRead(SPI_NOR_T *psNor, const uint32_t *pu32Dw, uint32_t u32Caps)
+{
+    uint32_t u32Param, u32Clocks, u32Lines, i;
+
+    psNor->u8ReadCmd = SPI_NOR_CMD_FAST_READ;
+    psNor->u8ReadBus = SPI_NOR_BUS_1_1_1;
+    psNor->u8ReadDummy = 1;
+
+    if(pu32Dw == NULL)
+        return;
+
+    for(i = 0; i < sizeof(s_asReadModes) / sizeof(s_asReadModes[0]); i++)
+    {
+        if(!(u32Caps & s_asReadModes[i].u8Cap) || !(pu32Dw[0] & (1UL << s_asReadModes[i].u8SupportBit)))
+            continue;
+
+        u32Param = (pu32Dw[s_asReadModes[i].u8Dword] >> s_asReadModes[i].u8Shift) & 0xFFFF;
+        u32Clocks = (u32Param & 0x1F) + ((u32Param >> 5) & 0x7);
+        u32Lines = SPI_NOR_ADDR_LINES(s_asReadModes[i].u8Bus);
+
+        if(((u32Clocks * u32Lines) % 8) || ((u32Clocks * u32Lines / 8) > SPI_NOR_MAX_DUMMY) || ((u32Param >> 8) == 0))
+            continue;
+
+        if((s_asReadModes[i].u8Cap == SPI_NOR_CAP_QUAD) && (SpiNor_EnableQuad(psNor) < 0))
+            continue;
+
+        psNor->u8ReadCmd = (uint8_t)(u32Param >> 8);
+        psNor->u8ReadBus = s_asReadModes[i].u8Bus;
+        psNor->u8ReadDummy = (uint8_t)(u32Clocks * u32Lines / 8);
+        return;
+    }
+}
+
+/* Sort the erase types and mark the ones which are faster than erasing their size with smaller types */
+static void SpiNor_SetEraseTypes(SPI_NOR_T *psNor)
+{
+    SPI_NOR_ERASE_TYPE_T sType;
+    uint32_t au32Cost[SPI_NOR_MAX_ERASE_TYPES], u32Sub, i, j;
+
+    for(i = 1; i < psNor->u32EraseNum; i++)
+    {
+        for(j = i; (j > 0) && (psNor->asErase[j - 1].u32Size > psNor->asErase[j].u32Size); j--)
+        {
+            sType = psNor->asErase[j];
+            psNor->asErase[j] = psNor->asErase[j - 1];
+            psNor->asErase[j - 1] = sType;
+        }
+    }
+
+    /* A size listed twice keeps the faster command */
+    for(i = 1; i < psNor->u32EraseNum;)
+    {
+        if(psNor->asErase[i].u32Size == psNor->asErase[i - 1].u32Size)
+        {
+            if(psNor->asErase[i].u32TimeMs < psNor->asErase[i - 1].u32TimeMs)
+                psNor->asErase[i - 1] = psNor->asErase[i];
+
+            for(j = i + 1; j < psNor->u32EraseNum; j++)
+                psNor->asErase[j - 1] = psNor->asErase[j];
+
+            psNor->u32EraseNum--;
+        }
+        else
+            i++;
+    }
+
+    /* au32Cost[i] is the least time to erase a block of asErase[i].u32Size */
+    for(i = 0; i < psNor->u32EraseNum; i++)
+    {
+        u32Sub = (i == 0) ? 0xFFFFFFFF : (psNor->asErase[i].u32Size / psNor->asErase[i - 1].u32Size) * au32Cost[i - 1];
+        psNor->asErase[i].u8Use = (psNor->asErase[i].u32TimeMs <= u32Sub);
+        au32Cost[i] = psNor->asErase[i].u8Use ? psNor->asErase[i].u32TimeMs : u32Sub;
+    }
+}
+
+/* Typical erase time when the flash doesn't report it. Sizes above the table scale from its last entry. */
+static uint32_t SpiNor_GuessEraseTime(uint32_t u32Size)
+{
+    uint32_t u32Last = sizeof(s_asEraseTimes) / sizeof(s_asEraseTimes[0]) - 1, i;
+
+    for(i = 0; i < u32Last; i++)
+    {
+        if(u32Size <= s_asEraseTimes[i].u32Size)
+            break;
+    }
+
+    if(u32Size <= s_asEraseTimes[i].u32Size)
+        return s_asEraseTimes[i].u16TimeMs;
+
+    return s_asEraseTimes[u32Last].u16TimeMs * (u32Size / s_asEraseTimes[u32Last].u32Size);
+}
+
+/* Suspend and resume commands by JEDEC ID. Both stay 0 for a flash which isn't in the table. */
+static void SpiNor_SetSuspendCmds(SPI_NOR_T *psNor)
+{
+    uint32_t i;
+
+    psNor->u8SuspendCmd = 0;
+    psNor->u8ResumeCmd = 0;
+
+    for(i = 0; i < sizeof(s_asSuspendCmds) / sizeof(s_asSuspendCmds[0]); i++)
+    {
+        if(s_asSuspendCmds[i].u16Id == (psNor->u32JedecId >> 8))
+        {
+            psNor->u8SuspendCmd = s_asSuspendCmds[i].u8SuspendCmd;
+            psNor->u8ResumeCmd = s_asSuspendCmds[i].u8ResumeCmd;
+        }
+    }
+}
+
+/* Read the device parameters from the basic flash parameter table */
+static void SpiNor_ParseBfpt(SPI_NOR_T *psNor, const uint32_t *pu32Dw, uint32_t u32Num)
+{
+    SPI_NOR_ERASE_TYPE_T *psType;
+    uint32_t u32Field, i;
+
+    if(pu32Dw[1] & 0x80000000UL)
+        psNor->u32Size = ((pu32Dw[1] & 0x7FFFFFFFUL) >= 34) ? 0x80000000UL : (1UL << ((pu32Dw[1] & 0x7FFFFFFFUL) - 3));
+    else
+        psNor->u32Size = (pu32Dw[1] >> 3) + 1;
+
+    psNor->u32EraseNum = 0;
+
+    for(i = 0; i < 4; i++)
+    {
+        u32Field = (pu32Dw[7 + i / 2] >> ((i % 2) * 16)) & 0xFFFF;
+
+        if(((u32Field & 0xFF) == 0) || ((u32Field & 0xFF) > 31))
+            continue;
+
+        psType = &psNor->asErase[psNor->u32EraseNum++];
+        psType->u32Size = 1UL << (u32Field & 0xFF);
+        psType->u8Cmd = (uint8_t)(u32Field >> 8);
+
+        if(u32Num >= 10)
+        {
+            u32Field = (pu32Dw[9] >> (4 + i * 7)) & 0x7F;
+            psType->u32TimeMs = ((u32Field & 0x1F) + 1) * s_au16EraseUnitMs[u32Field >> 5];
+        }
+        else
+            psType->u32TimeMs = SpiNor_GuessEraseTime(psType->u32Size);
+    }
+
+    if(u32Num >= 11)
+        psNor->u32PageSize = 1UL << ((pu32Dw[10] >> 4) & 0xF);
+
+    /* DWORD 12 bit 31 set means no suspend. DWORD 13 has the erase suspend and resume commands. */
+    if(u32Num >= 13)
+    {
+        if(pu32Dw[11] & 0x80000000UL)
+            psNor->u8SuspendCmd = 0;
+        else
+        {
+            psNor->u8SuspendCmd = (uint8_t)(pu32Dw[12] >> 24);
+            psNor->u8ResumeCmd = (uint8_t)(pu32Dw[12] >> 16);
+        }
+    }
+
+    if(u32Num >= 15)
+        psNor->u8QeMethod = (pu32Dw[14] >> 20) & 0x7;
+}
+
+/* Largest erase type which starts at u32Addr and fits before u32End */
+static SPI_NOR_ERASE_TYPE_T *SpiNor_NextErase(SPI_NOR_T *psNor, uint32_t u32Addr, uint32_t u32End)
+{
+    SPI_NOR_ERASE_TYPE_T *psType;
+    uint32_t i;
+
+    for(i = psNor->u32EraseNum; i-- > 0;)
+    {
+        psType = &psNor->asErase[i];
+
+        if(psType->u8Use && !(u32Addr & (psType->u32Size - 1)) && (u32End - u32Addr >= psType->u32Size))
+            return psType;
+    }
+
+    return NULL;
+}
+
+/* Start the next page program or block erase of the background operation */
+static int32_t SpiNor_Next(SPI_NOR_T *psNor)
+{
+    SPI_NOR_ERASE_TYPE_T *psType;
+    SPI_NOR_OP_T sOp;
+    uint32_t u32Len;
+
+    if(psNor->u32State == SPI_NOR_STATE_PROGRAM)
+    {
+        u32Len = psNor->u32PageSize - (psNor->u32Addr & (psNor->u32PageSize - 1));
+
+        if(u32Len > psNor->u32End - psNor->u32Addr)
+            u32Len = psNor->u32End - psNor->u32Addr;
+
+        SpiNor_InitOp(&sOp, SPI_NOR_CMD_PP, psNor->pu8Src, NULL, u32Len);
+        psNor->pu8Src += u32Len;
+    }
+    else
+    {
+        psType = SpiNor_NextErase(psNor, psNor->u32Addr, psNor->u32End);
+        SpiNor_InitOp(&sOp, psType->u8Cmd, NULL, NULL, 0);
+        u32Len = psType->u32Size;
+    }
+
+    sOp.u8AddrLen = psNor->u8AddrLen;
+    sOp.u32Addr = psNor->u32Addr;
+    psNor->u32Addr += u32Len;
+
+    if(SpiNor_ExecWrite(psNor, &sOp) < 0)
+    {
+        psNor->u32State = SPI_NOR_STATE_IDLE;
+        return SPI_NOR_ERR_DEVICE;
+    }
+
+    return 1;
+}
+
+static int32_t SpiNor_CheckRange(SPI_NOR_T *psNor, uint32_t u32Addr, uint32_t u32Len)
+{
+    if((u32Addr >= psNor->u32Size) || (u32Len > psNor->u32Size - u32Addr))
+        return SPI_NOR_ERR_PARAM;
+
+    return SPI_NOR_OK;
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup SPI_NOR_EXPORTED_FUNCTIONS SPI NOR Exported Functions
+  @{
+*/
+
+/**
+  * @brief      Find the flash parameters
+  * @param[in]  psNor       Flash with pfnExec, pfnYield, pvPort and u32MaxLen set by the port.
+  * @param[in]  u32Caps     Bus widths which the port supports, SPI_NOR_CAP_DUAL | SPI_NOR_CAP_QUAD or 0.
+  * @retval     SPI_NOR_OK          The flash is ready.
+  * @retval     SPI_NOR_ERR_DEVICE  No flash answered the JEDEC ID command.
+  * @details    The size, page size, erase types, fastest read and suspend commands come from the SFDP basic
+  *             flash parameter table. The quad enable bit is set if a quad read is selected. A flash larger than
+  *             16 MB enters 4-byte address mode if it can.
+  *             Without SFDP, Winbond W25Q commands are assumed for manufacturer ID 0xEF, and other flashes get
+  *             single SPI fast read with 4 KB and 64 KB erases.
+  *             Suspend is only used if SFDP DWORD 13 or the JEDEC ID table of the library names its commands.
+  *             Erase times which SFDP doesn't report are conservative typical values.
+  */
+int32_t SpiNor_Open(SPI_NOR_T *psNor, uint32_t u32Caps)
+{
+    uint32_t au32Dw[SFDP_BFPT_DWORDS], u32Num;
+    uint8_t au8Id[3];
+
+    psNor->u32State = SPI_NOR_STATE_IDLE;
+    psNor->u32SuspendCnt = 0;
+
+    if(SpiNor_Cmd(psNor, SPI_NOR_CMD_RDID, NULL, au8Id, 3) < 0)
+        return SPI_NOR_ERR_DEVICE;
+
+    psNor->u32JedecId = (au8Id[0] << 16) | (au8Id[1] << 8) | au8Id[2];
+
+    if((psNor->u32JedecId == 0) || (psNor->u32JedecId == 0xFFFFFF))
+        return SPI_NOR_ERR_DEVICE;
+
+    /* Defaults of the fields which old SFDP revisions don't have */
+    psNor->u32Size = ((au8Id[2] >= 16) && (au8Id[2] <= 31)) ? (1UL << au8Id[2]) : 0x200000;
+    psNor->u32PageSize = 256;
+    psNor->u8AddrLen = 3;
+    psNor->u8QeMethod = (au8Id[0] == 0xEF) ? 4 : ((au8Id[0] == 0xC2) ? 2 : 7);
+    SpiNor_SetSuspendCmds(psNor);
+    psNor->u32EraseNum = 2;
+    psNor->asErase[0].u32Size = 0x1000;
+    psNor->asErase[0].u8Cmd = SPI_NOR_CMD_SE_4K;
+    psNor->asErase[0].u32TimeMs = SpiNor_GuessEraseTime(0x1000);
+    psNor->asErase[1].u32Size = 0x10000;
+    psNor->asErase[1].u8Cmd = SPI_NOR_CMD_BE_64K;
+    psNor->asErase[1].u32TimeMs = SpiNor_GuessEraseTime(0x10000);
+
+    u32Num = SpiNor_ReadBfpt(psNor, au32Dw);
+    psNor->u8Sfdp = (u32Num != 0);
+
+    if(u32Num)
+    {
+        SpiNor_ParseBfpt(psNor, au32Dw, u32Num);
+
+        /* 4-byte address mode */
+        if(((au32Dw[0] >> 17) & 0x3) == 2)
+            psNor->u8AddrLen = 4;
+        else if(psNor->u32Size > 0x1000000)
+        {
+            if((((au32Dw[0] >> 17) & 0x3) == 1) && (u32Num >= 16) && (au32Dw[15] & (1UL << 24)) &&
+                    (SpiNor_Cmd(psNor, SPI_NOR_CMD_EN4B, NULL, NULL, 0) == 0))
+                psNor->u8AddrLen = 4;
+            else
+                psNor->u32Size = 0x1000000;
+        }
+
+        SpiNor_SelectRead(psNor, au32Dw, u32Caps);
+    }
+    else if(au8Id[0] == 0xEF)
+    {
+        au32Dw[0] = (1UL << 16) | (1UL << 20) | (1UL << 21) | (1UL << 22);
+        au32Dw[2] = s_au32W25qRead[0];
+        au32Dw[3] = s_au32W25qRead[1];
+        SpiNor_SelectRead(psNor, au32Dw, u32Caps);
+    }
+    else
+        SpiNor_SelectRead(psNor, NULL, 0);
+
+    SpiNor_SetEraseTypes(psNor);
+
+    return (psNor->u32EraseNum && psNor->u32PageSize) ? SPI_NOR_OK : SPI_NOR_ERR_DEVICE;
+}
+
+/**
+  * @brief      Read data
+  * @param[in]  psNor       Flash.
+  * @param[in]  u32Addr     Flash address.
+  * @param[out] pu8Buf      Buffer of the data.
+  * @param[in]  u32Len      Bytes to read.
+  * @retval     SPI_NOR_OK          Read is done.
+  * @retval     SPI_NOR_ERR_PARAM   The range is outside the flash.
+  * @retval     SPI_NOR_ERR_DEVICE  The port failed.
+  * @details    The selected fast read is used. A running background program or erase is suspended for the read
+  *             and resumed after it, so the read doesn't wait for the program or erase. Data of the page or block
+  *             being programmed or erased is undefined. If the flash can't suspend, the read waits.
+  */
+int32_t SpiNor_Read(SPI_NOR_T *psNor, uint32_t u32Addr, uint8_t *pu8Buf, uint32_t u32Len)
+{
+    SPI_NOR_OP_T sOp;
+    uint32_t u32Suspended = 0, u32Chunk;
+    uint8_t u8Sr;
+    int32_t i32Ret = SPI_NOR_OK;
+
+    if(SpiNor_CheckRange(psNor, u32Addr, u32Len) < 0)
+        return SPI_NOR_ERR_PARAM;
+
+    if(psNor->u32State != SPI_NOR_STATE_IDLE)
+    {
+        if(psNor->u8SuspendCmd == 0)
+        {
+            if(SpiNor_Sync(psNor) < 0)
+                return SPI_NOR_ERR_DEVICE;
+        }
+        else
+        {
+            if(SpiNor_Cmd(psNor, SPI_NOR_CMD_RDSR, NULL, &u8Sr, 1) < 0)
+                return SPI_NOR_ERR_DEVICE;
+
+            /* The flash clears WIP when it is suspended */
+            if(u8Sr & SPI_NOR_SR_WIP)
+            {
+                if((SpiNor_Cmd(psNor, psNor->u8SuspendCmd, NULL, NULL, 0) < 0) || (SpiNor_WaitReady(psNor) < 0))
+                    return SPI_NOR_ERR_DEVICE;
+
+                u32Suspended = 1;
+                psNor->u32SuspendCnt++;
+            }
+        }
+    }
+
+    SpiNor_InitOp(&sOp, psNor->u8ReadCmd, NULL, NULL, 0);
+    sOp.u8Bus = psNor->u8ReadBus;
+    sOp.u8AddrLen = psNor->u8AddrLen;
+    sOp.u8Dummy = psNor->u8ReadDummy;
+
+    while(u32Len)
+    {
+        u32Chunk = (psNor->u32MaxLen && (u32Len > psNor->u32MaxLen)) ? psNor->u32MaxLen : u32Len;
+        sOp.u32Addr = u32Addr;
+        sOp.pu8Rx = pu8Buf;
+        sOp.u32Len = u32Chunk;
+
+        if(SpiNor_Exec(psNor, &sOp, 1) < 0)
+        {
+            i32Ret = SPI_NOR_ERR_DEVICE;
+            break;
+        }
+
+        u32Addr += u32Chunk;
+        pu8Buf += u32Chunk;
+        u32Len -= u32Chunk;
+    }
+
+    if(u32Suspended && (SpiNor_Cmd(psNor, psNor->u8ResumeCmd, NULL, NULL, 0) < 0))
+        i32Ret = SPI_NOR_ERR_DEVICE;
+
+    return i32Ret;
+}
+
+/**
+  * @brief      Start to program data in the background
+  * @param[in]  psNor       Flash.
+  * @param[in]  u32Addr     Flash address. It needn't be page aligned.
+  * @param[in]  pu8Data     Data. It must stay valid until the program is done.
+  * @param[in]  u32Len      Bytes to program.
+  * @retval     SPI_NOR_OK          The first page is being programmed.
+  * @retval     SPI_NOR_ERR_PARAM   The range is outside the flash.
+  * @retval     SPI_NOR_ERR_BUSY    A program or erase is running.
+  * @retval     SPI_NOR_ERR_DEVICE  The port failed.
+  * @details    The data is split on page boundaries. SpiNor_Poll() starts each next page as soon as the flash
+  *             is ready, with the write enable and the page program sent back to back.
+  *             The flash must be erased before.
+  */
+int32_t SpiNor_WriteStart(SPI_NOR_T *psNor, uint32_t u32Addr, const uint8_t *pu8Data, uint32_t u32Len)
+{
+    if(psNor->u32State != SPI_NOR_STATE_IDLE)
+        return SPI_NOR_ERR_BUSY;
+
+    if(SpiNor_CheckRange(psNor, u32Addr, u32Len) < 0)
+        return SPI_NOR_ERR_PARAM;
+
+    if(u32Len == 0)
+        return SPI_NOR_OK;
+
+    psNor->u32State = SPI_NOR_STATE_PROGRAM;
+    psNor->u32Addr = u32Addr;
+    psNor->u32End = u32Addr + u32Len;
+    psNor->pu8Src = pu8Data;
+
+    return (SpiNor_Next(psNor) < 0) ? SPI_NOR_ERR_DEVICE : SPI_NOR_OK;
+}
+
+/**
+  * @brief      Program data
+  * @param[in]  psNor       Flash.
+  * @param[in]  u32Addr     Flash address. It needn't be page aligned.
+  * @param[in]  pu8Data     Data.
+  * @param[in]  u32Len      Bytes to program.
+  * @return     Same as SpiNor_WriteStart()
+  * @details    It returns when the last page is programmed. pfnYield is called while the flash is busy.
+  */
+int32_t SpiNor_Write(SPI_NOR_T *psNor, uint32_t u32Addr, const uint8_t *pu8Data, uint32_t u32Len)
+{
+    int32_t i32Ret = SpiNor_WriteStart(psNor, u32Addr, pu8Data, u32Len);
+
+    return (i32Ret < 0) ? i32Ret : SpiNor_Sync(psNor);
+}
+
+/**
+  * @brief      Plan the erases of a range
+  * @param[in]  psNor       Flash.
+  * @param[in]  u32Addr     Flash address, aligned to the smallest erase size.
+  * @param[in]  u32Len      Bytes to erase, a multiple of the smallest erase size.
+  * @param[out] psStep      Erase steps in address order, or NULL to only count them.
+  * @param[in]  u32MaxSteps Size of psStep. Steps after it aren't stored.
+  * @param[out] pu32TimeMs  Total typical erase time, or NULL.
+  * @return     Number of steps, or SPI_NOR_ERR_PARAM if the range is invalid.
+  * @details    Each step is the largest block which starts aligned and fits the rest of the range. A block size
+  *             is skipped if the flash erases it slower than its smaller blocks, so the plan has the least
+  *             typical time of all plans. SpiNor_EraseStart() erases the same steps.
+  */
+int32_t SpiNor_PlanErase(SPI_NOR_T *psNor, uint32_t u32Addr, uint32_t u32Len, SPI_NOR_ERASE_STEP_T *psStep,
+                         uint32_t u32MaxSteps, uint32_t *pu32TimeMs)
+{
+    SPI_NOR_ERASE_TYPE_T *psType;
+    uint32_t u32End = u32Addr + u32Len, u32Time = 0, u32Num = 0;
+
+    if((SpiNor_CheckRange(psNor, u32Addr, u32Len) < 0) || ((u32Addr | u32Len) & (psNor->asErase[0].u32Size - 1)))
+        return SPI_NOR_ERR_PARAM;
+
+    while(u32Addr < u32End)
+    {
+        psType = SpiNor_NextErase(psNor, u32Addr, u32End);
+
+        if(psStep && (u32Num < u32MaxSteps))
+        {
+            psStep[u32Num].u32Addr = u32Addr;
+            psStep[u32Num].u32Size = psType->u32Size;
+            psStep[u32Num].u8Cmd = psType->u8Cmd;
+        }
+
+        u32Num++;
+        u32Time += psType->u32TimeMs;
+        u32Addr += psType->u32Size;
+    }
+
+    if(pu32TimeMs)
+        *pu32TimeMs = u32Time;
+
+    return (int32_t)u32Num;
+}
+
+/**
+  * @brief      Start to erase a range in the background
+  * @param[in]  psNor       Flash.
+  * @param[in]  u32Addr     Flash address, aligned to the smallest erase size.
+  * @param[in]  u32Len      Bytes to erase, a multiple of the smallest erase size.
+  * @retval     SPI_NOR_OK          The first block is being erased.
+  * @retval     SPI_NOR_ERR_PARAM   The range is invalid.
+  * @retval     SPI_NOR_ERR_BUSY    A program or erase is running.
+  * @retval     SPI_NOR_ERR_DEVICE  The port failed.
+  * @details    The blocks of SpiNor_PlanErase() are erased one by one by SpiNor_Poll().
+  */
+int32_t SpiNor_EraseStart(SPI_NOR_T *psNor, uint32_t u32Addr, uint32_t u32Len)
+{
+    if(psNor->u32State != SPI_NOR_STATE_IDLE)
+        return SPI_NOR_ERR_BUSY;
+
+    if(SpiNor_PlanErase(psNor, u32Addr, u32Len, NULL, 0, NULL) < 0)
+        return SPI_NOR_ERR_PARAM;
+
+    if(u32Len == 0)
+        return SPI_NOR_OK;
+
+    psNor->u32State = SPI_NOR_STATE_ERASE;
+    psNor->u32Addr = u32Addr;
+    psNor->u32End = u32Addr + u32Len;
+
+    return (SpiNor_Next(psNor) < 0) ? SPI_NOR_ERR_DEVICE : SPI_NOR_OK;
+}
+
+/**
+  * @brief      Erase a range
+  * @param[in]  psNor       Flash.
+  * @param[in]  u32Addr     Flash address, aligned to the smallest erase size.
+  * @param[in]  u32Len      Bytes to erase, a multiple of the smallest erase size.
+  * @return     Same as SpiNor_EraseStart()
+  * @details    It returns when the last block is erased. pfnYield is called while the flash is busy.
+  */
+int32_t SpiNor_Erase(SPI_NOR_T *psNor, uint32_t u32Addr, uint32_t u32Len)
+{
+    int32_t i32Ret = SpiNor_EraseStart(psNor, u32Addr, u32Len);
+
+    return (i32Ret < 0) ? i32Ret : SpiNor_Sync(psNor);
+}
+
+/**
+  * @brief      Advance the background program or erase
+  * @param[in]  psNor       Flash.
+  * @retval     1                   The flash is busy.
+  * @retval     SPI_NOR_OK          Nothing is running.
+  * @retval     SPI_NOR_ERR_DEVICE  The port failed. The operation is abandoned.
+  * @details    It reads the status register once. If the flash is ready, the next page or block is started.
+  *             Call it from the main loop or a timer to keep the flash busy without waiting for it.
+  */
+int32_t SpiNor_Poll(SPI_NOR_T *psNor)
+{
+    uint8_t u8Sr;
+
+    if(psNor->u32State == SPI_NOR_STATE_IDLE)
+        return SPI_NOR_OK;
+
+    if(SpiNor_Cmd(psNor, SPI_NOR_CMD_RDSR, NULL, &u8Sr, 1) < 0)
+    {
+        psNor->u32State = SPI_NOR_STATE_IDLE;
+        return SPI_NOR_ERR_DEVICE;
+    }
+
+    if(u8Sr & SPI_NOR_SR_WIP)
+        return 1;
+
+    if(psNor->u32Addr == psNor->u32End)
+    {
+        psNor->u32State = SPI_NOR_STATE_IDLE;
+        return SPI_NOR_OK;
+    }
+
+    return SpiNor_Next(psNor);
+}
+
+/**
+  * @brief      Wait for the background program or erase
+  * @param[in]  psNor       Flash.
+  * @retval     SPI_NOR_OK          Nothing is running.
+  * @retval     SPI_NOR_ERR_DEVICE  The port failed.
+  * @details    pfnYield is called while the flash is busy.
+  */
+int32_t SpiNor_Sync(SPI_NOR_T *psNor)
+{
+    int32_t i32Ret;
+
+    while((i32Ret = SpiNor_Poll(psNor)) > 0)
+    {
+        if(psNor->pfnYield)
+            psNor->pfnYield(psNor);
+    }
+
+    return i32Ret;
+}
+
+/*@}*/ /* end of group SPI_NOR_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group SPI_NOR_Library */
+
+/*@}*/ /* end of group Library */
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
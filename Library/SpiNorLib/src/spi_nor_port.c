@@ -0,0 +1,152 @@
+/**************************************************************************//**
+ * @file     spi_nor_port.c
+ * @version  V1.00
+ * @brief    SPI NOR flash library port of the M451 SPI transaction queue
+ *
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include "spi_nor_port.h"
+
+/** @addtogroup Library Library
+  @{
+*/
+
+/** @addtogroup SPI_NOR_Library SPI NOR Library
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+/* Segment mode of a phase on u32Lines data lines */
+static uint32_t SpiNor_PortMode(uint32_t u32Lines, uint32_t u32Out)
+{
+    if(u32Lines == 4)
+        return u32Out ? SPI_QSEG_QUAD_OUT : SPI_QSEG_QUAD_IN;
+    else if(u32Lines == 2)
+        return u32Out ? SPI_QSEG_DUAL_OUT : SPI_QSEG_DUAL_IN;
+    else
+        return SPI_QSEG_SINGLE;
+}
+
+/* SPI_NOR_T.pfnExec. All operations are queued at once and the CPU sleeps until the last one is done. */
+static int32_t SpiNor_PortExec(void *pvPort, const SPI_NOR_OP_T *psOp, uint32_t u32Num)
+{
+    SPI_NOR_PORT_T *psPort = (SPI_NOR_PORT_T *)pvPort;
+    SPI_QXFER_T *psXfer;
+    SPI_QSEG_T *psSeg;
+    uint8_t *pu8Hdr;
+    uint32_t u32Lines, u32Seg, u32Pos, u32Len, u32Chunk, i, j;
+
+    if((u32Num == 0) || (u32Num > SPI_NOR_PORT_MAX_OPS))
+        return -1;
+
+    for(i = 0; i < u32Num; i++, psOp++)
+    {
+        psSeg = psPort->asSeg[i];
+        pu8Hdr = psPort->au8Hdr[i];
+        u32Lines = SPI_NOR_ADDR_LINES(psOp->u8Bus);
+
+        if((psOp->u8AddrLen > 4) || (psOp->u8Dummy > SPI_NOR_MAX_DUMMY))
+            return -1;
+
+        /* Command in single SPI. Address and dummy bytes join it if they are in single SPI too. */
+        pu8Hdr[0] = psOp->u8Cmd;
+        psSeg[0].pu8Tx = pu8Hdr;
+        psSeg[0].pu8Rx = NULL;
+        psSeg[0].u32Len = 1;
+        psSeg[0].u32Mode = SPI_QSEG_SINGLE;
+        u32Seg = 0;
+        u32Pos = 1;
+
+        if((psOp->u8AddrLen + psOp->u8Dummy) && (u32Lines != 1))
+        {
+            u32Seg = 1;
+            psSeg[1].pu8Tx = &pu8Hdr[1];
+            psSeg[1].pu8Rx = NULL;
+            psSeg[1].u32Mode = SpiNor_PortMode(u32Lines, 1);
+        }
+
+        for(j = psOp->u8AddrLen; j > 0; j--)
+            pu8Hdr[u32Pos++] = (uint8_t)(psOp->u32Addr >> ((j - 1) * 8));
+
+        for(j = 0; j < psOp->u8Dummy; j++)
+            pu8Hdr[u32Pos++] = 0xFF;
+
+        if(u32Seg == 0)
+            psSeg[0].u32Len = u32Pos;
+        else
+            psSeg[1].u32Len = u32Pos - 1;
+
+        /* Data in segments of SPI_QSEG_MAX_LEN bytes. They are chained without CPU. */
+        u32Lines = SPI_NOR_DATA_LINES(psOp->u8Bus);
+
+        for(u32Len = 0; u32Len < psOp->u32Len; u32Len += u32Chunk)
+        {
+            if(++u32Seg >= 2 + SPI_NOR_PORT_DATA_SEGS)
+                return -1;
+
+            u32Chunk = psOp->u32Len - u32Len;
+
+            if(u32Chunk > SPI_QSEG_MAX_LEN)
+                u32Chunk = SPI_QSEG_MAX_LEN;
+
+            psSeg[u32Seg].pu8Tx = psOp->pu8Tx ? &psOp->pu8Tx[u32Len] : NULL;
+            psSeg[u32Seg].pu8Rx = psOp->pu8Rx ? &psOp->pu8Rx[u32Len] : NULL;
+            psSeg[u32Seg].u32Len = u32Chunk;
+            psSeg[u32Seg].u32Mode = SpiNor_PortMode(u32Lines, psOp->pu8Rx == NULL);
+        }
+
+        psXfer = &psPort->asXfer[i];
+        psXfer->psDev = &psPort->sDev;
+        psXfer->psSeg = psSeg;
+        psXfer->u32SegNum = u32Seg + 1;
+        psXfer->pfnDone = NULL;
+
+        /* Transactions run in order, so waiting for the last one waits for all */
+        if(((i == u32Num - 1) ? SPI_QueueTransfer(psPort->psQueue, psXfer) : SPI_QueueSubmit(psPort->psQueue, psXfer)) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup SPI_NOR_EXPORTED_FUNCTIONS SPI NOR Exported Functions
+  @{
+*/
+
+/**
+  * @brief      Connect a flash to an SPI transaction queue
+  * @param[out] psNor       Flash. SpiNor_Open() must be called after it.
+  * @param[out] psPort      Port state in SRAM.
+  * @param[in]  psQueue     Queue opened by SPI_QueueOpen().
+  * @param[in]  u32BusClock The expected frequency of SPI bus clock in Hz.
+  * @param[in]  pu32CsPin   GPIO bit of the chip select like &PA3, or NULL if the SS pin of the port is used.
+  * @return     Actual frequency of SPI bus clock.
+  * @details    The flash runs in SPI mode 0 with an active low chip select. pfnYield is set to NULL, so the
+  *             CPU sleeps in the queue between status reads. Dual and quad modes need the data pins of the
+  *             port, like SPI0_MOSI1 and SPI0_MISO1 for quad.
+  */
+uint32_t SpiNor_PortInit(SPI_NOR_T *psNor, SPI_NOR_PORT_T *psPort, SPI_QUEUE_T *psQueue, uint32_t u32BusClock,
+                         volatile uint32_t *pu32CsPin)
+{
+    psPort->psQueue = psQueue;
+    psNor->pfnExec = SpiNor_PortExec;
+    psNor->pfnYield = NULL;
+    psNor->pvPort = psPort;
+    psNor->u32MaxLen = SPI_NOR_PORT_DATA_SEGS * SPI_QSEG_MAX_LEN;
+
+    return SPI_QueueInitDev(&psPort->sDev, psQueue, SPI_MODE_0, u32BusClock, pu32CsPin, SPI_SS_ACTIVE_LOW);
+}
+
+/*@}*/ /* end of group SPI_NOR_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group SPI_NOR_Library */
+
+/*@}*/ /* end of group Library */
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
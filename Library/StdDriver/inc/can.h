@@ -80,6 +80,47 @@ typedef struct
 
 #define MSG(id)  (id)
 
+/*---------------------------------------------------------------------------------------------------------*/
+/*  CAN message queue. Received frames are moved from a FIFO of message objects to a ring in the CAN       */
+/*  interrupt, and frames to send wait in a priority queue until a transmit object is free.                */
+/*---------------------------------------------------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t  u32Key;                   /*!< Private. Arbitration field, the lowest is sent first */
+    uint32_t  u32Seq;                   /*!< Private. Submission order */
+    uint32_t  u32Time;                  /*!< Time stamp of CAN_QueueSend(). See CAN_QueueSetTxHook() */
+    STR_CANMSG_T sMsg;
+} CAN_QTX_T;
+
+typedef struct CAN_QUEUE
+{
+    CAN_T     *tCAN;
+    uint32_t  u32RxObj;                 /*!< First message object of the receive FIFO */
+    uint32_t  u32RxNum;
+    uint32_t  u32RxMask;                /*!< Private */
+    STR_CANMSG_T *psRxBuf;              /*!< Ring of u32RxSize frames */
+    uint32_t  u32RxSize;                /*!< Power of 2 */
+    volatile uint32_t u32RxHead;        /*!< Private. Written in the CAN interrupt */
+    volatile uint32_t u32RxTail;        /*!< Private */
+    uint32_t  u32TxObj;                 /*!< First transmit message object */
+    uint32_t  u32TxNum;
+    uint32_t  u32TxMask;                /*!< Private */
+    CAN_QTX_T *psTxHeap;                /*!< Heap of u32TxSize queued frames */
+    uint32_t  u32TxSize;
+    volatile uint32_t u32TxCnt;         /*!< Frames in the heap */
+    uint32_t  u32TxNext;                /*!< Private. Next transmit object to load */
+    uint32_t  u32TxSeq;                 /*!< Private */
+    uint32_t  u32TxLoaded;              /*!< Private. Transmit objects not reported yet */
+    uint32_t  (*pfnGetTime)(void);      /*!< Private */
+    void      (*pfnTxDone)(struct CAN_QUEUE *psQueue, CAN_QTX_T *psEntry);  /*!< Private */
+    CAN_QTX_T *psTxObj;                 /*!< Private */
+    volatile uint32_t u32RxOverrun;     /*!< Frames dropped because the ring was full */
+    volatile uint32_t u32RxLost;        /*!< Frames overwritten in the last FIFO object before they were read */
+    volatile uint32_t u32BusOff;        /*!< Bus-off events */
+    volatile uint32_t u32BusFrames;     /*!< Frames on the bus, sent or received, accepted or not */
+    volatile uint32_t u32ErrFrames;     /*!< Bus errors, each followed by an error frame */
+} CAN_QUEUE_T;
+
 
 /*@}*/ /* end of group CAN_EXPORTED_CONSTANTS */
 
@@ -164,6 +205,15 @@ int32_t CAN_SetRxMsg(CAN_T *tCAN, uint32_t u32MsgNum , uint32_t u32IDType, uint3
 int32_t CAN_SetRxMsgAndMsk(CAN_T *tCAN, uint32_t u32MsgNum , uint32_t u32IDType, uint32_t u32ID, uint32_t u32IDMask);
 int32_t CAN_SetTxMsg(CAN_T *tCAN, uint32_t u32MsgNum , STR_CANMSG_T* pCanMsg);
 int32_t CAN_TriggerTxMsg(CAN_T  *tCAN, uint32_t u32MsgNum);
+int32_t CAN_SetMultiRxMsgAndMsk(CAN_T *tCAN, uint32_t u32MsgNum , uint32_t u32MsgCount, uint32_t u32IDType, uint32_t u32ID, uint32_t u32IDMask);
+void CAN_QueueOpen(CAN_QUEUE_T *psQueue, CAN_T *tCAN, uint32_t u32RxObj, uint32_t u32RxNum, STR_CANMSG_T *psRxBuf,
+                   uint32_t u32RxSize, uint32_t u32TxObj, uint32_t u32TxNum, CAN_QTX_T *psTxHeap, uint32_t u32TxSize);
+void CAN_QueueSetTxHook(CAN_QUEUE_T *psQueue, uint32_t (*pfnGetTime)(void),
+                        void (*pfnTxDone)(CAN_QUEUE_T *psQueue, CAN_QTX_T *psEntry), CAN_QTX_T *psTxObj);
+int32_t CAN_QueueSend(CAN_QUEUE_T *psQueue, STR_CANMSG_T *pCanMsg);
+int32_t CAN_QueueReceive(CAN_QUEUE_T *psQueue, STR_CANMSG_T *pCanMsg);
+uint32_t CAN_QueueGetTxCount(CAN_QUEUE_T *psQueue);
+uint32_t CAN_QueueIRQHandler(CAN_QUEUE_T *psQueue);
 
 
 /*@}*/ /* end of group CAN_EXPORTED_FUNCTIONS */
@@ -0,0 +1,95 @@
+/******************************************************************************
+ * @file     dlog.h
+ * @version  V3.00
+ * @brief    M451 series deferred debug log header file
+ *
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __DLOG_H__
+#define __DLOG_H__
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup DLOG_Driver DLOG Driver
+  @{
+*/
+
+/** @addtogroup DLOG_EXPORTED_CONSTANTS DLOG Exported Constants
+  @{
+*/
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Record format. All fields are 32-bit little endian words.                                               */
+/*   [0] DLOG_SYNC | argument number << 8 | dropped record count << 16                                      */
+/*   [1] Address of the format string in flash                                                             */
+/*   [2] DWT cycle counter when DLOG() was called                                                          */
+/*   [3] ... Arguments                                                                                     */
+/*---------------------------------------------------------------------------------------------------------*/
+#define DLOG_SYNC           0xA5UL      /*!< First byte of a record. It never appears in printf text. */
+#define DLOG_HDR_WORDS      3UL         /*!< Words in front of the arguments */
+#define DLOG_MAX_ARGS       8UL         /*!< Maximum arguments of one DLOG() call */
+
+/*@}*/ /* end of group DLOG_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup DLOG_EXPORTED_FUNCTIONS DLOG Exported Functions
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+#define DLOG_NARG(...)      DLOG_NARG_(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0, 0)
+#define DLOG_NARG_(f, a1, a2, a3, a4, a5, a6, a7, a8, n, ...)  n
+/// @endcond HIDDEN_SYMBOLS
+
+/**
+ *    @brief        Log a message without formatting it
+ *
+ *    @param[in]    ...     A printf format string literal followed by up to 8 arguments
+ *
+ *    @return       None
+ *
+ *    @details      This macro stores the address of the format string and the raw arguments in the log ring and
+ *                  returns. The record is sent by DLOG_Process() and formatted on the PC by dlog_dec.
+ *                  It can be called from any interrupt level.
+ *                  Every argument is stored as one 32-bit word, so 64-bit integers, float and double are not supported.
+ *                  %s is only decoded for strings in flash.
+ *                  Define DLOG_USE_PRINTF to send the messages with printf instead.
+ */
+#ifdef DLOG_USE_PRINTF
+#define DLOG                printf
+#else
+#define DLOG(...)           DLOG_Put(DLOG_NARG(__VA_ARGS__), __VA_ARGS__)
+#endif
+
+int32_t DLOG_Open(uint32_t *pu32Buf, uint32_t u32Words);
+void DLOG_Close(void);
+void DLOG_Put(uint32_t u32Num, const char *pcFmt, ...);
+uint32_t DLOG_Process(void);
+void DLOG_Flush(void);
+uint32_t DLOG_GetDropCount(void);
+
+
+/*@}*/ /* end of group DLOG_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group DLOG_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__DLOG_H__
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
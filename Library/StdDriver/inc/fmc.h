@@ -52,6 +52,7 @@ extern "C"
 
 #define FMC_FLASH_PAGE_SIZE     0x800           /*!< Flash Page Size (2048 Bytes) */
 #define FMC_LDROM_SIZE          0x1000          /*!< LDROM Size (4 kBytes)       */
+#define FMC_MULTI_WORD_PROG_LEN 256             /*!< The maximum length of a multi-word program (FMC_Write256) */
 
 /*---------------------------------------------------------------------------------------------------------*/
 /*  ISPCTL constant definitions                                                                            */
@@ -798,6 +799,8 @@ void FMC_EnableLDUpdate(void);
 void FMC_DisableLDUpdate(void);
 int32_t FMC_ReadConfig(uint32_t *u32Config, uint32_t u32Count);
 int32_t FMC_WriteConfig(uint32_t *u32Config, uint32_t u32Count);
+int32_t FMC_WriteMultiple(uint32_t u32Addr, uint32_t *pu32Buf, uint32_t u32Len);
+int32_t FMC_UpdatePage(uint32_t u32PageAddr, uint32_t *pu32Buf);
 void FMC_SetBootSource(int32_t i32BootSrc);
 int32_t FMC_GetBootSource(void);
 uint32_t FMC_ReadDataFlashBaseAddr(void);
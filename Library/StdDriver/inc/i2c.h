@@ -68,8 +68,60 @@ extern "C"
 #define I2C_ERR_FAIL    (-1L)            /*!< I2C operation failed                                                        */
 #define I2C_ERR_TIMEOUT (-2L)            /*!< I2C operation abort due to timeout error                                    */
 
+/*---------------------------------------------------------------------------------------------------------*/
+/* I2C message queue constant definitions.                                                                 */
+/*---------------------------------------------------------------------------------------------------------*/
+#define I2C_QMSG_WR         0x00         /*!< Message writes to the slave                                                 */
+#define I2C_QMSG_RD         0x01         /*!< Message reads from the slave                                                */
+
+#define I2C_QXFER_DONE      ( 0L)        /*!< Transaction is finished                                                     */
+#define I2C_QXFER_QUEUED    ( 1L)        /*!< Transaction waits in the queue                                              */
+#define I2C_QXFER_BUSY      ( 2L)        /*!< Transaction is on the bus                                                   */
+#define I2C_QXFER_NACK      (-1L)        /*!< Slave address or data is not acknowledged                                   */
+#define I2C_QXFER_BUS_ERR   (-2L)        /*!< Bus error or arbitration lost                                               */
+#define I2C_QXFER_TIMEOUT   (-3L)        /*!< Bus time-out. See I2C_EnableTimeout()                                       */
+
 /*@}*/ /* end of group I2C_EXPORTED_CONSTANTS */
 
+
+/** @addtogroup I2C_EXPORTED_STRUCTS I2C Exported Structs
+  @{
+*/
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* I2C message queue. Transactions of all slaves on one I2C port run in order from the I2C interrupt.      */
+/* A transaction is a list of messages. They are joined by repeated START and the last one ends with STOP, */
+/* like a register address write followed by a read.                                                       */
+/*---------------------------------------------------------------------------------------------------------*/
+typedef struct
+{
+    uint8_t u8Addr;                     /*!< 7-bit slave address */
+    uint8_t u8Flags;                    /*!< I2C_QMSG_WR or I2C_QMSG_RD */
+    uint16_t u16Len;                    /*!< Bytes. A read needs at least 1, a write of 0 only addresses the slave */
+    uint8_t *pu8Buf;
+} I2C_QMSG_T;
+
+typedef struct I2C_QXFER
+{
+    I2C_QMSG_T *psMsg;                  /*!< Messages in bus order */
+    uint32_t u32MsgNum;
+    void (*pfnDone)(struct I2C_QXFER *psXfer);  /*!< Called in I2C interrupt after STOP is requested. Can be NULL */
+    void *pvParam;                      /*!< For pfnDone */
+    volatile int32_t i32Status;         /*!< I2C_QXFER_XXX */
+    uint32_t u32Msg;                    /*!< Private. Message on the bus */
+    uint32_t u32Pos;                    /*!< Private. Byte of the message */
+    struct I2C_QXFER *psNext;           /*!< Private */
+} I2C_QXFER_T;
+
+typedef struct
+{
+    I2C_T *i2c;
+    I2C_QXFER_T *psHead;                /*!< Transaction on the bus */
+    I2C_QXFER_T *psTail;
+} I2C_QUEUE_T;
+
+/*@}*/ /* end of group I2C_EXPORTED_STRUCTS */
+
 extern int32_t g_I2C_i32ErrCode;
 
 /** @addtogroup I2C_EXPORTED_FUNCTIONS I2C Exported Functions
@@ -416,6 +468,11 @@ uint8_t I2C_SMBusGetPECValue(I2C_T *i2c);
 void I2C_SMBusIdleTimeout(I2C_T *i2c, uint32_t us, uint32_t u32Hclk);
 void I2C_SMBusTimeout(I2C_T *i2c, uint32_t ms, uint32_t u32Pclk);
 void I2C_SMBusClockLoTimeout(I2C_T *i2c, uint32_t ms, uint32_t u32Pclk);
+void I2C_QueueOpen(I2C_QUEUE_T *psQueue, I2C_T *i2c);
+int32_t I2C_QueueSubmit(I2C_QUEUE_T *psQueue, I2C_QXFER_T *psXfer);
+int32_t I2C_QueueWait(I2C_QUEUE_T *psQueue, I2C_QXFER_T *psXfer);
+int32_t I2C_QueueTransfer(I2C_QUEUE_T *psQueue, I2C_QXFER_T *psXfer);
+void I2C_QueueIRQHandler(I2C_QUEUE_T *psQueue);
 /*@}*/ /* end of group I2C_EXPORTED_FUNCTIONS */
 
 /*@}*/ /* end of group I2C_Driver */
@@ -102,9 +102,75 @@ extern "C"
 #define PDMA_INT_TEMPTY     0x00000001UL            /*!<Table Empty Interrupt  \hideinitializer */
 #define PDMA_INT_TIMEOUT    0x00000002UL            /*!<Timeout Interrupt(M45xD/M45xC Only)  \hideinitializer */
 
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Channel Manager Constant Definitions                                                                   */
+/*---------------------------------------------------------------------------------------------------------*/
+#define PDMA_NO_CH          0xFFFFFFFFUL            /*!<Channel of a chain which isn't running  \hideinitializer */
+#define PDMA_MAX_TRANS_CNT  ((PDMA_DSCT_CTL_TXCNT_Msk >> PDMA_DSCT_CTL_TXCNT_Pos) + 1)  /*!<Transfers of one descriptor  \hideinitializer */
+#define PDMA_TBINT_DISABLE  PDMA_DSCT_CTL_TBINTDIS_Msk  /*!<No interrupt and no event at the end of the descriptor  \hideinitializer */
+
+#define PDMA_EVT_DESC       0x00000001UL            /*!<A chain entry is finished  \hideinitializer */
+#define PDMA_EVT_DONE       0x00000002UL            /*!<The chain or the basic transfer is finished  \hideinitializer */
+#define PDMA_EVT_ABORT      0x00000004UL            /*!<Target abort. The channel is disabled  \hideinitializer */
+#define PDMA_EVT_TIMEOUT    0x00000008UL            /*!<Request timeout (M45xD/M45xC Only)  \hideinitializer */
+
+#define PDMA_ERR_PARAM      (-1L)                   /*!<Invalid parameter  \hideinitializer */
+#define PDMA_ERR_NO_CH      (-2L)                   /*!<All channels are in use  \hideinitializer */
+#define PDMA_ERR_NO_DESC    (-3L)                   /*!<Descriptor pool is empty  \hideinitializer */
+#define PDMA_ERR_BUSY       (-4L)                   /*!<Channel or chain is in use  \hideinitializer */
+
 
 /*@}*/ /* end of group PDMA_EXPORTED_CONSTANTS */
 
+
+/** @addtogroup PDMA_EXPORTED_STRUCTS PDMA Exported Structs
+  @{
+*/
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Scatter-gather descriptor of the channel manager. The first 4 words are the hardware descriptor, so     */
+/* descriptors must be word aligned in SRAM.                                                               */
+/*---------------------------------------------------------------------------------------------------------*/
+typedef struct PDMA_DESC
+{
+    uint32_t u32Ctl;
+    uint32_t u32Src;
+    uint32_t u32Dst;
+    uint32_t u32Next;
+    uint32_t u32Reload;                 /*!< Private. u32Ctl which arms the descriptor */
+    struct PDMA_DESC *psLink;           /*!< Private. Next descriptor of the chain or of the free list */
+} PDMA_DESC_T;
+
+typedef struct
+{
+    PDMA_DESC_T *psFree;                /*!< Private */
+    uint32_t u32FreeNum;
+} PDMA_POOL_T;
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Descriptor chain. A linear chain runs once. A circular chain re-arms every descriptor after its event,  */
+/* like a ping-pong buffer, until PDMA_ChainStop().                                                        */
+/*---------------------------------------------------------------------------------------------------------*/
+typedef struct
+{
+    PDMA_POOL_T *psPool;
+    PDMA_DESC_T *psFirst;
+    PDMA_DESC_T *psLast;
+    PDMA_DESC_T *psCur;                 /*!< Private. Oldest descriptor which isn't reported */
+    uint32_t u32Num;                    /*!< Descriptors of the chain */
+    uint32_t u32Loop;                   /*!< 1 if the chain is circular */
+    volatile uint32_t u32Ch;            /*!< Channel which runs the chain, or PDMA_NO_CH */
+    volatile uint32_t u32Overrun;       /*!< Times the channel reached a descriptor which wasn't re-armed */
+} PDMA_CHAIN_T;
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Channel callback. It runs in PDMA_ChannelIRQHandler(). u32Event is a mask of PDMA_EVT_xxx. psDesc is    */
+/* the finished descriptor, or NULL on a channel without chain.                                            */
+/*---------------------------------------------------------------------------------------------------------*/
+typedef void (*PDMA_CALLBACK_T)(void *pvArg, uint32_t u32Ch, uint32_t u32Event, PDMA_DESC_T *psDesc);
+
+/*@}*/ /* end of group PDMA_EXPORTED_STRUCTS */
+
 /** @addtogroup PDMA_EXPORTED_FUNCTIONS PDMA Exported Functions
   @{
 */
@@ -284,6 +350,20 @@ void PDMA_SetTimeOut(uint32_t u32Ch, uint32_t u32OnOff, uint32_t u32TimeOutCnt);
 void PDMA_Trigger(uint32_t u32Ch);
 void PDMA_EnableInt(uint32_t u32Ch, uint32_t u32Mask);
 void PDMA_DisableInt(uint32_t u32Ch, uint32_t u32Mask);
+int32_t PDMA_AllocChannel(uint32_t u32Peripheral, PDMA_CALLBACK_T pfnCallback, void *pvArg);
+int32_t PDMA_ReserveChannels(uint32_t u32Mask);
+void PDMA_FreeChannel(uint32_t u32Ch);
+void PDMA_PoolInit(PDMA_POOL_T *psPool, PDMA_DESC_T *psDesc, uint32_t u32Num);
+PDMA_DESC_T *PDMA_PoolAlloc(PDMA_POOL_T *psPool);
+void PDMA_PoolFree(PDMA_POOL_T *psPool, PDMA_DESC_T *psDesc);
+void PDMA_ChainInit(PDMA_CHAIN_T *psChain, PDMA_POOL_T *psPool);
+int32_t PDMA_ChainAdd(PDMA_CHAIN_T *psChain, uint32_t u32SrcAddr, uint32_t u32DstAddr, uint32_t u32TransCount,
+                      uint32_t u32Ctl);
+int32_t PDMA_ChainLoop(PDMA_CHAIN_T *psChain);
+int32_t PDMA_ChainStart(PDMA_CHAIN_T *psChain, uint32_t u32Ch);
+void PDMA_ChainStop(PDMA_CHAIN_T *psChain);
+int32_t PDMA_ChainFree(PDMA_CHAIN_T *psChain);
+void PDMA_ChannelIRQHandler(void);
 
 
 /*@}*/ /* end of group PDMA_EXPORTED_FUNCTIONS */
@@ -119,9 +119,86 @@ extern "C"
 #define I2S_RIGHT_ZC_INT_MASK            (0x20)                          /*!< Right channel zero cross interrupt mask */
 #define I2S_LEFT_ZC_INT_MASK             (0x40)                          /*!< Left channel zero cross interrupt mask */
 
+/* SPI transaction queue segment I/O mode. Dual and quad modes need an SPI port which supports them. */
+#define SPI_QSEG_SINGLE         (0x0)                                                   /*!< Full duplex on MOSI and MISO */
+#define SPI_QSEG_DUAL_IN        (SPI_CTL_DUALIOEN_Msk)                                  /*!< Receive on 2 data lines */
+#define SPI_QSEG_DUAL_OUT       (SPI_CTL_DUALIOEN_Msk | SPI_CTL_QDIODIR_Msk)            /*!< Send on 2 data lines */
+#define SPI_QSEG_QUAD_IN        (SPI_CTL_QUADIOEN_Msk)                                  /*!< Receive on 4 data lines */
+#define SPI_QSEG_QUAD_OUT       (SPI_CTL_QUADIOEN_Msk | SPI_CTL_QDIODIR_Msk)            /*!< Send on 4 data lines */
+#define SPI_QSEG_MAX_LEN        ((PDMA_DSCT_CTL_TXCNT_Msk >> PDMA_DSCT_CTL_TXCNT_Pos) + 1)  /*!< Maximum bytes of one segment */
+
+/* SPI transaction queue transaction status */
+#define SPI_QXFER_DONE          (0)                                     /*!< Transaction is finished */
+#define SPI_QXFER_QUEUED        (1)                                     /*!< Transaction waits in the queue */
+#define SPI_QXFER_BUSY          (2)                                     /*!< Transaction is on the bus */
+
 /*@}*/ /* end of group SPI_EXPORTED_CONSTANTS */
 
 
+/** @addtogroup SPI_EXPORTED_STRUCTS SPI Exported Structs
+  @{
+*/
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* PDMA scatter-gather descriptor                                                                          */
+/*---------------------------------------------------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t u32Ctl;
+    uint32_t u32Src;
+    uint32_t u32Dst;
+    uint32_t u32Next;
+} SPI_QDESC_T;
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* SPI transaction queue. Transactions of all devices on one SPI port run in order, and PDMA moves every   */
+/* byte. A transaction is a list of segments with one chip select assertion. Consecutive segments of the   */
+/* same I/O mode are chained through scatter-gather descriptors and run without CPU. The PDMA interrupt    */
+/* switches the I/O mode, the chip select and the device settings.                                         */
+/*---------------------------------------------------------------------------------------------------------*/
+typedef struct
+{
+    SPI_T *spi;
+    uint32_t u32Ctl;                    /*!< SPI mode and bit order of SPI_CTL */
+    uint32_t u32ClkDiv;                 /*!< DIVIDER of SPI_CLKDIV */
+    volatile uint32_t *pu32CsPin;       /*!< GPIO bit of chip select like &PA3, or NULL for the SS pin of the port */
+    uint32_t u32CsActive;               /*!< SPI_SS_ACTIVE_LOW or SPI_SS_ACTIVE_HIGH */
+} SPI_QDEV_T;
+
+typedef struct
+{
+    const uint8_t *pu8Tx;               /*!< Data to send, or NULL to send 0xFF */
+    uint8_t *pu8Rx;                     /*!< Buffer of received data, or NULL to discard it */
+    uint32_t u32Len;                    /*!< 1 ~ SPI_QSEG_MAX_LEN bytes */
+    uint32_t u32Mode;                   /*!< SPI_QSEG_SINGLE, SPI_QSEG_DUAL_IN, ... */
+    SPI_QDESC_T sTxDesc;                /*!< Private. Segments must be in SRAM */
+    SPI_QDESC_T sRxDesc;                /*!< Private */
+} SPI_QSEG_T;
+
+typedef struct SPI_QXFER
+{
+    SPI_QDEV_T *psDev;
+    SPI_QSEG_T *psSeg;                  /*!< Segments in bus order */
+    uint32_t u32SegNum;
+    void (*pfnDone)(struct SPI_QXFER *psXfer);  /*!< Called in PDMA interrupt when the chip select is released. Can be NULL */
+    void *pvParam;                      /*!< For pfnDone */
+    volatile int32_t i32Status;         /*!< SPI_QXFER_QUEUED, SPI_QXFER_BUSY or SPI_QXFER_DONE */
+    uint32_t u32Run;                    /*!< Private. First segment of the running descriptor chain */
+    struct SPI_QXFER *psNext;           /*!< Private */
+} SPI_QXFER_T;
+
+typedef struct
+{
+    SPI_T *spi;
+    uint32_t u32TxCh;                   /*!< PDMA channel of TX */
+    uint32_t u32RxCh;                   /*!< PDMA channel of RX */
+    SPI_QXFER_T *psHead;                /*!< Transaction on the bus */
+    SPI_QXFER_T *psTail;
+} SPI_QUEUE_T;
+
+/*@}*/ /* end of group SPI_EXPORTED_STRUCTS */
+
+
 /** @addtogroup SPI_EXPORTED_FUNCTIONS SPI Exported Functions
   @{
 */
@@ -622,6 +699,14 @@ void SPI_DisableInt(SPI_T *spi, uint32_t u32Mask);
 uint32_t SPI_GetIntFlag(SPI_T *spi, uint32_t u32Mask);
 void SPI_ClearIntFlag(SPI_T *spi, uint32_t u32Mask);
 uint32_t SPI_GetStatus(SPI_T *spi, uint32_t u32Mask);
+int32_t SPI_QueueOpen(SPI_QUEUE_T *psQueue, SPI_T *spi, uint32_t u32TxCh, uint32_t u32RxCh);
+void SPI_QueueClose(SPI_QUEUE_T *psQueue);
+uint32_t SPI_QueueInitDev(SPI_QDEV_T *psDev, SPI_QUEUE_T *psQueue, uint32_t u32SPIMode, uint32_t u32BusClock,
+                          volatile uint32_t *pu32CsPin, uint32_t u32CsActive);
+int32_t SPI_QueueSubmit(SPI_QUEUE_T *psQueue, SPI_QXFER_T *psXfer);
+int32_t SPI_QueueWait(SPI_QUEUE_T *psQueue, SPI_QXFER_T *psXfer);
+int32_t SPI_QueueTransfer(SPI_QUEUE_T *psQueue, SPI_QXFER_T *psXfer);
+void SPI_QueuePdmaHandler(SPI_QUEUE_T *psQueue);
 
 uint32_t I2S_Open(SPI_T *i2s, uint32_t u32MasterSlave, uint32_t u32SampleRate, uint32_t u32WordWidth, uint32_t u32Channels, uint32_t u32DataFormat);
 void I2S_Close(SPI_T *i2s);
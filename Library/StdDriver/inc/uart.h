@@ -114,9 +114,74 @@ extern "C"
 #define UART_BAUD_MODE2     (UART_BAUD_BAUDM1_Msk | UART_BAUD_BAUDM0_Msk) /*!< Set UART Baudrate Mode is Mode2 */
 
 
+/*---------------------------------------------------------------------------------------------------------*/
+/* UART asynchronous transfer constants definitions                                                        */
+/*---------------------------------------------------------------------------------------------------------*/
+#define UART_ASYNC_NO_CH    0xFFFFFFFFUL    /*!< PDMA channel setting of a direction which is not used */
+
+
 /*@}*/ /* end of group UART_EXPORTED_CONSTANTS */
 
 
+/** @addtogroup UART_EXPORTED_STRUCTS UART Exported Structs
+  @{
+*/
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* PDMA scatter-gather descriptor of the RX ring                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t u32Ctl;
+    uint32_t u32Src;
+    uint32_t u32Dst;
+    uint32_t u32Next;
+} UART_ASYNC_DESC_T;
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Asynchronous transfer of a UART port. TX sends a ring buffer with PDMA. RX receives into a ring buffer  */
+/* of two halves, which PDMA fills in turn. Counters run freely, so head - tail is the data in a ring.     */
+/*---------------------------------------------------------------------------------------------------------*/
+typedef struct UART_ASYNC
+{
+    UART_T *uart;
+    uint32_t u32TxCh;                   /*!< PDMA channel of TX or UART_ASYNC_NO_CH */
+    uint32_t u32RxCh;                   /*!< PDMA channel of RX or UART_ASYNC_NO_CH */
+    uint8_t *pu8TxBuf;
+    uint32_t u32TxSize;                 /*!< Power of 2 */
+    volatile uint32_t u32TxHead;        /*!< Bytes written by the application */
+    volatile uint32_t u32TxTail;        /*!< Bytes sent by PDMA */
+    volatile uint32_t u32TxDmaLen;      /*!< Bytes of the PDMA transfer in progress. 0 if TX is idle */
+    uint8_t *pu8RxBuf;
+    uint32_t u32RxSize;                 /*!< Power of 2 */
+    volatile uint32_t u32RxHead;        /*!< Bytes of filled halves */
+    uint32_t u32RxTail;                 /*!< Bytes read by the application */
+    uint32_t u32RxOverrun;              /*!< Bytes lost because the application read too late */
+    UART_ASYNC_DESC_T asRxDesc[2];      /*!< Descriptors of the two halves. Must be in SRAM */
+    void (*pfnTxDone)(struct UART_ASYNC *psAsync);  /*!< TX ring is empty. Called in PDMA interrupt. Can be NULL */
+    void (*pfnRxData)(struct UART_ASYNC *psAsync);  /*!< Half of RX ring is filled. Called in PDMA interrupt. Can be NULL */
+} UART_ASYNC_T;
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Asynchronous functions which retarget.c calls for g_psDebugAsync. UART_AsyncOpen() installs them, so    */
+/* retarget.c doesn't pull uart.c into projects which don't use the asynchronous transfer.                 */
+/*---------------------------------------------------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t (*pfnWrite)(UART_ASYNC_T *psAsync, const uint8_t *pu8Data, uint32_t u32Len);
+    void (*pfnWriteWait)(UART_ASYNC_T *psAsync, const uint8_t *pu8Data, uint32_t u32Len);
+    uint32_t (*pfnReadWait)(UART_ASYNC_T *psAsync, uint8_t *pu8Data, uint32_t u32Len);
+    uint32_t (*pfnGetRxCount)(UART_ASYNC_T *psAsync);
+    uint32_t (*pfnGetTxFree)(UART_ASYNC_T *psAsync);
+    void (*pfnFlush)(UART_ASYNC_T *psAsync);
+} UART_ASYNC_HOOK_T;
+
+extern UART_ASYNC_T *g_psDebugAsync;    /*!< retarget.c sends and receives through it if it isn't NULL */
+extern const UART_ASYNC_HOOK_T *g_psDebugAsyncHook; /*!< Set by UART_AsyncOpen(). NULL until then */
+
+/*@}*/ /* end of group UART_EXPORTED_STRUCTS */
+
+
 /** @addtogroup UART_EXPORTED_FUNCTIONS UART Exported Functions
   @{
 */
@@ -442,6 +507,18 @@ void UART_SelectIrDAMode(UART_T* uart, uint32_t u32Buadrate, uint32_t u32Directi
 void UART_SelectRS485Mode(UART_T* uart, uint32_t u32Mode, uint32_t u32Addr);
 void UART_SelectLINMode(UART_T* uart, uint32_t u32Mode, uint32_t u32BreakLength);
 uint32_t UART_Write(UART_T* uart, uint8_t *pu8TxBuf, uint32_t u32WriteBytes);
+int32_t UART_AsyncOpen(UART_ASYNC_T *psAsync, UART_T *uart, uint32_t u32TxCh, uint8_t *pu8TxBuf, uint32_t u32TxSize,
+                       uint32_t u32RxCh, uint8_t *pu8RxBuf, uint32_t u32RxSize);
+void UART_AsyncClose(UART_ASYNC_T *psAsync);
+uint32_t UART_AsyncWrite(UART_ASYNC_T *psAsync, const uint8_t *pu8Data, uint32_t u32Len);
+uint32_t UART_AsyncRead(UART_ASYNC_T *psAsync, uint8_t *pu8Data, uint32_t u32Len);
+uint32_t UART_AsyncGetRxCount(UART_ASYNC_T *psAsync);
+uint32_t UART_AsyncGetTxFree(UART_ASYNC_T *psAsync);
+void UART_AsyncWriteWait(UART_ASYNC_T *psAsync, const uint8_t *pu8Data, uint32_t u32Len);
+uint32_t UART_AsyncReadWait(UART_ASYNC_T *psAsync, uint8_t *pu8Data, uint32_t u32Len);
+void UART_AsyncFlush(UART_ASYNC_T *psAsync);
+void UART_AsyncPdmaHandler(UART_ASYNC_T *psAsync);
+void UART_AsyncIrqHandler(UART_ASYNC_T *psAsync);
 
 
 
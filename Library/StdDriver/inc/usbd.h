@@ -44,7 +44,9 @@ extern const S_USBD_INFO_T gsInfo;
 /** @addtogroup USBD_EXPORTED_CONSTANTS USBD Exported Constants
   @{
 */
-#define USBD_BUF_BASE   (USBD_BASE+0x100)
+#ifndef USBD_BUF_BASE
+#define USBD_BUF_BASE   (USBD_BASE+0x100)   /*!< USB SRAM base. Can be predefined to relocate the endpoint buffers, e.g. to a simulated block */
+#endif
 #define USBD_MAX_EP     8
 
 #define EP0     0       /*!< Endpoint 0 */
@@ -1020,11 +1020,46 @@ int32_t CAN_SetMultiRxMsg(CAN_T *tCAN, uint32_t u32MsgNum, uint32_t u32MsgCount,
     {
         u32TimeOutCount = 0;
 
-        u32MsgNum += (i - 1);
-
         if(i == u32MsgCount) u32EOB_Flag = 1;
 
-        while(CAN_SetRxMsgObj(tCAN, u32MsgNum, u32IDType, u32ID, u32EOB_Flag) == FALSE)
+        while(CAN_SetRxMsgObj(tCAN, u32MsgNum + i - 1, u32IDType, u32ID, u32EOB_Flag) == FALSE)
+        {
+            if(++u32TimeOutCount >= RETRY_COUNTS) return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+
+/**
+  * @brief The function is used to configure several receive message objects with an ID mask.
+  *
+  * @param[in] tCAN The pointer to CAN module base address.
+  * @param[in] u32MsgNum The starting MSG RAM number, from 0 to 31.
+  * @param[in] u32MsgCount the number of MSG RAM of the FIFO.
+  * @param[in] u32IDType Specifies the identifier type of the frames that will be received. Valid values are:
+  *                      - \ref CAN_STD_ID The 11-bit identifier.
+  *                      - \ref CAN_EXT_ID The 29-bit identifier.
+  * @param[in] u32ID Specifies the identifier used for acceptance filtering.
+  * @param[in] u32IDMask Specifies the identifier mask used for acceptance filtering. 0 bits are not compared.
+  *
+  * @retval FALSE No useful interface.
+  * @retval TRUE Configure receive message objects success.
+  *
+  * @details The objects form one FIFO. Only the last one has the EOB bit (CAN_IFn_MCON[7]) set, and a frame
+  *          is stored in the lowest numbered object of the FIFO that has no new data.
+  */
+int32_t CAN_SetMultiRxMsgAndMsk(CAN_T *tCAN, uint32_t u32MsgNum, uint32_t u32MsgCount, uint32_t u32IDType, uint32_t u32ID, uint32_t u32IDMask)
+{
+    uint32_t i;
+    uint32_t u32TimeOutCount;
+
+    for(i = 0; i < u32MsgCount; i++)
+    {
+        u32TimeOutCount = 0;
+
+        while(CAN_SetRxMsgObjAndMsk(tCAN, u32MsgNum + i, u32IDType, u32ID, u32IDMask, (i == u32MsgCount - 1)) == FALSE)
         {
             if(++u32TimeOutCount >= RETRY_COUNTS) return FALSE;
         }
@@ -1111,6 +1146,485 @@ void CAN_CLR_INT_PENDING_BIT(CAN_T *tCAN, uint8_t u32MsgNum)
     ReleaseIF(tCAN, u32MsgIfNum);
 }
 
+/// @cond HIDDEN_SYMBOLS
+
+/* Transmit order of two queued frames. Equal identifiers keep their submission order. */
+#define CAN_QTX_BEFORE(a, b)    (((a)->u32Key < (b)->u32Key) || \
+                                 (((a)->u32Key == (b)->u32Key) && ((int32_t)((a)->u32Seq - (b)->u32Seq) < 0)))
+
+/* Objects of the queue in the layout of the NDAT and TXREQ registers */
+#define CAN_QUEUE_OBJ_MASK(u32Obj, u32Num)  ((((u32Num) >= 32) ? 0xFFFFFFFFUL : ((1UL << (u32Num)) - 1)) << (u32Obj))
+
+/* Wait for the message transfer of IF2, which the queue owns */
+static void CAN_QueueIfWait(CAN_T *tCAN)
+{
+    uint32_t u32TimeOutCount = 0x1000;
+
+    while(tCAN->IF[1].CREQ & CAN_IF_CREQ_BUSY_Msk)
+        if(--u32TimeOutCount == 0) break;
+}
+
+/* Arbitration field of a frame as it goes on the bus, so that a lower key wins arbitration */
+static uint32_t CAN_QueueTxKey(STR_CANMSG_T *pCanMsg)
+{
+    uint32_t u32Rtr = pCanMsg->FrameType ? 0 : 1;
+
+    if(pCanMsg->IdType == CAN_STD_ID)
+        return ((pCanMsg->Id & 0x7FF) << 21) | (u32Rtr << 20);
+
+    /* Base ID, SRR and IDE (both recessive), ID extension and RTR */
+    return ((pCanMsg->Id & 0x1FFC0000) << 3) | (3UL << 19) | ((pCanMsg->Id & 0x3FFFF) << 1) | u32Rtr;
+}
+
+/* Load the transmit objects left in this round from the heap, highest priority first.
+   The controller sends the lowest numbered object first, so objects are loaded in ascending order and
+   a new round from the first object starts only after all objects of the last round are sent. */
+static void CAN_QueueTxLoad(CAN_QUEUE_T *psQueue)
+{
+    CAN_T *tCAN = psQueue->tCAN;
+    CAN_QTX_T *psHeap = psQueue->psTxHeap;
+    STR_CANMSG_T *pCanMsg;
+    uint32_t i, j, n;
+
+    while(psQueue->u32TxCnt && (psQueue->u32TxNext < psQueue->u32TxNum))
+    {
+        pCanMsg = &psHeap[0].sMsg;
+
+        tCAN->IF[1].CMASK = CAN_IF_CMASK_WRRD_Msk | CAN_IF_CMASK_ARB_Msk | CAN_IF_CMASK_CONTROL_Msk |
+                            CAN_IF_CMASK_DATAA_Msk | CAN_IF_CMASK_DATAB_Msk;
+
+        if(pCanMsg->IdType == CAN_STD_ID)
+        {
+            tCAN->IF[1].ARB1 = 0;
+            tCAN->IF[1].ARB2 = ((pCanMsg->Id & 0x7FF) << 2) | CAN_IF_ARB2_MSGVAL_Msk;
+        }
+        else
+        {
+            tCAN->IF[1].ARB1 = pCanMsg->Id & 0xFFFF;
+            tCAN->IF[1].ARB2 = ((pCanMsg->Id & 0x1FFF0000) >> 16) | CAN_IF_ARB2_XTD_Msk | CAN_IF_ARB2_MSGVAL_Msk;
+        }
+
+        /* A remote frame is sent by a receive object */
+        if(pCanMsg->FrameType)
+            tCAN->IF[1].ARB2 |= CAN_IF_ARB2_DIR_Msk;
+
+        tCAN->IF[1].DAT_A1 = ((uint16_t)pCanMsg->Data[1] << 8) | pCanMsg->Data[0];
+        tCAN->IF[1].DAT_A2 = ((uint16_t)pCanMsg->Data[3] << 8) | pCanMsg->Data[2];
+        tCAN->IF[1].DAT_B1 = ((uint16_t)pCanMsg->Data[5] << 8) | pCanMsg->Data[4];
+        tCAN->IF[1].DAT_B2 = ((uint16_t)pCanMsg->Data[7] << 8) | pCanMsg->Data[6];
+
+        /* Writing IntPnd as 0 also clears the interrupt of the last frame of the object */
+        tCAN->IF[1].MCON = CAN_IF_MCON_NEWDAT_Msk | CAN_IF_MCON_TXRQST_Msk | CAN_IF_MCON_TXIE_Msk |
+                           CAN_IF_MCON_EOB_Msk | (pCanMsg->DLC & CAN_IF_MCON_DLC_Msk);
+        tCAN->IF[1].CREQ = 1 + psQueue->u32TxObj + psQueue->u32TxNext;
+        CAN_QueueIfWait(tCAN);
+
+        /* Keep the frame for the completion callback */
+        if(psQueue->psTxObj)
+            psQueue->psTxObj[psQueue->u32TxNext] = psHeap[0];
+
+        psQueue->u32TxLoaded |= 1UL << psQueue->u32TxNext;
+        psQueue->u32TxNext++;
+
+        /* Move the last entry to the root and sift it down */
+        n = --psQueue->u32TxCnt;
+        i = 0;
+
+        while((j = 2 * i + 1) < n)
+        {
+            if((j + 1 < n) && CAN_QTX_BEFORE(&psHeap[j + 1], &psHeap[j]))
+                j++;
+
+            if(!CAN_QTX_BEFORE(&psHeap[j], &psHeap[n]))
+                break;
+
+            psHeap[i] = psHeap[j];
+            i = j;
+        }
+
+        psHeap[i] = psHeap[n];
+    }
+}
+
+/* Report the sent frames of the transmit objects in u32Done, relative to the first transmit object */
+static void CAN_QueueTxReport(CAN_QUEUE_T *psQueue, uint32_t u32Done)
+{
+    uint32_t i;
+
+    u32Done &= psQueue->u32TxLoaded;
+    psQueue->u32TxLoaded &= ~u32Done;
+
+    if(psQueue->pfnTxDone == NULL)
+        return;
+
+    for(i = 0; u32Done; i++, u32Done >>= 1)
+    {
+        if(u32Done & 1)
+            psQueue->pfnTxDone(psQueue, psQueue->psTxObj ? &psQueue->psTxObj[i] : NULL);
+    }
+}
+
+/* A transmit object has sent its frame */
+static void CAN_QueueTxDone(CAN_QUEUE_T *psQueue, uint32_t u32Obj)
+{
+    CAN_T *tCAN = psQueue->tCAN;
+
+    tCAN->IF[1].CMASK = CAN_IF_CMASK_CLRINTPND_Msk;
+    tCAN->IF[1].CREQ = 1 + u32Obj;
+    CAN_QueueIfWait(tCAN);
+
+    CAN_QueueTxReport(psQueue, 1UL << (u32Obj - psQueue->u32TxObj));
+
+    /* The round ends when no object of it waits for the bus any more. Objects whose interrupt is still
+       pending are reported before they are loaded again. */
+    if(((tCAN->TXREQ1 | (tCAN->TXREQ2 << 16)) & psQueue->u32TxMask) == 0)
+    {
+        CAN_QueueTxReport(psQueue, psQueue->u32TxLoaded);
+        psQueue->u32TxNext = 0;
+        CAN_QueueTxLoad(psQueue);
+    }
+}
+
+/* Move one receive object to the ring, then release it for the next frame */
+static void CAN_QueueRxRead(CAN_QUEUE_T *psQueue, uint32_t u32Obj)
+{
+    CAN_T *tCAN = psQueue->tCAN;
+    STR_CANMSG_T sDrop;
+    STR_CANMSG_T *pCanMsg;
+    uint32_t u32Head = psQueue->u32RxHead;
+
+    if(u32Head - psQueue->u32RxTail < psQueue->u32RxSize)
+    {
+        pCanMsg = &psQueue->psRxBuf[u32Head & (psQueue->u32RxSize - 1)];
+    }
+    else
+    {
+        psQueue->u32RxOverrun++;
+        pCanMsg = &sDrop;
+    }
+
+    tCAN->IF[1].CMASK = CAN_IF_CMASK_ARB_Msk | CAN_IF_CMASK_CONTROL_Msk | CAN_IF_CMASK_CLRINTPND_Msk |
+                        CAN_IF_CMASK_TXRQSTNEWDAT_Msk | CAN_IF_CMASK_DATAA_Msk | CAN_IF_CMASK_DATAB_Msk;
+    tCAN->IF[1].CREQ = 1 + u32Obj;
+    CAN_QueueIfWait(tCAN);
+
+    if((tCAN->IF[1].ARB2 & CAN_IF_ARB2_XTD_Msk) == 0)
+    {
+        pCanMsg->IdType = CAN_STD_ID;
+        pCanMsg->Id = (tCAN->IF[1].ARB2 & CAN_IF_ARB2_ID_Msk) >> 2;
+    }
+    else
+    {
+        pCanMsg->IdType = CAN_EXT_ID;
+        pCanMsg->Id = ((tCAN->IF[1].ARB2 & 0x1FFF) << 16) | tCAN->IF[1].ARB1;
+    }
+
+    pCanMsg->FrameType = CAN_DATA_FRAME;
+    pCanMsg->DLC     = tCAN->IF[1].MCON & CAN_IF_MCON_DLC_Msk;
+    pCanMsg->Data[0] = tCAN->IF[1].DAT_A1 & CAN_IF_DAT_A1_DATA0_Msk;
+    pCanMsg->Data[1] = (tCAN->IF[1].DAT_A1 & CAN_IF_DAT_A1_DATA1_Msk) >> CAN_IF_DAT_A1_DATA1_Pos;
+    pCanMsg->Data[2] = tCAN->IF[1].DAT_A2 & CAN_IF_DAT_A2_DATA2_Msk;
+    pCanMsg->Data[3] = (tCAN->IF[1].DAT_A2 & CAN_IF_DAT_A2_DATA3_Msk) >> CAN_IF_DAT_A2_DATA3_Pos;
+    pCanMsg->Data[4] = tCAN->IF[1].DAT_B1 & CAN_IF_DAT_B1_DATA4_Msk;
+    pCanMsg->Data[5] = (tCAN->IF[1].DAT_B1 & CAN_IF_DAT_B1_DATA5_Msk) >> CAN_IF_DAT_B1_DATA5_Pos;
+    pCanMsg->Data[6] = tCAN->IF[1].DAT_B2 & CAN_IF_DAT_B2_DATA6_Msk;
+    pCanMsg->Data[7] = (tCAN->IF[1].DAT_B2 & CAN_IF_DAT_B2_DATA7_Msk) >> CAN_IF_DAT_B2_DATA7_Pos;
+
+    if(tCAN->IF[1].MCON & CAN_IF_MCON_MSGLST_Msk)
+    {
+        /* The last object of the FIFO was overwritten */
+        psQueue->u32RxLost++;
+        tCAN->IF[1].CMASK = CAN_IF_CMASK_WRRD_Msk | CAN_IF_CMASK_CONTROL_Msk;
+        tCAN->IF[1].MCON &= ~(CAN_IF_MCON_MSGLST_Msk | CAN_IF_MCON_NEWDAT_Msk | CAN_IF_MCON_INTPND_Msk);
+        tCAN->IF[1].CREQ = 1 + u32Obj;
+        CAN_QueueIfWait(tCAN);
+    }
+
+    if(pCanMsg != &sDrop)
+        psQueue->u32RxHead = u32Head + 1;
+}
+
+/* Read every receive object with new data in arrival order.
+   The controller stores a frame in the lowest free object of the FIFO. Objects freed during a read are
+   filled again below older frames, so the highest group of consecutive full objects is always the oldest. */
+static void CAN_QueueRxDrain(CAN_QUEUE_T *psQueue)
+{
+    CAN_T *tCAN = psQueue->tCAN;
+    uint32_t u32Pend, u32Low, u32Obj;
+
+    u32Pend = (tCAN->NDAT1 | (tCAN->NDAT2 << 16)) & psQueue->u32RxMask;
+
+    while(u32Pend)
+    {
+        /* Find the bottom of the highest group */
+        u32Low = 31 - __CLZ(u32Pend);
+
+        while((u32Low > 0) && (u32Pend & (1UL << (u32Low - 1))))
+            u32Low--;
+
+        for(u32Obj = u32Low; (u32Obj < 32) && (u32Pend & (1UL << u32Obj)); u32Obj++)
+        {
+            CAN_QueueRxRead(psQueue, u32Obj);
+            u32Pend &= ~(1UL << u32Obj);
+        }
+    }
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+/**
+  * @brief Open the message queue of a CAN module.
+  *
+  * @param[in] psQueue Queue state. It must stay valid while the CAN module is used.
+  * @param[in] tCAN The pointer to CAN module base address.
+  * @param[in] u32RxObj The first message object of the receive FIFO, from 0 to 31.
+  * @param[in] u32RxNum The number of message objects of the receive FIFO.
+  * @param[in] psRxBuf Ring of received messages.
+  * @param[in] u32RxSize The number of messages of psRxBuf. It must be a power of 2.
+  * @param[in] u32TxObj The first transmit message object, from 0 to 31.
+  * @param[in] u32TxNum The number of transmit message objects.
+  * @param[in] psTxHeap Transmit queue.
+  * @param[in] u32TxSize The number of frames of psTxHeap.
+  *
+  * @return None
+  *
+  * @details The receive objects must be set up before with CAN_SetMultiRxMsg() or CAN_SetMultiRxMsgAndMsk().
+  *          They can hold several FIFOs of different filters. The queue uses IF2 (tCAN->IF[1]) from now on,
+  *          and other driver functions use IF1 only. The CAN and error interrupts are enabled.
+  *          CANn_IRQHandler() must call CAN_QueueIRQHandler(). u32BusFrames and u32ErrFrames are counted
+  *          only if the status change interrupt is enabled too by CAN_EnableInt().
+  */
+void CAN_QueueOpen(CAN_QUEUE_T *psQueue, CAN_T *tCAN, uint32_t u32RxObj, uint32_t u32RxNum, STR_CANMSG_T *psRxBuf,
+                   uint32_t u32RxSize, uint32_t u32TxObj, uint32_t u32TxNum, CAN_QTX_T *psTxHeap, uint32_t u32TxSize)
+{
+    uint32_t u32CanNo;
+
+#if defined(CAN1)
+    u32CanNo = (tCAN == CAN1) ? 1 : 0;
+#else // defined(CAN0) || defined(CAN)
+    u32CanNo = 0;
+#endif
+
+    psQueue->tCAN = tCAN;
+    psQueue->u32RxObj = u32RxObj;
+    psQueue->u32RxNum = u32RxNum;
+    psQueue->u32RxMask = CAN_QUEUE_OBJ_MASK(u32RxObj, u32RxNum);
+    psQueue->psRxBuf = psRxBuf;
+    psQueue->u32RxSize = u32RxSize;
+    psQueue->u32RxHead = 0;
+    psQueue->u32RxTail = 0;
+    psQueue->u32TxObj = u32TxObj;
+    psQueue->u32TxNum = u32TxNum;
+    psQueue->u32TxMask = CAN_QUEUE_OBJ_MASK(u32TxObj, u32TxNum);
+    psQueue->psTxHeap = psTxHeap;
+    psQueue->u32TxSize = u32TxSize;
+    psQueue->u32TxCnt = 0;
+    psQueue->u32TxNext = 0;
+    psQueue->u32TxSeq = 0;
+    psQueue->u32TxLoaded = 0;
+    psQueue->pfnGetTime = NULL;
+    psQueue->pfnTxDone = NULL;
+    psQueue->psTxObj = NULL;
+    psQueue->u32RxOverrun = 0;
+    psQueue->u32RxLost = 0;
+    psQueue->u32BusOff = 0;
+    psQueue->u32BusFrames = 0;
+    psQueue->u32ErrFrames = 0;
+
+    /* Keep IF2 for the queue */
+    CAN_DisableInt(tCAN, CAN_CON_IE_Msk | CAN_CON_SIE_Msk | CAN_CON_EIE_Msk);
+    gu8LockCanIf[u32CanNo][1] = TRUE;
+
+    CAN_EnableInt(tCAN, CAN_CON_IE_Msk | CAN_CON_EIE_Msk);
+#if defined(CAN1)
+    NVIC_EnableIRQ((tCAN == CAN1) ? CAN1_IRQn : CAN0_IRQn);
+#else
+    NVIC_EnableIRQ(CAN0_IRQn);
+#endif
+}
+
+/**
+  * @brief Report the end of each transmission of a queue.
+  *
+  * @param[in] psQueue Queue of the CAN module.
+  * @param[in] pfnGetTime Time stamp of CAN_QueueSend() in CAN_QTX_T.u32Time. Can be NULL.
+  * @param[in] pfnTxDone Called in the CAN interrupt with each sent frame. Can be NULL.
+  * @param[in] psTxObj Copies of the frames in the u32TxNum transmit objects. If it is NULL, pfnTxDone gets NULL.
+  *
+  * @return None
+  *
+  * @details Call it before frames are queued. CAN_QTX_T.u32Time minus the time in pfnTxDone is the latency
+  *          of the frame from the queue to the end of its transmission.
+  */
+void CAN_QueueSetTxHook(CAN_QUEUE_T *psQueue, uint32_t (*pfnGetTime)(void),
+                        void (*pfnTxDone)(CAN_QUEUE_T *psQueue, CAN_QTX_T *psEntry), CAN_QTX_T *psTxObj)
+{
+    psQueue->pfnGetTime = pfnGetTime;
+    psQueue->psTxObj = psTxObj;
+    psQueue->pfnTxDone = pfnTxDone;
+}
+
+/**
+  * @brief Queue a frame for transmission.
+  *
+  * @param[in] psQueue Queue of the CAN module.
+  * @param[in] pCanMsg The frame. It is copied.
+  *
+  * @retval TRUE The frame is queued.
+  * @retval FALSE The transmit queue is full.
+  *
+  * @details Queued frames are sent by identifier priority, and frames of the same identifier in order.
+  *          A free transmit object is loaded at once. Because the controller sends its objects in object
+  *          order, a frame can wait behind at most u32TxNum frames of lower priority that are already loaded.
+  *          It can be called from interrupts.
+  */
+int32_t CAN_QueueSend(CAN_QUEUE_T *psQueue, STR_CANMSG_T *pCanMsg)
+{
+    CAN_QTX_T *psHeap = psQueue->psTxHeap;
+    CAN_QTX_T sEntry;
+    uint32_t u32Primask, i, j;
+
+    sEntry.u32Key = CAN_QueueTxKey(pCanMsg);
+    sEntry.u32Time = psQueue->pfnGetTime ? psQueue->pfnGetTime() : 0;
+    sEntry.sMsg = *pCanMsg;
+
+    u32Primask = __get_PRIMASK();
+    __disable_irq();
+
+    if(psQueue->u32TxCnt >= psQueue->u32TxSize)
+    {
+        __set_PRIMASK(u32Primask);
+        return FALSE;
+    }
+
+    sEntry.u32Seq = psQueue->u32TxSeq++;
+
+    /* Sift the new entry up */
+    i = psQueue->u32TxCnt++;
+
+    while(i > 0)
+    {
+        j = (i - 1) / 2;
+
+        if(!CAN_QTX_BEFORE(&sEntry, &psHeap[j]))
+            break;
+
+        psHeap[i] = psHeap[j];
+        i = j;
+    }
+
+    psHeap[i] = sEntry;
+
+    CAN_QueueTxLoad(psQueue);
+
+    __set_PRIMASK(u32Primask);
+
+    return TRUE;
+}
+
+/**
+  * @brief Get a received frame.
+  *
+  * @param[in] psQueue Queue of the CAN module.
+  * @param[out] pCanMsg The oldest received frame.
+  *
+  * @retval TRUE A frame is copied.
+  * @retval FALSE No frame is received.
+  *
+  * @details Only one context may read the queue.
+  */
+int32_t CAN_QueueReceive(CAN_QUEUE_T *psQueue, STR_CANMSG_T *pCanMsg)
+{
+    uint32_t u32Tail = psQueue->u32RxTail;
+
+    if(u32Tail == psQueue->u32RxHead)
+        return FALSE;
+
+    *pCanMsg = psQueue->psRxBuf[u32Tail & (psQueue->u32RxSize - 1)];
+    psQueue->u32RxTail = u32Tail + 1;
+
+    return TRUE;
+}
+
+/**
+  * @brief Get the number of frames not sent yet.
+  *
+  * @param[in] psQueue Queue of the CAN module.
+  *
+  * @return Queued frames and frames in the transmit objects that wait for the bus.
+  */
+uint32_t CAN_QueueGetTxCount(CAN_QUEUE_T *psQueue)
+{
+    uint32_t u32Pend, u32Cnt;
+
+    u32Pend = (psQueue->tCAN->TXREQ1 | (psQueue->tCAN->TXREQ2 << 16)) & psQueue->u32TxMask;
+
+    for(u32Cnt = psQueue->u32TxCnt; u32Pend; u32Pend &= u32Pend - 1)
+        u32Cnt++;
+
+    return u32Cnt;
+}
+
+/**
+  * @brief CAN interrupt service of a queue.
+  *
+  * @param[in] psQueue Queue of the CAN module.
+  *
+  * @retval 0 All interrupts are handled.
+  * @retval others The interrupt identifier (CAN_IIDR) of a message object outside the queue.
+  *
+  * @details Call it from CANn_IRQHandler(). A receive interrupt moves all new frames of the FIFO to the ring,
+  *          and a transmit interrupt loads the next frames. A bus-off state is counted and recovery is started.
+  *          If another message object interrupts, the caller handles it and clears its pending bit.
+  */
+uint32_t CAN_QueueIRQHandler(CAN_QUEUE_T *psQueue)
+{
+    CAN_T *tCAN = psQueue->tCAN;
+    uint32_t u32IIDR, u32Bit, u32Status;
+
+    while((u32IIDR = tCAN->IIDR) != 0)
+    {
+        if(u32IIDR == 0x00008000)
+        {
+            /* Reading the status clears the status interrupt. LEC is set to 7 to see the next error. */
+            u32Status = tCAN->STATUS;
+            tCAN->STATUS = CAN_STATUS_LEC_Msk;
+
+            /* With the status change interrupt, RxOk is set by every frame on the bus whether it is accepted
+               or not. A looped back frame sets both RxOk and TxOk. */
+            if(u32Status & (CAN_STATUS_RXOK_Msk | CAN_STATUS_TXOK_Msk))
+                psQueue->u32BusFrames++;
+
+            if(((u32Status & CAN_STATUS_LEC_Msk) != 0) && ((u32Status & CAN_STATUS_LEC_Msk) != CAN_STATUS_LEC_Msk))
+                psQueue->u32ErrFrames++;
+
+            if(u32Status & CAN_STATUS_BOFF_Msk)
+            {
+                /* Leave the initialization mode entered at bus-off. The controller joins the bus again
+                   after 128 occurrences of 11 recessive bits. */
+                psQueue->u32BusOff++;
+                tCAN->CON &= ~CAN_CON_INIT_Msk;
+            }
+
+            continue;
+        }
+
+        if(u32IIDR > 32)
+            return u32IIDR;
+
+        u32Bit = 1UL << (u32IIDR - 1);
+
+        if(u32Bit & psQueue->u32RxMask)
+            CAN_QueueRxDrain(psQueue);
+        else if(u32Bit & psQueue->u32TxMask)
+            CAN_QueueTxDone(psQueue, u32IIDR - 1);
+        else
+            return u32IIDR;
+    }
+
+    return 0;
+}
+
 
 /*@}*/ /* end of group CAN_EXPORTED_FUNCTIONS */
 
@@ -0,0 +1,275 @@
+/**************************************************************************//**
+ * @file     dlog.c
+ * @version  V3.00
+ * @brief    M451 series deferred debug log source file
+ *
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stdarg.h>
+#include "M451Series.h"
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup DLOG_Driver DLOG Driver
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+/* Log ring of DLOG_Open() */
+static uint32_t *s_pu32DlogBuf = NULL;
+static uint32_t s_u32DlogSize;
+static volatile uint32_t s_u32DlogHead;     /* Words reserved by DLOG_Put() */
+static volatile uint32_t s_u32DlogTail;     /* Words released by DLOG_Process() */
+static volatile uint32_t s_u32DlogDrop;
+static uint32_t s_u32DlogSent;              /* Bytes of the oldest record in the UART FIFO */
+
+/* Records go through the asynchronous debug port of retarget.c when it is open */
+#define DLOG_ASYNC()        (g_psDebugAsync && g_psDebugAsyncHook && (g_psDebugAsync->u32TxCh != UART_ASYNC_NO_CH))
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup DLOG_EXPORTED_FUNCTIONS DLOG Exported Functions
+  @{
+*/
+
+/**
+ * @brief      Start the deferred debug log
+ *
+ * @param[in]  pu32Buf   Log ring
+ * @param[in]  u32Words  Size of the log ring in words. It must be a power of 2 and at least 16.
+ *
+ * @retval     0  Success
+ * @retval    -1  Invalid ring size
+ *
+ * @details    DLOG() stores records in the ring and DLOG_Process() sends them to the debug port.
+ *             The records are sent through g_psDebugAsync when its TX channel is open. Otherwise they are
+ *             written to the UART FIFO of DEBUG_PORT without waiting.
+ *             The DWT cycle counter is enabled for the time stamps.
+ */
+int32_t DLOG_Open(uint32_t *pu32Buf, uint32_t u32Words)
+{
+    uint32_t i;
+
+    if((u32Words < 16) || (u32Words & (u32Words - 1)))
+        return -1;
+
+    s_pu32DlogBuf = NULL;
+
+    /* Free words are 0, so a record is only visible after DLOG_Put() writes its first word */
+    for(i = 0; i < u32Words; i++)
+        pu32Buf[i] = 0;
+
+    s_u32DlogSize = u32Words;
+    s_u32DlogHead = 0;
+    s_u32DlogTail = 0;
+    s_u32DlogDrop = 0;
+    s_u32DlogSent = 0;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    s_pu32DlogBuf = pu32Buf;
+
+    return 0;
+}
+
+/**
+ * @brief      Stop the deferred debug log
+ *
+ * @param      None
+ *
+ * @returns    None
+ *
+ * @details    DLOG() calls are ignored after this. Records which are not sent yet are discarded.
+ */
+void DLOG_Close(void)
+{
+    s_pu32DlogBuf = NULL;
+}
+
+/**
+ * @brief      Store a log record
+ *
+ * @param[in]  u32Num  Number of the arguments which follow pcFmt
+ * @param[in]  pcFmt   Format string. It must stay in flash because only its address is stored.
+ * @param[in]  ...     Arguments. Each one is stored as a 32-bit word.
+ *
+ * @returns    None
+ *
+ * @details    Use DLOG() to call this function. The space of the record is reserved with LDREX/STREX, so
+ *             interrupts of any priority can log without disabling interrupts. A record which does not fit
+ *             in the ring is dropped and counted.
+ */
+void DLOG_Put(uint32_t u32Num, const char *pcFmt, ...)
+{
+    volatile uint32_t *pu32Buf = s_pu32DlogBuf;
+    uint32_t u32Time = DWT->CYCCNT, u32Mask, u32Head, u32Drop, i;
+    va_list args;
+
+    if(pu32Buf == NULL)
+        return;
+
+    if(u32Num > DLOG_MAX_ARGS)
+        u32Num = DLOG_MAX_ARGS;
+
+    u32Mask = s_u32DlogSize - 1;
+
+    do
+    {
+        u32Head = __LDREXW(&s_u32DlogHead);
+
+        if(s_u32DlogSize - (u32Head - s_u32DlogTail) < u32Num + DLOG_HDR_WORDS)
+        {
+            __CLREX();
+
+            do
+            {
+                u32Drop = __LDREXW(&s_u32DlogDrop);
+            }
+            while(__STREXW(u32Drop + 1, &s_u32DlogDrop));
+
+            return;
+        }
+    }
+    while(__STREXW(u32Head + u32Num + DLOG_HDR_WORDS, &s_u32DlogHead));
+
+    va_start(args, pcFmt);
+
+    for(i = 0; i < u32Num; i++)
+        pu32Buf[(u32Head + DLOG_HDR_WORDS + i) & u32Mask] = va_arg(args, uint32_t);
+
+    va_end(args);
+
+    pu32Buf[(u32Head + 1) & u32Mask] = (uint32_t)pcFmt;
+    pu32Buf[(u32Head + 2) & u32Mask] = u32Time;
+
+    /* The first word commits the record */
+    __DMB();
+    pu32Buf[u32Head & u32Mask] = DLOG_SYNC | (u32Num << 8) | (s_u32DlogDrop << 16);
+}
+
+/**
+ * @brief      Send stored log records
+ *
+ * @param      None
+ *
+ * @returns    Number of the records which are sent
+ *
+ * @details    This function sends what the debug port takes without waiting and returns. Call it from the main
+ *             loop or from one low priority interrupt, but not from both.
+ *             Records are sent in the order of their space in the ring. A record which is being written by an
+ *             interrupted DLOG() call holds back the records behind it until it is committed.
+ */
+uint32_t DLOG_Process(void)
+{
+    volatile uint32_t *pu32Buf = s_pu32DlogBuf;
+    uint32_t au32Rec[DLOG_HDR_WORDS + DLOG_MAX_ARGS];
+    uint32_t u32Mask, u32Tail, u32Len, u32Count = 0, i;
+    uint8_t *pu8Rec = (uint8_t *)au32Rec;
+
+    if(pu32Buf == NULL)
+        return 0;
+
+    u32Mask = s_u32DlogSize - 1;
+
+    while((u32Tail = s_u32DlogTail) != s_u32DlogHead)
+    {
+        if((pu32Buf[u32Tail & u32Mask] & 0xFF) != DLOG_SYNC)
+            break;
+
+        __DMB();
+        u32Len = ((pu32Buf[u32Tail & u32Mask] >> 8) & 0xFF) + DLOG_HDR_WORDS;
+
+        for(i = 0; i < u32Len; i++)
+            au32Rec[i] = pu32Buf[(u32Tail + i) & u32Mask];
+
+        if(DLOG_ASYNC())
+        {
+            /* Whole records only, so printf text never splits a record */
+            if(g_psDebugAsyncHook->pfnGetTxFree(g_psDebugAsync) < u32Len * 4)
+                break;
+
+            g_psDebugAsyncHook->pfnWrite(g_psDebugAsync, pu8Rec, u32Len * 4);
+        }
+        else
+        {
+            while(s_u32DlogSent < u32Len * 4)
+            {
+                if(DEBUG_PORT->FIFOSTS & UART_FIFOSTS_TXFULL_Msk)
+                    return u32Count;
+
+                DEBUG_PORT->DAT = pu8Rec[s_u32DlogSent++];
+            }
+
+            s_u32DlogSent = 0;
+        }
+
+        /* Clear the record before the space is released, so it cannot be taken for a committed record */
+        for(i = 0; i < u32Len; i++)
+            pu32Buf[(u32Tail + i) & u32Mask] = 0;
+
+        __DMB();
+        s_u32DlogTail = u32Tail + u32Len;
+        u32Count++;
+    }
+
+    return u32Count;
+}
+
+/**
+ * @brief      Send all stored log records
+ *
+ * @param      None
+ *
+ * @returns    None
+ *
+ * @details    This function waits until every committed record is sent out of the debug port.
+ *             Call it before the chip enters power-down or resets.
+ */
+void DLOG_Flush(void)
+{
+    if(s_pu32DlogBuf == NULL)
+        return;
+
+    while(s_u32DlogTail != s_u32DlogHead)
+    {
+        if((s_pu32DlogBuf[s_u32DlogTail & (s_u32DlogSize - 1)] & 0xFF) != DLOG_SYNC)
+            break;
+
+        /* Let the PDMA interrupt drain the TX ring if nothing fits */
+        if((DLOG_Process() == 0) && DLOG_ASYNC())
+            g_psDebugAsyncHook->pfnFlush(g_psDebugAsync);
+    }
+
+    if(DLOG_ASYNC())
+        g_psDebugAsyncHook->pfnFlush(g_psDebugAsync);
+
+    while((DEBUG_PORT->FIFOSTS & UART_FIFOSTS_TXEMPTYF_Msk) == 0U) {}
+}
+
+/**
+ * @brief      Get the number of dropped log records
+ *
+ * @param      None
+ *
+ * @returns    Number of the records which did not fit in the log ring since DLOG_Open()
+ */
+uint32_t DLOG_GetDropCount(void)
+{
+    return s_u32DlogDrop;
+}
+
+/*@}*/ /* end of group DLOG_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group DLOG_Driver */
+
+/*@}*/ /* end of group Standard_Driver */
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
@@ -287,6 +287,181 @@ int32_t FMC_WriteConfig(uint32_t *u32Config, uint32_t u32Count)
     return i32ret;
 }
 
+/**
+  * @brief      Program Multi-Word data into specified address of flash
+  *
+  * @param[in]  u32Addr  Start address of flash. It must be word aligned.
+  * @param[in]  pu32Buf  A data pointer is point to a data buffer start address.
+  * @param[in]  u32Len   Byte count to program. It must be multiple of 4.
+  *
+  * @retval      0 Success
+  * @retval     -1 Failed
+  *
+  * @details    Each 256 bytes aligned block is programmed by multi-word program (FMC_Write256).
+  *             The unaligned head and tail are programmed by 64-bit program (FMC_Write8) if they
+  *             are 8 bytes aligned, otherwise by 32-bit program (FMC_Write).
+  *             APROM or LDROM update must be enabled before programming them.
+  *
+  * @note       Global error code g_FMC_i32ErrCode
+  *             -1  Program failed or time-out
+  */
+int32_t FMC_WriteMultiple(uint32_t u32Addr, uint32_t *pu32Buf, uint32_t u32Len)
+{
+    int32_t i32Ret;
+
+    while(u32Len > 0)
+    {
+        if(((u32Addr & (FMC_MULTI_WORD_PROG_LEN - 1)) == 0) && (u32Len >= FMC_MULTI_WORD_PROG_LEN))
+        {
+            i32Ret = FMC_Write256(u32Addr, pu32Buf);
+            u32Addr += FMC_MULTI_WORD_PROG_LEN;
+            pu32Buf += FMC_MULTI_WORD_PROG_LEN / 4;
+            u32Len -= FMC_MULTI_WORD_PROG_LEN;
+        }
+        else if(((u32Addr & 0x7) == 0) && (u32Len >= 8))
+        {
+            i32Ret = FMC_Write8(u32Addr, pu32Buf[0], pu32Buf[1]);
+            u32Addr += 8;
+            pu32Buf += 2;
+            u32Len -= 8;
+        }
+        else
+        {
+            i32Ret = FMC_Write(u32Addr, pu32Buf[0]);
+            u32Addr += 4;
+            pu32Buf++;
+            u32Len -= 4;
+        }
+
+        if(i32Ret != 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+/* Read one word for FMC_UpdatePage(). APROM and Data Flash are read by ISP command when booting from LDROM. */
+static uint32_t FMC_ReadPageWord(uint32_t u32Addr, int32_t i32Isp)
+{
+    return i32Isp ? FMC_Read(u32Addr) : *(volatile uint32_t *)u32Addr;
+}
+
+/* FMC_GetCheckSum() is taken as CRC-32 of the page like this. Cleared if a page proves otherwise. */
+static uint32_t s_u32FmcCrcCheckSum = 1;
+
+/* CRC-32 of a page in SRAM by the CRC controller */
+static uint32_t FMC_PageCrc32(uint32_t *pu32Buf)
+{
+    uint8_t *pu8Buf = (uint8_t *)pu32Buf;
+    uint32_t i;
+
+    CLK->AHBCLK |= CLK_AHBCLK_CRCCKEN_Msk;
+    CRC->SEED = 0xFFFFFFFF;
+    CRC->CTL = CRC_32 | CRC_WDATA_RVS | CRC_CHECKSUM_RVS | CRC_CHECKSUM_COM | CRC_CPU_WDATA_8 | CRC_CTL_CRCEN_Msk;
+    CRC->CTL |= CRC_CTL_CRCRST_Msk;
+
+    /* Byte writes keep the byte order of flash */
+    for(i = 0; i < FMC_FLASH_PAGE_SIZE; i++)
+        CRC->DAT = pu8Buf[i];
+
+    return CRC->CHECKSUM;
+}
+
+/**
+  * @brief      Update a flash page only when its content changes
+  *
+  * @param[in]  u32PageAddr  Page aligned address of APROM or Data Flash.
+  * @param[in]  pu32Buf      New data of the whole page (FMC_FLASH_PAGE_SIZE bytes).
+  *
+  * @retval      1 Page content is the same. Nothing is erased or programmed.
+  * @retval      0 Page is updated and verified.
+  * @retval     -1 Failed
+  *
+  * @details    The page is compared with new data through the memory-mapped flash, or by ISP read when the
+  *             chip boots from LDROM. If all the changed words are still erased, only these words are
+  *             programmed. Otherwise the page is erased and programmed by FMC_WriteMultiple().
+  *             When booting from LDROM, the page is verified by the FMC checksum command against a CRC-32 of
+  *             the new data from the CRC controller, so it isn't read again word by word. If the checksum
+  *             doesn't match the CRC-32 but the words do, the checksum is not used any more.
+  *             APROM update must be enabled before updating APROM.
+  *
+  * @note       Global error code g_FMC_i32ErrCode
+  *             -1  Erase or program failed, or verify failed
+  */
+int32_t FMC_UpdatePage(uint32_t u32PageAddr, uint32_t *pu32Buf)
+{
+    uint32_t au32Changed[FMC_FLASH_PAGE_SIZE / 4 / 32];
+    uint32_t i, u32Data, u32Changed = 0, u32Erase = 0, u32Crc = 0;
+    int32_t i32Isp = FMC_GetBootSource(), i32CheckSum = 0;
+
+    if(i32Isp && s_u32FmcCrcCheckSum)
+    {
+        u32Crc = FMC_PageCrc32(pu32Buf);
+        i32CheckSum = 1;
+    }
+
+    for(i = 0; i < FMC_FLASH_PAGE_SIZE / 4 / 32; i++)
+        au32Changed[i] = 0;
+
+    for(i = 0; i < FMC_FLASH_PAGE_SIZE / 4; i++)
+    {
+        u32Data = FMC_ReadPageWord(u32PageAddr + i * 4, i32Isp);
+        if(u32Data != pu32Buf[i])
+        {
+            u32Changed = 1;
+            au32Changed[i / 32] |= (1UL << (i % 32));
+            if(u32Data != 0xFFFFFFFF)
+            {
+                u32Erase = 1;
+                break;
+            }
+        }
+    }
+
+    g_FMC_i32ErrCode = 0;
+
+    if(u32Changed == 0)
+        return 1;
+
+    if(u32Erase)
+    {
+        if((FMC_Erase(u32PageAddr) != 0) || (FMC_WriteMultiple(u32PageAddr, pu32Buf, FMC_FLASH_PAGE_SIZE) != 0))
+            return -1;
+    }
+    else
+    {
+        /* Program the changed words only. The others are already the same. */
+        for(i = 0; i < FMC_FLASH_PAGE_SIZE / 4; i++)
+        {
+            if((au32Changed[i / 32] & (1UL << (i % 32))) && (FMC_Write(u32PageAddr + i * 4, pu32Buf[i]) != 0))
+                return -1;
+        }
+    }
+
+    if(i32CheckSum && (FMC_GetCheckSum(u32PageAddr, FMC_FLASH_PAGE_SIZE) == u32Crc))
+    {
+        g_FMC_i32ErrCode = 0;
+        return 0;
+    }
+
+    for(i = 0; i < FMC_FLASH_PAGE_SIZE / 4; i++)
+    {
+        if(FMC_ReadPageWord(u32PageAddr + i * 4, i32Isp) != pu32Buf[i])
+        {
+            g_FMC_i32ErrCode = -1;
+            return -1;
+        }
+    }
+
+    /* The words match, so the checksum isn't the CRC-32 of FMC_PageCrc32() */
+    if(i32CheckSum)
+        s_u32FmcCrcCheckSum = 0;
+
+    g_FMC_i32ErrCode = 0;
+
+    return 0;
+}
+
 /**
  * @brief      Enable Flash Access Frequency  Optimization Mode
  *
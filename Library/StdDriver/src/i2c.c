@@ -636,6 +636,277 @@ void I2C_SMBusClockLoTimeout(I2C_T *i2c, uint32_t ms, uint32_t u32Pclk)
     i2c->CLKTOUT = (((ms * u32Pclk_kHz) / (16 * 1024 * 4)) - 1) & 0xFF; //The max value is 255
 }
 
+
+/// @cond HIDDEN_SYMBOLS
+
+/* Finish the head transaction with a STOP, or just release the bus after arbitration lost, and start the next one */
+static void I2C_QueueEnd(I2C_QUEUE_T *psQueue, int32_t i32Status, uint32_t u32Ctl)
+{
+    I2C_QXFER_T *psXfer = psQueue->psHead;
+
+    psQueue->psHead = psXfer->psNext;
+
+    if(psQueue->psHead)
+    {
+        /* STOP is sent before START if both are set */
+        psQueue->psHead->u32Msg = 0;
+        psQueue->psHead->u32Pos = 0;
+        psQueue->psHead->i32Status = I2C_QXFER_BUSY;
+        u32Ctl |= I2C_CTL_STA;
+    }
+    else
+    {
+        psQueue->psTail = NULL;
+    }
+
+    I2C_SET_CONTROL_REG(psQueue->i2c, u32Ctl);
+
+    psXfer->i32Status = i32Status;
+
+    if(psXfer->pfnDone)
+        psXfer->pfnDone(psXfer);
+}
+
+/* Go on with the next message by repeated START, or finish the transaction */
+static void I2C_QueueNextMsg(I2C_QUEUE_T *psQueue)
+{
+    I2C_QXFER_T *psXfer = psQueue->psHead;
+
+    psXfer->u32Pos = 0;
+
+    if(++psXfer->u32Msg < psXfer->u32MsgNum)
+        I2C_SET_CONTROL_REG(psQueue->i2c, I2C_CTL_STA_SI);
+    else
+        I2C_QueueEnd(psQueue, I2C_QXFER_DONE, I2C_CTL_STO_SI);
+}
+
+/* Wait for an interrupt while psXfer is pending. Where the I2C interrupt can't preempt, do its work instead.
+   The status is checked with interrupts masked, so an interrupt just before WFI still wakes the CPU. */
+static void I2C_QueueSleep(I2C_QUEUE_T *psQueue, I2C_QXFER_T *psXfer)
+{
+    uint32_t u32Primask = __get_PRIMASK();
+
+    __disable_irq();
+
+    if(__get_IPSR() || u32Primask)
+    {
+        I2C_QueueIRQHandler(psQueue);
+        __set_PRIMASK(u32Primask);
+    }
+    else
+    {
+        if(psXfer->i32Status > 0)
+            __WFI();
+
+        __enable_irq();
+    }
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+/**
+  * @brief      Open the message queue of an I2C port
+  *
+  * @param[in]  psQueue     Queue state. It must stay valid while the port is used.
+  * @param[in]  i2c         Specify I2C port. I2C_Open() must have set its bus clock.
+  *
+  * @return     None
+  *
+  * @details    The I2C interrupt is enabled. I2Cn_IRQHandler() must call I2C_QueueIRQHandler().
+  *
+  */
+void I2C_QueueOpen(I2C_QUEUE_T *psQueue, I2C_T *i2c)
+{
+    psQueue->i2c = i2c;
+    psQueue->psHead = NULL;
+    psQueue->psTail = NULL;
+
+    I2C_EnableInt(i2c);
+    NVIC_EnableIRQ((i2c == I2C0) ? I2C0_IRQn : I2C1_IRQn);
+}
+
+/**
+  * @brief      Add a transaction to a queue
+  *
+  * @param[in]  psQueue     Queue of the I2C port
+  * @param[in]  psXfer      Transaction. It and its messages and buffers must stay valid until it is done.
+  *
+  * @retval     0           The transaction is queued
+  * @retval     -1          It has no message, or a read message is empty
+  *
+  * @details    The transaction starts at once if the queue is empty. It can be called from the pfnDone callback,
+  *             so a callback can chain the next transaction without CPU polling.
+  *
+  */
+int32_t I2C_QueueSubmit(I2C_QUEUE_T *psQueue, I2C_QXFER_T *psXfer)
+{
+    uint32_t u32Primask, i;
+
+    if(psXfer->u32MsgNum == 0)
+        return -1;
+
+    for(i = 0; i < psXfer->u32MsgNum; i++)
+    {
+        if((psXfer->psMsg[i].u8Flags & I2C_QMSG_RD) && (psXfer->psMsg[i].u16Len == 0))
+            return -1;
+    }
+
+    psXfer->u32Msg = 0;
+    psXfer->u32Pos = 0;
+    psXfer->psNext = NULL;
+
+    u32Primask = __get_PRIMASK();
+    __disable_irq();
+
+    if(psQueue->psTail)
+    {
+        psXfer->i32Status = I2C_QXFER_QUEUED;
+        psQueue->psTail->psNext = psXfer;
+        psQueue->psTail = psXfer;
+    }
+    else
+    {
+        psXfer->i32Status = I2C_QXFER_BUSY;
+        psQueue->psHead = psXfer;
+        psQueue->psTail = psXfer;
+
+        /* A STOP requested by the last transaction is kept. It is sent before START. */
+        I2C_START(psQueue->i2c);
+    }
+
+    __set_PRIMASK(u32Primask);
+
+    return 0;
+}
+
+/**
+  * @brief      Wait for a transaction
+  *
+  * @param[in]  psQueue     Queue of the I2C port
+  * @param[in]  psXfer      A submitted transaction
+  *
+  * @return     I2C_QXFER_DONE, I2C_QXFER_NACK, I2C_QXFER_BUS_ERR or I2C_QXFER_TIMEOUT
+  *
+  * @details    The CPU sleeps until the transaction is done. It can be called with interrupts masked.
+  *
+  */
+int32_t I2C_QueueWait(I2C_QUEUE_T *psQueue, I2C_QXFER_T *psXfer)
+{
+    while(psXfer->i32Status > 0)
+        I2C_QueueSleep(psQueue, psXfer);
+
+    return psXfer->i32Status;
+}
+
+/**
+  * @brief      Run a transaction and wait for it
+  *
+  * @param[in]  psQueue     Queue of the I2C port
+  * @param[in]  psXfer      Transaction
+  *
+  * @return     I2C_QXFER_DONE, I2C_QXFER_NACK, I2C_QXFER_BUS_ERR, I2C_QXFER_TIMEOUT, or -1 if it is invalid
+  *
+  */
+int32_t I2C_QueueTransfer(I2C_QUEUE_T *psQueue, I2C_QXFER_T *psXfer)
+{
+    if(I2C_QueueSubmit(psQueue, psXfer) < 0)
+        return -1;
+
+    return I2C_QueueWait(psQueue, psXfer);
+}
+
+/**
+  * @brief      I2C interrupt service of a queue
+  *
+  * @param[in]  psQueue     Queue of the I2C port
+  *
+  * @return     None
+  *
+  * @details    Call it from I2Cn_IRQHandler(). Every bus event of a transaction is handled here from the status
+  *             code. A failed transaction ends with STOP and the next one still starts.
+  *
+  */
+void I2C_QueueIRQHandler(I2C_QUEUE_T *psQueue)
+{
+    I2C_T *i2c = psQueue->i2c;
+    I2C_QXFER_T *psXfer = psQueue->psHead;
+    I2C_QMSG_T *psMsg;
+    uint32_t u32Status;
+
+    if(I2C_GET_TIMEOUT_FLAG(i2c))
+    {
+        I2C_ClearTimeoutFlag(i2c);
+
+        if(psXfer)
+            I2C_QueueEnd(psQueue, I2C_QXFER_TIMEOUT, I2C_CTL_STO_SI);
+
+        return;
+    }
+
+    if(!(i2c->CTL & I2C_CTL_SI_Msk))
+        return;
+
+    if(psXfer == NULL)
+    {
+        I2C_SET_CONTROL_REG(i2c, I2C_CTL_SI);
+        return;
+    }
+
+    psMsg = &psXfer->psMsg[psXfer->u32Msg];
+    u32Status = I2C_GET_STATUS(i2c);
+
+    switch(u32Status)
+    {
+        case 0x08:                              /* START has been transmitted */
+        case 0x10:                              /* Repeat START has been transmitted */
+            I2C_SET_DATA(i2c, (psMsg->u8Addr << 1) | (psMsg->u8Flags & I2C_QMSG_RD));
+            I2C_SET_CONTROL_REG(i2c, I2C_CTL_SI);
+            break;
+
+        case 0x18:                              /* SLA+W has been transmitted and ACK has been received */
+        case 0x28:                              /* DATA has been transmitted and ACK has been received */
+            if(psXfer->u32Pos < psMsg->u16Len)
+            {
+                I2C_SET_DATA(i2c, psMsg->pu8Buf[psXfer->u32Pos++]);
+                I2C_SET_CONTROL_REG(i2c, I2C_CTL_SI);
+            }
+            else
+            {
+                I2C_QueueNextMsg(psQueue);
+            }
+            break;
+
+        case 0x40:                              /* SLA+R has been transmitted and ACK has been received */
+            /* NACK is returned for the last byte */
+            I2C_SET_CONTROL_REG(i2c, (psMsg->u16Len > 1) ? I2C_CTL_SI_AA : I2C_CTL_SI);
+            break;
+
+        case 0x50:                              /* DATA has been received and ACK has been returned */
+        case 0x58:                              /* DATA has been received and NACK has been returned */
+            psMsg->pu8Buf[psXfer->u32Pos++] = (uint8_t)I2C_GET_DATA(i2c);
+
+            if((u32Status == 0x58) || (psXfer->u32Pos >= psMsg->u16Len))
+                I2C_QueueNextMsg(psQueue);
+            else
+                I2C_SET_CONTROL_REG(i2c, (psMsg->u16Len - psXfer->u32Pos > 1) ? I2C_CTL_SI_AA : I2C_CTL_SI);
+            break;
+
+        case 0x20:                              /* SLA+W has been transmitted and NACK has been received */
+        case 0x30:                              /* DATA has been transmitted and NACK has been received */
+        case 0x48:                              /* SLA+R has been transmitted and NACK has been received */
+            I2C_QueueEnd(psQueue, I2C_QXFER_NACK, I2C_CTL_STO_SI);
+            break;
+
+        case 0x38:                              /* Arbitration lost. The bus belongs to another master */
+            I2C_QueueEnd(psQueue, I2C_QXFER_BUS_ERR, I2C_CTL_SI);
+            break;
+
+        default:                                /* Bus error or a slave mode event */
+            I2C_QueueEnd(psQueue, I2C_QXFER_BUS_ERR, I2C_CTL_STO_SI);
+            break;
+    }
+}
+
 /*@}*/ /* end of group I2C_EXPORTED_FUNCTIONS */
 
 /*@}*/ /* end of group I2C_Driver */
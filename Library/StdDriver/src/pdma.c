@@ -14,6 +14,13 @@
 
 static uint8_t u32ChSelect[PDMA_CH_MAX];
 
+/* Channel manager */
+static uint32_t s_u32ChUsed;            /* Channels allocated or reserved */
+static uint32_t s_u32ChManaged;         /* Channels of PDMA_AllocChannel() */
+static PDMA_CALLBACK_T s_apfnCallback[PDMA_CH_MAX];
+static void *s_apvArg[PDMA_CH_MAX];
+static PDMA_CHAIN_T *s_apsChain[PDMA_CH_MAX];
+
 /** @addtogroup Standard_Driver Standard Driver
   @{
 */
@@ -389,6 +396,613 @@ void PDMA_DisableInt(uint32_t u32Ch, uint32_t u32Mask)
     }
 }
 
+/* Start a channel at a descriptor of its chain */
+static void PDMA_ChainRun(uint32_t u32Ch, PDMA_DESC_T *psDesc)
+{
+    PDMA->DSCT[u32Ch].CTL = PDMA_OP_SCATTER;
+    PDMA->DSCT[u32Ch].NEXT = (uint32_t)psDesc - PDMA->SCATBA;
+    PDMA->CHCTL |= (1UL << u32Ch);
+    PDMA_Trigger(u32Ch);
+}
+
+/* Report the finished descriptors of a running chain and re-arm them if the chain is circular */
+static void PDMA_ChainUpdate(uint32_t u32Ch, PDMA_CHAIN_T *psChain)
+{
+    PDMA_DESC_T *psDesc;
+    uint32_t u32Event, i;
+
+    for(i = 0; i < psChain->u32Num; i++)
+    {
+        psDesc = psChain->psCur;
+
+        /* PDMA writes a descriptor back as idle when it is finished. The last descriptor of a linear chain
+           is finished when the channel is idle. */
+        if(psDesc->u32Ctl & PDMA_DSCT_CTL_OPMODE_Msk)
+        {
+            if(psChain->u32Loop || (psDesc != psChain->psLast) ||
+                    (PDMA->DSCT[u32Ch].CTL & PDMA_DSCT_CTL_OPMODE_Msk))
+                break;
+        }
+
+        u32Event = PDMA_EVT_DESC;
+
+        if(psChain->u32Loop || (psDesc != psChain->psLast))
+        {
+            psChain->psCur = psDesc->psLink;
+        }
+        else
+        {
+            /* Detach the chain first, so that the callback can start the channel again */
+            u32Event |= PDMA_EVT_DONE;
+            psChain->psCur = NULL;
+            psChain->u32Ch = PDMA_NO_CH;
+            s_apsChain[u32Ch] = NULL;
+        }
+
+        if(((psDesc->u32Reload & PDMA_DSCT_CTL_TBINTDIS_Msk) == 0) && s_apfnCallback[u32Ch])
+            s_apfnCallback[u32Ch](s_apvArg[u32Ch], u32Ch, u32Event, psDesc);
+
+        /* Chain is finished, or the callback stopped it */
+        if(s_apsChain[u32Ch] != psChain)
+            return;
+
+        if(psChain->u32Loop)
+            psDesc->u32Ctl = psDesc->u32Reload;
+    }
+
+    /* Channel stopped at a descriptor which wasn't re-armed. All descriptors are armed again now. */
+    if(psChain->u32Loop && ((PDMA->DSCT[u32Ch].CTL & PDMA_DSCT_CTL_OPMODE_Msk) == 0))
+    {
+        psChain->u32Overrun++;
+        PDMA_ChainRun(u32Ch, psChain->psCur);
+    }
+}
+
+/**
+ * @brief       Allocate a Channel
+ *
+ * @param[in]   u32Peripheral   The request source like \ref PDMA_UART0_TX, or \ref PDMA_MEM
+ * @param[in]   pfnCallback     Called by PDMA_ChannelIRQHandler() on the events of the channel. Can be NULL.
+ * @param[in]   pvArg           First argument of pfnCallback
+ *
+ * @return      The channel, or \ref PDMA_ERR_NO_CH if all channels are in use
+ *
+ * @details     This function takes the lowest free channel, enables it with the request source and enables
+ *              its transfer done interrupt. The application calls PDMA_ChannelIRQHandler() from
+ *              PDMA_IRQHandler(). Drivers which use fixed channels call PDMA_ReserveChannels() first.
+ */
+int32_t PDMA_AllocChannel(uint32_t u32Peripheral, PDMA_CALLBACK_T pfnCallback, void *pvArg)
+{
+    volatile uint32_t *pu32ReqSel;
+    uint32_t u32Primask, u32Ch, u32Pos;
+
+    u32Primask = __get_PRIMASK();
+    __disable_irq();
+
+    for(u32Ch = 0; u32Ch < PDMA_CH_MAX; u32Ch++)
+    {
+        if((s_u32ChUsed & (1UL << u32Ch)) == 0)
+            break;
+    }
+
+    if(u32Ch == PDMA_CH_MAX)
+    {
+        __set_PRIMASK(u32Primask);
+        return PDMA_ERR_NO_CH;
+    }
+
+    s_u32ChUsed |= (1UL << u32Ch);
+    s_u32ChManaged |= (1UL << u32Ch);
+    s_apfnCallback[u32Ch] = pfnCallback;
+    s_apvArg[u32Ch] = pvArg;
+    s_apsChain[u32Ch] = NULL;
+
+    CLK->AHBCLK |= CLK_AHBCLK_PDMACKEN_Msk;
+    PDMA_Open(1UL << u32Ch);
+
+    /* Same as PDMA_SetTransferMode() without touching the channel descriptor */
+    u32ChSelect[u32Ch] = (uint8_t)u32Peripheral;
+    pu32ReqSel = &PDMA->REQSEL0_3 + (u32Ch / 4);
+    u32Pos = (u32Ch % 4) * 8;
+    *pu32ReqSel = (*pu32ReqSel & ~(0x1FUL << u32Pos)) | (u32Peripheral << u32Pos);
+
+    PDMA->TDSTS = (1UL << u32Ch);
+    PDMA->ABTSTS = (1UL << u32Ch);
+    PDMA->INTEN |= (1UL << u32Ch);
+
+    __set_PRIMASK(u32Primask);
+
+    NVIC_EnableIRQ(PDMA_IRQn);
+
+    return (int32_t)u32Ch;
+}
+
+/**
+ * @brief       Reserve Fixed Channels
+ *
+ * @param[in]   u32Mask     Channel bits
+ *
+ * @retval      0                   Success
+ * @retval      PDMA_ERR_PARAM      No such channel
+ * @retval      PDMA_ERR_BUSY       A channel is in use
+ *
+ * @details     This function keeps PDMA_AllocChannel() away from channels which a driver uses directly.
+ *              UART_AsyncOpen(), SPI_QueueOpen() and ISP_Open() call it for their fixed channels, so two
+ *              drivers can't share one. PDMA_ChannelIRQHandler() doesn't touch them.
+ */
+int32_t PDMA_ReserveChannels(uint32_t u32Mask)
+{
+    uint32_t u32Primask;
+
+    if(u32Mask >> PDMA_CH_MAX)
+        return PDMA_ERR_PARAM;
+
+    u32Primask = __get_PRIMASK();
+    __disable_irq();
+
+    if(s_u32ChUsed & u32Mask)
+    {
+        __set_PRIMASK(u32Primask);
+        return PDMA_ERR_BUSY;
+    }
+
+    s_u32ChUsed |= u32Mask;
+
+    __set_PRIMASK(u32Primask);
+
+    return 0;
+}
+
+/**
+ * @brief       Free a Channel
+ *
+ * @param[in]   u32Ch       The allocated or reserved channel
+ *
+ * @return      None
+ *
+ * @details     This function stops an allocated channel at once and disables its interrupts. A reserved
+ *              channel only becomes free.
+ */
+void PDMA_FreeChannel(uint32_t u32Ch)
+{
+    uint32_t u32Primask, u32Bit = 1UL << u32Ch;
+
+    if(u32Ch >= PDMA_CH_MAX)
+        return;
+
+    u32Primask = __get_PRIMASK();
+    __disable_irq();
+
+    if(s_u32ChManaged & u32Bit)
+    {
+        PDMA->INTEN &= ~u32Bit;
+        PDMA->TOUTIEN &= ~u32Bit;
+        PDMA->TOUTEN &= ~u32Bit;
+        PDMA->STOP = u32Bit;
+        PDMA->CHCTL &= ~u32Bit;
+        PDMA->TDSTS = u32Bit;
+        PDMA->ABTSTS = u32Bit;
+        PDMA->SCATSTS = u32Bit;
+
+        if(s_apsChain[u32Ch])
+        {
+            s_apsChain[u32Ch]->u32Ch = PDMA_NO_CH;
+            s_apsChain[u32Ch] = NULL;
+        }
+
+        s_apfnCallback[u32Ch] = NULL;
+    }
+
+    s_u32ChUsed &= ~u32Bit;
+    s_u32ChManaged &= ~u32Bit;
+
+    __set_PRIMASK(u32Primask);
+}
+
+/**
+ * @brief       Initialize a Descriptor Pool
+ *
+ * @param[in]   psPool      The pool
+ * @param[in]   psDesc      Descriptor array in SRAM
+ * @param[in]   u32Num      Descriptors of the array
+ *
+ * @return      None
+ *
+ * @details     Chains of several channels can share one pool.
+ */
+void PDMA_PoolInit(PDMA_POOL_T *psPool, PDMA_DESC_T *psDesc, uint32_t u32Num)
+{
+    uint32_t i;
+
+    psPool->psFree = NULL;
+    psPool->u32FreeNum = 0;
+
+    for(i = 0; i < u32Num; i++)
+        PDMA_PoolFree(psPool, &psDesc[i]);
+}
+
+/**
+ * @brief       Take a Descriptor from the Pool
+ *
+ * @param[in]   psPool      The pool
+ *
+ * @return      The descriptor, or NULL if the pool is empty
+ *
+ * @details     This function can be called in interrupt handlers.
+ */
+PDMA_DESC_T *PDMA_PoolAlloc(PDMA_POOL_T *psPool)
+{
+    PDMA_DESC_T *psDesc;
+    uint32_t u32Primask;
+
+    u32Primask = __get_PRIMASK();
+    __disable_irq();
+
+    psDesc = psPool->psFree;
+
+    if(psDesc)
+    {
+        psPool->psFree = psDesc->psLink;
+        psPool->u32FreeNum--;
+        psDesc->psLink = NULL;
+    }
+
+    __set_PRIMASK(u32Primask);
+
+    return psDesc;
+}
+
+/**
+ * @brief       Give a Descriptor back to the Pool
+ *
+ * @param[in]   psPool      The pool
+ * @param[in]   psDesc      The descriptor
+ *
+ * @return      None
+ *
+ * @details     This function can be called in interrupt handlers.
+ */
+void PDMA_PoolFree(PDMA_POOL_T *psPool, PDMA_DESC_T *psDesc)
+{
+    uint32_t u32Primask;
+
+    u32Primask = __get_PRIMASK();
+    __disable_irq();
+
+    psDesc->u32Ctl = 0;
+    psDesc->psLink = psPool->psFree;
+    psPool->psFree = psDesc;
+    psPool->u32FreeNum++;
+
+    __set_PRIMASK(u32Primask);
+}
+
+/**
+ * @brief       Initialize an Empty Chain
+ *
+ * @param[in]   psChain     The chain
+ * @param[in]   psPool      Pool of the descriptors of the chain
+ *
+ * @return      None
+ */
+void PDMA_ChainInit(PDMA_CHAIN_T *psChain, PDMA_POOL_T *psPool)
+{
+    psChain->psPool = psPool;
+    psChain->psFirst = NULL;
+    psChain->psLast = NULL;
+    psChain->psCur = NULL;
+    psChain->u32Num = 0;
+    psChain->u32Loop = 0;
+    psChain->u32Ch = PDMA_NO_CH;
+    psChain->u32Overrun = 0;
+}
+
+/**
+ * @brief       Append a Transfer to a Chain
+ *
+ * @param[in]   psChain         The chain which isn't running or circular
+ * @param[in]   u32SrcAddr      Source address
+ * @param[in]   u32DstAddr      Destination address
+ * @param[in]   u32TransCount   Transfer count. It can exceed \ref PDMA_MAX_TRANS_CNT.
+ * @param[in]   u32Ctl          Combination of
+ *                - \ref PDMA_WIDTH_8, \ref PDMA_WIDTH_16 or \ref PDMA_WIDTH_32
+ *                - \ref PDMA_SAR_INC or \ref PDMA_SAR_FIX
+ *                - \ref PDMA_DAR_INC or \ref PDMA_DAR_FIX
+ *                - \ref PDMA_REQ_SINGLE or \ref PDMA_REQ_BURST with PDMA_BURST_xxx
+ *                - \ref PDMA_TBINT_DISABLE if the entry has no event
+ *
+ * @return      Descriptors of the entry, or PDMA_ERR_xxx
+ *
+ * @details     An entry longer than \ref PDMA_MAX_TRANS_CNT takes several descriptors with the incremented
+ *              addresses moved forward. Only the last descriptor of the entry raises the event, and it is
+ *              psDesc of the callback. If the pool runs out, the chain is left as it was.
+ */
+int32_t PDMA_ChainAdd(PDMA_CHAIN_T *psChain, uint32_t u32SrcAddr, uint32_t u32DstAddr, uint32_t u32TransCount,
+                      uint32_t u32Ctl)
+{
+    PDMA_DESC_T *psDesc, *psFirst = NULL, *psLast = NULL;
+    uint32_t u32Size, u32Cnt, u32Num = 0;
+
+    if((u32TransCount == 0) || psChain->u32Loop)
+        return PDMA_ERR_PARAM;
+
+    if(psChain->u32Ch != PDMA_NO_CH)
+        return PDMA_ERR_BUSY;
+
+    u32Ctl &= (PDMA_DSCT_CTL_TXTYPE_Msk | PDMA_DSCT_CTL_BURSIZE_Msk | PDMA_DSCT_CTL_TBINTDIS_Msk |
+               PDMA_DSCT_CTL_SAINC_Msk | PDMA_DSCT_CTL_DAINC_Msk | PDMA_DSCT_CTL_TXWIDTH_Msk);
+    u32Size = 1UL << ((u32Ctl & PDMA_DSCT_CTL_TXWIDTH_Msk) >> PDMA_DSCT_CTL_TXWIDTH_Pos);
+
+    while(u32TransCount)
+    {
+        psDesc = PDMA_PoolAlloc(psChain->psPool);
+
+        if(psDesc == NULL)
+        {
+            while(psFirst)
+            {
+                psDesc = psFirst->psLink;
+                PDMA_PoolFree(psChain->psPool, psFirst);
+                psFirst = psDesc;
+            }
+
+            return PDMA_ERR_NO_DESC;
+        }
+
+        u32Cnt = (u32TransCount > PDMA_MAX_TRANS_CNT) ? PDMA_MAX_TRANS_CNT : u32TransCount;
+
+        /* The descriptor is armed and linked by PDMA_ChainStart() */
+        psDesc->u32Reload = ((u32Cnt - 1) << PDMA_DSCT_CTL_TXCNT_Pos) | u32Ctl;
+        psDesc->u32Src = u32SrcAddr;
+        psDesc->u32Dst = u32DstAddr;
+        psDesc->u32Next = 0;
+
+        if(psLast)
+        {
+            psLast->u32Reload |= PDMA_DSCT_CTL_TBINTDIS_Msk;
+            psLast->psLink = psDesc;
+        }
+        else
+            psFirst = psDesc;
+
+        psLast = psDesc;
+        u32Num++;
+
+        if((u32Ctl & PDMA_DSCT_CTL_SAINC_Msk) != PDMA_SAR_FIX)
+            u32SrcAddr += u32Cnt * u32Size;
+
+        if((u32Ctl & PDMA_DSCT_CTL_DAINC_Msk) != PDMA_DAR_FIX)
+            u32DstAddr += u32Cnt * u32Size;
+
+        u32TransCount -= u32Cnt;
+    }
+
+    if(psChain->psLast)
+        psChain->psLast->psLink = psFirst;
+    else
+        psChain->psFirst = psFirst;
+
+    psChain->psLast = psLast;
+    psChain->u32Num += u32Num;
+
+    return (int32_t)u32Num;
+}
+
+/**
+ * @brief       Close a Chain into a Circle
+ *
+ * @param[in]   psChain     The chain which isn't running, with 2 descriptors at least
+ *
+ * @retval      0                   Success
+ * @retval      PDMA_ERR_PARAM      Too few descriptors, or the chain is circular already
+ * @retval      PDMA_ERR_BUSY       The chain is running
+ *
+ * @details     The last descriptor links to the first one. Every descriptor is re-armed after its callback
+ *              returns, so the callback can change u32Src and u32Dst of psDesc for the next round. Two
+ *              entries of the same size make a ping-pong buffer.
+ */
+int32_t PDMA_ChainLoop(PDMA_CHAIN_T *psChain)
+{
+    if((psChain->u32Num < 2) || psChain->u32Loop)
+        return PDMA_ERR_PARAM;
+
+    if(psChain->u32Ch != PDMA_NO_CH)
+        return PDMA_ERR_BUSY;
+
+    psChain->psLast->psLink = psChain->psFirst;
+    psChain->u32Loop = 1;
+
+    return 0;
+}
+
+/**
+ * @brief       Start a Chain
+ *
+ * @param[in]   psChain     The chain
+ * @param[in]   u32Ch       Channel from PDMA_AllocChannel()
+ *
+ * @retval      0                   Success
+ * @retval      PDMA_ERR_PARAM      The channel isn't allocated or the chain is empty
+ * @retval      PDMA_ERR_BUSY       The chain or another chain runs on the channel
+ *
+ * @details     This function arms all descriptors and starts the channel. A memory to memory channel is
+ *              triggered by software. A finished linear chain can be started again.
+ */
+int32_t PDMA_ChainStart(PDMA_CHAIN_T *psChain, uint32_t u32Ch)
+{
+    PDMA_DESC_T *psDesc;
+    uint32_t u32Primask, i;
+
+    if((u32Ch >= PDMA_CH_MAX) || ((s_u32ChManaged & (1UL << u32Ch)) == 0) || (psChain->u32Num == 0))
+        return PDMA_ERR_PARAM;
+
+    u32Primask = __get_PRIMASK();
+    __disable_irq();
+
+    if((psChain->u32Ch != PDMA_NO_CH) || s_apsChain[u32Ch])
+    {
+        __set_PRIMASK(u32Primask);
+        return PDMA_ERR_BUSY;
+    }
+
+    /* The last descriptor of a linear chain always raises the event */
+    psDesc = psChain->psFirst;
+
+    for(i = 0; i < psChain->u32Num; i++)
+    {
+        psDesc->u32Reload &= ~PDMA_DSCT_CTL_OPMODE_Msk;
+
+        if(psDesc->psLink)
+        {
+            psDesc->u32Reload |= PDMA_OP_SCATTER;
+            psDesc->u32Next = (uint32_t)psDesc->psLink - PDMA->SCATBA;
+        }
+        else
+            psDesc->u32Reload = (psDesc->u32Reload & ~PDMA_DSCT_CTL_TBINTDIS_Msk) | PDMA_OP_BASIC;
+
+        psDesc->u32Ctl = psDesc->u32Reload;
+        psDesc = psDesc->psLink;
+    }
+
+    psChain->psCur = psChain->psFirst;
+    psChain->u32Overrun = 0;
+    psChain->u32Ch = u32Ch;
+    s_apsChain[u32Ch] = psChain;
+
+    PDMA->TDSTS = (1UL << u32Ch);
+    PDMA_ChainRun(u32Ch, psChain->psFirst);
+
+    __set_PRIMASK(u32Primask);
+
+    return 0;
+}
+
+/**
+ * @brief       Stop a Chain
+ *
+ * @param[in]   psChain     The chain
+ *
+ * @return      None
+ *
+ * @details     This function stops the channel at once. The rest of the chain isn't reported. It can be
+ *              called in the callback of the chain.
+ */
+void PDMA_ChainStop(PDMA_CHAIN_T *psChain)
+{
+    uint32_t u32Primask, u32Ch;
+
+    u32Primask = __get_PRIMASK();
+    __disable_irq();
+
+    u32Ch = psChain->u32Ch;
+
+    if(u32Ch != PDMA_NO_CH)
+    {
+        PDMA->STOP = (1UL << u32Ch);
+        PDMA->TDSTS = (1UL << u32Ch);
+        s_apsChain[u32Ch] = NULL;
+        psChain->u32Ch = PDMA_NO_CH;
+    }
+
+    __set_PRIMASK(u32Primask);
+}
+
+/**
+ * @brief       Give the Descriptors of a Chain back to its Pool
+ *
+ * @param[in]   psChain     The chain which isn't running
+ *
+ * @retval      0                   Success
+ * @retval      PDMA_ERR_BUSY       The chain is running
+ *
+ * @details     The chain is empty afterwards and can be built again.
+ */
+int32_t PDMA_ChainFree(PDMA_CHAIN_T *psChain)
+{
+    PDMA_DESC_T *psDesc, *psNext;
+    uint32_t i;
+
+    if(psChain->u32Ch != PDMA_NO_CH)
+        return PDMA_ERR_BUSY;
+
+    psDesc = psChain->psFirst;
+
+    for(i = 0; i < psChain->u32Num; i++)
+    {
+        psNext = psDesc->psLink;
+        PDMA_PoolFree(psChain->psPool, psDesc);
+        psDesc = psNext;
+    }
+
+    PDMA_ChainInit(psChain, psChain->psPool);
+
+    return 0;
+}
+
+/**
+ * @brief       Interrupt Service of the Allocated Channels
+ *
+ * @param       None
+ *
+ * @return      None
+ *
+ * @details     Call it from PDMA_IRQHandler(). It only clears the flags of the channels of
+ *              PDMA_AllocChannel(), so handlers of drivers with reserved channels can be called as well.
+ *              On a chain, the callback gets \ref PDMA_EVT_DESC for every finished entry in order, with
+ *              \ref PDMA_EVT_DONE at the end of a linear chain. A channel without chain gets
+ *              \ref PDMA_EVT_DONE for its basic transfer. After \ref PDMA_EVT_ABORT the chain is stopped.
+ */
+void PDMA_ChannelIRQHandler(void)
+{
+    PDMA_CHAIN_T *psChain;
+    uint32_t u32Td, u32Abort, u32Tout, u32Bit, u32Event, i;
+
+    u32Td = PDMA->TDSTS & s_u32ChManaged;
+    u32Abort = PDMA->ABTSTS & s_u32ChManaged;
+    u32Tout = ((PDMA->INTSTS & PDMA_INTSTS_REQTOFn_Msk) >> PDMA_INTSTS_REQTOFn_Pos) & s_u32ChManaged;
+
+    /* Clear the flags first. A descriptor which finishes during the callbacks raises the interrupt again. */
+    PDMA->TDSTS = u32Td;
+    PDMA->ABTSTS = u32Abort;
+    PDMA->INTSTS = u32Tout << PDMA_INTSTS_REQTOFn_Pos;
+    PDMA->SCATSTS = PDMA->SCATSTS & s_u32ChManaged;
+
+    for(i = 0; i < PDMA_CH_MAX; i++)
+    {
+        u32Bit = 1UL << i;
+
+        if(((u32Td | u32Abort | u32Tout) & u32Bit) == 0)
+            continue;
+
+        psChain = s_apsChain[i];
+        u32Event = 0;
+
+        if(u32Abort & u32Bit)
+        {
+            u32Event |= PDMA_EVT_ABORT;
+
+            if(psChain)
+            {
+                psChain->u32Ch = PDMA_NO_CH;
+                s_apsChain[i] = NULL;
+            }
+        }
+        else if(u32Td & u32Bit)
+        {
+            if(psChain)
+                PDMA_ChainUpdate(i, psChain);
+            else
+                u32Event |= PDMA_EVT_DONE;
+        }
+
+        if(u32Tout & u32Bit)
+            u32Event |= PDMA_EVT_TIMEOUT;
+
+        if(u32Event && s_apfnCallback[i])
+            s_apfnCallback[i](s_apvArg[i], i, u32Event, psChain ? psChain->psCur : NULL);
+    }
+}
+
 /*@}*/ /* end of group PDMA_EXPORTED_FUNCTIONS */
 
 /*@}*/ /* end of group PDMA_Driver */
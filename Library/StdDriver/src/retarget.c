@@ -29,6 +29,14 @@ char GetChar(void);
 void SendChar_ToUART(int ch);
 void SendChar(int ch);
 
+/* Debug port goes through UART_AsyncWriteWait() and UART_AsyncReadWait() when the application sets it.
+   They are called through the hook of UART_AsyncOpen(), so projects without uart.c still link. */
+UART_ASYNC_T *g_psDebugAsync = NULL;
+const UART_ASYNC_HOOK_T *g_psDebugAsyncHook = NULL;
+
+#define DEBUG_ASYNC_TX()    (g_psDebugAsync && g_psDebugAsyncHook && (g_psDebugAsync->u32TxCh != UART_ASYNC_NO_CH))
+#define DEBUG_ASYNC_RX()    (g_psDebugAsync && g_psDebugAsyncHook && (g_psDebugAsync->u32RxCh != UART_ASYNC_NO_CH))
+
 
 
 #if defined(__ICCARM__)
@@ -470,6 +478,18 @@ __WEAK uint32_t ProcessHardFault(uint32_t lr, uint32_t msp, uint32_t psp)
  */
 void SendChar_ToUART(int ch)
 {
+    if(DEBUG_ASYNC_TX())
+    {
+        uint8_t au8Buf[2] = {'\r', (uint8_t)ch};
+
+        if((char)ch == '\n')
+            g_psDebugAsyncHook->pfnWriteWait(g_psDebugAsync, au8Buf, 2);
+        else
+            g_psDebugAsyncHook->pfnWriteWait(g_psDebugAsync, &au8Buf[1], 1);
+
+        return;
+    }
+
     if((char)ch == '\n')
     {
         while(DEBUG_PORT->FIFOSTS & UART_FIFOSTS_TXFULL_Msk) {}
@@ -569,6 +589,14 @@ char GetChar(void)
     return (0);
 #else
 
+    if(DEBUG_ASYNC_RX())
+    {
+        uint8_t u8Data;
+
+        g_psDebugAsyncHook->pfnReadWait(g_psDebugAsync, &u8Data, 1);
+        return (char)u8Data;
+    }
+
     while(1)
     {
         if((DEBUG_PORT->FIFOSTS & UART_FIFOSTS_RXEMPTY_Msk) == 0U)
@@ -593,6 +621,9 @@ char GetChar(void)
 
 int kbhit(void)
 {
+    if(DEBUG_ASYNC_RX())
+        return (g_psDebugAsyncHook->pfnGetRxCount(g_psDebugAsync) != 0U);
+
     return !((DEBUG_PORT->FIFOSTS & UART_FIFOSTS_RXEMPTY_Msk) == UART_FIFOSTS_RXEMPTY_Msk);
 }
 /**
@@ -604,10 +635,14 @@ int kbhit(void)
  * @retval   0: Message is transmitting.
  *
  * @details  Check if message finished (FIFO empty of debug port)
+ *           Records of the deferred log are not counted. Call DLOG_Flush() first when DLOG() is used.
  */
 
 int IsDebugFifoEmpty(void)
 {
+    if(g_psDebugAsync && (g_psDebugAsync->u32TxHead != g_psDebugAsync->u32TxTail))
+        return 0;
+
     return ((DEBUG_PORT->FIFOSTS & UART_FIFOSTS_TXEMPTYF_Msk) != 0U);
 }
 
@@ -429,19 +429,15 @@ void SPI_SetFIFO(SPI_T *spi, uint32_t u32TxThreshold, uint32_t u32RxThreshold)
 }
 
 /**
-  * @brief  Get the actual frequency of SPI bus clock. Only available in Master mode.
+  * @brief  This function is used to get SPI source clock frequency.
   * @param[in]  spi The pointer of the specified SPI module.
-  * @return Actual SPI bus clock frequency in Hz.
-  * @details This function will calculate the actual SPI bus clock rate according to the SPInSEL and DIVIDER settings. Only available in Master mode.
+  * @return SPI source clock frequency (Hz).
+  * @details Return the source clock frequency according to the setting of SPI0SEL, SPI1SEL or SPI2SEL (CLKSEL2).
   */
-uint32_t SPI_GetBusClock(SPI_T *spi)
+static uint32_t SPI_GetSourceClockFreq(SPI_T *spi)
 {
-    uint32_t u32Div;
     uint32_t u32ClkSrc, u32HCLKFreq;
 
-    /* Get DIVIDER setting */
-    u32Div = (spi->CLKDIV & SPI_CLKDIV_DIVIDER_Msk) >> SPI_CLKDIV_DIVIDER_Pos;
-
     /* Get system clock frequency */
     u32HCLKFreq = CLK_GetHCLKFreq();
 
@@ -498,8 +494,24 @@ uint32_t SPI_GetBusClock(SPI_T *spi)
             u32ClkSrc = __HIRC; /* Clock source is HIRC */
     }
 
+    return u32ClkSrc;
+}
+
+/**
+  * @brief  Get the actual frequency of SPI bus clock. Only available in Master mode.
+  * @param[in]  spi The pointer of the specified SPI module.
+  * @return Actual SPI bus clock frequency in Hz.
+  * @details This function will calculate the actual SPI bus clock rate according to the SPInSEL and DIVIDER settings. Only available in Master mode.
+  */
+uint32_t SPI_GetBusClock(SPI_T *spi)
+{
+    uint32_t u32Div;
+
+    /* Get DIVIDER setting */
+    u32Div = (spi->CLKDIV & SPI_CLKDIV_DIVIDER_Msk) >> SPI_CLKDIV_DIVIDER_Pos;
+
     /* Return SPI bus clock rate */
-    return (u32ClkSrc / (u32Div + 1));
+    return (SPI_GetSourceClockFreq(spi) / (u32Div + 1));
 }
 
 /**
@@ -817,6 +829,378 @@ uint32_t SPI_GetStatus(SPI_T *spi, uint32_t u32Mask)
 }
 
 
+/// @cond HIDDEN_SYMBOLS
+
+/* Bits of SPI_CTL which a device and a segment set */
+#define SPI_QUEUE_CTL_MSK   (SPI_CTL_CLKPOL_Msk | SPI_CTL_TXNEG_Msk | SPI_CTL_RXNEG_Msk | SPI_CTL_LSB_Msk | \
+                             SPI_CTL_DWIDTH_Msk | SPI_CTL_DUALIOEN_Msk | SPI_CTL_QUADIOEN_Msk | SPI_CTL_QDIODIR_Msk)
+
+static uint8_t s_u8SpiQueueDummy = 0xFF;    /* Sent by segments without TX data */
+static uint8_t s_u8SpiQueueDiscard;         /* Receives data of segments without RX buffer */
+
+/* Weak references, so projects without pdma.c still link. Nothing else can reserve channels there. */
+__WEAK int32_t PDMA_ReserveChannels(uint32_t u32Mask);
+__WEAK void PDMA_FreeChannel(uint32_t u32Ch);
+
+/* Route a PDMA channel to a request source */
+static void SPI_QueueSetReqSel(uint32_t u32Ch, uint32_t u32Src)
+{
+    volatile uint32_t *pu32ReqSel = &PDMA->REQSEL0_3 + (u32Ch / 4);
+    uint32_t u32Pos = (u32Ch % 4) * 8;
+
+    *pu32ReqSel = (*pu32ReqSel & ~(0x1FUL << u32Pos)) | (u32Src << u32Pos);
+}
+
+/* Drive the chip select of a device */
+static void SPI_QueueSetCs(SPI_QDEV_T *psDev, uint32_t u32Active)
+{
+    if(psDev->pu32CsPin)
+        *psDev->pu32CsPin = (u32Active ^ (psDev->u32CsActive == SPI_SS_ACTIVE_LOW)) ? 1 : 0;
+    else if(u32Active)
+        psDev->spi->SSCTL = (psDev->spi->SSCTL & ~(SPI_SSCTL_AUTOSS_Msk | SPI_SSCTL_SSACTPOL_Msk)) | psDev->u32CsActive |
+                            SPI_SSCTL_SS_Msk;
+    else
+        psDev->spi->SSCTL &= ~SPI_SSCTL_SS_Msk;
+}
+
+/* Chain the descriptors of a transaction. A chain ends where the I/O mode changes. */
+static void SPI_QueueBuild(SPI_QUEUE_T *psQueue, SPI_QXFER_T *psXfer)
+{
+    SPI_QSEG_T *psSeg;
+    uint32_t u32Last, u32Ctl, i;
+
+    for(i = 0; i < psXfer->u32SegNum; i++)
+    {
+        psSeg = &psXfer->psSeg[i];
+        u32Last = (i == psXfer->u32SegNum - 1) || (psSeg[1].u32Mode != psSeg->u32Mode);
+        u32Ctl = ((psSeg->u32Len - 1) << PDMA_DSCT_CTL_TXCNT_Pos) | PDMA_WIDTH_8 | PDMA_REQ_SINGLE |
+                 (u32Last ? PDMA_OP_BASIC : (PDMA_OP_SCATTER | PDMA_DSCT_CTL_TBINTDIS_Msk));
+
+        psSeg->sTxDesc.u32Ctl = u32Ctl | PDMA_DAR_FIX | (psSeg->pu8Tx ? PDMA_SAR_INC : PDMA_SAR_FIX);
+        psSeg->sTxDesc.u32Src = psSeg->pu8Tx ? (uint32_t)psSeg->pu8Tx : (uint32_t)&s_u8SpiQueueDummy;
+        psSeg->sTxDesc.u32Dst = (uint32_t)&psQueue->spi->TX;
+        psSeg->sTxDesc.u32Next = u32Last ? 0 : ((uint32_t)&psSeg[1].sTxDesc - PDMA->SCATBA);
+
+        /* Input modes finish when the last byte is received. Output modes finish on TX. */
+        if(!(psSeg->u32Mode & SPI_CTL_QDIODIR_Msk))
+            psSeg->sTxDesc.u32Ctl |= PDMA_DSCT_CTL_TBINTDIS_Msk;
+
+        psSeg->sRxDesc.u32Ctl = u32Ctl | PDMA_SAR_FIX | (psSeg->pu8Rx ? PDMA_DAR_INC : PDMA_DAR_FIX);
+        psSeg->sRxDesc.u32Src = (uint32_t)&psQueue->spi->RX;
+        psSeg->sRxDesc.u32Dst = psSeg->pu8Rx ? (uint32_t)psSeg->pu8Rx : (uint32_t)&s_u8SpiQueueDiscard;
+        psSeg->sRxDesc.u32Next = u32Last ? 0 : ((uint32_t)&psSeg[1].sRxDesc - PDMA->SCATBA);
+    }
+}
+
+/* Start the descriptor chain which begins at segment u32Run of the head transaction */
+static void SPI_QueueStartRun(SPI_QUEUE_T *psQueue)
+{
+    SPI_QXFER_T *psXfer = psQueue->psHead;
+    SPI_QSEG_T *psSeg = &psXfer->psSeg[psXfer->u32Run];
+    SPI_T *spi = psQueue->spi;
+
+    spi->CTL = (spi->CTL & ~SPI_QUEUE_CTL_MSK) | psXfer->psDev->u32Ctl | psSeg->u32Mode;
+
+    if(!(psSeg->u32Mode & SPI_CTL_QDIODIR_Msk))
+    {
+        PDMA->DSCT[psQueue->u32RxCh].CTL = PDMA_OP_SCATTER;
+        PDMA->DSCT[psQueue->u32RxCh].NEXT = (uint32_t)&psSeg->sRxDesc - PDMA->SCATBA;
+        PDMA->CHCTL |= (1 << psQueue->u32RxCh);
+        spi->PDMACTL |= SPI_PDMACTL_RXPDMAEN_Msk;
+    }
+
+    PDMA->DSCT[psQueue->u32TxCh].CTL = PDMA_OP_SCATTER;
+    PDMA->DSCT[psQueue->u32TxCh].NEXT = (uint32_t)&psSeg->sTxDesc - PDMA->SCATBA;
+    PDMA->CHCTL |= (1 << psQueue->u32TxCh);
+    spi->PDMACTL |= SPI_PDMACTL_TXPDMAEN_Msk;
+}
+
+/* Put the head transaction on the bus */
+static void SPI_QueueStartXfer(SPI_QUEUE_T *psQueue)
+{
+    SPI_QXFER_T *psXfer = psQueue->psHead;
+    SPI_T *spi = psQueue->spi;
+
+    /* Clock polarity is set before the chip select becomes active */
+    spi->CLKDIV = (spi->CLKDIV & ~SPI_CLKDIV_DIVIDER_Msk) | psXfer->psDev->u32ClkDiv;
+    spi->CTL = (spi->CTL & ~SPI_QUEUE_CTL_MSK) | psXfer->psDev->u32Ctl | psXfer->psSeg[0].u32Mode;
+    psXfer->u32Run = 0;
+    psXfer->i32Status = SPI_QXFER_BUSY;
+    SPI_QueueSetCs(psXfer->psDev, 1);
+    SPI_QueueStartRun(psQueue);
+}
+
+/* Wait for an interrupt while psXfer is pending. Where the PDMA interrupt can't preempt, do its work instead.
+   The status is checked with interrupts masked, so an interrupt just before WFI still wakes the CPU. */
+static void SPI_QueueSleep(SPI_QUEUE_T *psQueue, SPI_QXFER_T *psXfer)
+{
+    uint32_t u32Primask = __get_PRIMASK();
+
+    __disable_irq();
+
+    if(__get_IPSR() || u32Primask)
+    {
+        SPI_QueuePdmaHandler(psQueue);
+        __set_PRIMASK(u32Primask);
+    }
+    else
+    {
+        if(psXfer->i32Status > 0)
+            __WFI();
+
+        __enable_irq();
+    }
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+/**
+  * @brief  Open the transaction queue of an SPI port.
+  * @param[in]  psQueue Queue state. It must stay valid while the port is used.
+  * @param[in]  spi The pointer of the specified SPI module. SPI_Open() must have set it up as master with 8-bit data.
+  * @param[in]  u32TxCh PDMA channel of TX.
+  * @param[in]  u32RxCh PDMA channel of RX.
+  * @retval 0 Success
+  * @retval -1 Invalid channel, or a channel is in use
+  * @details The channels are reserved with PDMA_ReserveChannels() until SPI_QueueClose(). The automatic slave
+  *          selection is disabled, because the queue drives the chip selects.
+  *          PDMA_IRQHandler() must call SPI_QueuePdmaHandler().
+  */
+int32_t SPI_QueueOpen(SPI_QUEUE_T *psQueue, SPI_T *spi, uint32_t u32TxCh, uint32_t u32RxCh)
+{
+    uint32_t u32Idx = (spi == SPI0) ? 0 : ((spi == SPI1) ? 1 : 2);
+
+    if((u32TxCh >= PDMA_CH_MAX) || (u32RxCh >= PDMA_CH_MAX) || (u32TxCh == u32RxCh))
+        return -1;
+
+    if(PDMA_ReserveChannels && (PDMA_ReserveChannels((1 << u32TxCh) | (1 << u32RxCh)) != 0))
+        return -1;
+
+    psQueue->spi = spi;
+    psQueue->u32TxCh = u32TxCh;
+    psQueue->u32RxCh = u32RxCh;
+    psQueue->psHead = NULL;
+    psQueue->psTail = NULL;
+
+    spi->SSCTL &= ~(SPI_SSCTL_AUTOSS_Msk | SPI_SSCTL_SS_Msk);
+    spi->PDMACTL &= ~(SPI_PDMACTL_TXPDMAEN_Msk | SPI_PDMACTL_RXPDMAEN_Msk);
+
+    CLK->AHBCLK |= CLK_AHBCLK_PDMACKEN_Msk;
+    PDMA->CHCTL &= ~((1 << u32TxCh) | (1 << u32RxCh));
+    SPI_QueueSetReqSel(u32TxCh, PDMA_SPI0_TX + u32Idx);
+    SPI_QueueSetReqSel(u32RxCh, PDMA_SPI0_RX + u32Idx);
+    PDMA->TDSTS = (1 << u32TxCh) | (1 << u32RxCh);
+    PDMA->INTEN |= (1 << u32TxCh) | (1 << u32RxCh);
+    NVIC_EnableIRQ(PDMA_IRQn);
+
+    return 0;
+}
+
+/**
+  * @brief  Close the transaction queue of an SPI port.
+  * @param[in]  psQueue Queue state.
+  * @return None
+  * @details The function stops PDMA at once and frees the channels. Wait for the queued transactions first.
+  */
+void SPI_QueueClose(SPI_QUEUE_T *psQueue)
+{
+    psQueue->spi->PDMACTL &= ~(SPI_PDMACTL_TXPDMAEN_Msk | SPI_PDMACTL_RXPDMAEN_Msk);
+
+    PDMA->INTEN &= ~((1 << psQueue->u32TxCh) | (1 << psQueue->u32RxCh));
+    PDMA->STOP = (1 << psQueue->u32TxCh) | (1 << psQueue->u32RxCh);
+    if(PDMA_FreeChannel)
+    {
+        PDMA_FreeChannel(psQueue->u32TxCh);
+        PDMA_FreeChannel(psQueue->u32RxCh);
+    }
+
+    psQueue->psHead = NULL;
+    psQueue->psTail = NULL;
+}
+
+/**
+  * @brief  Set up a device on a queue.
+  * @param[out] psDev Device settings. Transactions of the device point to it.
+  * @param[in]  psQueue Queue of the SPI port which the device is connected to.
+  * @param[in]  u32SPIMode SPI_MODE_0 ~ SPI_MODE_3, optionally ORed with SPI_CTL_LSB_Msk.
+  * @param[in]  u32BusClock The expected frequency of SPI bus clock in Hz.
+  * @param[in]  pu32CsPin GPIO bit of the chip select like &PA3, or NULL if the SS pin of the port is used.
+  * @param[in]  u32CsActive Active level of the chip select. (SPI_SS_ACTIVE_HIGH, SPI_SS_ACTIVE_LOW)
+  * @return Actual frequency of SPI bus clock of the device.
+  * @details The divider is calculated from the current SPI clock source, so the clock of the running transaction
+  *          isn't touched. The chip select is set inactive.
+  */
+uint32_t SPI_QueueInitDev(SPI_QDEV_T *psDev, SPI_QUEUE_T *psQueue, uint32_t u32SPIMode, uint32_t u32BusClock,
+                          volatile uint32_t *pu32CsPin, uint32_t u32CsActive)
+{
+    uint32_t u32ClkSrc = SPI_GetSourceClockFreq(psQueue->spi), u32Div;
+
+    if(u32BusClock == 0)
+        u32Div = 0xFF;
+    else if(u32BusClock >= u32ClkSrc)
+        u32Div = 0;
+    else
+    {
+        /* Round up, so the bus clock never exceeds the device limit */
+        u32Div = (u32ClkSrc + u32BusClock - 1) / u32BusClock - 1;
+
+        if(u32Div > 0xFF)
+            u32Div = 0xFF;
+    }
+
+    psDev->spi = psQueue->spi;
+    psDev->u32Ctl = u32SPIMode | (8 << SPI_CTL_DWIDTH_Pos);
+    psDev->u32ClkDiv = u32Div << SPI_CLKDIV_DIVIDER_Pos;
+    psDev->pu32CsPin = pu32CsPin;
+    psDev->u32CsActive = u32CsActive;
+
+    if(pu32CsPin)
+        SPI_QueueSetCs(psDev, 0);
+
+    return u32ClkSrc / (u32Div + 1);
+}
+
+/**
+  * @brief  Add a transaction to a queue.
+  * @param[in]  psQueue Queue of the SPI port.
+  * @param[in]  psXfer Transaction. It and its segments and buffers must stay valid until it is done.
+  * @retval 0 The transaction is queued.
+  * @retval -1 A segment is empty or longer than SPI_QSEG_MAX_LEN.
+  * @details The descriptors are built here, so the PDMA interrupt only swaps the settings between transactions.
+  *          It can be called from the pfnDone callback.
+  */
+int32_t SPI_QueueSubmit(SPI_QUEUE_T *psQueue, SPI_QXFER_T *psXfer)
+{
+    uint32_t u32Primask, i;
+
+    if(psXfer->u32SegNum == 0)
+        return -1;
+
+    for(i = 0; i < psXfer->u32SegNum; i++)
+    {
+        if((psXfer->psSeg[i].u32Len == 0) || (psXfer->psSeg[i].u32Len > SPI_QSEG_MAX_LEN))
+            return -1;
+    }
+
+    SPI_QueueBuild(psQueue, psXfer);
+    psXfer->i32Status = SPI_QXFER_QUEUED;
+    psXfer->psNext = NULL;
+
+    u32Primask = __get_PRIMASK();
+    __disable_irq();
+
+    if(psQueue->psTail)
+    {
+        psQueue->psTail->psNext = psXfer;
+        psQueue->psTail = psXfer;
+    }
+    else
+    {
+        psQueue->psHead = psXfer;
+        psQueue->psTail = psXfer;
+        SPI_QueueStartXfer(psQueue);
+    }
+
+    __set_PRIMASK(u32Primask);
+
+    return 0;
+}
+
+/**
+  * @brief  Wait for a transaction.
+  * @param[in]  psQueue Queue of the SPI port.
+  * @param[in]  psXfer A submitted transaction.
+  * @return SPI_QXFER_DONE
+  * @details The CPU sleeps until the transaction is done. It can be called with interrupts masked.
+  */
+int32_t SPI_QueueWait(SPI_QUEUE_T *psQueue, SPI_QXFER_T *psXfer)
+{
+    while(psXfer->i32Status > 0)
+        SPI_QueueSleep(psQueue, psXfer);
+
+    return psXfer->i32Status;
+}
+
+/**
+  * @brief  Run a transaction and wait for it.
+  * @param[in]  psQueue Queue of the SPI port.
+  * @param[in]  psXfer Transaction.
+  * @retval 0 The transaction is done.
+  * @retval -1 The transaction is invalid.
+  */
+int32_t SPI_QueueTransfer(SPI_QUEUE_T *psQueue, SPI_QXFER_T *psXfer)
+{
+    if(SPI_QueueSubmit(psQueue, psXfer) < 0)
+        return -1;
+
+    return SPI_QueueWait(psQueue, psXfer);
+}
+
+/**
+  * @brief  PDMA interrupt service of a queue.
+  * @param[in]  psQueue Queue of the SPI port.
+  * @return None
+  * @details Call it from PDMA_IRQHandler() for every open queue. It only clears the flags of the channels of the
+  *          queue. The next transaction starts before pfnDone of the finished one is called.
+  */
+void SPI_QueuePdmaHandler(SPI_QUEUE_T *psQueue)
+{
+    SPI_QXFER_T *psXfer = psQueue->psHead;
+    SPI_T *spi = psQueue->spi;
+    uint32_t u32Sts = PDMA->TDSTS & ((1 << psQueue->u32TxCh) | (1 << psQueue->u32RxCh));
+    uint32_t u32Mode, u32Ch, i;
+
+    if(u32Sts == 0)
+        return;
+
+    PDMA->TDSTS = u32Sts;
+
+    if(psXfer == NULL)
+        return;
+
+    u32Mode = psXfer->psSeg[psXfer->u32Run].u32Mode;
+    u32Ch = (u32Mode & SPI_CTL_QDIODIR_Msk) ? psQueue->u32TxCh : psQueue->u32RxCh;
+
+    /* The descriptor chain ends with a basic descriptor, which is written back as idle */
+    if(PDMA->DSCT[u32Ch].CTL & PDMA_DSCT_CTL_OPMODE_Msk)
+        return;
+
+    if(u32Mode & SPI_CTL_QDIODIR_Msk)
+    {
+        /* At most a FIFO of data is left to shift out */
+        while(SPI_IS_BUSY(spi));
+
+        SPI_ClearRxFIFO(spi);
+    }
+
+    spi->PDMACTL &= ~(SPI_PDMACTL_TXPDMAEN_Msk | SPI_PDMACTL_RXPDMAEN_Msk);
+
+    /* Next chain of the transaction */
+    for(i = psXfer->u32Run + 1; (i < psXfer->u32SegNum) && (psXfer->psSeg[i].u32Mode == u32Mode); i++);
+
+    if(i < psXfer->u32SegNum)
+    {
+        psXfer->u32Run = i;
+        SPI_QueueStartRun(psQueue);
+        return;
+    }
+
+    SPI_QueueSetCs(psXfer->psDev, 0);
+
+    psQueue->psHead = psXfer->psNext;
+
+    if(psQueue->psHead)
+        SPI_QueueStartXfer(psQueue);
+    else
+        psQueue->psTail = NULL;
+
+    psXfer->i32Status = SPI_QXFER_DONE;
+
+    if(psXfer->pfnDone)
+        psXfer->pfnDone(psXfer);
+}
+
+
 /**
   * @brief  This function is used to get I2S source clock frequency.
   * @param[in]  i2s The pointer of the specified I2S module.
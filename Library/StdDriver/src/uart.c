@@ -11,6 +11,7 @@
 *****************************************************************************/
 
 #include <stdio.h>
+#include <string.h>
 #include "M451Series.h"
 
 /** @addtogroup Standard_Driver Standard Driver
@@ -492,6 +493,526 @@ uint32_t UART_Write(UART_T* uart, uint8_t *pu8TxBuf, uint32_t u32WriteBytes)
 
 }
 
+/* Weak references, so projects without pdma.c still link. Nothing else can reserve channels there. */
+__WEAK int32_t PDMA_ReserveChannels(uint32_t u32Mask);
+__WEAK void PDMA_FreeChannel(uint32_t u32Ch);
+
+/* Route a PDMA channel to a request source */
+static void UART_AsyncSetReqSel(uint32_t u32Ch, uint32_t u32Src)
+{
+    volatile uint32_t *pu32ReqSel = &PDMA->REQSEL0_3 + (u32Ch / 4);
+    uint32_t u32Pos = (u32Ch % 4) * 8;
+
+    *pu32ReqSel = (*pu32ReqSel & ~(0x1FUL << u32Pos)) | (u32Src << u32Pos);
+}
+
+/* Descriptor control word of a half of the RX ring */
+static uint32_t UART_AsyncRxCtl(UART_ASYNC_T *psAsync)
+{
+    return ((psAsync->u32RxSize / 2 - 1) << PDMA_DSCT_CTL_TXCNT_Pos) | PDMA_WIDTH_8 | PDMA_SAR_FIX | PDMA_DAR_INC |
+           PDMA_REQ_SINGLE | PDMA_OP_SCATTER;
+}
+
+/* Start PDMA on the half which receives byte u32RxHead */
+static void UART_AsyncRxStart(UART_ASYNC_T *psAsync)
+{
+    uint32_t u32Ch = psAsync->u32RxCh;
+
+    PDMA->DSCT[u32Ch].CTL = PDMA_OP_SCATTER;
+    PDMA->DSCT[u32Ch].NEXT = (uint32_t)&psAsync->asRxDesc[(psAsync->u32RxHead / (psAsync->u32RxSize / 2)) & 1] -
+                             PDMA->SCATBA;
+    PDMA->CHCTL |= (1 << u32Ch);
+}
+
+/* Publish the filled halves. Interrupts must be masked. */
+static void UART_AsyncRxUpdate(UART_ASYNC_T *psAsync)
+{
+    uint32_t u32Half = psAsync->u32RxSize / 2;
+    UART_ASYNC_DESC_T *psDesc;
+
+    /* PDMA writes a descriptor back as idle when its half is filled */
+    while(1)
+    {
+        psDesc = &psAsync->asRxDesc[(psAsync->u32RxHead / u32Half) & 1];
+
+        if(psDesc->u32Ctl & PDMA_DSCT_CTL_OPMODE_Msk)
+            break;
+
+        psDesc->u32Ctl = UART_AsyncRxCtl(psAsync);
+        psAsync->u32RxHead += u32Half;
+
+        /* Channel stopped at an idle descriptor. The UART FIFO kept the data meanwhile. */
+        if((PDMA->DSCT[psAsync->u32RxCh].CTL & PDMA_DSCT_CTL_OPMODE_Msk) == 0)
+            UART_AsyncRxStart(psAsync);
+    }
+}
+
+/* Send the next part of the TX ring. Interrupts must be masked. */
+static void UART_AsyncTxStart(UART_ASYNC_T *psAsync)
+{
+    uint32_t u32Ch = psAsync->u32TxCh, u32Pos, u32Len;
+
+    if(psAsync->u32TxDmaLen || (psAsync->u32TxHead == psAsync->u32TxTail))
+        return;
+
+    /* One transfer runs to the end of the ring at most */
+    u32Pos = psAsync->u32TxTail & (psAsync->u32TxSize - 1);
+    u32Len = psAsync->u32TxHead - psAsync->u32TxTail;
+
+    if(u32Len > psAsync->u32TxSize - u32Pos)
+        u32Len = psAsync->u32TxSize - u32Pos;
+
+    if(u32Len > (PDMA_DSCT_CTL_TXCNT_Msk >> PDMA_DSCT_CTL_TXCNT_Pos) + 1)
+        u32Len = (PDMA_DSCT_CTL_TXCNT_Msk >> PDMA_DSCT_CTL_TXCNT_Pos) + 1;
+
+    psAsync->u32TxDmaLen = u32Len;
+    PDMA->DSCT[u32Ch].SA = (uint32_t)&psAsync->pu8TxBuf[u32Pos];
+    PDMA->DSCT[u32Ch].DA = (uint32_t)&psAsync->uart->DAT;
+    PDMA->DSCT[u32Ch].CTL = ((u32Len - 1) << PDMA_DSCT_CTL_TXCNT_Pos) | PDMA_WIDTH_8 | PDMA_SAR_INC | PDMA_DAR_FIX |
+                            PDMA_REQ_SINGLE | PDMA_OP_BASIC;
+    PDMA->CHCTL |= (1 << u32Ch);
+}
+
+/* Conditions of UART_AsyncSleep() */
+#define UART_ASYNC_WAIT_TX_FREE     0   /* TX ring is full */
+#define UART_ASYNC_WAIT_RX_DATA     1   /* RX ring is empty */
+#define UART_ASYNC_WAIT_TX_DONE     2   /* TX ring isn't sent */
+
+static uint32_t UART_AsyncIsWaiting(UART_ASYNC_T *psAsync, uint32_t u32Wait)
+{
+    if(u32Wait == UART_ASYNC_WAIT_TX_FREE)
+        return (UART_AsyncGetTxFree(psAsync) == 0);
+    else if(u32Wait == UART_ASYNC_WAIT_RX_DATA)
+        return (UART_AsyncGetRxCount(psAsync) == 0);
+    else
+        return (psAsync->u32TxHead != psAsync->u32TxTail);
+}
+
+/* Wait for an interrupt while the condition holds. Where the PDMA interrupt can't preempt, do its work instead.
+   The condition is checked with interrupts masked, so an interrupt just before WFI still wakes the CPU. */
+static void UART_AsyncSleep(UART_ASYNC_T *psAsync, uint32_t u32Wait)
+{
+    uint32_t u32Primask = __get_PRIMASK();
+
+    __disable_irq();
+
+    if(__get_IPSR() || u32Primask)
+    {
+        UART_AsyncPdmaHandler(psAsync);
+        __set_PRIMASK(u32Primask);
+    }
+    else
+    {
+        if(UART_AsyncIsWaiting(psAsync, u32Wait))
+            __WFI();
+
+        __enable_irq();
+    }
+}
+
+/* Calls of retarget.c for g_psDebugAsync */
+static const UART_ASYNC_HOOK_T s_sAsyncHook =
+{
+    UART_AsyncWrite,
+    UART_AsyncWriteWait,
+    UART_AsyncReadWait,
+    UART_AsyncGetRxCount,
+    UART_AsyncGetTxFree,
+    UART_AsyncFlush
+};
+
+
+/**
+ *    @brief        Open asynchronous transfer of a UART port
+ *
+ *    @param[in]    psAsync     Transfer state. It must stay valid until UART_AsyncClose().
+ *    @param[in]    uart        The pointer of the specified UART module. UART_Open() must have set it up.
+ *    @param[in]    u32TxCh     PDMA channel of TX, or UART_ASYNC_NO_CH if TX isn't used.
+ *    @param[in]    pu8TxBuf    TX ring buffer
+ *    @param[in]    u32TxSize   Size of TX ring buffer. Power of 2.
+ *    @param[in]    u32RxCh     PDMA channel of RX, or UART_ASYNC_NO_CH if RX isn't used.
+ *    @param[in]    pu8RxBuf    RX ring buffer in SRAM
+ *    @param[in]    u32RxSize   Size of RX ring buffer. Power of 2, 2 ~ 32768.
+ *
+ *    @retval       0           Success
+ *    @retval       -1          Invalid parameter, or a channel is in use
+ *
+ *    @details      The channels are reserved with PDMA_ReserveChannels() until UART_AsyncClose(), so
+ *                  PDMA_AllocChannel() and other drivers can't take them.
+ *                  The function enables the PDMA and UART interrupts. The application calls
+ *                  UART_AsyncPdmaHandler() from PDMA_IRQHandler() and UART_AsyncIrqHandler() from the UART
+ *                  interrupt handler. RX runs without stop, so the application must read a half of the RX ring
+ *                  before PDMA fills the other half. The UART RX time-out can't report partial data because
+ *                  PDMA empties the RX FIFO at once, so the read functions take the live PDMA count instead.
+ */
+int32_t UART_AsyncOpen(UART_ASYNC_T *psAsync, UART_T *uart, uint32_t u32TxCh, uint8_t *pu8TxBuf, uint32_t u32TxSize,
+                       uint32_t u32RxCh, uint8_t *pu8RxBuf, uint32_t u32RxSize)
+{
+    UART_T *apsUart[] = {UART0, UART1, UART2, UART3};
+    IRQn_Type aeIrq[] = {UART0_IRQn, UART1_IRQn, UART2_IRQn, UART3_IRQn};
+    uint32_t u32Idx, u32ChMask = 0, i;
+
+    for(u32Idx = 0; (u32Idx < 4) && (apsUart[u32Idx] != uart); u32Idx++);
+
+    if(u32Idx == 4)
+        return -1;
+
+    if((u32TxCh != UART_ASYNC_NO_CH) && ((u32TxCh >= PDMA_CH_MAX) || (u32TxSize == 0) || (u32TxSize & (u32TxSize - 1))))
+        return -1;
+
+    if((u32RxCh != UART_ASYNC_NO_CH) && ((u32RxCh >= PDMA_CH_MAX) || (u32RxSize < 2) || (u32RxSize > 32768) ||
+                                         (u32RxSize & (u32RxSize - 1))))
+        return -1;
+
+    if((u32TxCh == u32RxCh) && (u32TxCh != UART_ASYNC_NO_CH))
+        return -1;
+
+    if(u32TxCh != UART_ASYNC_NO_CH)
+        u32ChMask |= (1 << u32TxCh);
+    if(u32RxCh != UART_ASYNC_NO_CH)
+        u32ChMask |= (1 << u32RxCh);
+
+    if(PDMA_ReserveChannels && (PDMA_ReserveChannels(u32ChMask) != 0))
+        return -1;
+
+    memset(psAsync, 0, sizeof(UART_ASYNC_T));
+    psAsync->uart = uart;
+    psAsync->u32TxCh = u32TxCh;
+    psAsync->pu8TxBuf = pu8TxBuf;
+    psAsync->u32TxSize = u32TxSize;
+    psAsync->u32RxCh = u32RxCh;
+    psAsync->pu8RxBuf = pu8RxBuf;
+    psAsync->u32RxSize = u32RxSize;
+
+    CLK->AHBCLK |= CLK_AHBCLK_PDMACKEN_Msk;
+
+    if(u32TxCh != UART_ASYNC_NO_CH)
+    {
+        UART_AsyncSetReqSel(u32TxCh, PDMA_UART0_TX + u32Idx);
+        PDMA->DSCT[u32TxCh].CTL = 0;
+        PDMA->TDSTS = (1 << u32TxCh);
+        PDMA->INTEN |= (1 << u32TxCh);
+        uart->INTEN |= UART_INTEN_TXPDMAEN_Msk;
+    }
+
+    if(u32RxCh != UART_ASYNC_NO_CH)
+    {
+        /* Two halves in a circle */
+        for(i = 0; i < 2; i++)
+        {
+            psAsync->asRxDesc[i].u32Ctl = UART_AsyncRxCtl(psAsync);
+            psAsync->asRxDesc[i].u32Src = (uint32_t)&uart->DAT;
+            psAsync->asRxDesc[i].u32Dst = (uint32_t)&pu8RxBuf[i * (u32RxSize / 2)];
+            psAsync->asRxDesc[i].u32Next = (uint32_t)&psAsync->asRxDesc[i ^ 1] - PDMA->SCATBA;
+        }
+
+        UART_AsyncSetReqSel(u32RxCh, PDMA_UART0_RX + u32Idx);
+        PDMA->TDSTS = (1 << u32RxCh);
+        PDMA->INTEN |= (1 << u32RxCh);
+        uart->FIFO |= UART_FIFO_RXRST_Msk;
+        UART_AsyncRxStart(psAsync);
+        uart->INTEN |= UART_INTEN_RXPDMAEN_Msk;
+        NVIC_EnableIRQ(aeIrq[u32Idx]);
+    }
+
+    NVIC_EnableIRQ(PDMA_IRQn);
+
+    /* The application may set g_psDebugAsync to this port now */
+    g_psDebugAsyncHook = &s_sAsyncHook;
+
+    return 0;
+}
+
+
+/**
+ *    @brief        Close asynchronous transfer of a UART port
+ *
+ *    @param[in]    psAsync     Transfer state
+ *
+ *    @return       None
+ *
+ *    @details      The function stops PDMA at once and frees the channels. Call UART_AsyncFlush() first to
+ *                  send all data.
+ */
+void UART_AsyncClose(UART_ASYNC_T *psAsync)
+{
+    psAsync->uart->INTEN &= ~(UART_INTEN_TXPDMAEN_Msk | UART_INTEN_RXPDMAEN_Msk | UART_INTEN_RDAIEN_Msk);
+
+    if(psAsync->u32TxCh != UART_ASYNC_NO_CH)
+    {
+        PDMA->INTEN &= ~(1 << psAsync->u32TxCh);
+        PDMA->STOP = (1 << psAsync->u32TxCh);
+        if(PDMA_FreeChannel)
+            PDMA_FreeChannel(psAsync->u32TxCh);
+    }
+
+    if(psAsync->u32RxCh != UART_ASYNC_NO_CH)
+    {
+        PDMA->INTEN &= ~(1 << psAsync->u32RxCh);
+        PDMA->STOP = (1 << psAsync->u32RxCh);
+        if(PDMA_FreeChannel)
+            PDMA_FreeChannel(psAsync->u32RxCh);
+    }
+
+    if(g_psDebugAsync == psAsync)
+        g_psDebugAsync = NULL;
+}
+
+
+/**
+ *    @brief        Queue data to send
+ *
+ *    @param[in]    psAsync     Transfer state
+ *    @param[in]    pu8Data     Data to send
+ *    @param[in]    u32Len      Byte count of data
+ *
+ *    @return       Byte count queued. It is less than u32Len if the TX ring is full.
+ *
+ *    @details      The function copies the data into the TX ring and returns at once. PDMA sends it in the
+ *                  background. The copy runs with interrupts masked, so main loop and interrupt handlers can
+ *                  write to the same port.
+ */
+uint32_t UART_AsyncWrite(UART_ASYNC_T *psAsync, const uint8_t *pu8Data, uint32_t u32Len)
+{
+    uint32_t u32Primask = __get_PRIMASK(), u32Pos, u32Part;
+
+    __disable_irq();
+
+    if(u32Len > psAsync->u32TxSize - (psAsync->u32TxHead - psAsync->u32TxTail))
+        u32Len = psAsync->u32TxSize - (psAsync->u32TxHead - psAsync->u32TxTail);
+
+    u32Pos = psAsync->u32TxHead & (psAsync->u32TxSize - 1);
+    u32Part = (u32Len < psAsync->u32TxSize - u32Pos) ? u32Len : (psAsync->u32TxSize - u32Pos);
+    memcpy(&psAsync->pu8TxBuf[u32Pos], pu8Data, u32Part);
+    memcpy(psAsync->pu8TxBuf, pu8Data + u32Part, u32Len - u32Part);
+    psAsync->u32TxHead += u32Len;
+
+    UART_AsyncTxStart(psAsync);
+    __set_PRIMASK(u32Primask);
+
+    return u32Len;
+}
+
+
+/**
+ *    @brief        Get received byte count
+ *
+ *    @param[in]    psAsync     Transfer state
+ *
+ *    @return       Byte count which UART_AsyncRead() can read
+ *
+ *    @details      The count includes the data of the half which PDMA is filling now.
+ */
+uint32_t UART_AsyncGetRxCount(UART_ASYNC_T *psAsync)
+{
+    uint32_t u32Primask = __get_PRIMASK(), u32Half = psAsync->u32RxSize / 2, u32Ctl, u32Cur, u32Head;
+    UART_ASYNC_DESC_T *psDesc;
+    int32_t i32Lost;
+
+    if(psAsync->u32RxCh == UART_ASYNC_NO_CH)
+        return 0;
+
+    __disable_irq();
+
+    /* A half may be filled between the reads. Then the count belongs to the next half, so read again. */
+    do
+    {
+        UART_AsyncRxUpdate(psAsync);
+        psDesc = &psAsync->asRxDesc[(psAsync->u32RxHead / u32Half) & 1];
+        u32Cur = PDMA->CURSCAT[psAsync->u32RxCh];
+        u32Ctl = PDMA->DSCT[psAsync->u32RxCh].CTL;
+    }
+    while((psDesc->u32Ctl & PDMA_DSCT_CTL_OPMODE_Msk) == 0);
+
+    u32Head = psAsync->u32RxHead;
+
+    /* The count is valid once the channel has loaded the descriptor of the half */
+    if((u32Cur == (uint32_t)psDesc) && (u32Ctl & PDMA_DSCT_CTL_OPMODE_Msk))
+        u32Head += u32Half - (((u32Ctl & PDMA_DSCT_CTL_TXCNT_Msk) >> PDMA_DSCT_CTL_TXCNT_Pos) + 1);
+
+    __set_PRIMASK(u32Primask);
+
+    /* Data before the other half is overwritten by PDMA */
+    i32Lost = (int32_t)(psAsync->u32RxHead - u32Half - psAsync->u32RxTail);
+
+    if(i32Lost > 0)
+    {
+        psAsync->u32RxOverrun += (uint32_t)i32Lost;
+        psAsync->u32RxTail += (uint32_t)i32Lost;
+    }
+
+    return ((int32_t)(u32Head - psAsync->u32RxTail) > 0) ? (u32Head - psAsync->u32RxTail) : 0;
+}
+
+
+/**
+ *    @brief        Read received data
+ *
+ *    @param[in]    psAsync     Transfer state
+ *    @param[out]   pu8Data     Buffer of read data
+ *    @param[in]    u32Len      Size of buffer
+ *
+ *    @return       Byte count read. 0 if no data is received.
+ *
+ *    @details      The function doesn't wait. Only one context may read a port.
+ */
+uint32_t UART_AsyncRead(UART_ASYNC_T *psAsync, uint8_t *pu8Data, uint32_t u32Len)
+{
+    uint32_t u32Count = UART_AsyncGetRxCount(psAsync), u32Pos, u32Part;
+
+    if(u32Len > u32Count)
+        u32Len = u32Count;
+
+    u32Pos = psAsync->u32RxTail & (psAsync->u32RxSize - 1);
+    u32Part = (u32Len < psAsync->u32RxSize - u32Pos) ? u32Len : (psAsync->u32RxSize - u32Pos);
+    memcpy(pu8Data, &psAsync->pu8RxBuf[u32Pos], u32Part);
+    memcpy(pu8Data + u32Part, psAsync->pu8RxBuf, u32Len - u32Part);
+    psAsync->u32RxTail += u32Len;
+
+    return u32Len;
+}
+
+
+/**
+ *    @brief        Get free space of TX ring
+ *
+ *    @param[in]    psAsync     Transfer state
+ *
+ *    @return       Byte count which UART_AsyncWrite() can queue
+ */
+uint32_t UART_AsyncGetTxFree(UART_ASYNC_T *psAsync)
+{
+    return psAsync->u32TxSize - (psAsync->u32TxHead - psAsync->u32TxTail);
+}
+
+
+/**
+ *    @brief        Queue all data to send
+ *
+ *    @param[in]    psAsync     Transfer state
+ *    @param[in]    pu8Data     Data to send
+ *    @param[in]    u32Len      Byte count of data
+ *
+ *    @return       None
+ *
+ *    @details      The CPU sleeps while the TX ring is full. In an interrupt handler the function waits for
+ *                  PDMA without sleep.
+ */
+void UART_AsyncWriteWait(UART_ASYNC_T *psAsync, const uint8_t *pu8Data, uint32_t u32Len)
+{
+    uint32_t u32Done = 0;
+
+    while(1)
+    {
+        u32Done += UART_AsyncWrite(psAsync, pu8Data + u32Done, u32Len - u32Done);
+
+        if(u32Done == u32Len)
+            break;
+
+        UART_AsyncSleep(psAsync, UART_ASYNC_WAIT_TX_FREE);
+    }
+}
+
+
+/**
+ *    @brief        Wait for received data and read it
+ *
+ *    @param[in]    psAsync     Transfer state
+ *    @param[out]   pu8Data     Buffer of read data
+ *    @param[in]    u32Len      Size of buffer
+ *
+ *    @return       Byte count read. At least 1.
+ *
+ *    @details      The CPU sleeps until data is received. The RX data available interrupt is enabled for the
+ *                  sleep. PDMA empties the FIFO at once, but the short pulse still wakes the CPU.
+ */
+uint32_t UART_AsyncReadWait(UART_ASYNC_T *psAsync, uint8_t *pu8Data, uint32_t u32Len)
+{
+    uint32_t u32Count;
+
+    while((u32Count = UART_AsyncRead(psAsync, pu8Data, u32Len)) == 0)
+    {
+        psAsync->uart->INTEN |= UART_INTEN_RDAIEN_Msk;
+
+        /* Data may come before the interrupt is enabled. UART_AsyncSleep() checks again with interrupts masked. */
+        UART_AsyncSleep(psAsync, UART_ASYNC_WAIT_RX_DATA);
+
+        psAsync->uart->INTEN &= ~UART_INTEN_RDAIEN_Msk;
+    }
+
+    return u32Count;
+}
+
+
+/**
+ *    @brief        Wait until all queued data is sent
+ *
+ *    @param[in]    psAsync     Transfer state
+ *
+ *    @return       None
+ *
+ *    @details      The CPU sleeps while PDMA sends the TX ring, then the function waits for the TX FIFO.
+ */
+void UART_AsyncFlush(UART_ASYNC_T *psAsync)
+{
+    while(psAsync->u32TxHead != psAsync->u32TxTail)
+        UART_AsyncSleep(psAsync, UART_ASYNC_WAIT_TX_DONE);
+
+    UART_WAIT_TX_EMPTY(psAsync->uart);
+}
+
+
+/**
+ *    @brief        PDMA interrupt service of a UART port
+ *
+ *    @param[in]    psAsync     Transfer state
+ *
+ *    @return       None
+ *
+ *    @details      Call it from PDMA_IRQHandler() for every open port. It only clears the flags of the
+ *                  channels of the port.
+ */
+void UART_AsyncPdmaHandler(UART_ASYNC_T *psAsync)
+{
+    uint32_t u32Sts = PDMA->TDSTS;
+
+    if((psAsync->u32TxCh != UART_ASYNC_NO_CH) && (u32Sts & (1 << psAsync->u32TxCh)))
+    {
+        PDMA->TDSTS = (1 << psAsync->u32TxCh);
+        psAsync->u32TxTail += psAsync->u32TxDmaLen;
+        psAsync->u32TxDmaLen = 0;
+        UART_AsyncTxStart(psAsync);
+
+        if((psAsync->u32TxDmaLen == 0) && psAsync->pfnTxDone)
+            psAsync->pfnTxDone(psAsync);
+    }
+
+    if((psAsync->u32RxCh != UART_ASYNC_NO_CH) && (u32Sts & (1 << psAsync->u32RxCh)))
+    {
+        PDMA->TDSTS = (1 << psAsync->u32RxCh);
+        UART_AsyncRxUpdate(psAsync);
+
+        if(psAsync->pfnRxData)
+            psAsync->pfnRxData(psAsync);
+    }
+}
+
+
+/**
+ *    @brief        UART interrupt service of an asynchronous port
+ *
+ *    @param[in]    psAsync     Transfer state
+ *
+ *    @return       None
+ *
+ *    @details      Call it from the UART interrupt handler. The interrupt only wakes UART_AsyncReadWait(), so
+ *                  it is disabled until the next wait.
+ */
+void UART_AsyncIrqHandler(UART_ASYNC_T *psAsync)
+{
+    psAsync->uart->INTEN &= ~UART_INTEN_RDAIEN_Msk;
+}
+
 
 /*@}*/ /* end of group UART_EXPORTED_FUNCTIONS */
 
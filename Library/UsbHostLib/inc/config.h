@@ -66,6 +66,7 @@
 #define ENABLE_DEBUG_MSG                    /* enable debug messages                      */
 //#define ENABLE_VERBOSE_DEBUG              /* verbos debug messages                      */
 //#define DUMP_DESCRIPTOR                     /* dump descriptors                           */
+//#define ENABLE_DEFERRED_LOG               /* debug messages by DLOG(), see dlog.h       */
 
 #ifdef ENABLE_ERROR_MSG
 #define USB_error            printf
@@ -73,7 +74,15 @@
 #define USB_error(...)
 #endif
 
-#ifdef ENABLE_DEBUG_MSG
+#if defined(ENABLE_DEBUG_MSG) && defined(ENABLE_DEFERRED_LOG)
+/* Messages cost no UART time in the interrupt. Strings in RAM are printed as addresses. */
+#define USB_debug            DLOG
+#ifdef ENABLE_VERBOSE_DEBUG
+#define USB_vdebug         DLOG
+#else
+#define USB_vdebug(...)
+#endif
+#elif defined(ENABLE_DEBUG_MSG)
 #define USB_debug            printf
 #ifdef ENABLE_VERBOSE_DEBUG
 #define USB_vdebug         printf
@@ -11,9 +11,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "M451Series.h"
-
-#define V6M_AIRCR_VECTKEY_DATA            0x05FA0000UL
-#define V6M_AIRCR_SYSRESETREQ             0x00000004UL
+#include "isp_lib.h"
 
 #define PLLCTL_SETTING                    (CLK_PLLCTL_72MHz_HXT)
 #define PLL_CLOCK                         (72000000)
@@ -27,9 +25,10 @@
 #define CAN_ISP_DtatLength                0x08
 #define CAN_RETRY_COUNTS                  0x1fffffff
 
-#define CMD_READ_CONFIG                   0xA2000000
-#define CMD_RUN_APROM                     0xAB000000
-#define CMD_GET_DEVICEID                  0xB1000000
+#define CAN_CMD_READ_CONFIG               0xA2000000
+#define CAN_CMD_RUN_APROM                 0xAB000000
+#define CAN_CMD_GET_DEVICEID              0xB1000000
+#define CAN_CMD_UPDATE_APROM_LZ           0xD1000000    /* Data is image size. Next frames carry 8 bytes of LZ stream */
 
 /*---------------------------------------------------------------------------*/
 /*  Function Declare                                                         */
@@ -47,6 +46,11 @@ STR_CANMSG_T rrMsg;
 volatile uint8_t g_u8CAN_PackageFlag = 0, g_u8CAN_AckFlag = 0;
 uint32_t Chip_EndAddress = 0;
 
+#if ISP_USE_LZ
+static ISP_LZ_T s_sLz;
+static uint32_t s_au32PageBuf[FMC_FLASH_PAGE_SIZE / 4];
+#endif
+
 /*---------------------------------------------------------------------------------------------------------*/
 /* ISR to handle CAN interrupt event                                                                       */
 /*---------------------------------------------------------------------------------------------------------*/
@@ -171,13 +175,15 @@ void CAN_Init(void)
 int main(void)
 {
     uint32_t  Address, Data;
+#if ISP_USE_LZ
+    uint8_t u8Stream = 0;
+#endif
     /* Unlock protected registers */
     SYS_UnlockReg();
     /* Init System, IP clock and multi-function I/O */
     if(SYS_Init() < 0) goto _APROM;
-    /* Enable FMC ISP function */
-    FMC_Open();
-    FMC_ENABLE_AP_UPDATE();
+    /* Enable FMC ISP function and APROM update */
+    if(ISP_FlashOpen() < 0) goto _APROM;
     FMC_ENABLE_CFG_UPDATE();
     /* Init CAN port */
     CAN_Init();
@@ -207,15 +213,49 @@ int main(void)
             Address = inpw(&rrMsg.Data);
             Data = inpw(&rrMsg.Data[4]);
 
-            if(Address == CMD_GET_DEVICEID)
+#if ISP_USE_LZ
+            if(u8Stream)
+            {
+                /* The ACK of the last frame returns decoded size (0xFFFFFFFF on error) and byte sum instead of echo */
+                if((ISP_LzDecode(&s_sLz, rrMsg.Data, 8) < 0) || (s_sLz.u32State == ISP_LZ_STATE_DONE))
+                {
+                    u8Stream = 0;
+                    outpw(&rrMsg.Data[0], (s_sLz.u32State == ISP_LZ_STATE_DONE) ? s_sLz.u32Done : 0xFFFFFFFF);
+                    outpw(&rrMsg.Data[4], s_sLz.u32Sum);
+                }
+            }
+            else if(Address == CAN_CMD_UPDATE_APROM_LZ)
+            {
+                if(Data > g_u32IspDataFlashAddr)
+                {
+                    Data = g_u32IspDataFlashAddr;
+                }
+
+                ISP_FlashEraseUsed(FMC_APROM_BASE + Data, g_u32IspDataFlashAddr);
+                ISP_LzOpen(&s_sLz, FMC_APROM_BASE, Data, s_au32PageBuf);
+                u8Stream = (Data != 0);
+            }
+#else
+            if(Address == CAN_CMD_UPDATE_APROM_LZ)
+            {
+                /* Not built in. Answer like a failed stream. */
+                outpw(&rrMsg.Data[0], 0xFFFFFFFF);
+            }
+#endif
+            else if(Address == CAN_CMD_GET_DEVICEID)
             {
                 outpw(&rrMsg.Data[4], SYS->PDID);
             }
-            else if(Address == CMD_READ_CONFIG)
+            else if(Address == CAN_CMD_READ_CONFIG)
             {
-                outpw(&rrMsg.Data[4], FMC_Read(Data));
+                if(ISP_FlashRead(Data, Data + 4, &Data) < 0)
+                {
+                    Data = 0xFFFFFFFF;
+                }
+
+                outpw(&rrMsg.Data[4], Data);
             }
-            else if(Address == CMD_RUN_APROM)
+            else if(Address == CAN_CMD_RUN_APROM)
             {
                 break;
             }
@@ -223,11 +263,11 @@ int main(void)
             {
                 if((Address % FMC_FLASH_PAGE_SIZE) == 0)
                 {
-                    FMC_Erase(Address);
+                    ISP_FlashErase(Address, FMC_FLASH_PAGE_SIZE);
                 }
 
-                FMC_Write(Address, Data);         //program ROM
-                Data = FMC_Read(Address);
+                FMC_Write(Address, Data);    //program ROM
+                ISP_FlashRead(Address, Address + 4, &Data);
                 memcpy(&rrMsg.Data[4], &Data, 4); //update data
             }
 
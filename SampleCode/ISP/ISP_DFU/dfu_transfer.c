@@ -12,15 +12,15 @@
 #include <string.h>
 #include "M451Series.h"
 #include "dfu_transfer.h"
-#include "fmc_user.h"
+#include "isp_lib.h"
 
-extern uint32_t g_apromSize;
-#define APROM_BLOCK_NUM         ((g_apromSize/TRANSFER_SIZE)-1)
+#define APROM_BLOCK_NUM         ((g_u32IspApromSize/TRANSFER_SIZE)-1)
 
 uint32_t command_Count = 0;
 uint8_t manifest_state = MANIFEST_COMPLETE;
 dfu_status_struct dfu_status;
 s_prog_struct prog_struct __attribute__((aligned(4))) = {{0}, 0, 0, APP_LOADED_ADDR};
+static uint32_t s_au32PageBuf[FMC_FLASH_PAGE_SIZE / 4];   /* Keeps the head of a page while it is erased */
 
 void USBD_IRQHandler(void)
 {
@@ -174,7 +174,8 @@ void DFU_ClassRequest(void)
                     {
                         dfu_status.bState = STATE_dfuDNLOAD_IDLE;
 
-                        WriteData(prog_struct.block_num * TRANSFER_SIZE, (prog_struct.block_num * TRANSFER_SIZE) + prog_struct.data_len, (uint32_t *)prog_struct.buf);
+                        /* Erase and program only the pages which are changed */
+                        ISP_FlashUpdate(prog_struct.block_num * TRANSFER_SIZE, (prog_struct.block_num * TRANSFER_SIZE) + prog_struct.data_len, (uint32_t *)prog_struct.buf, s_au32PageBuf);
                         //dfu_status.bStatus = STATUS_errWRITE;
 
                         command_Count = 0;
@@ -239,7 +240,7 @@ void DFU_ClassRequest(void)
                             break;
                         }
 
-                        ReadData(wValue * TRANSFER_SIZE, (wValue * TRANSFER_SIZE) + wLength, (uint32_t *)prog_struct.buf);
+                        ISP_FlashRead(wValue * TRANSFER_SIZE, (wValue * TRANSFER_SIZE) + wLength, (uint32_t *)prog_struct.buf);
                         USBD_PrepareCtrlIn((uint8_t *)prog_struct.buf, wLength);
                     }
 
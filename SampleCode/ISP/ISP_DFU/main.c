@@ -9,41 +9,14 @@
  ******************************************************************************/
 #include <stdio.h>
 #include "M451Series.h"
-#include "fmc_user.h"
+#include "isp_lib.h"
 #include "dfu_transfer.h"
 
 #define PLLCTL_SETTING      CLK_PLLCTL_144MHz_HXT
 #define PLL_CLOCK           144000000
 
-#define V6M_AIRCR_VECTKEY_DATA    0x05FA0000UL
-#define V6M_AIRCR_SYSRESETREQ     0x00000004UL
-
 #define DetectPin   PD0
 
-uint32_t g_apromSize;
-
-uint32_t GetApromSize()
-{
-    //the smallest of APROM size is 2K
-    uint32_t size = 0x800, data;
-    int result;
-
-    do
-    {
-        result = FMC_Read_User(size, &data);
-
-        if(result < 0)
-        {
-            return size;
-        }
-        else
-        {
-            size *= 2;
-        }
-    }
-    while(1);
-}
-
 int32_t SYS_Init(void)
 {
     uint32_t u32TimeOutCnt;
@@ -107,9 +80,8 @@ int32_t main(void)
     /* Init system and multi-funcition I/O */
     if( SYS_Init() < 0 ) goto _APROM;
 
-    CLK->AHBCLK |= CLK_AHBCLK_ISPCKEN_Msk;
-    FMC->ISPCTL |= FMC_ISPCTL_ISPEN_Msk | FMC_ISPCTL_APUEN_Msk | FMC_ISPCTL_ISPFF_Msk;
-    g_apromSize = GetApromSize();
+    /* Enable ISP and get APROM size */
+    if(ISP_FlashOpen() < 0) goto _APROM;
 
     /* Open USB controller */
     USBD_Open(&gsInfo, DFU_ClassRequest, NULL);
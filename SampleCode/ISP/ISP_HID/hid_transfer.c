@@ -11,9 +11,16 @@
 #include "targetdev.h"
 #include "hid_transfer.h"
 
-uint8_t volatile g_u8EP2Ready = 0;
-__attribute__((aligned(4))) uint8_t usb_rcvbuf[64];
-uint8_t bUsbDataReady;
+static ISP_PKT_QUEUE_T s_sRxQ;
+static volatile uint8_t s_u8EP2Busy = 0;       /* Response is not read by host yet */
+static volatile uint8_t s_u8EP3Pending = 0;    /* OUT endpoint is NAKed until a packet buffer is free */
+
+static uint8_t *HID_RecvPacket(uint32_t *pu32Len);
+static void HID_ReleasePacket(void);
+static void HID_SendPacket(uint8_t *pu8Buf, uint32_t u32Len);
+
+/* Reports are EP3_MAX_PKT_SIZE bytes, but the host may keep a window of reports in flight */
+const ISP_TRANSPORT_T g_sHidTransport = {HID_RecvPacket, HID_ReleasePacket, HID_SendPacket, NULL, EP3_MAX_PKT_SIZE, ISP_PKT_BUF_NUM};
 
 void USBD_IRQHandler(void)
 {
@@ -49,6 +56,7 @@ void USBD_IRQHandler(void)
             /* Bus reset */
             USBD_ENABLE_USB();
             USBD_SwReset();
+            s_u8EP2Busy = 0;
         }
 
         if(u32State & USBD_STATE_SUSPEND)
@@ -107,7 +115,7 @@ void USBD_IRQHandler(void)
             /* Clear event flag */
             USBD_CLR_INT_FLAG(USBD_INTSTS_EP2);
             // Interrupt IN
-//          EP2_Handler();
+            s_u8EP2Busy = 0;
         }
 
         if(u32IntSts & USBD_INTSTS_EP3)
@@ -144,14 +152,35 @@ void USBD_IRQHandler(void)
     }
 }
 
-extern __attribute__((aligned(4))) uint8_t response_buff[64];
-void EP2_Handler(void)  /* Interrupt IN handler */
+static void HID_SendPacket(uint8_t *pu8Buf, uint32_t u32Len)  /* Interrupt IN */
 {
     uint8_t *ptr;
+
+    /* Wait for host to read the previous response. USBD interrupt is polled. */
+    while(s_u8EP2Busy && (DetectPin == 0))
+        USBD_IRQHandler();
+
+    s_u8EP2Busy = 1;
     ptr = (uint8_t *)(USBD_BUF_BASE + USBD_GET_EP_BUF_ADDR(EP2));
     /* Prepare the data for next HID IN transfer */
-    USBD_MemCopy(ptr, response_buff, EP2_MAX_PKT_SIZE);
-    USBD_SET_PAYLOAD_LEN(EP2, EP2_MAX_PKT_SIZE);
+    USBD_MemCopy(ptr, pu8Buf, u32Len);
+    USBD_SET_PAYLOAD_LEN(EP2, u32Len);
+}
+
+static uint8_t *HID_RecvPacket(uint32_t *pu32Len)
+{
+    return ISP_PktGet(&s_sRxQ, pu32Len);
+}
+
+static void HID_ReleasePacket(void)
+{
+    ISP_PktFree(&s_sRxQ);
+
+    if(s_u8EP3Pending)
+    {
+        s_u8EP3Pending = 0;
+        USBD_SET_PAYLOAD_LEN(EP3, EP3_MAX_PKT_SIZE);
+    }
 }
 
 void EP3_Handler(void)  /* Interrupt OUT handler */
@@ -159,9 +188,14 @@ void EP3_Handler(void)  /* Interrupt OUT handler */
     uint8_t *ptr;
     /* Interrupt OUT */
     ptr = (uint8_t *)(USBD_BUF_BASE + USBD_GET_EP_BUF_ADDR(EP3));
-    USBD_MemCopy(usb_rcvbuf, ptr, EP3_MAX_PKT_SIZE);
-    bUsbDataReady = TRUE;
-    USBD_SET_PAYLOAD_LEN(EP3, EP3_MAX_PKT_SIZE);
+    USBD_MemCopy(ISP_PktRxBuf(&s_sRxQ), ptr, EP3_MAX_PKT_SIZE);
+    ISP_PktRxDone(&s_sRxQ, EP3_MAX_PKT_SIZE);
+
+    /* Keep NAKing the host until ISP engine releases a packet buffer */
+    if(ISP_PktIsFull(&s_sRxQ))
+        s_u8EP3Pending = 1;
+    else
+        USBD_SET_PAYLOAD_LEN(EP3, EP3_MAX_PKT_SIZE);
 }
 
 
@@ -64,13 +64,12 @@
 
 /*-------------------------------------------------------------*/
 
-extern uint8_t bUsbDataReady;
+extern const ISP_TRANSPORT_T g_sHidTransport;
 
 /*-------------------------------------------------------------*/
 void HID_Init(void);
 void HID_ClassRequest(void);
 
-void EP2_Handler(void);
 void EP3_Handler(void);
 void HID_SetInReport(void);
 void HID_GetOutReport(uint8_t *pu8EpBuf, uint32_t u32Size);
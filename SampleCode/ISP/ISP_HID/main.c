@@ -75,12 +75,9 @@ int32_t main(void)
 
     /* Init system and multi-function I/O */
     if( SYS_Init() < 0 ) goto _APROM;
-    CLK->AHBCLK |= CLK_AHBCLK_ISPCKEN_Msk;
-    FMC->ISPCTL |= FMC_ISPCTL_ISPEN_Msk;
 
-    /* Get APROM size, data flash size and address */
-    g_apromSize = GetApromSize();
-    GetDataFlashInfo(&g_dataFlashAddr, &g_dataFlashSize);
+    /* Enable ISP and get APROM size, data flash size and address */
+    if(ISP_Open(&g_sHidTransport) < 0) goto _APROM;
 
     while(DetectPin == 0)
     {
@@ -99,12 +96,8 @@ int32_t main(void)
             // polling USBD interrupt flag
             USBD_IRQHandler();
 
-            if(bUsbDataReady == TRUE)
-            {
-                ParseCmd((uint8_t *)usb_rcvbuf, 64);
-                EP2_Handler();
-                bUsbDataReady = FALSE;
-            }
+            /* Parse command from host and send response back */
+            ISP_Poll();
         }
     }
 
@@ -1,66 +0,0 @@
-/***************************************************************************//**
- * @file     targetdev.c
- * @brief    ISP support function source file
- * @version  0x32
- * @date     14, June, 2017
- *
- * @note
- * @copyright SPDX-License-Identifier: Apache-2.0
- * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
- ******************************************************************************/
-#include "targetdev.h"
-#include "isp_user.h"
-
-uint32_t GetApromSize()
-{
-    //the smallest of APROM size is 2K
-    uint32_t size = 0x800, data;
-    int result;
-
-    do
-    {
-        result = FMC_Read_User(size, &data);
-
-        if(result < 0)
-        {
-            return size;
-        }
-        else
-        {
-            size *= 2;
-        }
-    }
-    while(1);
-}
-
-// Data Flash is shared with APROM.
-// The size and start address are defined in CONFIG1.
-void GetDataFlashInfo(uint32_t *addr, uint32_t *size)
-{
-    uint32_t uData;
-    *size = 0;
-    FMC_Read_User(Config0, &uData);
-
-    if((uData & 0x01) == 0)    //DFEN enable
-    {
-        FMC_Read_User(Config1, &uData);
-
-        // Filter the reserved bits in CONFIG1
-        uData &= 0x000FFFFF;
-
-        if(uData > g_apromSize || uData & (FMC_FLASH_PAGE_SIZE - 1))    //avoid config1 value from error
-        {
-            uData = g_apromSize;
-        }
-
-        *addr = uData;
-        *size = g_apromSize - uData;
-    }
-    else
-    {
-        *addr = g_apromSize;
-        *size = 0;
-    }
-}
-
-/*** (C) COPYRIGHT 2019 Nuvoton Technology Corp. ***/
@@ -18,7 +18,7 @@ extern "C"
 
 // Nuvoton MCU Peripheral Access Layer Header File
 #include "M451Series.h"
-#include "isp_user.h"
+#include "isp_lib.h"
 #include "hid_transfer.h"
 #define DetectPin                   PD0
 
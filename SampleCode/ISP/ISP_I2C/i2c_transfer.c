@@ -16,12 +16,17 @@
 /*---------------------------------------------------------------------------------------------------------*/
 /* Global variables                                                                                        */
 /*---------------------------------------------------------------------------------------------------------*/
-uint8_t au8I2cRcvBuf[64];
-volatile uint8_t u8I2cDataReady;
+static ISP_PKT_QUEUE_T s_sRxQ;
 
 volatile uint8_t g_u8SlvDataLen;
 
 __STATIC_INLINE void I2C_SlaveTRx(I2C_T *i2c, uint32_t u32Status);
+static uint8_t *I2C_RecvPacket(uint32_t *pu32Len);
+static void I2C_ReleasePacket(void);
+
+/* Master reads the response from g_au32IspResponse, so no send function is required and packets can't be
+   streamed. Packet size is fixed by the master protocol. */
+const ISP_TRANSPORT_T g_sI2cTransport = {I2C_RecvPacket, I2C_ReleasePacket, NULL, NULL, 64, 1};
 
 extern uint32_t u32Pclk0;
 extern uint32_t u32Pclk1;
@@ -70,20 +75,25 @@ void I2C1_IRQHandler(void)
 void I2C_SlaveTRx(I2C_T *i2c, uint32_t u32Status)
 {
     uint8_t u8data;
+    uint8_t *pu8RcvBuf = ISP_PktRxBuf(&s_sRxQ);
+    uint8_t *pu8Response = (uint8_t *)g_au32IspResponse;
 
     if (u32Status == 0x60)                      /* Own SLA+W has been receive; ACK has been return */
     {
-        u8I2cDataReady = 0;
         g_u8SlvDataLen = 0;
         I2C_SET_CONTROL_REG(i2c, I2C_CTL_SI_AA);
     }
     else if (u32Status == 0x80)                 /* Previously address with own SLA address
                                                    Data has been received; ACK has been returned*/
     {
-        au8I2cRcvBuf[g_u8SlvDataLen] = I2C_GET_DATA(i2c);
+        pu8RcvBuf[g_u8SlvDataLen] = I2C_GET_DATA(i2c);
         g_u8SlvDataLen++;
         g_u8SlvDataLen &= 0x3F;
-        u8I2cDataReady = (g_u8SlvDataLen == 0);
+
+        if (g_u8SlvDataLen == 0)
+        {
+            ISP_PktRxDone(&s_sRxQ, 64);
+        }
 
         if (g_u8SlvDataLen == 0x3F)
         {
@@ -97,14 +107,14 @@ void I2C_SlaveTRx(I2C_T *i2c, uint32_t u32Status)
     else if (u32Status == 0xA8)                 /* Own SLA+R has been receive; ACK has been return */
     {
         g_u8SlvDataLen = 0;
-        u8data = response_buff[g_u8SlvDataLen];
+        u8data = pu8Response[g_u8SlvDataLen];
         I2C_SET_DATA(i2c, u8data);
         g_u8SlvDataLen++;
         I2C_SET_CONTROL_REG(i2c, I2C_CTL_SI_AA);
     }
     else if (u32Status == 0xB8)
     {
-        u8data = response_buff[g_u8SlvDataLen];
+        u8data = pu8Response[g_u8SlvDataLen];
         I2C_SET_DATA(i2c, u8data);
         g_u8SlvDataLen++;
         g_u8SlvDataLen &= 0x3F;
@@ -130,9 +140,14 @@ void I2C_SlaveTRx(I2C_T *i2c, uint32_t u32Status)
     else if (u32Status == 0x88)                 /* Previously addressed with own SLA address; NOT ACK has
                                                    been returned */
     {
-        au8I2cRcvBuf[g_u8SlvDataLen] = I2C_GET_DATA(i2c);
+        pu8RcvBuf[g_u8SlvDataLen] = I2C_GET_DATA(i2c);
         g_u8SlvDataLen++;
-        u8I2cDataReady = (g_u8SlvDataLen == 64);
+
+        if (g_u8SlvDataLen == 64)
+        {
+            ISP_PktRxDone(&s_sRxQ, 64);
+        }
+
         g_u8SlvDataLen = 0;
         I2C_SET_CONTROL_REG(i2c, I2C_CTL_SI_AA);
     }
@@ -149,4 +164,12 @@ void I2C_SlaveTRx(I2C_T *i2c, uint32_t u32Status)
     }
 }
 
+static uint8_t *I2C_RecvPacket(uint32_t *pu32Len)
+{
+    return ISP_PktGet(&s_sRxQ, pu32Len);
+}
 
+static void I2C_ReleasePacket(void)
+{
+    ISP_PktFree(&s_sRxQ);
+}
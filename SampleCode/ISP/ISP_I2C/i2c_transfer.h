@@ -11,9 +11,9 @@
 #ifndef __I2C_TRANS_H__
 #define __I2C_TRANS_H__
 #include <stdint.h>
+#include "isp_lib.h"
 
-extern volatile uint8_t u8I2cDataReady;
-extern uint8_t au8I2cRcvBuf[];
+extern const ISP_TRANSPORT_T g_sI2cTransport;
 
 /*-------------------------------------------------------------*/
 void I2C_Init(void);
@@ -79,28 +79,14 @@ int32_t SYS_Init(void)
 
 int main(void)
 {
-    uint32_t au8CmdBuff[16];
-
     /* Unlock protected registers */
     SYS_UnlockReg();
 
     /* Init System, peripheral clock and multi-function I/O */
     if( SYS_Init() < 0 ) goto _APROM;
 
-    /* Enable ISP */
-    CLK->AHBCLK |= CLK_AHBCLK_ISPCKEN_Msk;
-    FMC->ISPCTL |= (FMC_ISPCTL_ISPEN_Msk | FMC_ISPCTL_APUEN_Msk);
-
-    /* Get APROM size, data flash size and address */
-    g_apromSize = GetApromSize();
-    if( g_apromSize == 0 ) goto _APROM;
-    GetDataFlashInfo(&g_dataFlashAddr, &g_dataFlashSize);
-
-    if (g_dataFlashAddr < g_apromSize) {
-        g_dataFlashSize = (g_apromSize - g_dataFlashAddr);
-    } else {
-        g_dataFlashSize = 0;
-    }
+    /* Enable ISP and get APROM size, data flash size and address */
+    if (ISP_Open(&g_sI2cTransport) < 0) goto _APROM;
 
     /* Init I2C */
     I2C_Init();
@@ -114,7 +100,7 @@ int main(void)
     while (1)
     {
         /* Wait for CMD_CONNECT command */
-        if (u8I2cDataReady == 1)
+        if (ISP_Poll() == CMD_CONNECT)
         {
             goto _ISP;
         }
@@ -127,17 +113,10 @@ int main(void)
 
 _ISP:
 
-    /* Parse command from master and send response back */
+    /* Parse command from master. Master reads the response by itself. */
     while (1)
     {
-        if (u8I2cDataReady == 1)
-        {
-            /* Get command from I2C receive buffer */
-            memcpy(au8CmdBuff, au8I2cRcvBuf, 64);
-            u8I2cDataReady = 0;
-            /* Parse the current command */
-            ParseCmd((unsigned char *)au8CmdBuff, 64);
-        }
+        ISP_Poll();
     }
 
 _APROM:
@@ -8,6 +8,6 @@
  * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
  ******************************************************************************/
 #include "M451Series.h"
-#include "ISP_USER.h"
+#include "isp_lib.h"
 
 /*** (C) COPYRIGHT 2019 Nuvoton Technology Corp. ***/
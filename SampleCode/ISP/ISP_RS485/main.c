@@ -18,10 +18,6 @@
 #define PLLCTL_SETTING  CLK_PLLCTL_72MHz_HIRC
 #define PLL_CLOCK       71884800
 
-#define nRTSPin                 (PB8)
-#define REVEIVE_MODE            (0)
-#define TRANSMIT_MODE           (1)
-
 
 /*---------------------------------------------------------------------------------------------------------*/
 /* Global variables                                                                                        */
@@ -102,13 +98,8 @@ int32_t main(void)
     /* Init UART to 115200-8n1 */
     UART_Init();
 
-    /* Enable FMC ISP */
-    FMC->ISPCTL |= FMC_ISPCTL_ISPEN_Msk;
-
-    /* Get APROM size, data flash size and address */
-    g_apromSize = GetApromSize();
-    if( g_apromSize == 0 ) goto _APROM;
-    GetDataFlashInfo(&g_dataFlashAddr, &g_dataFlashSize);
+    /* Enable FMC ISP and get APROM size, data flash size and address */
+    if (ISP_Open(&g_sUartTransport) < 0) goto _APROM;
 
     /* Set Systick time-out for 300ms */
     SysTick->LOAD = 300000 * CyclesPerUs;
@@ -119,16 +110,8 @@ int32_t main(void)
     while (1) {
 
         /* Wait for CMD_CONNECT command */
-        if ((bufhead >= 4) || (bUartDataReady == TRUE)) {
-            uint32_t lcmd;
-            lcmd = inpw(uart_rcvbuf);
-
-            if (lcmd == CMD_CONNECT) {
-                break;
-            } else {
-                bUartDataReady = FALSE;
-                bufhead = 0;
-            }
+        if (ISP_Poll() == CMD_CONNECT) {
+            break;
         }
 
         /* Systick time-out, then go to APROM */
@@ -137,23 +120,9 @@ int32_t main(void)
         }
     }
 
-    /* Prase command from master and send response back */
+    /* Parse command from master and send response back */
     while (1) {
-
-        if (bUartDataReady == TRUE) {
-            bUartDataReady = FALSE;;        /* Reset UART data ready flag */
-            ParseCmd(uart_rcvbuf, 64);      /* Parse command from master */
-            NVIC_DisableIRQ(UART1_IRQn);    /* Disable NVIC */
-            nRTSPin = TRANSMIT_MODE;        /* Control RTS in transmit mode */
-            PutString();                    /* Send response to master */
-
-            /* Wait for data transmission is finished */
-            while ((UART1->FIFOSTS & UART_FIFOSTS_TXEMPTYF_Msk) == 0);
-
-            nRTSPin = REVEIVE_MODE;         /* Control RTS in reveive mode */
-            NVIC_EnableIRQ(UART1_IRQn);    /* Enable NVIC */
-        }
-
+        ISP_Poll();
     }
 
 _APROM:
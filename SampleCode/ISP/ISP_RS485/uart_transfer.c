@@ -13,15 +13,19 @@
 #include "targetdev.h"
 #include "uart_transfer.h"
 
-#ifdef __ICCARM__
-#pragma data_alignment=4
-uint8_t  uart_rcvbuf[MAX_PKT_SIZE] = {0};
-#else
-__attribute__((aligned(4))) uint8_t  uart_rcvbuf[MAX_PKT_SIZE] = {0};
-#endif
+static ISP_PKT_QUEUE_T s_sRxQ;
+static uint32_t volatile s_u32RxLen = 0;
+static uint32_t volatile s_u32PktSize = MAX_PKT_SIZE;
 
-uint8_t volatile bUartDataReady = 0;
-uint8_t volatile bufhead = 0;
+static uint8_t *UART_RecvPacket(uint32_t *pu32Len);
+static void UART_ReleasePacket(void);
+static void UART_SendPacket(uint8_t *pu8Buf, uint32_t u32Len);
+static void UART_SetPktSize(uint32_t u32PktSize);
+
+/* RS485 is half duplex, so the host can't send next packet before the response */
+const ISP_TRANSPORT_T g_sUartTransport = {UART_RecvPacket, UART_ReleasePacket, UART_SendPacket, UART_SetPktSize,
+                                          ISP_MAX_PKT_SIZE, 1
+                                         };
 
 
 /*---------------------------------------------------------------------------------------------------------*/
@@ -31,39 +35,68 @@ void UART1_IRQHandler(void)
 {
     /* Determine interrupt source */
     uint32_t u32IntSrc = UART1->INTSTS;
+    uint8_t *pu8Buf = ISP_PktRxBuf(&s_sRxQ);
 
     /* RDA FIFO interrupt and RDA timeout interrupt */
-    if (u32IntSrc & (UART_INTSTS_RXTOIF_Msk|UART_INTSTS_RDAIF_Msk)) { 
+    if (u32IntSrc & (UART_INTSTS_RXTOIF_Msk|UART_INTSTS_RDAIF_Msk)) {
 
         /* Read data until RX FIFO is empty or data is over maximum packet size */
-        while (((UART1->FIFOSTS & UART_FIFOSTS_RXEMPTY_Msk) == 0) && (bufhead < MAX_PKT_SIZE)) {	
-            uart_rcvbuf[bufhead++] = UART1->DAT;
+        while (((UART1->FIFOSTS & UART_FIFOSTS_RXEMPTY_Msk) == 0) && (s_u32RxLen < s_u32PktSize)) {
+            pu8Buf[s_u32RxLen++] = UART1->DAT;
         }
     }
 
-    /* Reset data buffer index */
-    if (bufhead == MAX_PKT_SIZE) {
-        bUartDataReady = TRUE;
-        bufhead = 0;
+    /* Hand the packet to ISP engine and reset data buffer index */
+    if (s_u32RxLen == s_u32PktSize) {
+        ISP_PktRxDone(&s_sRxQ, s_u32RxLen);
+        s_u32RxLen = 0;
     } else if (u32IntSrc & UART_INTSTS_RXTOIF_Msk) {
-        bufhead = 0;
+        /* A restarted host connects with legacy packets while large packets are expected */
+        if ((s_u32RxLen == ISP_LEGACY_PKT_SIZE) && (inpw(pu8Buf) == CMD_CONNECT)) {
+            ISP_PktRxDone(&s_sRxQ, s_u32RxLen);
+        }
+
+        s_u32RxLen = 0;
     }
 }
 
-extern __attribute__((aligned(4))) uint8_t response_buff[64];
-void PutString(void)
+static uint8_t *UART_RecvPacket(uint32_t *pu32Len)
+{
+    return ISP_PktGet(&s_sRxQ, pu32Len);
+}
+
+static void UART_ReleasePacket(void)
+{
+    ISP_PktFree(&s_sRxQ);
+}
+
+static void UART_SetPktSize(uint32_t u32PktSize)
+{
+    s_u32PktSize = u32PktSize;
+}
+
+static void UART_SendPacket(uint8_t *pu8Buf, uint32_t u32Len)
 {
     uint32_t i;
 
-    /* UART send response to master */    
-    for (i = 0; i < MAX_PKT_SIZE; i++) {
-        
+    NVIC_DisableIRQ(UART1_IRQn);    /* Disable NVIC */
+    nRTSPin = TRANSMIT_MODE;        /* Control RTS in transmit mode */
+
+    /* UART send response to master */
+    for (i = 0; i < u32Len; i++) {
+
         /* Wait for TX not full */
         while ((UART1->FIFOSTS & UART_FIFOSTS_TXFULL_Msk));
 
         /* UART send data */
-        UART1->DAT = response_buff[i];
+        UART1->DAT = pu8Buf[i];
     }
+
+    /* Wait for data transmission is finished */
+    while ((UART1->FIFOSTS & UART_FIFOSTS_TXEMPTYF_Msk) == 0);
+
+    nRTSPin = REVEIVE_MODE;         /* Control RTS in reveive mode */
+    NVIC_EnableIRQ(UART1_IRQn);     /* Enable NVIC */
 }
 
 void UART_Init()
@@ -10,22 +10,26 @@
 #ifndef __UART_TRANS_H__
 #define __UART_TRANS_H__
 #include <stdint.h>
+#include "isp_lib.h"
 
 /*-------------------------------------------------------------*/
-/* Define maximum packet size */
-#define MAX_PKT_SIZE        	64
+/* Define packet size before CMD_NEGOTIATE */
+#define MAX_PKT_SIZE        	ISP_LEGACY_PKT_SIZE
 
 /*-------------------------------------------------------------*/
 
-extern uint8_t  uart_rcvbuf[];
-extern uint8_t volatile bUartDataReady;
-extern uint8_t volatile bufhead;
+/* RS485 direction control */
+#define nRTSPin                 (PB8)
+#define REVEIVE_MODE            (0)
+#define TRANSMIT_MODE           (1)
+
+/*-------------------------------------------------------------*/
+
+extern const ISP_TRANSPORT_T g_sUartTransport;
 
 /*-------------------------------------------------------------*/
 void UART_Init(void);
-void UART0_IRQHandler(void);
-void PutString(void);
-uint32_t UART_IS_CONNECT(void);
+void UART1_IRQHandler(void);
 
 #endif  /* __UART_TRANS_H__ */
 
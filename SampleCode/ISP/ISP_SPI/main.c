@@ -111,26 +111,21 @@ int32_t SYS_Init(void)
 /*---------------------------------------------------------------------------------------------------------*/
 int32_t main(void)
 {
-    uint32_t cmd_buff[16];
-
     /* Unlock protected registers */
     SYS_UnlockReg();
     /* Init System, peripheral clock and multi-function I/O */
     if( SYS_Init() < 0 ) goto _APROM;
+
+    /* Enable ISP and get APROM size, data flash size and address */
+    if(ISP_Open(&g_sSpiTransport) < 0) goto _APROM;
+
     SPI_Init();
     GPIO_Init();
     TIMER3_Init();
 
-    CLK->AHBCLK |= CLK_AHBCLK_ISPCKEN_Msk;
-    FMC->ISPCTL |= (FMC_ISPCTL_ISPEN_Msk | FMC_ISPCTL_APUEN_Msk);
-
-    /* Get APROM size, data flash size and address */
-    g_apromSize = GetApromSize();
-    GetDataFlashInfo(&g_dataFlashAddr, &g_dataFlashSize);
-
     while(1)
     {
-        if(bSpiDataReady == 1)
+        if(ISP_Poll() == CMD_CONNECT)
         {
             goto _ISP;
         }
@@ -144,12 +139,7 @@ int32_t main(void)
 _ISP:
     while(1)
     {
-        if(bSpiDataReady == 1)
-        {
-            memcpy(cmd_buff, spi_rcvbuf, 64);
-            bSpiDataReady = 0;
-            ParseCmd((unsigned char *)cmd_buff, 64);
-        }
+        ISP_Poll();
     }
 
 _APROM:
@@ -14,11 +14,16 @@
 /*---------------------------------------------------------------------------------------------------------*/
 #define TEST_COUNT 16
 
-uint32_t spi_rcvbuf[TEST_COUNT];
+static ISP_PKT_QUEUE_T s_sRxQ;
 volatile uint32_t g_u32TxDataCount;
 volatile uint32_t g_u32RxDataCount;
 
-volatile uint8_t bSpiDataReady = 0;
+static uint8_t *SPI_RecvPacket(uint32_t *pu32Len);
+static void SPI_ReleasePacket(void);
+
+/* Master reads the response from g_au32IspResponse, so no send function is required and packets can't be
+   streamed. Packet size is fixed by the master protocol. */
+const ISP_TRANSPORT_T g_sSpiTransport = {SPI_RecvPacket, SPI_ReleasePacket, NULL, NULL, TEST_COUNT * 4, 1};
 
 void SPI_Init(void)
 {
@@ -52,8 +57,9 @@ void GPIO_Init(void)
 /*---------------------------------------------------------------------------------------------------------*/
 void GPE_IRQHandler(void)
 {
-    uint32_t *_response_buff;
-    _response_buff = (uint32_t *)response_buff; // in isp_user.c
+    uint32_t *_response_buff, *pu32RcvBuf;
+    _response_buff = g_au32IspResponse;
+    pu32RcvBuf = (uint32_t *)ISP_PktRxBuf(&s_sRxQ);
 
     if(GPIO_GET_INT_FLAG(PE, BIT12))
     {
@@ -81,7 +87,7 @@ void GPE_IRQHandler(void)
             if(SPI_GET_RX_FIFO_EMPTY_FLAG(SPI1) == 0)
             {
                 g_u32RxDataCount &= 0x0F;
-                spi_rcvbuf[g_u32RxDataCount++] = SPI_READ_RX(SPI1);    /* Read RX FIFO */
+                pu32RcvBuf[g_u32RxDataCount++] = SPI_READ_RX(SPI1);    /* Read RX FIFO */
             }
 
             if(SysTick->CTRL & SysTick_CTRL_COUNTFLAG_Msk)
@@ -94,12 +100,13 @@ void GPE_IRQHandler(void)
 
         if(PE12 == 1)
         {
-            if((g_u32RxDataCount == 16) && ((spi_rcvbuf[0] & 0xFFFFFF00) == 0x53504900))
+            if((g_u32RxDataCount == 16) && ((pu32RcvBuf[0] & 0xFFFFFF00) == 0x53504900))
             {
-                bSpiDataReady = 1;
+                /* Remove the signature and hand the packet to ISP engine */
+                pu32RcvBuf[0] &= 0x000000FF;
+                ISP_PktRxDone(&s_sRxQ, TEST_COUNT * 4);
             }
 
-            spi_rcvbuf[0] &= 0x000000FF;
             g_u32TxDataCount = 0;
             g_u32RxDataCount = 0;
 
@@ -114,4 +121,14 @@ void GPE_IRQHandler(void)
     }
 }
 
+static uint8_t *SPI_RecvPacket(uint32_t *pu32Len)
+{
+    return ISP_PktGet(&s_sRxQ, pu32Len);
+}
+
+static void SPI_ReleasePacket(void)
+{
+    ISP_PktFree(&s_sRxQ);
+}
+
 /*** (C) COPYRIGHT 2019 Nuvoton Technology Corp. ***/
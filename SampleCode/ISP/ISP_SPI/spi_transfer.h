@@ -9,9 +9,9 @@
 #ifndef __SPI_TRANS_H__
 #define __SPI_TRANS_H__
 #include <stdint.h>
+#include "isp_lib.h"
 
-extern volatile uint8_t bSpiDataReady;
-extern uint32_t spi_rcvbuf[];
+extern const ISP_TRANSPORT_T g_sSpiTransport;
 
 /*-------------------------------------------------------------*/
 void SPI_Init(void);
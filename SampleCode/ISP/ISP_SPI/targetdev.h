@@ -17,7 +17,7 @@ extern "C"
 
 // Nuvoton MCU Peripheral Access Layer Header File
 #include "M451Series.h"
-#include "isp_user.h"
+#include "isp_lib.h"
 
 #ifdef __cplusplus
 }
@@ -94,16 +94,11 @@ int32_t main(void)
     /* Init System, peripheral clock and multi-function I/O */
     if( SYS_Init() < 0 ) goto _APROM;
 
-    /* Init UART to 115200-8n1 */
+    /* Init UART to UART_BAUD_RATE-8n1 with PDMA */
     UART_Init();
 
-    /* Enable FMC ISP */
-    FMC->ISPCTL |= FMC_ISPCTL_ISPEN_Msk;
-
-    /* Get APROM size, data flash size and address */
-    g_apromSize = GetApromSize();
-    if( g_apromSize == 0 ) goto _APROM;
-    GetDataFlashInfo(&g_dataFlashAddr, &g_dataFlashSize);
+    /* Enable FMC ISP and get APROM size, data flash size and address */
+    if (ISP_Open(&g_sUartTransport) < 0) goto _APROM;
 
     /* Set Systick time-out for 300ms */
     SysTick->LOAD = 300000 * CyclesPerUs;
@@ -114,16 +109,8 @@ int32_t main(void)
     while (1) {
 
         /* Wait for CMD_CONNECT command */
-        if ((bufhead >= 4) || (bUartDataReady == TRUE)) {
-            uint32_t lcmd;
-            lcmd = inpw(uart_rcvbuf);
-
-            if (lcmd == CMD_CONNECT) {
-                break;
-            } else {
-                bUartDataReady = FALSE;
-                bufhead = 0;
-            }
+        if (ISP_Poll() == CMD_CONNECT) {
+            break;
         }
 
         /* Systick time-out, then go to APROM */
@@ -132,13 +119,9 @@ int32_t main(void)
         }
     }
 
-    /* Prase command from master and send response back */      
+    /* Parse command from master and send response back */
     while (1) {
-        if (bUartDataReady == TRUE) {
-            bUartDataReady = FALSE;
-            ParseCmd(uart_rcvbuf, 64);
-            PutString();
-        }
+        ISP_Poll();
     }
 
 _APROM:
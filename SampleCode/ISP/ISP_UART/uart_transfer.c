@@ -13,57 +13,158 @@
 #include "targetdev.h"
 #include "uart_transfer.h"
 
-#ifdef __ICCARM__
-#pragma data_alignment=4
-uint8_t  uart_rcvbuf[MAX_PKT_SIZE] = {0};
-#else
-__attribute__((aligned(4))) uint8_t  uart_rcvbuf[MAX_PKT_SIZE] = {0};
-#endif
+/* Scatter-gather descriptor of PDMA */
+typedef struct {
+    uint32_t u32Ctl;
+    uint32_t u32Src;
+    uint32_t u32Dst;
+    uint32_t u32Next;
+} UART_DMA_DESC_T;
 
-uint8_t volatile bUartDataReady = 0;
-uint8_t volatile bufhead = 0;
+static ISP_PKT_QUEUE_T s_sRxQ;
+static UART_DMA_DESC_T s_asRxDesc[ISP_PKT_BUF_NUM];     /* Descriptor n receives into packet buffer n */
+static uint32_t s_au32TxBuf[ISP_LEGACY_PKT_SIZE / 4];
+static uint32_t volatile s_u32RxCtl;                    /* Descriptor control word for current packet size */
+static uint32_t volatile s_u32PktSize = MAX_PKT_SIZE;
+static uint32_t s_u32RxCount, s_u32IdleTicks, s_u32LastTick;
 
+static uint8_t *UART_RecvPacket(uint32_t *pu32Len);
+static void UART_ReleasePacket(void);
+static void UART_SendPacket(uint8_t *pu8Buf, uint32_t u32Len);
+static void UART_SetPktSize(uint32_t u32PktSize);
+
+/* One buffer stays free while the host waits for a response, so PDMA never fills a packet in use */
+const ISP_TRANSPORT_T g_sUartTransport = {UART_RecvPacket, UART_ReleasePacket, UART_SendPacket, UART_SetPktSize,
+                                          ISP_MAX_PKT_SIZE, ISP_PKT_BUF_NUM - 1
+                                         };
+
+
+/* (Re)start the receive ring at the next packet buffer of the queue. PDMA interrupt must be masked. */
+static void UART_RxStart(void)
+{
+    uint32_t i;
+
+    PDMA->STOP = (1 << UART_RX_DMA_CH);
+    UART0->FIFO |= UART_FIFO_RXRST_Msk;
+
+    s_u32RxCtl = ((s_u32PktSize - 1) << PDMA_DSCT_CTL_TXCNT_Pos) | PDMA_WIDTH_8 | PDMA_SAR_FIX | PDMA_DAR_INC |
+                 PDMA_REQ_SINGLE | PDMA_OP_SCATTER;
+
+    for (i = 0; i < ISP_PKT_BUF_NUM; i++) {
+        s_asRxDesc[i].u32Ctl = s_u32RxCtl;
+        s_asRxDesc[i].u32Src = (uint32_t)&UART0->DAT;
+        s_asRxDesc[i].u32Dst = (uint32_t)s_sRxQ.au32Buf[i];
+        s_asRxDesc[i].u32Next = (uint32_t)&s_asRxDesc[(i + 1) % ISP_PKT_BUF_NUM] - PDMA->SCATBA;
+    }
+
+    PDMA->TDSTS = (1 << UART_RX_DMA_CH);
+    PDMA->DSCT[UART_RX_DMA_CH].CTL = PDMA_OP_SCATTER;
+    PDMA->DSCT[UART_RX_DMA_CH].NEXT = (uint32_t)&s_asRxDesc[s_sRxQ.u32Head & (ISP_PKT_BUF_NUM - 1)] - PDMA->SCATBA;
+    PDMA->CHCTL |= (1 << UART_RX_DMA_CH);
+
+    s_u32RxCount = 0;
+    s_u32IdleTicks = 0;
+}
 
 /*---------------------------------------------------------------------------------------------------------*/
-/* INTSTS to handle UART Channel 0 interrupt event                                                         */
+/* PDMA interrupt. A descriptor is written back as idle when its packet is complete.                      */
 /*---------------------------------------------------------------------------------------------------------*/
-void UART0_IRQHandler(void)
+void PDMA_IRQHandler(void)
 {
-    /* Determine interrupt source */
-    uint32_t u32IntSrc = UART0->INTSTS;
-
-    /* RDA FIFO interrupt and RDA timeout interrupt */    
-    if (u32IntSrc & (UART_INTSTS_RXTOIF_Msk|UART_INTSTS_RDAIF_Msk)) { 
-        
-        /* Read data until RX FIFO is empty or data is over maximum packet size */
-        while (((UART0->FIFOSTS & UART_FIFOSTS_RXEMPTY_Msk) == 0) && (bufhead < MAX_PKT_SIZE)) {	
-            uart_rcvbuf[bufhead++] = UART0->DAT;
+    UART_DMA_DESC_T *psDesc;
+
+    PDMA->TDSTS = (1 << UART_RX_DMA_CH);
+
+    /* Several packets may complete while the CPU is stalled by a flash erase */
+    while (1) {
+        psDesc = &s_asRxDesc[s_sRxQ.u32Head & (ISP_PKT_BUF_NUM - 1)];
+
+        if (psDesc->u32Ctl & PDMA_DSCT_CTL_OPMODE_Msk)
+            break;
+
+        /* The host ignored the window. Resynchronize rather than overwrite a packet in use. */
+        if (ISP_PktIsFull(&s_sRxQ)) {
+            UART_RxStart();
+            break;
         }
-    }
 
-    /* Reset data buffer index */      
-    if (bufhead == MAX_PKT_SIZE) {
-        bUartDataReady = TRUE;
-        bufhead = 0;
-    } else if (u32IntSrc & UART_INTSTS_RXTOIF_Msk) {
-        bufhead = 0;
+        ISP_PktRxDone(&s_sRxQ, s_u32PktSize);
+        psDesc->u32Ctl = s_u32RxCtl;
     }
 }
 
-extern __attribute__((aligned(4))) uint8_t response_buff[64];
-void PutString(void)
+/* Bytes of the packet in progress */
+static uint32_t UART_RxPartial(void)
 {
-    uint32_t i;
+    uint32_t u32Ctl = PDMA->DSCT[UART_RX_DMA_CH].CTL;
+
+    if ((u32Ctl & PDMA_DSCT_CTL_OPMODE_Msk) == 0)
+        return 0;
+
+    return s_u32PktSize - (((u32Ctl & PDMA_DSCT_CTL_TXCNT_Msk) >> PDMA_DSCT_CTL_TXCNT_Pos) + 1);
+}
+
+static uint8_t *UART_RecvPacket(uint32_t *pu32Len)
+{
+    uint8_t *pu8Buf = ISP_PktGet(&s_sRxQ, pu32Len);
+    uint32_t u32Tick, u32Count;
+
+    if (pu8Buf)
+        return pu8Buf;
+
+    /* Idle time of a partial packet is measured with SysTick, which main() keeps running */
+    u32Tick = SysTick->VAL;
+    u32Count = UART_RxPartial();
 
-    /* UART send response to master */    
-    for (i = 0; i < MAX_PKT_SIZE; i++) {
-        
-        /* Wait for TX not full */        
-        while ((UART0->FIFOSTS & UART_FIFOSTS_TXFULL_Msk));
+    if (u32Count != s_u32RxCount) {
+        s_u32RxCount = u32Count;
+        s_u32IdleTicks = 0;
+    } else if (u32Count) {
+        s_u32IdleTicks += (s_u32LastTick >= u32Tick) ? (s_u32LastTick - u32Tick) : (s_u32LastTick + SysTick->LOAD + 1 - u32Tick);
 
-        /* UART send data */         
-        UART0->DAT = response_buff[i];
+        if (s_u32IdleTicks > UART_RX_IDLE_US * CyclesPerUs) {
+            NVIC_DisableIRQ(PDMA_IRQn);
+
+            /* A restarted host connects with legacy packets while large packets are expected */
+            if ((UART_RxPartial() == ISP_LEGACY_PKT_SIZE) && (inpw(ISP_PktRxBuf(&s_sRxQ)) == CMD_CONNECT)) {
+                ISP_PktRxDone(&s_sRxQ, ISP_LEGACY_PKT_SIZE);
+            }
+
+            UART_RxStart();
+            NVIC_EnableIRQ(PDMA_IRQn);
+        }
     }
+
+    s_u32LastTick = u32Tick;
+    return NULL;
+}
+
+static void UART_ReleasePacket(void)
+{
+    ISP_PktFree(&s_sRxQ);
+}
+
+static void UART_SetPktSize(uint32_t u32PktSize)
+{
+    /* The host sends the next packet after it got the response, so the ring restarts between packets */
+    NVIC_DisableIRQ(PDMA_IRQn);
+    s_u32PktSize = u32PktSize;
+    UART_RxStart();
+    NVIC_EnableIRQ(PDMA_IRQn);
+}
+
+static void UART_SendPacket(uint8_t *pu8Buf, uint32_t u32Len)
+{
+    /* Wait for the previous response. PDMA sends from a copy, so the engine may build the next one. */
+    while (PDMA->DSCT[UART_TX_DMA_CH].CTL & PDMA_DSCT_CTL_OPMODE_Msk);
+
+    memcpy(s_au32TxBuf, pu8Buf, u32Len);
+
+    PDMA->DSCT[UART_TX_DMA_CH].SA = (uint32_t)s_au32TxBuf;
+    PDMA->DSCT[UART_TX_DMA_CH].DA = (uint32_t)&UART0->DAT;
+    PDMA->DSCT[UART_TX_DMA_CH].CTL = ((u32Len - 1) << PDMA_DSCT_CTL_TXCNT_Pos) | PDMA_WIDTH_8 | PDMA_SAR_INC |
+                                     PDMA_DAR_FIX | PDMA_REQ_SINGLE | PDMA_OP_BASIC;
+    PDMA->CHCTL |= (1 << UART_TX_DMA_CH);
 }
 
 void UART_Init()
@@ -75,16 +176,25 @@ void UART_Init()
     UART0->FUNCSEL = UART_FUNCSEL_UART;
     /* Set UART line configuration */
     UART0->LINE = UART_WORD_LEN_8 | UART_PARITY_NONE | UART_STOP_BIT_1;
-    /* Set UART Rx and RTS trigger level */
-    UART0->FIFO = UART_FIFO_RFITL_14BYTES | UART_FIFO_RTSTRGLV_14BYTES;
-    /* Set UART baud rate */
-    UART0->BAUD = (UART_BAUD_MODE0 | UART_BAUD_MODE0_DIVIDER(__HIRC, 115200));
-    /* Set time-out interrupt comparaTOUT */
-    UART0->TOUT = (UART0->TOUT & ~UART_TOUT_TOIC_Msk) | (0x40);
-    NVIC_SetPriority(UART0_IRQn, 2);
-    NVIC_EnableIRQ(UART0_IRQn);
-    /* Enable tim-out counter, Rx tim-out interrupt and Rx ready interrupt */
-    UART0->INTEN = (UART_INTEN_TOCNTEN_Msk | UART_INTEN_RXTOIEN_Msk | UART_INTEN_RDAIEN_Msk);
+    /* Set UART RTS trigger level */
+    UART0->FIFO = UART_FIFO_RTSTRGLV_14BYTES;
+    /* Set UART baud rate. Mode 2 divides HIRC exactly for 115200 ~ 1843200 bps. */
+    UART0->BAUD = (UART_BAUD_MODE2 | UART_BAUD_MODE2_DIVIDER(__HIRC, UART_BAUD_RATE));
+
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init PDMA. RX runs a ring of descriptors over the packet buffers, TX sends each response.               */
+    /*---------------------------------------------------------------------------------------------------------*/
+    CLK->AHBCLK |= CLK_AHBCLK_PDMACKEN_Msk;
+    PDMA->REQSEL0_3 = (PDMA->REQSEL0_3 & ~(PDMA_REQSEL0_3_REQSRC0_Msk | PDMA_REQSEL0_3_REQSRC1_Msk)) |
+                      (PDMA_UART0_RX << PDMA_REQSEL0_3_REQSRC0_Pos) | (PDMA_UART0_TX << PDMA_REQSEL0_3_REQSRC1_Pos);
+    PDMA->DSCT[UART_TX_DMA_CH].CTL = 0;
+    PDMA->INTEN = (1 << UART_RX_DMA_CH);
+    UART_RxStart();
+    NVIC_SetPriority(PDMA_IRQn, 2);
+    NVIC_EnableIRQ(PDMA_IRQn);
+
+    /* Enable UART PDMA requests */
+    UART0->INTEN = (UART_INTEN_RXPDMAEN_Msk | UART_INTEN_TXPDMAEN_Msk);
 }
 
 /*** (C) COPYRIGHT 2019 Nuvoton Technology Corp. ***/
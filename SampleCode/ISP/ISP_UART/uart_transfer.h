@@ -10,22 +10,31 @@
 #ifndef __UART_TRANS_H__
 #define __UART_TRANS_H__
 #include <stdint.h>
+#include "isp_lib.h"
 
 /*-------------------------------------------------------------*/
-/* Define maximum packet size */
-#define MAX_PKT_SIZE        	64
+/* Define packet size before CMD_NEGOTIATE */
+#define MAX_PKT_SIZE        	ISP_LEGACY_PKT_SIZE
+
+/* Define UART baud rate. 115200 bps is the rate of the NuMicro ISP Programming Tool. For a faster link define
+   UART_BAUD_RATE in the project, e.g. 921600, and run LinuxTool/isp_uart with the same -b rate. PDMA receives
+   whole packets, so the rate is not limited by the CPU. Mode 2 divides HIRC exactly for 115200 ~ 1843200 bps. */
+#ifndef UART_BAUD_RATE
+#define UART_BAUD_RATE          115200
+#endif
+
+/* Define PDMA channels and idle time which drops a partial packet */
+#define UART_RX_DMA_CH          0
+#define UART_TX_DMA_CH          1
+#define UART_RX_IDLE_US         20000
 
 /*-------------------------------------------------------------*/
 
-extern uint8_t  uart_rcvbuf[];
-extern uint8_t volatile bUartDataReady;
-extern uint8_t volatile bufhead;
+extern const ISP_TRANSPORT_T g_sUartTransport;
 
 /*-------------------------------------------------------------*/
 void UART_Init(void);
-void UART0_IRQHandler(void);
-void PutString(void);
-uint32_t UART_IS_CONNECT(void);
+void PDMA_IRQHandler(void);
 
 #endif  /* __UART_TRANS_H__ */
 
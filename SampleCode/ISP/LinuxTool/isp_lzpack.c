@@ -0,0 +1,291 @@
+/**************************************************************************//**
+ * @file     isp_lzpack.c
+ * @version  V1.00
+ * @brief    Linux tool to compress an APROM image for CMD_UPDATE_APROM_LZ
+ *
+ * @note
+ *           Build : gcc -O2 -o isp_lzpack isp_lzpack.c
+ *           Usage : isp_lzpack <image.bin> <image.lz>
+ *
+ *           The output is an LZ4 block without frame header. The ISP host sends the size and the byte sum of
+ *           the input image, which the tool prints, with the stream. The tool decodes the stream again and
+ *           compares it with the input before writing it.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MIN_MATCH       4
+#define MAX_OFFSET      65535
+#define LAST_LITERALS   5           /* LZ4 block rules, so any LZ4 decoder accepts the stream */
+#define MF_LIMIT        12
+#define HASH_BITS       16
+#define CHAIN_DEPTH     256
+
+#define ISP_PKT_SIZE    64          /* Legacy ISP packet. First packet carries 48 data bytes, the others 56. */
+
+static uint32_t Hash(const uint8_t *pu8Buf)
+{
+    uint32_t u32Data = pu8Buf[0] | (pu8Buf[1] << 8) | (pu8Buf[2] << 16) | ((uint32_t)pu8Buf[3] << 24);
+    return (u32Data * 2654435761U) >> (32 - HASH_BITS);
+}
+
+static uint8_t *PutLen(uint8_t *pu8Dst, uint32_t u32Len)
+{
+    for(; u32Len >= 255; u32Len -= 255)
+        *pu8Dst++ = 255;
+
+    *pu8Dst++ = (uint8_t)u32Len;
+    return pu8Dst;
+}
+
+static uint8_t *PutSequence(uint8_t *pu8Dst, const uint8_t *pu8Lit, uint32_t u32LitLen, uint32_t u32Offset, uint32_t u32MatchLen)
+{
+    uint8_t *pu8Token = pu8Dst++;
+    uint32_t u32Len;
+
+    *pu8Token = (uint8_t)((u32LitLen >= 15 ? 15 : u32LitLen) << 4);
+
+    if(u32LitLen >= 15)
+        pu8Dst = PutLen(pu8Dst, u32LitLen - 15);
+
+    memcpy(pu8Dst, pu8Lit, u32LitLen);
+    pu8Dst += u32LitLen;
+
+    if(u32MatchLen == 0)
+        return pu8Dst;   /* Last sequence */
+
+    *pu8Dst++ = (uint8_t)u32Offset;
+    *pu8Dst++ = (uint8_t)(u32Offset >> 8);
+    u32Len = u32MatchLen - MIN_MATCH;
+    *pu8Token |= (uint8_t)(u32Len >= 15 ? 15 : u32Len);
+
+    if(u32Len >= 15)
+        pu8Dst = PutLen(pu8Dst, u32Len - 15);
+
+    return pu8Dst;
+}
+
+/* Longest match at u32Pos searched along the hash chain */
+static uint32_t FindMatch(const uint8_t *pu8Src, uint32_t u32Pos, uint32_t u32Limit, const int32_t *pi32Head,
+                          const int32_t *pi32Prev, uint32_t *pu32Offset)
+{
+    int32_t i32Cand = pi32Head[Hash(pu8Src + u32Pos)];
+    uint32_t u32Best = 0, u32Len, u32Depth;
+
+    for(u32Depth = 0; (i32Cand >= 0) && (u32Depth < CHAIN_DEPTH); u32Depth++, i32Cand = pi32Prev[i32Cand])
+    {
+        if(u32Pos - (uint32_t)i32Cand > MAX_OFFSET)
+            break;
+
+        for(u32Len = 0; (u32Pos + u32Len < u32Limit) && (pu8Src[i32Cand + u32Len] == pu8Src[u32Pos + u32Len]); u32Len++);
+
+        if(u32Len > u32Best)
+        {
+            u32Best = u32Len;
+            *pu32Offset = u32Pos - (uint32_t)i32Cand;
+        }
+    }
+
+    return (u32Best >= MIN_MATCH) ? u32Best : 0;
+}
+
+static void Insert(const uint8_t *pu8Src, uint32_t u32Pos, int32_t *pi32Head, int32_t *pi32Prev)
+{
+    uint32_t u32Hash = Hash(pu8Src + u32Pos);
+
+    pi32Prev[u32Pos] = pi32Head[u32Hash];
+    pi32Head[u32Hash] = (int32_t)u32Pos;
+}
+
+static uint32_t Compress(const uint8_t *pu8Src, uint32_t u32Len, uint8_t *pu8Dst)
+{
+    int32_t *pi32Head = malloc(sizeof(int32_t) << HASH_BITS);
+    int32_t *pi32Prev = malloc(sizeof(int32_t) * (u32Len + 1));
+    uint8_t *pu8Out = pu8Dst;
+    uint32_t u32Pos = 0, u32Anchor = 0, u32MatchLen, u32Offset = 0, u32NextLen, u32NextOffset = 0, i;
+    uint32_t u32Limit = (u32Len > LAST_LITERALS) ? u32Len - LAST_LITERALS : 0;
+
+    memset(pi32Head, 0xFF, sizeof(int32_t) << HASH_BITS);
+
+    while(u32Len >= MF_LIMIT + 1 && u32Pos + MF_LIMIT < u32Len)
+    {
+        u32MatchLen = FindMatch(pu8Src, u32Pos, u32Limit, pi32Head, pi32Prev, &u32Offset);
+
+        if(u32MatchLen == 0)
+        {
+            Insert(pu8Src, u32Pos++, pi32Head, pi32Prev);
+            continue;
+        }
+
+        /* Lazy evaluation: take a literal if the match at next byte is longer */
+        Insert(pu8Src, u32Pos, pi32Head, pi32Prev);
+        u32NextLen = (u32Pos + 1 + MF_LIMIT < u32Len) ?
+                     FindMatch(pu8Src, u32Pos + 1, u32Limit, pi32Head, pi32Prev, &u32NextOffset) : 0;
+
+        if(u32NextLen > u32MatchLen + 1)
+        {
+            u32Pos++;
+            continue;
+        }
+
+        pu8Out = PutSequence(pu8Out, pu8Src + u32Anchor, u32Pos - u32Anchor, u32Offset, u32MatchLen);
+
+        for(i = 1; i < u32MatchLen; i++)
+        {
+            if(u32Pos + i + MIN_MATCH <= u32Len)
+                Insert(pu8Src, u32Pos + i, pi32Head, pi32Prev);
+        }
+
+        u32Pos += u32MatchLen;
+        u32Anchor = u32Pos;
+    }
+
+    pu8Out = PutSequence(pu8Out, pu8Src + u32Anchor, u32Len - u32Anchor, 0, 0);
+
+    free(pi32Head);
+    free(pi32Prev);
+    return (uint32_t)(pu8Out - pu8Dst);
+}
+
+/* Reference decoder with the same end condition as ISP_LzDecode() */
+static int Decompress(const uint8_t *pu8Src, uint32_t u32SrcLen, uint8_t *pu8Dst, uint32_t u32Len)
+{
+    const uint8_t *pu8End = pu8Src + u32SrcLen;
+    uint32_t u32Pos = 0, u32Lit, u32Match, u32Offset, u32Data;
+
+    while(u32Pos < u32Len)
+    {
+        if(pu8Src >= pu8End)
+            return -1;
+
+        u32Data = *pu8Src++;
+        u32Lit = u32Data >> 4;
+        u32Match = (u32Data & 0xF) + MIN_MATCH;
+
+        if(u32Lit == 15)
+        {
+            do
+            {
+                if(pu8Src >= pu8End)
+                    return -1;
+
+                u32Lit += *pu8Src;
+            }
+            while(*pu8Src++ == 255);
+        }
+
+        if((u32Lit > (uint32_t)(pu8End - pu8Src)) || (u32Lit > u32Len - u32Pos))
+            return -1;
+
+        memcpy(pu8Dst + u32Pos, pu8Src, u32Lit);
+        pu8Src += u32Lit;
+        u32Pos += u32Lit;
+
+        if(u32Pos == u32Len)
+            break;
+
+        if(pu8End - pu8Src < 2)
+            return -1;
+
+        u32Offset = pu8Src[0] | (pu8Src[1] << 8);
+        pu8Src += 2;
+
+        if(u32Match == 15 + MIN_MATCH)
+        {
+            do
+            {
+                if(pu8Src >= pu8End)
+                    return -1;
+
+                u32Match += *pu8Src;
+            }
+            while(*pu8Src++ == 255);
+        }
+
+        if((u32Offset == 0) || (u32Offset > u32Pos) || (u32Match > u32Len - u32Pos))
+            return -1;
+
+        for(; u32Match; u32Match--, u32Pos++)
+            pu8Dst[u32Pos] = pu8Dst[u32Pos - u32Offset];
+    }
+
+    return 0;
+}
+
+static uint32_t IspPackets(uint32_t u32Len)
+{
+    return (u32Len <= 48) ? 1 : 1 + (u32Len - 48 + 55) / 56;
+}
+
+int main(int argc, char **argv)
+{
+    FILE *fp;
+    uint8_t *pu8Src, *pu8Dst, *pu8Chk;
+    long lLen;
+    uint32_t u32Len, u32OutLen, u32Sum, i;
+
+    if(argc != 3)
+    {
+        fprintf(stderr, "Usage: %s <image.bin> <image.lz>\n", argv[0]);
+        return 1;
+    }
+
+    if((fp = fopen(argv[1], "rb")) == NULL)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    lLen = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    u32Len = (uint32_t)lLen;
+    pu8Src = malloc(u32Len + 1);
+    pu8Dst = malloc(u32Len + u32Len / 255 + 16);
+    pu8Chk = malloc(u32Len + 1);
+
+    if((lLen < 0) || (fread(pu8Src, 1, u32Len, fp) != u32Len))
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    fclose(fp);
+
+    u32OutLen = Compress(pu8Src, u32Len, pu8Dst);
+
+    if((Decompress(pu8Dst, u32OutLen, pu8Chk, u32Len) < 0) || memcmp(pu8Src, pu8Chk, u32Len))
+    {
+        fprintf(stderr, "Internal error: stream doesn't decode to the image\n");
+        return 1;
+    }
+
+    if(((fp = fopen(argv[2], "wb")) == NULL) || (fwrite(pu8Dst, 1, u32OutLen, fp) != u32OutLen))
+    {
+        perror(argv[2]);
+        return 1;
+    }
+
+    fclose(fp);
+
+    for(u32Sum = 0, i = 0; i < u32Len; i++)
+        u32Sum += pu8Src[i];
+
+    printf("Image size   : %u bytes\n", u32Len);
+    printf("Image sum    : 0x%08X\n", u32Sum);
+    printf("Stream size  : %u bytes (%.1f%%)\n", u32OutLen, u32Len ? 100.0 * u32OutLen / u32Len : 0.0);
+    printf("ISP packets  : %u -> %u (64-byte packets)\n", IspPackets(u32Len), IspPackets(u32OutLen));
+    printf("CAN frames   : %u -> %u\n", (u32Len + 3) / 4, (u32OutLen + 7) / 8 + 1);
+
+    free(pu8Src);
+    free(pu8Dst);
+    free(pu8Chk);
+    return 0;
+}
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
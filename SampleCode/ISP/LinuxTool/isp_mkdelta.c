@@ -0,0 +1,320 @@
+/**************************************************************************//**
+ * @file     isp_mkdelta.c
+ * @version  V1.00
+ * @brief    Linux tool to create a delta image for CMD_UPDATE_APROM_DELTA
+ *
+ * @note
+ *           Build : gcc -O2 -o isp_mkdelta isp_mkdelta.c
+ *           Usage : isp_mkdelta <base.bin> <new.bin> <delta.bin>
+ *
+ *           The output is the data of CMD_UPDATE_APROM_DELTA after the packet number:
+ *           [base size][base CRC][image size][image CRC] followed by the delta records of ISP_DeltaDecode().
+ *           The device builds the new image page by page over the base image, so a record only copies bytes
+ *           which are still in flash at that time. The tool applies the delta to a model of the flash and
+ *           compares the result with the new image before writing it.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define PAGE_SIZE       2048        /* FMC_FLASH_PAGE_SIZE */
+#define FLASH_SIZE      (256 * 1024)
+
+#define DELTA_SAME      0           /* ISP_DELTA_SAME */
+#define DELTA_COPY      1           /* ISP_DELTA_COPY */
+#define DELTA_DATA      2           /* ISP_DELTA_DATA */
+
+#define MIN_SAME        8           /* Shorter runs cost more as a record than as data */
+#define MIN_COPY        16
+#define HASH_LEN        8
+#define HASH_BITS       16
+#define CHAIN_DEPTH     64
+
+static uint8_t *s_pu8Base, *s_pu8New, *s_pu8Keep;
+static uint32_t s_u32BaseLen, s_u32NewLen;
+static uint8_t *s_pu8Out;
+static uint32_t s_u32OutLen;
+
+static uint32_t Crc32(const uint8_t *pu8Buf, uint32_t u32Len)
+{
+    uint32_t u32Crc = 0xFFFFFFFF, i, j;
+
+    /* Padded with 0xFF to word boundary like the flash */
+    for(i = 0; i < ((u32Len + 3) & ~3U); i++)
+    {
+        u32Crc ^= (i < u32Len) ? pu8Buf[i] : 0xFF;
+
+        for(j = 0; j < 8; j++)
+            u32Crc = (u32Crc >> 1) ^ (0xEDB88320 & (0 - (u32Crc & 1)));
+    }
+
+    return ~u32Crc;
+}
+
+static uint8_t *Load(const char *pcName, uint32_t *pu32Len)
+{
+    FILE *fp = fopen(pcName, "rb");
+    uint8_t *pu8Buf;
+    long lLen;
+
+    if(fp == NULL)
+    {
+        perror(pcName);
+        exit(1);
+    }
+
+    fseek(fp, 0, SEEK_END);
+    lLen = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    if((lLen <= 0) || (lLen > FLASH_SIZE))
+    {
+        fprintf(stderr, "%s: size must be 1 ~ %d bytes\n", pcName, FLASH_SIZE);
+        exit(1);
+    }
+
+    pu8Buf = malloc(FLASH_SIZE);
+    memset(pu8Buf, 0xFF, FLASH_SIZE);
+
+    if(fread(pu8Buf, 1, (size_t)lLen, fp) != (size_t)lLen)
+    {
+        perror(pcName);
+        exit(1);
+    }
+
+    fclose(fp);
+    *pu32Len = (uint32_t)lLen;
+    return pu8Buf;
+}
+
+static void Put32(uint32_t u32Data)
+{
+    int i;
+
+    for(i = 0; i < 4; i++, u32Data >>= 8)
+        s_pu8Out[s_u32OutLen++] = (uint8_t)u32Data;
+}
+
+static void PutRecord(uint32_t u32Type, uint32_t u32Len, uint32_t u32Src, const uint8_t *pu8Data)
+{
+    s_pu8Out[s_u32OutLen++] = (uint8_t)u32Type;
+    Put32(u32Len);
+
+    if(u32Type == DELTA_COPY)
+        Put32(u32Src);
+
+    if(u32Type == DELTA_DATA)
+    {
+        memcpy(s_pu8Out + s_u32OutLen, pu8Data, u32Len);
+        s_u32OutLen += u32Len;
+    }
+}
+
+/* Base byte at u32Src is still in flash when the byte at u32Dst is built */
+static int IsReadable(uint32_t u32Src, uint32_t u32Dst)
+{
+    if(u32Src >= s_u32BaseLen)
+        return 0;
+
+    return ((u32Src / PAGE_SIZE) >= (u32Dst / PAGE_SIZE)) || s_pu8Keep[u32Src];
+}
+
+static uint32_t Hash(const uint8_t *pu8Buf)
+{
+    uint32_t u32Hash = 0, i;
+
+    for(i = 0; i < HASH_LEN; i++)
+        u32Hash = u32Hash * 31 + pu8Buf[i];
+
+    return u32Hash & ((1 << HASH_BITS) - 1);
+}
+
+/* Longest readable base match for the new image at u32Pos */
+static uint32_t FindCopy(uint32_t u32Pos, const int32_t *pi32Head, const int32_t *pi32Next, uint32_t *pu32Src)
+{
+    int32_t i32Cand;
+    uint32_t u32Best = 0, u32Len, u32Depth;
+
+    if(u32Pos + HASH_LEN > s_u32NewLen)
+        return 0;
+
+    i32Cand = pi32Head[Hash(s_pu8New + u32Pos)];
+
+    for(u32Depth = 0; (i32Cand >= 0) && (u32Depth < CHAIN_DEPTH); u32Depth++, i32Cand = pi32Next[i32Cand])
+    {
+        for(u32Len = 0; (u32Pos + u32Len < s_u32NewLen) && ((uint32_t)i32Cand + u32Len < s_u32BaseLen); u32Len++)
+        {
+            if((s_pu8Base[i32Cand + u32Len] != s_pu8New[u32Pos + u32Len]) || !IsReadable(i32Cand + u32Len, u32Pos + u32Len))
+                break;
+        }
+
+        if(u32Len > u32Best)
+        {
+            u32Best = u32Len;
+            *pu32Src = (uint32_t)i32Cand;
+        }
+    }
+
+    return (u32Best >= MIN_COPY) ? u32Best : 0;
+}
+
+static uint32_t SameRun(uint32_t u32Pos)
+{
+    uint32_t u32Len;
+
+    for(u32Len = 0; (u32Pos + u32Len < s_u32NewLen) && (u32Pos + u32Len < s_u32BaseLen); u32Len++)
+    {
+        if(s_pu8Base[u32Pos + u32Len] != s_pu8New[u32Pos + u32Len])
+            break;
+    }
+
+    return u32Len;
+}
+
+/* Apply the delta like ISP_DeltaDecode() does on a model of the flash */
+static int Verify(void)
+{
+    uint8_t *pu8Flash = malloc(FLASH_SIZE), au8Page[PAGE_SIZE];
+    uint32_t u32In = 16, u32Done = 0, u32Pos = 0, u32Type, u32Len, u32Src = 0, u32Data, i;
+    int iRet;
+
+    memcpy(pu8Flash, s_pu8Base, FLASH_SIZE);
+
+    while(u32Done < s_u32NewLen)
+    {
+        u32Type = s_pu8Out[u32In];
+        memcpy(&u32Len, s_pu8Out + u32In + 1, 4);
+        u32In += 5;
+
+        if(u32Type == DELTA_SAME)
+        {
+            u32Src = u32Done;
+        }
+        else if(u32Type == DELTA_COPY)
+        {
+            memcpy(&u32Src, s_pu8Out + u32In, 4);
+            u32In += 4;
+        }
+
+        for(i = 0; i < u32Len; i++, u32Done++)
+        {
+            u32Data = (u32Type == DELTA_DATA) ? s_pu8Out[u32In++] : pu8Flash[u32Src++];
+            au8Page[u32Pos++] = (uint8_t)u32Data;
+
+            if((u32Pos == PAGE_SIZE) || (u32Done + 1 == s_u32NewLen))
+            {
+                memcpy(pu8Flash + (u32Done / PAGE_SIZE) * PAGE_SIZE, au8Page, u32Pos);
+                u32Pos = 0;
+            }
+        }
+    }
+
+    iRet = (u32In == s_u32OutLen) && (memcmp(pu8Flash, s_pu8New, s_u32NewLen) == 0);
+    free(pu8Flash);
+    return iRet;
+}
+
+int main(int argc, char **argv)
+{
+    int32_t *pi32Head, *pi32Next;
+    uint32_t u32Pos, u32Lit, u32Len, u32Src = 0, u32Same, u32Copy, u32Data, u32Pages, i;
+    FILE *fp;
+
+    if(argc != 4)
+    {
+        fprintf(stderr, "Usage: %s <base.bin> <new.bin> <delta.bin>\n", argv[0]);
+        return 1;
+    }
+
+    s_pu8Base = Load(argv[1], &s_u32BaseLen);
+    s_pu8New = Load(argv[2], &s_u32NewLen);
+    s_pu8Out = malloc(FLASH_SIZE * 2);
+    s_pu8Keep = malloc(FLASH_SIZE);
+
+    /* Bytes which stay in flash after their page is built */
+    for(i = 0; i < FLASH_SIZE; i++)
+        s_pu8Keep[i] = (i < s_u32NewLen) && (i < s_u32BaseLen) && (s_pu8Base[i] == s_pu8New[i]);
+
+    pi32Head = malloc(sizeof(int32_t) << HASH_BITS);
+    pi32Next = malloc(sizeof(int32_t) * FLASH_SIZE);
+    memset(pi32Head, 0xFF, sizeof(int32_t) << HASH_BITS);
+
+    for(i = s_u32BaseLen >= HASH_LEN ? s_u32BaseLen - HASH_LEN + 1 : 0; i-- > 0;)
+    {
+        u32Data = Hash(s_pu8Base + i);
+        pi32Next[i] = pi32Head[u32Data];
+        pi32Head[u32Data] = (int32_t)i;
+    }
+
+    Put32(s_u32BaseLen);
+    Put32(Crc32(s_pu8Base, s_u32BaseLen));
+    Put32(s_u32NewLen);
+    Put32(Crc32(s_pu8New, s_u32NewLen));
+
+    for(u32Pos = 0, u32Lit = 0; u32Pos < s_u32NewLen;)
+    {
+        u32Same = SameRun(u32Pos);
+        u32Copy = (u32Same >= MIN_SAME) ? 0 : FindCopy(u32Pos, pi32Head, pi32Next, &u32Src);
+
+        if((u32Same < MIN_SAME) && (u32Copy == 0))
+        {
+            u32Lit++;
+            u32Pos++;
+            continue;
+        }
+
+        if(u32Lit)
+            PutRecord(DELTA_DATA, u32Lit, 0, s_pu8New + u32Pos - u32Lit);
+
+        u32Lit = 0;
+
+        if(u32Same >= MIN_SAME)
+        {
+            PutRecord(DELTA_SAME, u32Same, 0, NULL);
+            u32Pos += u32Same;
+        }
+        else
+        {
+            PutRecord(DELTA_COPY, u32Copy, u32Src, NULL);
+            u32Pos += u32Copy;
+        }
+    }
+
+    if(u32Lit)
+        PutRecord(DELTA_DATA, u32Lit, 0, s_pu8New + u32Pos - u32Lit);
+
+    if(!Verify())
+    {
+        fprintf(stderr, "Internal error: delta doesn't build the new image\n");
+        return 1;
+    }
+
+    if(((fp = fopen(argv[3], "wb")) == NULL) || (fwrite(s_pu8Out, 1, s_u32OutLen, fp) != s_u32OutLen))
+    {
+        perror(argv[3]);
+        return 1;
+    }
+
+    fclose(fp);
+
+    for(u32Pages = 0, i = 0; i < s_u32NewLen; i += PAGE_SIZE)
+    {
+        u32Len = (s_u32NewLen - i < PAGE_SIZE) ? s_u32NewLen - i : PAGE_SIZE;
+
+        if((i + u32Len > s_u32BaseLen) || memcmp(s_pu8Base + i, s_pu8New + i, u32Len))
+            u32Pages++;
+    }
+
+    printf("Base image   : %u bytes, CRC 0x%08X\n", s_u32BaseLen, Crc32(s_pu8Base, s_u32BaseLen));
+    printf("New image    : %u bytes, CRC 0x%08X\n", s_u32NewLen, Crc32(s_pu8New, s_u32NewLen));
+    printf("Delta size   : %u bytes (%.1f%%)\n", s_u32OutLen, 100.0 * s_u32OutLen / s_u32NewLen);
+    printf("Pages changed: %u of %u\n", u32Pages, (s_u32NewLen + PAGE_SIZE - 1) / PAGE_SIZE);
+
+    return 0;
+}
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
@@ -0,0 +1,442 @@
+/**************************************************************************//**
+ * @file     isp_uart.c
+ * @version  V1.00
+ * @brief    Linux tool to update APROM through the ISP_UART loader
+ *
+ * @note
+ *           Build : gcc -O2 -o isp_uart isp_uart.c
+ *           Usage : isp_uart [-b baud rate] [-c] [-s packet size] [-r] <tty> <aprom.bin>
+ *             -b  115200, 230400, 460800 or 921600. Must match UART_BAUD_RATE of the loader. Default 115200.
+ *             -c  Check packets with CRC-32 (ISP_OPT_CRC32). Needs firmware version 0x35 or later.
+ *             -s  Packet size for CMD_NEGOTIATE. 64 keeps the legacy protocol. Default 256.
+ *             -r  Run APROM after the update.
+ *
+ *           The tool connects, negotiates the packet size and the packet check, programs the image with
+ *           CMD_UPDATE_APROM and compares the CRC-32 of CMD_GET_CRC32 with the image. With -c it also prints
+ *           the CPU cycles which the loader reports for the packet check and for the whole packet.
+ *           Packets are sent stop-and-wait. A packet which fails the check is sent again after
+ *           CMD_RESEND_PACKET.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/select.h>
+
+#define FLASH_SIZE          (256 * 1024)
+#define LEGACY_PKT_SIZE     64          /* ISP_LEGACY_PKT_SIZE */
+#define MAX_PKT_SIZE        512         /* ISP_MAX_PKT_SIZE */
+#define TIMEOUT_MS          1000
+#define RETRY_NUM           3
+
+#define CMD_UPDATE_APROM    0x000000A0
+#define CMD_GET_FWVER       0x000000A6
+#define CMD_RUN_APROM       0x000000AB
+#define CMD_CONNECT         0x000000AE
+#define CMD_NEGOTIATE       0x000000D0
+#define CMD_GET_CRC32       0x000000D3
+#define CMD_RESEND_PACKET   0x000000FF
+
+#define OPT_CRC32           0x00000001  /* ISP_OPT_CRC32 */
+
+static int s_iFd;
+static uint32_t s_u32PktSize = LEGACY_PKT_SIZE;
+static uint32_t s_u32Options;
+static uint32_t s_u32PackNo;
+static uint8_t s_au8Pkt[MAX_PKT_SIZE];
+static uint8_t s_au8Res[LEGACY_PKT_SIZE];
+static uint64_t s_u64CrcCycles, s_u64PktCycles;
+static uint32_t s_u32CycleCount;
+
+static uint32_t Crc32(const uint8_t *pu8Buf, uint32_t u32Len)
+{
+    uint32_t u32Crc = 0xFFFFFFFF, i, j;
+
+    /* Padded with 0xFF to word boundary like the flash */
+    for(i = 0; i < ((u32Len + 3) & ~3U); i++)
+    {
+        u32Crc ^= (i < u32Len) ? pu8Buf[i] : 0xFF;
+
+        for(j = 0; j < 8; j++)
+            u32Crc = (u32Crc >> 1) ^ (0xEDB88320 & (0 - (u32Crc & 1)));
+    }
+
+    return ~u32Crc;
+}
+
+static uint32_t Sum16(const uint8_t *pu8Buf, uint32_t u32Len)
+{
+    uint32_t u32Sum = 0, i;
+
+    for(i = 0; i < u32Len; i++)
+        u32Sum += pu8Buf[i];
+
+    return u32Sum & 0xFFFF;
+}
+
+static void Put32(uint8_t *pu8Buf, uint32_t u32Data)
+{
+    int i;
+
+    for(i = 0; i < 4; i++, u32Data >>= 8)
+        pu8Buf[i] = (uint8_t)u32Data;
+}
+
+static uint32_t Get32(const uint8_t *pu8Buf)
+{
+    return pu8Buf[0] | (pu8Buf[1] << 8) | (pu8Buf[2] << 16) | ((uint32_t)pu8Buf[3] << 24);
+}
+
+static int OpenTty(const char *pcName, speed_t tSpeed)
+{
+    struct termios sTio;
+    int iFd = open(pcName, O_RDWR | O_NOCTTY);
+
+    if(iFd < 0)
+    {
+        perror(pcName);
+        exit(1);
+    }
+
+    tcgetattr(iFd, &sTio);
+    cfmakeraw(&sTio);
+    cfsetispeed(&sTio, tSpeed);
+    cfsetospeed(&sTio, tSpeed);
+    sTio.c_cflag |= (CLOCAL | CREAD);
+    sTio.c_cflag &= ~(CSTOPB | CRTSCTS);
+    tcsetattr(iFd, TCSANOW, &sTio);
+    tcflush(iFd, TCIOFLUSH);
+
+    return iFd;
+}
+
+/* Read a response. Returns 0 on success, -1 on time-out. */
+static int ReadResponse(void)
+{
+    struct timeval sTv;
+    fd_set sSet;
+    uint32_t u32Len = 0;
+    ssize_t n;
+
+    while(u32Len < LEGACY_PKT_SIZE)
+    {
+        FD_ZERO(&sSet);
+        FD_SET(s_iFd, &sSet);
+        sTv.tv_sec = TIMEOUT_MS / 1000;
+        sTv.tv_usec = (TIMEOUT_MS % 1000) * 1000;
+
+        if(select(s_iFd + 1, &sSet, NULL, NULL, &sTv) <= 0)
+            return -1;
+
+        if((n = read(s_iFd, s_au8Res + u32Len, LEGACY_PKT_SIZE - u32Len)) <= 0)
+            return -1;
+
+        u32Len += (uint32_t)n;
+    }
+
+    return 0;
+}
+
+/*
+ * Send s_au8Pkt and check the response.
+ * Returns 0 on success, -1 if no response arrives, -2 if the loader parsed a packet which differs from s_au8Pkt.
+ */
+static int Transfer(uint32_t u32Len)
+{
+    uint32_t u32Check;
+
+    Put32(s_au8Pkt + 4, s_u32PackNo);
+
+    if((write(s_iFd, s_au8Pkt, u32Len) != (ssize_t)u32Len) || (ReadResponse() < 0) ||
+            (Get32(s_au8Res + 4) != s_u32PackNo + 1))
+        return -1;
+
+    s_u32PackNo += 2;
+
+    /* The check is in the mode which the response is built in */
+    if(s_u32Options & OPT_CRC32)
+        u32Check = Crc32(s_au8Pkt, u32Len);
+    else
+        u32Check = Sum16(s_au8Pkt, u32Len);
+
+    if(Get32(s_au8Res) != u32Check)
+        return -2;
+
+    if(s_u32Options & OPT_CRC32)
+    {
+        s_u64CrcCycles += Get32(s_au8Res + 56);
+        s_u64PktCycles += Get32(s_au8Res + 60);
+        s_u32CycleCount++;
+    }
+
+    return 0;
+}
+
+/* Send a command packet. Data of u32Len bytes follow the packet number. */
+static int Command(uint32_t u32Cmd, const uint8_t *pu8Data, uint32_t u32Len)
+{
+    memset(s_au8Pkt, 0, s_u32PktSize);
+    Put32(s_au8Pkt, u32Cmd);
+
+    if(u32Len)
+        memcpy(s_au8Pkt + 8, pu8Data, u32Len);
+
+    return Transfer(s_u32PktSize);
+}
+
+static void Connect(void)
+{
+    printf("Waiting for the loader ...\n");
+
+    /* The loader drops packets before CMD_CONNECT and resyncs when the line is idle */
+    for(;;)
+    {
+        s_u32PackNo = 1;
+        s_u32PktSize = LEGACY_PKT_SIZE;
+        s_u32Options = 0;
+        tcflush(s_iFd, TCIOFLUSH);
+
+        if(Command(CMD_CONNECT, NULL, 0) == 0)
+            break;
+    }
+}
+
+static void Negotiate(uint32_t u32Size, uint32_t u32Options)
+{
+    uint8_t au8Data[12];
+    uint32_t u32FwVer;
+
+    if(Command(CMD_GET_FWVER, NULL, 0) < 0)
+    {
+        fprintf(stderr, "CMD_GET_FWVER failed\n");
+        exit(1);
+    }
+
+    u32FwVer = s_au8Res[8];
+    printf("Firmware version 0x%02X\n", u32FwVer);
+
+    if(u32FwVer < 0x35)
+        u32Options = 0;
+
+    if((u32FwVer < 0x34) || ((u32Size == LEGACY_PKT_SIZE) && (u32Options == 0)))
+        return;
+
+    Put32(au8Data, u32Size);
+    Put32(au8Data + 4, 1);
+    Put32(au8Data + 8, u32Options);
+
+    /* The response of CMD_NEGOTIATE is checked in the new mode. Try both. */
+    memset(s_au8Pkt, 0, s_u32PktSize);
+    Put32(s_au8Pkt, CMD_NEGOTIATE);
+    memcpy(s_au8Pkt + 8, au8Data, sizeof(au8Data));
+    s_u32Options = u32Options;
+
+    switch(Transfer(s_u32PktSize))
+    {
+        case 0:
+            break;
+
+        case -2:
+            /* Options refused by a transport of legacy packets only */
+            if(Get32(s_au8Res) == Sum16(s_au8Pkt, s_u32PktSize))
+                break;
+
+        /* fall through */
+        default:
+            fprintf(stderr, "CMD_NEGOTIATE failed\n");
+            exit(1);
+    }
+
+    if((Get32(s_au8Res + 8) < LEGACY_PKT_SIZE) || (Get32(s_au8Res + 8) > u32Size))
+    {
+        fprintf(stderr, "CMD_NEGOTIATE not supported\n");
+        exit(1);
+    }
+
+    s_u32PktSize = Get32(s_au8Res + 8);
+    s_u32Options = Get32(s_au8Res + 16) & u32Options;
+    printf("Packet size %u, packet check %s\n", s_u32PktSize, (s_u32Options & OPT_CRC32) ? "CRC-32" : "byte sum");
+}
+
+static uint8_t *Load(const char *pcName, uint32_t *pu32Len)
+{
+    FILE *fp = fopen(pcName, "rb");
+    uint8_t *pu8Buf;
+    long lLen;
+
+    if(fp == NULL)
+    {
+        perror(pcName);
+        exit(1);
+    }
+
+    fseek(fp, 0, SEEK_END);
+    lLen = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    if((lLen <= 0) || (lLen > FLASH_SIZE))
+    {
+        fprintf(stderr, "%s: size must be 1 ~ %d bytes\n", pcName, FLASH_SIZE);
+        exit(1);
+    }
+
+    pu8Buf = malloc(FLASH_SIZE);
+    memset(pu8Buf, 0xFF, FLASH_SIZE);
+
+    if(fread(pu8Buf, 1, (size_t)lLen, fp) != (size_t)lLen)
+    {
+        perror(pcName);
+        exit(1);
+    }
+
+    fclose(fp);
+    *pu32Len = (uint32_t)lLen;
+    return pu8Buf;
+}
+
+static int UpdateAprom(const uint8_t *pu8Image, uint32_t u32ImageLen)
+{
+    uint32_t u32Pos, u32Len, u32Hdr, u32Retry;
+    int iRet;
+
+    for(u32Pos = 0; u32Pos < u32ImageLen; u32Pos += u32Len)
+    {
+        /* First packet is [cmd][packno][start address][size], the next ones [0][packno] */
+        u32Hdr = (u32Pos == 0) ? 16 : 8;
+        u32Len = s_u32PktSize - u32Hdr;
+
+        if(u32Len > u32ImageLen - u32Pos)
+            u32Len = u32ImageLen - u32Pos;
+
+        memset(s_au8Pkt, 0xFF, s_u32PktSize);
+        Put32(s_au8Pkt, (u32Pos == 0) ? CMD_UPDATE_APROM : 0);
+
+        if(u32Pos == 0)
+        {
+            Put32(s_au8Pkt + 8, 0);
+            Put32(s_au8Pkt + 12, u32ImageLen);
+        }
+
+        memcpy(s_au8Pkt + u32Hdr, pu8Image + u32Pos, u32Len);
+
+        for(u32Retry = 0; (iRet = Transfer(s_u32PktSize)) < 0; u32Retry++)
+        {
+            uint8_t au8Pkt[MAX_PKT_SIZE];
+
+            /* Without a response it is unknown whether the loader programmed the packet */
+            if((iRet == -1) || (u32Retry == RETRY_NUM))
+                return -1;
+
+            /* Let the loader restore the flash of the packet, then send the packet again */
+            memcpy(au8Pkt, s_au8Pkt, s_u32PktSize);
+
+            if(Command(CMD_RESEND_PACKET, NULL, 0) < 0)
+                return -1;
+
+            memcpy(s_au8Pkt, au8Pkt, s_u32PktSize);
+        }
+
+        printf("\r%u / %u bytes", u32Pos + u32Len, u32ImageLen);
+        fflush(stdout);
+    }
+
+    printf("\n");
+    return 0;
+}
+
+/* Returns 0 for a baud rate the tool doesn't support */
+static speed_t Speed(uint32_t u32Baud)
+{
+    switch(u32Baud)
+    {
+        case 115200:
+            return B115200;
+        case 230400:
+            return B230400;
+        case 460800:
+            return B460800;
+        case 921600:
+            return B921600;
+        default:
+            return 0;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint8_t *pu8Image, au8Data[8];
+    uint32_t u32ImageLen, u32Size = 256, u32Options = 0, u32Run = 0, u32Crc;
+    speed_t tSpeed = B115200;
+    int iOpt;
+
+    while((iOpt = getopt(argc, argv, "b:cs:r")) != -1)
+    {
+        if(iOpt == 'b')
+            tSpeed = Speed((uint32_t)strtoul(optarg, NULL, 0));
+        else if(iOpt == 'c')
+            u32Options |= OPT_CRC32;
+        else if(iOpt == 's')
+            u32Size = (uint32_t)strtoul(optarg, NULL, 0);
+        else if(iOpt == 'r')
+            u32Run = 1;
+        else
+            optind = argc;
+    }
+
+    if((argc - optind != 2) || (u32Size < LEGACY_PKT_SIZE) || (u32Size > MAX_PKT_SIZE) || (tSpeed == 0))
+    {
+        fprintf(stderr, "Usage: %s [-b 115200|230400|460800|921600] [-c] [-s packet size (%d ~ %d)] [-r] <tty> <aprom.bin>\n", argv[0],
+                LEGACY_PKT_SIZE, MAX_PKT_SIZE);
+        return 1;
+    }
+
+    pu8Image = Load(argv[optind + 1], &u32ImageLen);
+    s_iFd = OpenTty(argv[optind], tSpeed);
+
+    Connect();
+    Negotiate(u32Size, u32Options);
+
+    if(UpdateAprom(pu8Image, u32ImageLen) < 0)
+    {
+        fprintf(stderr, "\nCMD_UPDATE_APROM failed\n");
+        return 1;
+    }
+
+    Put32(au8Data, 0);
+    Put32(au8Data + 4, (u32ImageLen + 3) & ~3U);
+    u32Crc = Crc32(pu8Image, u32ImageLen);
+
+    if((Command(CMD_GET_CRC32, au8Data, sizeof(au8Data)) < 0) || (Get32(s_au8Res + 8) != u32Crc))
+    {
+        fprintf(stderr, "Image CRC mismatch: image 0x%08X, APROM 0x%08X\n", u32Crc, Get32(s_au8Res + 8));
+        return 1;
+    }
+
+    printf("Image CRC 0x%08X verified\n", u32Crc);
+
+    if(s_u32CycleCount)
+        printf("Cycles per packet: CRC %llu, total %llu\n", (unsigned long long)(s_u64CrcCycles / s_u32CycleCount),
+               (unsigned long long)(s_u64PktCycles / s_u32CycleCount));
+
+    if(u32Run)
+    {
+        /* The loader resets without response */
+        memset(s_au8Pkt, 0, s_u32PktSize);
+        Put32(s_au8Pkt, CMD_RUN_APROM);
+        Put32(s_au8Pkt + 4, s_u32PackNo);
+
+        if(write(s_iFd, s_au8Pkt, s_u32PktSize) != (ssize_t)s_u32PktSize)
+            perror(argv[optind]);
+    }
+
+    close(s_iFd);
+    return 0;
+}
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
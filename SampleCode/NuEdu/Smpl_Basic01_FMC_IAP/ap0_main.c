@@ -228,9 +228,7 @@ static int  load_image_to_flash(uint32_t image_base, uint32_t image_limit, uint3
             return -1;
         }
 
-        for (j = 0; j < FMC_FLASH_PAGE_SIZE; j += 4) {
-            FMC_Write(flash_addr + i + j, pu32Loader[(i + j) / 4]);
-        }
+        FMC_WriteMultiple(flash_addr + i, &pu32Loader[i / 4], FMC_FLASH_PAGE_SIZE);
     }
     printf("OK.\n");
 
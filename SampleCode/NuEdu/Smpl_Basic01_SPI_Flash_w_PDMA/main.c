@@ -6,6 +6,7 @@
  *           NuEdu-SDK-M451 SPI Flash with PDMA sample code.
 						 Use PDMA Channel 11 to transfer Data from Memmory to SPI Flash
 						 and PDMA Channel 10 to receive Data from SPI Flash to Memmory. 
+ *           Then stream a bulk range across page boundaries and print the write and read speed in MB/s.
  *           
  * @note
  * @copyright SPDX-License-Identifier: Apache-2.0
@@ -21,8 +22,38 @@
 #define	TEST_LENGTH					255	/* length */
 #define SPI_TX_DMA_CH 			1
 #define SPI_RX_DMA_CH 			2
+#define SPI_BULK_CLOCK      24000000    /* SPI clock of the bulk transfers */
+#define BULK_ADDRESS        0x10080     /* Not aligned to pages */
+#define BULK_LENGTH         0x20000
+#define BULK_BUF_SIZE       4096
 unsigned char	SrcArray[256];
 unsigned char DestArray[256];
+unsigned char BulkArray[BULK_BUF_SIZE];
+unsigned int g_u32FillCount;
+
+/* Pattern of the bulk test at byte offset u32Offset */
+#define BULK_PATTERN(u32Offset)     ((unsigned char)(((u32Offset) * 7) ^ ((u32Offset) >> 8)))
+
+/* Produce the next bytes of the bulk test. It runs while the flash programs the previous page. */
+void Bulk_Fill(unsigned char *pu8Buf, unsigned int u32Length)
+{
+    unsigned int i;
+
+    for(i = 0; i < u32Length; i++)
+    {
+        pu8Buf[i] = BULK_PATTERN(g_u32FillCount);
+        g_u32FillCount++;
+    }
+}
+
+/* Print u32Bytes in u32Cycles of the CPU clock in MB/s */
+void Print_Speed(unsigned int u32Bytes, unsigned int u32Cycles)
+{
+    unsigned int u32KBps;
+
+    u32KBps = (unsigned int)((uint64_t)u32Bytes * (SystemCoreClock / 1000) / u32Cycles);
+    printf("%d.%03d MB/s", u32KBps / 1000, u32KBps % 1000);
+}
 
 void UART0_Init(void)
 {
@@ -60,6 +91,7 @@ int32_t main(void)
     unsigned int u32ProgramFlashAddress = 0;
     unsigned int u32VerifyFlashAddress = 0;
     unsigned int MidDid;
+    unsigned int u32Clock, u32Start, u32Cycles, u32Offset;
 
     /* Initial system */
     SYS_Init();
@@ -140,6 +172,48 @@ int32_t main(void)
         printf("Done!");
     }
 
+    /*=== Bulk test ===*/
+    /* The PDMA channels stay configured from here on, and the SPI clock goes up for bulk transfers */
+    u32Clock = SpiFlash_w_PDMA_Init(SPI_BULK_CLOCK);
+    printf("\n\nBulk test of %d KB at 0x%X, SPI clock %d Hz", BULK_LENGTH / 1024, BULK_ADDRESS, u32Clock);
+
+    /* Enable the cycle counter for the measurements */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    printf("\nFlash Programming... ");
+    g_u32FillCount = 0;
+    u32Start = DWT->CYCCNT;
+    SpiFlash_w_PDMA_WriteStream(0, BULK_ADDRESS, BULK_LENGTH, Bulk_Fill);
+    u32Cycles = DWT->CYCCNT - u32Start;
+    Print_Speed(BULK_LENGTH, u32Cycles);
+
+    /* Time one read of the whole range, then verify it in buffers */
+    printf("\nFlash Reading... ");
+    u32Start = DWT->CYCCNT;
+    for(u32Offset = 0; u32Offset < BULK_LENGTH; u32Offset += BULK_BUF_SIZE)
+        SpiFlash_w_PDMA_Read((uint32_t)BulkArray, BULK_ADDRESS + u32Offset, BULK_BUF_SIZE);
+    u32Cycles = DWT->CYCCNT - u32Start;
+    Print_Speed(BULK_LENGTH, u32Cycles);
+    printf(", bus limit %d.%03d MB/s", u32Clock / 8000000, (u32Clock / 8000) % 1000);
+
+    printf("\nFlash Verifying... ");
+    for(u32Offset = 0; u32Offset < BULK_LENGTH; u32Offset += BULK_BUF_SIZE)
+    {
+        SpiFlash_w_PDMA_Read((uint32_t)BulkArray, BULK_ADDRESS + u32Offset, BULK_BUF_SIZE);
+
+        for(u32ByteCount = 0; u32ByteCount < BULK_BUF_SIZE; u32ByteCount++)
+        {
+            if(BulkArray[u32ByteCount] != BULK_PATTERN(u32Offset + u32ByteCount))
+            {
+                /* Error */
+                printf("SPI Flash R/W Fail at 0x%X!", BULK_ADDRESS + u32Offset + u32ByteCount);
+                while(1);
+            }
+        }
+    }
+    printf("Done!");
+
     printf("\n\nSPI Flash Test Ok!");
     printf("\n\n");
 
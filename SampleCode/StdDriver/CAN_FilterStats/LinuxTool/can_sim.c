@@ -0,0 +1,1071 @@
+/**************************************************************************//**
+ * @file     can_sim.c
+ * @version  V1.00
+ * @brief    Linux test of the CAN filter planner and bus statistics against a simulated CAN bus
+ *
+ * @note
+ *           Build : gcc -O2 -Wall -I../../../../Library/CanBusLib/inc -o can_sim can_sim.c
+ *                       ../../../../Library/CanBusLib/src/can_filter.c ../../../../Library/CanBusLib/src/can_stats.c
+ *           Usage : can_sim [error frames per 1000 frames]
+ *
+ *           The plans of random identifier ranges and masks are checked identifier by identifier against
+ *           a model of the C_CAN acceptance filter, exhaustively for standard identifiers and by samples and
+ *           inclusion-exclusion for extended ones. Plans of few blocks are compared with the best grouping of
+ *           the blocks, found by trying all of them. The bus model encodes every frame bit by bit with its CRC
+ *           and stuff bits, arbitrates the frames of several nodes, and injects errors which make the frame
+ *           sent again. The bus load, error rate, receive counters and transmit latency counted by the
+ *           statistics of one node are compared with those of the model. Time is counted in bit times.
+ *           The exit code is 0 if all tests pass.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "can_filter.h"
+#include "can_stats.h"
+
+#define BIT_RATE        500000
+#define SIM_BITS        (BIT_RATE * 20)     /* 20 s of bus time */
+#define WIN_BITS        (BIT_RATE / 10)     /* Statistics window of 100 ms */
+#define PEND_MAX        4                   /* Frames of a message waiting for the bus */
+#define OBJ_MAX         32
+#define ID_STATS_SIZE   64
+
+typedef struct
+{
+    uint8_t au8Bit[192];
+    uint32_t u32Len;
+} BITS_T;
+
+typedef struct
+{
+    uint32_t u32IdType;
+    uint32_t u32Id;
+    uint32_t u32Remote;
+    uint32_t u32DLC;
+    uint8_t au8Data[8];
+} FRAME_T;
+
+/* Message object as CAN_SetRxMsgObjAndMsk() writes it, with the 29-bit ARB and MASK fields */
+typedef struct
+{
+    uint32_t u32Arb;
+    uint32_t u32Mask;
+    uint32_t u32Xtd;
+} OBJ_T;
+
+typedef struct
+{
+    uint32_t u32Node;                       /* 0 is the node under test */
+    uint32_t u32IdType;
+    uint32_t u32Id;
+    uint32_t u32DLC;
+    uint32_t u32Period;                     /* Bit times */
+} BUS_MSG_T;
+
+typedef struct
+{
+    uint32_t u32Node;
+    uint32_t u32IdType;
+    uint32_t u32Id;
+    uint32_t u32DLC;
+    uint32_t u32Period;
+
+    uint64_t u64Key;                        /* Private. Arbitration field, the lowest wins */
+    uint32_t u32Next;                       /* Private. Next release */
+    uint32_t au32Pend[PEND_MAX];            /* Private. Release times of the waiting frames */
+    uint32_t u32PendNum;
+    uint32_t u32Seq;
+
+    uint32_t u32Overflow;                   /* Results of the model */
+    uint32_t u32Retries;
+    uint32_t u32TxCnt;
+    uint32_t u32LatMin;
+    uint32_t u32LatMax;
+    uint64_t u64LatSum;
+    uint32_t u32RxCnt;
+    uint32_t u32RxLast;
+    uint32_t u32RxGapMax;
+} MSG_T;
+
+typedef struct
+{
+    const char *pcName;
+    uint32_t u32Filters;
+    uint32_t u32ErrPerMille;
+    uint32_t u32LoadTol;                    /* Allowed bus load error in 0.1 % */
+} SCENARIO_T;
+
+typedef struct
+{
+    uint32_t u32IdType;
+    uint32_t u32First;
+    uint32_t u32Last;
+    uint32_t u32Id;
+    uint32_t u32Mask;                       /* 0 for a range */
+} WANT_T;
+
+static const BUS_MSG_T s_asBusMsg[] =
+{
+    {1, CAN_STATS_STD_ID, 0x100,      8, 1000},
+    {1, CAN_STATS_STD_ID, 0x17F,      2, 2500},
+    {2, CAN_STATS_STD_ID, 0x20A,      8, 1250},
+    {2, CAN_STATS_STD_ID, 0x21C,      8, 5000},
+    {2, CAN_STATS_STD_ID, 0x345,      1, 10000},
+    {3, CAN_STATS_STD_ID, 0x346,      8, 2000},
+    {3, CAN_STATS_STD_ID, 0x7F0,      8, 5000},
+    {3, CAN_STATS_EXT_ID, 0x18FEF012, 8, 2500},
+    {4, CAN_STATS_EXT_ID, 0x18FEF112, 8, 1000},
+    {4, CAN_STATS_EXT_ID, 0x0CF00400, 8, 2000},
+    {0, CAN_STATS_STD_ID, 0x050,      8, 5000},
+    {0, CAN_STATS_STD_ID, 0x300,      4, 2500},
+    {0, CAN_STATS_EXT_ID, 0x18FF1234, 8, 10000},
+};
+
+#define BUS_MSG_NUM     (sizeof(s_asBusMsg) / sizeof(s_asBusMsg[0]))
+
+/* Wanted identifiers of the node under test, as in the sample */
+static const WANT_T s_asNodeWant[] =
+{
+    {CAN_FILTER_STD_ID, 0x100,      0x17F, 0, 0},
+    {CAN_FILTER_STD_ID, 0x200,      0x213, 0, 0},
+    {CAN_FILTER_STD_ID, 0x345,      0x345, 0, 0},
+    {CAN_FILTER_STD_ID, 0x347,      0x347, 0, 0},
+    {CAN_FILTER_EXT_ID, 0x18FEF000, 0x18FEF0FF, 0, 0},
+};
+
+static uint32_t s_u32Fail;
+static CAN_FILTER_PLAN_T s_sPlan;
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Helpers                                                                                                 */
+/*---------------------------------------------------------------------------------------------------------*/
+static void Check(int32_t i32Ok, const char *pcWhat)
+{
+    if(!i32Ok)
+    {
+        printf("  FAIL: %s\n", pcWhat);
+        s_u32Fail++;
+    }
+}
+
+static uint32_t Rand32(void)
+{
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+static uint32_t Ones(uint32_t u32Val)
+{
+    uint32_t u32Cnt = 0;
+
+    for(; u32Val; u32Val >>= 1)
+        u32Cnt += u32Val & 1;
+
+    return u32Cnt;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Frame encoder. It builds the bits of ISO 11898-1 one by one, independent of CanStats_FrameBits().       */
+/*---------------------------------------------------------------------------------------------------------*/
+static void BitsPut(BITS_T *psBits, uint32_t u32Val, uint32_t u32Num)
+{
+    while(u32Num--)
+        psBits->au8Bit[psBits->u32Len++] = (u32Val >> u32Num) & 1;
+}
+
+/* CRC-15 by long division of the bits followed by 15 zeros by x^15 + x^14 + x^10 + x^8 + x^7 + x^4 + x^3 + 1 */
+static uint32_t Crc15(const BITS_T *psBits)
+{
+    static const uint8_t au8Poly[16] = {1, 1, 0, 0, 0, 1, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1};
+    uint8_t au8Rem[192 + 15];
+    uint32_t i, j, u32Crc = 0;
+
+    memcpy(au8Rem, psBits->au8Bit, psBits->u32Len);
+    memset(&au8Rem[psBits->u32Len], 0, 15);
+
+    for(i = 0; i < psBits->u32Len; i++)
+    {
+        if(au8Rem[i])
+        {
+            for(j = 0; j < 16; j++)
+                au8Rem[i + j] ^= au8Poly[j];
+        }
+    }
+
+    for(i = 0; i < 15; i++)
+        u32Crc = (u32Crc << 1) | au8Rem[psBits->u32Len + i];
+
+    return u32Crc;
+}
+
+/* Bits from the start of frame to the end of the CRC, without stuff bits */
+static void Encode(const FRAME_T *psFrame, BITS_T *psRaw)
+{
+    uint32_t i;
+
+    psRaw->u32Len = 0;
+    BitsPut(psRaw, 0, 1);
+
+    if(psFrame->u32IdType == CAN_STATS_EXT_ID)
+    {
+        BitsPut(psRaw, psFrame->u32Id >> 18, 11);
+        BitsPut(psRaw, 1, 1);                   /* SRR */
+        BitsPut(psRaw, 1, 1);                   /* IDE */
+        BitsPut(psRaw, psFrame->u32Id & 0x3FFFF, 18);
+        BitsPut(psRaw, psFrame->u32Remote, 1);
+        BitsPut(psRaw, 0, 2);                   /* r1, r0 */
+    }
+    else
+    {
+        BitsPut(psRaw, psFrame->u32Id, 11);
+        BitsPut(psRaw, psFrame->u32Remote, 1);
+        BitsPut(psRaw, 0, 2);                   /* IDE, r0 */
+    }
+
+    BitsPut(psRaw, psFrame->u32DLC, 4);
+
+    if(!psFrame->u32Remote)
+    {
+        for(i = 0; i < ((psFrame->u32DLC > 8) ? 8 : psFrame->u32DLC); i++)
+            BitsPut(psRaw, psFrame->au8Data[i], 8);
+    }
+
+    BitsPut(psRaw, Crc15(psRaw), 15);
+}
+
+/* Insert a bit of the other level after each 5 equal bits */
+static void Stuff(const BITS_T *psRaw, BITS_T *psOut)
+{
+    uint32_t i, u32Run = 0, u32Last = 2;
+
+    psOut->u32Len = 0;
+
+    for(i = 0; i < psRaw->u32Len; i++)
+    {
+        psOut->au8Bit[psOut->u32Len++] = psRaw->au8Bit[i];
+        u32Run = (psRaw->au8Bit[i] == u32Last) ? u32Run + 1 : 1;
+        u32Last = psRaw->au8Bit[i];
+
+        if(u32Run == 5)
+        {
+            u32Last = !u32Last;
+            psOut->au8Bit[psOut->u32Len++] = (uint8_t)u32Last;
+            u32Run = 1;
+        }
+    }
+}
+
+/* Bus time of a frame: stuffed bits, CRC delimiter, ACK, end of frame and intermission */
+static uint32_t FrameBits(const FRAME_T *psFrame)
+{
+    BITS_T sRaw, sStuffed;
+
+    Encode(psFrame, &sRaw);
+    Stuff(&sRaw, &sStuffed);
+
+    return sStuffed.u32Len + 1 + 2 + 7 + 3;
+}
+
+/* The arbitration field. The node which sends a dominant bit first wins, so the lowest bit string does. */
+static uint64_t ArbKey(const FRAME_T *psFrame)
+{
+    BITS_T sRaw;
+    uint64_t u64Key = 0;
+    uint32_t i;
+
+    Encode(psFrame, &sRaw);
+
+    for(i = 1; i <= 33; i++)
+        u64Key = (u64Key << 1) | sRaw.au8Bit[i];
+
+    return u64Key;
+}
+
+static void RandomFrame(FRAME_T *psFrame)
+{
+    uint32_t i;
+
+    psFrame->u32IdType = rand() & 1;
+    psFrame->u32Id = Rand32() & ((psFrame->u32IdType == CAN_STATS_EXT_ID) ? 0x1FFFFFFF : 0x7FF);
+    psFrame->u32Remote = ((rand() & 7) == 0);
+    psFrame->u32DLC = rand() % 16;
+
+    /* Runs of equal bits are the worst case of stuffing */
+    for(i = 0; i < 8; i++)
+        psFrame->au8Data[i] = (rand() & 1) ? (uint8_t)rand() : (((rand() & 1) ? 0xFF : 0x00) ^ (uint8_t)(rand() & 0x10));
+}
+
+static void TestFrameBits(void)
+{
+    FRAME_T sFrame;
+    BITS_T sRaw, sStuffed;
+    uint32_t u32Bad = 0, u32Over = 0, u32Run, u32Bound, u32Bits, n, i;
+    uint32_t au32Min[2] = {0xFFFFFFFF, 0xFFFFFFFF}, au32Max[2] = {0, 0};
+
+    for(n = 0; n < 200000; n++)
+    {
+        RandomFrame(&sFrame);
+        u32Bits = FrameBits(&sFrame);
+
+        if(u32Bits != CanStats_FrameBits(sFrame.u32IdType, sFrame.u32Id, sFrame.u32Remote, sFrame.u32DLC,
+                                         sFrame.au8Data))
+            u32Bad++;
+
+        /* No run of 6 equal bits may be left, and the worst case of Davis et al. holds */
+        Encode(&sFrame, &sRaw);
+        Stuff(&sRaw, &sStuffed);
+
+        for(i = 1, u32Run = 1; i < sStuffed.u32Len; i++)
+        {
+            u32Run = (sStuffed.au8Bit[i] == sStuffed.au8Bit[i - 1]) ? u32Run + 1 : 1;
+
+            if(u32Run > 5)
+                u32Over++;
+        }
+
+        u32Bound = sRaw.u32Len + 13 + (sRaw.u32Len - 1) / 4;
+
+        if(u32Bits > u32Bound)
+            u32Over++;
+
+        if(!sFrame.u32Remote && (sFrame.u32DLC >= 8))
+        {
+            if(u32Bits < au32Min[sFrame.u32IdType])
+                au32Min[sFrame.u32IdType] = u32Bits;
+
+            if(u32Bits > au32Max[sFrame.u32IdType])
+                au32Max[sFrame.u32IdType] = u32Bits;
+        }
+    }
+
+    Check(u32Bad == 0, "frame length matches the bit level encoder");
+    Check(u32Over == 0, "stuffing leaves no run of 6 bits and stays in the worst case bound");
+    printf("  8 byte data frames: standard %u ~ %u bits, extended %u ~ %u bits\n", au32Min[0], au32Max[0],
+           au32Min[1], au32Max[1]);
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* C_CAN acceptance filter model                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+static uint32_t SetObjects(const CAN_FILTER_PLAN_T *psPlan, OBJ_T *psObj)
+{
+    const CAN_FILTER_T *psFilter;
+    uint32_t i;
+
+    for(i = 0; i < psPlan->u32FilterNum; i++)
+    {
+        psFilter = &psPlan->asFilter[i];
+        psObj[i].u32Xtd = (psFilter->u32IdType == CAN_FILTER_EXT_ID);
+
+        /* A standard identifier is in bits 28:18 of the field */
+        psObj[i].u32Arb = psObj[i].u32Xtd ? psFilter->u32Id : (psFilter->u32Id & 0x7FF) << 18;
+        psObj[i].u32Mask = psObj[i].u32Xtd ? psFilter->u32Mask : (psFilter->u32Mask & 0x7FF) << 18;
+    }
+
+    return psPlan->u32FilterNum;
+}
+
+/* The first object which accepts the frame stores it. MXtd is set, so the identifier type must match too. */
+static int32_t Accept(const OBJ_T *psObj, uint32_t u32ObjNum, uint32_t u32IdType, uint32_t u32Id)
+{
+    uint32_t u32Field = (u32IdType == CAN_FILTER_EXT_ID) ? u32Id : u32Id << 18;
+    uint32_t i;
+
+    for(i = 0; i < u32ObjNum; i++)
+    {
+        if((psObj[i].u32Xtd == (u32IdType == CAN_FILTER_EXT_ID)) &&
+                (((u32Field ^ psObj[i].u32Arb) & psObj[i].u32Mask & 0x1FFFFFFF) == 0))
+            return 1;
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Filter planner tests                                                                                    */
+/*---------------------------------------------------------------------------------------------------------*/
+static int32_t Wanted(const WANT_T *psWant, uint32_t u32Num, uint32_t u32IdType, uint32_t u32Id)
+{
+    uint32_t i;
+
+    for(i = 0; i < u32Num; i++)
+    {
+        if(psWant[i].u32IdType != u32IdType)
+            continue;
+
+        if(psWant[i].u32Mask ? (((u32Id ^ psWant[i].u32Id) & psWant[i].u32Mask) == 0) :
+                ((u32Id >= psWant[i].u32First) && (u32Id <= psWant[i].u32Last)))
+            return 1;
+    }
+
+    return 0;
+}
+
+static int32_t AddWant(CAN_FILTER_PLAN_T *psPlan, const WANT_T *psWant)
+{
+    if(psWant->u32Mask)
+        return CanFilter_AddMask(psPlan, psWant->u32IdType, psWant->u32Id, psWant->u32Mask);
+
+    return CanFilter_AddRange(psPlan, psWant->u32IdType, psWant->u32First, psWant->u32Last);
+}
+
+/* All filters keep the bits outside their mask 0 */
+static int32_t FiltersValid(const CAN_FILTER_PLAN_T *psPlan)
+{
+    uint32_t i, u32Full;
+
+    for(i = 0; i < psPlan->u32FilterNum; i++)
+    {
+        u32Full = (psPlan->asFilter[i].u32IdType == CAN_FILTER_EXT_ID) ? 0x1FFFFFFF : 0x7FF;
+
+        if((psPlan->asFilter[i].u32Id & ~psPlan->asFilter[i].u32Mask) || (psPlan->asFilter[i].u32Mask & ~u32Full))
+            return 0;
+    }
+
+    return 1;
+}
+
+static void TestFilterStd(void)
+{
+    WANT_T asWant[8];
+    OBJ_T asObj[CAN_FILTER_MAX_BLOCKS];
+    uint32_t u32Miss = 0, u32Model = 0, u32Count = 0, u32Budget = 0, u32Loss = 0, u32Plans = 0;
+    uint32_t u32WantNum, u32MaxFilters, u32ObjNum, u32Wanted, u32Accepted, u32W, u32A, u32Id, n, i;
+    uint64_t u64Ppm = 0;
+    int32_t i32Num;
+
+    for(n = 0; n < 2000; n++)
+    {
+        u32WantNum = 1 + rand() % 8;
+        u32MaxFilters = 1 + rand() % 8;
+        CanFilter_Init(&s_sPlan);
+
+        for(i = 0; i < u32WantNum; i++)
+        {
+            asWant[i].u32IdType = CAN_FILTER_STD_ID;
+
+            if(rand() % 3)
+            {
+                asWant[i].u32First = rand() % 0x800;
+                asWant[i].u32Last = asWant[i].u32First + rand() % ((rand() & 1) ? 16 : 300);
+                asWant[i].u32Last = (asWant[i].u32Last > 0x7FF) ? 0x7FF : asWant[i].u32Last;
+                asWant[i].u32Mask = 0;
+            }
+            else
+            {
+                asWant[i].u32Id = rand() % 0x800;
+                asWant[i].u32Mask = 0x7FF & ~(1 << (rand() % 11)) & ~(1 << (rand() % 11));
+            }
+
+            if(AddWant(&s_sPlan, &asWant[i]) < 0)
+                break;
+        }
+
+        /* Too many blocks for a plan is fine, but only for unaligned ranges */
+        if(i < u32WantNum)
+            continue;
+
+        if((i32Num = CanFilter_Plan(&s_sPlan, u32MaxFilters)) < 0)
+        {
+            u32Budget++;
+            continue;
+        }
+
+        u32Plans++;
+
+        if(((uint32_t)i32Num > u32MaxFilters) || !FiltersValid(&s_sPlan))
+            u32Budget++;
+
+        u32ObjNum = SetObjects(&s_sPlan, asObj);
+        u32Wanted = 0;
+        u32Accepted = 0;
+
+        for(u32Id = 0; u32Id < 0x800; u32Id++)
+        {
+            u32W = Wanted(asWant, u32WantNum, CAN_FILTER_STD_ID, u32Id);
+            u32A = Accept(asObj, u32ObjNum, CAN_FILTER_STD_ID, u32Id);
+            u32Wanted += u32W;
+            u32Accepted += u32A;
+
+            if(u32W && !u32A)
+                u32Miss++;
+
+            if(u32A != (uint32_t)CanFilter_Match(&s_sPlan, CAN_FILTER_STD_ID, u32Id))
+                u32Model++;
+
+            if(Accept(asObj, u32ObjNum, CAN_FILTER_EXT_ID, u32Id))
+                u32Model++;
+        }
+
+        if((u32Wanted != s_sPlan.u32WantedIds) || (u32Accepted != s_sPlan.u32AcceptedIds))
+            u32Count++;
+
+        u64Ppm += CanFilter_FalseAcceptPpm(&s_sPlan);
+
+        /* With objects for all blocks nothing unwanted may pass */
+        CanFilter_Plan(&s_sPlan, CAN_FILTER_MAX_BLOCKS);
+
+        if(s_sPlan.u32AcceptedIds != s_sPlan.u32WantedIds)
+            u32Loss++;
+    }
+
+    Check(u32Miss == 0, "standard plans accept every wanted identifier");
+    Check(u32Model == 0, "message object model matches CanFilter_Match()");
+    Check(u32Count == 0, "wanted and accepted counts match the exhaustive counts");
+    Check(u32Budget == 0, "plans fit the filter budget");
+    Check(u32Loss == 0, "plans without a budget are exact");
+    printf("  %u standard plans, average false accept %u ppm\n", u32Plans, (uint32_t)(u64Ppm / (u32Plans ? u32Plans : 1)));
+}
+
+/* Identifiers of the union of the filters of one type by inclusion-exclusion */
+static uint64_t UnionCount(const CAN_FILTER_PLAN_T *psPlan, uint32_t u32IdType)
+{
+    uint32_t au32Idx[16], u32Num = 0, u32Set, u32Id, u32Mask, u32Ok, i;
+    uint32_t u32Width = (u32IdType == CAN_FILTER_EXT_ID) ? 29 : 11;
+    int64_t i64Sum = 0;
+
+    for(i = 0; i < psPlan->u32FilterNum; i++)
+    {
+        if((psPlan->asFilter[i].u32IdType == u32IdType) && (u32Num < 16))
+            au32Idx[u32Num++] = i;
+    }
+
+    for(u32Set = 1; u32Set < (1UL << u32Num); u32Set++)
+    {
+        u32Id = 0;
+        u32Mask = 0;
+        u32Ok = 1;
+
+        for(i = 0; i < u32Num; i++)
+        {
+            if(!(u32Set & (1UL << i)))
+                continue;
+
+            if((u32Id ^ psPlan->asFilter[au32Idx[i]].u32Id) & u32Mask & psPlan->asFilter[au32Idx[i]].u32Mask)
+                u32Ok = 0;
+
+            u32Id |= psPlan->asFilter[au32Idx[i]].u32Id;
+            u32Mask |= psPlan->asFilter[au32Idx[i]].u32Mask;
+        }
+
+        if(u32Ok)
+            i64Sum += ((Ones(u32Set) & 1) ? 1 : -1) * (int64_t)(1ULL << (u32Width - Ones(u32Mask)));
+    }
+
+    return (uint64_t)i64Sum;
+}
+
+/* Identifiers of the union of ranges */
+static uint64_t RangeCount(const WANT_T *psWant, uint32_t u32Num)
+{
+    WANT_T asSort[8], sTmp;
+    uint64_t u64Cnt = 0;
+    uint32_t u32End = 0, u32Any = 0, i, j;
+
+    memcpy(asSort, psWant, u32Num * sizeof(WANT_T));
+
+    for(i = 1; i < u32Num; i++)
+    {
+        for(j = i; (j > 0) && (asSort[j - 1].u32First > asSort[j].u32First); j--)
+        {
+            sTmp = asSort[j];
+            asSort[j] = asSort[j - 1];
+            asSort[j - 1] = sTmp;
+        }
+    }
+
+    for(i = 0; i < u32Num; i++)
+    {
+        if(!u32Any || (asSort[i].u32First > u32End))
+            u64Cnt += (uint64_t)asSort[i].u32Last - asSort[i].u32First + 1;
+        else if(asSort[i].u32Last > u32End)
+            u64Cnt += asSort[i].u32Last - u32End;
+
+        if(!u32Any || (asSort[i].u32Last > u32End))
+            u32End = asSort[i].u32Last;
+
+        u32Any = 1;
+    }
+
+    return u64Cnt;
+}
+
+static void TestFilterExt(void)
+{
+    WANT_T asWant[8];
+    OBJ_T asObj[CAN_FILTER_MAX_BLOCKS];
+    uint32_t u32Miss = 0, u32Model = 0, u32Count = 0, u32Budget = 0, u32Plans = 0;
+    uint32_t u32WantNum, u32MaxFilters, u32ObjNum, u32Id, u32A, n, i, k;
+    int32_t i32Num;
+
+    for(n = 0; n < 500; n++)
+    {
+        u32WantNum = 1 + rand() % 6;
+        u32MaxFilters = 1 + rand() % 8;
+        CanFilter_Init(&s_sPlan);
+
+        for(i = 0; i < u32WantNum; i++)
+        {
+            asWant[i].u32IdType = CAN_FILTER_EXT_ID;
+            asWant[i].u32First = Rand32() & 0x1FFFFFFF;
+            asWant[i].u32Last = asWant[i].u32First + (Rand32() % (1UL << (rand() % 21)));
+            asWant[i].u32Last = (asWant[i].u32Last > 0x1FFFFFFF) ? 0x1FFFFFFF : asWant[i].u32Last;
+            asWant[i].u32Mask = 0;
+
+            if(AddWant(&s_sPlan, &asWant[i]) < 0)
+                break;
+        }
+
+        if(i < u32WantNum)
+            continue;
+
+        if((i32Num = CanFilter_Plan(&s_sPlan, u32MaxFilters)) < 0)
+        {
+            u32Budget++;
+            continue;
+        }
+
+        u32Plans++;
+
+        if(((uint32_t)i32Num > u32MaxFilters) || !FiltersValid(&s_sPlan))
+            u32Budget++;
+
+        u32ObjNum = SetObjects(&s_sPlan, asObj);
+
+        /* Samples in the wanted ranges and all over the identifier space */
+        for(k = 0; k < 2000; k++)
+        {
+            i = rand() % u32WantNum;
+            u32Id = asWant[i].u32First + Rand32() % (asWant[i].u32Last - asWant[i].u32First + 1);
+
+            if(!Accept(asObj, u32ObjNum, CAN_FILTER_EXT_ID, u32Id))
+                u32Miss++;
+
+            u32Id = Rand32() & 0x1FFFFFFF;
+            u32A = Accept(asObj, u32ObjNum, CAN_FILTER_EXT_ID, u32Id);
+
+            if(u32A != (uint32_t)CanFilter_Match(&s_sPlan, CAN_FILTER_EXT_ID, u32Id))
+                u32Model++;
+
+            if(u32A && !Wanted(asWant, u32WantNum, CAN_FILTER_EXT_ID, u32Id) && (s_sPlan.u32AcceptedIds == s_sPlan.u32WantedIds))
+                u32Model++;
+        }
+
+        if((s_sPlan.u32WantedIds != RangeCount(asWant, u32WantNum)) ||
+                (s_sPlan.u32AcceptedIds != UnionCount(&s_sPlan, CAN_FILTER_EXT_ID)))
+            u32Count++;
+    }
+
+    Check(u32Miss == 0, "extended plans accept the sampled wanted identifiers");
+    Check(u32Model == 0, "message object model matches CanFilter_Match() on samples");
+    Check(u32Count == 0, "wanted and accepted counts match the range union and inclusion-exclusion");
+    Check(u32Budget == 0, "extended plans fit the filter budget");
+    printf("  %u extended plans\n", u32Plans);
+}
+
+/* Fewest standard identifiers which u32Groups + u32Free filters accept if every wanted block of the plan is in one
+   filter. Every grouping is tried and counted identifier by identifier. */
+static uint32_t BestGrouping(const CAN_FILTER_PLAN_T *psPlan, uint32_t u32Block, uint32_t *pu32Id, uint32_t *pu32Mask,
+                             uint32_t u32Groups, uint32_t u32Free)
+{
+    const CAN_FILTER_T *psBlock = &psPlan->asWant[u32Block];
+    uint32_t u32Id, u32Mask, u32Best = 0xFFFFFFFF, u32Cnt, i;
+
+    if(u32Block == psPlan->u32WantNum)
+    {
+        for(u32Id = 0, u32Cnt = 0; u32Id < 0x800; u32Id++)
+        {
+            for(i = 0; (i < u32Groups) && ((u32Id ^ pu32Id[i]) & pu32Mask[i]); i++);
+
+            u32Cnt += (i < u32Groups);
+        }
+
+        return u32Cnt;
+    }
+
+    for(i = 0; i < u32Groups; i++)
+    {
+        u32Id = pu32Id[i];
+        u32Mask = pu32Mask[i];
+        pu32Mask[i] &= psBlock->u32Mask & ~(u32Id ^ psBlock->u32Id);
+        pu32Id[i] &= pu32Mask[i];
+        u32Cnt = BestGrouping(psPlan, u32Block + 1, pu32Id, pu32Mask, u32Groups, u32Free);
+        u32Best = (u32Cnt < u32Best) ? u32Cnt : u32Best;
+        pu32Id[i] = u32Id;
+        pu32Mask[i] = u32Mask;
+    }
+
+    if(u32Free)
+    {
+        pu32Id[u32Groups] = psBlock->u32Id;
+        pu32Mask[u32Groups] = psBlock->u32Mask;
+        u32Cnt = BestGrouping(psPlan, u32Block + 1, pu32Id, pu32Mask, u32Groups + 1, u32Free - 1);
+        u32Best = (u32Cnt < u32Best) ? u32Cnt : u32Best;
+    }
+
+    return u32Best;
+}
+
+/* Plans of few blocks must be the best grouping of the blocks */
+static void TestFilterBest(void)
+{
+    uint32_t au32Id[8], au32Mask[8], u32Plans = 0, u32Worse = 0, u32MaxFilters, i, n;
+
+    for(n = 0; n < 1000; n++)
+    {
+        CanFilter_Init(&s_sPlan);
+
+        for(i = 2 + rand() % 7; i > 0; i--)
+            CanFilter_AddMask(&s_sPlan, CAN_FILTER_STD_ID, rand() % 0x800, 0x7FF & ~(1 << (rand() % 11)) & ~(1 << (rand() % 11)));
+
+        if((s_sPlan.u32WantNum < 2) || (s_sPlan.u32WantNum > 8))
+            continue;
+
+        u32MaxFilters = 1 + rand() % (s_sPlan.u32WantNum - 1);
+
+        if(CanFilter_Plan(&s_sPlan, u32MaxFilters) < 0)
+            continue;
+
+        u32Plans++;
+
+        if(s_sPlan.u32AcceptedIds != BestGrouping(&s_sPlan, 0, au32Id, au32Mask, 0, u32MaxFilters))
+            u32Worse++;
+    }
+
+    Check(u32Worse == 0, "plans of few blocks are the best grouping");
+    printf("  %u plans of up to 8 blocks, %u above the best grouping\n", u32Plans, u32Worse);
+}
+
+static void TestFilterParam(void)
+{
+    uint32_t i;
+    int32_t i32Ret = CAN_FILTER_OK;
+
+    CanFilter_Init(&s_sPlan);
+    Check(CanFilter_AddRange(&s_sPlan, CAN_FILTER_STD_ID, 0x10, 0x5) == CAN_FILTER_ERR_PARAM, "reversed range");
+    Check(CanFilter_AddRange(&s_sPlan, CAN_FILTER_STD_ID, 0x0, 0x800) == CAN_FILTER_ERR_PARAM, "range past 11 bits");
+    Check(CanFilter_AddMask(&s_sPlan, 2, 0, 0) == CAN_FILTER_ERR_PARAM, "invalid identifier type");
+    Check(CanFilter_Plan(&s_sPlan, 0) == CAN_FILTER_ERR_PARAM, "plan without filters");
+
+    /* Both types need one filter each at least */
+    Check(CanFilter_AddRange(&s_sPlan, CAN_FILTER_STD_ID, 0x123, 0x456) == CAN_FILTER_OK, "standard range");
+    Check(CanFilter_AddRange(&s_sPlan, CAN_FILTER_EXT_ID, 0x1000, 0x1FFF) == CAN_FILTER_OK, "extended range");
+    Check(CanFilter_Plan(&s_sPlan, 1) == CAN_FILTER_ERR_PARAM, "two types in one filter");
+    Check(CanFilter_Plan(&s_sPlan, 2) == 2, "two types in two filters");
+
+    /* Identifiers added twice count once */
+    CanFilter_Init(&s_sPlan);
+    CanFilter_AddRange(&s_sPlan, CAN_FILTER_STD_ID, 0x100, 0x1FF);
+    CanFilter_AddMask(&s_sPlan, CAN_FILTER_STD_ID, 0x140, 0x7C0);
+    CanFilter_AddRange(&s_sPlan, CAN_FILTER_STD_ID, 0x180, 0x27F);
+    Check((CanFilter_Plan(&s_sPlan, 8) > 0) && (s_sPlan.u32WantedIds == 0x180) && (s_sPlan.u32AcceptedIds == 0x180),
+          "overlapping wants");
+
+    /* Every other identifier needs a block each */
+    CanFilter_Init(&s_sPlan);
+
+    for(i = 0; (i < 0x800) && (i32Ret == CAN_FILTER_OK); i += 2)
+        i32Ret = CanFilter_AddMask(&s_sPlan, CAN_FILTER_STD_ID, i, 0x7FF);
+
+    Check((i32Ret == CAN_FILTER_ERR_FULL) && (i == 2 * (CAN_FILTER_MAX_BLOCKS + 1)), "block table full");
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Statistics tests                                                                                        */
+/*---------------------------------------------------------------------------------------------------------*/
+static void TestStatsTable(void)
+{
+    CAN_STATS_T sStats;
+    CAN_STATS_ID_T asId[8];
+    CAN_STATS_ID_T *psEntry;
+    uint8_t au8Data[8] = {0};
+    uint32_t i, u32Found = 0;
+
+    CanStats_Init(&sStats, BIT_RATE, BIT_RATE, WIN_BITS, asId, 8, 0);
+
+    for(i = 0; i < 12; i++)
+        CanStats_Rx(&sStats, CAN_STATS_EXT_ID, 0x1000 + i * 0x40, 0, 8, au8Data, i * 100);
+
+    CanStats_Rx(&sStats, CAN_STATS_EXT_ID, 0x1000, 0, 8, au8Data, 5000);
+    CanStats_Tx(&sStats, CAN_STATS_EXT_ID, 0x1000, 100, 350);
+
+    for(i = 0; i < 12; i++)
+        u32Found += (CanStats_Find(&sStats, CAN_STATS_EXT_ID, 0x1000 + i * 0x40) != NULL);
+
+    psEntry = CanStats_Find(&sStats, CAN_STATS_EXT_ID, 0x1000);
+
+    Check((sStats.u32IdNum == 8) && (sStats.u32IdDrop == 4) && (u32Found == 8), "full table drops new identifiers");
+    Check(psEntry && (psEntry->u32RxCnt == 2) && (psEntry->u32RxGapMax == 5000) && (psEntry->u32LatMin == 250),
+          "counters of an identifier");
+    Check(CanStats_Find(&sStats, CAN_STATS_STD_ID, 0x1000) == NULL, "identifier types are kept apart");
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Bus model                                                                                               */
+/*---------------------------------------------------------------------------------------------------------*/
+static void MsgFrame(const MSG_T *psMsg, FRAME_T *psFrame)
+{
+    uint32_t i, u32Hash = psMsg->u32Id * 2654435761UL + psMsg->u32Seq * 40503UL;
+
+    psFrame->u32IdType = psMsg->u32IdType;
+    psFrame->u32Id = psMsg->u32Id;
+    psFrame->u32Remote = 0;
+    psFrame->u32DLC = psMsg->u32DLC;
+
+    /* Counters and signals: a retransmission sends the same data */
+    for(i = 0; i < 8; i++)
+    {
+        u32Hash = u32Hash * 1103515245UL + 12345;
+        psFrame->au8Data[i] = (i < 2) ? (uint8_t)(psMsg->u32Seq >> (i * 8)) : (uint8_t)(u32Hash >> 24);
+    }
+}
+
+static void RunBus(const SCENARIO_T *psScen)
+{
+    static MSG_T asMsg[BUS_MSG_NUM];
+    CAN_STATS_T sStats;
+    CAN_STATS_ID_T asId[ID_STATS_SIZE];
+    CAN_STATS_ID_T *psEntry;
+    OBJ_T asObj[OBJ_MAX];
+    FRAME_T sFrame;
+    MSG_T *psMsg, *psWin;
+    uint32_t u32Now = 0, u32WinStart = 0, u32WinBits = 0, u32WinErr = 0, u32BusFrames = 0, u32ErrFrames = 0;
+    uint32_t u32ObjNum, u32Bits, u32Lat, u32Next, u32Diff, u32DiffMax = 0, u32Windows = 0, u32ErrBad = 0;
+    uint32_t u32RxBad = 0, u32TxBad = 0, u32LoadSum = 0, u32TrueSum = 0, u32Pos, i;
+    uint64_t u64Busy = 0;
+
+    printf("%s, %u filters, %u error frames per 1000 frames\n", psScen->pcName, psScen->u32Filters,
+           psScen->u32ErrPerMille);
+
+    /* Filters of the node under test */
+    CanFilter_Init(&s_sPlan);
+
+    if(psScen->u32Filters == 2)
+    {
+        CanFilter_AddMask(&s_sPlan, CAN_FILTER_STD_ID, 0, 0);
+        CanFilter_AddMask(&s_sPlan, CAN_FILTER_EXT_ID, 0, 0);
+    }
+    else
+    {
+        for(i = 0; i < sizeof(s_asNodeWant) / sizeof(s_asNodeWant[0]); i++)
+            AddWant(&s_sPlan, &s_asNodeWant[i]);
+    }
+
+    Check(CanFilter_Plan(&s_sPlan, psScen->u32Filters) > 0, "plan of the node");
+    u32ObjNum = SetObjects(&s_sPlan, asObj);
+
+    for(i = 0; i < u32ObjNum; i++)
+        printf("  %s filter 0x%08X / 0x%08X\n", asObj[i].u32Xtd ? "EXT" : "STD", s_sPlan.asFilter[i].u32Id,
+               s_sPlan.asFilter[i].u32Mask);
+
+    memset(asMsg, 0, sizeof(asMsg));
+
+    for(i = 0; i < BUS_MSG_NUM; i++)
+    {
+        asMsg[i].u32Node = s_asBusMsg[i].u32Node;
+        asMsg[i].u32IdType = s_asBusMsg[i].u32IdType;
+        asMsg[i].u32Id = s_asBusMsg[i].u32Id;
+        asMsg[i].u32DLC = s_asBusMsg[i].u32DLC;
+        asMsg[i].u32Period = s_asBusMsg[i].u32Period;
+        asMsg[i].u32Next = rand() % asMsg[i].u32Period;
+        MsgFrame(&asMsg[i], &sFrame);
+        asMsg[i].u64Key = ArbKey(&sFrame);
+    }
+
+    CanStats_Init(&sStats, BIT_RATE, BIT_RATE, WIN_BITS, asId, ID_STATS_SIZE, 0);
+
+    while(u32Now < SIM_BITS)
+    {
+        /* Release the periodic frames */
+        u32Next = 0xFFFFFFFF;
+
+        for(i = 0; i < BUS_MSG_NUM; i++)
+        {
+            psMsg = &asMsg[i];
+
+            while(psMsg->u32Next <= u32Now)
+            {
+                if(psMsg->u32PendNum < PEND_MAX)
+                    psMsg->au32Pend[psMsg->u32PendNum++] = psMsg->u32Next;
+                else
+                    psMsg->u32Overflow++;
+
+                psMsg->u32Next += psMsg->u32Period;
+            }
+
+            if(psMsg->u32Next < u32Next)
+                u32Next = psMsg->u32Next;
+        }
+
+        /* Arbitration among the nodes with a frame waiting at the start of frame */
+        psWin = NULL;
+
+        for(i = 0; i < BUS_MSG_NUM; i++)
+        {
+            if(asMsg[i].u32PendNum && ((psWin == NULL) || (asMsg[i].u64Key < psWin->u64Key)))
+                psWin = &asMsg[i];
+        }
+
+        if(psWin == NULL)
+        {
+            u32Now = u32Next;
+            continue;
+        }
+
+        MsgFrame(psWin, &sFrame);
+        u32Bits = FrameBits(&sFrame);
+
+        if((uint32_t)(rand() % 1000) < psScen->u32ErrPerMille)
+        {
+            /* An error flag at a random bit, the flags of the other nodes, delimiter and intermission.
+               The frame is sent again. */
+            u32Pos = 1 + rand() % (u32Bits - 10);
+            u32Bits = u32Pos + 6 + rand() % 7 + 8 + 3;
+            u32Now += u32Bits;
+            u32ErrFrames++;
+            u32WinErr++;
+            psWin->u32Retries++;
+        }
+        else
+        {
+            u32Now += u32Bits;
+            u32BusFrames++;
+
+            if(psWin->u32Node == 0)
+            {
+                /* Sent by the node under test */
+                u32Lat = u32Now - psWin->au32Pend[0];
+                CanStats_Tx(&sStats, psWin->u32IdType, psWin->u32Id, psWin->au32Pend[0], u32Now);
+
+                if((psWin->u32TxCnt == 0) || (u32Lat < psWin->u32LatMin))
+                    psWin->u32LatMin = u32Lat;
+
+                if(u32Lat > psWin->u32LatMax)
+                    psWin->u32LatMax = u32Lat;
+
+                psWin->u64LatSum += u32Lat;
+                psWin->u32TxCnt++;
+            }
+            else if(Accept(asObj, u32ObjNum, psWin->u32IdType, psWin->u32Id))
+            {
+                CanStats_Rx(&sStats, sFrame.u32IdType, sFrame.u32Id, 0, sFrame.u32DLC, sFrame.au8Data, u32Now);
+
+                if(psWin->u32RxCnt && (u32Now - psWin->u32RxLast > psWin->u32RxGapMax))
+                    psWin->u32RxGapMax = u32Now - psWin->u32RxLast;
+
+                psWin->u32RxLast = u32Now;
+                psWin->u32RxCnt++;
+            }
+
+            psWin->u32PendNum--;
+            memmove(&psWin->au32Pend[0], &psWin->au32Pend[1], psWin->u32PendNum * sizeof(uint32_t));
+            psWin->u32Seq++;
+        }
+
+        u32WinBits += u32Bits;
+        u64Busy += u32Bits;
+
+        /* The node updates the statistics after each frame */
+        if(CanStats_Bus(&sStats, u32BusFrames, u32ErrFrames, u32Now))
+        {
+            u32Pos = (uint32_t)((uint64_t)u32WinBits * 1000 / (u32Now - u32WinStart));
+            u32Diff = (sStats.u32Load > u32Pos) ? sStats.u32Load - u32Pos : u32Pos - sStats.u32Load;
+            u32DiffMax = (u32Diff > u32DiffMax) ? u32Diff : u32DiffMax;
+            u32LoadSum += sStats.u32Load;
+            u32TrueSum += u32Pos;
+
+            if(sStats.u32ErrRate != (uint32_t)((uint64_t)u32WinErr * BIT_RATE / (u32Now - u32WinStart)))
+                u32ErrBad++;
+
+            u32Windows++;
+            u32WinStart = u32Now;
+            u32WinBits = 0;
+            u32WinErr = 0;
+        }
+    }
+
+    printf("  Bus load %.1f %% counted, %.1f %% in the model over %u windows, largest difference %.1f %%\n",
+           u32LoadSum / 10.0 / u32Windows, u32TrueSum / 10.0 / u32Windows, u32Windows, u32DiffMax / 10.0);
+    printf("  %u frames, %u error frames, %.1f %% busy\n", sStats.u32Frames, sStats.u32ErrFrames, u64Busy * 100.0 / u32Now);
+
+    for(i = 0; i < BUS_MSG_NUM; i++)
+    {
+        psMsg = &asMsg[i];
+        psEntry = CanStats_Find(&sStats, psMsg->u32IdType, psMsg->u32Id);
+
+        if(psMsg->u32Node == 0)
+        {
+            printf("  TX %08X: %u frames, latency %u / %u / %u us, %u retries, %u overflows\n", psMsg->u32Id,
+                   psMsg->u32TxCnt, psMsg->u32LatMin * 1000000 / BIT_RATE,
+                   (uint32_t)(psMsg->u64LatSum / psMsg->u32TxCnt * 1000000 / BIT_RATE),
+                   psMsg->u32LatMax * 1000000 / BIT_RATE, psMsg->u32Retries, psMsg->u32Overflow);
+
+            if(!psEntry || (psEntry->u32TxCnt != psMsg->u32TxCnt) || (psEntry->u32LatMin != psMsg->u32LatMin) ||
+                    (psEntry->u32LatMax != psMsg->u32LatMax) || (psEntry->u64LatSum != psMsg->u64LatSum))
+                u32TxBad++;
+        }
+        else if(psMsg->u32RxCnt)
+        {
+            if(!psEntry || (psEntry->u32RxCnt != psMsg->u32RxCnt) || (psEntry->u32RxGapMax != psMsg->u32RxGapMax))
+                u32RxBad++;
+        }
+        else if(psEntry && psEntry->u32RxCnt)
+        {
+            u32RxBad++;
+        }
+    }
+
+    Check(u32Windows >= SIM_BITS / WIN_BITS - 1, "a window closes every 100 ms");
+    Check(u32DiffMax <= psScen->u32LoadTol + psScen->u32ErrPerMille / 10, "counted bus load is close to the model");
+    Check(u32ErrBad == 0, "error rate matches the model");
+    Check(sStats.u32Frames == u32BusFrames, "all frames are counted");
+    Check(u32RxBad == 0, "receive counters match the model");
+    Check(u32TxBad == 0, "transmit latency matches the model");
+    Check(sStats.u32IdDrop == 0, "no identifier is dropped");
+}
+
+int main(int argc, char **argv)
+{
+    /* Frames of the node itself and frames dropped by its filters count with the average length of the
+       received ones, and errors with half a frame, so the load is only estimated. The load tolerance is wider
+       with fewer frames received and grows with the errors. */
+    SCENARIO_T asScen[3] =
+    {
+        {"All frames received", 2, 0, 20},
+        {"All frames received, with errors", 2, 10, 20},
+        {"Planned filters, with errors", 4, 10, 80},
+    };
+    uint32_t i;
+
+    if(argc > 1)
+    {
+        asScen[1].u32ErrPerMille = strtoul(argv[1], NULL, 0);
+        asScen[2].u32ErrPerMille = asScen[1].u32ErrPerMille;
+    }
+
+    srand(1);
+
+    printf("Frame encoder\n");
+    TestFrameBits();
+
+    printf("Filter planner\n");
+    TestFilterParam();
+    TestFilterStd();
+    TestFilterExt();
+    TestFilterBest();
+
+    printf("Statistics table\n");
+    TestStatsTable();
+
+    for(i = 0; i < 3; i++)
+        RunBus(&asScen[i]);
+
+    printf("%s\n", s_u32Fail ? "FAIL" : "PASS");
+
+    return s_u32Fail ? 1 : 0;
+}
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
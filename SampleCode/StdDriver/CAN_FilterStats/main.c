@@ -0,0 +1,421 @@
+/****************************************************************************
+ * @file     main.c
+ * @version  V1.00
+ * @brief
+ *           Plan the acceptance filters of wanted identifier ranges, and count the bus load, error frames and
+ *           the latency of each identifier. The CAN runs in loop back and silent mode at 1 Mbit/s, so no
+ *           transceiver or second board is needed. Frames of wanted, unwanted and falsely accepted identifiers
+ *           are sent, and the received ones are checked against the plan.
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ *
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include "M451Series.h"
+#include "can_filter.h"
+#include "can_stats.h"
+
+
+#define PLL_CLOCK       72000000
+#define CAN_BIT_RATE    1000000
+
+#define FILTER_MAX      4       /* Each filter is a receive FIFO of FILTER_DEPTH objects from object 0 */
+#define FILTER_DEPTH    4
+#define TX_OBJ          16
+#define TX_NUM          8
+
+#define RX_RING_SIZE    64
+#define TX_HEAP_SIZE    32
+#define ID_STATS_SIZE   32
+
+#define TEST_FRAMES     10000
+#define ID_NUM          (sizeof(s_asId) / sizeof(s_asId[0]))
+
+/*---------------------------------------------------------------------------*/
+/*  Function Declare                                                         */
+/*---------------------------------------------------------------------------*/
+extern void CAN_EnterTestMode(CAN_T *tCAN, uint8_t u8TestMask);
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Define global variables and constants                                                                   */
+/*---------------------------------------------------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t u32IdType;
+    uint32_t u32First;
+    uint32_t u32Last;
+} WANTED_T;
+
+typedef struct
+{
+    uint32_t u32IdType;
+    uint32_t u32Id;
+    uint8_t  u8DLC;
+} TEST_ID_T;
+
+/* Identifiers the application wants */
+static const WANTED_T s_asWanted[] =
+{
+    {CAN_STD_ID, 0x100,      0x17F},
+    {CAN_STD_ID, 0x200,      0x213},
+    {CAN_STD_ID, 0x345,      0x345},
+    {CAN_STD_ID, 0x347,      0x347},
+    {CAN_EXT_ID, 0x18FEF000, 0x18FEF0FF},
+};
+
+/* Identifiers on the bus, wanted or not */
+static const TEST_ID_T s_asId[] =
+{
+    {CAN_STD_ID, 0x100,      8},
+    {CAN_STD_ID, 0x17F,      2},
+    {CAN_STD_ID, 0x20A,      8},
+    {CAN_STD_ID, 0x212,      8},
+    {CAN_STD_ID, 0x21C,      8},
+    {CAN_STD_ID, 0x345,      1},
+    {CAN_STD_ID, 0x346,      8},
+    {CAN_STD_ID, 0x7F0,      8},
+    {CAN_EXT_ID, 0x18FEF012, 8},
+    {CAN_EXT_ID, 0x18FEF112, 8},
+};
+
+static CAN_FILTER_PLAN_T s_sPlan;
+static CAN_STATS_T s_sStats;
+static CAN_STATS_ID_T s_asIdStats[ID_STATS_SIZE];
+
+static CAN_QUEUE_T s_sQueue;
+static STR_CANMSG_T s_asRxRing[RX_RING_SIZE];
+static CAN_QTX_T s_asTxHeap[TX_HEAP_SIZE];
+static CAN_QTX_T s_asTxObj[TX_NUM];
+
+static uint32_t s_au32Sent[ID_NUM];
+static uint32_t s_au32Received[ID_NUM];
+
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* CAN0 interrupt handler                                                                                  */
+/*---------------------------------------------------------------------------------------------------------*/
+void CAN0_IRQHandler(void)
+{
+    uint32_t u32IIDR;
+
+    /* No message object outside the queue is used. Just clear one if it interrupts. */
+    u32IIDR = CAN_QueueIRQHandler(&s_sQueue);
+
+    if((u32IIDR != 0) && (u32IIDR <= 32))
+        CAN_CLR_INT_PENDING_BIT(CAN0, (uint8_t)(u32IIDR - 1));
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Time stamps of the queue and the statistics are core clock cycles                                       */
+/*---------------------------------------------------------------------------------------------------------*/
+uint32_t Get_Time(void)
+{
+    return DWT->CYCCNT;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Called in the CAN interrupt when a queued frame has been sent                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+void Tx_Done(CAN_QUEUE_T *psQueue, CAN_QTX_T *psEntry)
+{
+    (void)psQueue;
+
+    CanStats_Tx(&s_sStats, psEntry->sMsg.IdType, psEntry->sMsg.Id, psEntry->u32Time, DWT->CYCCNT);
+}
+
+void SYS_Init(void)
+{
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init System Clock                                                                                       */
+    /*---------------------------------------------------------------------------------------------------------*/
+
+    /* Enable HIRC clock (Internal RC 22.1184MHz) */
+    CLK_EnableXtalRC(CLK_PWRCTL_HIRCEN_Msk);
+
+    /* Wait for HIRC clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HIRCSTB_Msk);
+
+    /* Select HCLK clock source as HIRC and HCLK source divider as 1 */
+    CLK_SetHCLK(CLK_CLKSEL0_HCLKSEL_HIRC, CLK_CLKDIV0_HCLK(1));
+
+    /* Set PLL to Power-down mode and PLLSTB bit in CLK_STATUS register will be cleared by hardware.*/
+    CLK_DisablePLL();
+
+    /* Enable HXT clock (external XTAL 12MHz) */
+    CLK_EnableXtalRC(CLK_PWRCTL_HXTEN_Msk);
+
+    /* Wait for HXT clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HXTSTB_Msk);
+
+    /* Set core clock as PLL_CLOCK from PLL */
+    CLK_SetCoreClock(PLL_CLOCK);
+
+    /* Enable UART module clock */
+    CLK_EnableModuleClock(UART0_MODULE);
+
+    /* Select UART module clock source as HXT and UART module clock divider as 1 */
+    CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL1_UARTSEL_HXT, CLK_CLKDIV0_UART(1));
+
+    /* Enable CAN module clock */
+    CLK_EnableModuleClock(CAN0_MODULE);
+
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init I/O Multi-function                                                                                 */
+    /*---------------------------------------------------------------------------------------------------------*/
+
+    /* Set PD multi-function pins for UART0 RXD and TXD */
+    SYS->GPD_MFPL &= ~(SYS_GPD_MFPL_PD0MFP_Msk | SYS_GPD_MFPL_PD1MFP_Msk);
+    SYS->GPD_MFPL |= (SYS_GPD_MFPL_PD0MFP_UART0_RXD | SYS_GPD_MFPL_PD1MFP_UART0_TXD);
+
+    /* Set PA multi-function pins for CANTX0 and CANRX0 */
+    SYS->GPA_MFPL &= ~(SYS_GPA_MFPL_PA0MFP_Msk | SYS_GPA_MFPL_PA1MFP_Msk);
+    SYS->GPA_MFPL |= (SYS_GPA_MFPL_PA1MFP_CAN0_TXD | SYS_GPA_MFPL_PA0MFP_CAN0_RXD);
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Plan the filters of the wanted identifiers and set up one receive FIFO for each                         */
+/*---------------------------------------------------------------------------------------------------------*/
+int32_t Filter_Init(void)
+{
+    CAN_FILTER_T *psFilter;
+    uint32_t i;
+    int32_t i32Num;
+
+    CanFilter_Init(&s_sPlan);
+
+    for(i = 0; i < sizeof(s_asWanted) / sizeof(s_asWanted[0]); i++)
+    {
+        if(CanFilter_AddRange(&s_sPlan, s_asWanted[i].u32IdType, s_asWanted[i].u32First, s_asWanted[i].u32Last) < 0)
+        {
+            printf("Invalid range 0x%X ~ 0x%X\n", s_asWanted[i].u32First, s_asWanted[i].u32Last);
+            return -1;
+        }
+    }
+
+    if((i32Num = CanFilter_Plan(&s_sPlan, FILTER_MAX)) < 0)
+    {
+        printf("No plan in %d filters\n", FILTER_MAX);
+        return -1;
+    }
+
+    printf("%d wanted identifiers in %d filters:\n", s_sPlan.u32WantedIds, i32Num);
+
+    for(i = 0; i < (uint32_t)i32Num; i++)
+    {
+        psFilter = &s_sPlan.asFilter[i];
+        printf("  %s ID 0x%08X mask 0x%08X, %d wanted\n", (psFilter->u32IdType == CAN_STD_ID) ? "STD" : "EXT",
+               psFilter->u32Id, psFilter->u32Mask, psFilter->u32Wanted);
+
+        CAN_SetMultiRxMsgAndMsk(CAN0, i * FILTER_DEPTH, FILTER_DEPTH, psFilter->u32IdType, psFilter->u32Id,
+                                psFilter->u32Mask);
+    }
+
+    printf("%d identifiers accepted, false accept rate %d ppm\n", s_sPlan.u32AcceptedIds,
+           CanFilter_FalseAcceptPpm(&s_sPlan));
+
+    return i32Num;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Queue a frame of an identifier                                                                          */
+/*---------------------------------------------------------------------------------------------------------*/
+int32_t Send_Next(uint32_t u32Idx)
+{
+    STR_CANMSG_T sMsg;
+    uint32_t i;
+
+    sMsg.IdType = s_asId[u32Idx].u32IdType;
+    sMsg.FrameType = CAN_DATA_FRAME;
+    sMsg.Id = s_asId[u32Idx].u32Id;
+    sMsg.DLC = s_asId[u32Idx].u8DLC;
+
+    for(i = 0; i < 4; i++)
+        sMsg.Data[i] = (uint8_t)(s_au32Sent[u32Idx] >> (i * 8));
+
+    for(i = 4; i < 8; i++)
+        sMsg.Data[i] = (uint8_t)(u32Idx + i);
+
+    if(CAN_QueueSend(&s_sQueue, &sMsg) == FALSE)
+        return FALSE;
+
+    s_au32Sent[u32Idx]++;
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Count a received frame. Only identifiers accepted by the plan may arrive.                               */
+/*---------------------------------------------------------------------------------------------------------*/
+int32_t Check_Frame(STR_CANMSG_T *pCanMsg)
+{
+    uint32_t u32Idx;
+
+    for(u32Idx = 0; u32Idx < ID_NUM; u32Idx++)
+    {
+        if((s_asId[u32Idx].u32IdType == pCanMsg->IdType) && (s_asId[u32Idx].u32Id == pCanMsg->Id))
+            break;
+    }
+
+    if((u32Idx == ID_NUM) || !CanFilter_Match(&s_sPlan, pCanMsg->IdType, pCanMsg->Id))
+    {
+        printf("Unexpected frame ID 0x%X\n", pCanMsg->Id);
+        return FALSE;
+    }
+
+    s_au32Received[u32Idx]++;
+
+    /* The transmit callback counts in the same table */
+    NVIC_DisableIRQ(CAN0_IRQn);
+    CanStats_Rx(&s_sStats, pCanMsg->IdType, pCanMsg->Id, pCanMsg->FrameType == CAN_REMOTE_FRAME, pCanMsg->DLC,
+                pCanMsg->Data, DWT->CYCCNT);
+    NVIC_EnableIRQ(CAN0_IRQn);
+
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Update the bus load and print it at the end of each window                                              */
+/*---------------------------------------------------------------------------------------------------------*/
+void Bus_Update(void)
+{
+    int32_t i32New;
+
+    NVIC_DisableIRQ(CAN0_IRQn);
+    i32New = CanStats_Bus(&s_sStats, s_sQueue.u32BusFrames, s_sQueue.u32ErrFrames, DWT->CYCCNT);
+    NVIC_EnableIRQ(CAN0_IRQn);
+
+    if(i32New)
+        printf("  bus load %d.%d%%, %d error frames/s\n", s_sStats.u32Load / 10, s_sStats.u32Load % 10,
+               s_sStats.u32ErrRate);
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Print the counters of each identifier and check them against the plan                                   */
+/*---------------------------------------------------------------------------------------------------------*/
+int32_t Print_Stats(void)
+{
+    CAN_STATS_ID_T *psEntry;
+    uint32_t i, u32Expected, u32CyclesPerUs;
+    int32_t i32Ret = TRUE;
+
+    u32CyclesPerUs = SystemCoreClock / 1000000;
+
+    printf("\n      ID    Sent  Received  Latency min/avg/max us\n");
+
+    for(i = 0; i < ID_NUM; i++)
+    {
+        printf("%8X %7d %9d", s_asId[i].u32Id, s_au32Sent[i], s_au32Received[i]);
+
+        psEntry = CanStats_Find(&s_sStats, s_asId[i].u32IdType, s_asId[i].u32Id);
+
+        if(psEntry && psEntry->u32TxCnt)
+            printf("  %d / %d / %d\n", psEntry->u32LatMin / u32CyclesPerUs,
+                   (uint32_t)(psEntry->u64LatSum / psEntry->u32TxCnt / u32CyclesPerUs),
+                   psEntry->u32LatMax / u32CyclesPerUs);
+        else
+            printf("\n");
+
+        u32Expected = CanFilter_Match(&s_sPlan, s_asId[i].u32IdType, s_asId[i].u32Id) ? s_au32Sent[i] : 0;
+
+        if((s_au32Received[i] != u32Expected) || !psEntry || (psEntry->u32TxCnt != s_au32Sent[i]))
+            i32Ret = FALSE;
+    }
+
+    printf("%d bus frames, %d error frames, %d identifiers\n", s_sStats.u32Frames, s_sStats.u32ErrFrames,
+           s_sStats.u32IdNum);
+
+    return i32Ret;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* MAIN function                                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+int main(void)
+{
+    STR_CANMSG_T sMsg;
+    uint32_t u32BitRate, u32Sent, u32Idle;
+    int32_t i32Filters;
+
+    /* Unlock protected registers */
+    SYS_UnlockReg();
+
+    /* Init System, IP clock and multi-function I/O */
+    SYS_Init();
+
+    /* Lock protected registers */
+    SYS_LockReg();
+
+    /* Init UART0 to 115200-8n1 for print message */
+    UART_Open(UART0, 115200);
+
+    /* Enable the cycle counter for the time stamps */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    printf("\n+------------------------------------------------------------------+\n");
+    printf("|             CAN Filter Plan and Bus Statistics Sample Code       |\n");
+    printf("+------------------------------------------------------------------+\n");
+
+    u32BitRate = CAN_Open(CAN0, CAN_BIT_RATE, CAN_NORMAL_MODE);
+    printf("Bit rate %d bps in loop back mode\n", u32BitRate);
+
+    /* Frames are received back internally */
+    CAN_EnterTestMode(CAN0, CAN_TEST_LBACK_Msk | CAN_TEST_SILENT_Msk);
+
+    if((i32Filters = Filter_Init()) < 0)
+        goto lexit;
+
+    CAN_QueueOpen(&s_sQueue, CAN0, 0, (uint32_t)i32Filters * FILTER_DEPTH, s_asRxRing, RX_RING_SIZE,
+                  TX_OBJ, TX_NUM, s_asTxHeap, TX_HEAP_SIZE);
+    CAN_QueueSetTxHook(&s_sQueue, Get_Time, Tx_Done, s_asTxObj);
+
+    /* The status change interrupt counts the frames and errors of the bus */
+    CAN_EnableInt(CAN0, CAN_CON_IE_Msk | CAN_CON_SIE_Msk | CAN_CON_EIE_Msk);
+
+    /* Windows of 100 ms */
+    CanStats_Init(&s_sStats, u32BitRate, SystemCoreClock, SystemCoreClock / 10, s_asIdStats, ID_STATS_SIZE,
+                  DWT->CYCCNT);
+
+    printf("Send %d frames ...\n", TEST_FRAMES);
+
+    u32Sent = 0;
+    u32Idle = 0;
+
+    /* Run until every frame is sent and nothing arrives for a while */
+    while((u32Sent < TEST_FRAMES) || CAN_QueueGetTxCount(&s_sQueue) || (u32Idle < SystemCoreClock / 100))
+    {
+        while((u32Sent < TEST_FRAMES) && Send_Next(u32Sent % ID_NUM))
+            u32Sent++;
+
+        Bus_Update();
+
+        if(CAN_QueueReceive(&s_sQueue, &sMsg) == FALSE)
+        {
+            if(++u32Idle > SystemCoreClock / 10)
+            {
+                printf("[FAIL] Timeout, %d frames sent\n", u32Sent);
+                goto lexit;
+            }
+            continue;
+        }
+
+        u32Idle = 0;
+
+        if(Check_Frame(&sMsg) == FALSE)
+            goto lexit;
+    }
+
+    if(Print_Stats())
+        printf("[OK]\n");
+    else
+        printf("[FAIL] Frames lost or wrongly filtered\n");
+
+    printf("Ring overruns %d, FIFO overwrites %d, bus-off %d\n", s_sQueue.u32RxOverrun, s_sQueue.u32RxLost,
+           s_sQueue.u32BusOff);
+
+lexit:
+
+    while(1);
+}
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
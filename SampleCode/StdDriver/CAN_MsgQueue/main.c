@@ -0,0 +1,277 @@
+/****************************************************************************
+ * @file     main.c
+ * @version  V1.00
+ * @brief
+ *           Send and receive frames through the CAN message queue at 1 Mbit/s.
+ *           The CAN runs in loop back and silent mode, so no transceiver or second board is needed.
+ *           Frames of several identifiers keep the bus busy, and each identifier is checked for lost or
+ *           reordered frames.
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ *
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include "M451Series.h"
+
+
+#define PLL_CLOCK       72000000
+#define CAN_BIT_RATE    1000000
+
+#define RX_OBJ          0       /* Objects 0 ~ 11 receive standard frames, 12 ~ 15 extended frames */
+#define RX_STD_NUM      12
+#define RX_EXT_NUM      4
+#define TX_OBJ          16
+#define TX_NUM          8
+
+#define RX_RING_SIZE    64
+#define TX_HEAP_SIZE    32
+
+#define TEST_FRAMES     20000
+#define ID_NUM          (sizeof(s_asId) / sizeof(s_asId[0]))
+
+/*---------------------------------------------------------------------------*/
+/*  Function Declare                                                         */
+/*---------------------------------------------------------------------------*/
+extern void CAN_EnterTestMode(CAN_T *tCAN, uint8_t u8TestMask);
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Define global variables and constants                                                                   */
+/*---------------------------------------------------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t u32IdType;
+    uint32_t u32Id;
+    uint8_t  u8DLC;
+} TEST_ID_T;
+
+static const TEST_ID_T s_asId[] =
+{
+    {CAN_STD_ID, 0x020,     8},
+    {CAN_STD_ID, 0x100,     8},
+    {CAN_STD_ID, 0x101,     4},
+    {CAN_STD_ID, 0x7F0,     8},
+    {CAN_EXT_ID, 0x0ABCDEF, 8},
+    {CAN_EXT_ID, 0x1234567, 6},
+};
+
+static CAN_QUEUE_T s_sQueue;
+static STR_CANMSG_T s_asRxRing[RX_RING_SIZE];
+static CAN_QTX_T s_asTxHeap[TX_HEAP_SIZE];
+
+static uint32_t s_au32TxSeq[ID_NUM];
+static uint32_t s_au32RxSeq[ID_NUM];
+
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* CAN0 interrupt handler                                                                                  */
+/*---------------------------------------------------------------------------------------------------------*/
+void CAN0_IRQHandler(void)
+{
+    uint32_t u32IIDR;
+
+    /* No message object outside the queue is used. Just clear one if it interrupts. */
+    u32IIDR = CAN_QueueIRQHandler(&s_sQueue);
+
+    if((u32IIDR != 0) && (u32IIDR <= 32))
+        CAN_CLR_INT_PENDING_BIT(CAN0, (uint8_t)(u32IIDR - 1));
+}
+
+void SYS_Init(void)
+{
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init System Clock                                                                                       */
+    /*---------------------------------------------------------------------------------------------------------*/
+
+    /* Enable HIRC clock (Internal RC 22.1184MHz) */
+    CLK_EnableXtalRC(CLK_PWRCTL_HIRCEN_Msk);
+
+    /* Wait for HIRC clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HIRCSTB_Msk);
+
+    /* Select HCLK clock source as HIRC and HCLK source divider as 1 */
+    CLK_SetHCLK(CLK_CLKSEL0_HCLKSEL_HIRC, CLK_CLKDIV0_HCLK(1));
+
+    /* Set PLL to Power-down mode and PLLSTB bit in CLK_STATUS register will be cleared by hardware.*/
+    CLK_DisablePLL();
+
+    /* Enable HXT clock (external XTAL 12MHz) */
+    CLK_EnableXtalRC(CLK_PWRCTL_HXTEN_Msk);
+
+    /* Wait for HXT clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HXTSTB_Msk);
+
+    /* Set core clock as PLL_CLOCK from PLL */
+    CLK_SetCoreClock(PLL_CLOCK);
+
+    /* Enable UART module clock */
+    CLK_EnableModuleClock(UART0_MODULE);
+
+    /* Select UART module clock source as HXT and UART module clock divider as 1 */
+    CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL1_UARTSEL_HXT, CLK_CLKDIV0_UART(1));
+
+    /* Enable CAN module clock */
+    CLK_EnableModuleClock(CAN0_MODULE);
+
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init I/O Multi-function                                                                                 */
+    /*---------------------------------------------------------------------------------------------------------*/
+
+    /* Set PD multi-function pins for UART0 RXD and TXD */
+    SYS->GPD_MFPL &= ~(SYS_GPD_MFPL_PD0MFP_Msk | SYS_GPD_MFPL_PD1MFP_Msk);
+    SYS->GPD_MFPL |= (SYS_GPD_MFPL_PD0MFP_UART0_RXD | SYS_GPD_MFPL_PD1MFP_UART0_TXD);
+
+    /* Set PA multi-function pins for CANTX0 and CANRX0 */
+    SYS->GPA_MFPL &= ~(SYS_GPA_MFPL_PA0MFP_Msk | SYS_GPA_MFPL_PA1MFP_Msk);
+    SYS->GPA_MFPL |= (SYS_GPA_MFPL_PA1MFP_CAN0_TXD | SYS_GPA_MFPL_PA0MFP_CAN0_RXD);
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Queue the next frame of an identifier. The first 4 data bytes carry its sequence number.                */
+/*---------------------------------------------------------------------------------------------------------*/
+int32_t Send_Next(uint32_t u32Idx)
+{
+    STR_CANMSG_T sMsg;
+    uint32_t i;
+
+    sMsg.IdType = s_asId[u32Idx].u32IdType;
+    sMsg.FrameType = CAN_DATA_FRAME;
+    sMsg.Id = s_asId[u32Idx].u32Id;
+    sMsg.DLC = s_asId[u32Idx].u8DLC;
+
+    for(i = 0; i < 4; i++)
+        sMsg.Data[i] = (uint8_t)(s_au32TxSeq[u32Idx] >> (i * 8));
+
+    for(i = 4; i < 8; i++)
+        sMsg.Data[i] = (uint8_t)(u32Idx + i);
+
+    if(CAN_QueueSend(&s_sQueue, &sMsg) == FALSE)
+        return FALSE;
+
+    s_au32TxSeq[u32Idx]++;
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Check a received frame against the next sequence number of its identifier                               */
+/*---------------------------------------------------------------------------------------------------------*/
+int32_t Check_Frame(STR_CANMSG_T *pCanMsg, uint32_t *pu32Bits)
+{
+    uint32_t u32Idx, u32Seq;
+
+    for(u32Idx = 0; u32Idx < ID_NUM; u32Idx++)
+    {
+        if((s_asId[u32Idx].u32IdType == pCanMsg->IdType) && (s_asId[u32Idx].u32Id == pCanMsg->Id))
+            break;
+    }
+
+    if((u32Idx == ID_NUM) || (pCanMsg->DLC != s_asId[u32Idx].u8DLC))
+    {
+        printf("Unknown frame ID 0x%X DLC %d\n", pCanMsg->Id, pCanMsg->DLC);
+        return FALSE;
+    }
+
+    u32Seq = pCanMsg->Data[0] | (pCanMsg->Data[1] << 8) | (pCanMsg->Data[2] << 16) | ((uint32_t)pCanMsg->Data[3] << 24);
+
+    if(u32Seq != s_au32RxSeq[u32Idx])
+    {
+        printf("ID 0x%X: frame %d received, %d expected\n", pCanMsg->Id, u32Seq, s_au32RxSeq[u32Idx]);
+        return FALSE;
+    }
+
+    s_au32RxSeq[u32Idx]++;
+
+    /* Frame bits without stuff bits, including the intermission */
+    *pu32Bits += ((pCanMsg->IdType == CAN_STD_ID) ? 47 : 67) + pCanMsg->DLC * 8;
+
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* MAIN function                                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+int main(void)
+{
+    STR_CANMSG_T sMsg;
+    uint32_t u32BitRate, u32Sent, u32Received, u32Bits, u32Start, u32Cycles, u32Idle, u32BitsPerSec;
+
+    /* Unlock protected registers */
+    SYS_UnlockReg();
+
+    /* Init System, IP clock and multi-function I/O */
+    SYS_Init();
+
+    /* Lock protected registers */
+    SYS_LockReg();
+
+    /* Init UART0 to 115200-8n1 for print message */
+    UART_Open(UART0, 115200);
+
+    /* Enable the cycle counter for the measurements */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    printf("\n+------------------------------------------------------------------+\n");
+    printf("|                   CAN Message Queue Sample Code                  |\n");
+    printf("+------------------------------------------------------------------+\n");
+
+    u32BitRate = CAN_Open(CAN0, CAN_BIT_RATE, CAN_NORMAL_MODE);
+    printf("Bit rate %d bps in loop back mode\n", u32BitRate);
+
+    /* Frames are received back internally */
+    CAN_EnterTestMode(CAN0, CAN_TEST_LBACK_Msk | CAN_TEST_SILENT_Msk);
+
+    /* Receive FIFOs of all standard and all extended frames */
+    CAN_SetMultiRxMsgAndMsk(CAN0, RX_OBJ, RX_STD_NUM, CAN_STD_ID, 0, 0);
+    CAN_SetMultiRxMsgAndMsk(CAN0, RX_OBJ + RX_STD_NUM, RX_EXT_NUM, CAN_EXT_ID, 0, 0);
+
+    CAN_QueueOpen(&s_sQueue, CAN0, RX_OBJ, RX_STD_NUM + RX_EXT_NUM, s_asRxRing, RX_RING_SIZE,
+                  TX_OBJ, TX_NUM, s_asTxHeap, TX_HEAP_SIZE);
+
+    printf("Send %d frames ...", TEST_FRAMES);
+
+    u32Sent = 0;
+    u32Received = 0;
+    u32Bits = 0;
+    u32Idle = 0;
+    u32Start = DWT->CYCCNT;
+
+    while(u32Received < TEST_FRAMES)
+    {
+        /* Keep the transmit queue full. The identifiers take turns. */
+        while((u32Sent < TEST_FRAMES) && Send_Next(u32Sent % ID_NUM))
+            u32Sent++;
+
+        if(CAN_QueueReceive(&s_sQueue, &sMsg) == FALSE)
+        {
+            if(++u32Idle > SystemCoreClock / 10)
+            {
+                printf("[FAIL] Timeout, %d frames sent and %d received\n", u32Sent, u32Received);
+                goto lexit;
+            }
+            continue;
+        }
+
+        u32Idle = 0;
+
+        if(Check_Frame(&sMsg, &u32Bits) == FALSE)
+            goto lexit;
+
+        u32Received++;
+    }
+
+    u32Cycles = DWT->CYCCNT - u32Start;
+    u32BitsPerSec = (uint32_t)((uint64_t)u32Bits * SystemCoreClock / u32Cycles);
+
+    printf("[OK]\n");
+    printf("%d frames/s, bus load %d%% without stuff bits\n",
+           (uint32_t)((uint64_t)TEST_FRAMES * SystemCoreClock / u32Cycles), u32BitsPerSec / (u32BitRate / 100));
+    printf("Ring overruns %d, FIFO overwrites %d, bus-off %d\n", s_sQueue.u32RxOverrun, s_sQueue.u32RxLost,
+           s_sQueue.u32BusOff);
+
+lexit:
+
+    while(1);
+}
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
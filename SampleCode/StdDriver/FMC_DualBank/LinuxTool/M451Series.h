@@ -0,0 +1,34 @@
+/**************************************************************************//**
+ * @file     M451Series.h
+ * @version  V1.00
+ * @brief    Flash model standing in for the device header when dual_bank.c is built on a Linux host
+ *
+ * @note
+ *           Only used by db_sim.c. It is found before the device header, so dual_bank.c calls the flash
+ *           model instead of the FMC driver. The model is 256 KB of APROM in which programming can only
+ *           clear bits. db_sim.c implements the functions and injects the power losses.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __M451SERIES_H__
+#define __M451SERIES_H__
+
+#include <stdint.h>
+
+#define FMC_FLASH_PAGE_SIZE     0x800
+#define FMC_APROM_SIZE          0x40000
+#define FMC_LDROM_BASE          0x00100000UL
+#define SRAM_BASE               0x20000000UL
+
+extern int32_t g_FMC_i32ErrCode;
+
+uint32_t FMC_Read(uint32_t u32Addr);
+void FMC_Write(uint32_t u32Addr, uint32_t u32Data);
+int32_t FMC_Erase(uint32_t u32PageAddr);
+uint32_t FMC_GetCheckSum(uint32_t u32Addr, int32_t i32Size);
+uint32_t FMC_GetVECMAP(void);
+int32_t FMC_SetVectorPageAddr(uint32_t u32PageAddr);
+void SYS_ResetCPU(void);
+
+#endif  /* __M451SERIES_H__ */
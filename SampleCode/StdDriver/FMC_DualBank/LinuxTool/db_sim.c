@@ -0,0 +1,426 @@
+/**************************************************************************//**
+ * @file     db_sim.c
+ * @version  V1.00
+ * @brief    Linux test of the A/B bank manager against a simulated APROM
+ *
+ * @note
+ *           Build : gcc -O2 -Wall -Wextra -I. -I.. -o db_sim db_sim.c ../dual_bank.c
+ *           Usage : db_sim [random seed]
+ *
+ *           M451Series.h of this directory replaces the device header, so dual_bank.c programs a flash
+ *           model in which programming can only clear bits. The boot manager of boot_main.c is modelled
+ *           by Boot(). The first test runs 300 update cycles with trial boots, resets during the trial,
+ *           rollbacks, cancelled updates and damaged images, enough records to compact the control pages
+ *           many times. The second test appends 600 records and cuts the power after every flash
+ *           operation of each append, one run per operation, including the erase and the record copies of
+ *           a compaction. After each power loss the state loaded by DB_Init() must be the state before or
+ *           after the append, and no confirmed record may be lost. A word or a page erase is taken as
+ *           done completely or not at all.
+ *           The exit code is 0 if all tests pass.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "M451Series.h"
+#include "dual_bank.h"
+
+#define CYCLE_NUM       300
+#define APPEND_NUM      600
+
+int32_t g_FMC_i32ErrCode;
+
+static uint8_t s_au8Flash[FMC_APROM_SIZE];
+static uint8_t s_au8Snap[FMC_APROM_SIZE];
+static uint32_t s_u32VecMap;
+static int32_t s_i32PowerLeft = -1;     /* Flash operations done before the power loss. -1 for no loss. */
+static uint32_t s_u32PowerLost;
+static uint32_t s_u32CtrlErases;
+static uint32_t s_u32Fail;
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Flash model                                                                                             */
+/*---------------------------------------------------------------------------------------------------------*/
+/* Returns 0 if the power is lost before the operation */
+static uint32_t PowerOn(void)
+{
+    if(s_u32PowerLost)
+        return 0;
+
+    if(s_i32PowerLeft == 0)
+    {
+        s_u32PowerLost = 1;
+        return 0;
+    }
+
+    if(s_i32PowerLeft > 0)
+        s_i32PowerLeft--;
+
+    return 1;
+}
+
+static void PowerRestore(void)
+{
+    s_i32PowerLeft = -1;
+    s_u32PowerLost = 0;
+}
+
+uint32_t FMC_Read(uint32_t u32Addr)
+{
+    uint32_t u32Data;
+
+    if((u32Addr & 3) || (u32Addr >= FMC_APROM_SIZE))
+    {
+        printf("  FAIL: read of 0x%X\n", u32Addr);
+        s_u32Fail++;
+        return 0xFFFFFFFF;
+    }
+
+    memcpy(&u32Data, &s_au8Flash[u32Addr], 4);
+    return u32Data;
+}
+
+void FMC_Write(uint32_t u32Addr, uint32_t u32Data)
+{
+    uint32_t u32Old;
+
+    if((u32Addr & 3) || (u32Addr >= FMC_APROM_SIZE))
+    {
+        printf("  FAIL: write of 0x%X\n", u32Addr);
+        s_u32Fail++;
+        return;
+    }
+
+    if(!PowerOn())
+        return;
+
+    u32Old = FMC_Read(u32Addr);
+
+    if(u32Old != 0xFFFFFFFF)
+    {
+        printf("  FAIL: word 0x%X programmed twice\n", u32Addr);
+        s_u32Fail++;
+    }
+
+    u32Old &= u32Data;
+    memcpy(&s_au8Flash[u32Addr], &u32Old, 4);
+}
+
+int32_t FMC_Erase(uint32_t u32PageAddr)
+{
+    if((u32PageAddr & (FMC_FLASH_PAGE_SIZE - 1)) || (u32PageAddr >= FMC_APROM_SIZE))
+        return -1;
+
+    if(!PowerOn())
+        return 0;
+
+    if((u32PageAddr >= DB_CTRL_BASE) && (u32PageAddr < DB_SLOT_A_BASE))
+        s_u32CtrlErases++;
+
+    memset(&s_au8Flash[u32PageAddr], 0xFF, FMC_FLASH_PAGE_SIZE);
+    return 0;
+}
+
+/* CRC32 like the ISP checksum command */
+uint32_t FMC_GetCheckSum(uint32_t u32Addr, int32_t i32Size)
+{
+    uint32_t u32Crc = 0xFFFFFFFF, i, j;
+
+    g_FMC_i32ErrCode = 0;
+
+    if((u32Addr & (FMC_FLASH_PAGE_SIZE - 1)) || (i32Size <= 0) || (i32Size & (FMC_FLASH_PAGE_SIZE - 1)) ||
+            (u32Addr + (uint32_t)i32Size > FMC_APROM_SIZE))
+    {
+        g_FMC_i32ErrCode = -1;
+        return 0xFFFFFFFF;
+    }
+
+    for(i = 0; i < (uint32_t)i32Size; i++)
+    {
+        u32Crc ^= s_au8Flash[u32Addr + i];
+
+        for(j = 0; j < 8; j++)
+            u32Crc = (u32Crc >> 1) ^ ((u32Crc & 1) ? 0xEDB88320UL : 0);
+    }
+
+    return ~u32Crc;
+}
+
+uint32_t FMC_GetVECMAP(void)
+{
+    return s_u32VecMap;
+}
+
+int32_t FMC_SetVectorPageAddr(uint32_t u32PageAddr)
+{
+    s_u32VecMap = u32PageAddr;
+    return 0;
+}
+
+void SYS_ResetCPU(void)
+{
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Boot manager and application                                                                            */
+/*---------------------------------------------------------------------------------------------------------*/
+static void Check(int32_t i32Ok, const char *pcWhat, uint32_t u32Step)
+{
+    if(!i32Ok)
+    {
+        printf("  FAIL: %s at step %u\n", pcWhat, u32Step);
+        s_u32Fail++;
+    }
+}
+
+/* Decision of boot_main.c. Returns the page mapped to the vector page. */
+static uint32_t Boot(void)
+{
+    DB_REC_T sRec, sConfirmed;
+    uint32_t i;
+
+    DB_Init();
+
+    if(DB_GetLatest(&sRec) < 0)
+        return (FMC_Read(DB_SLOT_A_BASE) != 0xFFFFFFFF) ? DB_SLOT_A_BASE : FMC_LDROM_BASE;
+
+    if((sRec.u32Type == DB_REC_PENDING) && (DB_VerifySlot(&sRec) == 0) && (DB_Append(DB_REC_TRIAL, &sRec) == 0))
+        return DB_GetSlotBase(sRec.u32Slot);
+
+    if((sRec.u32Type == DB_REC_CONFIRMED) && (DB_VerifySlot(&sRec) == 0))
+        return DB_GetSlotBase(sRec.u32Slot);
+
+    for(i = 0; i < DB_SLOT_NUM; i++)
+    {
+        if((i != sRec.u32Slot) && (DB_GetConfirmed(i, &sConfirmed) == 0) && (DB_VerifySlot(&sConfirmed) == 0))
+        {
+            DB_Append(DB_REC_CONFIRMED, &sConfirmed);
+            return DB_GetSlotBase(i);
+        }
+    }
+
+    return FMC_LDROM_BASE;
+}
+
+/* Reset, run the boot manager and start the selected image. Returns its slot. */
+static uint32_t Reset(void)
+{
+    s_u32VecMap = Boot();
+    DB_Init();
+    return DB_GetRunningSlot();
+}
+
+/* Vector table and body of an image linked at the slot */
+static void MakeImage(uint8_t *pu8Img, uint32_t u32Slot, uint32_t u32Size, uint32_t u32Seed)
+{
+    uint32_t u32Sp = SRAM_BASE + 0x4000, u32Pc = DB_GetSlotBase(u32Slot) + 0x101, i;
+
+    for(i = 8; i < u32Size; i++)
+        pu8Img[i] = (uint8_t)(i * u32Seed + (i >> 8));
+
+    memcpy(pu8Img, &u32Sp, 4);
+    memcpy(pu8Img + 4, &u32Pc, 4);
+}
+
+/* Send an image to the other slot in random parts. Returns 0 if it is installed. */
+static int32_t Install(uint32_t u32Size, uint32_t u32Seed, uint32_t u32Cancel)
+{
+    static uint8_t au8Img[DB_SLOT_SIZE];
+    uint32_t u32Slot = (DB_GetRunningSlot() + 1) % DB_SLOT_NUM, u32Done, u32Len;
+
+    MakeImage(au8Img, u32Slot, u32Size, u32Seed);
+
+    if(DB_BeginUpdate(u32Size) < 0)
+        return -1;
+
+    for(u32Done = 0; u32Done < u32Size; u32Done += u32Len)
+    {
+        u32Len = 1 + rand() % 64;
+
+        if(u32Len > u32Size - u32Done)
+            u32Len = u32Size - u32Done;
+
+        /* Reset in the middle of the transfer */
+        if(u32Cancel && (u32Done > u32Size / 2))
+            return -1;
+
+        if(DB_Write(&au8Img[u32Done], u32Len) < 0)
+            return -1;
+    }
+
+    if(DB_EndUpdate() < 0)
+        return -1;
+
+    return (memcmp(&s_au8Flash[DB_GetSlotBase(u32Slot)], au8Img, u32Size) == 0) ? 0 : -1;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Tests                                                                                                   */
+/*---------------------------------------------------------------------------------------------------------*/
+static void TestCycles(void)
+{
+    static uint8_t au8Img[4096];
+    uint32_t u32Slot, u32New, k;
+    DB_REC_T sRec;
+
+    printf("Update cycles\n");
+    memset(s_au8Flash, 0xFF, sizeof(s_au8Flash));
+    s_u32CtrlErases = 0;
+
+    Check(Reset() == DB_SLOT_NONE, "boot of empty flash", 0);
+    Check(s_u32VecMap == FMC_LDROM_BASE, "empty flash starts ISP", 0);
+
+    /* Image written by a programmer confirms itself */
+    MakeImage(au8Img, 0, sizeof(au8Img), 1);
+    memcpy(&s_au8Flash[DB_SLOT_A_BASE], au8Img, sizeof(au8Img));
+    u32Slot = Reset();
+    Check(u32Slot == 0, "programmed image boots", 0);
+    Check(DB_Confirm() == 0, "programmed image confirms", 0);
+
+    for(k = 0; k < CYCLE_NUM; k++)
+    {
+        u32New = (u32Slot + 1) % DB_SLOT_NUM;
+
+        /* Transfer cut by a reset. The running image must boot again. */
+        if((k % 11) == 5)
+        {
+            Check(Install(3000 + k, k, 1) < 0, "cancelled install", k);
+            Check(Reset() == u32Slot, "boot after cancelled install", k);
+        }
+
+        Check(Install(1000 + (k * 131) % 60000, k + 3, 0) == 0, "install", k);
+
+        /* Image damaged before its first boot. The boot manager keeps the running image. */
+        if((k % 13) == 6)
+        {
+            s_au8Flash[DB_GetSlotBase(u32New) + 200] ^= 0x10;
+            Check(Reset() == u32Slot, "damaged image not booted", k);
+            Check(DB_Confirm() == 0, "confirm after damaged image", k);
+            continue;
+        }
+
+        Check(Reset() == u32New, "trial boot", k);
+        Check((DB_GetLatest(&sRec) == 0) && (sRec.u32Type == DB_REC_TRIAL), "trial record", k);
+        Check(DB_BeginUpdate(100) < 0, "no update before confirm", k);
+
+        /* Reset before the new image confirms itself. The old image boots again. */
+        if((k % 5) == 4)
+        {
+            Check(Reset() == u32Slot, "rollback after trial reset", k);
+            Check(DB_Confirm() == 0, "confirm after rollback", k);
+            continue;
+        }
+
+        Check(DB_Confirm() == 0, "confirm", k);
+        u32Slot = u32New;
+        Check(Reset() == u32Slot, "boot of confirmed image", k);
+
+        if((k % 7) == 3)
+        {
+            Check(DB_Rollback() == 0, "rollback", k);
+            u32Slot = Reset();
+            Check(u32Slot == (u32New + 1) % DB_SLOT_NUM, "boot after rollback", k);
+            Check(DB_Confirm() == 0, "confirm after rollback", k);
+        }
+    }
+
+    printf("  %u cycles, %u control page erases\n", CYCLE_NUM, s_u32CtrlErases);
+    Check(s_u32CtrlErases >= 4, "control pages compacted", k);
+}
+
+static int32_t RecEqual(DB_REC_T *psA, DB_REC_T *psB)
+{
+    return (psA->u32Type == psB->u32Type) && (psA->u32Slot == psB->u32Slot) && (psA->u32Seq == psB->u32Seq) &&
+           (psA->u32Size == psB->u32Size) && (psA->u32CheckSum == psB->u32CheckSum);
+}
+
+static void TestPowerLoss(void)
+{
+    DB_REC_T sRec, sOld, sNew, sCur, asConfirmed[DB_SLOT_NUM];
+    uint32_t u32Type, u32Losses = 0, k, i;
+    int32_t i32Ops, i32Ok;
+
+    printf("Power loss during appends\n");
+    memset(s_au8Flash, 0xFF, sizeof(s_au8Flash));
+    s_u32CtrlErases = 0;
+    DB_Init();
+
+    for(i = 0; i < DB_SLOT_NUM; i++)
+    {
+        sRec.u32Slot = i;
+        sRec.u32Size = 0x100;
+        sRec.u32CheckSum = 0x5A000000 + i;
+        Check(DB_Append(DB_REC_CONFIRMED, &sRec) == 0, "first records", i);
+    }
+
+    for(k = 0; k < APPEND_NUM; k++)
+    {
+        u32Type = ((k % 3) == 0) ? DB_REC_CONFIRMED : (((k % 3) == 1) ? DB_REC_PENDING : DB_REC_TRIAL);
+        sRec.u32Slot = (k / 3) % DB_SLOT_NUM;
+        sRec.u32Size = 0x200 + k;
+        sRec.u32CheckSum = k;
+
+        DB_Init();
+        DB_GetLatest(&sOld);
+
+        for(i = 0; i < DB_SLOT_NUM; i++)
+            DB_GetConfirmed(i, &asConfirmed[i]);
+
+        sNew = sRec;
+        sNew.u32Type = u32Type;
+        sNew.u32Seq = sOld.u32Seq + 1;
+        memcpy(s_au8Snap, s_au8Flash, sizeof(s_au8Flash));
+
+        /* Cut the power before each flash operation in turn until the append completes */
+        for(i32Ops = 0; ; i32Ops++)
+        {
+            memcpy(s_au8Flash, s_au8Snap, sizeof(s_au8Flash));
+            DB_Init();
+            s_i32PowerLeft = i32Ops;
+            DB_Append(u32Type, &sRec);
+            i32Ok = !s_u32PowerLost;
+            PowerRestore();
+
+            if(i32Ok)
+                break;
+
+            u32Losses++;
+            DB_Init();
+            Check((DB_GetLatest(&sCur) == 0) && (RecEqual(&sCur, &sOld) || RecEqual(&sCur, &sNew)),
+                  "newest record after power loss", k);
+
+            for(i = 0; i < DB_SLOT_NUM; i++)
+            {
+                Check((DB_GetConfirmed(i, &sCur) == 0) && (RecEqual(&sCur, &asConfirmed[i]) ||
+                        ((u32Type == DB_REC_CONFIRMED) && (i == sRec.u32Slot) && RecEqual(&sCur, &sNew))),
+                      "confirmed record after power loss", k);
+            }
+
+            /* The next append after the power loss must work */
+            Check(DB_Append(DB_REC_PENDING, &sRec) == 0, "append after power loss", k);
+        }
+
+        memcpy(s_au8Flash, s_au8Snap, sizeof(s_au8Flash));
+        DB_Init();
+        Check(DB_Append(u32Type, &sRec) == 0, "append", k);
+        DB_Init();
+        Check((DB_GetLatest(&sCur) == 0) && RecEqual(&sCur, &sNew), "newest record", k);
+    }
+
+    printf("  %u appends, %u power losses, %u control page erases\n", APPEND_NUM, u32Losses, s_u32CtrlErases);
+}
+
+int main(int argc, char **argv)
+{
+    srand((argc > 1) ? strtoul(argv[1], NULL, 0) : 1);
+
+    TestCycles();
+    TestPowerLoss();
+
+    printf("%s\n", s_u32Fail ? "FAIL" : "PASS");
+
+    return s_u32Fail ? 1 : 0;
+}
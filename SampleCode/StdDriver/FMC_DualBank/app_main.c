@@ -0,0 +1,268 @@
+/**************************************************************************//**
+ * @file     app_main.c
+ * @version  V1.00
+ * @brief
+ *           Application of the A/B firmware sample. The same source is linked at slot A (0x2000) and at
+ *           slot B (0x21000). It confirms itself after start-up, receives a new image for the other slot
+ *           over UART0 while it keeps running and switches to it with one CPU reset.
+ *
+ *           Update protocol on UART0 (115200 8N1) after key 'u':
+ *             Host sends the image size as 4 bytes little endian and waits for "READY".
+ *             Host sends the image linked for the slot which is printed by the application.
+ *             The application prints "DONE" or "FAIL".
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include "M451Series.h"
+#include "dual_bank.h"
+
+#define PLL_CLOCK           72000000
+
+#define RX_BUF_SIZE         1024        /* Holds the data received while a word is programmed */
+#define RX_TIMEOUT_MS       3000
+
+static volatile uint8_t s_au8RxBuf[RX_BUF_SIZE];
+static volatile uint32_t s_u32RxHead, s_u32RxTail;
+static volatile uint32_t s_u32RxOverflow;
+static uint32_t s_u32WorkCount;
+
+
+void SYS_Init(void)
+{
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init System Clock                                                                                       */
+    /*---------------------------------------------------------------------------------------------------------*/
+
+    /* Enable Internal RC 22.1184MHz clock */
+    CLK_EnableXtalRC(CLK_PWRCTL_HIRCEN_Msk);
+
+    /* Waiting for Internal RC clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HIRCSTB_Msk);
+
+    /* Switch HCLK clock source to Internal RC and HCLK source divide 1 */
+    CLK_SetHCLK(CLK_CLKSEL0_HCLKSEL_HIRC, CLK_CLKDIV0_HCLK(1));
+
+    /* Enable external XTAL 12MHz clock */
+    CLK_EnableXtalRC(CLK_PWRCTL_HXTEN_Msk);
+
+    /* Waiting for external XTAL clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HXTSTB_Msk);
+
+    /* Set core clock as PLL_CLOCK from PLL */
+    CLK_SetCoreClock(PLL_CLOCK);
+
+    /* Enable UART module clock */
+    CLK_EnableModuleClock(UART0_MODULE);
+
+    /* Select UART module clock source */
+    CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL1_UARTSEL_HXT, CLK_CLKDIV0_UART(1));
+
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init I/O Multi-function                                                                                 */
+    /*---------------------------------------------------------------------------------------------------------*/
+
+    /* Set PD multi-function pins for UART0 RXD and TXD */
+    SYS->GPD_MFPL &= ~(SYS_GPD_MFPL_PD0MFP_Msk | SYS_GPD_MFPL_PD1MFP_Msk);
+    SYS->GPD_MFPL |= (SYS_GPD_MFPL_PD0MFP_UART0_RXD | SYS_GPD_MFPL_PD1MFP_UART0_TXD);
+}
+
+void UART0_IRQHandler(void)
+{
+    uint32_t u32Next;
+
+    while(!UART_GET_RX_EMPTY(UART0))
+    {
+        u32Next = (s_u32RxHead + 1) % RX_BUF_SIZE;
+
+        if(u32Next == s_u32RxTail)
+        {
+            s_u32RxOverflow = 1;
+            UART0->DAT;
+            continue;
+        }
+
+        s_au8RxBuf[s_u32RxHead] = UART0->DAT;
+        s_u32RxHead = u32Next;
+    }
+}
+
+/* Get a received byte. Returns -1 if nothing arrives within the timeout. */
+static int32_t RxByte(uint32_t u32TimeoutMs)
+{
+    int32_t i32Data;
+
+    while(s_u32RxHead == s_u32RxTail)
+    {
+        if(u32TimeoutMs-- == 0)
+            return -1;
+
+        CLK_SysTickDelay(1000);
+    }
+
+    i32Data = s_au8RxBuf[s_u32RxTail];
+    s_u32RxTail = (s_u32RxTail + 1) % RX_BUF_SIZE;
+    return i32Data;
+}
+
+/* The work of the application. It keeps running while an update is received. */
+static void AppTask(void)
+{
+    s_u32WorkCount++;
+}
+
+static void ShowStatus(void)
+{
+    uint32_t u32Slot = DB_GetRunningSlot(), i;
+    char *acType[] = {"-", "PENDING", "TRIAL", "CONFIRMED"};
+    DB_REC_T sRec;
+
+    printf("\nRunning slot %c at 0x%05X, work count %u\n", (u32Slot == 0) ? 'A' : 'B', FMC_GetVECMAP(), s_u32WorkCount);
+
+    if(DB_GetLatest(&sRec) == 0)
+        printf("Latest record: #%u %s slot %c, %u bytes, checksum 0x%08X\n", sRec.u32Seq, acType[sRec.u32Type],
+               'A' + sRec.u32Slot, sRec.u32Size, sRec.u32CheckSum);
+
+    for(i = 0; i < DB_SLOT_NUM; i++)
+    {
+        if(DB_GetConfirmed(i, &sRec) == 0)
+            printf("Slot %c confirmed: #%u, %u bytes, %s\n", 'A' + i, sRec.u32Seq, sRec.u32Size,
+                   (DB_VerifySlot(&sRec) == 0) ? "valid" : "damaged");
+        else
+            printf("Slot %c confirmed: none\n", 'A' + i);
+    }
+}
+
+static void Update(void)
+{
+    uint8_t au8Buf[64];
+    uint32_t u32Size = 0, u32Done, u32Len, i;
+    int32_t i32Data;
+
+    printf("Send the image linked at 0x%05X: 4-byte size, then the image after READY\n",
+           DB_GetSlotBase((DB_GetRunningSlot() + 1) % DB_SLOT_NUM));
+
+    for(i = 0; i < 4; i++)
+    {
+        if((i32Data = RxByte(RX_TIMEOUT_MS * 10)) < 0)
+            goto fail;
+
+        u32Size |= (uint32_t)i32Data << (i * 8);
+    }
+
+    /* Erase before the host starts sending. The CPU stalls during page erase and would lose UART data. */
+    if(DB_BeginUpdate(u32Size) < 0)
+        goto fail;
+
+    s_u32RxOverflow = 0;
+    printf("READY\n");
+
+    for(u32Done = 0; u32Done < u32Size; u32Done += u32Len)
+    {
+        for(u32Len = 0; (u32Len < sizeof(au8Buf)) && (u32Done + u32Len < u32Size); u32Len++)
+        {
+            if((i32Data = RxByte(RX_TIMEOUT_MS)) < 0)
+                goto fail;
+
+            au8Buf[u32Len] = (uint8_t)i32Data;
+        }
+
+        if(DB_Write(au8Buf, u32Len) < 0)
+            goto fail;
+
+        AppTask();
+    }
+
+    if(s_u32RxOverflow || (DB_EndUpdate() < 0))
+        goto fail;
+
+    printf("DONE. Press 'b' to boot the new image.\n");
+    return;
+
+fail:
+    printf("FAIL\n");
+}
+
+int main()
+{
+    int32_t i32Key;
+
+    /* Unlock protected registers */
+    SYS_UnlockReg();
+
+    /* Init system clock and multi-function I/O */
+    SYS_Init();
+
+    /* Init UART0 for printf and the image transfer */
+    UART_Open(UART0, 115200);
+    UART_EnableInt(UART0, UART_INTEN_RDAIEN_Msk);
+
+    /* Enable FMC ISP and APROM update */
+    FMC_Open();
+    FMC_ENABLE_AP_UPDATE();
+
+    printf("\n\n");
+    printf("+--------------------------------------------------------+\n");
+    printf("|    M451 A/B Firmware Update Sample Code                |\n");
+    printf("+--------------------------------------------------------+\n");
+
+    DB_Init();
+
+    if(DB_GetRunningSlot() == DB_SLOT_NONE)
+    {
+        printf("Not started by the boot manager. VECMAP = 0x%x\n", FMC_GetVECMAP());
+
+        while(1);
+    }
+
+    /* Self-test passed. Without this the boot manager rolls back at the next reset. */
+    printf("Confirm running image ... %s\n", (DB_Confirm() == 0) ? "OK" : "failed");
+
+    ShowStatus();
+
+    while(1)
+    {
+        printf("\n[u] Update other slot  [b] Boot latest image  [r] Roll back  [s] Status\n");
+
+        do
+        {
+            AppTask();
+            i32Key = RxByte(0);
+        }
+        while(i32Key < 0);
+
+        switch(i32Key)
+        {
+            case 'u':
+                Update();
+                break;
+
+            case 'b':
+                printf("Reboot ...\n");
+                UART_WAIT_TX_EMPTY(UART0);
+                DB_Reboot();
+                break;
+
+            case 'r':
+                if(DB_Rollback() == 0)
+                {
+                    printf("Roll back to the other slot ...\n");
+                    UART_WAIT_TX_EMPTY(UART0);
+                    DB_Reboot();
+                }
+
+                printf("The other slot has no valid confirmed image\n");
+                break;
+
+            case 's':
+                ShowStatus();
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
@@ -0,0 +1,121 @@
+/**************************************************************************//**
+ * @file     boot_main.c
+ * @version  V1.00
+ * @brief
+ *           Boot manager of the A/B firmware sample. It is placed at APROM address 0 and selects the slot
+ *           to boot from the bank control records:
+ *             PENDING   - check the new image, record the trial boot and boot it.
+ *             TRIAL     - the new image reset before it confirmed itself. Boot the confirmed image again.
+ *             CONFIRMED - check the image and boot it.
+ *           A slot which fails its hardware checksum is never booted. If no slot is bootable, the LDROM
+ *           ISP loader is started.
+ *
+ *           The boot manager uses no clock setup and no UART, so it adds only the checksum time and one
+ *           CPU reset to the boot time.
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include "M451Series.h"
+#include "dual_bank.h"
+
+
+/* Map the page to the vector page and restart the CPU from it */
+static void BootPage(uint32_t u32Page)
+{
+    FMC_SetVectorPageAddr(u32Page);
+    SYS_ResetCPU();
+
+    while(1);
+}
+
+/* Boot the confirmed image of the other slot */
+static void Rollback(uint32_t u32FailedSlot)
+{
+    DB_REC_T sRec;
+    uint32_t i;
+
+    for(i = 0; i < DB_SLOT_NUM; i++)
+    {
+        if((i != u32FailedSlot) && (DB_GetConfirmed(i, &sRec) == 0) && (DB_VerifySlot(&sRec) == 0))
+        {
+            /* The old image becomes the newest record, so the failed image is not tried again */
+            DB_Append(DB_REC_CONFIRMED, &sRec);
+            BootPage(DB_GetSlotBase(i));
+        }
+    }
+
+    /* Nothing to boot. Let the ISP loader receive a new image. */
+    BootPage(FMC_LDROM_BASE);
+}
+
+/* VECMAP needs new IAP mode. Set CBS to 10'b once. */
+static void SetIAPBoot(void)
+{
+    uint32_t au32Config[2];
+
+    FMC_ReadConfig(au32Config, 2);
+
+    if((au32Config[0] & 0xC0) != 0x80)
+    {
+        FMC_ENABLE_CFG_UPDATE();
+        au32Config[0] = (au32Config[0] & ~0xC0UL) | 0x80;
+        FMC_Erase(FMC_CONFIG_BASE);
+        FMC_WriteConfig(au32Config, 2);
+
+        /* Perform chip reset to make new User Config take effect */
+        SYS_ResetChip();
+
+        while(1);
+    }
+}
+
+int main()
+{
+    DB_REC_T sRec;
+
+    /* Unlock protected registers */
+    SYS_UnlockReg();
+
+    /* Enable FMC ISP and APROM update for the bank control records */
+    FMC_Open();
+    FMC_ENABLE_AP_UPDATE();
+
+    SetIAPBoot();
+
+    DB_Init();
+
+    if(DB_GetLatest(&sRec) < 0)
+    {
+        /* Image programmed by a programmer. It confirms itself with the checksum of the whole slot. */
+        if(FMC_Read(DB_SLOT_A_BASE) != 0xFFFFFFFF)
+            BootPage(DB_SLOT_A_BASE);
+
+        BootPage(FMC_LDROM_BASE);
+    }
+
+    switch(sRec.u32Type)
+    {
+        case DB_REC_PENDING:
+            if((DB_VerifySlot(&sRec) == 0) && (DB_Append(DB_REC_TRIAL, &sRec) == 0))
+                BootPage(DB_GetSlotBase(sRec.u32Slot));
+
+            break;
+
+        case DB_REC_CONFIRMED:
+            if(DB_VerifySlot(&sRec) == 0)
+                BootPage(DB_GetSlotBase(sRec.u32Slot));
+
+            break;
+
+        default:
+            break;
+    }
+
+    Rollback(sRec.u32Slot);
+
+    while(1);
+}
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
@@ -0,0 +1,493 @@
+/******************************************************************************
+ * @file     dual_bank.c
+ * @brief    M451 series A/B firmware bank manager
+ *
+ *           Two slots hold two copies of the application, each linked at its own slot address. The boot
+ *           manager at address 0 maps the selected slot to the vector page with VECMAP and resets the CPU.
+ *           The running application writes the other slot, and a new record in the bank control pages
+ *           switches to it. Records are only appended, so switching needs no page erase.
+ *
+ *           A new image is first booted on trial. If it resets before it confirms itself, the boot manager
+ *           boots the last confirmed image of the other slot again. The hardware checksum of a slot is
+ *           taken when the image is installed and checked on every boot.
+ *
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include "M451Series.h"
+#include "dual_bank.h"
+
+static uint32_t s_u32CtrlPage;                      /* Control page of the newest record */
+static uint32_t s_u32FreeRec;                       /* Next free record in s_u32CtrlPage */
+static DB_REC_T s_sLatest;                          /* u32Type is 0 if there is no record */
+static DB_REC_T s_asConfirmed[DB_SLOT_NUM];         /* Newest confirmed record of each slot */
+
+static uint32_t s_u32UpdSlot = DB_SLOT_NONE;        /* Slot being written */
+static uint32_t s_u32UpdSize;
+static uint32_t s_u32UpdDone;
+static uint32_t s_u32UpdWord;
+
+#define DB_ROUND_PAGE(x)    (((x) + FMC_FLASH_PAGE_SIZE - 1) & ~(FMC_FLASH_PAGE_SIZE - 1))
+
+/* Read a record. Returns 1 for a valid record, 0 for an erased one and -1 for an interrupted write. */
+static int32_t DB_ReadRec(uint32_t u32Addr, DB_REC_T *psRec)
+{
+    uint32_t u32Head = FMC_Read(u32Addr);
+
+    psRec->u32Seq = FMC_Read(u32Addr + 4);
+    psRec->u32Size = FMC_Read(u32Addr + 8);
+    psRec->u32CheckSum = FMC_Read(u32Addr + 12);
+
+    if((u32Head & 0xFFFF0000UL) != DB_REC_MAGIC)
+    {
+        if((u32Head & psRec->u32Seq & psRec->u32Size & psRec->u32CheckSum) == 0xFFFFFFFFUL)
+            return 0;
+
+        return -1;
+    }
+
+    psRec->u32Type = (u32Head >> 8) & 0xFF;
+    psRec->u32Slot = u32Head & 0xFF;
+
+    if((psRec->u32Type < DB_REC_PENDING) || (psRec->u32Type > DB_REC_CONFIRMED) || (psRec->u32Slot >= DB_SLOT_NUM))
+        return -1;
+
+    return 1;
+}
+
+/* The head word is programmed last, so a record interrupted by a power loss is never taken as valid */
+static int32_t DB_WriteRec(uint32_t u32Addr, DB_REC_T *psRec)
+{
+    uint32_t u32Head = DB_REC_MAGIC | (psRec->u32Type << 8) | psRec->u32Slot;
+    DB_REC_T sCheck;
+
+    FMC_Write(u32Addr + 4, psRec->u32Seq);
+    FMC_Write(u32Addr + 8, psRec->u32Size);
+    FMC_Write(u32Addr + 12, psRec->u32CheckSum);
+    FMC_Write(u32Addr, u32Head);
+
+    if((DB_ReadRec(u32Addr, &sCheck) != 1) || (sCheck.u32Type != psRec->u32Type) ||
+            (sCheck.u32Slot != psRec->u32Slot) || (sCheck.u32Seq != psRec->u32Seq) ||
+            (sCheck.u32Size != psRec->u32Size) || (sCheck.u32CheckSum != psRec->u32CheckSum))
+        return -1;
+
+    return 0;
+}
+
+/* Move the records which are still needed to the other control page */
+static int32_t DB_Compact(void)
+{
+    uint32_t u32Page = (s_u32CtrlPage + 1) % DB_CTRL_PAGE_NUM;
+    uint32_t u32Base = DB_CTRL_BASE + u32Page * FMC_FLASH_PAGE_SIZE;
+    DB_REC_T *apsKeep[DB_SLOT_NUM + 1], *psRec;
+    uint32_t u32Num = 0, i, j;
+
+    for(i = 0; i < DB_SLOT_NUM; i++)
+    {
+        if(s_asConfirmed[i].u32Type && (s_asConfirmed[i].u32Seq != s_sLatest.u32Seq))
+            apsKeep[u32Num++] = &s_asConfirmed[i];
+    }
+
+    apsKeep[u32Num++] = &s_sLatest;
+
+    /* Keep the sequence order. Both pages end with the same newest record until the next one is written. */
+    for(i = 1; i < u32Num; i++)
+    {
+        for(j = i; (j > 0) && (apsKeep[j - 1]->u32Seq > apsKeep[j]->u32Seq); j--)
+        {
+            psRec = apsKeep[j];
+            apsKeep[j] = apsKeep[j - 1];
+            apsKeep[j - 1] = psRec;
+        }
+    }
+
+    if(FMC_Erase(u32Base) != 0)
+        return -1;
+
+    for(i = 0; i < u32Num; i++)
+    {
+        if(DB_WriteRec(u32Base + i * DB_REC_SIZE, apsKeep[i]) < 0)
+            return -1;
+    }
+
+    s_u32CtrlPage = u32Page;
+    s_u32FreeRec = u32Num;
+    return 0;
+}
+
+/**
+  * @brief      Load the bank control state from flash
+  * @return     Number of valid records found
+  * @details    The newest record wins. If both control pages end with the same record because a compaction
+  *             was interrupted, the page with more free records is used.
+  */
+int32_t DB_Init(void)
+{
+    DB_REC_T sRec, asLatest[DB_CTRL_PAGE_NUM];
+    uint32_t au32Used[DB_CTRL_PAGE_NUM], u32Page, i;
+    int32_t i32Ret, i32Num = 0;
+
+    for(i = 0; i < DB_SLOT_NUM; i++)
+        s_asConfirmed[i].u32Type = 0;
+
+    for(u32Page = 0; u32Page < DB_CTRL_PAGE_NUM; u32Page++)
+    {
+        asLatest[u32Page].u32Type = 0;
+        au32Used[u32Page] = 0;
+
+        for(i = 0; i < DB_REC_NUM; i++)
+        {
+            i32Ret = DB_ReadRec(DB_CTRL_BASE + u32Page * FMC_FLASH_PAGE_SIZE + i * DB_REC_SIZE, &sRec);
+
+            if(i32Ret == 0)
+                continue;
+
+            au32Used[u32Page] = i + 1;
+
+            if(i32Ret < 0)
+                continue;
+
+            i32Num++;
+
+            if((asLatest[u32Page].u32Type == 0) || (sRec.u32Seq > asLatest[u32Page].u32Seq))
+                asLatest[u32Page] = sRec;
+
+            if((sRec.u32Type == DB_REC_CONFIRMED) &&
+                    ((s_asConfirmed[sRec.u32Slot].u32Type == 0) || (sRec.u32Seq > s_asConfirmed[sRec.u32Slot].u32Seq)))
+                s_asConfirmed[sRec.u32Slot] = sRec;
+        }
+    }
+
+    /* Page with the newest record. On a tie the page with more free records. */
+    for(s_u32CtrlPage = 0, u32Page = 1; u32Page < DB_CTRL_PAGE_NUM; u32Page++)
+    {
+        if(asLatest[u32Page].u32Type == 0)
+        {
+            if((asLatest[s_u32CtrlPage].u32Type == 0) && (au32Used[u32Page] < au32Used[s_u32CtrlPage]))
+                s_u32CtrlPage = u32Page;
+        }
+        else if((asLatest[s_u32CtrlPage].u32Type == 0) || (asLatest[u32Page].u32Seq > asLatest[s_u32CtrlPage].u32Seq) ||
+                ((asLatest[u32Page].u32Seq == asLatest[s_u32CtrlPage].u32Seq) && (au32Used[u32Page] < au32Used[s_u32CtrlPage])))
+        {
+            s_u32CtrlPage = u32Page;
+        }
+    }
+
+    s_sLatest = asLatest[s_u32CtrlPage];
+    s_u32FreeRec = au32Used[s_u32CtrlPage];
+    return i32Num;
+}
+
+/**
+  * @brief      Get the flash address of a slot
+  * @param[in]  u32Slot     Slot number
+  * @return     Base address of the slot
+  */
+uint32_t DB_GetSlotBase(uint32_t u32Slot)
+{
+    return (u32Slot == 0) ? DB_SLOT_A_BASE : DB_SLOT_B_BASE;
+}
+
+/**
+  * @brief      Get the slot which is mapped to the vector page
+  * @return     Slot number. DB_SLOT_NONE when running the boot manager or another image.
+  */
+uint32_t DB_GetRunningSlot(void)
+{
+    uint32_t u32Map = FMC_GetVECMAP(), i;
+
+    for(i = 0; i < DB_SLOT_NUM; i++)
+    {
+        if(u32Map == DB_GetSlotBase(i))
+            return i;
+    }
+
+    return DB_SLOT_NONE;
+}
+
+/**
+  * @brief      Get the newest record
+  * @param[out] psRec   Newest record
+  * @retval     0   Success
+  * @retval     -1  There is no record
+  */
+int32_t DB_GetLatest(DB_REC_T *psRec)
+{
+    if(s_sLatest.u32Type == 0)
+        return -1;
+
+    *psRec = s_sLatest;
+    return 0;
+}
+
+/**
+  * @brief      Get the newest confirmed record of a slot
+  * @param[in]  u32Slot     Slot number
+  * @param[out] psRec       Newest confirmed record
+  * @retval     0   Success
+  * @retval     -1  The slot has never been confirmed
+  */
+int32_t DB_GetConfirmed(uint32_t u32Slot, DB_REC_T *psRec)
+{
+    if((u32Slot >= DB_SLOT_NUM) || (s_asConfirmed[u32Slot].u32Type == 0))
+        return -1;
+
+    *psRec = s_asConfirmed[u32Slot];
+    return 0;
+}
+
+/**
+  * @brief      Check the image in a slot against a record
+  * @param[in]  psRec   Record of the slot
+  * @retval     0   The vector table is sane and the hardware checksum matches
+  * @retval     -1  The image is not bootable
+  */
+int32_t DB_VerifySlot(DB_REC_T *psRec)
+{
+    uint32_t u32Base = DB_GetSlotBase(psRec->u32Slot);
+    uint32_t u32Sp, u32Pc;
+
+    if((psRec->u32Size < 8) || (psRec->u32Size > DB_SLOT_SIZE))
+        return -1;
+
+    u32Sp = FMC_Read(u32Base);
+    u32Pc = FMC_Read(u32Base + 4);
+
+    if((u32Sp <= SRAM_BASE) || (u32Sp > SRAM_BASE + 0x8000) || (u32Pc < u32Base) || (u32Pc >= u32Base + psRec->u32Size))
+        return -1;
+
+    if(FMC_GetCheckSum(u32Base, DB_ROUND_PAGE(psRec->u32Size)) != psRec->u32CheckSum)
+        return -1;
+
+    return (g_FMC_i32ErrCode == 0) ? 0 : -1;
+}
+
+/**
+  * @brief      Append a record to the bank control pages
+  * @param[in]  u32Type     DB_REC_PENDING, DB_REC_TRIAL or DB_REC_CONFIRMED
+  * @param[in]  psRec       Slot, size and checksum of the record. The sequence number is assigned here.
+  * @retval     0   Success
+  * @retval     -1  The record can't be programmed
+  * @details    The switch is atomic. Until the head word of the record is programmed, the previous record is
+  *             the newest one. A full control page is compacted to the other page first.
+  */
+int32_t DB_Append(uint32_t u32Type, DB_REC_T *psRec)
+{
+    DB_REC_T sRec = *psRec;
+
+    sRec.u32Type = u32Type;
+    sRec.u32Seq = (s_sLatest.u32Type) ? s_sLatest.u32Seq + 1 : 1;
+
+    if((s_u32FreeRec >= DB_REC_NUM) && (s_sLatest.u32Type))
+    {
+        if(DB_Compact() < 0)
+            return -1;
+    }
+    else if(s_u32FreeRec >= DB_REC_NUM)
+    {
+        if(FMC_Erase(DB_CTRL_BASE + s_u32CtrlPage * FMC_FLASH_PAGE_SIZE) != 0)
+            return -1;
+
+        s_u32FreeRec = 0;
+    }
+
+    if(DB_WriteRec(DB_CTRL_BASE + s_u32CtrlPage * FMC_FLASH_PAGE_SIZE + s_u32FreeRec++ * DB_REC_SIZE, &sRec) < 0)
+        return -1;
+
+    s_sLatest = sRec;
+
+    if(u32Type == DB_REC_CONFIRMED)
+        s_asConfirmed[sRec.u32Slot] = sRec;
+
+    return 0;
+}
+
+/**
+  * @brief      Confirm the running image
+  * @retval     0   The running image is the rollback target from now on
+  * @retval     -1  Not running from a slot or the record can't be programmed
+  * @details    Call it after the self-test of a new image passed. An image programmed by a programmer has no
+  *             record. It is confirmed with the checksum of the whole slot.
+  */
+int32_t DB_Confirm(void)
+{
+    uint32_t u32Slot = DB_GetRunningSlot();
+    DB_REC_T sRec;
+
+    if(u32Slot == DB_SLOT_NONE)
+        return -1;
+
+    if((s_sLatest.u32Type == DB_REC_CONFIRMED) && (s_sLatest.u32Slot == u32Slot))
+        return 0;
+
+    if((s_sLatest.u32Type == DB_REC_TRIAL) && (s_sLatest.u32Slot == u32Slot))
+        return DB_Append(DB_REC_CONFIRMED, &s_sLatest);
+
+    if(s_sLatest.u32Type)
+        return -1;  /* Running image was not selected by the boot manager */
+
+    sRec.u32Slot = u32Slot;
+    sRec.u32Size = DB_SLOT_SIZE;
+    sRec.u32CheckSum = FMC_GetCheckSum(DB_GetSlotBase(u32Slot), DB_SLOT_SIZE);
+
+    if(g_FMC_i32ErrCode != 0)
+        return -1;
+
+    return DB_Append(DB_REC_CONFIRMED, &sRec);
+}
+
+/**
+  * @brief      Start writing a new image to the slot which is not running
+  * @param[in]  u32Size     Image size in bytes
+  * @retval     0   The pages of the image are erased. Write the image with DB_Write().
+  * @retval     -1  The running image is not confirmed yet (see DB_Confirm()), the image is too large or
+  *                 erase failed
+  * @details    An update which was installed but not booted yet is cancelled first, so a reset during the
+  *             write boots the running image again. Each page erase stalls the CPU, so the host should send
+  *             the image after this function returns.
+  */
+int32_t DB_BeginUpdate(uint32_t u32Size)
+{
+    uint32_t u32Slot = DB_GetRunningSlot(), u32Base, i;
+
+    s_u32UpdSlot = DB_SLOT_NONE;
+
+    if((u32Slot == DB_SLOT_NONE) || (s_sLatest.u32Type == 0) || (u32Size < 8) || (u32Size > DB_SLOT_SIZE))
+        return -1;
+
+    if(s_sLatest.u32Slot != u32Slot)
+    {
+        if((s_asConfirmed[u32Slot].u32Type == 0) || (DB_Append(DB_REC_CONFIRMED, &s_asConfirmed[u32Slot]) < 0))
+            return -1;
+    }
+    else if(s_sLatest.u32Type != DB_REC_CONFIRMED)
+    {
+        return -1;
+    }
+
+    u32Slot = (u32Slot + 1) % DB_SLOT_NUM;
+    u32Base = DB_GetSlotBase(u32Slot);
+
+    for(i = 0; i < u32Size; i += FMC_FLASH_PAGE_SIZE)
+    {
+        if(FMC_Erase(u32Base + i) != 0)
+            return -1;
+    }
+
+    s_u32UpdSlot = u32Slot;
+    s_u32UpdSize = u32Size;
+    s_u32UpdDone = 0;
+    return 0;
+}
+
+/**
+  * @brief      Write the next part of the new image
+  * @param[in]  pu8Data     Image data
+  * @param[in]  u32Len      Size of data. The image may be split at any byte.
+  * @retval     0   Success
+  * @retval     -1  No update is started, the data exceeds the image size or programming failed.
+  *                 The update is cancelled.
+  * @details    Every word is read back after programming. The running image keeps working between calls.
+  */
+int32_t DB_Write(uint8_t *pu8Data, uint32_t u32Len)
+{
+    uint32_t u32Addr;
+
+    if((s_u32UpdSlot == DB_SLOT_NONE) || (u32Len > s_u32UpdSize - s_u32UpdDone))
+        goto error;
+
+    while(u32Len--)
+    {
+        s_u32UpdWord = (s_u32UpdWord >> 8) | ((uint32_t)(*pu8Data++) << 24);
+
+        if((++s_u32UpdDone & 3) == 0)
+        {
+            u32Addr = DB_GetSlotBase(s_u32UpdSlot) + s_u32UpdDone - 4;
+            FMC_Write(u32Addr, s_u32UpdWord);
+
+            if(FMC_Read(u32Addr) != s_u32UpdWord)
+                goto error;
+        }
+    }
+
+    return 0;
+
+error:
+    s_u32UpdSlot = DB_SLOT_NONE;
+    return -1;
+}
+
+/**
+  * @brief      Finish the update and select the new image for the next boot
+  * @retval     0   The new image is booted on trial after the next reset
+  * @retval     -1  The image is incomplete or its vector table is not valid for the slot
+  */
+int32_t DB_EndUpdate(void)
+{
+    uint32_t u32Addr;
+    DB_REC_T sRec;
+
+    if((s_u32UpdSlot == DB_SLOT_NONE) || (s_u32UpdDone != s_u32UpdSize))
+        return -1;
+
+    /* Program the last word padded with 0xFF */
+    if(s_u32UpdDone & 3)
+    {
+        u32Addr = DB_GetSlotBase(s_u32UpdSlot) + (s_u32UpdDone & ~3UL);
+
+        while(s_u32UpdDone & 3)
+        {
+            s_u32UpdWord = (s_u32UpdWord >> 8) | 0xFF000000UL;
+            s_u32UpdDone++;
+        }
+
+        FMC_Write(u32Addr, s_u32UpdWord);
+    }
+
+    sRec.u32Slot = s_u32UpdSlot;
+    sRec.u32Size = s_u32UpdSize;
+    sRec.u32CheckSum = FMC_GetCheckSum(DB_GetSlotBase(s_u32UpdSlot), DB_ROUND_PAGE(s_u32UpdSize));
+    s_u32UpdSlot = DB_SLOT_NONE;
+
+    if(DB_VerifySlot(&sRec) < 0)
+        return -1;
+
+    return DB_Append(DB_REC_PENDING, &sRec);
+}
+
+/**
+  * @brief      Select the confirmed image of the other slot for the next boot
+  * @retval     0   The other image is booted after the next reset
+  * @retval     -1  The other slot has no confirmed image or the image is damaged
+  * @details    The previous image is still in its slot, so rollback only appends a record.
+  */
+int32_t DB_Rollback(void)
+{
+    uint32_t u32Slot = DB_GetRunningSlot();
+    DB_REC_T sRec;
+
+    if(u32Slot == DB_SLOT_NONE)
+        return -1;
+
+    if((DB_GetConfirmed((u32Slot + 1) % DB_SLOT_NUM, &sRec) < 0) || (DB_VerifySlot(&sRec) < 0))
+        return -1;
+
+    return DB_Append(DB_REC_CONFIRMED, &sRec);
+}
+
+/**
+  * @brief      Restart through the boot manager
+  * @return     None
+  * @details    Only the CPU is reset. Registers must be unlocked.
+  */
+void DB_Reboot(void)
+{
+    FMC_SetVectorPageAddr(DB_BOOT_BASE);
+    SYS_ResetCPU();
+
+    while(1);
+}
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
@@ -0,0 +1,65 @@
+/******************************************************************************
+ * @file     dual_bank.h
+ * @brief    M451 series A/B firmware bank manager header
+ *
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __DUAL_BANK_H__
+#define __DUAL_BANK_H__
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* APROM layout (256 KB APROM, Data Flash disabled)                                                        */
+/*   0x00000  Boot manager. Runs after every chip reset and maps the selected slot to the vector page.     */
+/*   0x01000  Bank control. Two pages of 16-byte records. The newest record tells which slot to boot.      */
+/*   0x02000  Slot A. The application image linked at 0x02000.                                             */
+/*   0x21000  Slot B. The same application linked at 0x21000.                                              */
+/* VECMAP is only valid in new IAP mode (CBS = 10'b or 00'b).                                              */
+/*---------------------------------------------------------------------------------------------------------*/
+#define DB_BOOT_BASE        0x00000000UL
+#define DB_CTRL_BASE        0x00001000UL
+#define DB_CTRL_PAGE_NUM    2
+#define DB_SLOT_A_BASE      0x00002000UL
+#define DB_SLOT_B_BASE      0x00021000UL
+#define DB_SLOT_SIZE        (DB_SLOT_B_BASE - DB_SLOT_A_BASE)
+#define DB_SLOT_NUM         2
+
+#define DB_REC_SIZE         16
+#define DB_REC_NUM          (FMC_FLASH_PAGE_SIZE / DB_REC_SIZE)     /* Records per control page */
+#define DB_REC_MAGIC        0xDB000000UL
+
+/* Record types. A record is [magic | type << 8 | slot][sequence][image size][hardware checksum]. */
+#define DB_REC_PENDING      1           /* Image is installed and is booted once on trial */
+#define DB_REC_TRIAL        2           /* Boot manager started the trial boot */
+#define DB_REC_CONFIRMED    3           /* Image passed its self-test and is the rollback target */
+
+#define DB_SLOT_NONE        0xFFFFFFFFUL
+
+typedef struct
+{
+    uint32_t u32Type;
+    uint32_t u32Slot;
+    uint32_t u32Seq;
+    uint32_t u32Size;
+    uint32_t u32CheckSum;
+} DB_REC_T;
+
+int32_t DB_Init(void);
+uint32_t DB_GetSlotBase(uint32_t u32Slot);
+uint32_t DB_GetRunningSlot(void);
+int32_t DB_GetLatest(DB_REC_T *psRec);
+int32_t DB_GetConfirmed(uint32_t u32Slot, DB_REC_T *psRec);
+int32_t DB_VerifySlot(DB_REC_T *psRec);
+int32_t DB_Append(uint32_t u32Type, DB_REC_T *psRec);
+
+int32_t DB_Confirm(void);
+int32_t DB_BeginUpdate(uint32_t u32Size);
+int32_t DB_Write(uint8_t *pu8Data, uint32_t u32Len);
+int32_t DB_EndUpdate(void);
+int32_t DB_Rollback(void);
+void DB_Reboot(void);
+
+#endif  /* __DUAL_BANK_H__ */
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
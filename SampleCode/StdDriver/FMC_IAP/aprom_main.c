@@ -107,10 +107,7 @@ static int  LoadImage(uint32_t u32ImageBase, uint32_t u32ImageLimit, uint32_t u3
     for(i = 0; i < u32ImageSize; i += FMC_FLASH_PAGE_SIZE)
     {
         FMC_Erase(u32FlashAddr + i);
-        for(j = 0; j < FMC_FLASH_PAGE_SIZE; j += 4)
-        {
-            FMC_Write(u32FlashAddr + i + j, pu32Loader[(i + j) / 4]);
-        }
+        FMC_WriteMultiple(u32FlashAddr + i, &pu32Loader[i / 4], FMC_FLASH_PAGE_SIZE);
     }
     printf("OK.\n");
 
@@ -0,0 +1,215 @@
+/**************************************************************************//**
+ * @file     main.c
+ * @version  V3.00
+ * @brief    Write and read EEPROM 24LC64 in blocks with the I2C EEPROM library.
+ *           Writes are split at page boundaries with ACK polling, unchanged pages are skipped, and reads are
+ *           sequential. The speed of each case is printed in bytes per second.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include "M451Series.h"
+#include "i2c_eeprom.h"
+
+#define PLL_CLOCK           72000000
+
+#define EEPROM_ADDR         0x50
+#define EEPROM_SIZE         8192
+#define EEPROM_PAGE_SIZE    32
+
+#define TEST_ADDR           0x0105      /* Not aligned to pages */
+#define TEST_LENGTH         4096
+#define BYTE_READ_LENGTH    256
+
+static I2C_QUEUE_T s_sQueue;
+static I2C_EEPROM_T s_sEeprom;
+
+static uint8_t s_au8SrcArray[TEST_LENGTH];
+static uint8_t s_au8DestArray[TEST_LENGTH];
+static uint32_t s_u32Start;
+
+
+void I2C0_IRQHandler(void)
+{
+    I2C_QueueIRQHandler(&s_sQueue);
+}
+
+void SYS_Init(void)
+{
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init System Clock                                                                                       */
+    /*---------------------------------------------------------------------------------------------------------*/
+
+    /* Enable Internal RC 22.1184MHz clock */
+    CLK_EnableXtalRC(CLK_PWRCTL_HIRCEN_Msk);
+
+    /* Waiting for Internal RC clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HIRCSTB_Msk);
+
+    /* Switch HCLK clock source to Internal RC and HCLK source divide 1 */
+    CLK_SetHCLK(CLK_CLKSEL0_HCLKSEL_HIRC, CLK_CLKDIV0_HCLK(1));
+
+    /* Enable external XTAL 12MHz clock */
+    CLK_EnableXtalRC(CLK_PWRCTL_HXTEN_Msk);
+
+    /* Waiting for external XTAL clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HXTSTB_Msk);
+
+    /* Set core clock as PLL_CLOCK from PLL */
+    CLK_SetCoreClock(PLL_CLOCK);
+
+    /* Enable UART module clock */
+    CLK_EnableModuleClock(UART0_MODULE);
+
+    /* Enable I2C0 module clock */
+    CLK_EnableModuleClock(I2C0_MODULE);
+
+    /* Select UART module clock source */
+    CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL1_UARTSEL_HXT, CLK_CLKDIV0_UART(1));
+
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init I/O Multi-function                                                                                 */
+    /*---------------------------------------------------------------------------------------------------------*/
+
+    /* Set GPD multi-function pins for UART0 RXD and TXD */
+    SYS->GPD_MFPL &= ~(SYS_GPD_MFPL_PD0MFP_Msk | SYS_GPD_MFPL_PD1MFP_Msk);
+    SYS->GPD_MFPL |= (SYS_GPD_MFPL_PD0MFP_UART0_RXD | SYS_GPD_MFPL_PD1MFP_UART0_TXD);
+
+    /* Set GPA multi-function pins for I2C0 SDA and SCL */
+    SYS->GPA_MFPL &= ~(SYS_GPA_MFPL_PA2MFP_Msk | SYS_GPA_MFPL_PA3MFP_Msk);
+    SYS->GPA_MFPL |= (SYS_GPA_MFPL_PA2MFP_I2C0_SDA | SYS_GPA_MFPL_PA3MFP_I2C0_SCL);
+
+    /* I2C pins enable schmitt trigger */
+    PA->SMTEN |= (GPIO_SMTEN_SMTEN2_Msk | GPIO_SMTEN_SMTEN3_Msk);
+}
+
+/* Start a measurement and clear the counters of the library */
+void Bench_Start(void)
+{
+    s_sEeprom.u32PageCnt = 0;
+    s_sEeprom.u32SkipCnt = 0;
+    s_sEeprom.u32PollCnt = 0;
+    s_u32Start = DWT->CYCCNT;
+}
+
+/* Print the speed of u32Bytes since Bench_Start() */
+void Bench_Print(const char *pcName, uint32_t u32Bytes)
+{
+    uint32_t u32Cycles = DWT->CYCCNT - s_u32Start;
+
+    printf("%-22s %6d bytes/s, %3d pages written, %3d skipped, %4d polls\n", pcName,
+           (uint32_t)((uint64_t)u32Bytes * SystemCoreClock / u32Cycles), s_sEeprom.u32PageCnt, s_sEeprom.u32SkipCnt,
+           s_sEeprom.u32PollCnt);
+}
+
+/* Read back and compare the test range */
+int32_t Verify(void)
+{
+    uint32_t i;
+
+    if(I2cEeprom_Read(&s_sEeprom, TEST_ADDR, s_au8DestArray, TEST_LENGTH) < 0)
+        return -1;
+
+    for(i = 0; i < TEST_LENGTH; i++)
+    {
+        if(s_au8DestArray[i] != s_au8SrcArray[i])
+        {
+            printf("Compare failed at 0x%X\n", TEST_ADDR + i);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Main Function                                                                                          */
+/*---------------------------------------------------------------------------------------------------------*/
+int32_t main(void)
+{
+    uint32_t i;
+
+    /* Unlock protected registers */
+    SYS_UnlockReg();
+
+    /* Init System, IP clock and multi-function I/O */
+    SYS_Init();
+
+    /* Lock protected registers */
+    SYS_LockReg();
+
+    /* Init UART0 to 115200-8n1 for print message */
+    UART_Open(UART0, 115200);
+
+    /* Enable the cycle counter for the measurements */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    printf("+-------------------------------------------------------+\n");
+    printf("|    M451 I2C EEPROM Block Access Sample with 24LC64    |\n");
+    printf("+-------------------------------------------------------+\n");
+
+    printf("I2C clock %d Hz\n", I2C_Open(I2C0, 400000));
+    I2C_EnableTimeout(I2C0, 1);
+    I2C_QueueOpen(&s_sQueue, I2C0);
+
+    if(I2cEeprom_Open(&s_sEeprom, &s_sQueue, EEPROM_ADDR, EEPROM_SIZE, EEPROM_PAGE_SIZE) < 0)
+    {
+        printf("No EEPROM found!\n");
+        goto lexit;
+    }
+
+    /* A pattern which differs from the last run, so every page is written */
+    if(I2cEeprom_Read(&s_sEeprom, TEST_ADDR, s_au8DestArray, 1) < 0)
+        goto lexit;
+
+    for(i = 0; i < TEST_LENGTH; i++)
+        s_au8SrcArray[i] = (uint8_t)(i + s_au8DestArray[0] + 1);
+
+    Bench_Start();
+    if(I2cEeprom_Write(&s_sEeprom, TEST_ADDR, s_au8SrcArray, TEST_LENGTH) < 0)
+        goto lexit;
+    I2cEeprom_WaitReady(&s_sEeprom);
+    Bench_Print("Write all pages", TEST_LENGTH);
+
+    /* The same data again. Every page is skipped. */
+    Bench_Start();
+    if(I2cEeprom_Write(&s_sEeprom, TEST_ADDR, s_au8SrcArray, TEST_LENGTH) < 0)
+        goto lexit;
+    I2cEeprom_WaitReady(&s_sEeprom);
+    Bench_Print("Write unchanged", TEST_LENGTH);
+
+    /* One byte changed in every 4th page */
+    for(i = 0; i < TEST_LENGTH; i += EEPROM_PAGE_SIZE * 4)
+        s_au8SrcArray[i] ^= 0x5A;
+
+    Bench_Start();
+    if(I2cEeprom_Write(&s_sEeprom, TEST_ADDR, s_au8SrcArray, TEST_LENGTH) < 0)
+        goto lexit;
+    I2cEeprom_WaitReady(&s_sEeprom);
+    Bench_Print("Write 1/4 changed", TEST_LENGTH);
+
+    /* Sequential read */
+    Bench_Start();
+    if(Verify() < 0)
+        goto lexit;
+    Bench_Print("Sequential read", TEST_LENGTH);
+
+    /* Random read of every byte for comparison */
+    Bench_Start();
+    for(i = 0; i < BYTE_READ_LENGTH; i++)
+    {
+        if(I2cEeprom_Read(&s_sEeprom, TEST_ADDR + i, &s_au8DestArray[i], 1) < 0)
+            goto lexit;
+    }
+    Bench_Print("Byte by byte read", BYTE_READ_LENGTH);
+
+    printf("I2C EEPROM Block Access Test OK\n");
+
+lexit:
+
+    while(1);
+}
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
@@ -0,0 +1,231 @@
+/**************************************************************************//**
+ * @file     main.c
+ * @version  V3.00
+ * @brief    Access EEPROM 24LC64 through the I2C message queue.
+ *           A page write, the ACK polling of its write cycle and a batch of random reads all run in the
+ *           I2C interrupt, while the main loop keeps counting.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include "M451Series.h"
+
+#define PLL_CLOCK           72000000
+
+#define EEPROM_ADDR         0x50
+#define EEPROM_PAGE_SIZE    32
+#define TEST_ADDR           0x0100
+#define READ_NUM            8
+#define READ_LEN            (EEPROM_PAGE_SIZE / READ_NUM)
+
+static I2C_QUEUE_T s_sQueue;
+
+/* Page write: 2 address bytes and a page of data in one message */
+static uint8_t s_au8Page[2 + EEPROM_PAGE_SIZE];
+static I2C_QMSG_T s_sPageMsg;
+static I2C_QXFER_T s_sPageXfer;
+
+/* ACK polling: the slave address alone, repeated until the write cycle is over */
+static I2C_QMSG_T s_sPollMsg;
+static I2C_QXFER_T s_sPollXfer;
+static volatile uint32_t s_u32PollCnt;
+static volatile uint32_t s_u32Ready;
+
+/* Random reads: address write, repeated START and read */
+static uint8_t s_au8ReadAddr[READ_NUM][2];
+static uint8_t s_au8ReadData[READ_NUM][READ_LEN];
+static I2C_QMSG_T s_asReadMsg[READ_NUM][2];
+static I2C_QXFER_T s_asReadXfer[READ_NUM];
+static volatile uint32_t s_u32ReadCnt;
+
+
+void I2C0_IRQHandler(void)
+{
+    I2C_QueueIRQHandler(&s_sQueue);
+}
+
+/* The EEPROM doesn't acknowledge its address during the write cycle */
+void Poll_Done(I2C_QXFER_T *psXfer)
+{
+    if(psXfer->i32Status == I2C_QXFER_NACK)
+    {
+        s_u32PollCnt++;
+        I2C_QueueSubmit(&s_sQueue, psXfer);
+    }
+    else
+    {
+        s_u32Ready = 1;
+    }
+}
+
+void Read_Done(I2C_QXFER_T *psXfer)
+{
+    if(psXfer->i32Status == I2C_QXFER_DONE)
+        s_u32ReadCnt++;
+}
+
+void SYS_Init(void)
+{
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init System Clock                                                                                       */
+    /*---------------------------------------------------------------------------------------------------------*/
+
+    /* Enable Internal RC 22.1184MHz clock */
+    CLK_EnableXtalRC(CLK_PWRCTL_HIRCEN_Msk);
+
+    /* Waiting for Internal RC clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HIRCSTB_Msk);
+
+    /* Switch HCLK clock source to Internal RC and HCLK source divide 1 */
+    CLK_SetHCLK(CLK_CLKSEL0_HCLKSEL_HIRC, CLK_CLKDIV0_HCLK(1));
+
+    /* Enable external XTAL 12MHz clock */
+    CLK_EnableXtalRC(CLK_PWRCTL_HXTEN_Msk);
+
+    /* Waiting for external XTAL clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HXTSTB_Msk);
+
+    /* Set core clock as PLL_CLOCK from PLL */
+    CLK_SetCoreClock(PLL_CLOCK);
+
+    /* Enable UART module clock */
+    CLK_EnableModuleClock(UART0_MODULE);
+
+    /* Enable I2C0 module clock */
+    CLK_EnableModuleClock(I2C0_MODULE);
+
+    /* Select UART module clock source */
+    CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL1_UARTSEL_HXT, CLK_CLKDIV0_UART(1));
+
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init I/O Multi-function                                                                                 */
+    /*---------------------------------------------------------------------------------------------------------*/
+
+    /* Set GPD multi-function pins for UART0 RXD and TXD */
+    SYS->GPD_MFPL &= ~(SYS_GPD_MFPL_PD0MFP_Msk | SYS_GPD_MFPL_PD1MFP_Msk);
+    SYS->GPD_MFPL |= (SYS_GPD_MFPL_PD0MFP_UART0_RXD | SYS_GPD_MFPL_PD1MFP_UART0_TXD);
+
+    /* Set GPA multi-function pins for I2C0 SDA and SCL */
+    SYS->GPA_MFPL &= ~(SYS_GPA_MFPL_PA2MFP_Msk | SYS_GPA_MFPL_PA3MFP_Msk);
+    SYS->GPA_MFPL |= (SYS_GPA_MFPL_PA2MFP_I2C0_SDA | SYS_GPA_MFPL_PA3MFP_I2C0_SCL);
+
+    /* I2C pins enable schmitt trigger */
+    PA->SMTEN |= (GPIO_SMTEN_SMTEN2_Msk | GPIO_SMTEN_SMTEN3_Msk);
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Main Function                                                                                          */
+/*---------------------------------------------------------------------------------------------------------*/
+int32_t main(void)
+{
+    I2C_QMSG_T sProbeMsg;
+    I2C_QXFER_T sProbeXfer;
+    uint32_t u32Loops, u32Addr, i, j;
+
+    /* Unlock protected registers */
+    SYS_UnlockReg();
+
+    /* Init System, IP clock and multi-function I/O */
+    SYS_Init();
+
+    /* Lock protected registers */
+    SYS_LockReg();
+
+    /* Init UART0 to 115200-8n1 for print message */
+    UART_Open(UART0, 115200);
+
+    printf("+-------------------------------------------------------+\n");
+    printf("|    M451 I2C Message Queue Sample Code with 24LC64     |\n");
+    printf("+-------------------------------------------------------+\n");
+
+    printf("I2C clock %d Hz\n", I2C_Open(I2C0, 400000));
+    I2C_EnableTimeout(I2C0, 1);
+    I2C_QueueOpen(&s_sQueue, I2C0);
+
+    /* A slave which isn't there ends with NACK */
+    sProbeMsg.u8Addr = 0x2A;
+    sProbeMsg.u8Flags = I2C_QMSG_WR;
+    sProbeMsg.u16Len = 0;
+    sProbeMsg.pu8Buf = NULL;
+    sProbeXfer.psMsg = &sProbeMsg;
+    sProbeXfer.u32MsgNum = 1;
+    sProbeXfer.pfnDone = NULL;
+    printf("Probe of slave 0x%02X: %d\n", sProbeMsg.u8Addr, I2C_QueueTransfer(&s_sQueue, &sProbeXfer));
+
+    /* Queue a page write and the ACK polling after it. Both run in the interrupt. */
+    s_au8Page[0] = (uint8_t)(TEST_ADDR >> 8);
+    s_au8Page[1] = (uint8_t)TEST_ADDR;
+
+    for(i = 0; i < EEPROM_PAGE_SIZE; i++)
+        s_au8Page[2 + i] = (uint8_t)(i * 5 + 7);
+
+    s_sPageMsg.u8Addr = EEPROM_ADDR;
+    s_sPageMsg.u8Flags = I2C_QMSG_WR;
+    s_sPageMsg.u16Len = sizeof(s_au8Page);
+    s_sPageMsg.pu8Buf = s_au8Page;
+    s_sPageXfer.psMsg = &s_sPageMsg;
+    s_sPageXfer.u32MsgNum = 1;
+    s_sPageXfer.pfnDone = NULL;
+
+    s_sPollMsg.u8Addr = EEPROM_ADDR;
+    s_sPollMsg.u8Flags = I2C_QMSG_WR;
+    s_sPollMsg.u16Len = 0;
+    s_sPollMsg.pu8Buf = NULL;
+    s_sPollXfer.psMsg = &s_sPollMsg;
+    s_sPollXfer.u32MsgNum = 1;
+    s_sPollXfer.pfnDone = Poll_Done;
+
+    I2C_QueueSubmit(&s_sQueue, &s_sPageXfer);
+    I2C_QueueSubmit(&s_sQueue, &s_sPollXfer);
+
+    for(u32Loops = 0; !s_u32Ready; u32Loops++);
+
+    printf("Page write %d, ready after %d polls, %d main loops\n", s_sPageXfer.i32Status, s_u32PollCnt, u32Loops);
+
+    /* Queue all random reads back to back */
+    for(i = 0; i < READ_NUM; i++)
+    {
+        u32Addr = TEST_ADDR + i * READ_LEN;
+        s_au8ReadAddr[i][0] = (uint8_t)(u32Addr >> 8);
+        s_au8ReadAddr[i][1] = (uint8_t)u32Addr;
+
+        s_asReadMsg[i][0].u8Addr = EEPROM_ADDR;
+        s_asReadMsg[i][0].u8Flags = I2C_QMSG_WR;
+        s_asReadMsg[i][0].u16Len = 2;
+        s_asReadMsg[i][0].pu8Buf = s_au8ReadAddr[i];
+        s_asReadMsg[i][1].u8Addr = EEPROM_ADDR;
+        s_asReadMsg[i][1].u8Flags = I2C_QMSG_RD;
+        s_asReadMsg[i][1].u16Len = READ_LEN;
+        s_asReadMsg[i][1].pu8Buf = s_au8ReadData[i];
+
+        s_asReadXfer[i].psMsg = s_asReadMsg[i];
+        s_asReadXfer[i].u32MsgNum = 2;
+        s_asReadXfer[i].pfnDone = Read_Done;
+        I2C_QueueSubmit(&s_sQueue, &s_asReadXfer[i]);
+    }
+
+    for(u32Loops = 0; s_asReadXfer[READ_NUM - 1].i32Status > 0; u32Loops++);
+
+    printf("%d of %d reads done, %d main loops\n", s_u32ReadCnt, READ_NUM, u32Loops);
+
+    for(i = 0; i < READ_NUM; i++)
+    {
+        for(j = 0; j < READ_LEN; j++)
+        {
+            if(s_au8ReadData[i][j] != s_au8Page[2 + i * READ_LEN + j])
+            {
+                printf("I2C Message Queue Test Failed at 0x%X\n", TEST_ADDR + i * READ_LEN + j);
+                goto lexit;
+            }
+        }
+    }
+
+    printf("I2C Message Queue Test OK\n");
+
+lexit:
+
+    while(1);
+}
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
@@ -0,0 +1,90 @@
+/**************************************************************************//**
+ * @file     core_cm4.h
+ * @version  V1.00
+ * @brief    Cortex-M4 core stand-in for building USBD firmware on a Linux host
+ *
+ * @note
+ *           Only used by usbd_sim.sh. It is found before CMSIS/Include, so M451Series.h picks it up instead of
+ *           the real core header. Core registers do not exist on the host. The NVIC and PRIMASK functions are
+ *           routed to the simulator, which runs USBD_IRQHandler() itself when the interrupt is enabled and
+ *           not masked.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __CORE_CM4_H__
+#define __CORE_CM4_H__
+
+#include <stdint.h>
+
+#define __I     volatile const
+#define __O     volatile
+#define __IO    volatile
+#define __IM    volatile const
+#define __OM    volatile
+#define __IOM   volatile
+
+#define __ASM               __asm__
+#define __INLINE            inline
+#define __STATIC_INLINE     static inline
+
+void     Sim_SetPrimask(uint32_t u32Primask);
+uint32_t Sim_GetPrimask(void);
+void     Sim_NvicEnable(IRQn_Type IRQn, uint32_t u32Enable);
+
+#define __set_PRIMASK(x)        Sim_SetPrimask(x)
+#define __get_PRIMASK()         Sim_GetPrimask()
+#define __disable_irq()         Sim_SetPrimask(1)
+#define __enable_irq()          Sim_SetPrimask(0)
+#define __NOP()
+#define __WFI()
+#define __DSB()
+#define __ISB()
+
+/* CLK_SysTickDelay() polls COUNTFLAG. The flag test lets the simulator advance its clock by LOAD instead */
+typedef struct
+{
+    __IO uint32_t CTRL;
+    __IO uint32_t LOAD;
+    __IO uint32_t VAL;
+    __I  uint32_t CALIB;
+} SysTick_Type;
+
+extern SysTick_Type g_sSimSysTick;
+uint32_t Sim_SysTickExpire(void);
+
+#define SysTick                         (&g_sSimSysTick)
+#define SysTick_CTRL_ENABLE_Msk         (1UL << 0)
+#define SysTick_CTRL_CLKSOURCE_Msk      (1UL << 2)
+#define SysTick_CTRL_COUNTFLAG_Msk      Sim_SysTickExpire()
+
+/* Cycle counter for timing code. The simulator keeps CYCCNT at the model time */
+typedef struct
+{
+    __IO uint32_t CTRL;
+    __IO uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+    __IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+extern DWT_Type g_sSimDwt;
+extern CoreDebug_Type g_sSimCoreDebug;
+
+#define DWT                             (&g_sSimDwt)
+#define CoreDebug                       (&g_sSimCoreDebug)
+#define DWT_CTRL_CYCCNTENA_Msk          (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk      (1UL << 24)
+
+/* Firmware console output is shown with the simulator -v option */
+int Sim_DevPrintf(const char *pcFmt, ...);
+#define printf                          Sim_DevPrintf
+
+#define NVIC_EnableIRQ(IRQn)            Sim_NvicEnable((IRQn), 1)
+#define NVIC_DisableIRQ(IRQn)           Sim_NvicEnable((IRQn), 0)
+#define NVIC_SetPriority(IRQn, u32Pri)
+#define NVIC_ClearPendingIRQ(IRQn)
+
+#endif /* __CORE_CM4_H__ */
@@ -0,0 +1,1067 @@
+/**************************************************************************//**
+ * @file     usbd_sim.c
+ * @version  V1.00
+ * @brief    USBD controller model and scripted full-speed host for Linux
+ *
+ * @note
+ *           Build : see usbd_sim.sh. x86 Linux only, the register model single-steps the CPU.
+ *
+ *           The USBD firmware (usbd.c and the class files of a sample) runs unmodified on the host:
+ *           - The USBD register block is mapped read-only at USBD_BASE. A register write faults, the handler
+ *             lets the instruction complete with the trap flag set, and the trap handler applies the hardware
+ *             side effects: INTSTS is write-1-to-clear, MXPLD arms an endpoint, CFGP.CLRRDY disarms it,
+ *             EPSTS and VBUSDET are read-only and ATTR[3:0] is bus state. Scripts trap other register pages
+ *             the same way with Sim_MapRegs().
+ *           - The 512-byte endpoint SRAM is relocated with -DUSBD_BUF_BASE to its own page, so buffer
+ *             copies do not trap. BUFSEG and STBUFSEG keep their 9-bit range.
+ *           - USBD_IRQHandler() runs when INTSTS & INTEN is set, the NVIC line is enabled and PRIMASK is clear.
+ *             Its effects become visible SIM_ISR_US after the event. The sample main loop body runs every
+ *             SIM_LOOP_US plus its SysTick delays, and the ISR preempts it. DWT->CYCCNT follows the model time.
+ *           The host side is a transaction-level full-speed host. It sends SOF every 1 ms, does not start a
+ *           transaction that would cross the end of frame, counts token, data (with bit stuffing),
+ *           handshake and inter-packet gap bits, retries NAKed control and bulk transactions at once and
+ *           polls interrupt and isochronous endpoints at their bInterval. It checks data PIDs, packet sizes,
+ *           endpoint SRAM ranges and the endpoint configuration against the descriptors.
+ *
+ *           Usage : <script> [-v] [-t]      -v prints the firmware printf output, -t traces every packet
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+#include "usbd_sim.h"
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE MAP_FIXED
+#endif
+
+#define SIM_USBD_BASE       0x400C0000UL    /* USBD_BASE of M451Series.h */
+#define SIM_PAGE_SIZE       0x1000UL
+#define SIM_SRAM_SIZE       512
+
+#ifndef USBD_BUF_BASE
+#error "Build with -DUSBD_BUF_BASE=<page outside the USBD register page>"
+#endif
+#if ((USBD_BUF_BASE) & ~(SIM_PAGE_SIZE - 1)) == SIM_USBD_BASE
+#error "USBD_BUF_BASE must not share the write protected register page"
+#endif
+
+#define SIM_ISR_US          4               /* Interrupt entry, handler and exit at 72 MHz */
+#define SIM_LOOP_US         2               /* One pass of the sample main loop */
+#define SIM_LOOP_BURST      256             /* Idle main loop passes run before the model skips ahead */
+#define SIM_TIMEOUT_MS      1000            /* NAK retry limit of one packet */
+#define SIM_ENUM_RETRY_MS   5               /* Wait before a control transfer is retried during enumeration */
+#define SIM_REGS_NUM        4               /* Trapped register pages, USBD included */
+
+/* Packet sizes in bit times */
+#define SIM_TOKEN_BITS      35              /* SYNC, PID, ADDR, ENDP, CRC5, EOP */
+#define SIM_HSHK_BITS       19              /* SYNC, PID, EOP */
+#define SIM_GAP_BITS        8               /* Inter-packet delay and bus turnaround */
+#define SIM_NORESP_BITS     18              /* Host response timeout */
+#define SIM_SOF_BITS        (SIM_TOKEN_BITS + SIM_GAP_BITS)
+#define SIM_EOF_BITS        42              /* No transaction is started in the end-of-frame window */
+
+#define SIM_PID_OUT         0x1
+#define SIM_PID_IN          0x9
+#define SIM_PID_SETUP       0xD
+
+/* Register word index */
+#define REG_INTEN           (0x00 / 4)
+#define REG_INTSTS          (0x04 / 4)
+#define REG_FADDR           (0x08 / 4)
+#define REG_EPSTS           (0x0C / 4)
+#define REG_ATTR            (0x10 / 4)
+#define REG_VBUSDET         (0x14 / 4)
+#define REG_STBUFSEG        (0x18 / 4)
+#define REG_SE0             (0x90 / 4)
+#define REG_EP0             (0x500 / 4)
+#define REG_EP(ep, n)       (REG_EP0 + (ep) * 4 + (n))
+#define EP_BUFSEG           0
+#define EP_MXPLD            1
+#define EP_CFG              2
+#define EP_CFGP             3
+#define SIM_EP_NUM          8
+
+#define INTSTS_BUSIF        (1UL << 0)
+#define INTSTS_USBIF        (1UL << 1)
+#define INTSTS_VBDETIF      (1UL << 2)
+#define INTSTS_EPEVT(ep)    (1UL << (16 + (ep)))
+#define INTSTS_SETUP        (1UL << 31)
+#define ATTR_USBRST         (1UL << 0)
+#define ATTR_STATE_MSK      0xFUL
+#define ATTR_PHYEN          (1UL << 4)
+#define ATTR_USBEN          (1UL << 7)
+#define ATTR_DPPUEN         (1UL << 8)
+#define CFG_EPNUM_MSK       0xFUL
+#define CFG_ISOCH           (1UL << 4)
+#define CFG_STATE(x)        (((x) >> 5) & 3)
+#define CFG_DSQSYNC         (1UL << 7)
+#define CFG_CSTALL          (1UL << 9)
+#define CFGP_CLRRDY         (1UL << 0)
+#define CFGP_SSTALL         (1UL << 1)
+#define STATE_OUT           1
+#define STATE_IN            2
+#define EPSTS_IN_ACK        0
+#define EPSTS_IN_NAK        1
+#define EPSTS_OUT0_ACK      2
+#define EPSTS_SETUP_ACK     3
+#define EPSTS_OUT1_ACK      6
+#define EPSTS_ISO           7
+#define SIM_USBD_IRQN       53
+
+void USBD_IRQHandler(void);
+
+#define SIM_MAX(a, b)       ((a) > (b) ? (a) : (b))
+#define SIM_MIN(a, b)       ((a) < (b) ? (a) : (b))
+
+/* Firmware side symbols normally provided by system_M451Series.c and the core header */
+uint32_t SystemCoreClock = 72000000;
+uint32_t CyclesPerUs = 72;
+struct
+{
+    volatile uint32_t CTRL;
+    volatile uint32_t LOAD;
+    volatile uint32_t VAL;
+    volatile uint32_t CALIB;
+} g_sSimSysTick;
+struct
+{
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} g_sSimDwt;
+struct
+{
+    volatile uint32_t DEMCR;
+} g_sSimCoreDebug;
+
+typedef struct
+{
+    uint32_t u32Base;
+    volatile uint32_t *pu32Reg;             /* Writable alias of the register page */
+    SIM_REG_WRITE_T pfnWrite;
+} SIM_REGS_T;
+
+static SIM_REGS_T s_asRegs[SIM_REGS_NUM];
+static uint32_t s_u32RegsCnt;
+static SIM_REGS_T *volatile s_psTrapRegs;
+static volatile uint32_t *s_pu32Reg;        /* Writable alias of the USBD register page */
+static uint8_t *s_pu8Sram;
+static volatile uint8_t s_au8Ready[SIM_EP_NUM];
+static volatile uint32_t s_u32TrapIdx, s_u32TrapOld;
+
+static void (*s_pfnMainLoop)(void);
+static uint8_t  s_u8Verbose, s_u8Trace;
+static uint32_t s_u32Primask, s_u32NvicEn;
+static uint32_t s_u32Errors;
+
+static uint64_t s_u64Time;                  /* Bus time */
+static uint64_t s_u64LoopAt;                /* Time of the next main loop pass */
+static uint64_t s_u64IsrFree;               /* ISR has finished its work up to here */
+static uint64_t s_u64IrqDone;               /* Completion time of the scheduled ISR. 0 if none */
+static uint64_t s_u64LastEvt;               /* Time of the last hardware event */
+static uint64_t s_u64Waits;                 /* Host imposed delays, for the enumeration report */
+static SIM_STAT_T s_sStat;
+
+static uint8_t  s_u8HostAddr;
+static uint16_t s_u16Ep0Mps = 64;
+static SIM_EP_T s_asEp[32];
+static uint32_t s_u32EpCnt;
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Register model                                                                                          */
+/*---------------------------------------------------------------------------------------------------------*/
+static void Sim_UpdateUsbIf(void)
+{
+    /* USBIF is the summary of the SETUP and endpoint events */
+    if(s_pu32Reg[REG_INTSTS] & (INTSTS_SETUP | (0xFFUL << 16)))
+        s_pu32Reg[REG_INTSTS] |= INTSTS_USBIF;
+    else
+        s_pu32Reg[REG_INTSTS] &= ~INTSTS_USBIF;
+}
+
+static void Sim_RegWrite(volatile uint32_t *pu32Reg, uint32_t u32Idx, uint32_t u32Old)
+{
+    uint32_t u32New = s_pu32Reg[u32Idx];
+    uint32_t u32Ep;
+
+    (void)pu32Reg;
+
+    if(u32Idx == REG_INTSTS)
+    {
+        s_pu32Reg[REG_INTSTS] = u32Old & ~u32New;
+        Sim_UpdateUsbIf();
+    }
+    else if((u32Idx == REG_EPSTS) || (u32Idx == REG_VBUSDET))
+    {
+        s_pu32Reg[u32Idx] = u32Old;
+    }
+    else if(u32Idx == REG_ATTR)
+    {
+        s_pu32Reg[REG_ATTR] = (u32New & ~ATTR_STATE_MSK) | (u32Old & ATTR_STATE_MSK);
+    }
+    else if((u32Idx >= REG_EP0) && (u32Idx < REG_EP(SIM_EP_NUM, 0)))
+    {
+        u32Ep = (u32Idx - REG_EP0) / 4;
+        if(((u32Idx - REG_EP0) & 3) == EP_MXPLD)
+        {
+            s_au8Ready[u32Ep] = 1;
+        }
+        else if((((u32Idx - REG_EP0) & 3) == EP_CFGP) && (u32New & CFGP_CLRRDY))
+        {
+            s_au8Ready[u32Ep] = 0;
+            s_pu32Reg[u32Idx] = u32New & ~CFGP_CLRRDY;
+        }
+    }
+}
+
+static void Sim_SegvHandler(int i32Sig, siginfo_t *psInfo, void *pvCtx)
+{
+    ucontext_t *psCtx = (ucontext_t *)pvCtx;
+    uintptr_t u32Addr = (uintptr_t)psInfo->si_addr;
+    SIM_REGS_T *psRegs = NULL;
+    uint32_t i;
+
+    (void)i32Sig;
+    for(i = 0; i < s_u32RegsCnt; i++)
+    {
+        if((u32Addr >= s_asRegs[i].u32Base) && (u32Addr < s_asRegs[i].u32Base + SIM_PAGE_SIZE))
+            psRegs = &s_asRegs[i];
+    }
+    if(!psRegs)
+    {
+        /* Not a register write. Fault again with the default action */
+        signal(SIGSEGV, SIG_DFL);
+        return;
+    }
+
+    /* Let the write complete, then apply its side effects in the trap handler */
+    s_psTrapRegs = psRegs;
+    s_u32TrapIdx = (uint32_t)(u32Addr - psRegs->u32Base) / 4;
+    s_u32TrapOld = psRegs->pu32Reg[s_u32TrapIdx];
+    mprotect((void *)(uintptr_t)psRegs->u32Base, SIM_PAGE_SIZE, PROT_READ | PROT_WRITE);
+    psCtx->uc_mcontext.gregs[REG_EFL] |= 0x100;
+}
+
+static void Sim_TrapHandler(int i32Sig, siginfo_t *psInfo, void *pvCtx)
+{
+    ucontext_t *psCtx = (ucontext_t *)pvCtx;
+
+    (void)i32Sig;
+    (void)psInfo;
+    psCtx->uc_mcontext.gregs[REG_EFL] &= ~0x100;
+    mprotect((void *)(uintptr_t)s_psTrapRegs->u32Base, SIM_PAGE_SIZE, PROT_READ);
+    if(s_psTrapRegs->pfnWrite)
+        s_psTrapRegs->pfnWrite(s_psTrapRegs->pu32Reg, s_u32TrapIdx, s_u32TrapOld);
+}
+
+static void Sim_Raise(uint32_t u32Flags)
+{
+    s_pu32Reg[REG_INTSTS] |= u32Flags;
+    Sim_UpdateUsbIf();
+    s_u64LastEvt = s_u64Time;
+}
+
+static void Sim_SetEpSts(uint32_t u32Ep, uint32_t u32Sts)
+{
+    uint32_t u32Pos = 8 + u32Ep * 3;
+
+    s_pu32Reg[REG_EPSTS] = (s_pu32Reg[REG_EPSTS] & ~(7UL << u32Pos)) | (u32Sts << u32Pos);
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Firmware hooks used by sim_inc/core_cm4.h                                                               */
+/*---------------------------------------------------------------------------------------------------------*/
+void Sim_SetPrimask(uint32_t u32Primask)
+{
+    s_u32Primask = u32Primask & 1;
+}
+
+uint32_t Sim_GetPrimask(void)
+{
+    return s_u32Primask;
+}
+
+void Sim_NvicEnable(int i32IRQn, uint32_t u32Enable)
+{
+    if(i32IRQn == SIM_USBD_IRQN)
+        s_u32NvicEn = u32Enable;
+}
+
+uint32_t Sim_SysTickExpire(void)
+{
+    /* The firmware waits LOAD cycles. Delay the next main loop pass and report COUNTFLAG */
+    s_u64LoopAt += (uint64_t)(g_sSimSysTick.LOAD / CyclesPerUs) * SIM_BITS_PER_US;
+    return g_sSimSysTick.CTRL;
+}
+
+int Sim_DevPrintf(const char *pcFmt, ...)
+{
+    va_list ap;
+    int i32Ret = 0;
+
+    if(s_u8Verbose)
+    {
+        va_start(ap, pcFmt);
+        i32Ret = vprintf(pcFmt, ap);
+        va_end(ap);
+    }
+    return i32Ret;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Device CPU                                                                                              */
+/*---------------------------------------------------------------------------------------------------------*/
+static int32_t Sim_IrqPending(void)
+{
+    return s_u32NvicEn && !s_u32Primask && (s_pu32Reg[REG_INTSTS] & s_pu32Reg[REG_INTEN] & 0xF);
+}
+
+static void Sim_SetCpuTime(uint64_t u64Time)
+{
+    g_sSimDwt.CYCCNT = (uint32_t)(u64Time * (CyclesPerUs / SIM_BITS_PER_US));
+}
+
+/* Run the ISR and the main loop up to u64Until. The ISR preempts the main loop and its delays */
+static void Sim_RunDevice(uint64_t u64Until)
+{
+    uint32_t u32Idle = 0;
+
+    for(;;)
+    {
+        if(!s_u64IrqDone && Sim_IrqPending())
+            s_u64IrqDone = SIM_MAX(s_u64IsrFree, s_u64LastEvt) + SIM_ISR_US * SIM_BITS_PER_US;
+
+        if(s_u64IrqDone && (s_u64IrqDone <= u64Until) && (!s_pfnMainLoop || (s_u64IrqDone <= s_u64LoopAt)))
+        {
+            Sim_SetCpuTime(s_u64IrqDone);
+            s_u64IsrFree = s_u64IrqDone;
+            s_u64IrqDone = 0;
+            s_u64LoopAt += SIM_ISR_US * SIM_BITS_PER_US;
+            s_sStat.u32Irqs++;
+            USBD_IRQHandler();
+            u32Idle = 0;
+        }
+        else if(s_pfnMainLoop && (s_u64LoopAt <= u64Until))
+        {
+            Sim_SetCpuTime(s_u64LoopAt);
+            s_u64LoopAt += SIM_LOOP_US * SIM_BITS_PER_US;
+            s_pfnMainLoop();
+            if((++u32Idle >= SIM_LOOP_BURST) && !s_u64IrqDone && !Sim_IrqPending())
+            {
+                /* Nothing happens until the next bus event. Skip the idle passes */
+                s_u64LoopAt = SIM_MAX(s_u64LoopAt, u64Until);
+                u32Idle = 0;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Bus                                                                                                     */
+/*---------------------------------------------------------------------------------------------------------*/
+static uint32_t Sim_DataBits(const uint8_t *pu8Data, uint32_t u32Len)
+{
+    uint32_t i, j, u32Ones = 0, u32Stuff = 0;
+
+    /* A zero is stuffed after six consecutive ones of the payload */
+    for(i = 0; i < u32Len; i++)
+    {
+        for(j = 0; j < 8; j++)
+        {
+            if((pu8Data[i] >> j) & 1)
+            {
+                if(++u32Ones == 6)
+                {
+                    u32Stuff++;
+                    u32Ones = 0;
+                }
+            }
+            else
+            {
+                u32Ones = 0;
+            }
+        }
+    }
+    return 8 + 8 + u32Len * 8 + u32Stuff + 16 + 3;
+}
+
+static uint32_t Sim_Frame(void)
+{
+    return (uint32_t)(s_u64Time / SIM_FRAME_BITS);
+}
+
+static void Sim_Schedule(uint32_t u32Bits)
+{
+    uint64_t u64Pos = s_u64Time % SIM_FRAME_BITS;
+
+    if(u64Pos < SIM_SOF_BITS)
+        s_u64Time += SIM_SOF_BITS - u64Pos;
+    else if(u64Pos + u32Bits > SIM_FRAME_BITS - SIM_EOF_BITS)
+        s_u64Time += SIM_FRAME_BITS - u64Pos + SIM_SOF_BITS;
+}
+
+static void Sim_WaitFrame(uint32_t u32Frame)
+{
+    if(Sim_Frame() < u32Frame)
+    {
+        Sim_RunDevice((uint64_t)u32Frame * SIM_FRAME_BITS);
+        s_u64Time = (uint64_t)u32Frame * SIM_FRAME_BITS;
+    }
+}
+
+static int32_t Sim_Connected(void)
+{
+    uint32_t u32Attr = s_pu32Reg[REG_ATTR];
+
+    return (s_pu32Reg[REG_VBUSDET] & 1) && !(s_pu32Reg[REG_SE0] & 1) &&
+           ((u32Attr & (ATTR_USBEN | ATTR_PHYEN | ATTR_DPPUEN)) == (ATTR_USBEN | ATTR_PHYEN | ATTR_DPPUEN));
+}
+
+static int32_t Sim_FindEp(uint32_t u32EpNum, uint32_t u32State)
+{
+    uint32_t i, u32Cfg;
+
+    for(i = 0; i < SIM_EP_NUM; i++)
+    {
+        u32Cfg = s_pu32Reg[REG_EP(i, EP_CFG)];
+        if(((u32Cfg & CFG_EPNUM_MSK) == u32EpNum) && (CFG_STATE(u32Cfg) == u32State))
+            return (int32_t)i;
+    }
+    return -1;
+}
+
+static uint8_t *Sim_EpBuf(uint32_t u32Seg, uint32_t u32Len, uint32_t u32Ep)
+{
+    u32Seg &= 0x1F8;
+    if(u32Seg + u32Len > SIM_SRAM_SIZE)
+    {
+        Sim_Fail("EP%d buffer 0x%03X + %d bytes is outside the 512-byte USB SRAM", u32Ep, u32Seg, u32Len);
+        return NULL;
+    }
+    return s_pu8Sram + u32Seg;
+}
+
+static void Sim_Trace(uint32_t u32Pid, uint32_t u32EpNum, uint32_t u32Len, const char *pcResult)
+{
+    static const char *const s_apcPid[16] = {0, "OUT", 0, 0, 0, 0, 0, 0, 0, "IN", 0, 0, 0, "SETUP", 0, 0};
+
+    if(s_u8Trace)
+        printf("%12.3f ms  %-5s addr %d ep %d  %3d bytes  %s\n", (double)s_u64Time / (SIM_BITS_PER_US * 1000),
+               s_apcPid[u32Pid], s_u8HostAddr, u32EpNum, u32Len, pcResult);
+}
+
+/* One transaction. Returns 0 (ACK) or the IN data length, or a negative SIM_ERR_ code */
+static int32_t Sim_Packet(uint32_t u32Pid, uint32_t u32EpNum, uint8_t *pu8Data, uint32_t u32Len, uint32_t *pu32DataPid)
+{
+    int32_t i32Ep;
+    uint32_t i, u32Cfg, u32Iso, u32Bits;
+    uint8_t *pu8Buf;
+
+    /* Reserve the frame time for the longest outcome, then let the device catch up to the token */
+    Sim_Schedule(SIM_TOKEN_BITS + u32Len * 8 + u32Len * 8 / 6 + 38 + SIM_HSHK_BITS + 4 * SIM_GAP_BITS);
+    Sim_RunDevice(s_u64Time);
+    u32Bits = SIM_TOKEN_BITS + SIM_GAP_BITS;
+    if(u32Pid != SIM_PID_IN)
+        u32Bits += Sim_DataBits(pu8Data, u32Len) + SIM_GAP_BITS;
+
+    if(!Sim_Connected() || ((s_pu32Reg[REG_FADDR] & 0x7F) != s_u8HostAddr))
+    {
+        Sim_Trace(u32Pid, u32EpNum, u32Len, "no response");
+        s_u64Time += u32Bits + SIM_NORESP_BITS;
+        return SIM_ERR_NORESP;
+    }
+
+    if(u32Pid == SIM_PID_SETUP)
+    {
+        i32Ep = Sim_FindEp(0, STATE_OUT);
+        if((i32Ep < 0) || (Sim_FindEp(0, STATE_IN) < 0))
+        {
+            s_u64Time += u32Bits + SIM_NORESP_BITS;
+            return SIM_ERR_NORESP;
+        }
+        pu8Buf = Sim_EpBuf(s_pu32Reg[REG_STBUFSEG], 8, i32Ep);
+        if(pu8Buf)
+            memcpy(pu8Buf, pu8Data, 8);
+        for(i = 0; i < SIM_EP_NUM; i++)
+        {
+            if(s_pu32Reg[REG_EP(i, EP_CFG)] & CFG_CSTALL)
+                s_pu32Reg[REG_EP(i, EP_CFGP)] &= ~CFGP_SSTALL;
+        }
+        s_u64Time += u32Bits + SIM_HSHK_BITS + SIM_GAP_BITS;
+        s_sStat.u32Packets++;
+        Sim_SetEpSts(i32Ep, EPSTS_SETUP_ACK);
+        Sim_Raise(INTSTS_SETUP);
+        Sim_Trace(u32Pid, u32EpNum, 8, "ACK");
+        return 0;
+    }
+
+    i32Ep = Sim_FindEp(u32EpNum, (u32Pid == SIM_PID_IN) ? STATE_IN : STATE_OUT);
+    if(i32Ep < 0)
+    {
+        Sim_Trace(u32Pid, u32EpNum, u32Len, "no response, endpoint not enabled");
+        s_u64Time += u32Bits + SIM_NORESP_BITS;
+        return SIM_ERR_NORESP;
+    }
+    u32Cfg = s_pu32Reg[REG_EP(i32Ep, EP_CFG)];
+    u32Iso = u32Cfg & CFG_ISOCH;
+
+    if(s_pu32Reg[REG_EP(i32Ep, EP_CFGP)] & CFGP_SSTALL)
+    {
+        s_u64Time += u32Bits + SIM_HSHK_BITS + SIM_GAP_BITS;
+        Sim_Trace(u32Pid, u32EpNum, u32Len, "STALL");
+        return SIM_ERR_STALL;
+    }
+
+    if(!s_au8Ready[i32Ep])
+    {
+        if(u32Iso)
+        {
+            /* Isochronous endpoint without data: zero length IN, dropped OUT */
+            s_u64Time += u32Bits + ((u32Pid == SIM_PID_IN) ? Sim_DataBits(NULL, 0) + SIM_GAP_BITS : 0);
+            s_sStat.u32Packets++;
+            Sim_Trace(u32Pid, u32EpNum, 0, "ISO, endpoint not ready");
+            return 0;
+        }
+        s_u64Time += u32Bits + SIM_HSHK_BITS + SIM_GAP_BITS;
+        s_sStat.u32Naks++;
+        if(u32Pid == SIM_PID_IN)
+            Sim_SetEpSts(i32Ep, EPSTS_IN_NAK);
+        Sim_Trace(u32Pid, u32EpNum, u32Len, "NAK");
+        return SIM_ERR_NAK;
+    }
+
+    if(u32Pid == SIM_PID_IN)
+    {
+        uint32_t u32Size = s_pu32Reg[REG_EP(i32Ep, EP_MXPLD)] & 0x1FF;
+
+        if(u32Size > u32Len)
+        {
+            Sim_Fail("EP%d sent %d bytes, host asked for at most %d", i32Ep, u32Size, u32Len);
+            return SIM_ERR_PROTOCOL;
+        }
+        pu8Buf = Sim_EpBuf(s_pu32Reg[REG_EP(i32Ep, EP_BUFSEG)], u32Size, i32Ep);
+        if(!pu8Buf)
+            return SIM_ERR_PROTOCOL;
+        memcpy(pu8Data, pu8Buf, u32Size);
+        *pu32DataPid = u32Iso ? 0 : ((u32Cfg & CFG_DSQSYNC) ? 1 : 0);
+        if(!u32Iso)
+            s_pu32Reg[REG_EP(i32Ep, EP_CFG)] = u32Cfg ^ CFG_DSQSYNC;
+        u32Bits += Sim_DataBits(pu8Data, u32Size) + SIM_GAP_BITS;
+        if(!u32Iso)
+            u32Bits += SIM_HSHK_BITS + SIM_GAP_BITS;
+        s_u64Time += u32Bits;
+        s_au8Ready[i32Ep] = 0;
+        s_sStat.u32Packets++;
+        Sim_SetEpSts(i32Ep, u32Iso ? EPSTS_ISO : EPSTS_IN_ACK);
+        Sim_Raise(INTSTS_EPEVT(i32Ep));
+        Sim_Trace(u32Pid, u32EpNum, u32Size, *pu32DataPid ? "DATA1" : "DATA0");
+        return (int32_t)u32Size;
+    }
+
+    if(u32Len > (s_pu32Reg[REG_EP(i32Ep, EP_MXPLD)] & 0x1FF))
+    {
+        Sim_Fail("EP%d got %d bytes, armed for %d", i32Ep, u32Len, s_pu32Reg[REG_EP(i32Ep, EP_MXPLD)] & 0x1FF);
+        return SIM_ERR_PROTOCOL;
+    }
+    pu8Buf = Sim_EpBuf(s_pu32Reg[REG_EP(i32Ep, EP_BUFSEG)], u32Len, i32Ep);
+    if(!pu8Buf)
+        return SIM_ERR_PROTOCOL;
+    memcpy(pu8Buf, pu8Data, u32Len);
+    s_pu32Reg[REG_EP(i32Ep, EP_MXPLD)] = u32Len;
+    if(!u32Iso)
+        u32Bits += SIM_HSHK_BITS + SIM_GAP_BITS;
+    s_u64Time += u32Bits;
+    s_au8Ready[i32Ep] = 0;
+    s_sStat.u32Packets++;
+    Sim_SetEpSts(i32Ep, u32Iso ? EPSTS_ISO : (*pu32DataPid ? EPSTS_OUT1_ACK : EPSTS_OUT0_ACK));
+    Sim_Raise(INTSTS_EPEVT(i32Ep));
+    Sim_Trace(u32Pid, u32EpNum, u32Len, "ACK");
+    return 0;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Host                                                                                                    */
+/*---------------------------------------------------------------------------------------------------------*/
+void Sim_Wait(uint32_t u32Us)
+{
+    uint64_t u64End = s_u64Time + (uint64_t)u32Us * SIM_BITS_PER_US;
+
+    Sim_RunDevice(u64End);
+    s_u64Time = u64End;
+    s_u64Waits += (uint64_t)u32Us * SIM_BITS_PER_US;
+}
+
+int32_t Sim_Control(uint8_t u8Type, uint8_t u8Req, uint16_t u16Value, uint16_t u16Index, uint16_t u16Len, uint8_t *pu8Data)
+{
+    uint8_t au8Setup[8];
+    uint64_t u64Deadline;
+    uint32_t u32Pid, u32Expect, u32Done, u32Len;
+    int32_t i32Ret;
+
+    au8Setup[0] = u8Type;
+    au8Setup[1] = u8Req;
+    au8Setup[2] = u16Value & 0xFF;
+    au8Setup[3] = u16Value >> 8;
+    au8Setup[4] = u16Index & 0xFF;
+    au8Setup[5] = u16Index >> 8;
+    au8Setup[6] = u16Len & 0xFF;
+    au8Setup[7] = u16Len >> 8;
+
+    u64Deadline = s_u64Time + (uint64_t)SIM_TIMEOUT_MS * 1000 * SIM_BITS_PER_US;
+    u32Pid = 0;
+    i32Ret = Sim_Packet(SIM_PID_SETUP, 0, au8Setup, 8, &u32Pid);
+    if(i32Ret < 0)
+        return i32Ret;
+
+    /* Data stage starts with DATA1 */
+    u32Expect = 1;
+    u32Done = 0;
+    while(u32Done < u16Len)
+    {
+        u32Len = SIM_MIN(s_u16Ep0Mps, u16Len - u32Done);
+        u32Pid = u32Expect;
+        i32Ret = Sim_Packet((u8Type & 0x80) ? SIM_PID_IN : SIM_PID_OUT, 0, pu8Data + u32Done, u32Len, &u32Pid);
+        if(i32Ret == SIM_ERR_NAK)
+        {
+            if(s_u64Time > u64Deadline)
+                return SIM_ERR_NAK;
+            continue;
+        }
+        if(i32Ret < 0)
+            return i32Ret;
+        if(u32Pid != u32Expect)
+        {
+            Sim_Fail("Control request 0x%02X: data stage packet is DATA%d, expected DATA%d", u8Req, u32Pid, u32Expect);
+            return SIM_ERR_PROTOCOL;
+        }
+        u32Expect ^= 1;
+        if(u8Type & 0x80)
+        {
+            u32Done += (uint32_t)i32Ret;
+            if((uint32_t)i32Ret < s_u16Ep0Mps)
+                break;
+        }
+        else
+        {
+            u32Done += u32Len;
+        }
+    }
+    if(u32Done > u16Len)
+    {
+        Sim_Fail("Control request 0x%02X returned %d bytes, wLength is %d", u8Req, u32Done, u16Len);
+        return SIM_ERR_PROTOCOL;
+    }
+
+    /* Status stage is a zero length DATA1 packet in the other direction */
+    for(;;)
+    {
+        u32Pid = 1;
+        i32Ret = Sim_Packet((u8Type & 0x80) && u16Len ? SIM_PID_OUT : SIM_PID_IN, 0, au8Setup, 0, &u32Pid);
+        if(i32Ret == SIM_ERR_NAK)
+        {
+            if(s_u64Time > u64Deadline)
+                return SIM_ERR_NAK;
+            continue;
+        }
+        if(i32Ret < 0)
+            return i32Ret;
+        if(u32Pid != 1)
+        {
+            Sim_Fail("Control request 0x%02X: status stage is DATA0", u8Req);
+            return SIM_ERR_PROTOCOL;
+        }
+        break;
+    }
+    s_sStat.u32Controls++;
+    return (int32_t)u32Done;
+}
+
+SIM_EP_T *Sim_GetEp(uint8_t u8EpAddr)
+{
+    uint32_t i;
+
+    for(i = 0; i < s_u32EpCnt; i++)
+    {
+        if(s_asEp[i].u8Addr == u8EpAddr)
+            return &s_asEp[i];
+    }
+    return NULL;
+}
+
+int32_t Sim_Transfer(uint8_t u8EpAddr, uint8_t *pu8Buf, uint32_t u32Len, uint32_t u32Zlp)
+{
+    SIM_EP_T *psEp = Sim_GetEp(u8EpAddr);
+    uint64_t u64Deadline;
+    uint32_t u32Done, u32Size, u32Pid, u32Periodic, u32Iso;
+    int32_t i32Ret;
+
+    if(!psEp)
+    {
+        Sim_Fail("Endpoint 0x%02X is not in the configuration descriptor", u8EpAddr);
+        return SIM_ERR_NORESP;
+    }
+    u32Iso = (psEp->u8Type == 1);
+    u32Periodic = (psEp->u8Type & 1);
+    u64Deadline = s_u64Time + (uint64_t)SIM_TIMEOUT_MS * 1000 * SIM_BITS_PER_US;
+    u32Done = 0;
+    for(;;)
+    {
+        if(u32Periodic)
+            Sim_WaitFrame(psEp->u32NextFrame);
+
+        u32Size = SIM_MIN(psEp->u16MaxPkt, u32Len - u32Done);
+        u32Pid = u32Iso ? 0 : psEp->u8Toggle;
+        i32Ret = Sim_Packet((u8EpAddr & 0x80) ? SIM_PID_IN : SIM_PID_OUT, u8EpAddr & 0xF, pu8Buf + u32Done, u32Size, &u32Pid);
+        if(u32Periodic)
+            psEp->u32NextFrame = Sim_Frame() + (u32Iso ? (1U << (psEp->u8Interval - 1)) : psEp->u8Interval);
+
+        if(i32Ret == SIM_ERR_NAK)
+        {
+            if(s_u64Time > u64Deadline)
+                return SIM_ERR_NAK;
+            continue;
+        }
+        if(i32Ret < 0)
+            return i32Ret;
+        if(!u32Iso)
+        {
+            if(u32Pid != psEp->u8Toggle)
+            {
+                Sim_Fail("Endpoint 0x%02X sent DATA%d, expected DATA%d", u8EpAddr, u32Pid, psEp->u8Toggle);
+                return SIM_ERR_PROTOCOL;
+            }
+            psEp->u8Toggle ^= 1;
+        }
+        u64Deadline = s_u64Time + (uint64_t)SIM_TIMEOUT_MS * 1000 * SIM_BITS_PER_US;
+
+        if(u8EpAddr & 0x80)
+        {
+            u32Done += (uint32_t)i32Ret;
+            if(((uint32_t)i32Ret < psEp->u16MaxPkt) || (u32Done >= u32Len))
+                break;
+        }
+        else
+        {
+            u32Done += u32Size;
+            if((u32Size < psEp->u16MaxPkt) || ((u32Done >= u32Len) && !u32Zlp))
+                break;
+        }
+    }
+    return (int32_t)u32Done;
+}
+
+static int32_t Sim_EnumControl(uint8_t u8Type, uint8_t u8Req, uint16_t u16Value, uint16_t u16Index, uint16_t u16Len, uint8_t *pu8Data)
+{
+    int32_t i32Ret;
+    uint32_t u32Retry;
+
+    /* Like a host driver, retry a failed request a few times before giving up */
+    for(u32Retry = 0; u32Retry < 3; u32Retry++)
+    {
+        i32Ret = Sim_Control(u8Type, u8Req, u16Value, u16Index, u16Len, pu8Data);
+        if((i32Ret >= 0) || (i32Ret == SIM_ERR_STALL))
+            return i32Ret;
+        Sim_Wait(SIM_ENUM_RETRY_MS * 1000);
+    }
+    Sim_Fail("Request 0x%02X wValue 0x%04X failed (%d) during enumeration", u8Req, u16Value, i32Ret);
+    return i32Ret;
+}
+
+static void Sim_BusReset(void)
+{
+    /* SE0 for 10 ms, then 10 ms reset recovery */
+    s_pu32Reg[REG_ATTR] |= ATTR_USBRST;
+    Sim_Raise(INTSTS_BUSIF);
+    Sim_Wait(10000);
+    s_pu32Reg[REG_ATTR] &= ~ATTR_USBRST;
+    s_u8HostAddr = 0;
+    Sim_Wait(10000);
+}
+
+static void Sim_CheckConfig(const uint8_t *pu8Cfg, uint32_t u32CfgLen)
+{
+    uint32_t i, j, u32Seg[SIM_EP_NUM + 1], u32Len[SIM_EP_NUM + 1], u32Cfg, u32State, u32Num;
+    SIM_EP_T *psEp;
+
+    /* Parse endpoint descriptors */
+    s_u32EpCnt = 0;
+    for(i = 0; (i + 2 <= u32CfgLen) && pu8Cfg[i]; i += pu8Cfg[i])
+    {
+        if((pu8Cfg[i + 1] == 5) && (s_u32EpCnt < sizeof(s_asEp) / sizeof(s_asEp[0])))
+        {
+            psEp = &s_asEp[s_u32EpCnt++];
+            memset(psEp, 0, sizeof(*psEp));
+            psEp->u8Addr = pu8Cfg[i + 2];
+            psEp->u8Type = pu8Cfg[i + 3] & 3;
+            psEp->u16MaxPkt = pu8Cfg[i + 4] | (pu8Cfg[i + 5] << 8);
+            psEp->u8Interval = pu8Cfg[i + 6] ? pu8Cfg[i + 6] : 1;
+        }
+    }
+
+    /* Every hardware endpoint in use needs a descriptor, and its SRAM buffer must not overlap another one */
+    u32Seg[SIM_EP_NUM] = s_pu32Reg[REG_STBUFSEG] & 0x1F8;
+    u32Len[SIM_EP_NUM] = 8;
+    for(i = 0; i < SIM_EP_NUM; i++)
+    {
+        u32Cfg = s_pu32Reg[REG_EP(i, EP_CFG)];
+        u32State = CFG_STATE(u32Cfg);
+        u32Num = u32Cfg & CFG_EPNUM_MSK;
+        u32Seg[i] = s_pu32Reg[REG_EP(i, EP_BUFSEG)] & 0x1F8;
+        u32Len[i] = 0;
+        if((u32State != STATE_IN) && (u32State != STATE_OUT))
+            continue;
+        if(u32Num == 0)
+        {
+            u32Len[i] = s_u16Ep0Mps;
+            continue;
+        }
+        psEp = Sim_GetEp((uint8_t)(u32Num | ((u32State == STATE_IN) ? 0x80 : 0)));
+        if(!psEp)
+        {
+            Sim_Fail("EP%d is enabled for endpoint %d %s but the descriptor does not list it", i, u32Num,
+                     (u32State == STATE_IN) ? "IN" : "OUT");
+            continue;
+        }
+        if(((psEp->u8Type == 1) ? 1 : 0) != ((u32Cfg & CFG_ISOCH) ? 1 : 0))
+            Sim_Fail("EP%d isochronous setting does not match endpoint 0x%02X", i, psEp->u8Addr);
+        u32Len[i] = psEp->u16MaxPkt;
+    }
+    for(i = 0; i <= SIM_EP_NUM; i++)
+    {
+        if(!u32Len[i])
+            continue;
+        if(u32Seg[i] + u32Len[i] > SIM_SRAM_SIZE)
+            Sim_Fail("%s%d buffer 0x%03X + %d bytes is outside the 512-byte USB SRAM", (i == SIM_EP_NUM) ? "SETUP" : "EP",
+                     (i == SIM_EP_NUM) ? 0 : i, u32Seg[i], u32Len[i]);
+        for(j = i + 1; j <= SIM_EP_NUM; j++)
+        {
+            /* The control IN and OUT endpoints may share one buffer, only one of them is armed at a time */
+            if((j < SIM_EP_NUM) && !(s_pu32Reg[REG_EP(i, EP_CFG)] & CFG_EPNUM_MSK) &&
+                    !(s_pu32Reg[REG_EP(j, EP_CFG)] & CFG_EPNUM_MSK))
+                continue;
+            if(u32Len[j] && (u32Seg[i] < u32Seg[j] + u32Len[j]) && (u32Seg[j] < u32Seg[i] + u32Len[i]))
+                Sim_Fail("EP%d buffer 0x%03X overlaps %s%d buffer 0x%03X", i, u32Seg[i], (j == SIM_EP_NUM) ? "SETUP" : "EP",
+                         (j == SIM_EP_NUM) ? 0 : j, u32Seg[j]);
+        }
+    }
+    for(i = 0; i < s_u32EpCnt; i++)
+    {
+        if(Sim_FindEp(s_asEp[i].u8Addr & 0xF, (s_asEp[i].u8Addr & 0x80) ? STATE_IN : STATE_OUT) < 0)
+            Sim_Fail("Endpoint 0x%02X has no hardware endpoint", s_asEp[i].u8Addr);
+    }
+}
+
+void Sim_Attach(void)
+{
+    s_u64Time = SIM_MAX(s_u64Time, s_u64LoopAt);
+    s_pu32Reg[REG_VBUSDET] = 1;
+    Sim_Raise(INTSTS_VBDETIF);
+}
+
+int32_t Sim_Enumerate(void)
+{
+    uint8_t au8Buf[1024];
+    uint8_t au8Str[3];
+    SIM_STAT_T sStart;
+    uint64_t u64Waits;
+    uint32_t i, u32CfgLen;
+    int32_t i32Ret;
+
+    Sim_GetStat(&sStart);
+    u64Waits = s_u64Waits;
+
+    /* Attach debounce */
+    Sim_Wait(100000);
+    if(!Sim_Connected())
+    {
+        Sim_Fail("D+ pull-up is not enabled 100 ms after VBUS");
+        return SIM_ERR_NORESP;
+    }
+
+    /* The first request only learns bMaxPacketSize0, like the Linux and Windows hosts */
+    Sim_BusReset();
+    s_u16Ep0Mps = 64;
+    i32Ret = Sim_EnumControl(0x80, SIM_REQ_GET_DESCRIPTOR, 0x0100, 0, 64, au8Buf);
+    if(i32Ret < 8)
+        return (i32Ret < 0) ? i32Ret : SIM_ERR_PROTOCOL;
+    s_u16Ep0Mps = au8Buf[7];
+    if((s_u16Ep0Mps != 8) && (s_u16Ep0Mps != 16) && (s_u16Ep0Mps != 32) && (s_u16Ep0Mps != 64))
+    {
+        Sim_Fail("bMaxPacketSize0 %d is not valid", s_u16Ep0Mps);
+        return SIM_ERR_PROTOCOL;
+    }
+    Sim_BusReset();
+
+    i32Ret = Sim_EnumControl(0x00, SIM_REQ_SET_ADDRESS, 1, 0, 0, NULL);
+    if(i32Ret < 0)
+        return i32Ret;
+    s_u8HostAddr = 1;
+    Sim_Wait(2000);
+
+    i32Ret = Sim_EnumControl(0x80, SIM_REQ_GET_DESCRIPTOR, 0x0100, 0, 18, au8Buf);
+    if(i32Ret != 18)
+    {
+        Sim_Fail("Device descriptor is %d bytes", i32Ret);
+        return (i32Ret < 0) ? i32Ret : SIM_ERR_PROTOCOL;
+    }
+    au8Str[0] = au8Buf[14];
+    au8Str[1] = au8Buf[15];
+    au8Str[2] = au8Buf[16];
+
+    i32Ret = Sim_EnumControl(0x80, SIM_REQ_GET_DESCRIPTOR, 0x0200, 0, 9, au8Buf);
+    if(i32Ret != 9)
+        return (i32Ret < 0) ? i32Ret : SIM_ERR_PROTOCOL;
+    u32CfgLen = SIM_MIN(au8Buf[2] | (au8Buf[3] << 8), sizeof(au8Buf));
+    i32Ret = Sim_EnumControl(0x80, SIM_REQ_GET_DESCRIPTOR, 0x0200, 0, (uint16_t)u32CfgLen, au8Buf);
+    if(i32Ret != (int32_t)u32CfgLen)
+    {
+        Sim_Fail("Configuration descriptor is %d bytes, wTotalLength is %d", i32Ret, u32CfgLen);
+        return (i32Ret < 0) ? i32Ret : SIM_ERR_PROTOCOL;
+    }
+
+    /* Language table, then the strings the device descriptor refers to */
+    Sim_EnumControl(0x80, SIM_REQ_GET_DESCRIPTOR, 0x0300, 0, 255, au8Buf + u32CfgLen);
+    for(i = 0; i < 3; i++)
+    {
+        if(au8Str[i])
+            Sim_EnumControl(0x80, SIM_REQ_GET_DESCRIPTOR, 0x0300 | au8Str[i], 0x0409, 255, au8Buf + u32CfgLen);
+    }
+
+    i32Ret = Sim_EnumControl(0x00, SIM_REQ_SET_CONFIG, au8Buf[5], 0, 0, NULL);
+    if(i32Ret < 0)
+        return i32Ret;
+    Sim_CheckConfig(au8Buf, u32CfgLen);
+
+    Sim_Report("enumeration", &sStart, 0, 0);
+    printf("  %-28s %9.3f ms\n", "  spec delays included", (double)(s_u64Waits - u64Waits) / (SIM_BITS_PER_US * 1000));
+    return 0;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Report                                                                                                  */
+/*---------------------------------------------------------------------------------------------------------*/
+void Sim_GetStat(SIM_STAT_T *psStat)
+{
+    *psStat = s_sStat;
+    psStat->u64Bits = s_u64Time;
+}
+
+void Sim_Report(const char *pcWhat, const SIM_STAT_T *psStart, uint32_t u32Bytes, uint32_t u32Rounds)
+{
+    double dMs = (double)(s_u64Time - psStart->u64Bits) / (SIM_BITS_PER_US * 1000);
+
+    printf("  %-28s %9.3f ms", pcWhat, dMs);
+    if(u32Rounds)
+        printf("  %8.1f us/round", dMs * 1000 / u32Rounds);
+    if(u32Bytes && (dMs > 0))
+        printf("  %7.1f KB/s", u32Bytes / 1.024 / dMs);
+    printf("  ctrl %u  pkt %u  NAK %u  IRQ %u\n", s_sStat.u32Controls - psStart->u32Controls,
+           s_sStat.u32Packets - psStart->u32Packets, s_sStat.u32Naks - psStart->u32Naks,
+           s_sStat.u32Irqs - psStart->u32Irqs);
+}
+
+void Sim_Fail(const char *pcFmt, ...)
+{
+    va_list ap;
+
+    printf("  FAIL: ");
+    va_start(ap, pcFmt);
+    vprintf(pcFmt, ap);
+    va_end(ap);
+    printf("\n");
+    s_u32Errors++;
+}
+
+int Sim_Finish(void)
+{
+    printf("  %s\n\n", s_u32Errors ? "FAILED" : "PASSED");
+    return s_u32Errors ? 1 : 0;
+}
+
+volatile uint32_t *Sim_MapRegs(uint32_t u32Base, SIM_REG_WRITE_T pfnWrite)
+{
+    SIM_REGS_T *psRegs;
+    void *pvMap;
+    int i32Fd;
+
+    if(s_u32RegsCnt >= SIM_REGS_NUM)
+    {
+        fprintf(stderr, "Too many register pages\n");
+        exit(2);
+    }
+    psRegs = &s_asRegs[s_u32RegsCnt];
+
+    /* Read-only view at the register address for the firmware, writable alias for the model */
+    i32Fd = memfd_create("regs", 0);
+    if((i32Fd < 0) || (ftruncate(i32Fd, SIM_PAGE_SIZE) != 0))
+    {
+        perror("memfd_create");
+        exit(2);
+    }
+    pvMap = mmap((void *)(uintptr_t)u32Base, SIM_PAGE_SIZE, PROT_READ, MAP_SHARED | MAP_FIXED_NOREPLACE, i32Fd, 0);
+    if(pvMap != (void *)(uintptr_t)u32Base)
+    {
+        fprintf(stderr, "Cannot map registers at 0x%08X. Link with -no-pie.\n", u32Base);
+        exit(2);
+    }
+    psRegs->pu32Reg = (volatile uint32_t *)mmap(NULL, SIM_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, i32Fd, 0);
+    if(psRegs->pu32Reg == MAP_FAILED)
+    {
+        perror("mmap");
+        exit(2);
+    }
+    close(i32Fd);
+    psRegs->u32Base = u32Base;
+    psRegs->pfnWrite = pfnWrite;
+    s_u32RegsCnt++;
+
+    return psRegs->pu32Reg;
+}
+
+void Sim_Init(int argc, char *argv[], const char *pcName, void (*pfnMainLoop)(void))
+{
+    struct sigaction sAct;
+    void *pvMap;
+    int i;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-v") == 0)
+            s_u8Verbose = 1;
+        else if(strcmp(argv[i], "-t") == 0)
+            s_u8Trace = 1;
+    }
+    s_pfnMainLoop = pfnMainLoop;
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    printf("%s\n", pcName);
+
+    /* USBD registers, then the endpoint SRAM on its own page */
+    s_pu32Reg = Sim_MapRegs(SIM_USBD_BASE, Sim_RegWrite);
+    pvMap = mmap((void *)((USBD_BUF_BASE) & ~(SIM_PAGE_SIZE - 1)), SIM_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if(pvMap != (void *)((USBD_BUF_BASE) & ~(SIM_PAGE_SIZE - 1)))
+    {
+        fprintf(stderr, "Cannot map USB SRAM at 0x%08lX\n", (unsigned long)(USBD_BUF_BASE));
+        exit(2);
+    }
+    s_pu8Sram = (uint8_t *)(USBD_BUF_BASE);
+
+    memset(&sAct, 0, sizeof(sAct));
+    sAct.sa_flags = SA_SIGINFO;
+    sAct.sa_sigaction = Sim_SegvHandler;
+    sigaction(SIGSEGV, &sAct, NULL);
+    sAct.sa_sigaction = Sim_TrapHandler;
+    sigaction(SIGTRAP, &sAct, NULL);
+}
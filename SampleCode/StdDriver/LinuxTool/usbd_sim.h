@@ -0,0 +1,66 @@
+/**************************************************************************//**
+ * @file     usbd_sim.h
+ * @version  V1.00
+ * @brief    USBD controller model and scripted full-speed host for Linux
+ *
+ * @note
+ *           See usbd_sim.c for the model and usbd_sim.sh for the build.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __USBD_SIM_H__
+#define __USBD_SIM_H__
+
+#include <stdint.h>
+
+#define SIM_BITS_PER_US     12          /* Full speed, 12 Mbit/s */
+#define SIM_FRAME_BITS      12000       /* 1 ms frame */
+
+/* Transfer results. Non-negative values are byte counts */
+#define SIM_ERR_NAK         (-1)        /* Endpoint kept NAKing until the transfer timeout */
+#define SIM_ERR_STALL       (-2)        /* Endpoint returned STALL */
+#define SIM_ERR_NORESP      (-3)        /* No handshake. Device, address or endpoint is not enabled */
+#define SIM_ERR_PROTOCOL    (-4)        /* Wrong data PID, packet size or buffer range */
+
+/* Standard request helpers */
+#define SIM_REQ_GET_DESCRIPTOR  0x06
+#define SIM_REQ_SET_ADDRESS     0x05
+#define SIM_REQ_SET_CONFIG      0x09
+
+typedef struct
+{
+    uint8_t  u8Addr;            /* bEndpointAddress */
+    uint8_t  u8Type;            /* bmAttributes[1:0] */
+    uint16_t u16MaxPkt;         /* wMaxPacketSize */
+    uint8_t  u8Interval;        /* bInterval in frames */
+    uint8_t  u8Toggle;          /* Host data toggle */
+    uint32_t u32NextFrame;      /* First frame the periodic endpoint may be polled again */
+} SIM_EP_T;
+
+typedef struct
+{
+    uint64_t u64Bits;           /* Bus time in bit times */
+    uint32_t u32Packets;        /* Data packets on the bus, including zero length ones */
+    uint32_t u32Naks;           /* NAK handshakes */
+    uint32_t u32Irqs;           /* USBD_IRQHandler() calls */
+    uint32_t u32Controls;       /* Completed control transfers */
+} SIM_STAT_T;
+
+/* Register write side effects. pu32Reg is the writable alias of the page, u32Old the value before the write */
+typedef void (*SIM_REG_WRITE_T)(volatile uint32_t *pu32Reg, uint32_t u32Idx, uint32_t u32Old);
+
+void     Sim_Init(int argc, char *argv[], const char *pcName, void (*pfnMainLoop)(void));
+void     Sim_Attach(void);
+int32_t  Sim_Enumerate(void);
+int32_t  Sim_Control(uint8_t u8Type, uint8_t u8Req, uint16_t u16Value, uint16_t u16Index, uint16_t u16Len, uint8_t *pu8Data);
+int32_t  Sim_Transfer(uint8_t u8EpAddr, uint8_t *pu8Buf, uint32_t u32Len, uint32_t u32Zlp);
+SIM_EP_T *Sim_GetEp(uint8_t u8EpAddr);
+void     Sim_Wait(uint32_t u32Us);
+void     Sim_GetStat(SIM_STAT_T *psStat);
+void     Sim_Report(const char *pcWhat, const SIM_STAT_T *psStart, uint32_t u32Bytes, uint32_t u32Rounds);
+void     Sim_Fail(const char *pcFmt, ...);
+int      Sim_Finish(void);
+volatile uint32_t *Sim_MapRegs(uint32_t u32Base, SIM_REG_WRITE_T pfnWrite);
+
+#endif /* __USBD_SIM_H__ */
@@ -0,0 +1,44 @@
+#!/bin/sh
+#
+# Build and run the USBD simulator scripts on x86 Linux.
+#
+#   usbd_sim.sh [-v] [-t]      options are passed to every script, see usbd_sim.c
+#
+# Each script links usbd.c and the class files of its sample unmodified. Exit status is non-zero if any
+# script reports a failure.
+#
+# SPDX-License-Identifier: Apache-2.0
+# Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+
+TOOL=$(cd "$(dirname "$0")" && pwd)
+BSP=$TOOL/../../..
+SAMPLE=$TOOL/..
+OUT=${OUT:-/tmp/usbd_sim}
+CC=${CC:-gcc}
+
+# USB SRAM is moved off the register page, globals stay below 4 GB for the 32-bit address casts
+CFLAGS="-O2 -g -Wall -Wno-pointer-to-int-cast -Wno-int-to-pointer-cast -no-pie -DUSBD_BUF_BASE=0x400C1000
+        -I$TOOL/sim_inc -I$TOOL -I$BSP/Library/Device/Nuvoton/M451Series/Include -I$BSP/Library/StdDriver/inc"
+
+mkdir -p "$OUT" || exit 2
+STATUS=0
+
+run()
+{
+    NAME=$1
+    shift
+    $CC $CFLAGS -I"$SAMPLE/$NAME" -o "$OUT/$NAME" "$TOOL/usbd_sim.c" "$BSP/Library/StdDriver/src/usbd.c" "$@" || exit 2
+    "$OUT/$NAME" $OPTS || STATUS=1
+}
+
+OPTS="$*"
+run USBD_HID_Transfer $TOOL/usbd_sim_hid.c $SAMPLE/USBD_HID_Transfer/hid_transfer.c $SAMPLE/USBD_HID_Transfer/descriptors.c
+run USBD_VENDOR_LBK $TOOL/usbd_sim_lbk.c $SAMPLE/USBD_VENDOR_LBK/vendor_lbk.c $SAMPLE/USBD_VENDOR_LBK/descriptors.c
+run USBD_Micro_Printer $TOOL/usbd_sim_ptr.c $SAMPLE/USBD_Micro_Printer/micro_printer.c $SAMPLE/USBD_Micro_Printer/descriptors.c
+run USBD_Audio_NAU8822 $TOOL/usbd_sim_uac.c $SAMPLE/USBD_Audio_NAU8822/usbd_audio.c $SAMPLE/USBD_Audio_NAU8822/descriptors.c
+run USBD_MassStorage_CDROM $TOOL/usbd_sim_cdrom.c $SAMPLE/USBD_MassStorage_CDROM/MassStorage.c $SAMPLE/USBD_MassStorage_CDROM/descriptors.c \
+    $SAMPLE/USBD_MassStorage_CDROM/DiskImg.c
+run USBD_MassStorage_DataFlash $TOOL/usbd_sim_msc.c $SAMPLE/USBD_MassStorage_DataFlash/MassStorage.c \
+    $SAMPLE/USBD_MassStorage_DataFlash/DataFlashProg.c $SAMPLE/USBD_MassStorage_DataFlash/descriptors.c
+
+exit $STATUS
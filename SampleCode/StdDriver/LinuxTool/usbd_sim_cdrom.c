@@ -0,0 +1,169 @@
+/**************************************************************************//**
+ * @file     usbd_sim_cdrom.c
+ * @version  V1.00
+ * @brief    Host script for USBD_MassStorage_CDROM on the USBD simulator
+ *
+ * @note
+ *           Build : see usbd_sim.sh
+ *
+ *           Sends Bulk-Only commands like a host CD-ROM driver: INQUIRY, READ CAPACITY, then READ(10) of the
+ *           whole disc in one command, of every sector alone in reverse order and of 1 to 4 sectors from every
+ *           LBA, so that reads start, end and cross the 32 KB system area anywhere. The data must be zeros in
+ *           the system area and eprom[] of DiskImg.c after it, and every CSW must pass with no residue.
+ *           The image is the default internal flash media (CDROM_MEDIA_FLASH).
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "M451Series.h"
+#include "massstorage.h"
+#include "usbd_sim.h"
+
+#undef printf                   /* Script output is not firmware output */
+
+#define DISC_SECTORS        (MSC_ImageSize / CDROM_BLOCK_SIZE)
+#define DISC_SIZE           (DISC_SECTORS * CDROM_BLOCK_SIZE)
+
+static uint8_t s_au8Disc[DISC_SIZE];    /* Data the host must read */
+static uint8_t s_au8Buf[DISC_SIZE];
+static uint32_t s_u32Tag;
+
+static void PutBe32(uint8_t *pu8Buf, uint32_t u32Val)
+{
+    pu8Buf[0] = (uint8_t)(u32Val >> 24);
+    pu8Buf[1] = (uint8_t)(u32Val >> 16);
+    pu8Buf[2] = (uint8_t)(u32Val >> 8);
+    pu8Buf[3] = (uint8_t)u32Val;
+}
+
+static uint32_t GetBe32(const uint8_t *pu8Buf)
+{
+    return ((uint32_t)pu8Buf[0] << 24) | ((uint32_t)pu8Buf[1] << 16) | ((uint32_t)pu8Buf[2] << 8) | pu8Buf[3];
+}
+
+static uint32_t GetLe32(const uint8_t *pu8Buf)
+{
+    return ((uint32_t)pu8Buf[3] << 24) | ((uint32_t)pu8Buf[2] << 16) | ((uint32_t)pu8Buf[1] << 8) | pu8Buf[0];
+}
+
+/* One Bulk-Only IN command. Return the CSW status, or -1 if the transport fails. */
+static int32_t Bot(const uint8_t *pu8Cdb, uint32_t u32CdbLen, uint8_t *pu8Data, uint32_t u32Len)
+{
+    uint8_t au8Cbw[31], au8Csw[13];
+
+    memset(au8Cbw, 0, sizeof(au8Cbw));
+    au8Cbw[0] = (uint8_t)CBW_SIGNATURE;
+    au8Cbw[1] = (uint8_t)(CBW_SIGNATURE >> 8);
+    au8Cbw[2] = (uint8_t)(CBW_SIGNATURE >> 16);
+    au8Cbw[3] = (uint8_t)(CBW_SIGNATURE >> 24);
+    s_u32Tag++;
+    memcpy(&au8Cbw[4], &s_u32Tag, 4);
+    au8Cbw[8] = (uint8_t)u32Len;
+    au8Cbw[9] = (uint8_t)(u32Len >> 8);
+    au8Cbw[10] = (uint8_t)(u32Len >> 16);
+    au8Cbw[11] = (uint8_t)(u32Len >> 24);
+    au8Cbw[12] = 0x80;
+    au8Cbw[14] = (uint8_t)u32CdbLen;
+    memcpy(&au8Cbw[15], pu8Cdb, u32CdbLen);
+
+    if(Sim_Transfer(BULK_OUT_EP_NUM | EP_OUTPUT, au8Cbw, sizeof(au8Cbw), 0) != sizeof(au8Cbw))
+    {
+        Sim_Fail("CBW of command 0x%02X failed", pu8Cdb[0]);
+        return -1;
+    }
+    if(u32Len && (Sim_Transfer(BULK_IN_EP_NUM | EP_INPUT, pu8Data, u32Len, 0) != (int32_t)u32Len))
+    {
+        Sim_Fail("Data of command 0x%02X is not %u bytes", pu8Cdb[0], u32Len);
+        return -1;
+    }
+    if((Sim_Transfer(BULK_IN_EP_NUM | EP_INPUT, au8Csw, sizeof(au8Csw), 0) != sizeof(au8Csw)) ||
+            (GetLe32(&au8Csw[0]) != CSW_SIGNATURE) || (GetLe32(&au8Csw[4]) != s_u32Tag))
+    {
+        Sim_Fail("No valid CSW for command 0x%02X", pu8Cdb[0]);
+        return -1;
+    }
+    if(GetLe32(&au8Csw[8]) != 0)
+        Sim_Fail("Command 0x%02X has residue %u", pu8Cdb[0], GetLe32(&au8Csw[8]));
+
+    return au8Csw[12];
+}
+
+/* READ(10) of u32Num sectors from u32Lba, checked against the disc */
+static void Read(uint32_t u32Lba, uint32_t u32Num)
+{
+    uint8_t au8Cdb[10];
+
+    memset(au8Cdb, 0, sizeof(au8Cdb));
+    au8Cdb[0] = UFI_READ_10;
+    PutBe32(&au8Cdb[2], u32Lba);
+    au8Cdb[7] = (uint8_t)(u32Num >> 8);
+    au8Cdb[8] = (uint8_t)u32Num;
+
+    memset(s_au8Buf, 0xA5, u32Num * CDROM_BLOCK_SIZE);
+    if(Bot(au8Cdb, sizeof(au8Cdb), s_au8Buf, u32Num * CDROM_BLOCK_SIZE) != 0)
+        Sim_Fail("READ(10) of LBA %u, %u sectors failed", u32Lba, u32Num);
+    else if(memcmp(s_au8Buf, &s_au8Disc[u32Lba * CDROM_BLOCK_SIZE], u32Num * CDROM_BLOCK_SIZE))
+        Sim_Fail("READ(10) of LBA %u, %u sectors returned wrong data", u32Lba, u32Num);
+}
+
+/* Same main loop as the sample, without power down */
+static void MainLoop(void)
+{
+    MSC_ProcessCmd();
+}
+
+int main(int argc, char *argv[])
+{
+    uint8_t au8Cdb[10];
+    uint32_t u32Lba, u32Num, u32Cmds;
+    SIM_STAT_T sStart;
+
+    Sim_Init(argc, argv, "USBD_MassStorage_CDROM", MainLoop);
+
+    /* Same start-up as main() of the sample */
+    USBD_Open(&gsInfo, MSC_ClassRequest, NULL);
+    MSC_Init();
+    USBD_Start();
+    NVIC_EnableIRQ(USBD_IRQn);
+
+    /* System area is zeros, then the ISO data from offset 32768 */
+    memcpy(&s_au8Disc[CDROM_SYS_AREA_SIZE], eprom, DISC_SIZE - CDROM_SYS_AREA_SIZE);
+
+    Sim_Attach();
+    if(Sim_Enumerate() < 0)
+        return Sim_Finish();
+
+    memset(au8Cdb, 0, sizeof(au8Cdb));
+    au8Cdb[0] = UFI_INQUIRY;
+    au8Cdb[4] = 36;
+    if((Bot(au8Cdb, 6, s_au8Buf, 36) != 0) || ((s_au8Buf[0] & 0x1F) != 0x05))
+        Sim_Fail("INQUIRY does not return a CD-ROM device");
+
+    memset(au8Cdb, 0, sizeof(au8Cdb));
+    au8Cdb[0] = UFI_READ_CAPACITY;
+    if((Bot(au8Cdb, 10, s_au8Buf, 8) != 0) || (GetBe32(&s_au8Buf[0]) != DISC_SECTORS - 1) ||
+            (GetBe32(&s_au8Buf[4]) != CDROM_BLOCK_SIZE))
+        Sim_Fail("READ CAPACITY is not %u sectors of %u bytes", DISC_SECTORS, CDROM_BLOCK_SIZE);
+
+    Sim_GetStat(&sStart);
+    Read(0, DISC_SECTORS);
+    Sim_Report("read whole disc", &sStart, DISC_SIZE, 1);
+
+    Sim_GetStat(&sStart);
+    for(u32Lba = DISC_SECTORS; u32Lba > 0; u32Lba--)
+        Read(u32Lba - 1, 1);
+    Sim_Report("read sectors in reverse", &sStart, DISC_SIZE, DISC_SECTORS);
+
+    Sim_GetStat(&sStart);
+    u32Cmds = 0;
+    for(u32Lba = 0; u32Lba < DISC_SECTORS; u32Lba++)
+    {
+        for(u32Num = 1; (u32Num <= 4) && (u32Lba + u32Num <= DISC_SECTORS); u32Num++, u32Cmds++)
+            Read(u32Lba, u32Num);
+    }
+    Sim_Report("read 1~4 sectors at every LBA", &sStart, 0, u32Cmds);
+
+    return Sim_Finish();
+}
@@ -0,0 +1,124 @@
+/**************************************************************************//**
+ * @file     usbd_sim_hid.c
+ * @version  V1.00
+ * @brief    Host script for USBD_HID_Transfer on the USBD simulator
+ *
+ * @note
+ *           Build : see usbd_sim.sh
+ *
+ *           Enumerates the sample like a HID host driver, measures the GET_IDLE round trip, then writes the
+ *           test pages with HID OUT reports and reads them back with HID IN reports through the command
+ *           protocol of the Windows tool.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "M451Series.h"
+#include "hid_transfer.h"
+#include "usbd_sim.h"
+
+#undef printf                   /* Script output is not firmware output */
+
+#define HID_CMD_SIGNATURE   0x43444948
+#define HID_CMD_ERASE       0x71
+#define HID_CMD_READ        0xD2
+#define HID_CMD_WRITE       0xC3
+#define HID_CMD_SIZE        14          /* Command bytes covered by the checksum */
+#define PAGE_SIZE           2048
+#define TEST_PAGES          4
+#define START_SECTOR        0x10
+#define SECTOR_SIZE         4096
+
+#define ROUNDS              100
+
+static void PutWord(uint8_t *pu8Buf, uint32_t u32Data)
+{
+    pu8Buf[0] = (uint8_t)u32Data;
+    pu8Buf[1] = (uint8_t)(u32Data >> 8);
+    pu8Buf[2] = (uint8_t)(u32Data >> 16);
+    pu8Buf[3] = (uint8_t)(u32Data >> 24);
+}
+
+static int32_t HidCommand(uint8_t u8Cmd, uint32_t u32Arg1, uint32_t u32Arg2)
+{
+    uint8_t au8Pkt[EP3_MAX_PKT_SIZE];
+    uint32_t i, u32Sum;
+
+    memset(au8Pkt, 0, sizeof(au8Pkt));
+    au8Pkt[0] = u8Cmd;
+    au8Pkt[1] = HID_CMD_SIZE;
+    PutWord(&au8Pkt[2], u32Arg1);
+    PutWord(&au8Pkt[6], u32Arg2);
+    PutWord(&au8Pkt[10], HID_CMD_SIGNATURE);
+    for(i = 0, u32Sum = 0; i < HID_CMD_SIZE; i++)
+        u32Sum += au8Pkt[i];
+    PutWord(&au8Pkt[HID_CMD_SIZE], u32Sum);
+
+    return Sim_Transfer(INT_OUT_EP_NUM | EP_OUTPUT, au8Pkt, sizeof(au8Pkt), 0);
+}
+
+int main(int argc, char *argv[])
+{
+    static uint8_t au8Out[TEST_PAGES * PAGE_SIZE], au8In[TEST_PAGES * PAGE_SIZE];
+    uint8_t au8Buf[256];
+    SIM_STAT_T sStart;
+    uint32_t i;
+    int32_t i32Ret;
+
+    Sim_Init(argc, argv, "USBD_HID_Transfer", HID_Process);
+
+    /* Same start-up as main() of the sample */
+    USBD_Open(&gsInfo, HID_ClassRequest, NULL);
+    HID_Init();
+    USBD_Start();
+    NVIC_EnableIRQ(USBD_IRQn);
+
+    Sim_Attach();
+    if(Sim_Enumerate() < 0)
+        return Sim_Finish();
+
+    /* HID driver start-up */
+    i32Ret = Sim_Control(0x81, SIM_REQ_GET_DESCRIPTOR, 0x2200, 0, sizeof(au8Buf), au8Buf);
+    if(i32Ret <= 0)
+        Sim_Fail("Report descriptor request failed (%d)", i32Ret);
+    if(Sim_Control(0x21, SET_IDLE, 0, 0, 0, NULL) < 0)
+        Sim_Fail("SET_IDLE failed");
+
+    Sim_GetStat(&sStart);
+    for(i = 0; i < ROUNDS; i++)
+    {
+        i32Ret = Sim_Control(0xA1, GET_IDLE, 0, 0, 1, au8Buf);
+        if(i32Ret != 1)
+        {
+            Sim_Fail("GET_IDLE returned %d", i32Ret);
+            break;
+        }
+    }
+    Sim_Report("GET_IDLE round trip", &sStart, 0, ROUNDS);
+
+    for(i = 0; i < sizeof(au8Out); i++)
+        au8Out[i] = (uint8_t)(i * 7 + (i >> 8));
+
+    if(HidCommand(HID_CMD_ERASE, START_SECTOR, sizeof(au8Out) / SECTOR_SIZE) < 0)
+        Sim_Fail("Erase command failed");
+
+    Sim_GetStat(&sStart);
+    if((HidCommand(HID_CMD_WRITE, 0, TEST_PAGES) < 0) ||
+            (Sim_Transfer(INT_OUT_EP_NUM | EP_OUTPUT, au8Out, sizeof(au8Out), 0) != sizeof(au8Out)))
+        Sim_Fail("Page write failed");
+    Sim_Report("interrupt OUT page write", &sStart, sizeof(au8Out), 0);
+
+    Sim_GetStat(&sStart);
+    if(HidCommand(HID_CMD_READ, 0, TEST_PAGES) < 0)
+        Sim_Fail("Read command failed");
+    i32Ret = Sim_Transfer(INT_IN_EP_NUM | EP_INPUT, au8In, sizeof(au8In), 0);
+    if(i32Ret != sizeof(au8In))
+        Sim_Fail("Page read returned %d bytes", i32Ret);
+    else if(memcmp(au8In, au8Out, sizeof(au8In)) != 0)
+        Sim_Fail("Pages read back differ from the written pages");
+    Sim_Report("interrupt IN page read", &sStart, sizeof(au8In), 0);
+
+    return Sim_Finish();
+}
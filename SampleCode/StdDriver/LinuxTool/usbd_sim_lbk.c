@@ -0,0 +1,110 @@
+/**************************************************************************//**
+ * @file     usbd_sim_lbk.c
+ * @version  V1.00
+ * @brief    Host script for USBD_VENDOR_LBK on the USBD simulator
+ *
+ * @note
+ *           Build : see usbd_sim.sh
+ *
+ *           Runs the control, interrupt, isochronous and bulk loopbacks of the sample and checks that
+ *           every packet comes back unchanged.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "M451Series.h"
+#include "vendor_lbk.h"
+#include "usbd_sim.h"
+
+#undef printf                   /* Script output is not firmware output */
+
+#define CTRL_ROUNDS         100
+#define INT_ROUNDS          100
+#define ISO_ROUNDS          100
+#define BULK_ROUNDS         1024
+#define STALE_POLLS         3
+
+static void Fill(uint8_t *pu8Buf, uint32_t u32Len, uint32_t u32Seed)
+{
+    uint32_t i;
+
+    for(i = 0; i < u32Len; i++)
+        pu8Buf[i] = (uint8_t)(u32Seed * 13 + i);
+}
+
+/* OUT one packet, IN one packet, compare */
+static uint32_t Loopback(const char *pcWhat, uint8_t u8Out, uint8_t u8In, uint32_t u32Len, uint32_t u32Rounds)
+{
+    uint8_t au8Out[256], au8In[256];
+    SIM_STAT_T sStart;
+    uint32_t i, j;
+    int32_t i32Ret;
+
+    Sim_GetStat(&sStart);
+    for(i = 0; i < u32Rounds; i++)
+    {
+        Fill(au8Out, u32Len, i);
+        i32Ret = Sim_Transfer(u8Out, au8Out, u32Len, 0);
+        if(i32Ret != (int32_t)u32Len)
+        {
+            Sim_Fail("%s: OUT round %d returned %d", pcWhat, i, i32Ret);
+            break;
+        }
+        /* Interrupt and isochronous IN endpoints are always armed. A poll in the same frame as the OUT
+           returns the previous packet, so poll again before calling it a failure */
+        for(j = 0; j < STALE_POLLS; j++)
+        {
+            i32Ret = Sim_Transfer(u8In, au8In, u32Len, 0);
+            if((i32Ret == (int32_t)u32Len) && !memcmp(au8In, au8Out, u32Len))
+                break;
+        }
+        if(j == STALE_POLLS)
+        {
+            Sim_Fail("%s: IN round %d did not return the OUT data", pcWhat, i);
+            break;
+        }
+    }
+    Sim_Report(pcWhat, &sStart, u32Len * i, u32Rounds);
+    return i;
+}
+
+int main(int argc, char *argv[])
+{
+    uint8_t au8Out[EP0_MAX_PKT_SIZE], au8In[EP0_MAX_PKT_SIZE];
+    SIM_STAT_T sStart;
+    uint32_t i;
+
+    Sim_Init(argc, argv, "USBD_VENDOR_LBK", VendorLBK_ProcessData);
+
+    /* Same start-up as main() of the sample */
+    USBD_Open(&gsInfo, VendorLBK_ClassRequest, NULL);
+    VendorLBK_Init();
+    USBD_Start();
+    NVIC_EnableIRQ(USBD_IRQn);
+
+    Sim_Attach();
+    if(Sim_Enumerate() < 0)
+        return Sim_Finish();
+
+    Sim_GetStat(&sStart);
+    for(i = 0; i < CTRL_ROUNDS; i++)
+    {
+        Fill(au8Out, sizeof(au8Out), i);
+        if((Sim_Control(0x21, REQ_SET_DATA, 0, 0, sizeof(au8Out), au8Out) != sizeof(au8Out)) ||
+                (Sim_Control(0xA1, REQ_GET_DATA, 0, 0, sizeof(au8In), au8In) != sizeof(au8In)) ||
+                memcmp(au8In, au8Out, sizeof(au8In)))
+        {
+            Sim_Fail("Control loopback round %d failed", i);
+            break;
+        }
+    }
+    Sim_Report("control SET+GET_DATA", &sStart, sizeof(au8Out) * i, CTRL_ROUNDS * 2);
+
+    Loopback("interrupt loopback", INT_OUT_EP_NUM | EP_OUTPUT, INT_IN_EP_NUM | EP_INPUT, EP3_MAX_PKT_SIZE, INT_ROUNDS);
+    Loopback("isochronous loopback", ISO_OUT_EP_NUM | EP_OUTPUT, ISO_IN_EP_NUM | EP_INPUT, EP5_MAX_PKT_SIZE, ISO_ROUNDS);
+    Loopback("bulk loopback", BULK_OUT_EP_NUM | EP_OUTPUT, BULK_IN_EP_NUM | EP_INPUT, EP7_MAX_PKT_SIZE, BULK_ROUNDS);
+
+    return Sim_Finish();
+}
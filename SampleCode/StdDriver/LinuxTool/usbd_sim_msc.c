@@ -0,0 +1,357 @@
+/**************************************************************************//**
+ * @file     usbd_sim_msc.c
+ * @version  V1.00
+ * @brief    Host script for USBD_MassStorage_DataFlash on the USBD simulator
+ *
+ * @note
+ *           Build : see usbd_sim.sh
+ *
+ *           The data flash used by the flash translation layer is a page at FTL_BASE that the firmware reads
+ *           directly. The FMC ISP registers are trapped with Sim_MapRegs(): ISPTRG runs the read, program and
+ *           page erase commands on the model. Programming only clears bits, and a word programmed twice
+ *           without an erase fails the script. FMC_WriteMultiple() is replaced by a direct multi-word program.
+ *           Flash program and erase times are not modelled.
+ *
+ *           Sends Bulk-Only commands like a host disk driver: INQUIRY, READ CAPACITY, a blank disk read, a
+ *           whole disk write, then random WRITE(10) of 1 to 8 sectors with idle gaps for the reclaim of
+ *           FTL_Process(). Every read must match the host copy of the disk, also after FTL_Init() mounts the
+ *           flash again as after a reset. Every CSW must pass with no residue.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "M451Series.h"
+#include "massstorage.h"
+#include "DataFlashProg.h"
+#include "usbd_sim.h"
+
+#undef printf                   /* Script output is not firmware output */
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE MAP_FIXED
+#endif
+
+#define FLASH_SIZE          (FTL_BLOCK_NUM * FTL_BLOCK_SIZE)
+#define FLASH_PAGES         (FLASH_SIZE / FLASH_PAGE_SIZE)
+#define DISK_SECTORS        (DATA_FLASH_STORAGE_SIZE / UDC_SECTOR_SIZE)
+#define RANDOM_WRITES       1500
+#define CHECK_EVERY         100         /* Idle gap and whole disk check every this many writes */
+#define IDLE_GAP_MS         20
+
+#define REG_ISPCTL          (0x00 / 4)
+#define REG_ISPADDR         (0x04 / 4)
+#define REG_ISPDAT          (0x08 / 4)
+#define REG_ISPCMD          (0x0C / 4)
+#define REG_ISPTRG          (0x10 / 4)
+
+int32_t g_FMC_i32ErrCode;
+
+static uint8_t *s_pu8Flash;            /* Writable alias of the data flash. The firmware reads it at FTL_BASE. */
+static uint32_t s_au32Erases[FLASH_PAGES];
+static uint8_t s_au8Disk[DATA_FLASH_STORAGE_SIZE];      /* Host copy of the disk */
+static uint8_t s_au8Buf[DATA_FLASH_STORAGE_SIZE];
+static uint32_t s_u32Tag;
+static uint32_t s_u32Seed = 1;
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Data flash model                                                                                        */
+/*---------------------------------------------------------------------------------------------------------*/
+static int32_t FlashProgram(uint32_t u32Addr, uint32_t u32Data)
+{
+    uint32_t *pu32Word = (uint32_t *)&s_pu8Flash[u32Addr - FTL_BASE];
+
+    if((u32Addr < FTL_BASE) || (u32Addr >= FTL_BASE + FLASH_SIZE) || (u32Addr & 3))
+    {
+        Sim_Fail("Program outside the data flash at 0x%08X", u32Addr);
+        return -1;
+    }
+    if(*pu32Word != 0xFFFFFFFF)
+        Sim_Fail("Word at 0x%08X programmed twice without erase", u32Addr);
+
+    *pu32Word &= u32Data;
+    return 0;
+}
+
+static void FmcRegWrite(volatile uint32_t *pu32Reg, uint32_t u32Idx, uint32_t u32Old)
+{
+    uint32_t u32Addr = pu32Reg[REG_ISPADDR];
+
+    if(u32Idx == REG_ISPCTL)
+    {
+        /* ISPFF is write-1-to-clear */
+        if(pu32Reg[REG_ISPCTL] & FMC_ISPCTL_ISPFF_Msk)
+            pu32Reg[REG_ISPCTL] &= ~FMC_ISPCTL_ISPFF_Msk;
+        else
+            pu32Reg[REG_ISPCTL] |= u32Old & FMC_ISPCTL_ISPFF_Msk;
+        return;
+    }
+    if((u32Idx != REG_ISPTRG) || !(pu32Reg[REG_ISPTRG] & 1))
+        return;
+
+    switch(pu32Reg[REG_ISPCMD])
+    {
+        case FMC_ISPCMD_READ:
+            if((u32Addr >= FTL_BASE) && (u32Addr < FTL_BASE + FLASH_SIZE))
+                pu32Reg[REG_ISPDAT] = *(uint32_t *)&s_pu8Flash[(u32Addr - FTL_BASE) & ~3UL];
+            else
+                pu32Reg[REG_ISPCTL] |= FMC_ISPCTL_ISPFF_Msk;
+            break;
+
+        case FMC_ISPCMD_PROGRAM:
+            if(FlashProgram(u32Addr, pu32Reg[REG_ISPDAT]))
+                pu32Reg[REG_ISPCTL] |= FMC_ISPCTL_ISPFF_Msk;
+            break;
+
+        case FMC_ISPCMD_PAGE_ERASE:
+            if((u32Addr < FTL_BASE) || (u32Addr >= FTL_BASE + FLASH_SIZE) || (u32Addr & (FLASH_PAGE_SIZE - 1)))
+            {
+                Sim_Fail("Page erase outside the data flash at 0x%08X", u32Addr);
+                pu32Reg[REG_ISPCTL] |= FMC_ISPCTL_ISPFF_Msk;
+                break;
+            }
+            memset(&s_pu8Flash[u32Addr - FTL_BASE], 0xFF, FLASH_PAGE_SIZE);
+            s_au32Erases[(u32Addr - FTL_BASE) / FLASH_PAGE_SIZE]++;
+            break;
+
+        default:
+            Sim_Fail("ISP command 0x%02X is not modelled", pu32Reg[REG_ISPCMD]);
+            pu32Reg[REG_ISPCTL] |= FMC_ISPCTL_ISPFF_Msk;
+            break;
+    }
+
+    pu32Reg[REG_ISPTRG] = 0;
+}
+
+/* Multi-word program of fmc.c */
+int32_t FMC_WriteMultiple(uint32_t u32Addr, uint32_t *pu32Buf, uint32_t u32Len)
+{
+    uint32_t i;
+
+    g_FMC_i32ErrCode = 0;
+    for(i = 0; i < u32Len; i += 4)
+    {
+        if(FlashProgram(u32Addr + i, pu32Buf[i / 4]))
+        {
+            g_FMC_i32ErrCode = -1;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Host                                                                                                    */
+/*---------------------------------------------------------------------------------------------------------*/
+static uint32_t Random(void)
+{
+    /* xorshift32 */
+    s_u32Seed ^= s_u32Seed << 13;
+    s_u32Seed ^= s_u32Seed >> 17;
+    s_u32Seed ^= s_u32Seed << 5;
+    return s_u32Seed;
+}
+
+static void PutBe32(uint8_t *pu8Buf, uint32_t u32Val)
+{
+    pu8Buf[0] = (uint8_t)(u32Val >> 24);
+    pu8Buf[1] = (uint8_t)(u32Val >> 16);
+    pu8Buf[2] = (uint8_t)(u32Val >> 8);
+    pu8Buf[3] = (uint8_t)u32Val;
+}
+
+static uint32_t GetBe32(const uint8_t *pu8Buf)
+{
+    return ((uint32_t)pu8Buf[0] << 24) | ((uint32_t)pu8Buf[1] << 16) | ((uint32_t)pu8Buf[2] << 8) | pu8Buf[3];
+}
+
+static uint32_t GetLe32(const uint8_t *pu8Buf)
+{
+    return ((uint32_t)pu8Buf[3] << 24) | ((uint32_t)pu8Buf[2] << 16) | ((uint32_t)pu8Buf[1] << 8) | pu8Buf[0];
+}
+
+/* One Bulk-Only command. Return the CSW status, or -1 if the transport fails. */
+static int32_t Bot(const uint8_t *pu8Cdb, uint32_t u32CdbLen, uint32_t u32In, uint8_t *pu8Data, uint32_t u32Len)
+{
+    uint8_t au8Cbw[31], au8Csw[13];
+    uint8_t u8DataEp = u32In ? (BULK_IN_EP_NUM | EP_INPUT) : (BULK_OUT_EP_NUM | EP_OUTPUT);
+
+    memset(au8Cbw, 0, sizeof(au8Cbw));
+    au8Cbw[0] = (uint8_t)CBW_SIGNATURE;
+    au8Cbw[1] = (uint8_t)(CBW_SIGNATURE >> 8);
+    au8Cbw[2] = (uint8_t)(CBW_SIGNATURE >> 16);
+    au8Cbw[3] = (uint8_t)(CBW_SIGNATURE >> 24);
+    s_u32Tag++;
+    memcpy(&au8Cbw[4], &s_u32Tag, 4);
+    au8Cbw[8] = (uint8_t)u32Len;
+    au8Cbw[9] = (uint8_t)(u32Len >> 8);
+    au8Cbw[10] = (uint8_t)(u32Len >> 16);
+    au8Cbw[11] = (uint8_t)(u32Len >> 24);
+    au8Cbw[12] = u32In ? 0x80 : 0x00;
+    au8Cbw[14] = (uint8_t)u32CdbLen;
+    memcpy(&au8Cbw[15], pu8Cdb, u32CdbLen);
+
+    if(Sim_Transfer(BULK_OUT_EP_NUM | EP_OUTPUT, au8Cbw, sizeof(au8Cbw), 0) != sizeof(au8Cbw))
+    {
+        Sim_Fail("CBW of command 0x%02X failed", pu8Cdb[0]);
+        return -1;
+    }
+    if(u32Len && (Sim_Transfer(u8DataEp, pu8Data, u32Len, 0) != (int32_t)u32Len))
+    {
+        Sim_Fail("Data of command 0x%02X is not %u bytes", pu8Cdb[0], u32Len);
+        return -1;
+    }
+    if((Sim_Transfer(BULK_IN_EP_NUM | EP_INPUT, au8Csw, sizeof(au8Csw), 0) != sizeof(au8Csw)) ||
+            (GetLe32(&au8Csw[0]) != CSW_SIGNATURE) || (GetLe32(&au8Csw[4]) != s_u32Tag))
+    {
+        Sim_Fail("No valid CSW for command 0x%02X", pu8Cdb[0]);
+        return -1;
+    }
+    if(GetLe32(&au8Csw[8]) != 0)
+        Sim_Fail("Command 0x%02X has residue %u", pu8Cdb[0], GetLe32(&au8Csw[8]));
+
+    return au8Csw[12];
+}
+
+/* READ(10) or WRITE(10) of u32Num sectors from u32Lba */
+static int32_t ReadWrite(uint8_t u8OpCode, uint32_t u32Lba, uint32_t u32Num, uint8_t *pu8Data)
+{
+    uint8_t au8Cdb[10];
+
+    memset(au8Cdb, 0, sizeof(au8Cdb));
+    au8Cdb[0] = u8OpCode;
+    PutBe32(&au8Cdb[2], u32Lba);
+    au8Cdb[7] = (uint8_t)(u32Num >> 8);
+    au8Cdb[8] = (uint8_t)u32Num;
+
+    return Bot(au8Cdb, sizeof(au8Cdb), u8OpCode == UFI_READ_10, pu8Data, u32Num * UDC_SECTOR_SIZE);
+}
+
+static void Write(uint32_t u32Lba, uint32_t u32Num)
+{
+    if(ReadWrite(UFI_WRITE_10, u32Lba, u32Num, &s_au8Disk[u32Lba * UDC_SECTOR_SIZE]) != 0)
+        Sim_Fail("WRITE(10) of LBA %u, %u sectors failed", u32Lba, u32Num);
+}
+
+static void CheckDisk(const char *pcWhen)
+{
+    memset(s_au8Buf, 0xA5, sizeof(s_au8Buf));
+    if(ReadWrite(UFI_READ_10, 0, DISK_SECTORS, s_au8Buf) != 0)
+        Sim_Fail("READ(10) of the disk failed %s", pcWhen);
+    else if(memcmp(s_au8Buf, s_au8Disk, sizeof(s_au8Disk)))
+        Sim_Fail("Disk content is wrong %s", pcWhen);
+}
+
+/* Same main loop as the sample */
+static void MainLoop(void)
+{
+    MSC_ProcessCmd();
+
+    /* Reclaim flash between commands */
+    if(g_u8BulkState == BULK_CBW)
+        FTL_Process();
+}
+
+int main(int argc, char *argv[])
+{
+    uint8_t au8Cdb[10];
+    uint32_t i, u32Lba, u32Num, u32Sector, u32Bytes, u32Min, u32Max;
+    int i32Fd;
+    SIM_STAT_T sStart;
+
+    Sim_Init(argc, argv, "USBD_MassStorage_DataFlash", MainLoop);
+
+    /* Erased data flash, read-only for the firmware, then the FMC ISP registers */
+    i32Fd = memfd_create("flash", 0);
+    if((i32Fd < 0) || (ftruncate(i32Fd, FLASH_SIZE) != 0) ||
+            (mmap((void *)FTL_BASE, FLASH_SIZE, PROT_READ, MAP_SHARED | MAP_FIXED_NOREPLACE, i32Fd, 0) != (void *)FTL_BASE) ||
+            ((s_pu8Flash = mmap(NULL, FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, i32Fd, 0)) == MAP_FAILED))
+    {
+        fprintf(stderr, "Cannot map data flash at 0x%08X\n", FTL_BASE);
+        return 2;
+    }
+    close(i32Fd);
+    memset(s_pu8Flash, 0xFF, FLASH_SIZE);
+    Sim_MapRegs(FMC_BASE, FmcRegWrite);
+
+    /* Same start-up as main() of the sample, without the CONFIG update */
+    if(FTL_Init() < 0)
+        Sim_Fail("FTL_Init() failed on blank flash");
+    USBD_Open(&gsInfo, MSC_ClassRequest, NULL);
+    USBD_SetConfigCallback(MSC_SetConfig);
+    MSC_Init();
+    USBD_Start();
+    NVIC_EnableIRQ(USBD_IRQn);
+
+    Sim_Attach();
+    if(Sim_Enumerate() < 0)
+        return Sim_Finish();
+
+    memset(au8Cdb, 0, sizeof(au8Cdb));
+    au8Cdb[0] = UFI_INQUIRY;
+    au8Cdb[4] = 36;
+    if((Bot(au8Cdb, 6, 1, s_au8Buf, 36) != 0) || ((s_au8Buf[0] & 0x1F) != 0x00))
+        Sim_Fail("INQUIRY does not return a direct access device");
+
+    memset(au8Cdb, 0, sizeof(au8Cdb));
+    au8Cdb[0] = UFI_READ_CAPACITY;
+    if((Bot(au8Cdb, 10, 1, s_au8Buf, 8) != 0) || (GetBe32(&s_au8Buf[0]) != DISK_SECTORS - 1) ||
+            (GetBe32(&s_au8Buf[4]) != UDC_SECTOR_SIZE))
+        Sim_Fail("READ CAPACITY is not %u sectors of %u bytes", DISK_SECTORS, UDC_SECTOR_SIZE);
+
+    /* Never written sectors read as erased flash */
+    memset(s_au8Disk, 0xFF, sizeof(s_au8Disk));
+    Sim_GetStat(&sStart);
+    CheckDisk("when blank");
+    Sim_Report("read whole disk", &sStart, sizeof(s_au8Disk), 1);
+
+    for(i = 0; i < sizeof(s_au8Disk); i++)
+        s_au8Disk[i] = (uint8_t)Random();
+    Sim_GetStat(&sStart);
+    Write(0, DISK_SECTORS);
+    Sim_Report("write whole disk", &sStart, sizeof(s_au8Disk), 1);
+    CheckDisk("after the whole disk write");
+
+    Sim_GetStat(&sStart);
+    u32Bytes = 0;
+    for(i = 1; i <= RANDOM_WRITES; i++)
+    {
+        u32Num = Random() % 8 + 1;
+        u32Lba = Random() % (DISK_SECTORS - u32Num + 1);
+
+        /* Some sectors keep their content. The FTL skips them. */
+        for(u32Sector = u32Lba; u32Sector < u32Lba + u32Num; u32Sector++)
+        {
+            if(Random() & 3)
+                memset(&s_au8Disk[u32Sector * UDC_SECTOR_SIZE], (uint8_t)Random(), UDC_SECTOR_SIZE);
+        }
+        Write(u32Lba, u32Num);
+        u32Bytes += u32Num * UDC_SECTOR_SIZE;
+
+        if((i % CHECK_EVERY) == 0)
+        {
+            Sim_Wait(IDLE_GAP_MS * 1000);
+            CheckDisk("during the random writes");
+        }
+    }
+    Sim_Report("random writes and checks", &sStart, u32Bytes, RANDOM_WRITES);
+
+    /* Mount the flash again as after a reset */
+    if(FTL_Init() < 0)
+        Sim_Fail("FTL_Init() failed after the writes");
+    CheckDisk("after FTL_Init()");
+
+    u32Min = u32Max = s_au32Erases[0];
+    for(i = 1; i < FLASH_PAGES; i++)
+    {
+        u32Min = (s_au32Erases[i] < u32Min) ? s_au32Erases[i] : u32Min;
+        u32Max = (s_au32Erases[i] > u32Max) ? s_au32Erases[i] : u32Max;
+    }
+    printf("  %-28s %u ~ %u erases per page\n", "  wear", u32Min, u32Max);
+
+    return Sim_Finish();
+}
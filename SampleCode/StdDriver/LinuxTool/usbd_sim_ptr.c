@@ -0,0 +1,118 @@
+/**************************************************************************//**
+ * @file     usbd_sim_ptr.c
+ * @version  V1.00
+ * @brief    Host script for USBD_Micro_Printer on the USBD simulator
+ *
+ * @note
+ *           Build : see usbd_sim.sh
+ *
+ *           Sends print jobs that end with a short packet, with a zero length packet, with nothing (idle
+ *           flush) and with a SOFT_RESET request, and checks the byte count and Adler-32 of every job the
+ *           sample decodes.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "M451Series.h"
+#include "micro_printer.h"
+#include "usbd_sim.h"
+
+#undef printf                   /* Script output is not firmware output */
+
+#define JOB_MAX             (100 * 1024)
+#define JOB_WAIT_MS         (PTR_IDLE_FLUSH_MS * 4)
+
+static uint8_t s_au8Job[JOB_MAX];
+
+/* Same main loop as the sample, without the LED */
+static void MainLoop(void)
+{
+    PTR_Process();
+    CLK_SysTickDelay(2000);
+}
+
+static uint32_t Adler32(const uint8_t *pu8Buf, uint32_t u32Len)
+{
+    uint32_t i, u32A = 1, u32B = 0;
+
+    for(i = 0; i < u32Len; i++)
+    {
+        u32A = (u32A + pu8Buf[i]) % 65521;
+        u32B = (u32B + u32A) % 65521;
+    }
+    return (u32B << 16) | u32A;
+}
+
+/* Wait until the sample reports the job, then check it */
+static void CheckJob(const char *pcWhat, uint32_t u32Len, uint32_t u32JobCnt)
+{
+    uint32_t i;
+
+    for(i = 0; (i < JOB_WAIT_MS) && (g_u32JobCnt == u32JobCnt); i++)
+        Sim_Wait(1000);
+
+    if(g_u32JobCnt != u32JobCnt + 1)
+        Sim_Fail("%s: %d jobs decoded, expected 1", pcWhat, g_u32JobCnt - u32JobCnt);
+    else if(g_sLastJob.u32Bytes != u32Len)
+        Sim_Fail("%s: job has %d bytes, sent %d", pcWhat, g_sLastJob.u32Bytes, u32Len);
+    else if(g_sLastJob.u32Adler != Adler32(s_au8Job, u32Len))
+        Sim_Fail("%s: Adler-32 0x%08X, expected 0x%08X", pcWhat, g_sLastJob.u32Adler, Adler32(s_au8Job, u32Len));
+}
+
+static void SendJob(const char *pcWhat, uint32_t u32Len, uint32_t u32Zlp, uint32_t u32SoftReset)
+{
+    SIM_STAT_T sStart, sSent;
+    uint32_t u32JobCnt = g_u32JobCnt;
+    int32_t i32Ret;
+
+    Sim_GetStat(&sStart);
+    i32Ret = Sim_Transfer(BULK_OUT_EP_NUM | EP_OUTPUT, s_au8Job, u32Len, u32Zlp);
+    if(i32Ret != (int32_t)u32Len)
+    {
+        Sim_Fail("%s: bulk OUT returned %d", pcWhat, i32Ret);
+        return;
+    }
+    Sim_Report(pcWhat, &sStart, u32Len, 0);
+
+    if(u32SoftReset && (Sim_Control(0x21, SOFT_RESET, 0, 0, 0, NULL) < 0))
+        Sim_Fail("%s: SOFT_RESET failed", pcWhat);
+
+    Sim_GetStat(&sSent);
+    CheckJob(pcWhat, u32Len, u32JobCnt);
+    Sim_Report("  until decoded", &sSent, 0, 0);
+}
+
+int main(int argc, char *argv[])
+{
+    uint8_t au8Buf[8];
+    uint32_t i;
+    int32_t i32Ret;
+
+    Sim_Init(argc, argv, "USBD_Micro_Printer", MainLoop);
+
+    /* Same start-up as main() of the sample */
+    USBD_Open(&gsInfo, PTR_ClassRequest, NULL);
+    PTR_Init();
+    USBD_Start();
+    NVIC_EnableIRQ(USBD_IRQn);
+
+    Sim_Attach();
+    if(Sim_Enumerate() < 0)
+        return Sim_Finish();
+
+    i32Ret = Sim_Control(0xA1, GET_PORT_STATUS, 0, 0, 1, au8Buf);
+    if(i32Ret < 0)
+        Sim_Fail("GET_PORT_STATUS failed (%d)", i32Ret);
+
+    for(i = 0; i < sizeof(s_au8Job); i++)
+        s_au8Job[i] = (uint8_t)(i * 31 + (i >> 9));
+
+    SendJob("job ending with short packet", JOB_MAX - 17, 0, 0);
+    SendJob("job ending with ZLP", JOB_MAX, 1, 0);
+    SendJob("job ending with idle flush", JOB_MAX, 0, 0);
+    SendJob("job ending with SOFT_RESET", 128, 0, 1);
+
+    return Sim_Finish();
+}
@@ -0,0 +1,204 @@
+/**************************************************************************//**
+ * @file     usbd_sim_uac.c
+ * @version  V1.00
+ * @brief    Host script for USBD_Audio_NAU8822 on the USBD simulator
+ *
+ * @note
+ *           Build : see usbd_sim.sh
+ *
+ *           Plays a stream to the asynchronous speaker endpoint like a host audio driver: every frame the
+ *           host sends the number of samples that the feedback endpoint asks for. The codec is modelled by
+ *           calling SPI1_IRQHandler() at a sample rate slightly off 48 kHz, as a codec crystal would be.
+ *           The I2S registers are a plain memory page. Every sample written to the I2S TX FIFO must follow
+ *           the previous one, so a play buffer underrun or overrun fails the script, and the mean feedback
+ *           must match the codec rate.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "M451Series.h"
+#include "usbd_audio.h"
+#include "usbd_sim.h"
+
+#undef printf                   /* Script output is not firmware output */
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE MAP_FIXED
+#endif
+
+#define SETTLE_FRAMES       2000        /* Feedback settles before it is checked */
+#define PLAY_FRAMES         8000
+#define FB_TOLERANCE        (1 << 7)    /* Mean feedback within 1/128 sample per frame of the codec rate */
+
+#define REQ_SET_INTERFACE   0x0B
+#define SPEAKER_INTERFACE   2
+
+uint32_t GetSamplesInBuf(void);         /* usbd_audio.c */
+void SPI1_IRQHandler(void);
+
+static uint32_t s_u32I2sInt;            /* Interrupts enabled by I2S_EnableInt() */
+static uint32_t s_u32CodecRate;         /* Samples per second of the codec model */
+static uint32_t s_u32LastCycle;
+static uint64_t s_u64Cycles;            /* CPU cycles since the codec started */
+static uint64_t s_u64Samples;           /* Samples clocked out by the codec */
+static uint32_t s_u32LastTx;            /* Last sample seen in the TX FIFO */
+static uint32_t s_u32Check;             /* Check the sample order */
+static uint32_t s_u32Breaks;            /* Samples out of order, or silence while playing */
+
+/* The sample links i2s.c functions of the BSP driver. Only the interrupt mask matters here. */
+void I2S_EnableInt(SPI_T *i2s, uint32_t u32Mask)
+{
+    (void)i2s;
+    s_u32I2sInt |= u32Mask;
+}
+
+void I2S_DisableInt(SPI_T *i2s, uint32_t u32Mask)
+{
+    (void)i2s;
+    s_u32I2sInt &= ~u32Mask;
+}
+
+/* Codec. SPI1_IRQHandler() writes 2 samples per TX threshold interrupt. */
+static void CodecLoop(void)
+{
+    uint32_t u32Cycle = DWT->CYCCNT;
+
+    s_u64Cycles += (uint32_t)(u32Cycle - s_u32LastCycle);
+    s_u32LastCycle = u32Cycle;
+
+    if(!(s_u32I2sInt & I2S_FIFO_TXTH_INT_MASK))
+    {
+        s_u64Samples = s_u64Cycles * s_u32CodecRate / SystemCoreClock;
+        return;
+    }
+
+    while(s_u64Samples + 2 <= s_u64Cycles * s_u32CodecRate / SystemCoreClock)
+    {
+        s_u64Samples += 2;
+        SPI1->I2SSTS = SPI_I2SSTS_TXTHIF_Msk;
+        SPI1_IRQHandler();
+
+        if(s_u32Check && s_u32LastTx && (SPI1->TX != s_u32LastTx + 2))
+            s_u32Breaks++;
+        s_u32LastTx = SPI1->TX;
+    }
+}
+
+/* Play PLAY_FRAMES frames with the codec at u32Rate */
+static void Play(uint32_t u32Rate)
+{
+    uint8_t au8Pkt[EP3_MAX_PKT_SIZE], au8Fb[EP4_MAX_PKT_SIZE];
+    uint32_t u32Fb = FB_NOMINAL, u32Acc = 0, u32Sample = 1, u32Num, u32Frame, i;
+    uint64_t u64FbSum = 0;
+    uint32_t u32FbNum = 0, u32Expect;
+    SIM_STAT_T sStart;
+    char acWhat[40];
+
+    s_u32CodecRate = u32Rate;
+    s_u32Check = 0;
+    s_u32LastTx = 0;
+    s_u32Breaks = 0;
+
+    if(Sim_Control(0x01, REQ_SET_INTERFACE, 1, SPEAKER_INTERFACE, 0, NULL) < 0)
+    {
+        Sim_Fail("SET_INTERFACE 1 failed");
+        return;
+    }
+
+    Sim_GetStat(&sStart);
+    for(u32Frame = 0; u32Frame < SETTLE_FRAMES + PLAY_FRAMES; u32Frame++)
+    {
+        /* Samples of this frame from the 10.14 feedback */
+        u32Acc += u32Fb;
+        u32Num = u32Acc >> 14;
+        u32Acc &= 0x3FFF;
+        if(u32Num > EP3_MAX_PKT_SIZE / 4)
+            u32Num = EP3_MAX_PKT_SIZE / 4;
+
+        for(i = 0; i < u32Num; i++, u32Sample++)
+        {
+            au8Pkt[i * 4] = (uint8_t)u32Sample;
+            au8Pkt[i * 4 + 1] = (uint8_t)(u32Sample >> 8);
+            au8Pkt[i * 4 + 2] = (uint8_t)(u32Sample >> 16);
+            au8Pkt[i * 4 + 3] = (uint8_t)(u32Sample >> 24);
+        }
+
+        if(Sim_Transfer(ISO_OUT_EP_NUM | EP_OUTPUT, au8Pkt, u32Num * 4, 0) < 0)
+        {
+            Sim_Fail("ISO OUT failed in frame %d", u32Frame);
+            break;
+        }
+
+        if(Sim_Transfer(ISO_FB_EP_NUM | EP_INPUT, au8Fb, sizeof(au8Fb), 0) == EP4_MAX_PKT_SIZE)
+            u32Fb = au8Fb[0] | (au8Fb[1] << 8) | (au8Fb[2] << 16);
+
+        if(u32Frame == SETTLE_FRAMES)
+            s_u32Check = 1;
+
+        if(u32Frame >= SETTLE_FRAMES)
+        {
+            u64FbSum += u32Fb;
+            u32FbNum++;
+        }
+    }
+
+    s_u32Check = 0;
+    snprintf(acWhat, sizeof(acWhat), "play, codec at %u Hz", u32Rate);
+    Sim_Report(acWhat, &sStart, (u32Sample - 1) * 4, 0);
+
+    /* Codec samples per frame in 10.14 format */
+    u32Expect = (uint32_t)(((uint64_t)u32Rate << 14) / 1000);
+    u64FbSum /= (u32FbNum ? u32FbNum : 1);
+    printf("  %-28s %u.%04u samples/frame (codec %u.%04u), buffer %u of %u\n", "  mean feedback",
+           (uint32_t)(u64FbSum >> 14), (uint32_t)(((u64FbSum & 0x3FFF) * 10000) >> 14),
+           u32Expect >> 14, ((u32Expect & 0x3FFF) * 10000) >> 14, GetSamplesInBuf(), BUF_LEN);
+
+    if(s_u32LastTx < u32Sample / 2)
+        Sim_Fail("Played samples do not reach the codec at %u Hz", u32Rate);
+    if(s_u32Breaks)
+        Sim_Fail("%u breaks in the played samples at %u Hz", s_u32Breaks, u32Rate);
+    if((u64FbSum > u32Expect + FB_TOLERANCE) || (u64FbSum + FB_TOLERANCE < u32Expect))
+        Sim_Fail("Mean feedback does not follow the codec rate %u Hz", u32Rate);
+    if((GetSamplesInBuf() < BUF_LEN / 4) || (GetSamplesInBuf() > BUF_LEN * 3 / 4))
+        Sim_Fail("Play buffer is not kept near half full at %u Hz", u32Rate);
+
+    if(Sim_Control(0x01, REQ_SET_INTERFACE, 0, SPEAKER_INTERFACE, 0, NULL) < 0)
+        Sim_Fail("SET_INTERFACE 0 failed");
+}
+
+int main(int argc, char *argv[])
+{
+    static const uint32_t au32Rates[] = {47760, 48000, 48240};
+    uint32_t i;
+
+    Sim_Init(argc, argv, "USBD_Audio_NAU8822", CodecLoop);
+
+    /* I2S registers of SPI1 */
+    if(mmap((void *)SPI1_BASE, 0x1000, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0) !=
+            (void *)SPI1_BASE)
+    {
+        fprintf(stderr, "Cannot map SPI1 at 0x%08lX\n", (unsigned long)SPI1_BASE);
+        return 2;
+    }
+
+    /* Same start-up as main() of the sample */
+    USBD_Open(&gsInfo, UAC_ClassRequest, (SET_INTERFACE_REQ)UAC_SetInterface);
+    UAC_Init();
+    USBD_Start();
+    NVIC_EnableIRQ(USBD_IRQn);
+
+    Sim_Attach();
+    if(Sim_Enumerate() < 0)
+        return Sim_Finish();
+
+    /* Codec crystal 0.5% slow, exact and 0.5% fast */
+    for(i = 0; i < sizeof(au32Rates) / sizeof(au32Rates[0]); i++)
+        Play(au32Rates[i]);
+
+    return Sim_Finish();
+}
@@ -60,14 +60,7 @@ void DataFlashReadPage(uint32_t addr, uint32_t buffer)
 
 uint32_t DataFlashProgramPage(uint32_t u32StartAddr, uint32_t * u32Buf)
 {
-    uint32_t i;
-
-    for(i = 0; i < FLASH_PAGE_SIZE / 4; i++)
-    {
-        FMC_Write(u32StartAddr + i * 4, u32Buf[i]);
-    }
-
-    return 0;
+    return FMC_WriteMultiple(u32StartAddr, u32Buf, FLASH_PAGE_SIZE);
 }
 
 
@@ -85,12 +78,10 @@ void DataFlashWrite(uint32_t addr, uint32_t size, uint32_t buffer)
 
     if((len == FLASH_PAGE_SIZE) && ((addr & (FLASH_PAGE_SIZE - 1)) == 0))
     {
-        /* Page erase */
-        FMC_Erase(addr);
-
         while(len >= FLASH_PAGE_SIZE)
         {
-            DataFlashProgramPage(addr, (uint32_t *) buffer);
+            /* Erase and program the page only if it changes */
+            FMC_UpdatePage(addr, (uint32_t *) buffer);
             len    -= FLASH_PAGE_SIZE;
             buffer += FLASH_PAGE_SIZE;
             addr   += FLASH_PAGE_SIZE;
@@ -124,10 +115,8 @@ void DataFlashWrite(uint32_t addr, uint32_t size, uint32_t buffer)
                 g_sectorBuf[offset / 4 + i] = pu32[i];
             }
 
-            /* Page erase */
-            FMC_Erase(alignAddr);
-            /* Write to the destination page */
-            DataFlashProgramPage(alignAddr, (uint32_t *) g_sectorBuf);
+            /* Update the destination page. It is erased only if needed. */
+            FMC_UpdatePage(alignAddr, (uint32_t *) g_sectorBuf);
 
             size -= len;
             addr += len;
@@ -0,0 +1,317 @@
+/**************************************************************************//**
+ * @file     main.c
+ * @version  V1.00
+ * @brief
+ *           Allocate PDMA channels at run time and build scatter-gather chains from a descriptor pool. A gather
+ *           chain collects scattered blocks into one buffer, with a block longer than one descriptor, while a
+ *           circular ping-pong chain runs on another channel. Both report to callbacks from one
+ *           PDMA_IRQHandler().
+ *
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ *
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include "M451Series.h"
+
+#define PLL_CLOCK           72000000
+
+#define DESC_NUM            16
+#define FILL_LEN            16400       /* Longer than PDMA_MAX_TRANS_CNT, so it takes 2 descriptors */
+#define FILL_DATA           0xA5
+#define GATHER_LEN          (sizeof(g_au8Blk0) + sizeof(g_au8Blk1) + FILL_LEN + sizeof(g_au8Blk2))
+#define PINGPONG_LEN        8
+#define PINGPONG_ROUNDS     50
+
+/* The channel of the UART PDMA driver is fixed. It is kept away from the allocator. */
+#define FIXED_CH            0
+
+uint8_t g_au8Blk0[200];
+uint8_t g_au8Blk1[300];
+uint8_t g_au8Blk2[100];
+uint8_t g_u8Fill = FILL_DATA;
+uint8_t g_au8Gather[GATHER_LEN];
+
+uint32_t g_au32Ping[PINGPONG_LEN];
+uint32_t g_au32Pong[PINGPONG_LEN];
+uint32_t g_au32PingDst[PINGPONG_LEN];
+uint32_t g_au32PongDst[PINGPONG_LEN];
+
+/* Descriptors must be in SRAM */
+PDMA_DESC_T g_asDesc[DESC_NUM];
+PDMA_POOL_T g_sPool;
+PDMA_CHAIN_T g_sGather;
+PDMA_CHAIN_T g_sPingPong;
+
+volatile uint32_t g_u32GatherEntries = 0;
+volatile uint32_t g_u32GatherDone = 0;
+volatile uint32_t g_u32Rounds = 0;
+volatile uint32_t g_u32Errors = 0;
+
+/**
+ * @brief       DMA IRQ
+ *
+ * @param       None
+ *
+ * @return      None
+ *
+ * @details     The DMA default IRQ, declared in startup_M451series.s. Drivers with fixed channels would
+ *              have their handlers called here too.
+ */
+void PDMA_IRQHandler(void)
+{
+    PDMA_ChannelIRQHandler();
+}
+
+/* Every entry of the gather chain reports. The last one finishes the chain. */
+void Gather_Callback(void *pvArg, uint32_t u32Ch, uint32_t u32Event, PDMA_DESC_T *psDesc)
+{
+    if(u32Event & (PDMA_EVT_ABORT | PDMA_EVT_TIMEOUT))
+        g_u32Errors++;
+
+    if(u32Event & PDMA_EVT_DESC)
+        g_u32GatherEntries++;
+
+    if(u32Event & PDMA_EVT_DONE)
+        g_u32GatherDone = 1;
+}
+
+/* A half of the ping-pong buffer is copied. Check it while PDMA copies the other half. */
+void PingPong_Callback(void *pvArg, uint32_t u32Ch, uint32_t u32Event, PDMA_DESC_T *psDesc)
+{
+    PDMA_CHAIN_T *psChain = (PDMA_CHAIN_T *)pvArg;
+    uint32_t *pu32Src, *pu32Dst, i;
+
+    if(u32Event & (PDMA_EVT_ABORT | PDMA_EVT_TIMEOUT))
+    {
+        g_u32Errors++;
+        return;
+    }
+
+    pu32Src = (uint32_t *)psDesc->u32Src;
+    pu32Dst = (uint32_t *)psDesc->u32Dst;
+
+    for(i = 0; i < PINGPONG_LEN; i++)
+    {
+        if(pu32Dst[i] != pu32Src[i])
+            g_u32Errors++;
+
+        pu32Dst[i] = 0;
+    }
+
+    if(psDesc->u32Src == (uint32_t)g_au32Pong)
+    {
+        if(++g_u32Rounds >= PINGPONG_ROUNDS)
+            PDMA_ChainStop(psChain);
+    }
+}
+
+void SYS_Init(void)
+{
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init System Clock                                                                                       */
+    /*---------------------------------------------------------------------------------------------------------*/
+
+    /* Enable HIRC clock (Internal RC 22.1184MHz) */
+    CLK_EnableXtalRC(CLK_PWRCTL_HIRCEN_Msk);
+
+    /* Waiting for HIRC clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HIRCSTB_Msk);
+
+    /* Select HCLK clock source as HIRC and HCLK clock divider as 1 */
+    CLK_SetHCLK(CLK_CLKSEL0_HCLKSEL_HIRC, CLK_CLKDIV0_HCLK(1));
+
+    /* Enable HXT clock (external XTAL 12MHz) */
+    CLK_EnableXtalRC(CLK_PWRCTL_HXTEN_Msk);
+
+    /* Waiting for HXT clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HXTSTB_Msk);
+
+    /* Set core clock as PLL_CLOCK from PLL */
+    CLK_SetCoreClock(PLL_CLOCK);
+
+    /* Enable IP clock. PDMA_AllocChannel() enables the PDMA clock. */
+    CLK_EnableModuleClock(UART0_MODULE);
+
+    /* Select UART module clock source as HXT and UART module clock divider as 1 */
+    CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL1_UARTSEL_HXT, CLK_CLKDIV0_UART(1));
+
+    /* Update System Core Clock */
+    /* User can use SystemCoreClockUpdate() to calculate SystemCoreClock. */
+    SystemCoreClockUpdate();
+
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init I/O Multi-function                                                                                 */
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Set PD multi-function pins for UART0 RXD and TXD */
+    SYS->GPD_MFPL &= ~(SYS_GPD_MFPL_PD0MFP_Msk | SYS_GPD_MFPL_PD1MFP_Msk);
+    SYS->GPD_MFPL |= (SYS_GPD_MFPL_PD0MFP_UART0_RXD | SYS_GPD_MFPL_PD1MFP_UART0_TXD);
+}
+
+void UART0_Init(void)
+{
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init UART                                                                                               */
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Reset UART module */
+    SYS_ResetModule(UART0_RST);
+
+    /* Configure UART0 and set UART0 baud rate */
+    UART_Open(UART0, 115200);
+}
+
+/* Check the gathered buffer block by block */
+uint32_t Gather_Check(void)
+{
+    uint32_t i, u32Pos = 0, u32Err = 0;
+
+    for(i = 0; i < sizeof(g_au8Blk0); i++)
+        u32Err += (g_au8Gather[u32Pos++] != g_au8Blk0[i]);
+
+    for(i = 0; i < sizeof(g_au8Blk1); i++)
+        u32Err += (g_au8Gather[u32Pos++] != g_au8Blk1[i]);
+
+    for(i = 0; i < FILL_LEN; i++)
+        u32Err += (g_au8Gather[u32Pos++] != FILL_DATA);
+
+    for(i = 0; i < sizeof(g_au8Blk2); i++)
+        u32Err += (g_au8Gather[u32Pos++] != g_au8Blk2[i]);
+
+    return u32Err;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* MAIN function                                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+int main(void)
+{
+    int32_t ai32Ch[PDMA_CH_MAX], i32GatherCh, i32PingPongCh, i32Ret;
+    uint32_t i, u32Num, u32TimeOutCnt;
+
+    /* Unlock protected registers */
+    SYS_UnlockReg();
+
+    /* Init System, IP clock and multi-function I/O */
+    SYS_Init();
+
+    /* Lock protected registers */
+    /* If user want to write protected register, please issue SYS_UnlockReg() to unlock protected register. */
+    SYS_LockReg();
+
+    /* Init UART for printf */
+    UART0_Init();
+
+    printf("\n\nCPU @ %dHz\n", SystemCoreClock);
+
+    printf("+-----------------------------------------------------------------------+ \n");
+    printf("|          M451 PDMA Channel Manager and Descriptor Pool Sample         | \n");
+    printf("+-----------------------------------------------------------------------+ \n");
+
+    for(i = 0; i < sizeof(g_au8Blk0); i++)
+        g_au8Blk0[i] = (uint8_t)i;
+
+    for(i = 0; i < sizeof(g_au8Blk1); i++)
+        g_au8Blk1[i] = (uint8_t)(0xFF - i);
+
+    for(i = 0; i < sizeof(g_au8Blk2); i++)
+        g_au8Blk2[i] = (uint8_t)(i * 7);
+
+    for(i = 0; i < PINGPONG_LEN; i++)
+    {
+        g_au32Ping[i] = 0x55555555 + i;
+        g_au32Pong[i] = 0xAAAAAAAA + i;
+    }
+
+    PDMA_ReserveChannels(1 << FIXED_CH);
+    PDMA_PoolInit(&g_sPool, g_asDesc, DESC_NUM);
+
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Gather chain: 4 entries in 5 descriptors                                                                */
+    /*---------------------------------------------------------------------------------------------------------*/
+    PDMA_ChainInit(&g_sGather, &g_sPool);
+    u32Num = (uint32_t)g_au8Gather;
+    PDMA_ChainAdd(&g_sGather, (uint32_t)g_au8Blk0, u32Num, sizeof(g_au8Blk0),
+                  PDMA_WIDTH_8 | PDMA_SAR_INC | PDMA_DAR_INC | PDMA_REQ_BURST | PDMA_BURST_128);
+    u32Num += sizeof(g_au8Blk0);
+    PDMA_ChainAdd(&g_sGather, (uint32_t)g_au8Blk1, u32Num, sizeof(g_au8Blk1),
+                  PDMA_WIDTH_8 | PDMA_SAR_INC | PDMA_DAR_INC | PDMA_REQ_BURST | PDMA_BURST_128);
+    u32Num += sizeof(g_au8Blk1);
+    PDMA_ChainAdd(&g_sGather, (uint32_t)&g_u8Fill, u32Num, FILL_LEN,
+                  PDMA_WIDTH_8 | PDMA_SAR_FIX | PDMA_DAR_INC | PDMA_REQ_BURST | PDMA_BURST_128);
+    u32Num += FILL_LEN;
+    PDMA_ChainAdd(&g_sGather, (uint32_t)g_au8Blk2, u32Num, sizeof(g_au8Blk2),
+                  PDMA_WIDTH_8 | PDMA_SAR_INC | PDMA_DAR_INC | PDMA_REQ_BURST | PDMA_BURST_128);
+    printf("Gather chain of %d bytes in %d descriptors\n", (uint32_t)GATHER_LEN, g_sGather.u32Num);
+
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Ping-pong chain: 2 halves in a circle                                                                   */
+    /*---------------------------------------------------------------------------------------------------------*/
+    PDMA_ChainInit(&g_sPingPong, &g_sPool);
+    PDMA_ChainAdd(&g_sPingPong, (uint32_t)g_au32Ping, (uint32_t)g_au32PingDst, PINGPONG_LEN,
+                  PDMA_WIDTH_32 | PDMA_SAR_INC | PDMA_DAR_INC | PDMA_REQ_BURST | PDMA_BURST_8);
+    PDMA_ChainAdd(&g_sPingPong, (uint32_t)g_au32Pong, (uint32_t)g_au32PongDst, PINGPONG_LEN,
+                  PDMA_WIDTH_32 | PDMA_SAR_INC | PDMA_DAR_INC | PDMA_REQ_BURST | PDMA_BURST_8);
+    PDMA_ChainLoop(&g_sPingPong);
+    printf("Descriptors left in the pool: %d\n", g_sPool.u32FreeNum);
+
+    i32GatherCh = PDMA_AllocChannel(PDMA_MEM, Gather_Callback, &g_sGather);
+    i32PingPongCh = PDMA_AllocChannel(PDMA_MEM, PingPong_Callback, &g_sPingPong);
+
+    if((i32GatherCh < 0) || (i32PingPongCh < 0))
+    {
+        printf("No PDMA channel!\n");
+        goto lexit;
+    }
+
+    printf("Channel %d gathers, channel %d runs the ping-pong buffer\n", i32GatherCh, i32PingPongCh);
+
+    /* Both chains run at the same time */
+    PDMA_ChainStart(&g_sPingPong, (uint32_t)i32PingPongCh);
+    PDMA_ChainStart(&g_sGather, (uint32_t)i32GatherCh);
+
+    u32TimeOutCnt = SystemCoreClock; /* 1 second time-out */
+    while((g_u32GatherDone == 0) || (g_sPingPong.u32Ch != PDMA_NO_CH))
+    {
+        if(--u32TimeOutCnt == 0)
+        {
+            printf("Wait for PDMA time-out!\n");
+            PDMA_ChainStop(&g_sPingPong);
+            PDMA_ChainStop(&g_sGather);
+            break;
+        }
+    }
+
+    printf("Gather: %d entries reported, %d wrong bytes\n", g_u32GatherEntries, Gather_Check());
+    printf("Ping-pong: %d rounds, %d re-starts after overrun\n", g_u32Rounds, g_sPingPong.u32Overrun);
+    printf("Errors in callbacks: %d\n", g_u32Errors);
+
+    /* Descriptors go back to the pool */
+    PDMA_ChainFree(&g_sGather);
+    PDMA_ChainFree(&g_sPingPong);
+    printf("Descriptors in the pool: %d\n", g_sPool.u32FreeNum);
+
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Take the remaining channels                                                                             */
+    /*---------------------------------------------------------------------------------------------------------*/
+    u32Num = 0;
+    while((i32Ret = PDMA_AllocChannel(PDMA_MEM, NULL, NULL)) >= 0)
+        ai32Ch[u32Num++] = i32Ret;
+
+    printf("%d more channels allocated, then %d\n", u32Num, i32Ret);
+
+    for(i = 0; i < u32Num; i++)
+        PDMA_FreeChannel((uint32_t)ai32Ch[i]);
+
+    PDMA_FreeChannel((uint32_t)i32GatherCh);
+    PDMA_FreeChannel((uint32_t)i32PingPongCh);
+
+    if((Gather_Check() == 0) && (g_u32GatherEntries == 4) && (g_u32Rounds == PINGPONG_ROUNDS) && (g_u32Errors == 0))
+        printf("test done...\n");
+    else
+        printf("test failed!\n");
+
+lexit:
+
+    while(1);
+}
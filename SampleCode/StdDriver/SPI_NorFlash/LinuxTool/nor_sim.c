@@ -0,0 +1,712 @@
+/**************************************************************************//**
+ * @file     nor_sim.c
+ * @version  V1.00
+ * @brief    Linux test of the SPI NOR flash library against simulated flash devices
+ *
+ * @note
+ *           Build : gcc -O2 -Wall -I../../../../Library/SpiNorLib/inc -o nor_sim nor_sim.c
+ *                       ../../../../Library/SpiNorLib/src/spi_nor.c
+ *           Usage : nor_sim [SPI clock in Hz]
+ *
+ *           The simulated flash decodes every operation like a W25Q or MX25L flash. It has an SFDP table,
+ *           status registers, a program and erase timer and the suspend and resume commands of the device.
+ *           Commands which a real flash would ignore or answer with undefined data are counted as violations.
+ *           The time of a background erase is checked against the plan of SpiNor_PlanErase(). Time is simulated from
+ *           the SPI clock, the bus width of each operation and the typical program and erase times, so the
+ *           tool also reports the throughput of each read mode and the time of the erase plans.
+ *           The exit code is 0 if all tests pass.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "spi_nor.h"
+
+#define XFER_GAP_NS     2000        /* CPU time between two queued transactions */
+#define YIELD_NS        50000       /* Work done by the application in pfnYield */
+#define SUSPEND_NS      20000       /* tSUS */
+#define PROGRAM_NS      700000      /* Typical page program time */
+#define WRSR_NS         5000000
+#define PLAN_SLACK      4           /* A background erase may take 1/PLAN_SLACK longer than its plan for the reads */
+
+typedef struct
+{
+    uint8_t u8Cmd;
+    uint8_t u8Bus;
+    uint8_t u8Dummy;
+    uint8_t u8Quad;                 /* Needs the QE bit */
+} READ_CMD_T;
+
+typedef struct
+{
+    const char *pcName;
+    uint32_t u32Id;
+    uint32_t u32Size;
+    uint32_t u32SfdpDwords;         /* 0 if the flash has no SFDP table */
+    uint32_t u32QeMask;             /* QE bit. Bits 7:0 are SR1, bits 15:8 are SR2 */
+    const READ_CMD_T *psReads;
+    uint32_t u32ReadNum;
+    uint32_t au32EraseSize[4];
+    uint8_t au8EraseCmd[4];
+    uint32_t au32EraseMs[4];        /* Real typical times */
+    uint8_t u8SuspendCmd;           /* 0 if the flash can't suspend */
+    uint8_t u8ResumeCmd;
+} DEVICE_T;
+
+typedef struct
+{
+    const DEVICE_T *psDev;
+    uint8_t *pu8Mem;
+    uint8_t au8Sfdp[256];
+    uint32_t u32SfdpLen;
+    uint8_t u8Sr1, u8Sr2;
+    uint32_t u32Wel;
+
+    uint64_t u64Now;                /* ns */
+    uint64_t u64BusyEnd;            /* Program or erase ends at this time */
+    uint64_t u64Remain;             /* Time left of a suspended operation */
+    uint64_t u64SuspendEnd;         /* WIP clears at this time after suspend */
+    uint32_t u32Busy;               /* 0, 1 program, 2 erase */
+    uint32_t u32Suspended;
+    uint32_t u32BusyAddr, u32BusyLen;   /* Region of the busy operation */
+    uint32_t u32ClockHz;
+
+    uint32_t u32Violations;
+    uint32_t u32Suspends;
+    uint32_t u32Programs;
+    uint64_t u64IdleNs;             /* Flash ready but no program running during a write */
+    uint64_t u64ReadyAt;            /* Last program or erase end seen */
+} FLASH_T;
+
+static const READ_CMD_T s_asW25qReads[] =
+{
+    {0x03, SPI_NOR_BUS_1_1_1, 0, 0},
+    {0x0B, SPI_NOR_BUS_1_1_1, 1, 0},
+    {0x3B, SPI_NOR_BUS_1_1_2, 1, 0},
+    {0xBB, SPI_NOR_BUS_1_2_2, 1, 0},
+    {0x6B, SPI_NOR_BUS_1_1_4, 1, 1},
+    {0xEB, SPI_NOR_BUS_1_4_4, 3, 1},
+};
+
+static const READ_CMD_T s_asMx25Reads[] =
+{
+    {0x03, SPI_NOR_BUS_1_1_1, 0, 0},
+    {0x0B, SPI_NOR_BUS_1_1_1, 1, 0},
+    {0x3B, SPI_NOR_BUS_1_1_2, 1, 0},
+    {0x6B, SPI_NOR_BUS_1_1_4, 1, 1},
+};
+
+static const DEVICE_T s_asDevices[] =
+{
+    {
+        "W25Q32JV, SFDP rev B", 0xEF4016, 0x400000, 16, 0x0200, s_asW25qReads, 6,
+        {0x1000, 0x8000, 0x10000, 0}, {0x20, 0x52, 0xD8, 0}, {45, 120, 150, 0}, 0x75, 0x7A
+    },
+    {
+        "W25Q32 with slow 64 KB erase", 0xEF4016, 0x400000, 16, 0x0200, s_asW25qReads, 6,
+        {0x1000, 0x8000, 0x10000, 0}, {0x20, 0x52, 0xD8, 0}, {45, 120, 1000, 0}, 0x75, 0x7A
+    },
+    {
+        "MX25L3206E, SFDP rev 0, no suspend", 0xC22016, 0x400000, 9, 0x0040, s_asMx25Reads, 4,
+        {0x1000, 0x10000, 0, 0}, {0x20, 0xD8, 0, 0}, {40, 500, 0, 0}, 0, 0
+    },
+    {
+        "MX25L3233F, SFDP rev B", 0xC22016, 0x400000, 16, 0x0040, s_asMx25Reads, 4,
+        {0x1000, 0x8000, 0x10000, 0}, {0x20, 0x52, 0xD8, 0}, {40, 200, 400, 0}, 0xB0, 0x30
+    },
+    {
+        "W25Q32BV, no SFDP", 0xEF4016, 0x400000, 0, 0x0200, s_asW25qReads, 6,
+        {0x1000, 0x8000, 0x10000, 0}, {0x20, 0x52, 0xD8, 0}, {45, 120, 150, 0}, 0x75, 0x7A
+    },
+};
+
+static uint32_t s_u32Fail;
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* SFDP table of a device                                                                                  */
+/*---------------------------------------------------------------------------------------------------------*/
+static void PutDword(uint8_t *pu8Buf, uint32_t u32Val)
+{
+    pu8Buf[0] = (uint8_t)u32Val;
+    pu8Buf[1] = (uint8_t)(u32Val >> 8);
+    pu8Buf[2] = (uint8_t)(u32Val >> 16);
+    pu8Buf[3] = (uint8_t)(u32Val >> 24);
+}
+
+/* Typical time field of DWORD 10 */
+static uint32_t EraseTimeField(uint32_t u32Ms)
+{
+    static const uint32_t au32Unit[4] = {1, 16, 128, 1000};
+    uint32_t u32Unit, u32Count;
+
+    for(u32Unit = 0; u32Unit < 3; u32Unit++)
+    {
+        if((u32Ms + au32Unit[u32Unit] - 1) / au32Unit[u32Unit] <= 32)
+            break;
+    }
+
+    u32Count = (u32Ms + au32Unit[u32Unit] - 1) / au32Unit[u32Unit];
+
+    return (u32Unit << 5) | (u32Count - 1);
+}
+
+static void BuildSfdp(FLASH_T *psFlash)
+{
+    const DEVICE_T *psDev = psFlash->psDev;
+    uint32_t au32Dw[16], u32Exp, i, j;
+
+    memset(psFlash->au8Sfdp, 0xFF, sizeof(psFlash->au8Sfdp));
+    psFlash->u32SfdpLen = 0;
+
+    if(psDev->u32SfdpDwords == 0)
+        return;
+
+    memset(au32Dw, 0, sizeof(au32Dw));
+    au32Dw[0] = 0xFF800001 | (0x20 << 8);
+    au32Dw[1] = psDev->u32Size * 8 - 1;
+
+    for(i = 0; i < psDev->u32ReadNum; i++)
+    {
+        const READ_CMD_T *psRd = &psDev->psReads[i];
+        uint32_t u32Lines = SPI_NOR_ADDR_LINES(psRd->u8Bus), u32Clocks = psRd->u8Dummy * 8 / u32Lines, u32Param;
+
+        /* Dual and quad I/O reads have 1 byte of mode bits */
+        if(u32Lines > 1)
+            u32Param = (psRd->u8Cmd << 8) | ((8 / u32Lines) << 5) | (u32Clocks - 8 / u32Lines);
+        else
+            u32Param = (psRd->u8Cmd << 8) | u32Clocks;
+
+        switch(psRd->u8Bus)
+        {
+            case SPI_NOR_BUS_1_1_2:
+                au32Dw[0] |= 1 << 16;
+                au32Dw[3] |= u32Param;
+                break;
+
+            case SPI_NOR_BUS_1_2_2:
+                au32Dw[0] |= 1 << 20;
+                au32Dw[3] |= u32Param << 16;
+                break;
+
+            case SPI_NOR_BUS_1_4_4:
+                au32Dw[0] |= 1 << 21;
+                au32Dw[2] |= u32Param;
+                break;
+
+            case SPI_NOR_BUS_1_1_4:
+                au32Dw[0] |= 1 << 22;
+                au32Dw[2] |= u32Param << 16;
+                break;
+        }
+    }
+
+    for(i = 0; i < 4; i++)
+    {
+        if(psDev->au32EraseSize[i] == 0)
+            continue;
+
+        for(u32Exp = 0; (1UL << u32Exp) < psDev->au32EraseSize[i]; u32Exp++);
+
+        au32Dw[7 + i / 2] |= ((psDev->au8EraseCmd[i] << 8) | u32Exp) << ((i % 2) * 16);
+        au32Dw[9] |= EraseTimeField(psDev->au32EraseMs[i]) << (4 + i * 7);
+    }
+
+    au32Dw[10] = 8 << 4;
+
+    /* DWORD 12 bit 31 is set if the flash can't suspend. DWORD 13 has the erase and program suspend commands. */
+    if(psDev->u8SuspendCmd)
+        au32Dw[12] = (psDev->u8SuspendCmd << 24) | (psDev->u8ResumeCmd << 16) | (psDev->u8SuspendCmd << 8) | psDev->u8ResumeCmd;
+    else
+        au32Dw[11] = 0x80000000;
+
+    au32Dw[14] = ((psDev->u32QeMask == 0x0200) ? 4 : 2) << 20;
+
+    memcpy(psFlash->au8Sfdp, "SFDP", 4);
+    psFlash->au8Sfdp[4] = (psDev->u32SfdpDwords > 9) ? 6 : 0;
+    psFlash->au8Sfdp[5] = 1;
+    psFlash->au8Sfdp[6] = 0;
+    psFlash->au8Sfdp[8] = 0x00;
+    psFlash->au8Sfdp[9] = psFlash->au8Sfdp[4];
+    psFlash->au8Sfdp[10] = 1;
+    psFlash->au8Sfdp[11] = (uint8_t)psDev->u32SfdpDwords;
+    PutDword(&psFlash->au8Sfdp[12], 0xFF000030);
+
+    for(j = 0; j < psDev->u32SfdpDwords; j++)
+        PutDword(&psFlash->au8Sfdp[0x30 + j * 4], au32Dw[j]);
+
+    psFlash->u32SfdpLen = 0x30 + psDev->u32SfdpDwords * 4;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Flash device model                                                                                      */
+/*---------------------------------------------------------------------------------------------------------*/
+static void Violation(FLASH_T *psFlash, const SPI_NOR_OP_T *psOp, const char *pcWhy)
+{
+    if(psFlash->u32Violations++ < 10)
+        printf("  VIOLATION: cmd 0x%02X addr 0x%06X: %s\n", psOp->u8Cmd, psOp->u32Addr, pcWhy);
+}
+
+static void UpdateBusy(FLASH_T *psFlash)
+{
+    if(psFlash->u32Busy && !psFlash->u32Suspended && (psFlash->u64Now >= psFlash->u64BusyEnd))
+    {
+        psFlash->u32Busy = 0;
+        psFlash->u32Wel = 0;
+        psFlash->u64ReadyAt = psFlash->u64BusyEnd;
+    }
+}
+
+static uint8_t StatusReg1(FLASH_T *psFlash)
+{
+    uint32_t u32Wip = psFlash->u32Busy && (!psFlash->u32Suspended || (psFlash->u64Now < psFlash->u64SuspendEnd));
+
+    return psFlash->u8Sr1 | (psFlash->u32Wel ? 0x02 : 0) | (u32Wip ? SPI_NOR_SR_WIP : 0);
+}
+
+static void StartBusy(FLASH_T *psFlash, uint32_t u32Type, uint64_t u64Ns, uint32_t u32Addr, uint32_t u32Len)
+{
+    /* Time the flash was ready while a write waited */
+    if((u32Type == 1) && (psFlash->u32Programs++ > 0))
+        psFlash->u64IdleNs += psFlash->u64Now - psFlash->u64ReadyAt;
+
+    psFlash->u32Busy = u32Type;
+    psFlash->u64BusyEnd = psFlash->u64Now + u64Ns;
+    psFlash->u32BusyAddr = u32Addr;
+    psFlash->u32BusyLen = u32Len;
+}
+
+static int32_t SimExecOne(FLASH_T *psFlash, const SPI_NOR_OP_T *psOp)
+{
+    const DEVICE_T *psDev = psFlash->psDev;
+    uint32_t u32AddrLines = SPI_NOR_ADDR_LINES(psOp->u8Bus), u32DataLines = SPI_NOR_DATA_LINES(psOp->u8Bus);
+    uint32_t u32Addr = psOp->u32Addr, u32Page, i;
+    uint64_t u64Clocks;
+
+    /* Bus time */
+    u64Clocks = 8 + (psOp->u8AddrLen + psOp->u8Dummy) * 8 / u32AddrLines + (uint64_t)psOp->u32Len * 8 / u32DataLines;
+    psFlash->u64Now += u64Clocks * 1000000000ULL / psFlash->u32ClockHz + XFER_GAP_NS;
+    UpdateBusy(psFlash);
+
+    if((psOp->pu8Tx != NULL) && (psOp->pu8Rx != NULL))
+        Violation(psFlash, psOp, "both TX and RX data");
+
+    if(psFlash->u32Busy && !psFlash->u32Suspended && (psOp->u8Cmd != SPI_NOR_CMD_RDSR) &&
+            (psOp->u8Cmd != SPI_NOR_CMD_RDSR2) && (!psDev->u8SuspendCmd || (psOp->u8Cmd != psDev->u8SuspendCmd)))
+    {
+        Violation(psFlash, psOp, "flash is busy");
+        return 0;
+    }
+
+    /* Commands of the device, so a flash without them rejects them below */
+    if(psDev->u8SuspendCmd && (psOp->u8Cmd == psDev->u8SuspendCmd))
+    {
+        if(psFlash->u32Busy && !psFlash->u32Suspended)
+        {
+            psFlash->u32Suspended = 1;
+            psFlash->u32Suspends++;
+            psFlash->u64Remain = psFlash->u64BusyEnd - psFlash->u64Now;
+            psFlash->u64SuspendEnd = psFlash->u64Now + SUSPEND_NS;
+        }
+
+        return 0;
+    }
+
+    if(psDev->u8ResumeCmd && (psOp->u8Cmd == psDev->u8ResumeCmd))
+    {
+        if(psFlash->u32Suspended)
+        {
+            if(psFlash->u64Now < psFlash->u64SuspendEnd)
+                Violation(psFlash, psOp, "resume before suspend is done");
+
+            psFlash->u32Suspended = 0;
+            psFlash->u64BusyEnd = psFlash->u64Now + psFlash->u64Remain;
+        }
+
+        return 0;
+    }
+
+    switch(psOp->u8Cmd)
+    {
+        case SPI_NOR_CMD_RDID:
+            for(i = 0; i < psOp->u32Len; i++)
+                psOp->pu8Rx[i] = (i < 3) ? (uint8_t)(psDev->u32Id >> (16 - i * 8)) : 0xFF;
+
+            return 0;
+
+        case SPI_NOR_CMD_RDSFDP:
+            if((psOp->u8AddrLen != 3) || (psOp->u8Dummy != 1) || (psOp->u8Bus != SPI_NOR_BUS_1_1_1))
+                Violation(psFlash, psOp, "bad SFDP read format");
+
+            for(i = 0; i < psOp->u32Len; i++)
+                psOp->pu8Rx[i] = (psFlash->u32SfdpLen && (u32Addr + i < sizeof(psFlash->au8Sfdp))) ? psFlash->au8Sfdp[u32Addr + i] : 0xFF;
+
+            return 0;
+
+        case SPI_NOR_CMD_RDSR:
+            for(i = 0; i < psOp->u32Len; i++)
+                psOp->pu8Rx[i] = StatusReg1(psFlash);
+
+            return 0;
+
+        case SPI_NOR_CMD_RDSR2:
+            for(i = 0; i < psOp->u32Len; i++)
+                psOp->pu8Rx[i] = psFlash->u8Sr2 | (psFlash->u32Suspended ? 0x80 : 0);
+
+            return 0;
+
+        case SPI_NOR_CMD_WREN:
+            psFlash->u32Wel = 1;
+            return 0;
+
+        case SPI_NOR_CMD_WRSR:
+            if(!psFlash->u32Wel)
+            {
+                Violation(psFlash, psOp, "WRSR without WREN");
+                return 0;
+            }
+
+            psFlash->u8Sr1 = psOp->pu8Tx[0] & 0xFC;
+
+            if(psOp->u32Len > 1)
+                psFlash->u8Sr2 = psOp->pu8Tx[1] & 0x7F;
+            else if(psDev->u32QeMask & 0xFF00)
+                psFlash->u8Sr2 = 0;     /* Writing SR1 only clears SR2 */
+
+            StartBusy(psFlash, 3, WRSR_NS, 0, 0);
+            return 0;
+
+        case SPI_NOR_CMD_PP:
+            if(!psFlash->u32Wel || psFlash->u32Suspended || (psOp->u8AddrLen != 3) || (psOp->u8Bus != SPI_NOR_BUS_1_1_1))
+            {
+                Violation(psFlash, psOp, "bad page program");
+                return 0;
+            }
+
+            if(((u32Addr & 0xFF) + psOp->u32Len) > 256)
+                Violation(psFlash, psOp, "page program wraps");
+
+            u32Page = u32Addr & ~0xFFU;
+
+            for(i = 0; i < psOp->u32Len; i++)
+                psFlash->pu8Mem[u32Page + ((u32Addr + i) & 0xFF)] &= psOp->pu8Tx[i];
+
+            StartBusy(psFlash, 1, PROGRAM_NS, u32Page, 256);
+            return 0;
+
+        case SPI_NOR_CMD_EN4B:
+            return 0;
+    }
+
+    /* Erase */
+    for(i = 0; i < 4; i++)
+    {
+        if(psDev->au32EraseSize[i] && (psOp->u8Cmd == psDev->au8EraseCmd[i]))
+        {
+            if(!psFlash->u32Wel || psFlash->u32Suspended || (psOp->u8AddrLen != 3))
+                Violation(psFlash, psOp, "bad erase");
+            else
+            {
+                if(u32Addr & (psDev->au32EraseSize[i] - 1))
+                    Violation(psFlash, psOp, "unaligned erase");
+
+                u32Addr &= ~(psDev->au32EraseSize[i] - 1);
+                memset(&psFlash->pu8Mem[u32Addr], 0xFF, psDev->au32EraseSize[i]);
+                StartBusy(psFlash, 2, psDev->au32EraseMs[i] * 1000000ULL, u32Addr, psDev->au32EraseSize[i]);
+            }
+
+            return 0;
+        }
+    }
+
+    /* Read */
+    for(i = 0; i < psDev->u32ReadNum; i++)
+    {
+        const READ_CMD_T *psRd = &psDev->psReads[i];
+
+        if(psOp->u8Cmd != psRd->u8Cmd)
+            continue;
+
+        if((psOp->u8Bus != psRd->u8Bus) || (psOp->u8Dummy != psRd->u8Dummy) || (psOp->u8AddrLen != 3))
+            Violation(psFlash, psOp, "bad read format");
+
+        if(psRd->u8Quad && !((psFlash->u8Sr1 | (psFlash->u8Sr2 << 8)) & psDev->u32QeMask))
+            Violation(psFlash, psOp, "quad read without QE");
+
+        if(psFlash->u32Suspended && (u32Addr < psFlash->u32BusyAddr + psFlash->u32BusyLen) &&
+                (u32Addr + psOp->u32Len > psFlash->u32BusyAddr))
+            Violation(psFlash, psOp, "read of the suspended region");
+
+        if(psFlash->u32Suspended && (psFlash->u64Now < psFlash->u64SuspendEnd))
+            Violation(psFlash, psOp, "read before suspend is done");
+
+        for(i = 0; i < psOp->u32Len; i++)
+            psOp->pu8Rx[i] = psFlash->pu8Mem[(u32Addr + i) % psDev->u32Size];
+
+        return 0;
+    }
+
+    Violation(psFlash, psOp, "unknown command");
+    return 0;
+}
+
+/* SPI_NOR_T.pfnExec */
+static int32_t SimExec(void *pvPort, const SPI_NOR_OP_T *psOp, uint32_t u32Num)
+{
+    uint32_t i;
+
+    for(i = 0; i < u32Num; i++)
+        SimExecOne((FLASH_T *)pvPort, &psOp[i]);
+
+    return 0;
+}
+
+/* SPI_NOR_T.pfnYield */
+static void SimYield(SPI_NOR_T *psNor)
+{
+    ((FLASH_T *)psNor->pvPort)->u64Now += YIELD_NS;
+}
+
+static void SimInit(FLASH_T *psFlash, SPI_NOR_T *psNor, const DEVICE_T *psDev, uint32_t u32ClockHz)
+{
+    memset(psFlash, 0, sizeof(FLASH_T));
+    psFlash->psDev = psDev;
+    psFlash->pu8Mem = malloc(psDev->u32Size);
+    memset(psFlash->pu8Mem, 0xFF, psDev->u32Size);
+    psFlash->u32ClockHz = u32ClockHz;
+    BuildSfdp(psFlash);
+
+    memset(psNor, 0, sizeof(SPI_NOR_T));
+    psNor->pfnExec = SimExec;
+    psNor->pfnYield = SimYield;
+    psNor->pvPort = psFlash;
+    psNor->u32MaxLen = 65536;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Tests                                                                                                   */
+/*---------------------------------------------------------------------------------------------------------*/
+static void Check(int32_t i32Ok, const char *pcWhat)
+{
+    if(!i32Ok)
+    {
+        printf("  FAIL: %s\n", pcWhat);
+        s_u32Fail++;
+    }
+}
+
+/* Least time to erase a range, by dynamic programming over all aligned block tilings */
+static uint32_t BestEraseTime(SPI_NOR_T *psNor, uint32_t u32Addr, uint32_t u32Len)
+{
+    uint32_t u32Unit = psNor->asErase[0].u32Size, u32Num = u32Len / u32Unit, u32Size, u32Ret, i, j;
+    uint32_t *pu32Best = malloc((u32Num + 1) * sizeof(uint32_t));
+
+    for(i = 0; i <= u32Num; i++)
+        pu32Best[i] = 0xFFFFFFFF;
+
+    pu32Best[0] = 0;
+
+    for(i = 0; i < u32Num; i++)
+    {
+        for(j = 0; j < psNor->u32EraseNum; j++)
+        {
+            u32Size = psNor->asErase[j].u32Size;
+
+            if(((u32Addr + i * u32Unit) % u32Size) || (i * u32Unit + u32Size > u32Len))
+                continue;
+
+            if(pu32Best[i] + psNor->asErase[j].u32TimeMs < pu32Best[i + u32Size / u32Unit])
+                pu32Best[i + u32Size / u32Unit] = pu32Best[i] + psNor->asErase[j].u32TimeMs;
+        }
+    }
+
+    u32Ret = pu32Best[u32Num];
+    free(pu32Best);
+
+    return u32Ret;
+}
+
+static void TestPlanner(SPI_NOR_T *psNor)
+{
+    static SPI_NOR_ERASE_STEP_T asStep[1100];
+    uint32_t u32Unit = psNor->asErase[0].u32Size, u32Addr, u32Len, u32Time, u32Pos, u32Bad = 0, i, n;
+    int32_t i32Num;
+
+    for(n = 0; n < 2000; n++)
+    {
+        u32Addr = (rand() % (psNor->u32Size / u32Unit)) * u32Unit;
+        u32Len = (1 + rand() % 256) * u32Unit;
+
+        if(u32Addr + u32Len > psNor->u32Size)
+            u32Len = psNor->u32Size - u32Addr;
+
+        i32Num = SpiNor_PlanErase(psNor, u32Addr, u32Len, asStep, 1100, &u32Time);
+
+        for(i = 0, u32Pos = u32Addr; (i32Num > 0) && (i < (uint32_t)i32Num); u32Pos += asStep[i++].u32Size)
+        {
+            if((asStep[i].u32Addr != u32Pos) || (asStep[i].u32Addr & (asStep[i].u32Size - 1)))
+                break;
+        }
+
+        if((i32Num <= 0) || (u32Pos != u32Addr + u32Len) || (u32Time != BestEraseTime(psNor, u32Addr, u32Len)))
+            u32Bad++;
+    }
+
+    Check(u32Bad == 0, "erase plans are contiguous, aligned and of least time");
+    Check(SpiNor_PlanErase(psNor, 0x100, u32Unit, NULL, 0, NULL) == SPI_NOR_ERR_PARAM, "unaligned erase is rejected");
+    Check(SpiNor_PlanErase(psNor, psNor->u32Size - u32Unit, 2 * u32Unit, NULL, 0, NULL) == SPI_NOR_ERR_PARAM,
+          "erase past the end is rejected");
+
+    /* A range like a file system partition: unaligned to the big blocks on both ends */
+    u32Addr = 0x3000;
+    u32Len = 0x30000;
+    i32Num = SpiNor_PlanErase(psNor, u32Addr, u32Len, asStep, 1100, &u32Time);
+    printf("  Plan of 0x%05X + 0x%05X:", u32Addr, u32Len);
+
+    for(i = 0; i < (uint32_t)i32Num; i++)
+        printf(" %uK", asStep[i].u32Size / 1024);
+
+    printf(" = %u ms, %u ms with 4 KB erases only\n", u32Time, u32Len / u32Unit * psNor->asErase[0].u32TimeMs);
+}
+
+static void TestReadWrite(SPI_NOR_T *psNor, FLASH_T *psFlash)
+{
+    static uint8_t au8Data[0x40000], au8Buf[0x40000];
+    uint64_t u64Start;
+    uint32_t u32Addr = 0x10000 + 77, u32Len = 5000, i;
+
+    for(i = 0; i < sizeof(au8Data); i++)
+        au8Data[i] = (uint8_t)rand();
+
+    Check(SpiNor_Erase(psNor, 0x10000, 0x10000) == 0, "erase 64 KB");
+    Check(SpiNor_Write(psNor, u32Addr, au8Data, u32Len) == 0, "write across pages");
+    Check(SpiNor_Read(psNor, u32Addr, au8Buf, u32Len) == 0, "read back");
+    Check(memcmp(au8Data, au8Buf, u32Len) == 0, "data matches");
+    Check((psFlash->pu8Mem[u32Addr - 1] == 0xFF) && (psFlash->pu8Mem[u32Addr + u32Len] == 0xFF), "neighbours untouched");
+
+    /* Write throughput */
+    Check(SpiNor_Erase(psNor, 0x100000, 0x40000) == 0, "erase 256 KB");
+    psFlash->u32Programs = 0;
+    psFlash->u64IdleNs = 0;
+    u64Start = psFlash->u64Now;
+    Check(SpiNor_Write(psNor, 0x100000, au8Data, 0x10000) == 0, "write 64 KB");
+    printf("  Write 64 KB: %.1f KB/s, flash idle %.1f us per page\n",
+           65536.0 / 1024 / ((psFlash->u64Now - u64Start) / 1e9), psFlash->u64IdleNs / 1e3 / (psFlash->u32Programs - 1));
+
+    /* Read throughput */
+    memcpy(&psFlash->pu8Mem[0x200000], au8Data, sizeof(au8Data));
+    u64Start = psFlash->u64Now;
+    Check(SpiNor_Read(psNor, 0x200000, au8Buf, sizeof(au8Buf)) == 0, "read 256 KB");
+    printf("  Read 256 KB with 0x%02X (%u-%u-%u): %.2f MB/s\n", psNor->u8ReadCmd, 1, SPI_NOR_ADDR_LINES(psNor->u8ReadBus),
+           SPI_NOR_DATA_LINES(psNor->u8ReadBus), sizeof(au8Buf) / 1048576.0 / ((psFlash->u64Now - u64Start) / 1e9));
+    Check(memcmp(au8Data, au8Buf, sizeof(au8Buf)) == 0, "256 KB data matches");
+}
+
+static void TestBackground(SPI_NOR_T *psNor, FLASH_T *psFlash)
+{
+    static uint8_t au8Buf[4096];
+    uint64_t u64Start;
+    uint32_t u32Reads = 0, u32Time, u32Real, i;
+    int32_t i32Ret;
+
+    memset(&psFlash->pu8Mem[0x300000], 0x5A, 0x40000);
+    memset(&psFlash->pu8Mem[0x000000], 0xA5, 0x1000);
+    SpiNor_PlanErase(psNor, 0x300000, 0x40000, NULL, 0, &u32Time);
+    u64Start = psFlash->u64Now;
+    Check(SpiNor_EraseStart(psNor, 0x300000, 0x40000) == 0, "start background erase");
+    Check(SpiNor_EraseStart(psNor, 0, 0x1000) == SPI_NOR_ERR_BUSY, "second erase is refused");
+
+    /* The application reads other data every 2 ms while the erase runs */
+    do
+    {
+        psFlash->u64Now += 2000000;
+        Check(SpiNor_Read(psNor, 0, au8Buf, sizeof(au8Buf)) == 0, "read during erase");
+
+        for(i = 0; i < sizeof(au8Buf); i++)
+        {
+            if(au8Buf[i] != 0xA5)
+                break;
+        }
+
+        Check(i == sizeof(au8Buf), "data read during erase");
+        u32Reads++;
+        i32Ret = SpiNor_Poll(psNor);
+    }
+    while(i32Ret > 0);
+
+    Check(i32Ret == 0, "background erase finishes");
+
+    for(i = 0; i < 0x40000; i++)
+    {
+        if(psFlash->pu8Mem[0x300000 + i] != 0xFF)
+            break;
+    }
+
+    Check(i == 0x40000, "range is erased");
+    u32Real = (uint32_t)((psFlash->u64Now - u64Start) / 1000000);
+    printf("  Background erase of 256 KB: %u ms (plan %u ms), %u reads, %u suspends\n",
+           u32Real, u32Time, u32Reads, psNor->u32SuspendCnt);
+
+    /* Erase times of the library may be longer than the real ones, but not shorter */
+    Check(u32Real <= u32Time + u32Time / PLAN_SLACK, "background erase ends within its plan");
+
+    if(psNor->u8SuspendCmd)
+        Check(psNor->u32SuspendCnt > 0, "reads suspend the erase");
+}
+
+int main(int argc, char **argv)
+{
+    static const uint32_t au32Caps[3] = {0, SPI_NOR_CAP_DUAL, SPI_NOR_CAP_DUAL | SPI_NOR_CAP_QUAD};
+    uint32_t u32ClockHz = (argc > 1) ? strtoul(argv[1], NULL, 0) : 36000000;
+    SPI_NOR_T sNor;
+    FLASH_T sFlash;
+    uint32_t i, j, k;
+
+    srand(1);
+
+    for(i = 0; i < sizeof(s_asDevices) / sizeof(s_asDevices[0]); i++)
+    {
+        for(j = 0; j < 3; j++)
+        {
+            printf("%s, %s, SPI clock %u Hz\n", s_asDevices[i].pcName, (j == 0) ? "single" : ((j == 1) ? "dual" : "quad"),
+                   u32ClockHz);
+            SimInit(&sFlash, &sNor, &s_asDevices[i], u32ClockHz);
+
+            Check(SpiNor_Open(&sNor, au32Caps[j]) == 0, "open");
+            Check(sNor.u32Size == s_asDevices[i].u32Size, "size");
+            Check(sNor.u8Sfdp == (s_asDevices[i].u32SfdpDwords != 0), "SFDP found");
+            Check((sNor.u8SuspendCmd == s_asDevices[i].u8SuspendCmd) && (sNor.u8ResumeCmd == s_asDevices[i].u8ResumeCmd),
+                  "suspend commands");
+
+            if(j == 0)
+            {
+                printf("  ID %06X, %u KB, page %u, read 0x%02X with %u dummy bytes, suspend 0x%02X, erase",
+                       sNor.u32JedecId, sNor.u32Size / 1024, sNor.u32PageSize, sNor.u8ReadCmd, sNor.u8ReadDummy,
+                       sNor.u8SuspendCmd);
+
+                for(k = 0; k < sNor.u32EraseNum; k++)
+                    printf(" %uK/0x%02X/%ums%s", sNor.asErase[k].u32Size / 1024, sNor.asErase[k].u8Cmd,
+                           sNor.asErase[k].u32TimeMs, sNor.asErase[k].u8Use ? "" : "(unused)");
+
+                printf("\n");
+                TestPlanner(&sNor);
+            }
+
+            TestReadWrite(&sNor, &sFlash);
+
+            if(j == 2)
+                TestBackground(&sNor, &sFlash);
+
+            Check(sFlash.u32Violations == 0, "no protocol violations");
+            free(sFlash.pu8Mem);
+        }
+    }
+
+    printf("%s\n", s_u32Fail ? "FAIL" : "PASS");
+
+    return s_u32Fail ? 1 : 0;
+}
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
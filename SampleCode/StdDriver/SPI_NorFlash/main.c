@@ -0,0 +1,199 @@
+/**************************************************************************//**
+ * @file     main.c
+ * @version  V3.00
+ * @brief    Access a SPI NOR flash with the SPI NOR library.
+ *           The flash parameters come from its SFDP table, reads use quad I/O through PDMA, and a long erase
+ *           runs in the background while the main loop keeps reading the flash.
+ *           LinuxTool/nor_sim tests the library against simulated flashes on a PC.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include "M451Series.h"
+#include "spi_nor_port.h"
+
+#define PLL_CLOCK           72000000
+
+#define SPI_FLASH_PORT      SPI0
+#define SPI_TX_DMA_CH       0
+#define SPI_RX_DMA_CH       1
+#define SPI_FLASH_CLOCK     36000000
+
+#define TEST_ADDR           0x3000      /* Not aligned to 32 KB and 64 KB blocks */
+#define TEST_LENGTH         0x30000
+#define BUF_SIZE            4096
+
+static SPI_QUEUE_T s_sQueue;
+static SPI_NOR_PORT_T s_sPort;
+static SPI_NOR_T s_sNor;
+
+static uint8_t s_au8SrcArray[BUF_SIZE];
+static uint8_t s_au8DestArray[BUF_SIZE];
+static SPI_NOR_ERASE_STEP_T s_asStep[32];
+
+
+void PDMA_IRQHandler(void)
+{
+    SPI_QueuePdmaHandler(&s_sQueue);
+}
+
+void SYS_Init(void)
+{
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init System Clock                                                                                       */
+    /*---------------------------------------------------------------------------------------------------------*/
+
+    /* Enable external 12MHz XTAL */
+    CLK_EnableXtalRC(CLK_PWRCTL_HXTEN_Msk);
+
+    /* Waiting for clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HXTSTB_Msk);
+
+    /* Switch HCLK clock source to HXT and HCLK source divide 1 */
+    CLK_SetHCLK(CLK_CLKSEL0_HCLKSEL_HXT, CLK_CLKDIV0_HCLK(1));
+
+    /* Set core clock as PLL_CLOCK from PLL */
+    CLK_SetCoreClock(PLL_CLOCK);
+
+    /* Select HXT as the clock source of UART0 */
+    CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL1_UARTSEL_HXT, CLK_CLKDIV0_UART(1));
+
+    /* Enable UART peripheral clock */
+    CLK_EnableModuleClock(UART0_MODULE);
+
+    /* Select PCLK0 as the clock source of SPI0 */
+    CLK_SetModuleClock(SPI0_MODULE, CLK_CLKSEL2_SPI0SEL_PCLK0, MODULE_NoMsk);
+
+    /* Enable SPI0 and PDMA peripheral clock */
+    CLK_EnableModuleClock(SPI0_MODULE);
+    CLK_EnableModuleClock(PDMA_MODULE);
+
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init I/O Multi-function                                                                                 */
+    /*---------------------------------------------------------------------------------------------------------*/
+
+    /* Set PD multi-function pins for UART0 RXD and TXD */
+    SYS->GPD_MFPL &= ~(SYS_GPD_MFPL_PD0MFP_Msk | SYS_GPD_MFPL_PD1MFP_Msk);
+    SYS->GPD_MFPL |= (SYS_GPD_MFPL_PD0MFP_UART0_RXD | SYS_GPD_MFPL_PD1MFP_UART0_TXD);
+
+    /* Set SPI0 multi-function pins for quad mode */
+    SYS->GPB_MFPL &= ~(SYS_GPB_MFPL_PB0MFP_Msk | SYS_GPB_MFPL_PB1MFP_Msk | SYS_GPB_MFPL_PB2MFP_Msk | SYS_GPB_MFPL_PB3MFP_Msk |
+                       SYS_GPB_MFPL_PB4MFP_Msk | SYS_GPB_MFPL_PB5MFP_Msk);
+    SYS->GPB_MFPL |= (SYS_GPB_MFPL_PB0MFP_SPI0_MOSI1 | SYS_GPB_MFPL_PB1MFP_SPI0_MISO1 | SYS_GPB_MFPL_PB2MFP_SPI0_CLK |
+                      SYS_GPB_MFPL_PB3MFP_SPI0_MISO0 | SYS_GPB_MFPL_PB4MFP_SPI0_SS | SYS_GPB_MFPL_PB5MFP_SPI0_MOSI0);
+
+    /* Enable SPI0 I/O higher slew rate */
+    PB->SLEWCTL |= (GPIO_SLEWCTL_HSREN0_Msk | GPIO_SLEWCTL_HSREN1_Msk | GPIO_SLEWCTL_HSREN2_Msk | GPIO_SLEWCTL_HSREN3_Msk |
+                    GPIO_SLEWCTL_HSREN4_Msk | GPIO_SLEWCTL_HSREN5_Msk);
+}
+
+/* Main */
+int main(void)
+{
+    uint32_t u32Clock, u32Start, u32Cycles, u32TimeMs, u32Reads, u32Addr, i;
+    int32_t i32Num;
+
+    /* Unlock protected registers */
+    SYS_UnlockReg();
+
+    /* Init System, IP clock and multi-function I/O */
+    SYS_Init();
+
+    /* Init UART to 115200-8n1 for print message */
+    UART_Open(UART0, 115200);
+
+    /* Enable the cycle counter for the measurements */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    printf("\n+------------------------------------------------------------------------+\n");
+    printf("|                     SPI NOR Flash Library Sample Code                  |\n");
+    printf("+------------------------------------------------------------------------+\n");
+
+    SPI_Open(SPI_FLASH_PORT, SPI_MASTER, SPI_MODE_0, 8, 2000000);
+    SPI_QueueOpen(&s_sQueue, SPI_FLASH_PORT, SPI_TX_DMA_CH, SPI_RX_DMA_CH);
+    u32Clock = SpiNor_PortInit(&s_sNor, &s_sPort, &s_sQueue, SPI_FLASH_CLOCK, NULL);
+
+    if(SpiNor_Open(&s_sNor, SPI_NOR_CAP_DUAL | SPI_NOR_CAP_QUAD) < 0)
+    {
+        printf("No flash found!\n");
+        goto lexit;
+    }
+
+    printf("JEDEC ID 0x%06X, %d KB, %s, SPI clock %d Hz\n", s_sNor.u32JedecId, s_sNor.u32Size / 1024,
+           s_sNor.u8Sfdp ? "SFDP" : "no SFDP", u32Clock);
+    printf("Read command 0x%02X (1-%d-%d), suspend command 0x%02X\n", s_sNor.u8ReadCmd, SPI_NOR_ADDR_LINES(s_sNor.u8ReadBus),
+           SPI_NOR_DATA_LINES(s_sNor.u8ReadBus), s_sNor.u8SuspendCmd);
+
+    for(i = 0; i < s_sNor.u32EraseNum; i++)
+        printf("Erase %2d KB by 0x%02X in %4d ms%s\n", s_sNor.asErase[i].u32Size / 1024, s_sNor.asErase[i].u8Cmd,
+               s_sNor.asErase[i].u32TimeMs, s_sNor.asErase[i].u8Use ? "" : ", not used");
+
+    /* Erase plan of the test range */
+    i32Num = SpiNor_PlanErase(&s_sNor, TEST_ADDR, TEST_LENGTH, s_asStep, sizeof(s_asStep) / sizeof(s_asStep[0]), &u32TimeMs);
+    printf("\nErase plan of 0x%X ~ 0x%X, about %d ms:", TEST_ADDR, TEST_ADDR + TEST_LENGTH - 1, u32TimeMs);
+
+    for(i = 0; i < (uint32_t)i32Num; i++)
+        printf(" %dK", s_asStep[i].u32Size / 1024);
+
+    printf("\n");
+
+    /* The erase runs in the background. The first 4 KB of the flash are read meanwhile. */
+    if(SpiNor_EraseStart(&s_sNor, TEST_ADDR, TEST_LENGTH) < 0)
+        goto lexit;
+
+    u32Start = DWT->CYCCNT;
+    u32Reads = 0;
+
+    while(SpiNor_Poll(&s_sNor) > 0)
+    {
+        SpiNor_Read(&s_sNor, 0, s_au8DestArray, BUF_SIZE);
+        u32Reads++;
+    }
+
+    printf("Erased in %d ms with %d reads of 4 KB and %d suspends\n", (DWT->CYCCNT - u32Start) / (SystemCoreClock / 1000),
+           u32Reads, s_sNor.u32SuspendCnt);
+
+    /* Program the range unaligned to pages */
+    for(i = 0; i < BUF_SIZE; i++)
+        s_au8SrcArray[i] = (uint8_t)(i * 3 + 1);
+
+    printf("Program ...");
+    u32Start = DWT->CYCCNT;
+
+    for(u32Addr = TEST_ADDR + 1; u32Addr + BUF_SIZE <= TEST_ADDR + TEST_LENGTH; u32Addr += BUF_SIZE)
+    {
+        if(SpiNor_Write(&s_sNor, u32Addr, s_au8SrcArray, BUF_SIZE) < 0)
+            goto lexit;
+    }
+
+    u32Cycles = DWT->CYCCNT - u32Start;
+    printf("[OK] %d KB/s\n", (uint32_t)((uint64_t)(u32Addr - TEST_ADDR - 1) * (SystemCoreClock / 1024) / u32Cycles));
+
+    printf("Read ...");
+    u32Start = DWT->CYCCNT;
+
+    for(u32Addr = TEST_ADDR + 1; u32Addr + BUF_SIZE <= TEST_ADDR + TEST_LENGTH; u32Addr += BUF_SIZE)
+    {
+        SpiNor_Read(&s_sNor, u32Addr, s_au8DestArray, BUF_SIZE);
+
+        for(i = 0; i < BUF_SIZE; i++)
+        {
+            if(s_au8DestArray[i] != s_au8SrcArray[i])
+            {
+                printf("[FAIL] at 0x%X\n", u32Addr + i);
+                goto lexit;
+            }
+        }
+    }
+
+    u32Cycles = DWT->CYCCNT - u32Start;
+    printf("[OK] %d KB/s with compare\n", (uint32_t)((uint64_t)(u32Addr - TEST_ADDR - 1) * (SystemCoreClock / 1024) / u32Cycles));
+
+lexit:
+
+    while(1);
+}
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
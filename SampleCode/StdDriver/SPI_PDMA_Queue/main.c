@@ -0,0 +1,259 @@
+/**************************************************************************//**
+ * @file     main.c
+ * @version  V3.00
+ * @brief    Access SPI flash through the SPI transaction queue.
+ *           Every byte is moved by PDMA. Write enable and program commands are queued back to back, and a long
+ *           read runs while the main loop keeps counting.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include "M451Series.h"
+
+#define PLL_CLOCK           72000000
+
+#define SPI_FLASH_PORT      SPI0
+#define SPI_TX_DMA_CH       0
+#define SPI_RX_DMA_CH       1
+
+#define FLASH_PAGE_SIZE     256
+#define TEST_PAGES          4
+#define TEST_LENGTH         (FLASH_PAGE_SIZE * TEST_PAGES)
+
+/* Complete initializers of a single I/O segment and of a transaction on the flash. Private fields start at 0. */
+#define QSEG(tx, rx, len)       {(tx), (rx), (len), SPI_QSEG_SINGLE, {0, 0, 0, 0}, {0, 0, 0, 0}}
+#define QXFER(seg, num, done)   {&s_sFlash, (seg), (num), (done), NULL, 0, 0, NULL}
+
+static SPI_QUEUE_T s_sQueue;
+static SPI_QDEV_T s_sFlash;
+
+static uint8_t s_au8SrcArray[TEST_LENGTH];
+static uint8_t s_au8DestArray[TEST_LENGTH];
+static volatile uint32_t s_u32ReadDone;
+
+
+void PDMA_IRQHandler(void)
+{
+    SPI_QueuePdmaHandler(&s_sQueue);
+}
+
+/* Send a command of up to 4 bytes and receive u32RxLen bytes in one chip select */
+static void SpiFlash_Command(const uint8_t *pu8Cmd, uint32_t u32CmdLen, uint8_t *pu8Rx, uint32_t u32RxLen)
+{
+    SPI_QSEG_T asSeg[2] = {QSEG(NULL, NULL, 0), QSEG(NULL, NULL, 0)};
+    SPI_QXFER_T sXfer = QXFER(NULL, 0, NULL);
+
+    asSeg[0].pu8Tx = pu8Cmd;
+    asSeg[0].u32Len = u32CmdLen;
+    asSeg[1].pu8Rx = pu8Rx;
+    asSeg[1].u32Len = u32RxLen;
+    sXfer.psSeg = asSeg;
+    sXfer.u32SegNum = (u32RxLen == 0) ? 1 : 2;
+
+    SPI_QueueTransfer(&s_sQueue, &sXfer);
+}
+
+uint32_t SpiFlash_ReadJedecID(void)
+{
+    uint8_t u8Cmd = 0x9F, au8Id[3];
+
+    SpiFlash_Command(&u8Cmd, 1, au8Id, 3);
+
+    return (au8Id[0] << 16) | (au8Id[1] << 8) | au8Id[2];
+}
+
+int32_t SpiFlash_WaitReady(void)
+{
+    uint8_t u8Cmd = 0x05, u8Status;
+    uint32_t u32TimeOutCnt = 100000;
+
+    do
+    {
+        SpiFlash_Command(&u8Cmd, 1, &u8Status, 1);
+
+        if(--u32TimeOutCnt == 0)
+        {
+            printf("Wait for SPI flash time-out!\n");
+            return -1;
+        }
+    }
+    while(u8Status & 0x01);
+
+    return 0;
+}
+
+/* Write enable and sector erase are queued together. The bus has no CPU gap between them. */
+void SpiFlash_SectorErase(uint32_t u32Addr)
+{
+    static const uint8_t u8WriteEnable = 0x06;
+    uint8_t au8Cmd[4];
+    SPI_QSEG_T asSeg[2] = {QSEG(&u8WriteEnable, NULL, 1), QSEG(NULL, NULL, 4)};
+    SPI_QXFER_T asXfer[2] = {QXFER(NULL, 1, NULL), QXFER(NULL, 1, NULL)};
+
+    au8Cmd[0] = 0x20;
+    au8Cmd[1] = (uint8_t)(u32Addr >> 16);
+    au8Cmd[2] = (uint8_t)(u32Addr >> 8);
+    au8Cmd[3] = (uint8_t)u32Addr;
+    asSeg[1].pu8Tx = au8Cmd;
+    asXfer[0].psSeg = &asSeg[0];
+    asXfer[1].psSeg = &asSeg[1];
+
+    SPI_QueueSubmit(&s_sQueue, &asXfer[0]);
+    SPI_QueueTransfer(&s_sQueue, &asXfer[1]);
+}
+
+void SpiFlash_PageProgram(uint32_t u32Addr, const uint8_t *pu8Data)
+{
+    static const uint8_t u8WriteEnable = 0x06;
+    uint8_t au8Cmd[4];
+    SPI_QSEG_T asSeg[3] = {QSEG(&u8WriteEnable, NULL, 1), QSEG(NULL, NULL, 4), QSEG(NULL, NULL, FLASH_PAGE_SIZE)};
+    SPI_QXFER_T asXfer[2] = {QXFER(NULL, 1, NULL), QXFER(NULL, 2, NULL)};
+
+    au8Cmd[0] = 0x02;
+    au8Cmd[1] = (uint8_t)(u32Addr >> 16);
+    au8Cmd[2] = (uint8_t)(u32Addr >> 8);
+    au8Cmd[3] = (uint8_t)u32Addr;
+    asSeg[1].pu8Tx = au8Cmd;
+    asSeg[2].pu8Tx = pu8Data;
+    asXfer[0].psSeg = &asSeg[0];
+    asXfer[1].psSeg = &asSeg[1];
+
+    SPI_QueueSubmit(&s_sQueue, &asXfer[0]);
+    SPI_QueueTransfer(&s_sQueue, &asXfer[1]);
+}
+
+static void ReadDone(SPI_QXFER_T *psXfer)
+{
+    s_u32ReadDone = 1;
+}
+
+void SYS_Init(void)
+{
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init System Clock                                                                                       */
+    /*---------------------------------------------------------------------------------------------------------*/
+
+    /* Enable external 12MHz XTAL */
+    CLK_EnableXtalRC(CLK_PWRCTL_HXTEN_Msk);
+
+    /* Waiting for clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HXTSTB_Msk);
+
+    /* Switch HCLK clock source to HXT and HCLK source divide 1 */
+    CLK_SetHCLK(CLK_CLKSEL0_HCLKSEL_HXT, CLK_CLKDIV0_HCLK(1));
+
+    /* Set core clock as PLL_CLOCK from PLL */
+    CLK_SetCoreClock(PLL_CLOCK);
+
+    /* Select HXT as the clock source of UART0 */
+    CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL1_UARTSEL_HXT, CLK_CLKDIV0_UART(1));
+
+    /* Enable UART peripheral clock */
+    CLK_EnableModuleClock(UART0_MODULE);
+
+    /* Select PCLK0 as the clock source of SPI0 */
+    CLK_SetModuleClock(SPI0_MODULE, CLK_CLKSEL2_SPI0SEL_PCLK0, MODULE_NoMsk);
+
+    /* Enable SPI0 and PDMA peripheral clock */
+    CLK_EnableModuleClock(SPI0_MODULE);
+    CLK_EnableModuleClock(PDMA_MODULE);
+
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init I/O Multi-function                                                                                 */
+    /*---------------------------------------------------------------------------------------------------------*/
+
+    /* Set PD multi-function pins for UART0 RXD and TXD */
+    SYS->GPD_MFPL &= ~(SYS_GPD_MFPL_PD0MFP_Msk | SYS_GPD_MFPL_PD1MFP_Msk);
+    SYS->GPD_MFPL |= (SYS_GPD_MFPL_PD0MFP_UART0_RXD | SYS_GPD_MFPL_PD1MFP_UART0_TXD);
+
+    /* Set SPI0 multi-function pins. D2 and D3 of the flash are kept high by GPIO. */
+    SYS->GPB_MFPL &= ~(SYS_GPB_MFPL_PB0MFP_Msk | SYS_GPB_MFPL_PB1MFP_Msk | SYS_GPB_MFPL_PB2MFP_Msk | SYS_GPB_MFPL_PB3MFP_Msk |
+                       SYS_GPB_MFPL_PB4MFP_Msk | SYS_GPB_MFPL_PB5MFP_Msk);
+    SYS->GPB_MFPL |= (SYS_GPB_MFPL_PB2MFP_SPI0_CLK | SYS_GPB_MFPL_PB3MFP_SPI0_MISO0 | SYS_GPB_MFPL_PB4MFP_SPI0_SS |
+                      SYS_GPB_MFPL_PB5MFP_SPI0_MOSI0);
+    PB0 = 1;
+    PB1 = 1;
+    GPIO_SetMode(PB, BIT0 | BIT1, GPIO_MODE_OUTPUT);
+}
+
+/* Main */
+int main(void)
+{
+    static const uint8_t au8ReadCmd[5] = {0x0B, 0, 0, 0, 0};     /* Fast read from address 0 with a dummy byte */
+    static SPI_QSEG_T asReadSeg[2] = {QSEG(au8ReadCmd, NULL, 5), QSEG(NULL, s_au8DestArray, TEST_LENGTH)};
+    static SPI_QXFER_T sRead = QXFER(asReadSeg, 2, ReadDone);
+    uint32_t u32ID, u32Page, u32Loops, i;
+
+    /* Unlock protected registers */
+    SYS_UnlockReg();
+
+    /* Init System, IP clock and multi-function I/O */
+    SYS_Init();
+
+    /* Init UART to 115200-8n1 for print message */
+    UART_Open(UART0, 115200);
+
+    /* Configure SPI_FLASH_PORT as a master with 8-bit data. The queue sets mode and clock for each device. */
+    SPI_Open(SPI_FLASH_PORT, SPI_MASTER, SPI_MODE_0, 8, 2000000);
+    SPI_QueueOpen(&s_sQueue, SPI_FLASH_PORT, SPI_TX_DMA_CH, SPI_RX_DMA_CH);
+    printf("\nFlash clock %d Hz\n", SPI_QueueInitDev(&s_sFlash, &s_sQueue, SPI_MODE_0, 18000000, NULL, SPI_SS_ACTIVE_LOW));
+
+    printf("+------------------------------------------------------------------------+\n");
+    printf("|                  SPI Transaction Queue Sample Code                     |\n");
+    printf("+------------------------------------------------------------------------+\n");
+
+    u32ID = SpiFlash_ReadJedecID();
+    printf("JEDEC ID 0x%06X\n", u32ID);
+
+    if((u32ID == 0) || (u32ID == 0xFFFFFF))
+        goto lexit;
+
+    printf("Erase sector 0 ...");
+    SpiFlash_SectorErase(0);
+
+    if(SpiFlash_WaitReady() < 0)
+        goto lexit;
+
+    printf("[OK]\n");
+
+    for(i = 0; i < TEST_LENGTH; i++)
+        s_au8SrcArray[i] = (uint8_t)(i * 7);
+
+    printf("Program %d pages ...", TEST_PAGES);
+
+    for(u32Page = 0; u32Page < TEST_PAGES; u32Page++)
+    {
+        SpiFlash_PageProgram(u32Page * FLASH_PAGE_SIZE, &s_au8SrcArray[u32Page * FLASH_PAGE_SIZE]);
+
+        if(SpiFlash_WaitReady() < 0)
+            goto lexit;
+    }
+
+    printf("[OK]\n");
+
+    /* The read runs in the background and calls ReadDone() when the chip select is released */
+    s_u32ReadDone = 0;
+    SPI_QueueSubmit(&s_sQueue, &sRead);
+
+    for(u32Loops = 0; !s_u32ReadDone; u32Loops++);
+
+    printf("Read %d bytes while the main loop ran %d times ...", TEST_LENGTH, u32Loops);
+
+    for(i = 0; i < TEST_LENGTH; i++)
+    {
+        if(s_au8DestArray[i] != s_au8SrcArray[i])
+        {
+            printf("[FAIL] at %d\n", i);
+            goto lexit;
+        }
+    }
+
+    printf("[OK]\n");
+
+lexit:
+
+    while(1);
+}
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
@@ -0,0 +1,153 @@
+/**************************************************************************//**
+ * @file     main.c
+ * @version  V3.00
+ * @brief
+ *           Send printf output and receive terminal input with the asynchronous UART API.
+ *           PDMA moves all data of UART0, so the main loop keeps running while a long message is sent.
+ *
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ *
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include "stdio.h"
+#include "M451Series.h"
+
+
+#define PLL_CLOCK       72000000
+
+#define UART_RX_DMA_CH  0
+#define UART_TX_DMA_CH  1
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Global variables                                                                                        */
+/*---------------------------------------------------------------------------------------------------------*/
+static UART_ASYNC_T s_sUart0;
+static uint8_t s_au8TxBuf[1024];
+static uint8_t s_au8RxBuf[256];
+static volatile uint32_t s_u32TxDone;
+
+
+void SYS_Init(void)
+{
+
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init System Clock                                                                                       */
+    /*---------------------------------------------------------------------------------------------------------*/
+
+    /* Enable HIRC clock (Internal RC 22.1184MHz) */
+    CLK_EnableXtalRC(CLK_PWRCTL_HIRCEN_Msk);
+
+    /* Wait for HIRC clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HIRCSTB_Msk);
+
+    /* Select HCLK clock source as HIRC and HCLK clock divider as 1 */
+    CLK_SetHCLK(CLK_CLKSEL0_HCLKSEL_HIRC, CLK_CLKDIV0_HCLK(1));
+
+    /* Enable HXT clock (external XTAL 12MHz) */
+    CLK_EnableXtalRC(CLK_PWRCTL_HXTEN_Msk);
+
+    /* Wait for HXT clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HXTSTB_Msk);
+
+    /* Set core clock as PLL_CLOCK from PLL */
+    CLK_SetCoreClock(PLL_CLOCK);
+
+    /* Enable UART module clock */
+    CLK_EnableModuleClock(UART0_MODULE);
+
+    /* Select UART module clock source as HXT and UART module clock divider as 1 */
+    CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL1_UARTSEL_HXT, CLK_CLKDIV0_UART(1));
+
+    /* Enable PDMA module clock */
+    CLK_EnableModuleClock(PDMA_MODULE);
+
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init I/O Multi-function                                                                                 */
+    /*---------------------------------------------------------------------------------------------------------*/
+
+    /* Set PD multi-function pins for UART0 RXD(PD.0) and TXD(PD.1) */
+    SYS->GPD_MFPL &= ~(SYS_GPD_MFPL_PD0MFP_Msk | SYS_GPD_MFPL_PD1MFP_Msk);
+    SYS->GPD_MFPL |= (SYS_GPD_MFPL_PD0MFP_UART0_RXD | SYS_GPD_MFPL_PD1MFP_UART0_TXD);
+
+}
+
+void PDMA_IRQHandler(void)
+{
+    UART_AsyncPdmaHandler(&s_sUart0);
+}
+
+void UART0_IRQHandler(void)
+{
+    UART_AsyncIrqHandler(&s_sUart0);
+}
+
+/* Called in PDMA interrupt when the TX ring is empty */
+static void TxDone(UART_ASYNC_T *psAsync)
+{
+    s_u32TxDone = 1;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Main Function                                                                                          */
+/*---------------------------------------------------------------------------------------------------------*/
+int32_t main(void)
+{
+    uint8_t au8Line[64];
+    uint32_t u32Loops, u32Len, i;
+
+    /* Unlock protected registers */
+    SYS_UnlockReg();
+
+    /* Init System, peripheral clock and multi-function I/O */
+    SYS_Init();
+
+    /* Lock protected registers */
+    SYS_LockReg();
+
+    /* Init UART0 to 115200-8n1 and hand it to PDMA. printf and getchar go through the rings from now on. */
+    SYS_ResetModule(UART0_RST);
+    UART_Open(UART0, 115200);
+    UART_AsyncOpen(&s_sUart0, UART0, UART_TX_DMA_CH, s_au8TxBuf, sizeof(s_au8TxBuf),
+                   UART_RX_DMA_CH, s_au8RxBuf, sizeof(s_au8RxBuf));
+    s_sUart0.pfnTxDone = TxDone;
+    g_psDebugAsync = &s_sUart0;
+
+    printf("\n\nCPU @ %dHz\n", SystemCoreClock);
+    printf("+-----------------------------------------------+\n");
+    printf("|  UART Asynchronous PDMA Transfer Sample Code  |\n");
+    printf("+-----------------------------------------------+\n");
+
+    /* Queue a long message and count the main loop while PDMA sends it */
+    s_u32TxDone = 0;
+
+    for(i = 0; i < 12; i++)
+        printf("Line %2d of a message which PDMA sends in the background ...\n", i);
+
+    for(u32Loops = 0; !s_u32TxDone; u32Loops++);
+
+    printf("Main loop ran %d times while the message was sent\n\n", u32Loops);
+    printf("Type something. It is echoed line by line. The CPU sleeps while it waits.\n");
+
+    while(1)
+    {
+        /* Sleep until at least one byte is received, then take what has arrived */
+        u32Len = UART_AsyncReadWait(&s_sUart0, au8Line, sizeof(au8Line));
+
+        for(i = 0; i < u32Len; i++)
+        {
+            if(au8Line[i] == '\r')
+                au8Line[i] = '\n';
+        }
+
+        UART_AsyncWriteWait(&s_sUart0, au8Line, u32Len);
+
+        if(s_sUart0.u32RxOverrun)
+        {
+            printf("\n%d bytes lost\n", s_sUart0.u32RxOverrun);
+            s_sUart0.u32RxOverrun = 0;
+        }
+    }
+}
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
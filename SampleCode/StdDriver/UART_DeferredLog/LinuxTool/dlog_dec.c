@@ -0,0 +1,414 @@
+/**************************************************************************//**
+ * @file     dlog_dec.c
+ * @version  V1.00
+ * @brief    Linux tool to decode the records of DLOG()
+ *
+ * @note
+ *           Build : gcc -O2 -o dlog_dec dlog_dec.c
+ *           Usage : dlog_dec [-f CPU clock] [-b baud rate] <image.axf> [tty]
+ *             -f  CPU clock in Hz. Time stamps are printed in seconds. Without it they are printed in cycles.
+ *             -b  115200, 230400, 460800 or 921600. Default 115200.
+ *
+ *           The tool reads the debug port from the tty, or from stdin when no tty is given, so a captured log
+ *           can be decoded later. The format strings and the %s strings are read from the ELF image which
+ *           runs on the chip (Keil .axf, IAR .out or GCC .elf). Bytes which are not a record are printf text
+ *           and are printed as they are.
+ *
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+
+#define DLOG_SYNC           0xA5        /* Same as dlog.h */
+#define DLOG_HDR_WORDS      3
+#define DLOG_MAX_ARGS       8
+
+#define SHT_PROGBITS        1
+#define SHF_ALLOC           2
+#define MAX_SECTION_NUM     64
+
+typedef struct
+{
+    uint64_t u64Addr;
+    uint64_t u64Size;
+    const uint8_t *pu8Data;
+} SECTION_T;
+
+static uint8_t *s_pu8Elf;
+static long s_lElfSize;
+static SECTION_T s_asSec[MAX_SECTION_NUM];
+static uint32_t s_u32SecNum;
+
+static int s_iFd;
+static double s_dCpuClock;
+static uint64_t s_u64Time;
+static uint32_t s_u32LastStamp, s_u32LastDrop;
+static int s_iFirst = 1;
+
+static uint64_t GetN(const uint8_t *pu8Buf, int iLen)
+{
+    uint64_t u64Val = 0;
+
+    while(iLen--)
+        u64Val = (u64Val << 8) | pu8Buf[iLen];
+
+    return u64Val;
+}
+
+/* Keep the sections which are loaded to the chip. Both ELF32 and ELF64 (for host tests) are accepted. */
+static void LoadElf(const char *pcName)
+{
+    FILE *psFile = fopen(pcName, "rb");
+    uint64_t u64ShOff, u64Off;
+    uint32_t u32ShSize, u32ShNum, i;
+    const uint8_t *pu8Sh;
+    int i64Bit;
+
+    if(psFile == NULL)
+    {
+        perror(pcName);
+        exit(1);
+    }
+
+    fseek(psFile, 0, SEEK_END);
+    s_lElfSize = ftell(psFile);
+    rewind(psFile);
+    s_pu8Elf = malloc(s_lElfSize);
+
+    if((s_pu8Elf == NULL) || (fread(s_pu8Elf, 1, s_lElfSize, psFile) != (size_t)s_lElfSize) || (s_lElfSize < 64) ||
+            memcmp(s_pu8Elf, "\177ELF", 4) || (s_pu8Elf[5] != 1))
+    {
+        fprintf(stderr, "%s is not a little endian ELF file\n", pcName);
+        exit(1);
+    }
+
+    fclose(psFile);
+    i64Bit = (s_pu8Elf[4] == 2);
+    u64ShOff = i64Bit ? GetN(s_pu8Elf + 0x28, 8) : GetN(s_pu8Elf + 0x20, 4);
+    u32ShSize = (uint32_t)GetN(s_pu8Elf + (i64Bit ? 0x3A : 0x2E), 2);
+    u32ShNum = (uint32_t)GetN(s_pu8Elf + (i64Bit ? 0x3C : 0x30), 2);
+
+    for(i = 0; i < u32ShNum; i++)
+    {
+        if(u64ShOff + (uint64_t)(i + 1) * u32ShSize > (uint64_t)s_lElfSize)
+            break;
+
+        pu8Sh = s_pu8Elf + u64ShOff + (uint64_t)i * u32ShSize;
+
+        if((GetN(pu8Sh + 4, 4) != SHT_PROGBITS) || !(GetN(pu8Sh + 8, i64Bit ? 8 : 4) & SHF_ALLOC) ||
+                (s_u32SecNum == MAX_SECTION_NUM))
+            continue;
+
+        s_asSec[s_u32SecNum].u64Addr = i64Bit ? GetN(pu8Sh + 0x10, 8) : GetN(pu8Sh + 0x0C, 4);
+        u64Off = i64Bit ? GetN(pu8Sh + 0x18, 8) : GetN(pu8Sh + 0x10, 4);
+        s_asSec[s_u32SecNum].u64Size = i64Bit ? GetN(pu8Sh + 0x20, 8) : GetN(pu8Sh + 0x14, 4);
+
+        if(u64Off + s_asSec[s_u32SecNum].u64Size > (uint64_t)s_lElfSize)
+            continue;
+
+        s_asSec[s_u32SecNum++].pu8Data = s_pu8Elf + u64Off;
+    }
+
+    if(s_u32SecNum == 0)
+    {
+        fprintf(stderr, "%s has no loadable section\n", pcName);
+        exit(1);
+    }
+}
+
+/* Find the string at a chip address. Returns NULL if it is not a terminated string of the image. */
+static const char *GetString(uint32_t u32Addr)
+{
+    uint32_t i;
+
+    for(i = 0; i < s_u32SecNum; i++)
+    {
+        if((u32Addr >= s_asSec[i].u64Addr) && (u32Addr < s_asSec[i].u64Addr + s_asSec[i].u64Size))
+        {
+            uint64_t u64Off = u32Addr - s_asSec[i].u64Addr;
+
+            if(memchr(s_asSec[i].pu8Data + u64Off, 0, s_asSec[i].u64Size - u64Off) == NULL)
+                return NULL;
+
+            return (const char *)s_asSec[i].pu8Data + u64Off;
+        }
+    }
+
+    return NULL;
+}
+
+static int OpenTty(const char *pcName, speed_t sSpeed)
+{
+    struct termios sTio;
+    int iFd = open(pcName, O_RDONLY | O_NOCTTY);
+
+    if(iFd < 0)
+    {
+        perror(pcName);
+        exit(1);
+    }
+
+    tcgetattr(iFd, &sTio);
+    cfmakeraw(&sTio);
+    cfsetispeed(&sTio, sSpeed);
+    cfsetospeed(&sTio, sSpeed);
+    sTio.c_cflag |= (CLOCAL | CREAD);
+    sTio.c_cflag &= ~(CSTOPB | CRTSCTS);
+    tcsetattr(iFd, TCSANOW, &sTio);
+    tcflush(iFd, TCIFLUSH);
+
+    return iFd;
+}
+
+/* Returns the next input byte or -1 at the end of input */
+static int GetByte(void)
+{
+    static uint8_t au8Buf[4096];
+    static ssize_t n, i;
+
+    if(i == n)
+    {
+        fflush(stdout);
+        n = read(s_iFd, au8Buf, sizeof(au8Buf));
+        i = 0;
+
+        if(n <= 0)
+            return -1;
+    }
+
+    return au8Buf[i++];
+}
+
+static int GetBytes(uint8_t *pu8Buf, uint32_t u32Len)
+{
+    int iData;
+
+    while(u32Len--)
+    {
+        if((iData = GetByte()) < 0)
+            return -1;
+
+        *pu8Buf++ = (uint8_t)iData;
+    }
+
+    return 0;
+}
+
+/* Format one record like printf. Every conversion takes one 32-bit word. */
+static void PrintRecord(const char *pcFmt, const uint32_t *pu32Arg, uint32_t u32Num)
+{
+    char acSpec[32], acNum[16];
+    const char *pcStr;
+    uint32_t u32Arg, u32Used = 0;
+    size_t n;
+
+#define NEXT_ARG()  ((u32Used < u32Num) ? pu32Arg[u32Used++] : 0)
+
+    while(*pcFmt)
+    {
+        if(*pcFmt != '%')
+        {
+            putchar(*pcFmt++);
+            continue;
+        }
+
+        acSpec[0] = *pcFmt++;
+        n = 1;
+
+        /* Flags, width and precision. '*' takes an argument. */
+        while(*pcFmt && strchr("-+ #0123456789.*", *pcFmt) && (n < sizeof(acSpec) - sizeof(acNum) - 2))
+        {
+            if(*pcFmt == '*')
+            {
+                snprintf(acNum, sizeof(acNum), "%d", (int32_t)NEXT_ARG());
+                memcpy(acSpec + n, acNum, strlen(acNum));
+                n += strlen(acNum);
+                pcFmt++;
+            }
+            else
+                acSpec[n++] = *pcFmt++;
+        }
+
+        /* Length modifiers do not change a 32-bit word */
+        while(*pcFmt && strchr("hlzjtL", *pcFmt))
+            pcFmt++;
+
+        if(*pcFmt == 0)
+            break;
+
+        acSpec[n++] = *pcFmt;
+        acSpec[n] = 0;
+
+        switch(*pcFmt++)
+        {
+            case '%':
+                putchar('%');
+                break;
+
+            case 'd':
+            case 'i':
+            case 'c':
+                printf(acSpec, (int32_t)NEXT_ARG());
+                break;
+
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                printf(acSpec, NEXT_ARG());
+                break;
+
+            case 'p':
+                printf("0x%08X", NEXT_ARG());
+                break;
+
+            case 's':
+                u32Arg = NEXT_ARG();
+
+                if((pcStr = GetString(u32Arg)) != NULL)
+                    printf(acSpec, pcStr);
+                else
+                    printf("<0x%08X>", u32Arg);
+
+                break;
+
+            default:
+                /* float and double are not stored by DLOG() */
+                NEXT_ARG();
+                printf("<%s?>", acSpec);
+                break;
+        }
+    }
+
+#undef NEXT_ARG
+}
+
+static void DecodeRecord(const uint8_t *pu8Hdr)
+{
+    uint32_t au32Arg[DLOG_MAX_ARGS], u32Num = pu8Hdr[1], u32Drop = (uint32_t)GetN(pu8Hdr + 2, 2);
+    uint32_t u32Fmt = (uint32_t)GetN(pu8Hdr + 4, 4), u32Stamp = (uint32_t)GetN(pu8Hdr + 8, 4), i;
+    uint8_t au8Arg[DLOG_MAX_ARGS * 4];
+    const char *pcFmt;
+
+    if(GetBytes(au8Arg, u32Num * 4) < 0)
+        return;
+
+    for(i = 0; i < u32Num; i++)
+        au32Arg[i] = (uint32_t)GetN(au8Arg + i * 4, 4);
+
+    /* The cycle counter wraps in a minute at 72 MHz. Records are sent in order, so add the differences. */
+    if(!s_iFirst)
+        s_u64Time += (uint32_t)(u32Stamp - s_u32LastStamp);
+
+    s_u32LastStamp = u32Stamp;
+
+    if(!s_iFirst && (u32Drop != s_u32LastDrop))
+        printf("[%u records dropped]\n", (uint16_t)(u32Drop - s_u32LastDrop));
+
+    s_u32LastDrop = u32Drop;
+    s_iFirst = 0;
+
+    if(s_dCpuClock > 0)
+        printf("[%12.6f] ", s_u64Time / s_dCpuClock);
+    else
+        printf("[%12llu] ", (unsigned long long)s_u64Time);
+
+    if((pcFmt = GetString(u32Fmt)) == NULL)
+    {
+        printf("<unknown format 0x%08X>\n", u32Fmt);
+        return;
+    }
+
+    PrintRecord(pcFmt, au32Arg, u32Num);
+}
+
+int main(int argc, char *argv[])
+{
+    uint8_t au8Hdr[DLOG_HDR_WORDS * 4];
+    speed_t sSpeed = B115200;
+    int iOpt, iData;
+
+    while((iOpt = getopt(argc, argv, "f:b:")) != -1)
+    {
+        switch(iOpt)
+        {
+            case 'f':
+                s_dCpuClock = atof(optarg);
+                break;
+
+            case 'b':
+                switch(atoi(optarg))
+                {
+                    case 115200:
+                        sSpeed = B115200;
+                        break;
+
+                    case 230400:
+                        sSpeed = B230400;
+                        break;
+
+                    case 460800:
+                        sSpeed = B460800;
+                        break;
+
+                    case 921600:
+                        sSpeed = B921600;
+                        break;
+
+                    default:
+                        fprintf(stderr, "Unsupported baud rate %s\n", optarg);
+                        return 1;
+                }
+
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-f CPU clock] [-b baud rate] <image.axf> [tty]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if((optind != argc - 1) && (optind != argc - 2))
+    {
+        fprintf(stderr, "Usage: %s [-f CPU clock] [-b baud rate] <image.axf> [tty]\n", argv[0]);
+        return 1;
+    }
+
+    LoadElf(argv[optind]);
+    s_iFd = (optind == argc - 2) ? OpenTty(argv[optind + 1], sSpeed) : STDIN_FILENO;
+
+    while((iData = GetByte()) >= 0)
+    {
+        if(iData != DLOG_SYNC)
+        {
+            /* printf text. The UART driver sends "\r\n". */
+            if(iData != '\r')
+                putchar(iData);
+
+            continue;
+        }
+
+        au8Hdr[0] = (uint8_t)iData;
+
+        if(GetBytes(au8Hdr + 1, sizeof(au8Hdr) - 1) < 0)
+            break;
+
+        if(au8Hdr[1] > DLOG_MAX_ARGS)
+        {
+            printf("<bad record>\n");
+            continue;
+        }
+
+        DecodeRecord(au8Hdr);
+    }
+
+    return 0;
+}
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
@@ -0,0 +1,162 @@
+/**************************************************************************//**
+ * @file     main.c
+ * @version  V3.00
+ * @brief
+ *           Log from a 1 kHz timer interrupt with DLOG(). The interrupt only stores the format string address
+ *           and the arguments. The main loop hands the records to PDMA, and LinuxTool/dlog_dec formats them
+ *           on the PC:
+ *             dlog_dec -f 72000000 KEIL/obj/UART_DeferredLog.axf /dev/ttyUSB0
+ *
+ * @note
+ * @copyright SPDX-License-Identifier: Apache-2.0
+ *
+ * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include "M451Series.h"
+
+
+#define PLL_CLOCK       72000000
+
+#define UART_TX_DMA_CH  0
+#define LOG_PERIOD      10          /* Log every 10th timer interrupt */
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Global variables                                                                                        */
+/*---------------------------------------------------------------------------------------------------------*/
+static UART_ASYNC_T s_sUart0;
+static uint8_t s_au8TxBuf[1024];
+static uint32_t s_au32LogBuf[256];
+static volatile uint32_t s_u32Ticks;
+static uint32_t s_u32LogCycles;
+
+
+void TMR0_IRQHandler(void)
+{
+    uint32_t u32Start;
+
+    if(TIMER_GetIntFlag(TIMER0) == 1)
+    {
+        /* Clear Timer0 time-out interrupt flag */
+        TIMER_ClearIntFlag(TIMER0);
+
+        if((++s_u32Ticks % LOG_PERIOD) == 0)
+        {
+            u32Start = DWT->CYCCNT;
+            DLOG("Tick %u, last DLOG() took %u cycles, %u dropped\n", s_u32Ticks, s_u32LogCycles, DLOG_GetDropCount());
+            s_u32LogCycles = DWT->CYCCNT - u32Start;
+        }
+    }
+}
+
+void PDMA_IRQHandler(void)
+{
+    UART_AsyncPdmaHandler(&s_sUart0);
+}
+
+void UART0_IRQHandler(void)
+{
+    UART_AsyncIrqHandler(&s_sUart0);
+}
+
+void SYS_Init(void)
+{
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init System Clock                                                                                       */
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Enable HIRC clock */
+    CLK_EnableXtalRC(CLK_PWRCTL_HIRCEN_Msk);
+
+    /* Waiting for HIRC clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HIRCSTB_Msk);
+
+    /* Switch HCLK clock source to HIRC */
+    CLK_SetHCLK(CLK_CLKSEL0_HCLKSEL_HIRC, CLK_CLKDIV0_HCLK(1));
+
+    /* Enable HXT */
+    CLK_EnableXtalRC(CLK_PWRCTL_HXTEN_Msk);
+
+    /* Waiting for clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HXTSTB_Msk);
+
+    /* Set core clock as PLL_CLOCK from PLL */
+    CLK_SetCoreClock(PLL_CLOCK);
+
+    /* Enable peripheral clock */
+    CLK_EnableModuleClock(UART0_MODULE);
+    CLK_EnableModuleClock(TMR0_MODULE);
+    CLK_EnableModuleClock(PDMA_MODULE);
+
+    /* Peripheral clock source */
+    CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL1_UARTSEL_HXT, CLK_CLKDIV0_UART(1));
+    CLK_SetModuleClock(TMR0_MODULE, CLK_CLKSEL1_TMR0SEL_HXT, 0);
+
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Init I/O Multi-function                                                                                 */
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* Set PD multi-function pins for UART0 RXD and TXD */
+    SYS->GPD_MFPL &= ~(SYS_GPD_MFPL_PD0MFP_Msk | SYS_GPD_MFPL_PD1MFP_Msk);
+    SYS->GPD_MFPL |= (SYS_GPD_MFPL_PD0MFP_UART0_RXD | SYS_GPD_MFPL_PD1MFP_UART0_TXD);
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Main Function                                                                                          */
+/*---------------------------------------------------------------------------------------------------------*/
+int main(void)
+{
+    uint32_t u32Start, u32DlogCycles, u32PrintfCycles, u32Loops = 0;
+
+    /* Unlock protected registers */
+    SYS_UnlockReg();
+
+    /* Init System, peripheral clock and multi-function I/O */
+    SYS_Init();
+
+    /* Lock protected registers */
+    SYS_LockReg();
+
+    /* Init UART0 to 115200-8n1 for print message */
+    SYS_ResetModule(UART0_RST);
+    UART_Open(UART0, 115200);
+
+    /* Start the log. It enables the DWT cycle counter too. */
+    DLOG_Open(s_au32LogBuf, sizeof(s_au32LogBuf) / sizeof(uint32_t));
+
+    printf("\n\nCPU @ %d Hz\n", SystemCoreClock);
+    printf("+-------------------------------------------+\n");
+    printf("|    UART Deferred Debug Log Sample Code    |\n");
+    printf("+-------------------------------------------+\n");
+
+    /* Compare one message of both ways. printf waits for the UART FIFO. */
+    u32Start = DWT->CYCCNT;
+    DLOG("DLOG %u %u\n", 1, 2);
+    u32DlogCycles = DWT->CYCCNT - u32Start;
+
+    u32Start = DWT->CYCCNT;
+    printf("printf %u %u\n", 1, 2);
+    u32PrintfCycles = DWT->CYCCNT - u32Start;
+
+    DLOG_Flush();
+    printf("DLOG() took %u cycles, printf() took %u cycles\n", u32DlogCycles, u32PrintfCycles);
+
+    /* From now on PDMA sends the records and the printf text */
+    UART_AsyncOpen(&s_sUart0, UART0, UART_TX_DMA_CH, s_au8TxBuf, sizeof(s_au8TxBuf), UART_ASYNC_NO_CH, NULL, 0);
+    g_psDebugAsync = &s_sUart0;
+
+    /* Open Timer0 in periodic mode at 1 kHz */
+    TIMER_Open(TIMER0, TIMER_PERIODIC_MODE, 1000);
+    TIMER_EnableInt(TIMER0);
+    NVIC_EnableIRQ(TMR0_IRQn);
+    TIMER_Start(TIMER0);
+
+    while(1)
+    {
+        /* The drain task. It never waits for the UART. */
+        DLOG_Process();
+
+        if((++u32Loops % 1000000) == 0)
+            DLOG("Main loop %u\n", u32Loops);
+    }
+}
+
+/*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
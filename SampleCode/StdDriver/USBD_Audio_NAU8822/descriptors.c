@@ -39,7 +39,7 @@ const uint8_t gu8ConfigDescriptor[] =
 {
     LEN_CONFIG,     /* bLength */
     DESC_CONFIG,    /* bDescriptorType */
-    0xC2, 0x00,     /* wTotalLength */
+    0xCB, 0x00,     /* wTotalLength */
     0x03,           /* bNumInterfaces */
     0x01,           /* bConfigurationValue */
     0x00,           /* iConfiguration */
@@ -212,7 +212,7 @@ const uint8_t gu8ConfigDescriptor[] =
     0x04,           /* bDescriptorType */
     0x02,           /* bInterfaceNumber */
     0x01,           /* bAlternateSetting */
-    0x01,           /* bNumEndpoints */
+    0x02,           /* bNumEndpoints */
     0x01,           /* bInterfaceClass:AUDIO */
     0x02,           /* bInterfaceSubClass:AUDIOSTREAMING */
     0x00,           /* bInterfaceProtocol */
@@ -239,15 +239,15 @@ const uint8_t gu8ConfigDescriptor[] =
     PLAY_RATE_MD,
     PLAY_RATE_HI,   /* Sample Frequency */
 
-    /* Standard AS ISO Audio Data Endpoint, output, addtess 2, Max 0x40 */
+    /* Standard AS ISO Audio Data Endpoint, output, addtess 2, asynchronous */
     0x09,                       /* bLength */
     0x05,                       /* bDescriptorType */
     ISO_OUT_EP_NUM | EP_OUTPUT, /* bEndpointAddress */
-    0x0d,                       /* bmAttributes */
-    EP3_MAX_PKT_SIZE, 0x00,     /* wMaxPacketSize */
+    0x05,                       /* bmAttributes: isochronous, asynchronous */
+    (EP3_MAX_PKT_SIZE & 0xFF), ((EP3_MAX_PKT_SIZE >> 8) & 0xFF), /* wMaxPacketSize */
     0x01,                       /* bInterval */
     0x00,                       /* bRefresh */
-    0x00,                       /* bSynchAddress */
+    ISO_FB_EP_NUM | EP_INPUT,   /* bSynchAddress */
 
     /* Class-spec AS ISO Audio Data endpoint Descriptor */
     0x07,           /* bLength */
@@ -256,6 +256,16 @@ const uint8_t gu8ConfigDescriptor[] =
     0x80,           /* bmAttributes */
     0x00,           /* bLockDelayUnits */
     0x00, 0x00,     /* wLockDelay */
+
+    /* Standard AS ISO Synch Feedback Endpoint, input, address 3 */
+    0x09,                       /* bLength */
+    0x05,                       /* bDescriptorType */
+    ISO_FB_EP_NUM | EP_INPUT,   /* bEndpointAddress */
+    0x01,                       /* bmAttributes: isochronous. UAC 1.0 synch endpoints use no usage bits */
+    EP4_MAX_PKT_SIZE, 0x00,     /* wMaxPacketSize */
+    0x01,                       /* bInterval */
+    FB_REFRESH,                 /* bRefresh */
+    0x00,                       /* bSynchAddress */
 };
 
 /*!<USB Language String Descriptor */
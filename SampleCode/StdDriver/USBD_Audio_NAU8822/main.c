@@ -171,8 +171,8 @@ int32_t main(void)
         uint32_t u32Reg, u32Data;
         extern int32_t kbhit(void);
 
-        /* Adjust codec sampling rate to synch with USB. The adjustment range is +-0.005% */
-        AdjFreq();
+        /* Show asynchronous feedback and play buffer status. Codec clock is not retuned */
+        UAC_ShowStatus();
 
         /* Set audio volume according USB volume control settings */
         VolumnControl();
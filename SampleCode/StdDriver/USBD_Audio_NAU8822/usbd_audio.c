@@ -34,19 +34,16 @@ volatile int16_t g_usbd_PlayResVolume = 0x400;
 
 static volatile uint8_t g_u8RecEn = 0;
 static volatile uint8_t g_u8PlayEn = 0;      /* To indicate data is output to I2S */
-static volatile int32_t g_i32AdjFlag = 0;    /* To indicate current I2S frequency adjustment status */
+
+/* Asynchronous feedback. I2S samples are counted and sampled once per frame (ISO OUT packet) */
+static volatile uint32_t g_u32PlaySampleCnt = 0;   /* Samples output to I2S */
+static volatile uint32_t g_u32FbValue = FB_NOMINAL; /* Current feedback in 10.14 format */
 
 
 /*******************************************************************/
-typedef enum
-{
-    E_RS_NONE,          // no resampling
-    E_RS_UP,            // up sampling
-    E_RS_DOWN           // down sampling
-} RESAMPLE_STATE_T;
 
 /* Temp buffer for play and record */
-uint32_t g_au32UsbTmpBuf[((PLAY_RATE > REC_RATE) ? PLAY_RATE : REC_RATE) / 2000 * ((PLAY_CHANNELS > REC_CHANNELS) ? PLAY_CHANNELS : REC_CHANNELS)] = {0};
+uint32_t g_au32UsbTmpBuf[EP3_MAX_PKT_SIZE / 4] = {0};
 
 /* Recoder Buffer and its pointer */
 uint32_t g_au32PcmRecBuf[96] = {0};
@@ -195,6 +192,9 @@ void USBD_IRQHandler(void)
         {
             /* Clear event flag */
             USBD_CLR_INT_FLAG(USBD_INTSTS_EP4);
+
+            // Isochronous IN feedback
+            EP4_Handler();
         }
 
         if(u32IntSts & USBD_INTSTS_EP5)
@@ -267,15 +267,17 @@ void EP3_Handler(void)
     /* Get the address in USB buffer */
     pu8Src = (uint8_t *)((uint32_t)USBD_BUF_BASE + USBD_GET_EP_BUF_ADDR(EP3));
 
+    /* Byte size of play data. It varies frame by frame according to the feedback */
+    u32Len = USBD_GET_PAYLOAD_LEN(EP3);
+    if(u32Len > EP3_MAX_PKT_SIZE)
+        u32Len = EP3_MAX_PKT_SIZE;
+
     /* Prepare for nex OUT packet */
     USBD_SET_PAYLOAD_LEN(EP3, EP3_MAX_PKT_SIZE);
 
     /* Get the temp buffer */
     pu8Buf = (uint8_t *)g_au32UsbTmpBuf;
 
-    /* Calculate byte size of play data */
-    u32Len = PLAY_RATE / 1000 * PLAY_CHANNELS * 2;
-
     /* Copy all data from USB buffer to SRAM buffer */
     /* We assume the source data are 4 bytes alignment. */
     for(i = 0; i < u32Len; i += 4)
@@ -313,7 +315,71 @@ void EP3_Handler(void)
             g_u8PlayEn = 1;
     }
 
+    /* One ISO OUT packet per frame. Use it as frame clock to measure I2S rate */
+    UAC_UpdateFeedback();
+}
+
+/**
+ * @brief       Update asynchronous feedback value
+ *
+ * @param[in]   None
+ *
+ * @return      None
+ *
+ * @details     This function is called once per USB frame. Every 2^FB_REFRESH frames it calculates
+ *              the number of samples consumed by I2S per frame in 10.14 format and adds a small
+ *              correction to keep the play buffer half full.
+ */
+void UAC_UpdateFeedback(void)
+{
+    static uint32_t u32FrameCnt = 0;
+    static uint32_t u32PreSampleCnt = 0;
+    uint32_t u32SampleCnt;
+    int32_t i32Fb;
+
+    if(++u32FrameCnt < (1 << FB_REFRESH))
+        return;
+    u32FrameCnt = 0;
+
+    u32SampleCnt = g_u32PlaySampleCnt;
+
+    /* Samples in 2^FB_REFRESH frames to samples per frame in 10.14 format */
+    i32Fb = (int32_t)((u32SampleCnt - u32PreSampleCnt) << (14 - FB_REFRESH));
+    u32PreSampleCnt = u32SampleCnt;
+
+    /* Elastic buffer. Ask for more data if less than half full and less data if more than half full */
+    i32Fb += ((int32_t)(BUF_LEN / 2) - (int32_t)GetSamplesInBuf()) << FB_FILL_GAIN;
 
+    if(i32Fb > FB_NOMINAL + FB_MAX_DEV)
+        i32Fb = FB_NOMINAL + FB_MAX_DEV;
+    else if(i32Fb < FB_NOMINAL - FB_MAX_DEV)
+        i32Fb = FB_NOMINAL - FB_MAX_DEV;
+
+    g_u32FbValue = (uint32_t)i32Fb;
+}
+
+/**
+ * @brief       EP4 Handler (ISO IN feedback interrupt handler)
+ *
+ * @param[in]   None
+ *
+ * @return      None
+ *
+ * @details     This function is used to prepare the 3-byte 10.14 feedback value for next ISO IN transfer.
+ */
+void EP4_Handler(void)
+{
+    uint8_t *pu8Buf;
+    uint32_t u32Fb;
+
+    pu8Buf = (uint8_t *)((uint32_t)USBD_BUF_BASE + USBD_GET_EP_BUF_ADDR(EP4));
+
+    u32Fb = g_u32FbValue;
+    pu8Buf[0] = (uint8_t)u32Fb;
+    pu8Buf[1] = (uint8_t)(u32Fb >> 8);
+    pu8Buf[2] = (uint8_t)(u32Fb >> 16);
+
+    USBD_SET_PAYLOAD_LEN(EP4, EP4_MAX_PKT_SIZE);
 }
 
 
@@ -358,6 +424,12 @@ void UAC_Init(void)
     USBD_SET_EP_BUF_ADDR(EP3, EP3_BUF_BASE);
     /* trigger receive OUT data */
     USBD_SET_PAYLOAD_LEN(EP3, EP3_MAX_PKT_SIZE);
+
+    /*****************************************************/
+    /* EP4 ==> Isochronous IN feedback endpoint, address 3 */
+    USBD_CONFIG_EP(EP4, USBD_CFG_EPMODE_IN | ISO_FB_EP_NUM | USBD_CFG_TYPE_ISO);
+    /* Buffer offset for EP4 */
+    USBD_SET_EP_BUF_ADDR(EP4, EP4_BUF_BASE);
 }
 
 
@@ -659,6 +731,8 @@ void UAC_SetInterface(void)
         if(u32AltInterface == 1)
         {
             USBD_SET_PAYLOAD_LEN(EP3, EP3_MAX_PKT_SIZE);
+            g_u32FbValue = FB_NOMINAL;
+            EP4_Handler();
             UAC_DeviceEnable(UAC_SPEAKER);
         }
         else
@@ -788,6 +862,9 @@ void SPI1_IRQHandler(void)
             }
         }
 
+        /* Count samples clocked out by codec for feedback */
+        g_u32PlaySampleCnt += 2;
+
     }
 
     if(u32I2SIntFlag & SPI_I2SSTS_RXTHIF_Msk)
@@ -920,92 +997,23 @@ void UAC_DeviceDisable(uint8_t u8Object)
 
 
 
-void AdjustCodecPll(RESAMPLE_STATE_T r)
+void UAC_ShowStatus(void)
 {
-    static uint16_t tb[3][3] = {{0x00C, 0x093, 0x0E9}, // 8.192
-        {0x00E, 0x1D2, 0x1E3},  // * 1.005 = 8.233
-        {0x009, 0x153, 0x1EF}
-    }; // * .995 = 8.151
-    static RESAMPLE_STATE_T current = E_RS_NONE;
-    int i, s;
-
-    if(r == current)
-        return;
-    else
-        current = r;
-    switch(r)
-    {
-        case E_RS_UP:
-            s = 1;
-            break;
-        case E_RS_DOWN:
-            s = 2;
-            break;
-        case E_RS_NONE:
-        default:
-            s = 0;
-    }
-
-    for(i = 0; i < 3; i++)
-        I2C_WriteNAU8822(37 + i, tb[s][i]);
-}
-
-
-
-void AdjFreq(void)
-{
-    uint32_t u32Size;
-    static int32_t i32PreFlag = 0;
+    static uint32_t u32PreFb = FB_NOMINAL;
     static int32_t i32Cnt = 0;
 
-    /* Only adjust the frequency when play data */
+    /* Only show status when play data */
     if(g_u8PlayEn == 0)
         return;
 
-    /* Get sample size in play buffer */
-    u32Size = GetSamplesInBuf();
-
-
-    if(g_i32AdjFlag == 0)
+    /* Show feedback, buffer, volume status */
+    if((u32PreFb != g_u32FbValue) || (i32Cnt++ > 40000))
     {
-        /* Check if we need to adjust the frequency when we didn't in adjusting state */
-        if(u32Size > (BUF_LEN * 3 / 4))
-        {
-            /* USB rate > I2S rate. So we increase I2S rate here */
-            AdjustCodecPll(E_RS_UP);
-            g_i32AdjFlag = -1;
-        }
-        else if(u32Size < (BUF_LEN * 1 / 4))
-        {
-            /* USB rate < I2S rate. So we decrease I2S rate here */
-            AdjustCodecPll(E_RS_DOWN);
-            g_i32AdjFlag = 1;
-        }
-    }
-    else
-    {
-        /* Check if we need to stop adjust the frequency when we are in adjusting state */
-        if((g_i32AdjFlag > 0) && (u32Size > BUF_LEN / 2))
-        {
-            AdjustCodecPll(E_RS_NONE);
-            g_i32AdjFlag = 0;
-        }
-
-        if((g_i32AdjFlag < 0) && (u32Size < BUF_LEN / 2))
-        {
-            AdjustCodecPll(E_RS_NONE);
-            g_i32AdjFlag = 0;
-        }
-    }
-
-    /* Show adjustment, buffer, volume status */
-    if((i32PreFlag != g_i32AdjFlag) || (i32Cnt++ > 40000))
-    {
-        i32PreFlag = g_i32AdjFlag;
-        printf("%d %d %d %d\n", g_i32AdjFlag, u32Size, g_usbd_PlayVolumeL, g_usbd_RecVolumeL);
+        u32PreFb = g_u32FbValue;
+        printf("%d.%04d %d %d %d\n", u32PreFb >> 14, ((u32PreFb & 0x3FFF) * 10000) >> 14,
+               GetSamplesInBuf(), g_usbd_PlayVolumeL, g_usbd_RecVolumeL);
         i32Cnt = 0;
     }
-
 }
 
 void VolumnControl(void)
@@ -89,7 +89,8 @@
 #define EP0_MAX_PKT_SIZE    8
 #define EP1_MAX_PKT_SIZE    EP0_MAX_PKT_SIZE
 #define EP2_MAX_PKT_SIZE    256
-#define EP3_MAX_PKT_SIZE    PLAY_RATE*PLAY_CHANNELS*2/1000
+#define EP3_MAX_PKT_SIZE    ((PLAY_RATE/1000 + 1)*PLAY_CHANNELS*2)  /* One extra sample for asynchronous rate feedback */
+#define EP4_MAX_PKT_SIZE    3                                       /* 10.14 feedback value */
 
 #define SETUP_BUF_BASE      0
 #define SETUP_BUF_LEN       8
@@ -100,11 +101,21 @@
 #define EP2_BUF_BASE        (EP1_BUF_BASE + EP1_BUF_LEN)
 #define EP2_BUF_LEN         EP2_MAX_PKT_SIZE
 #define EP3_BUF_BASE        (EP2_BUF_BASE + EP2_BUF_LEN)
-#define EP3_BUF_LEN         EP3_MAX_PKT_SIZE
+#define EP3_BUF_LEN         ((EP3_MAX_PKT_SIZE + 7) & ~7)
+#define EP4_BUF_BASE        (EP3_BUF_BASE + EP3_BUF_LEN)
+#define EP4_BUF_LEN         8
 
 /* Define the interrupt In EP number */
 #define ISO_IN_EP_NUM    0x01
 #define ISO_OUT_EP_NUM   0x02
+#define ISO_FB_EP_NUM    0x03
+
+/*-------------------------------------------------------------*/
+/* Asynchronous feedback endpoint */
+#define FB_REFRESH      5                               /* Feedback refreshed every 2^FB_REFRESH frames (bRefresh) */
+#define FB_NOMINAL      ((PLAY_RATE / 1000) << 14)      /* Nominal samples per frame in 10.14 format */
+#define FB_MAX_DEV      (1 << 13)                       /* Clamp feedback to nominal +- 0.5 sample per frame */
+#define FB_FILL_GAIN    4                               /* Buffer fill error (samples) << FB_FILL_GAIN is added to feedback */
 
 /*-------------------------------------------------------------*/
 extern volatile uint32_t g_usbd_UsbAudioState;
@@ -122,10 +133,12 @@ void UAC_SetInterface(void);
 
 void EP2_Handler(void);
 void EP3_Handler(void);
+void EP4_Handler(void);
+void UAC_UpdateFeedback(void);
 
 void NAU8822_Setup(void);
 void timer_init(void);
-void AdjFreq(void);
+void UAC_ShowStatus(void);
 void VolumnControl(void);
 void I2C_WriteNAU8822(uint8_t u8addr, uint16_t u16data);
 
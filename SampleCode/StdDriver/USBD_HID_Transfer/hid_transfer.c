@@ -13,10 +13,15 @@
 #include "M451Series.h"
 #include "hid_transfer.h"
 
-uint8_t volatile g_u8EP2Ready = 0;
 uint8_t volatile g_u8Suspend = 0;
 uint8_t g_u8Idle = 0, g_u8Protocol = 0;
 
+/* OUT report ring. Filled by EP3 handler and drained by HID_Process() */
+static uint8_t g_au8RxRing[HID_RX_RING_LEN][EP3_MAX_PKT_SIZE];
+static volatile uint32_t g_u32RxHead = 0;
+static volatile uint32_t g_u32RxTail = 0;
+static volatile uint8_t  g_u8RxHold = 0;      /* EP3 is not triggered because ring is full */
+
 void USBD_IRQHandler(void)
 {
     uint32_t u32IntSts = USBD_GET_INT_FLAG();
@@ -161,10 +166,20 @@ void EP2_Handler(void)  /* Interrupt IN handler */
 void EP3_Handler(void)  /* Interrupt OUT handler */
 {
     uint8_t *ptr;
-    /* Interrupt OUT */
+    uint32_t u32Head;
+
+    /* Interrupt OUT. Queue the report and process it in main loop */
     ptr = (uint8_t *)(USBD_BUF_BASE + USBD_GET_EP_BUF_ADDR(EP3));
-    HID_GetOutReport(ptr, USBD_GET_PAYLOAD_LEN(EP3));
-    USBD_SET_PAYLOAD_LEN(EP3, EP3_MAX_PKT_SIZE);
+    u32Head = g_u32RxHead;
+    USBD_MemCopy(g_au8RxRing[u32Head], ptr, EP3_MAX_PKT_SIZE);
+    u32Head = (u32Head + 1) & (HID_RX_RING_LEN - 1);
+    g_u32RxHead = u32Head;
+
+    /* Hold OUT endpoint in NAK state when ring is full. HID_Process() will release it */
+    if(((u32Head + 1) & (HID_RX_RING_LEN - 1)) == g_u32RxTail)
+        g_u8RxHold = 1;
+    else
+        USBD_SET_PAYLOAD_LEN(EP3, EP3_MAX_PKT_SIZE);
 }
 
 
@@ -318,10 +333,17 @@ typedef struct
 
 CMD_T gCmd;
 
-static uint8_t  g_u8PageBuff[PAGE_SIZE] = {0};    /* Page buffer to upload/download through HID report */
+static uint8_t  g_u8PageBuff[PAGE_SIZE] = {0};    /* Page buffer to download through HID report */
 static uint32_t g_u32BytesInPageBuf = 0;          /* The bytes of data in g_u8PageBuff */
 static uint8_t  g_u8TestPages[TEST_PAGES * PAGE_SIZE] = {0};    /* Test pages to upload/download through HID report */
 
+/* IN page queue. Pages are read in main loop and sent by EP2 handler without gaps */
+static uint8_t  g_au8InPage[HID_IN_PAGES][PAGE_SIZE];
+static volatile uint32_t g_au32InBytes[HID_IN_PAGES];   /* Bytes left to send in each page. 0 means empty */
+static volatile uint32_t g_u32InRd = 0;                 /* Page being sent */
+static uint32_t g_u32InWr = 0;                          /* Next page to fill */
+static volatile uint8_t  g_u8InIdle = 1;                /* EP2 is not triggered */
+
 int32_t HID_CmdEraseSectors(CMD_T *pCmd)
 {
     uint32_t u32StartSector;
@@ -354,18 +376,20 @@ int32_t HID_CmdReadPages(CMD_T *pCmd)
 
     if(u32Pages)
     {
-        /* Update data to page buffer to upload */
-        /* TODO: We need to update the page data if got a page read command. (0xFF is used in this sample code) */
-        memcpy(g_u8PageBuff, g_u8TestPages, sizeof(g_u8PageBuff));
-        g_u32BytesInPageBuf = PAGE_SIZE;
+        /* Reset IN page queue */
+        memset((void *)g_au32InBytes, 0, sizeof(g_au32InBytes));
+        g_u32InRd = 0;
+        g_u32InWr = 0;
 
         /* The signature word is used as page counter */
-        pCmd->u32Signature = 1;
+        pCmd->u32Signature = 0;
 
-        /* Trigger HID IN */
-        USBD_MemCopy((uint8_t *)(USBD_BUF_BASE + USBD_GET_EP_BUF_ADDR(EP2)), (void *)g_u8PageBuff, EP2_MAX_PKT_SIZE);
-        USBD_SET_PAYLOAD_LEN(EP2, EP2_MAX_PKT_SIZE);
-        g_u32BytesInPageBuf -= EP2_MAX_PKT_SIZE;
+        /* Read pages to queue and trigger HID IN */
+        HID_FillInPages();
+    }
+    else
+    {
+        pCmd->u8Cmd = HID_CMD_NONE;
     }
 
     return 0;
@@ -542,55 +566,110 @@ void HID_GetOutReport(uint8_t *pu8EpBuf, uint32_t u32Size)
     }
 }
 
+/**
+  * @brief  Prepare next HID IN report from IN page queue.
+  * @param  None.
+  * @retval None.
+  * @details Called by EP2 handler on IN ACK, and by HID_FillInPages() to restart an idle endpoint.
+  */
 void HID_SetInReport(void)
 {
-    uint32_t u32StartPage;
-    uint32_t u32TotalPages;
-    uint32_t u32PageCnt;
     uint8_t *ptr;
-    uint8_t u8Cmd;
-
-    u8Cmd        = gCmd.u8Cmd;
-    u32StartPage = gCmd.u32Arg1;
-    u32TotalPages = gCmd.u32Arg2;
-    u32PageCnt   = gCmd.u32Signature;
+    uint32_t u32Rd, u32Bytes;
 
     /* Check if it is in data phase of read command */
-    if(u8Cmd == HID_CMD_READ)
+    if(gCmd.u8Cmd != HID_CMD_READ)
     {
-        /* Process the data phase of read command */
-        if((u32PageCnt >= u32TotalPages) && (g_u32BytesInPageBuf == 0))
-        {
-            /* The data transfer is complete. */
-            u8Cmd = HID_CMD_NONE;
-            printf("Read command complete!\n");
-        }
-        else
-        {
-            if(g_u32BytesInPageBuf == 0)
-            {
-                /* The previous page has sent out. Read new page to page buffer */
-                /* TODO: We should update new page data here. (0xFF is used in this sample code) */
-                printf("Reading page %d\n", u32StartPage + u32PageCnt);
-                memcpy(g_u8PageBuff, g_u8TestPages + u32PageCnt * PAGE_SIZE, sizeof(g_u8PageBuff));
+        g_u8InIdle = 1;
+        return;
+    }
 
-                g_u32BytesInPageBuf = PAGE_SIZE;
+    u32Rd = g_u32InRd;
+    u32Bytes = g_au32InBytes[u32Rd];
+    if(u32Bytes == 0)
+    {
+        /* Queue is empty */
+        g_u8InIdle = 1;
 
-                /* Update the page counter */
-                u32PageCnt++;
-            }
+        /* The data transfer is complete when all pages are queued and sent */
+        if(gCmd.u32Signature >= gCmd.u32Arg2)
+            gCmd.u8Cmd = HID_CMD_NONE;
+        return;
+    }
 
-            /* Prepare the data for next HID IN transfer */
-            ptr = (uint8_t *)(USBD_BUF_BASE + USBD_GET_EP_BUF_ADDR(EP2));
-            USBD_MemCopy(ptr, (void *)&g_u8PageBuff[PAGE_SIZE - g_u32BytesInPageBuf], EP2_MAX_PKT_SIZE);
-            USBD_SET_PAYLOAD_LEN(EP2, EP2_MAX_PKT_SIZE);
-            g_u32BytesInPageBuf -= EP2_MAX_PKT_SIZE;
-        }
+    /* Prepare the data for next HID IN transfer */
+    ptr = (uint8_t *)(USBD_BUF_BASE + USBD_GET_EP_BUF_ADDR(EP2));
+    USBD_MemCopy(ptr, &g_au8InPage[u32Rd][PAGE_SIZE - u32Bytes], EP2_MAX_PKT_SIZE);
+    USBD_SET_PAYLOAD_LEN(EP2, EP2_MAX_PKT_SIZE);
+    g_u8InIdle = 0;
+
+    u32Bytes -= EP2_MAX_PKT_SIZE;
+    g_au32InBytes[u32Rd] = u32Bytes;
+    if(u32Bytes == 0)
+        g_u32InRd = (u32Rd + 1) % HID_IN_PAGES;
+}
+
+/**
+  * @brief  Read pages of current read command into free IN page buffers.
+  * @param  None.
+  * @retval None.
+  */
+void HID_FillInPages(void)
+{
+    uint32_t u32PageCnt;
+
+    if(gCmd.u8Cmd != HID_CMD_READ)
+        return;
+
+    u32PageCnt = gCmd.u32Signature;
+    while((u32PageCnt < gCmd.u32Arg2) && (g_au32InBytes[g_u32InWr] == 0))
+    {
+        /* TODO: We should update new page data here. (0xFF is used in this sample code) */
+        printf("Reading page %d\n", gCmd.u32Arg1 + u32PageCnt);
+        memcpy(g_au8InPage[g_u32InWr], g_u8TestPages + (u32PageCnt % TEST_PAGES) * PAGE_SIZE, PAGE_SIZE);
+
+        g_au32InBytes[g_u32InWr] = PAGE_SIZE;
+        g_u32InWr = (g_u32InWr + 1) % HID_IN_PAGES;
+
+        /* Update the page counter */
+        u32PageCnt++;
+        gCmd.u32Signature = u32PageCnt;
     }
 
-    gCmd.u8Cmd        = u8Cmd;
-    gCmd.u32Signature = u32PageCnt;
+    /* Restart HID IN if endpoint has drained the queue */
+    __set_PRIMASK(1);
+    if(g_u8InIdle)
+        HID_SetInReport();
+    __set_PRIMASK(0);
 }
 
+/**
+  * @brief  Process queued HID OUT reports and keep IN pages filled.
+  * @param  None.
+  * @retval None.
+  * @details This function should be called in main loop.
+  */
+void HID_Process(void)
+{
+    static uint8_t u8PreCmd = HID_CMD_NONE;
+
+    while(g_u32RxTail != g_u32RxHead)
+    {
+        HID_GetOutReport(g_au8RxRing[g_u32RxTail], EP3_MAX_PKT_SIZE);
+        g_u32RxTail = (g_u32RxTail + 1) & (HID_RX_RING_LEN - 1);
 
+        /* A slot is free now. Release OUT endpoint if it is held */
+        if(g_u8RxHold)
+        {
+            g_u8RxHold = 0;
+            USBD_SET_PAYLOAD_LEN(EP3, EP3_MAX_PKT_SIZE);
+        }
+    }
+
+    HID_FillInPages();
+
+    if((u8PreCmd == HID_CMD_READ) && (gCmd.u8Cmd == HID_CMD_NONE))
+        printf("Read command complete!\n");
+    u8PreCmd = gCmd.u8Cmd;
+}
 
@@ -61,6 +61,10 @@
 
 #define LEN_CONFIG_AND_SUBORDINATE      (LEN_CONFIG+LEN_INTERFACE+LEN_HID+LEN_ENDPOINT)
 
+/* Define streaming queue depth */
+#define HID_RX_RING_LEN     32      /* OUT reports queued before EP3 is NAKed. Must be power of 2 */
+#define HID_IN_PAGES        2       /* Pages queued for HID IN */
+
 
 /*-------------------------------------------------------------*/
 
@@ -72,6 +76,8 @@ void EP2_Handler(void);
 void EP3_Handler(void);
 void HID_SetInReport(void);
 void HID_GetOutReport(uint8_t *pu8EpBuf, uint32_t u32Size);
+void HID_FillInPages(void);
+void HID_Process(void);
 
 extern uint8_t volatile g_u8Suspend;
 
@@ -135,6 +135,9 @@ int32_t main(void)
 
     while(SYS->PDID)
     {
+        /* Process queued HID commands and keep HID IN streaming */
+        HID_Process();
+
         /* Enter power down when USB suspend */
         if(g_u8Suspend)
             PowerDown();
@@ -1,4 +1,8 @@
 /* http://srecord.sourceforge.net/ */
+#include "M451Series.h"
+#include "massstorage.h"
+
+#if (CDROM_MEDIA == CDROM_MEDIA_FLASH)
 const unsigned char eprom[] =
 {
 0x01, 0x43, 0x44, 0x30,
@@ -1036,3 +1040,5 @@ const unsigned long eprom_length      = 0x0000B000;
 #define EPROM_START       0x00000000
 #define EPROM_FINISH      0x0000B000
 #define EPROM_LENGTH      0x0000B000
+
+#endif
@@ -43,6 +43,15 @@ struct CSW g_sCSW;
 uint32_t MassBlock[MASS_BUFFER_SIZE / 4];
 uint32_t Storage_Block[STORAGE_BUFFER_SIZE / 4];
 
+#if (CDROM_MEDIA == CDROM_MEDIA_SPI_FLASH)
+/* SPI flash read-ahead buffers. One is being sent while the other is prefetched */
+static uint32_t g_au32ReadAhead[2][CDROM_READAHEAD_SIZE / 4];
+static uint32_t g_au32RaOffset[2] = {0xFFFFFFFF, 0xFFFFFFFF};  /* Image offset of each buffer */
+static uint32_t g_au32RaStart[2];                               /* First byte read into each buffer */
+static uint32_t g_au32RaFilled[2];                              /* End of the bytes read into each buffer */
+static uint32_t g_u32RaCur = 0;                                 /* Buffer currently being sent */
+#endif
+
 /*--------------------------------------------------------------------------*/
 uint8_t g_au8InquiryID[36] =
 {
@@ -746,6 +755,11 @@ void MSC_Read(void)
             u32Len = g_u32Length;
             if(u32Len > STORAGE_BUFFER_SIZE)
                 u32Len = STORAGE_BUFFER_SIZE;
+#if (CDROM_MEDIA == CDROM_MEDIA_SPI_FLASH)
+            /* Called in USBD IRQ. Read one packet at a time from SPI flash. */
+            if(u32Len > EP2_MAX_PKT_SIZE)
+                u32Len = EP2_MAX_PKT_SIZE;
+#endif
 
             MSC_ReadMedia(g_u32LbaAddress, u32Len, (uint8_t *)STORAGE_DATA_BUF);
             g_u32BytesInStorageBuf = u32Len;
@@ -797,51 +811,201 @@ void MSC_ReadConfiguration(void)
     }
 }
 
-void MSC_ReadTrig(void)
+/* Read ISO data from media. u32Offset is the offset after System Area. */
+static void MSC_ReadImage(uint32_t u32Offset, uint32_t u32Size, uint8_t *pu8Buf)
 {
-    uint32_t u32Len;
+#if (CDROM_MEDIA == CDROM_MEDIA_SPI_FLASH)
+    uint32_t i, u32Tx;
 
-    if(g_u32Length)
+    u32Offset += CDROM_SPI_IMG_ADDR;
+
+    SPI_SET_SS_LOW(SPI0);
+
+    /* Fast read command, 24-bit address and one dummy byte */
+    SPI_WRITE_TX(SPI0, 0x0B);
+    SPI_WRITE_TX(SPI0, (u32Offset >> 16) & 0xFF);
+    SPI_WRITE_TX(SPI0, (u32Offset >> 8) & 0xFF);
+    SPI_WRITE_TX(SPI0, u32Offset & 0xFF);
+    while(SPI_GET_TX_FIFO_FULL_FLAG(SPI0));
+    SPI_WRITE_TX(SPI0, 0x00);
+    while(SPI_IS_BUSY(SPI0));
+    SPI_ClearRxFIFO(SPI0);
+
+    /* Keep TX FIFO filled so that the clock runs without gaps */
+    for(i = 0, u32Tx = 0; i < u32Size;)
     {
-        if(g_u32BytesInStorageBuf)
+        if((u32Tx < u32Size) && !SPI_GET_TX_FIFO_FULL_FLAG(SPI0))
         {
-            /* Prepare next data packet */
-            g_u8Size = EP2_MAX_PKT_SIZE;
-            if(g_u8Size > g_u32Length)
-                g_u8Size = g_u32Length;
-
-            if(USBD_GET_EP_BUF_ADDR(EP2) == g_u32BulkBuf1)
-                USBD_MemCopy((uint8_t *)((uint32_t)USBD_BUF_BASE + g_u32BulkBuf0), (uint8_t *)g_u32Address, g_u8Size);
-            else
-                USBD_MemCopy((uint8_t *)((uint32_t)USBD_BUF_BASE + g_u32BulkBuf1), (uint8_t *)g_u32Address, g_u8Size);
-            g_u32Address += g_u8Size;
+            SPI_WRITE_TX(SPI0, 0x00);
+            u32Tx++;
         }
-        else
-        {
-            u32Len = g_u32Length;
-            if(g_u32LbaAddress <= (16 * CDROM_BLOCK_SIZE))   /* Logical Block Address > 32KB */
-            {
-                if(u32Len > STORAGE_BUFFER_SIZE)
-                    u32Len = STORAGE_BUFFER_SIZE;
-                g_u32Address = STORAGE_DATA_BUF;
-            }
+        if(!SPI_GET_RX_FIFO_EMPTY_FLAG(SPI0))
+            pu8Buf[i++] = SPI_READ_RX(SPI0);
+    }
 
-            MSC_ReadMedia(g_u32LbaAddress, u32Len, (uint8_t *)STORAGE_DATA_BUF);
-            g_u32BytesInStorageBuf = u32Len;
-            g_u32LbaAddress += u32Len;
+    SPI_SET_SS_HIGH(SPI0);
+#elif (CDROM_MEDIA == CDROM_MEDIA_EBI_NOR)
+    memcpy(pu8Buf, (uint8_t *)(CDROM_EBI_IMG_BASE + u32Offset), u32Size);
+#else
+    memcpy(pu8Buf, &eprom[u32Offset], u32Size);
+#endif
+}
 
-            /* Prepare next data packet */
-            g_u8Size = EP2_MAX_PKT_SIZE;
-            if(g_u8Size > g_u32Length)
-                g_u8Size = g_u32Length;
+/* Copy a packet into USB buffer. Memory-mapped media are word aligned and can be copied by word. */
+static __INLINE void MSC_CopyPacket(uint8_t *pu8Dst, uint8_t *pu8Src, uint32_t u32Size)
+{
+    uint32_t *pu32Dst, *pu32Src;
 
-            if(USBD_GET_EP_BUF_ADDR(EP2) == g_u32BulkBuf1)
-                USBD_MemCopy((uint8_t *)((uint32_t)USBD_BUF_BASE + g_u32BulkBuf0), (uint8_t *)g_u32Address, g_u8Size);
-            else
-                USBD_MemCopy((uint8_t *)((uint32_t)USBD_BUF_BASE + g_u32BulkBuf1), (uint8_t *)g_u32Address, g_u8Size);
-            g_u32Address += g_u8Size;
+    if((((uint32_t)pu8Dst | (uint32_t)pu8Src | u32Size) & 0x3) == 0)
+    {
+        pu32Dst = (uint32_t *)pu8Dst;
+        pu32Src = (uint32_t *)pu8Src;
+        for(u32Size >>= 2; u32Size > 0; u32Size--)
+            *pu32Dst++ = *pu32Src++;
+    }
+    else
+        USBD_MemCopy(pu8Dst, pu8Src, u32Size);
+}
+
+#if (CDROM_MEDIA == CDROM_MEDIA_SPI_FLASH)
+/* Read up to one packet more into a read-ahead buffer. Returns 0 if the buffer is full. */
+static uint32_t MSC_ReadAheadFill(uint32_t i)
+{
+    uint32_t u32Len;
+
+    if(g_au32RaOffset[i] >= MSC_ImageSize)
+        return 0;
+
+    u32Len = CDROM_READAHEAD_SIZE - g_au32RaFilled[i];
+    if(u32Len > MSC_ImageSize - (g_au32RaOffset[i] + g_au32RaFilled[i]))
+        u32Len = MSC_ImageSize - (g_au32RaOffset[i] + g_au32RaFilled[i]);
+    if(u32Len > EP2_MAX_PKT_SIZE)
+        u32Len = EP2_MAX_PKT_SIZE;
+
+    if(u32Len)
+    {
+        MSC_ReadImage(g_au32RaOffset[i] + g_au32RaFilled[i], u32Len,
+                      (uint8_t *)g_au32ReadAhead[i] + g_au32RaFilled[i]);
+        g_au32RaFilled[i] += u32Len;
+    }
+
+    return u32Len;
+}
+
+/* Map SPI flash data. It is called in USBD IRQ, so at most one packet is read from SPI flash here. */
+static uint8_t *MSC_ReadAhead(uint32_t u32Offset, uint32_t *pu32Len)
+{
+    uint32_t i, u32Base, u32Pos, u32End;
+
+    u32Base = u32Offset & ~(CDROM_READAHEAD_SIZE - 1);
+    u32Pos = u32Offset - u32Base;
+
+    /* Sequential reads normally hit the prefetched buffer */
+    for(i = 0; i < 2; i++)
+    {
+        if((g_au32RaOffset[i] == u32Base) && (u32Pos >= g_au32RaStart[i]) && (u32Pos <= g_au32RaFilled[i]))
+            break;
+    }
+    if(i == 2)
+    {
+        /* Random read. Fill the buffer from the requested offset. */
+        i = (g_au32RaOffset[g_u32RaCur] == u32Base) ? g_u32RaCur : (g_u32RaCur ^ 1);
+        g_au32RaOffset[i] = u32Base;
+        g_au32RaStart[i] = u32Pos;
+        g_au32RaFilled[i] = u32Pos;
+    }
+    g_u32RaCur = i;
+
+    /* Bytes up to the end of this buffer */
+    u32End = CDROM_READAHEAD_SIZE;
+    if(u32End > MSC_ImageSize - u32Base)
+        u32End = MSC_ImageSize - u32Base;
+    if(*pu32Len > u32End - u32Pos)
+        *pu32Len = u32End - u32Pos;
+
+    /* Make sure the next packet is there. MSC_Prefetch() reads the rest. */
+    if(g_au32RaFilled[i] == u32Pos)
+        MSC_ReadAheadFill(i);
+    if(*pu32Len > g_au32RaFilled[i] - u32Pos)
+        *pu32Len = g_au32RaFilled[i] - u32Pos;
+
+    /* Start prefetching the next buffer */
+    u32Base += CDROM_READAHEAD_SIZE;
+    if((g_au32RaOffset[i ^ 1] != u32Base) && (u32Base < MSC_ImageSize))
+    {
+        g_au32RaOffset[i ^ 1] = u32Base;
+        g_au32RaStart[i ^ 1] = 0;
+        g_au32RaFilled[i ^ 1] = 0;
+    }
+
+    return (uint8_t *)g_au32ReadAhead[i] + u32Pos;
+}
+
+/* Read one packet while the current packet is being sent. The current buffer is completed first. */
+static void MSC_Prefetch(void)
+{
+    if(MSC_ReadAheadFill(g_u32RaCur) == 0)
+        MSC_ReadAheadFill(g_u32RaCur ^ 1);
+}
+#endif
+
+/**
+  * @brief  Map ISO data to be sent.
+  * @param[in]  u32Offset   Byte offset in ISO file.
+  * @param[in,out] pu32Len  Bytes requested. Return bytes available at the returned address.
+  * @return Address of ISO data.
+  * @details Memory-mapped media (internal flash and EBI NOR) return the data address directly
+  *          so that it is copied into USB buffer without an intermediate buffer.
+  */
+uint8_t *MSC_MapImage(uint32_t u32Offset, uint32_t *pu32Len)
+{
+    if((u32Offset < CDROM_SYS_AREA_SIZE) || ((u32Offset - CDROM_SYS_AREA_SIZE) >= MSC_ImageSize))
+    {
+        /* First 32KB of ISO file are all 0 */
+        if(*pu32Len > STORAGE_BUFFER_SIZE)
+            *pu32Len = STORAGE_BUFFER_SIZE;
+        memset((uint32_t *)Storage_Block, 0, *pu32Len);
+        return (uint8_t *)STORAGE_DATA_BUF;
+    }
+
+    u32Offset -= CDROM_SYS_AREA_SIZE;
+
+#if (CDROM_MEDIA == CDROM_MEDIA_SPI_FLASH)
+    return MSC_ReadAhead(u32Offset, pu32Len);
+#else
+    if(*pu32Len > MSC_ImageSize - u32Offset)
+        *pu32Len = MSC_ImageSize - u32Offset;
+#if (CDROM_MEDIA == CDROM_MEDIA_EBI_NOR)
+    return (uint8_t *)(CDROM_EBI_IMG_BASE + u32Offset);
+#else
+    return (uint8_t *)&eprom[u32Offset];
+#endif
+#endif
+}
+
+void MSC_ReadTrig(void)
+{
+    if(g_u32Length)
+    {
+        if(g_u32BytesInStorageBuf == 0)
+        {
+            /* Map next chunk of ISO data */
+            g_u32BytesInStorageBuf = g_u32Length;
+            g_u32Address = (uint32_t)MSC_MapImage(g_u32LbaAddress, &g_u32BytesInStorageBuf);
+            g_u32LbaAddress += g_u32BytesInStorageBuf;
         }
 
+        /* Prepare next data packet */
+        g_u8Size = EP2_MAX_PKT_SIZE;
+        if(g_u8Size > g_u32Length)
+            g_u8Size = g_u32Length;
+
+        if(USBD_GET_EP_BUF_ADDR(EP2) == g_u32BulkBuf1)
+            MSC_CopyPacket((uint8_t *)((uint32_t)USBD_BUF_BASE + g_u32BulkBuf0), (uint8_t *)g_u32Address, g_u8Size);
+        else
+            MSC_CopyPacket((uint8_t *)((uint32_t)USBD_BUF_BASE + g_u32BulkBuf1), (uint8_t *)g_u32Address, g_u8Size);
+        g_u32Address += g_u8Size;
+
         /* DATA0/DATA1 Toggle */
         if(USBD_GET_EP_BUF_ADDR(EP2) == g_u32BulkBuf1)
             USBD_SET_EP_BUF_ADDR(EP2, g_u32BulkBuf0);
@@ -853,6 +1017,12 @@ void MSC_ReadTrig(void)
 
         g_u32Length -= g_u8Size;
         g_u32BytesInStorageBuf -= g_u8Size;
+
+#if (CDROM_MEDIA == CDROM_MEDIA_SPI_FLASH)
+        /* Use the packet time to read ahead */
+        if(g_u32Length)
+            MSC_Prefetch();
+#endif
     }
     else
         USBD_SET_PAYLOAD_LEN(EP2, 0);
@@ -1196,8 +1366,6 @@ void MSC_ProcessCmd(void)
                 case UFI_READ_12:
                 case UFI_READ_10:
                 {
-                    extern const unsigned long eprom_length;
-
                     /* Check if it is a new transfer */
                     if(g_u32Length == 0)
                     {
@@ -1249,28 +1417,11 @@ void MSC_ProcessCmd(void)
                     g_u32Address = get_be32(&g_sCBW.au8Data[0]);
                     g_u32LbaAddress = g_u32Address * CDROM_BLOCK_SIZE;
                     g_u32Length = g_sCBW.dCBWDataTransferLength;
-                    g_u32BytesInStorageBuf = g_u32Length;
-
-                    i = g_u32Length;
-                    if(i > STORAGE_BUFFER_SIZE)
-                        i = STORAGE_BUFFER_SIZE;
 
-                    if((g_u32LbaAddress >= (16 * CDROM_BLOCK_SIZE)) && ((g_u32LbaAddress - 32768) < eprom_length))
-                    {
-                        /*
-                            Because first 32KB of the ISO file are all '0', remove first 32KB data from ISO file
-                            to reduce the code size instead of including ISO file directly.
-                            The array - eprom is the data of ISO file with offset 32768
-                         */
-                        g_u32Address = (uint32_t)(&eprom[g_u32LbaAddress - 32768]);
-                        g_u32LbaAddress += i;
-                    }
-                    else                                             /* Logical Block Address > 32KB */
-                    {
-                        memset((uint32_t*)Storage_Block, 0, i);      /* First 32KB of ISO file are all 0 */
-                        g_u32Address = STORAGE_DATA_BUF;
-                    }
-                    g_u32BytesInStorageBuf = i;
+                    /* Map the first chunk of ISO data */
+                    g_u32BytesInStorageBuf = g_u32Length;
+                    g_u32Address = (uint32_t)MSC_MapImage(g_u32LbaAddress, &g_u32BytesInStorageBuf);
+                    g_u32LbaAddress += g_u32BytesInStorageBuf;
 
                     /* Indicate the next packet should be Bulk IN Data packet */
                     g_u8BulkState = BULK_IN;
@@ -1284,7 +1435,7 @@ void MSC_ProcessCmd(void)
 
                         /* Prepare the first data packet (DATA1) */
                         /* Bulk IN buffer */
-                        USBD_MemCopy((uint8_t *)((uint32_t)USBD_BUF_BASE + g_u32BulkBuf1), (uint8_t *)g_u32Address, g_u8Size);
+                        MSC_CopyPacket((uint8_t *)((uint32_t)USBD_BUF_BASE + g_u32BulkBuf1), (uint8_t *)g_u32Address, g_u8Size);
                         g_u32Address += g_u8Size;
 
                         /* kick - start */
@@ -1293,6 +1444,10 @@ void MSC_ProcessCmd(void)
                         USBD_SET_PAYLOAD_LEN(EP2, g_u8Size);
                         g_u32Length -= g_u8Size;
                         g_u32BytesInStorageBuf -= g_u8Size;
+#if (CDROM_MEDIA == CDROM_MEDIA_SPI_FLASH)
+                        if(g_u32Length)
+                            MSC_Prefetch();
+#endif
                     }
                     return;
                 }
@@ -1561,6 +1716,28 @@ void MSC_AckCmd(void)
 
 void MSC_ReadMedia(uint32_t addr, uint32_t size, uint8_t *buffer)
 {
+    uint32_t u32Len;
+
+    while(size)
+    {
+        u32Len = size;
+        if((addr < CDROM_SYS_AREA_SIZE) || ((addr - CDROM_SYS_AREA_SIZE) >= MSC_ImageSize))
+        {
+            /* System Area and data out of image are all 0 */
+            if((addr < CDROM_SYS_AREA_SIZE) && (u32Len > CDROM_SYS_AREA_SIZE - addr))
+                u32Len = CDROM_SYS_AREA_SIZE - addr;
+            memset(buffer, 0, u32Len);
+        }
+        else
+        {
+            if(u32Len > MSC_ImageSize - (addr - CDROM_SYS_AREA_SIZE))
+                u32Len = MSC_ImageSize - (addr - CDROM_SYS_AREA_SIZE);
+            MSC_ReadImage(addr - CDROM_SYS_AREA_SIZE, u32Len, buffer);
+        }
+        addr += u32Len;
+        buffer += u32Len;
+        size -= u32Len;
+    }
 }
 
 void MSC_WriteMedia(uint32_t addr, uint32_t size, uint8_t *buffer)
@@ -23,6 +23,10 @@
  *               -> EPROM_LENGTH in DiskImg.c is the size of your .iso image. 
  *                  Define MSC_ImageSize value in massstorage.h in this project.
  *                  Modify MSC_ImageSize value to hold the file size.
+ *
+ *           (4) The ISO data can also be placed in EBI NOR flash or SPI flash (from ISO offset 32768).
+ *               Select the media by CDROM_MEDIA in massstorage.h and set CDROM_EBI_IMG_SIZE or
+ *               CDROM_SPI_IMG_SIZE to the ISO size - 32768. DiskImg.c is then empty.
  * @copyright SPDX-License-Identifier: Apache-2.0
  * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
  ******************************************************************************/
@@ -32,6 +36,57 @@
 
 /*--------------------------------------------------------------------------*/
 
+#if (CDROM_MEDIA == CDROM_MEDIA_EBI_NOR)
+void Configure_EBI_16BIT_Pins(void)
+{
+    /* EBI AD0~7 pins on PA.0~7 */
+    SYS->GPA_MFPL &= ~(SYS_GPA_MFPL_PA0MFP_Msk | SYS_GPA_MFPL_PA1MFP_Msk |
+                       SYS_GPA_MFPL_PA2MFP_Msk | SYS_GPA_MFPL_PA3MFP_Msk |
+                       SYS_GPA_MFPL_PA4MFP_Msk | SYS_GPA_MFPL_PA5MFP_Msk |
+                       SYS_GPA_MFPL_PA6MFP_Msk | SYS_GPA_MFPL_PA7MFP_Msk);
+    SYS->GPA_MFPL |= SYS_GPA_MFPL_PA0MFP_EBI_AD0 | SYS_GPA_MFPL_PA1MFP_EBI_AD1 |
+                     SYS_GPA_MFPL_PA2MFP_EBI_AD2 | SYS_GPA_MFPL_PA3MFP_EBI_AD3 |
+                     SYS_GPA_MFPL_PA4MFP_EBI_AD4 | SYS_GPA_MFPL_PA5MFP_EBI_AD5 |
+                     SYS_GPA_MFPL_PA6MFP_EBI_AD6 | SYS_GPA_MFPL_PA7MFP_EBI_AD7;
+
+    /* EBI AD8~15 pins on PC.0~7 */
+    SYS->GPC_MFPL &= ~(SYS_GPC_MFPL_PC0MFP_Msk | SYS_GPC_MFPL_PC1MFP_Msk |
+                       SYS_GPC_MFPL_PC2MFP_Msk | SYS_GPC_MFPL_PC3MFP_Msk |
+                       SYS_GPC_MFPL_PC4MFP_Msk | SYS_GPC_MFPL_PC5MFP_Msk |
+                       SYS_GPC_MFPL_PC6MFP_Msk | SYS_GPC_MFPL_PC7MFP_Msk);
+    SYS->GPC_MFPL |= SYS_GPC_MFPL_PC0MFP_EBI_AD8 | SYS_GPC_MFPL_PC1MFP_EBI_AD9 |
+                     SYS_GPC_MFPL_PC2MFP_EBI_AD10 | SYS_GPC_MFPL_PC3MFP_EBI_AD11 |
+                     SYS_GPC_MFPL_PC4MFP_EBI_AD12 | SYS_GPC_MFPL_PC5MFP_EBI_AD13 |
+                     SYS_GPC_MFPL_PC6MFP_EBI_AD14 | SYS_GPC_MFPL_PC7MFP_EBI_AD15;
+
+    /* EBI AD16~19 pins on PD.12~15*/
+    SYS->GPD_MFPH &= ~(SYS_GPD_MFPH_PD12MFP_Msk | SYS_GPD_MFPH_PD13MFP_Msk |
+                       SYS_GPD_MFPH_PD14MFP_Msk | SYS_GPD_MFPH_PD15MFP_Msk);
+    SYS->GPD_MFPH |= SYS_GPD_MFPH_PD12MFP_EBI_ADR16 | SYS_GPD_MFPH_PD13MFP_EBI_ADR17 |
+                     SYS_GPD_MFPH_PD14MFP_EBI_ADR18 | SYS_GPD_MFPH_PD15MFP_EBI_ADR19;
+
+    /* EBI nWR and nRD pins on PD.2 and PD.7 */
+    SYS->GPD_MFPL &= ~(SYS_GPD_MFPL_PD2MFP_Msk | SYS_GPD_MFPL_PD7MFP_Msk);
+    SYS->GPD_MFPL |= SYS_GPD_MFPL_PD2MFP_EBI_nWR | SYS_GPD_MFPL_PD7MFP_EBI_nRD;
+
+    /* EBI nWRL and nWRH pins on PB.0 and PB.1 */
+    SYS->GPB_MFPL &= ~(SYS_GPB_MFPL_PB0MFP_Msk | SYS_GPB_MFPL_PB1MFP_Msk);
+    SYS->GPB_MFPL |= SYS_GPB_MFPL_PB0MFP_EBI_nWRL | SYS_GPB_MFPL_PB1MFP_EBI_nWRH;
+
+    /* EBI nCS1 pin on PB.15 */
+    SYS->GPB_MFPH &= ~(SYS_GPB_MFPH_PB15MFP_Msk);
+    SYS->GPB_MFPH |= SYS_GPB_MFPH_PB15MFP_EBI_nCS1;
+
+    /* EBI ALE pin on PD.9 */
+    SYS->GPD_MFPH &= ~(SYS_GPD_MFPH_PD9MFP_Msk);
+    SYS->GPD_MFPH |= SYS_GPD_MFPH_PD9MFP_EBI_ALE;
+
+    /* EBI MCLK pin on PD.3 */
+    SYS->GPD_MFPL &= ~(SYS_GPD_MFPL_PD3MFP_Msk);
+    SYS->GPD_MFPL |= SYS_GPD_MFPL_PD3MFP_EBI_MCLK;
+}
+#endif
+
 void SYS_Init(void)
 {
     /*---------------------------------------------------------------------------------------------------------*/
@@ -63,6 +118,12 @@ void SYS_Init(void)
     /* Select module clock source */
     CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL1_UARTSEL_HXT, CLK_CLKDIV0_UART(1));
     CLK_SetModuleClock(USBD_MODULE, 0, CLK_CLKDIV0_USB(3));
+#if (CDROM_MEDIA == CDROM_MEDIA_SPI_FLASH)
+    CLK_SetModuleClock(SPI0_MODULE, CLK_CLKSEL2_SPI0SEL_PCLK0, MODULE_NoMsk);
+    CLK_EnableModuleClock(SPI0_MODULE);
+#elif (CDROM_MEDIA == CDROM_MEDIA_EBI_NOR)
+    CLK_EnableModuleClock(EBI_MODULE);
+#endif
 
     /* Enable USB LDO33 */
     SYS->USBPHY = SYS_USBPHY_LDO33EN_Msk;
@@ -77,6 +138,14 @@ void SYS_Init(void)
 
     /* Enable CLKO (PD.6) for monitor HCLK. CLKO = HCLK/8 Hz */
     CLK_EnableCKO(CLK_CLKSEL1_CLKOSEL_HCLK, 2, 0);
+
+#if (CDROM_MEDIA == CDROM_MEDIA_SPI_FLASH)
+    /* Set PB multi-function pins for SPI0 CLK, MISO0, SS and MOSI0 */
+    SYS->GPB_MFPL &= ~(SYS_GPB_MFPL_PB2MFP_Msk | SYS_GPB_MFPL_PB3MFP_Msk | SYS_GPB_MFPL_PB4MFP_Msk | SYS_GPB_MFPL_PB5MFP_Msk);
+    SYS->GPB_MFPL |= (SYS_GPB_MFPL_PB2MFP_SPI0_CLK | SYS_GPB_MFPL_PB3MFP_SPI0_MISO0 | SYS_GPB_MFPL_PB4MFP_SPI0_SS | SYS_GPB_MFPL_PB5MFP_SPI0_MOSI0);
+#elif (CDROM_MEDIA == CDROM_MEDIA_EBI_NOR)
+    Configure_EBI_16BIT_Pins();
+#endif
 }
 
 void PowerDown()
@@ -116,6 +185,16 @@ int32_t main(void)
 
     printf("NuMicro USB MassStorage Start!\n");
 
+#if (CDROM_MEDIA == CDROM_MEDIA_SPI_FLASH)
+    /* ISO image in SPI flash. SS is controlled by software for burst read */
+    SPI_Open(SPI0, SPI_MASTER, SPI_MODE_0, 8, CDROM_SPI_CLK);
+    SPI_DisableAutoSS(SPI0);
+    SPI_SET_SS_HIGH(SPI0);
+#elif (CDROM_MEDIA == CDROM_MEDIA_EBI_NOR)
+    /* ISO image in NOR flash on EBI bank 1 */
+    EBI_Open(EBI_BANK1, EBI_BUSWIDTH_16BIT, EBI_TIMING_NORMAL, 0, EBI_CS_ACTIVE_LOW);
+#endif
+
     USBD_Open(&gsInfo, MSC_ClassRequest, NULL);
 
     /* Endpoint configuration */
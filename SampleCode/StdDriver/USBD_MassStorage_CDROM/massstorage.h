@@ -125,10 +125,28 @@ struct CSW
 /*-------------------------------------------------------------*/
 
 
+/* ISO image media. The first 32KB of ISO (System Area) are all 0 and are not stored on any media */
+#define CDROM_MEDIA_FLASH       0                   /* eprom[] of DiskImg.c in internal flash */
+#define CDROM_MEDIA_EBI_NOR     1                   /* NOR flash on EBI bank 1 */
+#define CDROM_MEDIA_SPI_FLASH   2                   /* SPI flash on SPI0 */
+
+#define CDROM_MEDIA             CDROM_MEDIA_FLASH   /* Select the media that holds the ISO image */
+#define CDROM_EBI_IMG_BASE      EBI_BANK1_BASE_ADDR /* ISO data (offset 32768) location in EBI NOR */
+#define CDROM_EBI_IMG_SIZE      0x00100000          /* ISO size - 32768. At most the 1MB of an EBI bank */
+#define CDROM_SPI_IMG_ADDR      0x00000000          /* ISO data (offset 32768) location in SPI flash */
+#define CDROM_SPI_IMG_SIZE      0x00400000          /* ISO size - 32768. At most the SPI flash size */
+#define CDROM_SPI_CLK           18000000
+
 /* MSC Disk Image Definitions */
+#if (CDROM_MEDIA == CDROM_MEDIA_SPI_FLASH)
+#define MSC_ImageSize   CDROM_SPI_IMG_SIZE
+#elif (CDROM_MEDIA == CDROM_MEDIA_EBI_NOR)
+#define MSC_ImageSize   CDROM_EBI_IMG_SIZE
+#else
 #define MSC_ImageSize   0x0000B000
 
 extern const unsigned char eprom[MSC_ImageSize];   /* Disk Image */
+#endif
 
 #define MSC_MemorySize  MSC_ImageSize
 
@@ -136,6 +154,8 @@ extern const unsigned char eprom[MSC_ImageSize];   /* Disk Image */
 #define MASS_BUFFER_SIZE    256                 /* Mass Storage command buffer size */
 #define STORAGE_BUFFER_SIZE 2048                /* Data transfer buffer size in 2048 bytes alignment */
 #define CDROM_BLOCK_SIZE    2048                /* logic sector size */
+#define CDROM_SYS_AREA_SIZE     (16 * CDROM_BLOCK_SIZE)
+#define CDROM_READAHEAD_SIZE    4096                /* SPI read-ahead buffer size. Must be power of 2 */
 
 extern uint32_t MassBlock[];
 extern uint32_t Storage_Block[];
@@ -159,6 +179,7 @@ uint32_t MSC_ModeSense10(void);
 void MSC_ReadTrig(void);
 void MSC_ClassRequest(void);
 
+uint8_t *MSC_MapImage(uint32_t u32Offset, uint32_t *pu32Len);
 void MSC_ReadMedia(uint32_t addr, uint32_t size, uint8_t *buffer);
 void MSC_WriteMedia(uint32_t addr, uint32_t size, uint8_t *buffer);
 
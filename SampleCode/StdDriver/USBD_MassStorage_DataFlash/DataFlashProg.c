@@ -20,122 +20,409 @@
 /*---------------------------------------------------------------------------------------------------------*/
 /* Macro, type and constant definitions                                                                    */
 /*---------------------------------------------------------------------------------------------------------*/
+#define FTL_MAGIC           0x4C54464E      /* "NFTL" */
+#define FTL_SEQ_FREE        0xFFFFFFFF      /* Sequence number of an erased block */
+#define FTL_TAG_BLANK       0xFFFFFFFF      /* Slot not written */
+#define FTL_TAG_DEAD        0xFFFF0000      /* Slot interrupted while programming */
+#define FTL_UNMAPPED        0xFFFF
 
-uint32_t g_sectorBuf[FLASH_PAGE_SIZE / 4];
+/* Block header words */
+#define FTL_BLK_ADDR(b)     (FTL_BASE + (b) * FTL_BLOCK_SIZE)
+#define FTL_HDR_MAGIC(b)    (FTL_BLK_ADDR(b) + 0)
+#define FTL_HDR_ERASE(b)    (FTL_BLK_ADDR(b) + 4)
+#define FTL_HDR_SEQ(b)      (FTL_BLK_ADDR(b) + 8)
+#define FTL_HDR_TAG(b, s)   (FTL_BLK_ADDR(b) + 12 + (s) * 4)
+#define FTL_SLOT_ADDR(b, s) (FTL_BLK_ADDR(b) + (s) * FTL_SECTOR_SIZE)
 
-void DataFlashRead(uint32_t addr, uint32_t size, uint32_t buffer)
+uint32_t g_sectorBuf[FTL_SECTOR_SIZE / 4];
+
+static uint16_t g_au16L2P[FTL_SECTOR_NUM];      /* Logical sector to (block * FTL_SLOT_NUM + slot) */
+static uint32_t g_au32EraseCnt[FTL_BLOCK_NUM];  /* Wear counter of each block */
+static uint32_t g_au32Seq[FTL_BLOCK_NUM];       /* Sequence number of each block. Newer block has larger number */
+static uint8_t g_au8Valid[FTL_BLOCK_NUM];       /* Valid slots of each block */
+static uint32_t g_u32Seq;                       /* Last used sequence number */
+static uint32_t g_u32FreeBlks;                  /* Erased blocks ready to be opened */
+static int32_t g_i32OpenBlk = -1;               /* Block receiving new sectors */
+static uint32_t g_u32OpenSlot;                  /* Next free slot of open block */
+static int32_t g_i32GcBlk = -1;                 /* Block being reclaimed */
+static uint32_t g_u32GcStep;                    /* Reclaim progress: slots, then page erases, then header */
+
+
+static int32_t FTL_WriteHeader(uint32_t u32Blk, uint32_t u32EraseCnt)
 {
-    /* This is low level read function of USB Mass Storage */
-    int32_t len;
-    uint32_t i;
-    uint32_t * pu32Buf = (uint32_t *)buffer;
+    /* Magic is written last. A block without magic still carries its erase count if the power was lost
+       between the two writes. */
+    if(FMC_Write(FTL_HDR_ERASE(u32Blk), u32EraseCnt) || FMC_Write(FTL_HDR_MAGIC(u32Blk), FTL_MAGIC))
+        return -1;
 
-    /* Modify the address to MASS_STORAGE_OFFSET */
-    addr += MASS_STORAGE_OFFSET;
+    g_au32EraseCnt[u32Blk] = u32EraseCnt;
+    g_au32Seq[u32Blk] = FTL_SEQ_FREE;
+    g_au8Valid[u32Blk] = 0;
+    g_u32FreeBlks++;
+    return 0;
+}
 
-    len = (int32_t)size;
+static int32_t FTL_EraseBlock(uint32_t u32Blk, uint32_t u32EraseCnt)
+{
+    uint32_t i;
 
-    while(len >= BUFFER_PAGE_SIZE)
+    for(i = 0; i < FTL_BLOCK_SIZE; i += FLASH_PAGE_SIZE)
     {
-        //FMC_ReadPage(addr, (uint32_t *)buffer);
-        for(i = 0; i < BUFFER_PAGE_SIZE / 4; i++)
-            pu32Buf[i] = FMC_Read(addr + i * 4);
-        addr   += BUFFER_PAGE_SIZE;
-        buffer += BUFFER_PAGE_SIZE;
-        len  -= BUFFER_PAGE_SIZE;
-        pu32Buf = (uint32_t *)buffer;
+        if(FMC_Erase(FTL_BLK_ADDR(u32Blk) + i))
+            return -1;
     }
+    return FTL_WriteHeader(u32Blk, u32EraseCnt);
 }
 
-void DataFlashReadPage(uint32_t addr, uint32_t buffer)
+static int32_t FTL_OpenBlock(void)
 {
     uint32_t i;
-    uint32_t * pu32Buf = (uint32_t *)buffer;
+    int32_t i32Blk = -1;
 
-    /* Modify the address to MASS_STORAGE_OFFSET */
-    addr += MASS_STORAGE_OFFSET;
+    /* Use the least worn free block */
+    for(i = 0; i < FTL_BLOCK_NUM; i++)
+    {
+        if((g_au32Seq[i] == FTL_SEQ_FREE) && ((i32Blk < 0) || (g_au32EraseCnt[i] < g_au32EraseCnt[i32Blk])))
+            i32Blk = i;
+    }
+    if(i32Blk < 0)
+        return -1;
+
+    if(FMC_Write(FTL_HDR_SEQ(i32Blk), g_u32Seq + 1))
+        return -1;
 
-    for(i = 0; i < FLASH_PAGE_SIZE / 4; i++)
-        pu32Buf[i] = FMC_Read(addr + i * 4);
+    g_au32Seq[i32Blk] = ++g_u32Seq;
+    g_u32FreeBlks--;
+    g_i32OpenBlk = i32Blk;
+    g_u32OpenSlot = 1;
+    return 0;
 }
 
-uint32_t DataFlashProgramPage(uint32_t u32StartAddr, uint32_t * u32Buf)
+/* Append a sector to open block and update mapping */
+static int32_t FTL_Program(uint32_t u32Sector, uint32_t *pu32Buf)
 {
-    uint32_t i;
+    uint32_t u32Addr, u32Old;
+
+    if((g_i32OpenBlk < 0) || (g_u32OpenSlot >= FTL_SLOT_NUM))
+    {
+        if(FTL_OpenBlock())
+            return -1;
+    }
+
+    u32Addr = FTL_SLOT_ADDR(g_i32OpenBlk, g_u32OpenSlot);
+    if(FMC_WriteMultiple(u32Addr, pu32Buf, FTL_SECTOR_SIZE) || memcmp((void *)u32Addr, pu32Buf, FTL_SECTOR_SIZE))
+    {
+        FMC_Write(FTL_HDR_TAG(g_i32OpenBlk, g_u32OpenSlot), FTL_TAG_DEAD);
+        g_u32OpenSlot++;
+        return -1;
+    }
 
-    for(i = 0; i < FLASH_PAGE_SIZE / 4; i++)
+    /* Tag is written after data. A slot without tag is never used. */
+    if(FMC_Write(FTL_HDR_TAG(g_i32OpenBlk, g_u32OpenSlot), u32Sector))
     {
-        FMC_Write(u32StartAddr + i * 4, u32Buf[i]);
+        g_u32OpenSlot++;
+        return -1;
     }
 
+    u32Old = g_au16L2P[u32Sector];
+    if(u32Old != FTL_UNMAPPED)
+        g_au8Valid[u32Old / FTL_SLOT_NUM]--;
+
+    g_au16L2P[u32Sector] = g_i32OpenBlk * FTL_SLOT_NUM + g_u32OpenSlot;
+    g_au8Valid[g_i32OpenBlk]++;
+    g_u32OpenSlot++;
     return 0;
 }
 
+static int32_t FTL_PickVictim(uint32_t u32WearLevel)
+{
+    uint32_t i, u32Min, u32Max;
+    int32_t i32Blk = -1, i32Cold = -1;
+
+    u32Min = 0xFFFFFFFF;
+    u32Max = 0;
+    for(i = 0; i < FTL_BLOCK_NUM; i++)
+    {
+        if(g_au32EraseCnt[i] > u32Max)
+            u32Max = g_au32EraseCnt[i];
+
+        if((g_au32Seq[i] == FTL_SEQ_FREE) || ((int32_t)i == g_i32OpenBlk))
+            continue;
+
+        /* Block with least valid slots costs least to reclaim */
+        if((i32Blk < 0) || (g_au8Valid[i] < g_au8Valid[i32Blk]) ||
+                ((g_au8Valid[i] == g_au8Valid[i32Blk]) && (g_au32EraseCnt[i] < g_au32EraseCnt[i32Blk])))
+            i32Blk = i;
+
+        if(g_au32EraseCnt[i] < u32Min)
+        {
+            u32Min = g_au32EraseCnt[i];
+            i32Cold = i;
+        }
+    }
+
+    /* Static wear leveling. Move cold data out of a rarely erased block. */
+    if(u32WearLevel)
+        return ((i32Cold >= 0) && (u32Max - u32Min > FTL_WL_THRESHOLD)) ? i32Cold : -1;
+
+    if((i32Blk >= 0) && (g_au8Valid[i32Blk] >= FTL_SLOT_NUM - 1))
+        return -1;
+
+    return i32Blk;
+}
 
-void DataFlashWrite(uint32_t addr, uint32_t size, uint32_t buffer)
+/* Run one step of block reclaim. Return -1 if there is nothing to reclaim. */
+static int32_t FTL_GcStep(uint32_t u32WearLevel)
 {
-    /* This is low level write function of USB Mass Storage */
-    int32_t len, i, offset;
-    uint32_t *pu32;
-    uint32_t alignAddr;
+    uint32_t i, u32Tag;
 
-    /* Modify the address to MASS_STORAGE_OFFSET */
-    addr += MASS_STORAGE_OFFSET;
+    if(g_i32GcBlk < 0)
+    {
+        g_i32GcBlk = FTL_PickVictim(u32WearLevel);
+        if(g_i32GcBlk < 0)
+            return -1;
+        g_u32GcStep = 1;
+    }
 
-    len = (int32_t)size;
+    /* Move one valid slot */
+    while(g_u32GcStep < FTL_SLOT_NUM)
+    {
+        u32Tag = FMC_Read(FTL_HDR_TAG(g_i32GcBlk, g_u32GcStep));
+        if((u32Tag < FTL_SECTOR_NUM) && (g_au16L2P[u32Tag] == g_i32GcBlk * FTL_SLOT_NUM + g_u32GcStep))
+        {
+            memcpy(g_sectorBuf, (void *)FTL_SLOT_ADDR(g_i32GcBlk, g_u32GcStep), FTL_SECTOR_SIZE);
+            if(FTL_Program(u32Tag, g_sectorBuf))
+                return -1;
+            g_u32GcStep++;
+            return 0;
+        }
+        g_u32GcStep++;
+    }
 
-    if((len == FLASH_PAGE_SIZE) && ((addr & (FLASH_PAGE_SIZE - 1)) == 0))
+    /* Erase one page. Header page is erased first so that an interrupted erase is detected at mount. */
+    i = g_u32GcStep - FTL_SLOT_NUM;
+    if(i < FTL_BLOCK_SIZE / FLASH_PAGE_SIZE)
     {
-        /* Page erase */
-        FMC_Erase(addr);
+        if(FMC_Erase(FTL_BLK_ADDR(g_i32GcBlk) + i * FLASH_PAGE_SIZE))
+            return -1;
+        g_u32GcStep++;
+        return 0;
+    }
 
-        while(len >= FLASH_PAGE_SIZE)
+    if(FTL_WriteHeader(g_i32GcBlk, g_au32EraseCnt[g_i32GcBlk] + 1))
+        return -1;
+    g_i32GcBlk = -1;
+    return 0;
+}
+
+int32_t FTL_Init(void)
+{
+    uint32_t i, j, u32Tag, u32Old, u32Found, u32Min, u32Max, u32Avg, u32Cnt;
+
+    memset(g_au16L2P, 0xFF, sizeof(g_au16L2P));
+    g_u32Seq = 0;
+    g_u32FreeBlks = 0;
+    g_i32OpenBlk = -1;
+    g_i32GcBlk = -1;
+
+    /* Average erase count of the good blocks stands in for a lost one */
+    for(i = 0, u32Found = 0, u32Avg = 0; i < FTL_BLOCK_NUM; i++)
+    {
+        if(FMC_Read(FTL_HDR_MAGIC(i)) == FTL_MAGIC)
         {
-            DataFlashProgramPage(addr, (uint32_t *) buffer);
-            len    -= FLASH_PAGE_SIZE;
-            buffer += FLASH_PAGE_SIZE;
-            addr   += FLASH_PAGE_SIZE;
+            u32Found++;
+            u32Avg += FMC_Read(FTL_HDR_ERASE(i));
         }
     }
-    else
+    if(u32Found)
+        u32Avg = (u32Avg + u32Found - 1) / u32Found;
+
+    for(i = 0; i < FTL_BLOCK_NUM; i++)
     {
-        do
+        /* Format a new disk or repair a block interrupted while erasing */
+        if(u32Found == 0)
+        {
+            if(FTL_EraseBlock(i, 0))
+                return -1;
+            continue;
+        }
+        if(FMC_Read(FTL_HDR_MAGIC(i)) != FTL_MAGIC)
         {
-            alignAddr = addr & 0x1F800;
+            /* The header page is erased first, so the erase count is usually lost with it */
+            u32Cnt = FMC_Read(FTL_HDR_ERASE(i));
+            if(u32Cnt == 0xFFFFFFFF)
+                u32Cnt = u32Avg;
+            if(FTL_EraseBlock(i, u32Cnt + 1))
+                return -1;
+            continue;
+        }
 
-            /* Get the sector offset*/
-            offset = (addr & (FLASH_PAGE_SIZE - 1));
+        g_au32EraseCnt[i] = FMC_Read(FTL_HDR_ERASE(i));
+        g_au32Seq[i] = FMC_Read(FTL_HDR_SEQ(i));
+        g_au8Valid[i] = 0;
+        if(g_au32Seq[i] == FTL_SEQ_FREE)
+        {
+            g_u32FreeBlks++;
+            continue;
+        }
+        if(g_au32Seq[i] > g_u32Seq)
+            g_u32Seq = g_au32Seq[i];
 
-            if(offset || (size < FLASH_PAGE_SIZE))
+        /* Newest copy of a sector wins */
+        for(j = 1; j < FTL_SLOT_NUM; j++)
+        {
+            u32Tag = FMC_Read(FTL_HDR_TAG(i, j));
+            if(u32Tag >= FTL_SECTOR_NUM)
+                continue;
+
+            u32Old = g_au16L2P[u32Tag];
+            if(u32Old != FTL_UNMAPPED)
             {
-                /* Not 2048-byte alignment. Read the destination page for modification. Note: It needs to avoid adding MASS_STORAGE_OFFSET twice. */
-                DataFlashReadPage(alignAddr - MASS_STORAGE_OFFSET, /*FLASH_PAGE_SIZE,*/ (uint32_t)&g_sectorBuf[0]);
+                if((g_au32Seq[u32Old / FTL_SLOT_NUM] > g_au32Seq[i]) ||
+                        ((u32Old / FTL_SLOT_NUM == i) && (u32Old % FTL_SLOT_NUM > j)))
+                    continue;
+                g_au8Valid[u32Old / FTL_SLOT_NUM]--;
+            }
+            g_au16L2P[u32Tag] = i * FTL_SLOT_NUM + j;
+            g_au8Valid[i]++;
+        }
+    }
 
+    /* Continue writing the newest block */
+    for(i = 0; i < FTL_BLOCK_NUM; i++)
+    {
+        if((g_au32Seq[i] != FTL_SEQ_FREE) && (g_au32Seq[i] == g_u32Seq))
+        {
+            g_i32OpenBlk = i;
+            for(g_u32OpenSlot = 1; g_u32OpenSlot < FTL_SLOT_NUM; g_u32OpenSlot++)
+            {
+                if(FMC_Read(FTL_HDR_TAG(i, g_u32OpenSlot)) == FTL_TAG_BLANK)
+                    break;
             }
 
-            /* Source buffer */
-            pu32 = (uint32_t *)buffer;
-            /* Get the update length */
-            len = FLASH_PAGE_SIZE - offset;
-            if(size < len)
-                len = size;
-            /* Update the destination buffer */
-            for(i = 0; i < len / 4; i++)
+            /* Skip the slot if power was lost while programming it */
+            if(g_u32OpenSlot < FTL_SLOT_NUM)
             {
-                g_sectorBuf[offset / 4 + i] = pu32[i];
+                for(j = 0; j < FTL_SECTOR_SIZE; j += 4)
+                {
+                    if(FMC_Read(FTL_SLOT_ADDR(i, g_u32OpenSlot) + j) != 0xFFFFFFFF)
+                    {
+                        FMC_Write(FTL_HDR_TAG(i, g_u32OpenSlot), FTL_TAG_DEAD);
+                        g_u32OpenSlot++;
+                        break;
+                    }
+                }
             }
+        }
+    }
+
+    u32Min = 0xFFFFFFFF;
+    u32Max = 0;
+    for(i = 0; i < FTL_BLOCK_NUM; i++)
+    {
+        if(g_au32EraseCnt[i] < u32Min)
+            u32Min = g_au32EraseCnt[i];
+        if(g_au32EraseCnt[i] > u32Max)
+            u32Max = g_au32EraseCnt[i];
+    }
+    printf("FTL: %d sectors, %d free blocks, erase count %d ~ %d\n", FTL_SECTOR_NUM, g_u32FreeBlks, u32Min, u32Max);
+
+    return 0;
+}
+
+int32_t FTL_ReadSector(uint32_t u32Sector, uint32_t *pu32Buf)
+{
+    uint32_t u32Phy;
+
+    if(u32Sector >= FTL_SECTOR_NUM)
+        return -1;
+
+    u32Phy = g_au16L2P[u32Sector];
+    if(u32Phy == FTL_UNMAPPED)
+    {
+        /* Never written sector reads as erased flash */
+        memset(pu32Buf, 0xFF, FTL_SECTOR_SIZE);
+        return 0;
+    }
 
-            /* Page erase */
-            FMC_Erase(alignAddr);
-            /* Write to the destination page */
-            DataFlashProgramPage(alignAddr, (uint32_t *) g_sectorBuf);
+    /* Data flash is memory-mapped. It is faster than ISP read. */
+    memcpy(pu32Buf, (void *)FTL_SLOT_ADDR(u32Phy / FTL_SLOT_NUM, u32Phy % FTL_SLOT_NUM), FTL_SECTOR_SIZE);
 
-            size -= len;
-            addr += len;
-            buffer += len;
+    return 0;
+}
 
+int32_t FTL_WriteSector(uint32_t u32Sector, uint32_t *pu32Buf)
+{
+    uint32_t i, u32Phy;
+
+    if(u32Sector >= FTL_SECTOR_NUM)
+        return -1;
+
+    /* Skip the sector if its content is not changed */
+    u32Phy = g_au16L2P[u32Sector];
+    if(u32Phy != FTL_UNMAPPED)
+    {
+        if(memcmp((void *)FTL_SLOT_ADDR(u32Phy / FTL_SLOT_NUM, u32Phy % FTL_SLOT_NUM), pu32Buf, FTL_SECTOR_SIZE) == 0)
+            return 0;
+    }
+    else
+    {
+        for(i = 0; i < FTL_SECTOR_SIZE / 4; i++)
+        {
+            if(pu32Buf[i] != 0xFFFFFFFF)
+                break;
         }
-        while(size > 0);
+        if(i == FTL_SECTOR_SIZE / 4)
+            return 0;
+    }
+
+    /* Keep one free block for reclaim. Only erase here if idle time was not enough. */
+    while(((g_i32OpenBlk < 0) || (g_u32OpenSlot >= FTL_SLOT_NUM)) && (g_u32FreeBlks <= 1))
+    {
+        if(FTL_GcStep(0))
+            return -1;
     }
+
+    return FTL_Program(u32Sector, pu32Buf);
+}
+
+uint32_t FTL_GetSectorCount(void)
+{
+    return FTL_SECTOR_NUM;
+}
+
+/* Reclaim obsolete slots and level wear. Call it in idle time. */
+void FTL_Process(void)
+{
+    if((g_i32GcBlk >= 0) || (g_u32FreeBlks < FTL_GC_THRESHOLD))
+        FTL_GcStep(0);
+    else if(g_u32FreeBlks > FTL_GC_THRESHOLD)
+        FTL_GcStep(1);
+}
+
+void DataFlashRead(uint32_t addr, uint32_t size, uint32_t buffer)
+{
+    /* This is low level read function of USB Mass Storage */
+    while(size >= FTL_SECTOR_SIZE)
+    {
+        FTL_ReadSector(addr / FTL_SECTOR_SIZE, (uint32_t *)buffer);
+        addr   += FTL_SECTOR_SIZE;
+        buffer += FTL_SECTOR_SIZE;
+        size   -= FTL_SECTOR_SIZE;
+    }
+}
+
+int32_t DataFlashWrite(uint32_t addr, uint32_t size, uint32_t buffer)
+{
+    /* This is low level write function of USB Mass Storage. Return -1 if a sector cannot be written. */
+    while(size >= FTL_SECTOR_SIZE)
+    {
+        if(FTL_WriteSector(addr / FTL_SECTOR_SIZE, (uint32_t *)buffer))
+            return -1;
+        addr   += FTL_SECTOR_SIZE;
+        buffer += FTL_SECTOR_SIZE;
+        size   -= FTL_SECTOR_SIZE;
+    }
+    return 0;
 }
 
@@ -14,6 +14,32 @@
 #define FLASH_PAGE_SIZE           2048
 #define BUFFER_PAGE_SIZE          512
 
+/*---------------------------------------------------------------------------------------------------------*/
+/* Flash translation layer                                                                                 */
+/*   The data flash is divided into blocks of FTL_BLOCK_SIZE. Slot 0 of each block is the block header     */
+/*   (magic, erase count, sequence number and one tag per slot). Sectors are always written to the next     */
+/*   free slot of the open block, so host writes never wait for a page erase. Obsolete slots are reclaimed */
+/*   by FTL_Process() in idle time.                                                                         */
+/*---------------------------------------------------------------------------------------------------------*/
+#define FTL_BASE                  MASS_STORAGE_OFFSET
+#define FTL_SECTOR_SIZE           512                                   /* Logical sector size */
+#define FTL_BLOCK_SIZE            (4 * FLASH_PAGE_SIZE)                 /* Erase unit of FTL */
+#define FTL_BLOCK_NUM             8                                     /* FTL uses FTL_BLOCK_NUM * FTL_BLOCK_SIZE bytes */
+#define FTL_SLOT_NUM              (FTL_BLOCK_SIZE / FTL_SECTOR_SIZE)    /* Slot 0 is block header */
+#define FTL_SECTOR_NUM            (DATA_FLASH_STORAGE_SIZE / FTL_SECTOR_SIZE)
+#define FTL_GC_THRESHOLD          3           /* Reclaim blocks in idle time when free blocks are less than this */
+#define FTL_WL_THRESHOLD          32          /* Move cold data when erase counts differ more than this */
+
+#if (FTL_SECTOR_NUM > (FTL_BLOCK_NUM - 2) * (FTL_SLOT_NUM - 1))
+#error "FTL_BLOCK_NUM is too small for DATA_FLASH_STORAGE_SIZE"
+#endif
+
+int32_t FTL_Init(void);
+int32_t FTL_ReadSector(uint32_t u32Sector, uint32_t *pu32Buf);
+int32_t FTL_WriteSector(uint32_t u32Sector, uint32_t *pu32Buf);
+uint32_t FTL_GetSectorCount(void);
+void FTL_Process(void);
+
 #endif  /* __DATA_FLASH_PROG_H__ */
 
 /*** (C) COPYRIGHT 2014~2015 Nuvoton Technology Corp. ***/
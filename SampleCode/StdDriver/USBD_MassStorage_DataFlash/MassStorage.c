@@ -717,6 +717,15 @@ void MSC_ModeSense10(void)
     }
 }
 
+/* Fail the WRITE command with MEDIUM ERROR / WRITE ERROR. The remaining data is still received. */
+static void MSC_WriteError(void)
+{
+    g_au8SenseKey[0] = 0x03;
+    g_au8SenseKey[1] = 0x0C;
+    g_au8SenseKey[2] = 0x00;
+    g_sCSW.bCSWStatus = 0x01;
+}
+
 void MSC_Write(void)
 {
     uint32_t lba, len;
@@ -744,7 +753,8 @@ void MSC_Write(void)
             /* Buffer full. Writer it to storage first. */
             if(g_u32Address >= (STORAGE_DATA_BUF + STORAGE_BUFFER_SIZE))
             {
-                DataFlashWrite(g_u32DataFlashStartAddr, STORAGE_BUFFER_SIZE, (uint32_t)STORAGE_DATA_BUF);
+                if(DataFlashWrite(g_u32DataFlashStartAddr, STORAGE_BUFFER_SIZE, (uint32_t)STORAGE_DATA_BUF))
+                    MSC_WriteError();
 
                 g_u32Address = STORAGE_DATA_BUF;
                 g_u32DataFlashStartAddr += STORAGE_BUFFER_SIZE;
@@ -770,7 +780,8 @@ void MSC_Write(void)
 
                 if(len)
                 {
-                    DataFlashWrite(g_u32DataFlashStartAddr, len, (uint32_t)STORAGE_DATA_BUF);
+                    if(DataFlashWrite(g_u32DataFlashStartAddr, len, (uint32_t)STORAGE_DATA_BUF))
+                        MSC_WriteError();
                 }
             }
 
@@ -113,6 +113,14 @@ int32_t main(void)
         SYS->IPRST0 = SYS_IPRST0_CHIPRST_Msk;
     }
 
+    /* Mount flash translation layer on data flash */
+    if(FTL_Init() < 0)
+    {
+        printf("Error: FTL Init Failed!\n");
+        FMC_Close();
+        return -1;
+    }
+
     printf("NuMicro USB MassStorage Start!\n");
 
     USBD_Open(&gsInfo, MSC_ClassRequest, NULL);
@@ -127,6 +135,10 @@ int32_t main(void)
     while(1)
     {
         MSC_ProcessCmd();
+
+        /* Reclaim flash between commands */
+        if(g_u8BulkState == BULK_CBW)
+            FTL_Process();
     }
 }
 
@@ -122,6 +122,7 @@ struct CSW
 
 extern uint32_t MassBlock[];
 extern uint32_t Storage_Block[];
+extern uint8_t g_u8BulkState;
 
 #define MassCMD_BUF        ((uint32_t)&MassBlock[0])
 #define STORAGE_DATA_BUF   ((uint32_t)&Storage_Block[0])
@@ -129,7 +130,7 @@ extern uint32_t Storage_Block[];
 /*-------------------------------------------------------------*/
 
 /*-------------------------------------------------------------*/
-void DataFlashWrite(uint32_t addr, uint32_t size, uint32_t buffer);
+int32_t DataFlashWrite(uint32_t addr, uint32_t size, uint32_t buffer);
 void DataFlashRead(uint32_t addr, uint32_t size, uint32_t buffer);
 void MSC_Init(void);
 void MSC_RequestSense(void);
@@ -126,6 +126,9 @@ int32_t main(void)
         if(g_u8Suspend)
             PowerDown();
 
+        /* Decode queued print data */
+        PTR_Process();
+
         CLK_SysTickDelay(2000);   // delay
         if(++Str[1] > 0x39)
             Str[1] = 0x30;      // increase 1 to 10 than reset to 0
@@ -7,12 +7,38 @@
  * @copyright Copyright (C) 2014~2015 Nuvoton Technology Corp. All rights reserved.
  ******************************************************************************/
 
+#include  <stdio.h>
 #include  "M451Series.h"
 #include  "micro_printer.h"
 
 uint32_t volatile g_u32OutToggle = 0;
 uint8_t volatile g_u8Suspend = 0;
 
+/* Page pool. Pages [g_u32PageRd, g_u32PageWr) are full and waiting for decode. g_u32PageWr is being filled */
+static PTR_PAGE_T g_asPage[PTR_PAGE_NUM];
+static volatile uint32_t g_u32PageWr = 0;
+static volatile uint32_t g_u32PageRd = 0;
+static volatile uint8_t  g_u8OutHold = 0;      /* EP3 is not triggered because all pages are full */
+static volatile uint8_t  g_u8JobOpen = 0;      /* Data received since the last page that ended a job */
+static volatile uint32_t g_u32RxCycle = 0;     /* DWT cycle count of the last bulk OUT packet */
+static uint8_t g_u8SoftReset = 0;              /* SOFT_RESET received, completed after the EP events */
+
+/* Print job being decoded, and the last completed one */
+static PTR_JOB_T g_sJob = {0, 1};
+uint32_t volatile g_u32JobCnt = 0;
+PTR_JOB_T g_sLastJob;
+
+#if PTR_BENCHMARK
+/* Statistics */
+static volatile uint32_t g_u32RxBytes = 0;     /* Total print data received */
+static volatile uint32_t g_u32IrqCycles = 0;   /* Total CPU cycles spent in PTR_Data_Receive */
+static volatile uint32_t g_u32IrqMaxCycles = 0;
+static volatile uint32_t g_u32RxPackets = 0;
+#endif
+
+static void PTR_ClosePage(uint32_t u32Last);
+static void PTR_EndJob(void);
+
 /*--------------------------------------------------------------------------*/
 void USBD_IRQHandler(void)
 {
@@ -155,6 +181,14 @@ void USBD_IRQHandler(void)
             /* Clear event flag */
             USBD_CLR_INT_FLAG(USBD_INTSTS_EP7);
         }
+
+        if(g_u8SoftReset)
+        {
+            /* Queue the data received so far and restart bulk OUT from DATA0 */
+            g_u8SoftReset = 0;
+            PTR_EndJob();
+            g_u32OutToggle = 0;
+        }
     }
 }
 
@@ -198,6 +232,18 @@ void PTR_Init(void)
     USBD_CONFIG_EP(EP4, USBD_CFG_EPMODE_IN | INT_IN_EP_NUM);
     /* Buffer offset for EP4 ->  */
     USBD_SET_EP_BUF_ADDR(EP4, EP4_BUF_BASE);
+
+    /* Reset page pool */
+    g_u32PageWr = 0;
+    g_u32PageRd = 0;
+    g_u8OutHold = 0;
+    g_u8JobOpen = 0;
+    g_asPage[0].u32Len = 0;
+
+    /* Enable cycle counter to time the idle flush */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 }
 
 void PTR_ClassRequest(void)
@@ -231,15 +277,175 @@ void PTR_ClassRequest(void)
     else
     {
         // Host to device
+        switch(buf[1])
+        {
+            case SOFT_RESET:
+            {
+                /* The bulk OUT packet sent before this request may still be pending. USBD_IRQHandler()
+                   queues the job and resets the OUT toggle after handling it */
+                g_u8SoftReset = 1;
+                USBD_SET_DATA0(EP2);
+                /* Status stage */
+                USBD_SET_DATA1(EP0);
+                USBD_SET_PAYLOAD_LEN(EP0, 0);
+                break;
+            }
+            default:
+            {
+                /* Setup error, stall the device */
+                USBD_SetStall(0);
+                break;
+            }
+        }
     }
 }
 
+/* Queue the page being filled. Called by USBD_IRQHandler() or with interrupt disabled */
+static void PTR_ClosePage(uint32_t u32Last)
+{
+    uint32_t u32Wr = g_u32PageWr;
+
+    g_asPage[u32Wr & (PTR_PAGE_NUM - 1)].u32Last = u32Last;
+    if(u32Last)
+        g_u8JobOpen = 0;
+
+    u32Wr++;
+    g_u32PageWr = u32Wr;
+
+    if((u32Wr - g_u32PageRd) >= PTR_PAGE_NUM)
+    {
+        /* No free page. Hold bulk OUT in NAK state until a page is released */
+        g_u8OutHold = 1;
+    }
+    else
+    {
+        g_asPage[u32Wr & (PTR_PAGE_NUM - 1)].u32Len = 0;
+    }
+}
+
+/* Queue the page being filled, even if empty, as the end of the job. Called by USBD_IRQHandler() or with
+   interrupt disabled. If no page is free, the idle flush in PTR_Process() ends the job later */
+static void PTR_EndJob(void)
+{
+    if(g_u8JobOpen && !g_u8OutHold && ((g_u32PageWr + 1 - g_u32PageRd) < PTR_PAGE_NUM))
+        PTR_ClosePage(1);
+}
+
 /* Receive printer command and data from host */
 void PTR_Data_Receive(void)
 {
     uint8_t *pu8Buf = (uint8_t *)(USBD_BUF_BASE + USBD_GET_EP_BUF_ADDR(EP3));
     uint32_t u32Size = USBD_GET_PAYLOAD_LEN(EP3);
+#if PTR_BENCHMARK
+    uint32_t u32Start = DWT->CYCCNT;
+    uint32_t u32Cycles;
+#endif
+    PTR_PAGE_T *psPage;
+
+    /* Only copy the packet to current page here. Decoding is deferred to PTR_Process() */
+    psPage = &g_asPage[g_u32PageWr & (PTR_PAGE_NUM - 1)];
+    USBD_MemCopy(&psPage->au8Data[psPage->u32Len], pu8Buf, u32Size);
+    psPage->u32Len += u32Size;
+    g_u8JobOpen = 1;
+    g_u32RxCycle = DWT->CYCCNT;
+#if PTR_BENCHMARK
+    g_u32RxBytes += u32Size;
+    g_u32RxPackets++;
+#endif
+
+    /* Page is complete when it is full or at the end of a transfer (short packet) */
+    if((psPage->u32Len > PTR_PAGE_SIZE - EP3_MAX_PKT_SIZE) || (u32Size < EP3_MAX_PKT_SIZE))
+        PTR_ClosePage(u32Size < EP3_MAX_PKT_SIZE);
 
     /* trigger next OUT data */
-    USBD_SET_PAYLOAD_LEN(EP3, EP3_MAX_PKT_SIZE);
+    if(!g_u8OutHold)
+        USBD_SET_PAYLOAD_LEN(EP3, EP3_MAX_PKT_SIZE);
+
+#if PTR_BENCHMARK
+    u32Cycles = DWT->CYCCNT - u32Start;
+    g_u32IrqCycles += u32Cycles;
+    if(u32Cycles > g_u32IrqMaxCycles)
+        g_u32IrqMaxCycles = u32Cycles;
+#endif
+}
+
+/* Decode one page of print data. Called in main loop. This sample consumes the data by checksumming
+   each job. A real printer parses its commands and raster data here */
+void PTR_DecodePage(PTR_PAGE_T *psPage)
+{
+    uint32_t i, u32A, u32B;
+
+    /* Adler-32. A page is shorter than 5552 bytes, so the modulo is needed once per page only */
+    u32A = g_sJob.u32Adler & 0xFFFF;
+    u32B = g_sJob.u32Adler >> 16;
+    for(i = 0; i < psPage->u32Len; i++)
+    {
+        u32A += psPage->au8Data[i];
+        u32B += u32A;
+    }
+    g_sJob.u32Adler = ((u32B % 65521) << 16) | (u32A % 65521);
+    g_sJob.u32Bytes += psPage->u32Len;
+
+    if(psPage->u32Last && g_sJob.u32Bytes)
+    {
+        printf("Job %d: %d bytes, Adler-32 0x%08X\n", g_u32JobCnt + 1, g_sJob.u32Bytes, g_sJob.u32Adler);
+        g_sLastJob = g_sJob;
+        g_u32JobCnt++;
+        g_sJob.u32Bytes = 0;
+        g_sJob.u32Adler = 1;
+    }
+}
+
+/* Decode received pages and release them to the pool. Should be called in main loop. */
+void PTR_Process(void)
+{
+#if PTR_BENCHMARK
+    static uint32_t u32PreBytes = 0, u32PreCycle = 0;
+    uint32_t u32Cycle;
+#endif
+    uint32_t u32Rd;
+    PTR_PAGE_T *psPage;
+
+    /* A job that ends with a full packet and no zero length packet leaves its last page open.
+       Queue it when bulk OUT has been idle for PTR_IDLE_FLUSH_MS */
+    if(g_u8JobOpen && ((DWT->CYCCNT - g_u32RxCycle) >= PTR_IDLE_FLUSH_MS * (SystemCoreClock / 1000)))
+    {
+        __set_PRIMASK(1);
+        if((DWT->CYCCNT - g_u32RxCycle) >= PTR_IDLE_FLUSH_MS * (SystemCoreClock / 1000))
+            PTR_EndJob();
+        __set_PRIMASK(0);
+    }
+
+    while((u32Rd = g_u32PageRd) != g_u32PageWr)
+    {
+        psPage = &g_asPage[u32Rd & (PTR_PAGE_NUM - 1)];
+        PTR_DecodePage(psPage);
+
+        __set_PRIMASK(1);
+        g_u32PageRd = u32Rd + 1;
+        if(g_u8OutHold)
+        {
+            /* A page is free now. Start to receive again */
+            g_u8OutHold = 0;
+            g_asPage[g_u32PageWr & (PTR_PAGE_NUM - 1)].u32Len = 0;
+            USBD_SET_PAYLOAD_LEN(EP3, EP3_MAX_PKT_SIZE);
+        }
+        __set_PRIMASK(0);
+    }
+
+#if PTR_BENCHMARK
+    /* Show receive rate and IRQ time about every second */
+    u32Cycle = DWT->CYCCNT;
+    if((u32Cycle - u32PreCycle) >= SystemCoreClock)
+    {
+        if(g_u32RxBytes != u32PreBytes)
+        {
+            printf("RX %d B/s, IRQ avg %d max %d cycles/packet\n",
+                   (uint32_t)((uint64_t)(g_u32RxBytes - u32PreBytes) * SystemCoreClock / (u32Cycle - u32PreCycle)),
+                   g_u32RxPackets ? g_u32IrqCycles / g_u32RxPackets : 0, g_u32IrqMaxCycles);
+        }
+        u32PreBytes = g_u32RxBytes;
+        u32PreCycle = u32Cycle;
+    }
+#endif
 }
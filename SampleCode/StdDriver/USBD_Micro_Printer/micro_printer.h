@@ -52,14 +52,39 @@
 
 /************************************************/
 #define  GET_PORT_STATUS           0x01
+#define  SOFT_RESET                0x02
+
+/*-------------------------------------------------------------*/
+/* Print data pipeline. Bulk OUT packets are queued into pages and decoded in main loop */
+#define PTR_PAGE_SIZE       1024    /* Must be multiple of EP3_MAX_PKT_SIZE */
+#define PTR_PAGE_NUM        4       /* Must be power of 2 */
+#define PTR_IDLE_FLUSH_MS   50      /* Queue the last page of a job when bulk OUT is idle this long */
+#define PTR_BENCHMARK       0       /* 1: print receive rate and IRQ time about every second */
+
+typedef struct
+{
+    uint32_t u32Len;                        /* Bytes of print data in page */
+    uint32_t u32Last;                       /* Page ends a print job */
+    uint8_t  au8Data[PTR_PAGE_SIZE];
+} PTR_PAGE_T;
+
+typedef struct
+{
+    uint32_t u32Bytes;                      /* Bytes of print data in job */
+    uint32_t u32Adler;                      /* Adler-32 of print data */
+} PTR_JOB_T;
 
 
 /*-------------------------------------------------------------*/
 void PTR_Init(void);
 void PTR_ClassRequest(void);
 void PTR_Data_Receive(void);
+void PTR_Process(void);
+void PTR_DecodePage(PTR_PAGE_T *psPage);
 
 extern uint8_t volatile g_u8Suspend;
+extern uint32_t volatile g_u32JobCnt;
+extern PTR_JOB_T g_sLastJob;
 
 #endif  /* __USBD_PRINTER_H_ */
 
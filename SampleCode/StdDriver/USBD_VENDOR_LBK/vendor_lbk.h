@@ -21,14 +21,14 @@
 #define EP1_MAX_PKT_SIZE    EP0_MAX_PKT_SIZE
 #define EP2_MAX_PKT_SIZE    64
 #define EP3_MAX_PKT_SIZE    64
-#define EP4_MAX_PKT_SIZE    192
-#define EP5_MAX_PKT_SIZE    192
+#define EP4_MAX_PKT_SIZE    56      /* All buffers must fit in the 512-byte USB SRAM */
+#define EP5_MAX_PKT_SIZE    56
 #define EP6_MAX_PKT_SIZE    64
 #define EP7_MAX_PKT_SIZE    64
 
 #define SETUP_BUF_BASE      0
 #define SETUP_BUF_LEN       8
-#define EP0_BUF_BASE        64
+#define EP0_BUF_BASE        (SETUP_BUF_BASE + SETUP_BUF_LEN)
 #define EP0_BUF_LEN         EP0_MAX_PKT_SIZE
 #define EP1_BUF_BASE        (EP0_BUF_BASE + EP0_BUF_LEN)
 #define EP1_BUF_LEN         EP1_MAX_PKT_SIZE